@@ -15,5 +15,6 @@
 #include "dlpspec_calib.h"
 #include "dlpspec_util.h"
 #include "dlpspec_scan.h"
+#include "dlpspec_compress.h"
 
 #endif
@@ -0,0 +1,707 @@
+/*****************************************************************************
+**
+**  Copyright (c) 2015 Texas Instruments Incorporated.
+**
+******************************************************************************
+**
+**  DLP Spectrum Library
+**
+*****************************************************************************/
+
+#include <string.h>
+#include <stdint.h>
+#include "dlpspec_compress.h"
+#include "dlpspec_util.h"
+
+/**
+ * @addtogroup group_compress
+ *
+ * @{
+ */
+
+/*
+ * Lossless packing of the ADC samples of a scan.
+ *
+ * Each sample is predicted from the previous samples of its own stream: the
+ * black (all-off) patterns recur every black_pattern_period samples and sit
+ * at the dark level, so they form one stream and all other samples the
+ * other. Per block of ADC_PACK_BLOCK_LEN samples the encoder uses either the
+ * previous sample (steps such as Hadamard patterns) or the linear
+ * extrapolation of the previous two (smooth column spectra), whichever
+ * leaves the smaller residuals. The residuals are zig-zag mapped to unsigned
+ * values and Rice coded with one parameter k per block, picked by the exact
+ * coded size. Large residuals are escaped and stored as raw 32 bits, which
+ * bounds the size of any block.
+ *
+ * Bits are written LSB first. Each block starts with the predictor order
+ * bit and k. A quotient q is stored as q zero bits followed by a one, then
+ * the k low bits of the value. Header fields are little endian regardless of
+ * the target. Samples past numSamples are not stored.
+ *
+ * Neither direction allocates memory; the encoder needs one block of
+ * residuals on the stack.
+ *
+ * An interpreted spectrum is packed for clients that only want to plot or
+ * process it. Every wavelength of a scan is the calibration polynomial
+ * evaluated at the centre of a DMD column group, which is a whole or half
+ * column. The wavelengths are therefore sent as the three coefficients and
+ * the centre of each point in half columns; steps between neighbouring
+ * points barely change, so those pack to a few bits per point. Intensities
+ * are packed losslessly the same way as ADC samples.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__TI_COMPILER_VERSION__)
+#define ADC_PACK_CTZ(x)			((uint32_t)__builtin_ctz(x))
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define ADC_PACK_FAST_REFILL
+#endif
+#else
+static uint32_t ADC_PACK_CTZ(uint32_t x)
+{
+	uint32_t n = 0;
+
+	while((x & 1) == 0)
+	{
+		x >>= 1;
+		n++;
+	}
+	return n;
+}
+#endif
+
+#define ADC_PACK_K_BITS			5
+#define ADC_PACK_K_MAX			31
+#define ADC_PACK_BLOCK_HDR_BITS	(1 + ADC_PACK_K_BITS)
+
+typedef struct
+{
+	uint8_t *p;
+	uint8_t *end;
+	uint64_t acc;
+	uint32_t bits;
+} adcBitWriter;
+
+typedef struct
+{
+	const uint8_t *p;
+	const uint8_t *end;
+	uint64_t acc;
+	uint32_t bits;
+	uint32_t pad;		/* zero bytes fed past the end of the stream */
+} adcBitReader;
+
+static bool adc_put_bits(adcBitWriter *pW, uint64_t val, uint32_t n)
+/* Appends the n low bits of val; n + pending bits must not exceed 64 */
+{
+	pW->acc |= val << pW->bits;
+	pW->bits += n;
+	while(pW->bits >= 8)
+	{
+		if(pW->p == pW->end)
+			return false;
+		*pW->p++ = (uint8_t)pW->acc;
+		pW->acc >>= 8;
+		pW->bits -= 8;
+	}
+	return true;
+}
+
+static void adc_refill(adcBitReader *pR)
+/* Tops the bit window up to at least 56 bits */
+{
+#ifdef ADC_PACK_FAST_REFILL
+	uint64_t val;
+
+	if(pR->end - pR->p >= 8)
+	{
+		memcpy(&val, pR->p, sizeof(val));
+		pR->acc |= val << pR->bits;
+		pR->p += (63 - pR->bits) >> 3;
+		pR->bits |= 56;
+		return;
+	}
+#endif
+	while(pR->bits <= 56)
+	{
+		if(pR->p < pR->end)
+			pR->acc |= (uint64_t)(*pR->p++) << pR->bits;
+		else
+			pR->pad++;
+		pR->bits += 8;
+	}
+}
+
+static void adc_skip_bits(adcBitReader *pR, uint32_t n)
+{
+	pR->acc >>= n;
+	pR->bits -= n;
+}
+
+static uint32_t adc_rice_cost(const uint32_t *pZ, int len, uint32_t k)
+/* Exact size in bits of one block coded with parameter k */
+{
+	uint32_t cost = ADC_PACK_BLOCK_HDR_BITS;
+	uint32_t q;
+	int i;
+
+	for(i = 0; i < len; i++)
+	{
+		q = pZ[i] >> k;
+		if(q < ADC_PACK_ESCAPE)
+			cost += q + 1 + k;
+		else
+			cost += ADC_PACK_ESCAPE + 1 + 32;
+	}
+	return cost;
+}
+
+static uint32_t adc_zigzag(uint32_t d)
+{
+	return (d << 1) ^ (uint32_t)((int32_t)d >> 31);
+}
+
+static uint32_t adc_choose_k(const uint32_t *pZ, int len, uint64_t sum)
+/* Rice coding is optimal close to k = log2(mean) - 0.5; of the two
+ * neighbouring values the cheaper one is picked */
+{
+	uint32_t mean = (uint32_t)(sum / len);
+	uint32_t k0 = 0;
+	uint32_t k;
+	uint32_t kBest;
+	uint32_t cost;
+	uint32_t costBest;
+
+	while((k0 < ADC_PACK_K_MAX) && ((mean >> (k0 + 1)) != 0))
+		k0++;
+
+	kBest = (k0 > 0) ? k0 - 1 : 0;
+	costBest = adc_rice_cost(pZ, len, kBest);
+	for(k = kBest + 1; k <= k0; k++)
+	{
+		cost = adc_rice_cost(pZ, len, k);
+		if(cost < costBest)
+		{
+			costBest = cost;
+			kBest = k;
+		}
+	}
+	return kBest;
+}
+
+static void adc_put_u16(uint8_t *p, uint16_t val)
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)(val >> 8);
+}
+
+static void adc_put_u32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)(val >> 8);
+	p[2] = (uint8_t)(val >> 16);
+	p[3] = (uint8_t)(val >> 24);
+}
+
+static uint16_t adc_get_u16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t adc_get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+		((uint32_t)p[3] << 24);
+}
+
+static void adc_put_double(uint8_t *p, double val)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &val, sizeof(bits));
+	adc_put_u32(p, (uint32_t)bits);
+	adc_put_u32(p + 4, (uint32_t)(bits >> 32));
+}
+
+static double adc_get_double(const uint8_t *p)
+{
+	uint64_t bits = adc_get_u32(p) | ((uint64_t)adc_get_u32(p + 4) << 32);
+	double val;
+
+	memcpy(&val, &bits, sizeof(val));
+	return val;
+}
+
+bool dlpspec_adc_is_packed(const void *pBuf, const size_t bufSize)
+/**
+ * Tells whether a buffer starts with a packed ADC data stream
+ *
+ * @param[in]   pBuf        Pointer to the buffer
+ * @param[in]   bufSize     buffer size, in bytes
+ *
+ * @return      true if the stream header is recognized
+ *
+ */
+{
+	const uint8_t *p = (const uint8_t *)pBuf;
+
+	if((pBuf == NULL) || (bufSize < ADC_PACK_HEADER_SIZE))
+		return false;
+
+	return ((p[0] == ADC_PACK_MAGIC0) && (p[1] == ADC_PACK_MAGIC1) &&
+			(p[2] == ADC_PACK_MAGIC2) && (p[3] == ADC_PACK_MAGIC3) &&
+			(p[4] == ADC_PACK_VERSION) && (p[5] == ADC_PACK_BLOCK_LEN));
+}
+
+DLPSPEC_ERR_CODE dlpspec_adc_get_packed_size(const void *pBuf,
+		const size_t bufSize, size_t *pSize)
+/**
+ * Returns the size of the packed ADC data stream at the start of a buffer
+ *
+ * @param[in]   pBuf        Pointer to the packed stream
+ * @param[in]   bufSize     buffer size, in bytes
+ * @param[out]  pSize       stream size including its header, in bytes
+ *
+ * @return      Error code
+ *
+ */
+{
+	size_t size;
+
+	if((pBuf == NULL) || (pSize == NULL))
+		return (ERR_DLPSPEC_NULL_POINTER);
+
+	if(!dlpspec_adc_is_packed(pBuf, bufSize))
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	size = ADC_PACK_HEADER_SIZE + adc_get_u32((const uint8_t *)pBuf + 12);
+	if(size > bufSize)
+		return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+
+	*pSize = size;
+	return (DLPSPEC_PASS);
+}
+
+DLPSPEC_ERR_CODE dlpspec_adc_pack(const int32_t *pADC, const uint16_t numSamples,
+		const uint8_t blackFirst, const uint8_t blackPeriod, void *pBuf,
+		const size_t bufSize, size_t *pSize)
+/**
+ * Losslessly packs ADC samples. The black pattern position only steers the
+ * prediction; any value gives back the same samples, a wrong one just packs
+ * less tightly.
+ *
+ * @param[in]   pADC        Pointer to the ADC samples
+ * @param[in]   numSamples  number of samples to pack
+ * @param[in]   blackFirst  index of the first black pattern sample
+ * @param[in]   blackPeriod black pattern recurrence; 0 if there are none
+ * @param[out]  pBuf        Pointer to buffer for the packed stream
+ * @param[in]   bufSize     buffer size, in bytes
+ * @param[out]  pSize       bytes of pBuf used
+ *
+ * @return      Error code; ERR_DLPSPEC_INSUFFICIENT_MEM when the packed stream
+ *              does not fit in bufSize, so that passing the unpacked size
+ *              tells whether packing pays off
+ *
+ */
+{
+	adcBitWriter w;
+	uint32_t z[2][ADC_PACK_BLOCK_LEN];
+	uint32_t prev[2] = {0, 0};
+	uint32_t prev2[2] = {0, 0};
+	uint32_t nextBlack;
+	uint32_t x;
+	uint32_t q;
+	uint32_t k;
+	uint32_t mask;
+	uint64_t sum[2];
+	const uint32_t *pZ;
+	int order;
+	int start;
+	int len;
+	int cls;
+	int i;
+
+	if((pADC == NULL) || (pBuf == NULL) || (pSize == NULL))
+		return (ERR_DLPSPEC_NULL_POINTER);
+
+	if(bufSize < ADC_PACK_HEADER_SIZE)
+		return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+
+	w.p = (uint8_t *)pBuf + ADC_PACK_HEADER_SIZE;
+	w.end = (uint8_t *)pBuf + bufSize;
+	w.acc = 0;
+	w.bits = 0;
+
+	nextBlack = (blackPeriod != 0) ? blackFirst : UINT32_MAX;
+
+	for(start = 0; start < numSamples; start += ADC_PACK_BLOCK_LEN)
+	{
+		len = numSamples - start;
+		if(len > ADC_PACK_BLOCK_LEN)
+			len = ADC_PACK_BLOCK_LEN;
+
+		sum[0] = 0;
+		sum[1] = 0;
+		for(i = 0; i < len; i++)
+		{
+			cls = ((uint32_t)(start + i) == nextBlack);
+			if(cls)
+				nextBlack += blackPeriod;
+			x = (uint32_t)pADC[start + i];
+			z[0][i] = adc_zigzag(x - prev[cls]);
+			z[1][i] = adc_zigzag(x - (2 * prev[cls] - prev2[cls]));
+			prev2[cls] = prev[cls];
+			prev[cls] = x;
+			sum[0] += z[0][i];
+			sum[1] += z[1][i];
+		}
+
+		order = (sum[1] < sum[0]);
+		pZ = z[order];
+		k = adc_choose_k(pZ, len, sum[order]);
+		mask = ((uint32_t)1 << k) - 1;
+		if(!adc_put_bits(&w, order | (k << 1), ADC_PACK_BLOCK_HDR_BITS))
+			return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+
+		for(i = 0; i < len; i++)
+		{
+			q = pZ[i] >> k;
+			if(q < ADC_PACK_ESCAPE)
+			{
+				if(!adc_put_bits(&w, ((uint64_t)1 << q) |
+							((uint64_t)(pZ[i] & mask) << (q + 1)), q + 1 + k))
+					return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+			}
+			else
+			{
+				if(!adc_put_bits(&w, (uint64_t)1 << ADC_PACK_ESCAPE,
+							ADC_PACK_ESCAPE + 1) ||
+						!adc_put_bits(&w, pZ[i], 32))
+					return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+			}
+		}
+	}
+
+	if(w.bits != 0)
+	{
+		if(!adc_put_bits(&w, 0, 8 - w.bits))
+			return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+	}
+
+	*pSize = (size_t)(w.p - (uint8_t *)pBuf);
+
+	w.p = (uint8_t *)pBuf;
+	w.p[0] = ADC_PACK_MAGIC0;
+	w.p[1] = ADC_PACK_MAGIC1;
+	w.p[2] = ADC_PACK_MAGIC2;
+	w.p[3] = ADC_PACK_MAGIC3;
+	w.p[4] = ADC_PACK_VERSION;
+	w.p[5] = ADC_PACK_BLOCK_LEN;
+	adc_put_u16(&w.p[6], numSamples);
+	w.p[8] = blackFirst;
+	w.p[9] = blackPeriod;
+	adc_put_u16(&w.p[10], 0);
+	adc_put_u32(&w.p[12], (uint32_t)(*pSize - ADC_PACK_HEADER_SIZE));
+
+	return (DLPSPEC_PASS);
+}
+
+DLPSPEC_ERR_CODE dlpspec_adc_unpack(const void *pBuf, const size_t bufSize,
+		int32_t *pADC, const uint16_t maxSamples, uint16_t *pNumSamples)
+/**
+ * Restores the ADC samples of a stream packed by dlpspec_adc_pack()
+ *
+ * @param[in]   pBuf        Pointer to the packed stream
+ * @param[in]   bufSize     buffer size, in bytes
+ * @param[out]  pADC        Pointer to array for the samples
+ * @param[in]   maxSamples  length of the pADC array
+ * @param[out]  pNumSamples number of samples restored
+ *
+ * @return      Error code
+ *
+ */
+{
+	const uint8_t *p = (const uint8_t *)pBuf;
+	adcBitReader r;
+	uint32_t prev[2] = {0, 0};
+	uint32_t prev2[2] = {0, 0};
+	size_t size;
+	uint32_t numSamples;
+	uint32_t nextBlack;
+	uint32_t blackPeriod;
+	uint32_t low;
+	uint32_t q;
+	uint32_t k;
+	uint32_t z;
+	uint32_t x;
+	int order;
+	int start;
+	int len;
+	int cls;
+	int i;
+	DLPSPEC_ERR_CODE ret_val;
+
+	if((pBuf == NULL) || (pADC == NULL) || (pNumSamples == NULL))
+		return (ERR_DLPSPEC_NULL_POINTER);
+
+	ret_val = dlpspec_adc_get_packed_size(pBuf, bufSize, &size);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+
+	numSamples = adc_get_u16(&p[6]);
+	if(numSamples > maxSamples)
+		return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+
+	blackPeriod = p[9];
+	nextBlack = (blackPeriod != 0) ? p[8] : UINT32_MAX;
+
+	r.p = p + ADC_PACK_HEADER_SIZE;
+	r.end = p + size;
+	r.acc = 0;
+	r.bits = 0;
+	r.pad = 0;
+
+	for(start = 0; start < (int)numSamples; start += ADC_PACK_BLOCK_LEN)
+	{
+		len = numSamples - start;
+		if(len > ADC_PACK_BLOCK_LEN)
+			len = ADC_PACK_BLOCK_LEN;
+
+		adc_refill(&r);
+		order = (int)(r.acc & 1);
+		k = (uint32_t)(r.acc >> 1) & ((1 << ADC_PACK_K_BITS) - 1);
+		adc_skip_bits(&r, ADC_PACK_BLOCK_HDR_BITS);
+
+		for(i = 0; i < len; i++)
+		{
+			adc_refill(&r);
+			low = (uint32_t)r.acc & ((1 << (ADC_PACK_ESCAPE + 1)) - 1);
+			if(low == 0)
+				return (ERR_DLPSPEC_INVALID_INPUT);
+			q = ADC_PACK_CTZ(low);
+			adc_skip_bits(&r, q + 1);
+			if(q < ADC_PACK_ESCAPE)
+			{
+				z = (q << k) | ((uint32_t)r.acc & (((uint32_t)1 << k) - 1));
+				adc_skip_bits(&r, k);
+			}
+			else
+			{
+				adc_refill(&r);
+				z = (uint32_t)r.acc;
+				adc_skip_bits(&r, 32);
+			}
+
+			cls = ((uint32_t)(start + i) == nextBlack);
+			if(cls)
+				nextBlack += blackPeriod;
+			x = (z >> 1) ^ (0 - (z & 1));
+			if(order)
+				x += 2 * prev[cls] - prev2[cls];
+			else
+				x += prev[cls];
+			prev2[cls] = prev[cls];
+			prev[cls] = x;
+			pADC[start + i] = (int32_t)x;
+		}
+	}
+
+	/* Bits still in the window were read ahead; only zero padding may have
+	 * been consumed past the end of the stream */
+	if(r.pad * 8 > r.bits)
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	*pNumSamples = (uint16_t)numSamples;
+	return (DLPSPEC_PASS);
+}
+
+DLPSPEC_ERR_CODE dlpspec_spectrum_pack(const scanResults *pResults,
+		const uint8_t shift, int32_t *pWork, void *pBuf, const size_t bufSize,
+		size_t *pSize)
+/**
+ * Packs the wavelengths and intensities of an interpreted scan. The
+ * wavelengths come back to within HALF_COLUMN_NM_TOLERANCE (0.001 nm) of
+ * the interpreted ones, not necessarily bit for bit. Intensities are rounded to a multiple of 2^shift; with shift 0
+ * they come back exactly.
+ *
+ * @param[in]   pResults    Pointer to the interpreted scan
+ * @param[in]   shift       intensity bits to drop or SPEC_PACK_SHIFT_INT16
+ * @param[out]  pWork       scratch array of at least pResults->length entries
+ * @param[out]  pBuf        Pointer to buffer for the packed spectrum
+ * @param[in]   bufSize     buffer size, in bytes
+ * @param[out]  pSize       bytes of pBuf used
+ *
+ * @return      Error code; ERR_DLPSPEC_INVALID_INPUT when a wavelength does
+ *              not lie on the calibration polynomial of the scan
+ *
+ */
+{
+	uint8_t *p = (uint8_t *)pBuf;
+	const double *pCoeffs;
+	size_t colSize;
+	size_t intSize;
+	int64_t maxVal = 0;
+	uint32_t bits = shift;
+	int i;
+	DLPSPEC_ERR_CODE ret_val;
+
+	if((pResults == NULL) || (pWork == NULL) || (pBuf == NULL) ||
+			(pSize == NULL))
+		return (ERR_DLPSPEC_NULL_POINTER);
+
+	if((pResults->length < 0) || (pResults->length > ADC_DATA_LEN) ||
+			((shift > 31) && (shift != SPEC_PACK_SHIFT_INT16)))
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	if(shift == SPEC_PACK_SHIFT_INT16)
+	{
+		for(i = 0; i < pResults->length; i++)
+		{
+			if((int64_t)pResults->intensity[i] > maxVal)
+				maxVal = pResults->intensity[i];
+			if(-(int64_t)pResults->intensity[i] > maxVal + 1)
+				maxVal = -(int64_t)pResults->intensity[i] - 1;
+		}
+		/* Rounding may carry the largest value up by one step */
+		bits = 0;
+		while(((maxVal + ((int64_t)1 << bits >> 1)) >> bits) > INT16_MAX)
+			bits++;
+	}
+
+	if(bufSize < SPEC_PACK_HEADER_SIZE)
+		return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+
+	pCoeffs = pResults->calibration_coeffs.PixelToWavelengthCoeffs;
+	for(i = 0; i < pResults->length; i++)
+	{
+		ret_val = dlpspec_util_nmToHalfColumn(pResults->wavelength[i], pCoeffs,
+				&pWork[i]);
+		if(ret_val != DLPSPEC_PASS)
+			return ret_val;
+	}
+
+	ret_val = dlpspec_adc_pack(pWork, (uint16_t)pResults->length, 0, 0,
+			p + SPEC_PACK_HEADER_SIZE, bufSize - SPEC_PACK_HEADER_SIZE,
+			&colSize);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+
+	/* The half columns are packed; the work array takes the scaled
+	 * intensities next */
+	for(i = 0; i < pResults->length; i++)
+		pWork[i] = (int32_t)(((int64_t)pResults->intensity[i] +
+					((int64_t)1 << bits >> 1)) >> bits);
+
+	ret_val = dlpspec_adc_pack(pWork, (uint16_t)pResults->length, 0, 0,
+			p + SPEC_PACK_HEADER_SIZE + colSize,
+			bufSize - SPEC_PACK_HEADER_SIZE - colSize, &intSize);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+
+	*pSize = SPEC_PACK_HEADER_SIZE + colSize + intSize;
+
+	p[0] = SPEC_PACK_MAGIC0;
+	p[1] = SPEC_PACK_MAGIC1;
+	p[2] = SPEC_PACK_MAGIC2;
+	p[3] = SPEC_PACK_MAGIC3;
+	p[4] = SPEC_PACK_VERSION;
+	p[5] = 0;
+	adc_put_u16(&p[6], (uint16_t)pResults->length);
+	p[8] = pResults->pga;
+	p[9] = (uint8_t)bits;
+	adc_put_u16(&p[10], 0);
+	adc_put_u32(&p[12], (uint32_t)(*pSize - 16));
+	for(i = 0; i < 3; i++)
+		adc_put_double(&p[16 + 8 * i], pCoeffs[i]);
+
+	return (DLPSPEC_PASS);
+}
+
+DLPSPEC_ERR_CODE dlpspec_spectrum_unpack(const void *pBuf, const size_t bufSize,
+		scanResults *pResults)
+/**
+ * Restores a spectrum packed by dlpspec_spectrum_pack(), scaling the
+ * intensities back up if they were rounded. Fills in the
+ * wavelength, intensity, length, pga and calibration coefficient fields of
+ * pResults and leaves the others alone.
+ *
+ * @param[in]   pBuf        Pointer to the packed spectrum
+ * @param[in]   bufSize     buffer size, in bytes
+ * @param[out]  pResults    Pointer to the scan results to fill in
+ *
+ * @return      Error code
+ *
+ */
+{
+	const uint8_t *p = (const uint8_t *)pBuf;
+	double *pCoeffs;
+	size_t size;
+	size_t colSize;
+	uint16_t numPoints;
+	uint16_t num;
+	uint32_t bits;
+	int i;
+	DLPSPEC_ERR_CODE ret_val;
+
+	if((pBuf == NULL) || (pResults == NULL))
+		return (ERR_DLPSPEC_NULL_POINTER);
+
+	if((bufSize < SPEC_PACK_HEADER_SIZE) || (p[0] != SPEC_PACK_MAGIC0) ||
+			(p[1] != SPEC_PACK_MAGIC1) || (p[2] != SPEC_PACK_MAGIC2) ||
+			(p[3] != SPEC_PACK_MAGIC3) || (p[4] != SPEC_PACK_VERSION))
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	size = 16 + (size_t)adc_get_u32(&p[12]);
+	if((size < SPEC_PACK_HEADER_SIZE) || (size > bufSize))
+		return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+
+	numPoints = adc_get_u16(&p[6]);
+	if(numPoints > ADC_DATA_LEN)
+		return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+
+	bits = p[9];
+	if(bits > 31)
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	pCoeffs = pResults->calibration_coeffs.PixelToWavelengthCoeffs;
+	for(i = 0; i < 3; i++)
+		pCoeffs[i] = adc_get_double(&p[16 + 8 * i]);
+
+	/* The half columns go through the intensity array on their way to the
+	 * wavelengths */
+	ret_val = dlpspec_adc_get_packed_size(p + SPEC_PACK_HEADER_SIZE,
+			size - SPEC_PACK_HEADER_SIZE, &colSize);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+
+	ret_val = dlpspec_adc_unpack(p + SPEC_PACK_HEADER_SIZE, colSize,
+			(int32_t *)pResults->intensity, ADC_DATA_LEN, &num);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+	if(num != numPoints)
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	for(i = 0; i < numPoints; i++)
+		dlpspec_util_columnToNm(pResults->intensity[i] / 2.0, pCoeffs,
+				&pResults->wavelength[i]);
+
+	ret_val = dlpspec_adc_unpack(p + SPEC_PACK_HEADER_SIZE + colSize,
+			size - SPEC_PACK_HEADER_SIZE - colSize,
+			(int32_t *)pResults->intensity, ADC_DATA_LEN, &num);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+	if(num != numPoints)
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	for(i = 0; i < numPoints; i++)
+		pResults->intensity[i] = (int)(int32_t)
+			((uint32_t)pResults->intensity[i] << bits);
+
+	pResults->length = numPoints;
+	pResults->pga = p[8];
+
+	return (DLPSPEC_PASS);
+}
+
+/** @} // group group_compress
+ *
+ */
@@ -0,0 +1,93 @@
+/*****************************************************************************
+**
+**  Copyright (c) 2015 Texas Instruments Incorporated.
+**
+******************************************************************************
+**
+**  DLP Spectrum Library
+**
+*****************************************************************************/
+
+#ifndef _DLPSPEC_COMPRESS_H
+#define _DLPSPEC_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "dlpspec_types.h"
+#include "dlpspec_scan.h"
+
+/**
+ * @addtogroup group_compress
+ *
+ * @{
+ */
+
+/** First bytes of a packed ADC data stream: "ADCz" */
+#define ADC_PACK_MAGIC0			'A'
+#define ADC_PACK_MAGIC1			'D'
+#define ADC_PACK_MAGIC2			'C'
+#define ADC_PACK_MAGIC3			'z'
+#define ADC_PACK_VERSION		1
+
+/** Size of the stream header in bytes */
+#define ADC_PACK_HEADER_SIZE	16
+
+/** Samples coded with one Rice parameter */
+#define ADC_PACK_BLOCK_LEN		32
+
+/** Quotients of this size or larger are escaped and stored as raw 32 bits */
+#define ADC_PACK_ESCAPE			24
+
+/**
+ * Worst case size of a packed stream of num samples. dlpspec_adc_pack() gives
+ * up before reaching it when the data does not compress.
+ */
+#define ADC_PACK_MAX_SIZE(num)	(ADC_PACK_HEADER_SIZE + 8 + \
+		((num) * (ADC_PACK_ESCAPE + 1 + 32) + \
+		 (((num) + ADC_PACK_BLOCK_LEN - 1) / ADC_PACK_BLOCK_LEN) * 6 + 7) / 8)
+
+/** First bytes of a packed interpreted spectrum: "SPCz" */
+#define SPEC_PACK_MAGIC0		'S'
+#define SPEC_PACK_MAGIC1		'P'
+#define SPEC_PACK_MAGIC2		'C'
+#define SPEC_PACK_MAGIC3		'z'
+#define SPEC_PACK_VERSION		1
+
+/** Size of the spectrum header, including the calibration coefficients */
+#define SPEC_PACK_HEADER_SIZE	(16 + 3 * 8)
+
+/**
+ * Intensity scaling for dlpspec_spectrum_pack(): the smallest right shift
+ * that brings every intensity into the int16_t range. Shifts 0 to 31 are
+ * taken as given, 0 keeping the intensities exact.
+ */
+#define SPEC_PACK_SHIFT_INT16	0xFF
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+DLPSPEC_ERR_CODE dlpspec_adc_pack(const int32_t *pADC, const uint16_t numSamples,
+		const uint8_t blackFirst, const uint8_t blackPeriod, void *pBuf,
+		const size_t bufSize, size_t *pSize);
+DLPSPEC_ERR_CODE dlpspec_adc_unpack(const void *pBuf, const size_t bufSize,
+		int32_t *pADC, const uint16_t maxSamples, uint16_t *pNumSamples);
+DLPSPEC_ERR_CODE dlpspec_adc_get_packed_size(const void *pBuf,
+		const size_t bufSize, size_t *pSize);
+bool dlpspec_adc_is_packed(const void *pBuf, const size_t bufSize);
+DLPSPEC_ERR_CODE dlpspec_spectrum_pack(const scanResults *pResults,
+		const uint8_t shift, int32_t *pWork, void *pBuf, const size_t bufSize,
+		size_t *pSize);
+DLPSPEC_ERR_CODE dlpspec_spectrum_unpack(const void *pBuf, const size_t bufSize,
+		scanResults *pResults);
+
+#ifdef __cplusplus      /* matches __cplusplus construct above */
+}
+#endif
+
+/** @} // group group_compress
+ *
+ */
+
+#endif //_DLPSPEC_COMPRESS_H
@@ -21,6 +21,7 @@
 #include "dlpspec_helper.h"
 #include "dlpspec_util.h"
 #include "dlpspec_calib.h"
+#include "dlpspec_compress.h"
 
 /**
  * @addtogroup group_scan
@@ -435,7 +436,7 @@ DLPSPEC_ERR_CODE dlpspec_get_scan_data_dump_size(const uScanData *pData,
     if (pData == NULL)
 		return (ERR_DLPSPEC_NULL_POINTER);
 
-	if(pData->data.scan_type != SLEW_TYPE)
+	if(dlpspec_scan_data_get_type(pData) != SLEW_TYPE)
 	{
 		ret_val = dlpspec_get_serialize_dump_size(pData, pBufSize, SCAN_DATA_TYPE);
 	}
@@ -451,6 +452,43 @@ DLPSPEC_ERR_CODE dlpspec_get_scan_data_dump_size(const uScanData *pData,
 
 }
 
+/* Leading fields of #slewScanData, as serialized by SLEW_DATA_HEAD_TYPE */
+typedef struct
+{
+    SCAN_DATA_VERSION
+    SCAN_DATA_HEAD
+} slewScanDataHead;
+
+static DLPSPEC_ERR_CODE dlpspec_scan_write_slew_head(const uScanData *pData,
+		uint32_t header_version, void *pBuf, size_t size_data_head,
+		size_t size_cfg_head, size_t size_sect)
+/* Serializes everything of a slew scan but the ADC data, which follows, with
+ * header_version in place of the one in pData */
+{
+    DLPSPEC_ERR_CODE ret_val;
+	slewScanDataHead head;
+	void *pHeadBuf;
+	void *pSectBuf;
+
+	memcpy(&head, pData, sizeof(head));
+	head.header_version = header_version;
+	ret_val = dlpspec_serialize(&head, pBuf, size_data_head, 
+			SLEW_DATA_HEAD_TYPE);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+	pHeadBuf = (void *)((uintptr_t)pBuf + size_data_head);
+	ret_val = dlpspec_serialize(&pData->slew_data.slewCfg, pHeadBuf, 
+			size_cfg_head, SLEW_CFG_HEAD_TYPE);
+
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+	pSectBuf = (void *)((uintptr_t)pHeadBuf + size_cfg_head);
+	ret_val = dlpspec_serialize(&pData->slew_data.slewCfg.section[0], 
+			pSectBuf, size_sect, SLEW_CFG_SECT_TYPE);
+
+	return ret_val;
+}
+
 DLPSPEC_ERR_CODE dlpspec_scan_write_data(const uScanData *pData, void *pBuf, 
 		const size_t bufSize)
 /**
@@ -471,8 +509,6 @@ DLPSPEC_ERR_CODE dlpspec_scan_write_data(const uScanData *pData, void *pBuf,
 	size_t size_cfg_head;
 	size_t size_sect;
 	size_t size_adc_data;
-	void *pHeadBuf;
-	void *pSectBuf;
 	void *pADCdataBuf;
     int type;
     
@@ -505,22 +541,13 @@ DLPSPEC_ERR_CODE dlpspec_scan_write_data(const uScanData *pData, void *pBuf,
 			return ERR_DLPSPEC_INSUFFICIENT_MEM;
 		}
 
-		ret_val = dlpspec_serialize(pData, pBuf, size_data_head, 
-				SLEW_DATA_HEAD_TYPE);
+		ret_val = dlpspec_scan_write_slew_head(pData,
+				pData->slew_data.header_version, pBuf, size_data_head,
+				size_cfg_head, size_sect);
 		if(ret_val != DLPSPEC_PASS)
 			return ret_val;
-		pHeadBuf = (void *)((uintptr_t)pBuf + size_data_head);
-		ret_val = dlpspec_serialize(&pData->slew_data.slewCfg, pHeadBuf, 
-				size_cfg_head, SLEW_CFG_HEAD_TYPE);
-
-		if(ret_val != DLPSPEC_PASS)
-			return ret_val;
-		pSectBuf = (void *)((uintptr_t)pHeadBuf + size_cfg_head);
-		ret_val = dlpspec_serialize(&pData->slew_data.slewCfg.section[0], 
-				pSectBuf, size_sect, SLEW_CFG_SECT_TYPE);
-		if(ret_val != DLPSPEC_PASS)
-			return ret_val;
-		pADCdataBuf = (void *)((uintptr_t)pSectBuf + size_sect);
+		pADCdataBuf = (void *)((uintptr_t)pBuf + size_data_head + 
+				size_cfg_head + size_sect);
 		ret_val = dlpspec_serialize(&pData->slew_data.adc_data[0], pADCdataBuf,
 				size_adc_data, SLEW_DATA_ADC_TYPE);
 	}
@@ -528,10 +555,109 @@ DLPSPEC_ERR_CODE dlpspec_scan_write_data(const uScanData *pData, void *pBuf,
     return ret_val;
 }
 
+DLPSPEC_ERR_CODE dlpspec_scan_write_data_encoded(const uScanData *pData,
+		void *pBuf, const size_t bufSize, const ADC_DATA_ENCODING encoding,
+		size_t *pSize)
+/**
+ * Function to write scan data to serialized format, optionally with the ADC
+ * data of a slew scan packed losslessly. The packed stream takes the place of
+ * the ADC data TPL array and the data is written as #PACKED_SCANDATA_VERSION,
+ * which dlpspec_scan_read_data() and dlpspec_scan_interpret() of 2.0.4 and
+ * later accept and older ones reject. Other scan types, and slew scans whose
+ * ADC data does not get smaller, are written as by dlpspec_scan_write_data().
+ *
+ * @param[in]       pData       Pointer to scan data
+ * @param[in,out]   pBuf        Pointer to buffer in which to store the 
+ *								serialized scan data
+ * @param[in]       bufSize     buffer size, in bytes
+ * @param[in]       encoding    encoding of the ADC data
+ * @param[out]      pSize       bytes of pBuf used
+ *
+ * @return          Error code
+ *
+ */
+{
+    DLPSPEC_ERR_CODE ret_val = (DLPSPEC_PASS);
+	size_t size_data_head;
+	size_t size_cfg_head;
+	size_t size_sect;
+	size_t size_adc_data;
+	size_t size_head;
+	size_t size_packed;
+	uint16_t num_samples;
+	void *pADCdataBuf;
+
+    if ((pData == NULL) || (pBuf == NULL) || (pSize == NULL))
+        return (ERR_DLPSPEC_NULL_POINTER);
+
+    if((encoding == ADC_DATA_ENCODING_RAW) || 
+			(dlpspec_scan_data_get_type(pData) != SLEW_TYPE))
+	{
+		ret_val = dlpspec_scan_write_data(pData, pBuf, bufSize);
+		if(ret_val != DLPSPEC_PASS)
+			return ret_val;
+		return dlpspec_get_scan_data_dump_size(pData, pSize);
+	}
+	else if(encoding != ADC_DATA_ENCODING_RICE)
+		return (ERR_DLPSPEC_INVALID_INPUT);
+
+	ret_val =  dlpspec_get_scan_data_dump_sizes(&pData->slew_data, 
+			&size_data_head, &size_cfg_head, &size_sect, &size_adc_data);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+
+	size_head = size_data_head+size_cfg_head+size_sect;
+	if(bufSize < size_head)
+		return ERR_DLPSPEC_INSUFFICIENT_MEM;
+
+	pADCdataBuf = (void *)((uintptr_t)pBuf + size_head);
+	num_samples = pData->slew_data.adc_data_length;
+	if(num_samples > ADC_DATA_LEN)
+		num_samples = ADC_DATA_LEN;
+
+	// Only keep the packed stream if it is smaller than the TPL array
+	if(bufSize - size_head < size_adc_data)
+		size_packed = bufSize - size_head;
+	else
+		size_packed = size_adc_data - 1;
+	ret_val = dlpspec_adc_pack(&pData->slew_data.adc_data[0], num_samples,
+			pData->slew_data.black_pattern_first,
+			pData->slew_data.black_pattern_period, pADCdataBuf, size_packed,
+			&size_packed);
+	if(ret_val == DLPSPEC_PASS)
+	{
+		// The head goes in last as its version depends on the packing
+		ret_val = dlpspec_scan_write_slew_head(pData, PACKED_SCANDATA_VERSION,
+				pBuf, size_data_head, size_cfg_head, size_sect);
+		if(ret_val == DLPSPEC_PASS)
+			*pSize = size_head + size_packed;
+		return ret_val;
+	}
+	else if(ret_val != ERR_DLPSPEC_INSUFFICIENT_MEM)
+		return ret_val;
+
+	if(bufSize < size_head + size_adc_data)
+		return ERR_DLPSPEC_INSUFFICIENT_MEM;
+
+	ret_val = dlpspec_scan_write_slew_head(pData,
+			pData->slew_data.header_version, pBuf, size_data_head,
+			size_cfg_head, size_sect);
+	if(ret_val != DLPSPEC_PASS)
+		return ret_val;
+	ret_val = dlpspec_serialize(&pData->slew_data.adc_data[0], pADCdataBuf,
+			size_adc_data, SLEW_DATA_ADC_TYPE);
+	if(ret_val == DLPSPEC_PASS)
+		*pSize = size_head + size_adc_data;
+
+	return ret_val;
+}
+
 DLPSPEC_ERR_CODE dlpspec_scan_read_data(void *pBuf, const size_t bufSize)
 /**
  * Function to deserialize a serialized scan data blob. The deserialized data
- * is placed at the same buffer (pBuf).
+ * is placed at the same buffer (pBuf), which must therefore hold
+ * SCAN_DATA_BLOB_SIZE bytes even if the blob has packed ADC data. Data
+ * written as #PACKED_SCANDATA_VERSION is returned as #CUR_SCANDATA_VERSION.
  *
  * @param[in]   pBuf        Pointer to serialized scan data blob; where output
  *							deserialized data is also returned.
@@ -545,10 +671,13 @@ DLPSPEC_ERR_CODE dlpspec_scan_read_data(void *pBuf, const size_t bufSize)
 	void *pHeadBuf;
 	void *pSectBuf;
 	void *pADCdataBuf;
+	void *pPackedBuf;
 	size_t size_data_head;
 	size_t size_cfg_head;
 	size_t size_sect;
 	size_t size_adc_data;
+	size_t size_packed;
+	uint16_t num_samples;
 	uScanData *pData = (uScanData *)pBuf;
     
     if (pBuf == NULL)
@@ -572,6 +701,8 @@ DLPSPEC_ERR_CODE dlpspec_scan_read_data(void *pBuf, const size_t bufSize)
 		}
 
 		ret_val = dlpspec_deserialize(pBuf, size_data_head,	SLEW_DATA_HEAD_TYPE);
+		if(ret_val != DLPSPEC_PASS)
+			return ret_val;
 		
 		pHeadBuf = (void *)((uintptr_t)pBuf + size_data_head);
 		ret_val = dlpspec_deserialize(pHeadBuf, size_cfg_head, SLEW_CFG_HEAD_TYPE);
@@ -588,9 +719,32 @@ DLPSPEC_ERR_CODE dlpspec_scan_read_data(void *pBuf, const size_t bufSize)
 				sizeof(slewScanSection)*SLEW_SCAN_MAX_SECTIONS);
 
 		pADCdataBuf = (void *)((uintptr_t)pSectBuf + size_sect);
-		ret_val = dlpspec_deserialize(pADCdataBuf, size_adc_data, 
-				SLEW_DATA_ADC_TYPE);
-		memcpy(pData->slew_data.adc_data, pADCdataBuf, sizeof(uint32_t)*ADC_DATA_LEN);
+		if(pData->slew_data.header_version == PACKED_SCANDATA_VERSION)
+		{
+			if(!dlpspec_adc_is_packed(pADCdataBuf, size_adc_data))
+				return (ERR_DLPSPEC_INVALID_INPUT);
+			/* The samples are restored over the packed stream, so unpack
+			 * from a copy */
+			ret_val = dlpspec_adc_get_packed_size(pADCdataBuf, size_adc_data,
+					&size_packed);
+			if(ret_val != DLPSPEC_PASS)
+				return ret_val;
+			pPackedBuf = malloc(size_packed);
+			if(pPackedBuf == NULL)
+				return (ERR_DLPSPEC_INSUFFICIENT_MEM);
+			memcpy(pPackedBuf, pADCdataBuf, size_packed);
+			memset(pData->slew_data.adc_data, 0, sizeof(int32_t)*ADC_DATA_LEN);
+			ret_val = dlpspec_adc_unpack(pPackedBuf, size_packed,
+					pData->slew_data.adc_data, ADC_DATA_LEN, &num_samples);
+			free(pPackedBuf);
+			pData->slew_data.header_version = CUR_SCANDATA_VERSION;
+		}
+		else
+		{
+			ret_val = dlpspec_deserialize(pADCdataBuf, size_adc_data, 
+					SLEW_DATA_ADC_TYPE);
+			memcpy(pData->slew_data.adc_data, pADCdataBuf, sizeof(uint32_t)*ADC_DATA_LEN);
+		}
 		
 	}
 
@@ -646,7 +800,8 @@ DLPSPEC_ERR_CODE dlpspec_scan_interpret(const void *pBuf, const size_t bufSize,
  * Function to interpret a serialized scan data blob into a results struct
  *
  * @param[in]   pBuf        Pointer to serialized scan data blob
- * @param[in]   bufSize     buffer size, in bytes
+ * @param[in]   bufSize     buffer size, in bytes; may be just the length of
+ *							a blob with packed ADC data
  * @param[out]  pResults    Pointer to scanResults struct
  *
  * @return      Error code
@@ -660,14 +815,17 @@ DLPSPEC_ERR_CODE dlpspec_scan_interpret(const void *pBuf, const size_t bufSize,
     if ((pBuf == NULL) || (pResults == NULL))
         return (ERR_DLPSPEC_NULL_POINTER);
 
-    void *pCopyBuff = (void *)malloc(bufSize);
+    // Deserialization is in place and needs room for the whole struct
+    size_t copySize = (bufSize < SCAN_DATA_BLOB_SIZE) ? SCAN_DATA_BLOB_SIZE : bufSize;
+    void *pCopyBuff = (void *)malloc(copySize);
 
     if(pCopyBuff == NULL)
         return (ERR_DLPSPEC_INSUFFICIENT_MEM);
 
     memcpy(pCopyBuff, pBuf, bufSize);
+    memset((void *)((uintptr_t)pCopyBuff + bufSize), 0, copySize - bufSize);
 
-    ret_val = dlpspec_scan_read_data(pCopyBuff, bufSize);
+    ret_val = dlpspec_scan_read_data(pCopyBuff, copySize);
     if(ret_val < 0)
     {
         goto cleanup_and_exit;
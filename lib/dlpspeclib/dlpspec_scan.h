@@ -29,6 +29,14 @@
 /** Version number for future compatibility if changes are required */
 #define CUR_SCANDATA_VERSION 1
 
+/**
+ * Version number of serialized slew scan data whose ADC data is packed by
+ * dlpspec_scan_write_data_encoded(). Readers older than 2.0.4 reject it
+ * rather than misreading the packed stream as samples;
+ * dlpspec_scan_read_data() returns such data as #CUR_SCANDATA_VERSION.
+ */
+#define PACKED_SCANDATA_VERSION 2
+
 /** Maximum number of sections allowed in a slew scan definition/config */
 #define SLEW_SCAN_MAX_SECTIONS 5
 
@@ -233,6 +241,13 @@ typedef union
 #define SCAN_DATA_BLOB_SIZE (sizeof(uScanData)+150)
 #define OLD_SCAN_DATA_BLOB_SIZE (sizeof(scanData)+100)
 
+/** How dlpspec_scan_write_data_encoded() stores the ADC samples of a slew scan */
+typedef enum
+{
+    ADC_DATA_ENCODING_RAW   = 0, /**< TPL array, same as dlpspec_scan_write_data() */
+    ADC_DATA_ENCODING_RICE  = 1, /**< Losslessly packed by dlpspec_adc_pack(); falls back to RAW when that is not smaller */
+}ADC_DATA_ENCODING;
+
 /// @}
 
 /**
@@ -266,6 +281,9 @@ DLPSPEC_ERR_CODE dlpspec_scan_interpret(const void *pBuf, const size_t bufSize,
 	   	scanResults *pResults);
 DLPSPEC_ERR_CODE dlpspec_scan_write_data(const uScanData *pData, void *pBuf, 
 		const size_t bufSize);
+DLPSPEC_ERR_CODE dlpspec_scan_write_data_encoded(const uScanData *pData,
+		void *pBuf, const size_t bufSize, const ADC_DATA_ENCODING encoding,
+		size_t *pSize);
 DLPSPEC_ERR_CODE dlpspec_scan_read_data(void *pBuf, const size_t bufSize);
 DLPSPEC_ERR_CODE dlpspec_scan_interpReference(const void *pRefCal, 
 		size_t calSize, const void *pMatrix, size_t matrixSize, 
@@ -87,6 +87,55 @@ DLPSPEC_ERR_CODE dlpspec_util_columnToNm(const double column,  const double *coe
 	return (DLPSPEC_PASS);
 }
 
+DLPSPEC_ERR_CODE dlpspec_util_nmToHalfColumn(const double nm, const double *coeffs, int32_t *halfColumn)
+/**
+ * Function to find the DMD column centre, in half columns, that a computed
+ * wavelength came from. Interpreted wavelengths are dlpspec_util_columnToNm()
+ * of a whole or half column, so the column is recovered from the wavelength
+ * and coefficients alone and gives the same wavelength back.
+ *
+ * @param[in]   nm          wavelength in nm
+ * @param[in]   coeffs      Coefficient from wavelength calibration
+ * @param[out]  halfColumn  twice the DMD column
+ *
+ * @return      Error code; ERR_DLPSPEC_INVALID_INPUT if the wavelength is
+ *              not within HALF_COLUMN_NM_TOLERANCE of the nearest half column
+ *
+ */
+{
+	double column;
+	double slope;
+	double check;
+	int i;
+
+	if ((coeffs == NULL) || (halfColumn == NULL))
+		return ERR_DLPSPEC_NULL_POINTER;
+
+	if (0 == coeffs[1])
+		return ERR_DLPSPEC_INVALID_INPUT;
+
+	//Newton iterations from the linear estimate pick the root on the DMD
+	column = (nm - coeffs[0]) / coeffs[1];
+	for (i = 0; i < 4; i++)
+	{
+		slope = 2.0 * coeffs[2] * column + coeffs[1];
+		if (0 == slope)
+			return ERR_DLPSPEC_INVALID_INPUT;
+		column -= (coeffs[2] * column * column + coeffs[1] * column + coeffs[0] - nm) / slope;
+	}
+
+	if (fabs(column) > (MAX_DMD_COLUMN + 1) * 2)
+		return ERR_DLPSPEC_INVALID_INPUT;
+
+	*(halfColumn) = (int32_t)floor(2.0 * column + 0.5);
+
+	dlpspec_util_columnToNm(*(halfColumn) / 2.0, coeffs, &check);
+	if (fabs(check - nm) > HALF_COLUMN_NM_TOLERANCE)
+		return ERR_DLPSPEC_INVALID_INPUT;
+
+	return (DLPSPEC_PASS);
+}
+
 DLPSPEC_ERR_CODE dlpspec_util_columnToNmDistance(const double column_distance,  const double *coeffs, double *nm)
 /**
  * Function to output wavelength distance in nm at the center of the DMD given a DMD 
@@ -22,6 +22,12 @@
  * @{
  */
 
+/**
+ * Largest difference in nm allowed between a wavelength and the one computed
+ * back from the half column found by dlpspec_util_nmToHalfColumn()
+ */
+#define HALF_COLUMN_NM_TOLERANCE	0.001
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,6 +35,7 @@ extern "C" {
 DLPSPEC_ERR_CODE dlpspec_util_nmToColumn(const double nm, const double *coeffs, double *column);
 DLPSPEC_ERR_CODE dlpspec_util_columnToNm(const double column,  const double *coeffs, double *nm);
 DLPSPEC_ERR_CODE dlpspec_util_columnToNmDistance(const double column_distance, const double *coeffs, double *nm);
+DLPSPEC_ERR_CODE dlpspec_util_nmToHalfColumn(const double nm, const double *coeffs, int32_t *halfColumn);
 
 #ifdef __cplusplus      /* matches __cplusplus construct above */
 }
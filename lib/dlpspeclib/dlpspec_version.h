@@ -14,7 +14,7 @@
 // Version format: MAJOR.MINOR.BUILD
 #define DLPSPEC_VERSION_MAJOR 2
 #define DLPSPEC_VERSION_MINOR 0
-#define DLPSPEC_VERSION_BUILD 3
+#define DLPSPEC_VERSION_BUILD 5
 
 // Data format versions
 #define DLPSPEC_CALIB_VER 1
@@ -36,6 +36,13 @@ The following Library functions are not re-entrant:-
 VERSION HISTORY:
 ----------------------------------------------------------------------
 
+* 2.0.5 - Packed interpreted spectra: dlpspec_spectrum_pack(), dlpspec_spectrum_unpack()
+        - Wavelengths are sent as DMD half columns on the calibration polynomial,
+        - intensities exactly or rounded to int16
+* 2.0.4 - Lossless packing of slew scan ADC data: dlpspec_scan_write_data_encoded()
+        - Packed scan data is written as header version 2 (PACKED_SCANDATA_VERSION),
+        - which earlier versions reject
+        - dlpspec_get_scan_data_dump_size() returned the non-slew size for slew scans
 * 2.0.3 - Interpolation function added: dlpspec_interpolate_double_positions()
         - Corrected issue with truncation of pointer arithmetic in 64-bit systems
 * 2.0.2 - DLL build script added
@@ -0,0 +1,387 @@
+/*
+ *
+ * Deferred binary logging. BinLog_Write() claims room in the ring with an
+ * exclusive load/store pair instead of masking interrupts, fills in the
+ * format address, timestamp and arguments and publishes the record by
+ * writing its header word last. A %s argument outside the image is copied
+ * into the record, since the string may be gone by the time it is read.
+ * Nothing is formatted on the device: the drain task reads complete records
+ * out in order and sends them to the log port, and the host renders them
+ * using the format strings in the image.
+ *
+ * Building with NIRSCAN_HOST_BUILD defined replaces the DWT cycle counter and
+ * the exclusive accesses with host equivalents and leaves out the drain task,
+ * so the ring can be exercised in a simulation. There is no image on the
+ * host, so every %s argument is copied.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#ifdef NIRSCAN_HOST_BUILD
+#include <time.h>
+#else
+#include <inc/hw_types.h>
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <ti/sysbios/knl/Task.h>
+#include "common.h"
+#endif
+#include "binLog.h"
+
+#ifdef NIRSCAN_HOST_BUILD
+#define BIN_LOG_CYCLES()			((uint32_t)clock())
+#define BIN_LOG_IN_IMAGE(addr)		false
+#else
+/* Core cycle counter; main() starts it at boot and nothing resets it, as
+ * scanTrace.c timestamps from it too */
+#define DWT_CYCCNT					0xE0001004
+
+#define BIN_LOG_CYCLES()			HWREG(DWT_CYCCNT)
+
+/* Constants of the image are in the 1 MB of flash at address 0 */
+#define BIN_LOG_FLASH_END			0x00100000
+#define BIN_LOG_IN_IMAGE(addr)		((addr) < BIN_LOG_FLASH_END)
+#endif
+
+#define BIN_LOG_RING_MASK			(BIN_LOG_RING_WORDS - 1)
+
+/* Words a record takes in the ring ahead of its arguments: header, format
+ * and timestamp */
+#define BIN_LOG_RING_HEADER_WORDS	3
+
+/* Header word of a published record. Words are cleared as they are read,
+ * so a slot that has been claimed but not yet published reads as 0 */
+#define BIN_LOG_HDR_VALID			0xB1000000
+#define BIN_LOG_HDR_VALID_MASK		0xFF000000
+#define BIN_LOG_HDR_NUM_ARGS(hdr)	((hdr) & 0xFF)
+#define BIN_LOG_HDR_STR_WORDS(hdr)	(((hdr) >> 8) & 0xFF)
+
+static volatile uint32_t logRing[BIN_LOG_RING_WORDS];
+static volatile uint32_t logWriteIdx = 0;	// words claimed, free running
+static volatile uint32_t logReadIdx = 0;	// words read out, free running
+static volatile uint32_t logDropped = 0;	// log calls dropped, free running
+static uint32_t logDroppedSent = 0;			// drops already reported
+static uint16_t logSeq = 0;					// records read out
+
+#ifdef NIRSCAN_HOST_BUILD
+static bool BinLog_Claim(uint32_t numWords, uint32_t *pIdx)
+{
+	uint32_t idx;
+
+	do
+	{
+		idx = logWriteIdx;
+		if(idx + numWords - logReadIdx > BIN_LOG_RING_WORDS)
+			return false;
+	} while(!__sync_bool_compare_and_swap(&logWriteIdx, idx, idx + numWords));
+
+	*pIdx = idx;
+	return true;
+}
+
+static void BinLog_CountDrop(void)
+{
+	__sync_fetch_and_add(&logDropped, 1);
+}
+#else
+/*
+ * An interrupt between the exclusive load and store clears the exclusive
+ * monitor, so the store fails and the claim is retried with the index the
+ * interrupt left behind
+ */
+static bool BinLog_Claim(uint32_t numWords, uint32_t *pIdx)
+{
+	uint32_t idx;
+
+	do
+	{
+		idx = (uint32_t)__ldrex((void *)&logWriteIdx);
+		if(idx + numWords - logReadIdx > BIN_LOG_RING_WORDS)
+			return false;
+	} while(__strex(idx + numWords, (void *)&logWriteIdx) != 0);
+
+	*pIdx = idx;
+	return true;
+}
+
+static void BinLog_CountDrop(void)
+{
+	uint32_t dropped;
+
+	do
+	{
+		dropped = (uint32_t)__ldrex((void *)&logDropped);
+	} while(__strex(dropped + 1, (void *)&logDropped) != 0);
+}
+#endif
+
+static void BinLog_PutWord(uint8_t *pBuf, uint32_t val)
+{
+	pBuf[0] = val & 0xFF;
+	pBuf[1] = (val >> 8) & 0xFF;
+	pBuf[2] = (val >> 16) & 0xFF;
+	pBuf[3] = (val >> 24) & 0xFF;
+}
+
+/* numWords: string words in bits 15:8, arguments in bits 7:0 */
+static uint32_t BinLog_PutHeader(uint8_t *pBuf, uint32_t numWords, uint32_t fmt, uint32_t cycles)
+{
+	BinLog_PutWord(&pBuf[0], BIN_LOG_SYNC);
+	BinLog_PutWord(&pBuf[4], ((uint32_t)logSeq++ << 16) | numWords);
+	BinLog_PutWord(&pBuf[8], fmt);
+	BinLog_PutWord(&pBuf[12], cycles);
+
+	return BIN_LOG_RECORD_HEADER_SIZE;
+}
+
+/* Bit per argument that is a %s string to copy into the record */
+static uint32_t BinLog_StringArgs(const char *pFmt, const uint32_t *pArgs, uint32_t numArgs)
+{
+	uint32_t mask = 0;
+	uint32_t arg;
+
+	/* Most log calls pass small numbers and constants only; their format
+	 * need not be looked at */
+	for(arg = 0; arg < numArgs; arg++)
+	{
+		if(!BIN_LOG_IN_IMAGE(pArgs[arg]))
+			break;
+	}
+	if(arg == numArgs)
+		return 0;
+
+	/* Conversions as binlog_decode.py takes them */
+	arg = 0;
+	while((*pFmt != '\0') && (arg < numArgs))
+	{
+		if(*pFmt++ != '%')
+			continue;
+		while((*pFmt != '\0') && (strchr("-+ #.0123456789lh", *pFmt) != NULL))
+			pFmt++;
+		if(*pFmt == '\0')
+			break;
+		if((*pFmt == 's') && (pArgs[arg] != 0) && !BIN_LOG_IN_IMAGE(pArgs[arg]))
+			mask |= 1 << arg;
+		if(*pFmt++ != '%')
+			arg++;
+	}
+
+	return mask;
+}
+
+/* Bytes the copy of a string takes, with its terminating 0 */
+static uint32_t BinLog_StringSize(uint32_t addr)
+{
+	const char *pStr = (const char *)(uintptr_t)addr;
+	uint32_t length = 0;
+
+	while((length < BIN_LOG_MAX_STR_LEN - 1) && (pStr[length] != '\0'))
+		length++;
+
+	return length + 1;
+}
+
+/* Copies a string into the ring a word at a time; the last byte stays 0
+ * even if the string has changed since it was measured */
+static void BinLog_PutString(uint32_t idx, uint32_t addr, uint32_t size)
+{
+	const char *pStr = (const char *)(uintptr_t)addr;
+	uint32_t word;
+	uint32_t i;
+	uint32_t j;
+
+	for(i = 0; i < size; i += 4)
+	{
+		word = 0;
+		for(j = 0; (j < 4) && (i + j < size - 1); j++)
+			word |= (uint32_t)(uint8_t)pStr[i + j] << (8 * j);
+		logRing[idx++ & BIN_LOG_RING_MASK] = word;
+	}
+}
+
+void BinLog_Write(const char *pFmt, uint32_t numArgs, ...)
+	/**
+	 * Logs a message without formatting it. Safe to call from any task or
+	 * interrupt; use through BIN_LOG() so the arguments are passed as words.
+	 *
+	 * @param pFmt    - I - printf style format string, a constant in the image
+	 * @param numArgs - I - number of 32-bit arguments that follow
+	 *
+	 * @return none
+	 */
+{
+	va_list vaArgP;
+	uint32_t args[BIN_LOG_MAX_ARGS];
+	uint32_t strSize[BIN_LOG_MAX_ARGS];
+	uint32_t strMask;
+	uint32_t strBytes = 0;
+	uint32_t idx;
+	uint32_t i;
+
+	if(numArgs > BIN_LOG_MAX_ARGS)
+		numArgs = BIN_LOG_MAX_ARGS;
+
+	va_start(vaArgP, numArgs);
+	for(i = 0; i < numArgs; i++)
+		args[i] = va_arg(vaArgP, uint32_t);
+	va_end(vaArgP);
+
+	strMask = BinLog_StringArgs(pFmt, args, numArgs);
+	for(i = 0; i < numArgs; i++)
+	{
+		if(strMask & (1 << i))
+		{
+			strSize[i] = BinLog_StringSize(args[i]);
+			strBytes += (strSize[i] + 3) & ~3;
+		}
+	}
+
+	if(!BinLog_Claim(BIN_LOG_RING_HEADER_WORDS + numArgs + strBytes / 4, &idx))
+	{
+		BinLog_CountDrop();
+		return;
+	}
+
+	logRing[(idx + 1) & BIN_LOG_RING_MASK] = (uint32_t)(uintptr_t)pFmt;
+	logRing[(idx + 2) & BIN_LOG_RING_MASK] = BIN_LOG_CYCLES();
+
+	strBytes = 0;
+	for(i = 0; i < numArgs; i++)
+	{
+		if(strMask & (1 << i))
+		{
+			BinLog_PutString(idx + BIN_LOG_RING_HEADER_WORDS + numArgs + strBytes / 4,
+					args[i], strSize[i]);
+			args[i] = BIN_LOG_STR_INLINE | strBytes;
+			strBytes += (strSize[i] + 3) & ~3;
+		}
+		logRing[(idx + BIN_LOG_RING_HEADER_WORDS + i) & BIN_LOG_RING_MASK] = args[i];
+	}
+
+	logRing[idx & BIN_LOG_RING_MASK] = BIN_LOG_HDR_VALID | ((strBytes / 4) << 8) | numArgs;
+}
+
+uint32_t BinLog_Read(uint8_t *pBuf, uint32_t max_size)
+	/**
+	 * Moves published records out of the ring, oldest first, in the format
+	 * described in binLog.h. Stops at a record that is still being written.
+	 * If log calls were dropped since the last read, a record saying how
+	 * many follows the records read. Must only be called from one task.
+	 *
+	 * @param pBuf     - O - destination
+	 * @param max_size - I - size of pBuf in bytes
+	 *
+	 * @return number of bytes written to pBuf
+	 */
+{
+	uint32_t size = 0;
+	uint32_t idx = logReadIdx;
+	uint32_t hdr;
+	uint32_t numArgs;
+	uint32_t numWords;
+	uint32_t dropped;
+	uint32_t i;
+
+	while(idx != logWriteIdx)
+	{
+		hdr = logRing[idx & BIN_LOG_RING_MASK];
+		if((hdr & BIN_LOG_HDR_VALID_MASK) != BIN_LOG_HDR_VALID)
+			break;
+
+		numArgs = BIN_LOG_HDR_NUM_ARGS(hdr);
+		numWords = numArgs + BIN_LOG_HDR_STR_WORDS(hdr);
+		if(size + BIN_LOG_RECORD_HEADER_SIZE + 4 * numWords > max_size)
+			break;
+
+		size += BinLog_PutHeader(&pBuf[size], hdr & 0xFFFF,
+				logRing[(idx + 1) & BIN_LOG_RING_MASK],
+				logRing[(idx + 2) & BIN_LOG_RING_MASK]);
+		for(i = 0; i < numWords; i++)
+		{
+			BinLog_PutWord(&pBuf[size], logRing[(idx + BIN_LOG_RING_HEADER_WORDS + i) & BIN_LOG_RING_MASK]);
+			size += 4;
+		}
+
+		/* Clear the words before handing them back to the writers */
+		for(i = 0; i < BIN_LOG_RING_HEADER_WORDS + numWords; i++)
+			logRing[(idx + i) & BIN_LOG_RING_MASK] = 0;
+		idx += BIN_LOG_RING_HEADER_WORDS + numWords;
+		logReadIdx = idx;
+	}
+
+	dropped = logDropped;
+	if((dropped != logDroppedSent) && (size + BIN_LOG_RECORD_HEADER_SIZE + 4 <= max_size))
+	{
+		size += BinLog_PutHeader(&pBuf[size], 1, 0, BIN_LOG_CYCLES());
+		BinLog_PutWord(&pBuf[size], dropped - logDroppedSent);
+		size += 4;
+		logDroppedSent = dropped;
+	}
+
+	return size;
+}
+
+#ifndef NIRSCAN_HOST_BUILD
+static void BinLog_Output(const uint8_t *pBuf, uint32_t size)
+{
+#if (LOG_PORT == UART_CONSOLE) && !defined(ENABLE_UART_COMMAND_INTERFACE)
+	uint32_t sent;
+
+	/* Buffered UARTwrite() sends the bytes as they are and drops what does
+	 * not fit, so hand them over as room frees up */
+	while(size > 0)
+	{
+		sent = UARTwrite((const char *)pBuf, size);
+		pBuf += sent;
+		size -= sent;
+		if(size > 0)
+			Task_sleep(1);
+	}
+#else
+	/* The CCS console only takes text: one line of hex words per record,
+	 * the sync word replaced by the NLOG tag */
+	uint32_t numWords;
+	uint32_t i;
+
+	while(size >= BIN_LOG_RECORD_HEADER_SIZE)
+	{
+		numWords = (BIN_LOG_RECORD_HEADER_SIZE / 4) + pBuf[4] + pBuf[5];
+		System_printf("NLOG");
+		for(i = 1; i < numWords; i++)
+			System_printf(" %x", pBuf[4 * i] | (pBuf[4 * i + 1] << 8) |
+					(pBuf[4 * i + 2] << 16) | ((uint32_t)pBuf[4 * i + 3] << 24));
+		System_printf("\n");
+		pBuf += 4 * numWords;
+		size -= 4 * numWords;
+	}
+	System_flush();
+#endif
+}
+
+void BinLog_Task(void)
+	/**
+	 * Drains the ring to the log port every BIN_LOG_DRAIN_PERIOD_TICKS. Runs
+	 * at the lowest task priority, so a log call interrupted between claiming
+	 * and publishing its record has always finished by the time it is read.
+	 *
+	 * @return none
+	 */
+{
+	static uint8_t drainBuf[512];
+	uint32_t size;
+
+	while(1)
+	{
+		while((size = BinLog_Read(drainBuf, sizeof(drainBuf))) > 0)
+			BinLog_Output(drainBuf, size);
+
+		Task_sleep(BIN_LOG_DRAIN_PERIOD_TICKS);
+	}
+}
+#endif
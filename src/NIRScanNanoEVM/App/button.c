@@ -130,6 +130,13 @@ void HandleScanButtonInterrupt()
 	#else
 			if (num_ticks != 0);
 	#endif
+			if (Scan_IsContinuousMode())
+			{	// a short press ends a continuous scan run instead of adding a scan
+				Scan_StopContinuousMode();
+				UnlockScanButton();
+			}
+			else
+			{
 				Scan_StoreToSDcard();
 				Semaphore_post( scanSem );    // To initiate scan
 	#ifdef NIRSCAN_INCLUDE_BLE
@@ -143,6 +150,9 @@ void HandleScanButtonInterrupt()
 					if (0 == bleNotificationHandler_setNotificationData(BLE_NOTIFY_SCAN_STATUS, 5, &notification[0]))
 						Semaphore_post(BLENotifySem);
 				}
+	#endif
+			}
+	#ifdef NIRSCAN_INCLUDE_BLE
 			}
 	#endif
 		}
@@ -92,6 +92,23 @@ const CMD_DICT_ENTRY refDictArray[] =
     { NNO_CMD_SCAN_INTERPRET_GET_STATUS, cmdScanInterpretStatus_rd   }, /* 0x023A */
     { NNO_CMD_MODEL_NAME_WRITE,         cmdSaveModelName_wr         }, /* 0x023B */
     { NNO_CMD_MODEL_NAME_READ,          cmdGetModelName_rd          }, /* 0x023C */
+    { NNO_CMD_SCAN_STREAM_ENABLE,       cmdScanStreamEnable_wr      }, /* 0x023D */
+    { NNO_CMD_SCAN_STREAM_READ,         cmdScanStreamRead_rd        }, /* 0x023E */
+    { NNO_CMD_SCAN_CONTINUOUS_START,    cmdScanContinuousStart_wr   }, /* 0x023F */
+    { NNO_CMD_SCAN_CONTINUOUS_STOP,     cmdScanContinuousStop_wr    }, /* 0x0240 */
+    { NNO_CMD_READ_PGA_STATS,           cmdReadPGAStats_rd          }, /* 0x0241 */
+    { NNO_CMD_SCAN_TRACE_CTRL,          cmdScanTraceCtrl_wr         }, /* 0x0242 */
+    { NNO_CMD_SNR_SET_WINDOW,           cmdSNRSetWindow_wr          }, /* 0x0243 */
+    { NNO_CMD_SENSOR_SVC_PERIODS,       cmdSensorSvcPeriods_wr      }, /* 0x0244 */
+    { NNO_CMD_SD_WRITER_STATS,          cmdSDWriterStats_rd         }, /* 0x0245 */
+    { NNO_CMD_SD_ARCHIVE_CTRL,          cmdSDArchiveCtrl_wr         }, /* 0x0246 */
+    { NNO_CMD_SD_SCAN_QUERY,            cmdSDScanQuery_rd           }, /* 0x0247 */
+    { NNO_CMD_FILE_STREAM_DATA,         cmdFileStream_rd            }, /* 0x0248 */
+    { NNO_CMD_USB_BULK_STATUS,          cmdUsbBulkStatus_rd         }, /* 0x0249 */
+    { NNO_CMD_FILE_BULK_READ,           cmdFileBulkRead_rd          }, /* 0x024A */
+    { NNO_CMD_FILE_BULK_WRITE,          cmdFileBulkWrite_wr         }, /* 0x024B */
+    { NNO_CMD_USB_BULK_ABORT,           cmdUsbBulkAbort_wr          }, /* 0x024C */
+    { NNO_CMD_USB_CMD_QUEUE_STATS,      cmdUsbCmdQueueStats_rd      }, /* 0x024D */
     { NNO_CMD_READ_TEMP, 				cmdTemp_rd	         		}, /* 0x0301 */
     { NNO_CMD_READ_HUM, 				cmdHum_rd	         		}, /* 0x0302 */
     { NNO_CMD_SET_DATE_TIME, 			cmdSetDateTime_wr         	}, /* 0x0309 */
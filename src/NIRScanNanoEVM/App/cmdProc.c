@@ -13,6 +13,7 @@
 #include <xdc/runtime/Types.h>
 #include <ti/sysbios/knl/Swi.h>
 #include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/BIOS.h>
 #include <ti/drivers/I2C.h>
 #include <string.h>
@@ -46,6 +47,13 @@
 #include "flash.h"
 #include "sdram.h"
 #include "scan.h"
+#include "scanStream.h"
+#include "scanTrace.h"
+#include "sensorSvc.h"
+#include "sdWriter.h"
+#include "usbBulk.h"
+#include "usbCmdQueue.h"
+#include "interpretData.h"
 #include "adcWrapper.h"
 #include "bq24250.h"
 #include "sdram.h"
@@ -62,6 +70,7 @@
 #include "dlpspec_helper.h"
 #include "dlpspec_scan.h"
 #include "dlpspec_calib.h"
+#include "dlpspec_compress.h"
 #include "dlpspec_version.h"
 #include "refCalMatrix.h"
 #include "led.h"
@@ -80,6 +89,11 @@
 #include "testimages.h"
 #endif
 
+/* How long a BLE spectrum request waits for the scan to be interpreted, in
+ * system ticks of 1 ms */
+#define SCAN_SPECTRUM_WAIT_TICKS	3000
+#define SCAN_SPECTRUM_POLL_TICKS	10
+
 extern uint8_t		g_TestOnOffButtonPresses;			// Number of consecutive button presses
 extern uint8_t		g_TestScanButtonPresses;
 extern uint8_t		g_ButtonTestMode;				// Button Test Mode
@@ -101,6 +115,21 @@ static uint32_t dlpc150_flash_ver = 0xFFFFFFFF;
 static uint8_t *pUsbDataPtr = NULL;
 static scanResults scan_results;
 static uint8_t tempBuffer[ADC_DATA_LEN * sizeof(float) + ADC_DATA_LEN * sizeof(int)];
+static uint8_t streamPktBuffer[NNO_DATA_MAX_SIZE];
+static INTERPRET_DATA_FILE interpretDataFile;
+static bool fileIsInterpretData = false;	// file is encoded from scan_results as it is read
+
+/* Packed spectrum of the scan last interpreted, sent to BLE clients that ask
+ * for BLE_SCAN_DATA_FIELD_SPECTRUM. A spectrum that does not pack smaller
+ * than the scan data blob is not kept; the client reads the blob instead. */
+static uint8_t scanSpectrum[SCAN_DATA_BLOB_SIZE];
+static int32_t scanSpectrumWork[ADC_DATA_LEN];
+static uint32_t scanSpectrumSize = 0;
+static uint32_t scanSpectrumIndex = 0;
+static volatile uint32_t scanInterpretSDIndex = 0;
+static volatile bool scanInterpretFromSD = false;
+
+static int cmdPrepareScanSpectrum(uint32_t scanDataIndex);
 
 
 
@@ -194,6 +223,9 @@ bool cmdFileSz_wr( void )						 /* 0x002A */
 
 	else if(fileAction >= NNO_FILE_PTN_LOAD_SDRAM)
 	{
+		if ((fileAction - NNO_FILE_PTN_LOAD_SDRAM) >= NUM_FRAMEBUFFERS)
+			return false;
+		Display_InvalidatePatternCache();
 		pSDRAMFrameData = (int8_t *)(SDRAM_START_ADDRESS + (fileAction-NNO_FILE_PTN_LOAD_SDRAM)*(DISP_WIDTH * DISP_HEIGHT * 3));
 	}
 
@@ -221,6 +253,7 @@ bool cmdFileListSz_rd()
 	if(num_records==0)
 	    return false;
 
+	SDWriter_Flush();
 	SDstatus = FATSD_FindListScanIndex(&scanDataIndexArrayLength);
 	if( ( SDstatus != PASS) && (SDstatus != SDCARD_ERROR_NOT_READY) )
 		return false;
@@ -301,6 +334,7 @@ bool cmdFileList_rd()
 		return false;
 
 
+	SDWriter_Flush();
 	SDstatus = FATSD_FindListScanIndex(&scanDataIndexArrayLength);
 	if( ( SDstatus != PASS) && (SDstatus != SDCARD_ERROR_NOT_READY) )
 		return false;
@@ -362,10 +396,17 @@ bool cmdFileSz_rd(void)
 #ifdef NIRSCAN_INCLUDE_BLE
 	uint32_t scanDataIndex = 0;
 	uint8_t field_type = 0;
+	FRESULT fatresult;
 #endif
 	int result = PASS;
-	int i;
-	uint8_t *pBuffer;
+
+#ifdef NIRSCAN_USB_BULK
+	/* The previous file may still be going out on the bulk interface */
+	if (UsbBulk_IsBusy())
+		return false;
+#endif
+
+	fileIsInterpretData = false;
 
 	if (file_type == NNO_FILE_SCAN_DATA)
 	{
@@ -414,11 +455,20 @@ bool cmdFileSz_rd(void)
 			else if (field_type == BLE_SCAN_DATA_FIELD_BLOB)
 			{
 				if (scanDataIndex == GetScanDataPtr()->data.scanDataIndex)
-					result = dlpspec_scan_write_data(GetScanDataPtr(), g_dataBlob, SCAN_DATA_BLOB_SIZE);
-
-				if (result == PASS)
-					bytesToSend = SCAN_DATA_BLOB_SIZE;
+					result = Scan_SerializeData(g_dataBlob, SCAN_DATA_BLOB_SIZE, &bytesToSend);
 				else
+				{
+					/* Size as stored, which cmdFileData_rd() sends */
+					SDWriter_Flush();
+					fatresult = FATSD_GetScanFileSize(scanDataIndex, &bytesToSend);
+					if (fatresult != FR_OK)
+					{
+						bytesToSend = 0;
+						bleNotificationHandler_sendErrorIndication(NNO_ERROR_SD_CARD, fatresult);
+					}
+				}
+
+				if (result != PASS)
 				{
 					bytesToSend = 0;
 					bleNotificationHandler_sendErrorIndication(NNO_ERROR_SPEC_LIB, result);
@@ -427,19 +477,27 @@ bool cmdFileSz_rd(void)
 				gBLECmdHandlerRepsonse.subFileType = BLE_SCAN_DATA_FIELD_BLOB;
 				cmdPut(sizeof(unsigned int), &bytesToSend);
 			}
+			else if (field_type == BLE_SCAN_DATA_FIELD_SPECTRUM)
+			{
+				if (PASS == cmdPrepareScanSpectrum(scanDataIndex))
+					bytesToSend = scanSpectrumSize;
+				else
+				{
+					bytesToSend = 0;
+					bleNotificationHandler_sendErrorIndication(NNO_ERROR_SPEC_LIB, FAIL);
+				}
+
+				gBLECmdHandlerRepsonse.subFileType = BLE_SCAN_DATA_FIELD_SPECTRUM;
+				cmdPut(sizeof(unsigned int), &bytesToSend);
+			}
 		}
 		else
 		{
 #endif
 			bytesSent = 0;
-			result = dlpspec_scan_write_data(GetScanDataPtr(), g_dataBlob, SCAN_DATA_BLOB_SIZE);
-			if (PASS == result)
-				bytesToSend = SCAN_DATA_BLOB_SIZE;
-			else
-			{
-				bytesToSend = 0;
+			result = Scan_SerializeData(g_dataBlob, SCAN_DATA_BLOB_SIZE, &bytesToSend);
+			if (PASS != result)
 				nnoStatus_setErrorStatusAndCode(NNO_ERROR_SPEC_LIB, true, result);
-			}
 			cmdPut4(bytesToSend);
 			pUsbDataPtr = &g_dataBlob[0];
 #ifdef NIRSCAN_INCLUDE_BLE
@@ -539,6 +597,7 @@ bool cmdFileSz_rd(void)
 		{
 #endif
 			pUsbDataPtr = &g_dataBlob[0];
+			SDWriter_Flush();
 			if (FR_OK == FATSD_ReadLastStoredScanFile((void *)pUsbDataPtr, &bytesToSend))
 				cmdPut4(bytesToSend);
 			else
@@ -556,17 +615,32 @@ bool cmdFileSz_rd(void)
 	}
 	else if ( file_type == NNO_FILE_INTERPRET_DATA )
 	{
-		bytesToSend = sizeof(int) + scan_results.length * sizeof(double) + scan_results.length * sizeof(int);
+		uint8_t format;
+
+		/* Optional layout byte, see NNOCommandDefs.h */
+		if (!cmdGet(1, &format))
+			format = INTERPRET_DATA_INTERLEAVED;
+
+		if (!InterpretData_Open(&interpretDataFile, &scan_results, format))
+			return false;
+
+		bytesSent = 0;
+		bytesToSend = interpretDataFile.size;
+		cmdPut4( bytesToSend );
+		fileIsInterpretData = true;
+	}
+	else if ( file_type == NNO_FILE_SCAN_TRACE )
+	{
+		bytesSent = 0;
+		bytesToSend = ScanTrace_Snapshot(&tempBuffer[0], sizeof(tempBuffer));
+		cmdPut4( bytesToSend );
+		pUsbDataPtr = &tempBuffer[0];
+	}
+	else if ( file_type == NNO_FILE_SENSOR_LOG )
+	{
+		bytesSent = 0;
+		bytesToSend = SensorSvc_ReadLog(&tempBuffer[0], sizeof(tempBuffer));
 		cmdPut4( bytesToSend );
-		pBuffer = &tempBuffer[0];
-		*((int *)pBuffer) = (int) scan_results.length;
-		pBuffer += sizeof(int);
-		for ( i = 0; i < scan_results.length; i++ ) {
-			*((double *)pBuffer) = (double) scan_results.wavelength[i];
-			pBuffer += sizeof(double);
-			*((int *)pBuffer) = (int) scan_results.intensity[i];
-			pBuffer += sizeof(int);
-		}			
 		pUsbDataPtr = &tempBuffer[0];
 	}
 
@@ -575,17 +649,17 @@ bool cmdFileSz_rd(void)
 
 bool cmdFileData_rd(void)
 {
-	int i;
-	size_t max_data_size = 0;
+	size_t chunk = 0;
 
 #ifdef NIRSCAN_INCLUDE_BLE
+	int i;
 	uint32_t scanDataIndex = 0;
 	uint8_t field_type = 0;
 	int8_t file_type = 0;
 	scanData *scan_data = NULL;
 	uint8_t index = 0;
 	FRESULT fatresult = FR_OK;
-	unsigned short length=0;
+	uint32_t length=0;
 
 	if (isBLEConnActive())
 	{
@@ -621,8 +695,9 @@ bool cmdFileData_rd(void)
 
 			bool isCurrScan = (scanDataIndex == GetScanDataPtr()->data.scanDataIndex) ? true : false;
 
-			if (!isCurrScan)	//Read from SD card
+			if (!isCurrScan && (field_type != BLE_SCAN_DATA_FIELD_SPECTRUM))	//Read from SD card
 			{
+				SDWriter_Flush();
 				fatresult = FATSD_ReadScanFile(scanDataIndex, (void *) &g_dataBlob, &bytesToSend);
 				if (FR_OK != fatresult)
 				{
@@ -634,9 +709,11 @@ bool cmdFileData_rd(void)
 
 				if (field_type != BLE_SCAN_DATA_FIELD_BLOB)
 				{
-					dlpspec_deserialize((void *)g_dataBlob, SCAN_DATA_BLOB_SIZE, SCAN_DATA_TYPE);
+					dlpspec_scan_read_data((void *)g_dataBlob, SCAN_DATA_BLOB_SIZE);
 					scan_data = (scanData *)&g_dataBlob[0];
 				}
+				else
+					length = bytesToSend;
 			}
 			else
 				scan_data = (scanData *)GetScanDataPtr();
@@ -680,34 +757,42 @@ bool cmdFileData_rd(void)
 			{
 				if (isCurrScan)
 				{
-					i = dlpspec_scan_write_data(GetScanDataPtr(), g_dataBlob, SCAN_DATA_BLOB_SIZE);
+					i = Scan_SerializeData(g_dataBlob, SCAN_DATA_BLOB_SIZE, &length);
 					DEBUG_PRINT("\r\nScan data serialization done\r\n");
 
-					if (PASS == i)
-						length = SCAN_DATA_BLOB_SIZE;
-					else
-					{
+					if (PASS != i)
 						nnoStatus_setErrorStatusAndCode(NNO_ERROR_SPEC_LIB, true, i);
-						length = 0;
-					}
 				}
 
 				gBLECmdHandlerRepsonse.subFileType = BLE_SCAN_DATA_FIELD_BLOB;
 				if (length > 0)
 					cmdPut(length, &g_dataBlob[0]);
 			}
+			else if (field_type == BLE_SCAN_DATA_FIELD_SPECTRUM)
+			{
+				gBLECmdHandlerRepsonse.subFileType = BLE_SCAN_DATA_FIELD_SPECTRUM;
+				if ((scanSpectrumSize > 0) && (scanSpectrumIndex == scanDataIndex))
+					cmdPut(scanSpectrumSize, &scanSpectrum[0]);
+			}
 		}
 	}
 	else
 	{
 #endif
-		max_data_size = getMaxDataLimit();
+		chunk = MIN(getMaxDataLimit(), bytesToSend);
 
-		for(i=0; i<MIN(max_data_size, bytesToSend); i++)
-			cmdPut1(pUsbDataPtr[bytesSent+i]);
+		if (fileIsInterpretData)
+		{
+			chunk = InterpretData_Read(&interpretDataFile, bytesSent, &streamPktBuffer[0],
+					MIN(chunk, sizeof(streamPktBuffer)));
+			if ((chunk > 0) && !cmdPut(chunk, &streamPktBuffer[0]))
+				return false;
+		}
+		else if ((chunk > 0) && !cmdPut(chunk, &pUsbDataPtr[bytesSent]))
+			return false;
 
-		bytesSent += MIN(max_data_size, bytesToSend);
-		bytesToSend -= MIN(max_data_size, bytesToSend);
+		bytesSent += chunk;
+		bytesToSend -= chunk;
 #ifdef NIRSCAN_INCLUDE_BLE
 		}
 #endif
@@ -744,6 +829,7 @@ bool cmdTivaBootMode_wr(void)
 											   SYSCTL_CFG_VCO_480), NIRSCAN_SYSCLK);
 #endif
 
+	Nano_eeprom_FlushCounters();
 	MAP_USBDevDisconnect(USB0_BASE); //Disconnect application USB feature from the bus
 
 	//
@@ -961,6 +1047,8 @@ bool cmdSDTest_rd(void)
 {
 	int32_t test_result;
 
+	/* The test rewrites its files on the card; let queued scans go first */
+	SDWriter_Flush();
 	test_result = FATSD_Test();
 
 	cmdPut1((int8_t)test_result);
@@ -1057,6 +1145,7 @@ bool cmdEEPROMCal_wr(void)
 	calCoeffs.PixelToWavelengthCoeffs[1] = -0.874372;
 	calCoeffs.PixelToWavelengthCoeffs[2] = -0.000278;
 
+	Display_InvalidatePatternCache();
 	if (PASS == Nano_eeprom_SavecalibCoeffs(&calCoeffs))
 		return true;
 	else
@@ -1120,6 +1209,8 @@ bool cmdStorePatternInSDRAM_wr(void)
 	if (data_size > SDRAM_32MB)
 		return FALSE;
 
+	Display_InvalidatePatternCache();
+
 	// Store num frames transfered for scan command to use
 	Scan_SetNumPatternsToScan(data_size / (g_patternNumCols * g_patternNumRows * 3));
 
@@ -1149,7 +1240,7 @@ bool cmdStartScan_wr(void)
 #endif
 
 	// First check if there is an ongoing scan, if so dont allow a second one
-	if (nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS))
+	if (nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS) || Scan_IsContinuousMode())
 		return FALSE;
 
 	Scan_SetPatternSource(PATTERNS_FROM_RGB_PORT);
@@ -1173,6 +1264,52 @@ bool cmdStartScan_wr(void)
 	return TRUE;
 }
 
+bool cmdScanContinuousStart_wr(void)
+{
+	uint8_t storeScaninSDCard;
+	uint16_t num_scans;
+
+	if (nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS) || Scan_IsContinuousMode())
+		return FALSE;
+
+	storeScaninSDCard = cmdGet1(uint8_t);
+	num_scans = cmdGet2(uint16_t);
+
+	Scan_SetPatternSource(PATTERNS_FROM_RGB_PORT);
+	if (PASS != Scan_SetContinuousMode(num_scans, (storeScaninSDCard > 0) ? true : false))
+		return FALSE;
+
+	Semaphore_post( scanSem );
+	return TRUE;
+}
+
+bool cmdScanContinuousStop_wr(void)
+{
+	Scan_StopContinuousMode();
+	return TRUE;
+}
+
+bool cmdReadPGAStats_rd(void)
+{
+	PGAPredictStats stats;
+
+	Scan_GetPGAPredictStats(&stats);
+	cmdPut4(stats.num_predicted);
+	cmdPut4(stats.num_prescans);
+	cmdPut4(stats.num_saturated);
+	cmdPut4(stats.saved_ms);
+	return true;
+}
+
+bool cmdScanTraceCtrl_wr(void)
+{
+	uint32_t mask = cmdGet4(uint32_t);
+
+	ScanTrace_SetMask(mask);
+	ScanTrace_Clear();
+	return true;
+}
+
 bool cmdScanStatus_rd(void)
 {
 
@@ -1183,6 +1320,34 @@ bool cmdScanStatus_rd(void)
 	return true;
 }
 
+bool cmdScanStreamEnable_wr(void)
+{
+	uint8_t enable = cmdGet1(uint8_t);
+
+	ScanStream_Enable((enable > 0) ? true : false);
+	return true;
+}
+
+bool cmdScanStreamRead_rd(void)
+{
+	int length;
+	bool scan_done;
+
+#ifdef NIRSCAN_INCLUDE_BLE
+	/* The stream has one reader; a BLE client taking it as notifications has it */
+	if (bleNotificationHandler_isScanStreamOn())
+		return false;
+#endif
+	scan_done = !nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS);
+	length = ScanStream_ReadPacket(&streamPktBuffer[0],
+			MIN(getMaxDataLimit(), sizeof(streamPktBuffer)), scan_done);
+	if (length < 0)
+		return false;
+
+	cmdPut(length, &streamPktBuffer[0]);
+	return true;
+}
+
 bool cmdStartScanInterpret_wr(void)
 {
 
@@ -1193,12 +1358,49 @@ bool cmdStartScanInterpret_wr(void)
 		return FALSE;
 	}
 	
+	scanInterpretFromSD = false;
 	nnoStatus_setDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS, true);
 	Semaphore_post( scanInterpretSem );
 
 	return TRUE;
 }
 
+static int cmdPrepareScanSpectrum(uint32_t scanDataIndex)
+	/**
+	 * Makes sure scanSpectrum holds the packed spectrum of a scan. If it does
+	 * not, the InterpretScan task is asked to interpret the scan, from the SD
+	 * card unless it is the current one, and the caller waits for it.
+	 *
+	 * @param scanDataIndex - I - index of the scan
+	 *
+	 * @return PASS or FAIL
+	 */
+{
+	uint32_t waited = 0;
+
+	if ((scanSpectrumSize > 0) && (scanSpectrumIndex == scanDataIndex))
+		return PASS;
+
+	if ( nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS) ||
+		nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS) )
+		return FAIL;
+
+	scanInterpretSDIndex = scanDataIndex;
+	scanInterpretFromSD = (scanDataIndex != GetScanDataPtr()->data.scanDataIndex);
+	nnoStatus_setDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS, true);
+	Semaphore_post( scanInterpretSem );
+
+	while (nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS))
+	{
+		if (waited >= SCAN_SPECTRUM_WAIT_TICKS)
+			return FAIL;
+		Task_sleep(SCAN_SPECTRUM_POLL_TICKS);
+		waited += SCAN_SPECTRUM_POLL_TICKS;
+	}
+
+	return ((scanSpectrumSize > 0) && (scanSpectrumIndex == scanDataIndex)) ? PASS : FAIL;
+}
+
 bool cmdScanInterpretStatus_rd(void)
 {
 
@@ -1215,28 +1417,57 @@ void InterpretScan()
  * This is the scan interpret task function. The task waits for scanInterpretSem semaphore indefinitiely and
  * upon receving the semaphore interprets a previous scan. nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS) function shall be used
  * to query scan completion status.
+ *
+ * The interpreted spectrum is also packed for BLE clients, with intensities
+ * scaled to 16 bits. A scan stored on the SD card is interpreted instead of
+ * the current one when cmdPrepareScanSpectrum() asks for it.
  */
 {
 	int result = PASS;	
+	uint32_t fileSize;
+	size_t packedSize;
+	FRESULT fatresult;
 
 	while ( 1 )
 	{
 		Semaphore_pend(scanInterpretSem, BIOS_WAIT_FOREVER);
-		bytesSent = 0;
-		result = dlpspec_scan_write_data(GetScanDataPtr(), g_dataBlob, SCAN_DATA_BLOB_SIZE);
-		if ( PASS == result) 
-			bytesToSend = SCAN_DATA_BLOB_SIZE;
+		scanSpectrumSize = 0;
+		if (scanInterpretFromSD)
+		{
+			SDWriter_Flush();
+			fatresult = FATSD_ReadScanFile(scanInterpretSDIndex, (void *) &g_dataBlob, &fileSize);
+			if (FR_OK != fatresult)
+			{
+				nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fatresult);
+				nnoStatus_setDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS, false);
+				continue;
+			}
+		}
 		else
 		{
-			bytesToSend = 0;
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SPEC_LIB, true, result);
+			bytesSent = 0;
+			result = dlpspec_scan_write_data(GetScanDataPtr(), g_dataBlob, SCAN_DATA_BLOB_SIZE);
+			if ( PASS == result) 
+				bytesToSend = SCAN_DATA_BLOB_SIZE;
+			else
+			{
+				bytesToSend = 0;
+				nnoStatus_setErrorStatusAndCode(NNO_ERROR_SPEC_LIB, true, result);
+			}
 		}
 
-		if ( dlpspec_scan_interpret(g_dataBlob, SCAN_DATA_BLOB_SIZE, &scan_results)!= PASS )
+		result = dlpspec_scan_interpret(g_dataBlob, SCAN_DATA_BLOB_SIZE, &scan_results);
+		if ( result != PASS )
 		{
 			nnoStatus_setDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS, false);
 			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SPEC_LIB, true, result);
 		}
+		else if (PASS == dlpspec_spectrum_pack(&scan_results, SPEC_PACK_SHIFT_INT16,
+				scanSpectrumWork, scanSpectrum, sizeof(scanSpectrum), &packedSize))
+		{
+			scanSpectrumIndex = scan_results.scanDataIndex;
+			scanSpectrumSize = packedSize;
+		}
 
 		nnoStatus_setDeviceStatus(NNO_STATUS_SCAN_INTERPRET_IN_PROGRESS, false);
 	}
@@ -1245,6 +1476,7 @@ void InterpretScan()
 
 bool cmdTivaReset_wr(void)
 {
+	Nano_eeprom_FlushCounters();
 	SysCtlReset();
 	return true;
 }
@@ -1411,8 +1643,11 @@ bool cmdSaveCfg_wr(void)
 
 		if(Nano_eeprom_SaveConfigRecord(index, pCfg) >= 0)
 			return true;
-		else
-			return false;
+
+		/* Also when the EEPROM has no room for the new record next to
+		 * the old one, which is then kept */
+		nnoStatus_setErrorStatus(NNO_ERROR_EEPROM, true);
+		return false;
 	}
 	else
 		return false;
@@ -1631,6 +1866,7 @@ bool cmdEEPROM_wipe_wr(void)
 			EEPROMProgram(&clear_val, addr, 4);
 			addr += 4;
 		}
+		Nano_eeprom_ClearConfigDir();
 	}
 
 	return true;
@@ -1675,6 +1911,7 @@ bool cmdEEPROMcalibCoeffs_wr(void)
 	if (PASS == result)
 	{
 		pCfg = (calibCoeffs*)pBuf;
+		Display_InvalidatePatternCache();
 		if(Nano_eeprom_SavecalibCoeffs(pCfg) >= 0)
 			return true;
 		else
@@ -1811,6 +2048,262 @@ bool cmdHadSNRCompute_wr(void)
     return true;
 }
 
+bool cmdSNRSetWindow_wr(void)
+{
+	uint8_t index = cmdGet1(uint8_t);
+	uint16_t bin_size = cmdGet2(uint16_t);
+	uint16_t sample_step = cmdGet2(uint16_t);
+
+	if(Scan_SNRSetWindow(index, bin_size, sample_step) != PASS)
+		return false;
+
+	return true;
+}
+
+bool cmdSensorSvcPeriods_wr(void)
+{
+	uint16_t idle_period_ms = cmdGet2(uint16_t);
+	uint16_t scan_period_ms = cmdGet2(uint16_t);
+
+	if(SensorSvc_SetPeriods(idle_period_ms, scan_period_ms) != PASS)
+		return false;
+
+	return true;
+}
+
+bool cmdSDWriterStats_rd(void)
+{
+	SD_WRITER_STATS stats;
+
+	SDWriter_GetStats(&stats);
+	cmdPut4(stats.num_queued);
+	cmdPut4(stats.num_written);
+	cmdPut4(stats.num_failed);
+	cmdPut4(stats.num_stalls);
+	cmdPut4(stats.stall_ms_max);
+	cmdPut4(stats.depth);
+	cmdPut4(stats.depth_max);
+	cmdPut4(stats.write_ms_last);
+	cmdPut4(stats.write_ms_max);
+	cmdPut4(stats.latency_ms_last);
+	cmdPut4(stats.latency_ms_max);
+	return true;
+}
+
+bool cmdSDArchiveCtrl_wr(void)
+{
+	uint8_t op = cmdGet1(uint8_t);
+#ifdef NIRSCAN_SD_ARCHIVE
+	FRESULT fresult;
+	uint8_t *pBuf;
+	uint32_t size;
+
+	if((op != FATSD_ARCHIVE_COMPACT) && (op != FATSD_ARCHIVE_EXPORT))
+		return false;
+
+	/*
+	 * g_dataBlob may hold a file being read out or a scan being interpreted,
+	 * so the archive works in an SD writer slot instead
+	 */
+	pBuf = SDWriter_Reserve(&size);
+	if(op == FATSD_ARCHIVE_COMPACT)
+		fresult = FATSD_CompactArchive(pBuf, size);
+	else
+		fresult = FATSD_ExportArchive(pBuf, size);
+	SDWriter_Release();
+
+	return (fresult == FR_OK);
+#else
+	return false;
+#endif
+}
+
+bool cmdSDScanQuery_rd(void)
+{
+	uint32_t min_index = cmdGet4(uint32_t);
+	uint32_t min_timestamp = cmdGet4(uint32_t);
+	uint32_t cursor = cmdGet4(uint32_t);
+#ifdef NIRSCAN_SD_ARCHIVE
+	/* 8 byte header and 12 bytes per scan stay within one USB response */
+	SD_ARCHIVE_ENTRY entries[32];
+	uint32_t num;
+	uint32_t i;
+
+	SDWriter_Flush();
+	if(FATSD_QueryScans(min_index, min_timestamp, &cursor, entries,
+			sizeof(entries) / sizeof(entries[0]), &num) != FR_OK)
+		return false;
+
+	cmdPut4(cursor);
+	cmdPut4(num);
+	for(i = 0; i < num; i++)
+	{
+		cmdPut4(entries[i].index);
+		cmdPut4(entries[i].timestamp);
+		cmdPut2(entries[i].length);
+		cmdPut2(entries[i].config_id);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+/* Points pUsbDataPtr at the rest of an interpreted data file, encoded into
+ * tempBuffer, for the commands that send it from a buffer in one go. Larger
+ * layouts are read with NNO_CMD_FILE_GET_DATA */
+static bool cmdFileEncodeInterpretData(void)
+{
+	if (bytesToSend > sizeof(tempBuffer))
+		return false;
+
+	InterpretData_Read(&interpretDataFile, bytesSent, &tempBuffer[0], bytesToSend);
+	pUsbDataPtr = &tempBuffer[0];
+	bytesSent = 0;
+	fileIsInterpretData = false;
+
+	return true;
+}
+
+bool cmdFileStream_rd(void)
+{
+	/*
+	 * Sends everything left of the file prepared by cmdFileSz_rd() in one go:
+	 * the response holds the number of bytes that follow as raw 64 byte
+	 * reports, the last one zero padded. Saves the host a request per 512
+	 * bytes compared to NNO_CMD_FILE_GET_DATA. USB only.
+	 */
+	if (cmdHandler_getActConnType() != CONN_USB)
+		return false;
+
+	if (fileIsInterpretData && !cmdFileEncodeInterpretData())
+		return false;
+
+	if ((bytesToSend > 0) && !cmdStreamUSB(&pUsbDataPtr[bytesSent], bytesToSend))
+		return false;
+
+	cmdPut4(bytesToSend);
+	bytesSent += bytesToSend;
+	bytesToSend = 0;
+
+	return true;
+}
+
+bool cmdUsbBulkStatus_rd(void)
+{
+#ifdef NIRSCAN_USB_BULK
+	USB_BULK_STATUS status;
+
+	UsbBulk_GetStatus(&status);
+	cmdPut1(USB_BULK_PROTO_VERSION);
+	cmdPut1(status.state);
+	cmdPut1(status.error);
+	cmdPut1(0);
+	cmdPut2(status.tag);
+	cmdPut2(USB_BULK_MAX_PKT_SIZE);
+	cmdPut4(status.done);
+	cmdPut4(status.total);
+#else
+	/* Version 0 tells the host to stay on the HID file commands */
+	cmdPut1(0);
+	cmdPut1(USB_BULK_STATE_OFFLINE);
+	cmdPut1(USB_BULK_ERR_NONE);
+	cmdPut1(0);
+	cmdPut2(0);
+	cmdPut2(0);
+	cmdPut4(0);
+	cmdPut4(0);
+#endif
+	return true;
+}
+
+bool cmdFileBulkRead_rd(void)
+{
+#ifdef NIRSCAN_USB_BULK
+	uint16_t tag = cmdGet2(uint16_t);
+
+	/*
+	 * Sends everything left of the file prepared by cmdFileSz_rd() as one
+	 * frame on the bulk interface. The response gives the payload bytes.
+	 */
+	if (cmdHandler_getActConnType() != CONN_USB)
+		return false;
+
+	if (fileIsInterpretData && !cmdFileEncodeInterpretData())
+		return false;
+
+	if (UsbBulk_StartSend(tag, &pUsbDataPtr[bytesSent], bytesToSend) != PASS)
+		return false;
+
+	cmdPut4(bytesToSend);
+	bytesSent += bytesToSend;
+	bytesToSend = 0;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool cmdFileBulkWrite_wr(void)
+{
+#ifdef NIRSCAN_USB_BULK
+	uint32_t size = cmdGet4(uint32_t);
+	uint16_t action = cmdGet2(uint16_t);
+	uint16_t tag = cmdGet2(uint16_t);
+	uint8_t *pDst;
+
+	/*
+	 * Sets up the bulk interface to take the next frame straight into an
+	 * SDRAM pattern frame; the host polls NNO_CMD_USB_BULK_STATUS for the
+	 * result. DLPC150 flash updates and reference calibration data are
+	 * programmed as they arrive and stay on NNO_CMD_FILE_SET_WRITESIZE.
+	 */
+	if (cmdHandler_getActConnType() != CONN_USB)
+		return false;
+
+	if ((action < NNO_FILE_PTN_LOAD_SDRAM) || (action == NNO_FILE_REFCAL_DATA))
+		return false;
+
+	/* The action selects the frame buffer; there are NUM_FRAMEBUFFERS */
+	if ((action - NNO_FILE_PTN_LOAD_SDRAM) >= NUM_FRAMEBUFFERS)
+		return false;
+
+	if (size > DISP_WIDTH * DISP_HEIGHT * 3)
+		return false;
+
+	Display_InvalidatePatternCache();
+	pDst = (uint8_t *)(SDRAM_START_ADDRESS + (action-NNO_FILE_PTN_LOAD_SDRAM)*(DISP_WIDTH * DISP_HEIGHT * 3));
+
+	return (UsbBulk_StartReceive(tag, pDst, size) == PASS);
+#else
+	return false;
+#endif
+}
+
+bool cmdUsbBulkAbort_wr(void)
+{
+#ifdef NIRSCAN_USB_BULK
+	UsbBulk_Abort();
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool cmdUsbCmdQueueStats_rd(void)
+{
+	USB_CMD_QUEUE_STATS stats;
+
+	UsbCmdQueue_GetStats(&stats);
+	cmdPut4(stats.num_immediate);
+	cmdPut4(stats.num_queued);
+	cmdPut4(stats.num_busy);
+	cmdPut4(stats.depth);
+	cmdPut4(stats.depth_max);
+	return true;
+}
+
 bool cmdRefCalibSave_wr(void)
 {
 	int result = PASS;
@@ -1986,6 +2479,7 @@ bool cmdEraseScan_wr(void)
 	int ret_val = 0;
 
 	index = cmdGet4(uint32_t);
+	SDWriter_Flush();
 		ret_val = FATSD_DeleteScanFile(index);
 
 	if (ret_val == FR_OK)
@@ -2017,17 +2511,26 @@ bool cmdEEPROM_mass_erase_wr(void)
 
 bool cmdScantime_rd(void)
 {
-	uint32_t scan_time = Scan_ComputeScanTime();
+	ScanTimeEstimate est;
+	int i;
+
+	Scan_GetScanTimeEstimate(&est);
 #ifdef NIRSCAN_INCLUDE_BLE
 	if (!isBLEConnActive())
 #endif
-		cmdPut4(scan_time);
+	{
+		/* Total first so that readers of the original 4 byte reply still work */
+		cmdPut4(est.total_ms);
+		for(i=0; i<SCAN_NUM_PHASES; i++)
+			cmdPut4(est.phase_ms[i]);
+	}
 
 	return TRUE;
 }
 
 bool cmdSDDeleteLastScanFile_wr(void)
 {
+	SDWriter_Flush();
 	FATSD_DeleteLastScanFile();
     return true;
 }
@@ -2037,10 +2540,14 @@ bool cmdTemp_rd(void)
 	uint32_t ret_val, val;
 	float TMPAmbientTemp  = 0.0;
 	float TMPDetectTemp  = 0.0;
+	SENSOR_SNAPSHOT snap;
 #ifdef NIRSCAN_INCLUDE_BLE
 	int16_t temperature = 0;
 #endif
-	ret_val = tmp006_DataTemperatureGetFloat( &TMPAmbientTemp, &TMPDetectTemp );
+	ret_val = SensorSvc_Refresh( SENSOR_SNAP_TMP006 );
+	SensorSvc_GetSnapshot( &snap );
+	TMPAmbientTemp = snap.ambient_temp;
+	TMPDetectTemp = snap.detector_temp;
 
 	if ( ret_val == PASS )
 	{
@@ -2078,8 +2585,12 @@ bool cmdHum_rd(void)
 #endif
 	float HDCtemp;
 	float HDChumidity = 0.0;
+	SENSOR_SNAPSHOT snap;
 
-	ret_val = hdc1000_DataTemperatureGetFloat( &HDCtemp, &HDChumidity );
+	ret_val = SensorSvc_Refresh( SENSOR_SNAP_HDC1000 );
+	SensorSvc_GetSnapshot( &snap );
+	HDCtemp = snap.board_temp;
+	HDChumidity = snap.humidity;
 
 	if(ret_val == PASS)
 	{
@@ -2140,11 +2651,21 @@ bool cmdSetDateTime_wr(void)
 bool cmdBattVolt_rd(void)
 {
 	float battvoltage = 0.0;
+	int32_t ret_val;
 	uint32_t  val;
+	SENSOR_SNAPSHOT snap;
 #ifdef NIRSCAN_INCLUDE_BLE
 	unsigned char percentage = 0;
 #endif
-	battery_read( &battvoltage );
+	ret_val = SensorSvc_Refresh( SENSOR_SNAP_BATTERY );
+	SensorSvc_GetSnapshot( &snap );
+	battvoltage = snap.battery_volt;
+
+	if ( ret_val != PASS )
+	{
+		cmdPut4( ret_val );
+		return true;
+	}
 
 #ifdef NIRSCAN_INCLUDE_BLE
 	if (isBLEConnActive())
@@ -2221,6 +2742,7 @@ bool cmdGetDateTime_rd(void)
 
 bool cmdSetPowerDown_wr(void)
 {
+	Nano_eeprom_FlushCounters();
 	NIRscanNano_powerDown();
 
     return TRUE;
@@ -2256,6 +2778,7 @@ bool cmdSDGetNumScanFiles_rd(void)
 {
 	int num;
 
+	SDWriter_Flush();
 	num = FATSD_GetNumScanFiles();
 	cmdPut4(num);
 	return (TRUE);
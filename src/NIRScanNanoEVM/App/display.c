@@ -30,6 +30,7 @@
 #include "nano_eeprom.h"
 #include "trigger.h"
 #include "display.h"
+#include "scanTrace.h"
 
 /*****************************************************************************
  *
@@ -44,6 +45,38 @@ static uint32_t g_FrameFlipVsyncCount;
 static volatile uint32_t vsyncCount = 0;
 static tLCDRasterTiming g_tTiming;
 
+#ifndef INTERNAL_FRAMEBUFFER
+/*****************************************************************************
+ *
+ *Pattern sets already generated for recently used scan configs are kept in
+ *SDRAM so that switching back to one of them only moves the frame buffer
+ *pointer. Space is handed out in whole frames out of the NUM_FRAMEBUFFERS
+ *frames that fit in SDRAM.
+ *
+ *****************************************************************************/
+#define PTN_CACHE_NUM_ENTRIES		4
+#define PTN_CACHE_BUDGET_FRAMES		NUM_FRAMEBUFFERS
+#define PTN_CACHE_HASH_INIT			2166136261u		// FNV-1a offset basis
+
+typedef struct _ptnCacheEntry
+{
+	bool		valid;
+	uint16_t	scanConfigIndex;
+	uint32_t	cfg_hash;		// hash of the fields that shape the patterns
+	uint32_t	coeff_hash;		// hash of the calibration coefficients used
+	uint16_t	start_frame;
+	uint16_t	num_frames;
+	int			num_patterns;
+	uint32_t	last_used;
+} PTN_CACHE_ENTRY;
+
+static PTN_CACHE_ENTRY ptnCache[PTN_CACHE_NUM_ENTRIES];
+static uint32_t ptnCacheUseCount = 0;
+
+/* Frame g_frameBuffer0 points at: 0, or the first frame of a cached set */
+static volatile uint16_t g_startFrame = 0;
+#endif
+
 /*****************************************************************************
  *
  *Private functions declaration
@@ -52,6 +85,13 @@ static tLCDRasterTiming g_tTiming;
 static void Display_InitGPIO(void);
 static void Display_InitVideoTiming(void);
 static void Display_InitLCD(void);
+#ifndef INTERNAL_FRAMEBUFFER
+static uint32_t Display_PtnCacheHash(const void *pData, uint32_t len, uint32_t hash);
+static uint32_t Display_PtnCacheCfgHash(const uScanConfig *pCfg);
+static bool Display_PtnCacheEvictLRU(void);
+static uint16_t Display_PtnCacheFindGap(uint16_t *pStart);
+static void Display_SetStartFrame(uint16_t frame);
+#endif
 
 /*****************************************************************************
  *
@@ -99,8 +139,12 @@ void DisplayIntHandler()
 	 * Handles display-related interrupts
 	 */
 	uint32_t ui32Status;
+#ifndef INTERNAL_FRAMEBUFFER
+	uint32_t frame;
+#endif
 	ui32Status = LCDIntStatus(LCD0_BASE, true); // Get the current interrupt status and clear any active interrupts
 	LCDIntClear(LCD0_BASE, ui32Status);
+	SCAN_TRACE(SCAN_TRACE_MASK_ISR_DISPLAY, SCAN_TRACE_ISR_DISPLAY, g_fullFrameCount);
 	if(ui32Status & LCD_INT_UNDERFLOW) // If we saw an underflow interrupt, restart the raster
 	{
   		g_ui32UnderflowCount++;
@@ -142,11 +186,12 @@ void DisplayIntHandler()
 #else
 	if(vsyncCount == g_FrameFlipVsyncCount)
 	{
-#ifdef SIXTEEN_BPP
-			MAP_LCDRasterFrameBufferSet(LCD0_BASE, 0, g_frameBuffer0+g_fullFrameCount*g_frameBufferSz/2, g_frameBufferSz); // p. 1900 TIVA TM4C129XNCZAD
-#else
-			MAP_LCDRasterFrameBufferSet(LCD0_BASE, 0, g_frameBuffer0+g_fullFrameCount*g_frameBufferSz/4, g_frameBufferSz); // p. 1900 TIVA TM4C129XNCZAD
-#endif
+			/* A cached pattern set can start anywhere in the frame buffer area,
+			 * so wrap within that area and not past the end of SDRAM */
+			frame = g_startFrame + g_fullFrameCount;
+			if(frame >= NUM_FRAMEBUFFERS)
+				frame -= NUM_FRAMEBUFFERS;
+			MAP_LCDRasterFrameBufferSet(LCD0_BASE, 0, (uint32_t *)(SDRAM_START_ADDRESS + frame * g_frameBufferSz), g_frameBufferSz); // p. 1900 TIVA TM4C129XNCZAD
 			g_FrameFlipVsyncCount = vsyncCount + Scan_GetFrameSyncs(g_fullFrameCount++);
 			if(g_fullFrameCount == NUM_FRAMEBUFFERS)
 				g_fullFrameCount = 0;
@@ -325,6 +370,12 @@ int Display_GenCalibPatterns(CALIB_SCAN_TYPES scan_type)
 #endif
 #endif
 
+#ifndef INTERNAL_FRAMEBUFFER
+	/* Calibration patterns take the whole frame buffer area */
+	Display_InvalidatePatternCache();
+	fb.frameBuffer = (uint32_t *)g_frameBuffer0;
+#endif
+
 	num_patterns = dlpspec_calib_genPatterns(scan_type, &fb);
 
 	if(num_patterns > 0)
@@ -337,7 +388,9 @@ int Display_GenCalibPatterns(CALIB_SCAN_TYPES scan_type)
 int Display_GenScanPatterns(uScanConfig *pCfg)
 /**
  * Calls the spectrum library API to generate patterns for scans. Pattern bending is also done
- * for optical distortion.
+ * for optical distortion. With an external frame buffer the generated set is cached in SDRAM
+ * and a later call for the same config and calibration coefficients only points the display
+ * at the cached set.
  *
  * @param   pCfg -I- scan configuration defines the scan type and various parameters such as start
  *                   and end wavelength and num of patterns which are used to configure start and end
@@ -350,6 +403,15 @@ int Display_GenScanPatterns(uScanConfig *pCfg)
 	FrameBufferDescriptor fb;
 	calibCoeffs calib_coeffs; //SK: Think about memset to zero
 	int numPatterns;
+#ifndef INTERNAL_FRAMEBUFFER
+	PTN_CACHE_ENTRY *pEntry = NULL;
+	uint32_t cfg_hash;
+	uint32_t coeff_hash;
+	uint16_t start_frame = 0;
+	uint16_t num_frames;
+	int est_patterns;
+	int i;
+#endif
 
 	fb.frameBuffer = (uint32_t *)g_frameBuffer0;
 	fb.numFBs = NUM_FRAMEBUFFERS;
@@ -366,15 +428,234 @@ int Display_GenScanPatterns(uScanConfig *pCfg)
 #endif
 
 	Nano_eeprom_GetcalibCoeffs(&calib_coeffs);
+
+#ifndef INTERNAL_FRAMEBUFFER
+	cfg_hash = Display_PtnCacheCfgHash(pCfg);
+	coeff_hash = Display_PtnCacheHash(&calib_coeffs, sizeof(calibCoeffs), PTN_CACHE_HASH_INIT);
+
+	for(i = 0; i < PTN_CACHE_NUM_ENTRIES; i++)
+	{
+		if(ptnCache[i].valid && (ptnCache[i].scanConfigIndex == pCfg->scanCfg.scanConfigIndex) &&
+				(ptnCache[i].cfg_hash == cfg_hash) && (ptnCache[i].coeff_hash == coeff_hash))
+		{
+			ptnCache[i].last_used = ++ptnCacheUseCount;
+			Display_SetStartFrame(ptnCache[i].start_frame);
+			return ptnCache[i].num_patterns;
+		}
+	}
+
+	/* Miss: need a free entry and, as far as can be told before generating,
+	 * enough contiguous frames. Hadamard sets can come out a little larger
+	 * than num_patterns; that case is caught after generation. */
+	if(pCfg->scanCfg.scan_type == SLEW_TYPE)
+		est_patterns = dlpspec_scan_slew_get_num_patterns(&pCfg->slewScanCfg);
+	else
+		est_patterns = pCfg->scanCfg.num_patterns;
+
+	for(i = 0; i < PTN_CACHE_NUM_ENTRIES; i++)
+	{
+		if(!ptnCache[i].valid)
+			break;
+	}
+	if(i == PTN_CACHE_NUM_ENTRIES)
+	{
+		Display_PtnCacheEvictLRU();
+		for(i = 0; ptnCache[i].valid; i++);
+	}
+	pEntry = &ptnCache[i];
+
+	while((num_frames = Display_PtnCacheFindGap(&start_frame)) < est_patterns/NUM_BP_PER_FRAME + 1)
+	{
+		if(!Display_PtnCacheEvictLRU())
+			break;
+	}
+
+	if(start_frame + num_frames > NUM_FRAMEBUFFERS)
+	{
+		Display_InvalidatePatternCache();
+		start_frame = 0;
+		num_frames = NUM_FRAMEBUFFERS;
+	}
+
+	fb.frameBuffer = (uint32_t *)(SDRAM_START_ADDRESS + start_frame * g_frameBufferSz);
+	fb.numFBs = num_frames;
 	numPatterns = dlpspec_scan_genPatterns(pCfg, &calib_coeffs, &fb);
+
+	if(numPatterns > num_frames * NUM_BP_PER_FRAME)
+	{
+		/* Did not fit in the gap; fall back to the whole frame buffer area */
+		Display_InvalidatePatternCache();
+		start_frame = 0;
+		fb.frameBuffer = (uint32_t *)g_frameBuffer0;
+		fb.numFBs = num_frames = NUM_FRAMEBUFFERS;
+		numPatterns = dlpspec_scan_genPatterns(pCfg, &calib_coeffs, &fb);
+	}
+#else
+	numPatterns = dlpspec_scan_genPatterns(pCfg, &calib_coeffs, &fb);
+#endif
 #ifndef NO_PATTERN_BENDING
 	if(dlpspec_scan_bendPatterns(&fb, &calib_coeffs, numPatterns) != PASS)
 		return -1;
 #endif
+
+#ifndef INTERNAL_FRAMEBUFFER
+	Display_SetStartFrame(start_frame);
+	if((numPatterns > 0) && (start_frame + MIN(numPatterns/NUM_BP_PER_FRAME + 1, num_frames) <= NUM_FRAMEBUFFERS))
+	{
+		pEntry->valid = true;
+		pEntry->scanConfigIndex = pCfg->scanCfg.scanConfigIndex;
+		pEntry->cfg_hash = cfg_hash;
+		pEntry->coeff_hash = coeff_hash;
+		pEntry->start_frame = start_frame;
+		pEntry->num_frames = MIN(numPatterns/NUM_BP_PER_FRAME + 1, num_frames);
+		pEntry->num_patterns = numPatterns;
+		pEntry->last_used = ++ptnCacheUseCount;
+	}
+#endif
 	return numPatterns;
 
 }
 
+void Display_InvalidatePatternCache(void)
+/**
+ * Drops all cached pattern sets and points the display back at the start of the frame
+ * buffer area. Must be called before anything other than Display_GenScanPatterns() writes
+ * to the frame buffer area and when the calibration coefficients change.
+ *
+ * @return  None
+ *
+ */
+{
+#ifndef INTERNAL_FRAMEBUFFER
+	int i;
+
+	for(i = 0; i < PTN_CACHE_NUM_ENTRIES; i++)
+		ptnCache[i].valid = false;
+
+	Display_SetStartFrame(0);
+#endif
+}
+
+#ifndef INTERNAL_FRAMEBUFFER
+static void Display_SetStartFrame(uint16_t frame)
+/*
+ * Points the display at the pattern set starting at the given frame. The
+ * display ISR counts frames from here and wraps at the end of the frame
+ * buffer area.
+ */
+{
+	g_frameBuffer0 = (void *)(SDRAM_START_ADDRESS + frame * g_frameBufferSz);
+	g_startFrame = frame;
+}
+
+static uint32_t Display_PtnCacheHash(const void *pData, uint32_t len, uint32_t hash)
+{
+	const uint8_t *pByte = (const uint8_t *)pData;
+
+	while(len--)
+	{
+		hash ^= *pByte++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t Display_PtnCacheCfgHash(const uScanConfig *pCfg)
+/*
+ * Hashes only the fields that change the generated patterns so that name,
+ * repeat count and padding do not cause needless misses.
+ */
+{
+	uint32_t hash = PTN_CACHE_HASH_INIT;
+	const slewScanSection *pSect;
+	int i;
+
+	hash = Display_PtnCacheHash(&pCfg->scanCfg.scan_type, sizeof(pCfg->scanCfg.scan_type), hash);
+	if(pCfg->scanCfg.scan_type == SLEW_TYPE)
+	{
+		for(i = 0; i < pCfg->slewScanCfg.head.num_sections && i < SLEW_SCAN_MAX_SECTIONS; i++)
+		{
+			pSect = &pCfg->slewScanCfg.section[i];
+			hash = Display_PtnCacheHash(&pSect->section_scan_type, sizeof(pSect->section_scan_type), hash);
+			hash = Display_PtnCacheHash(&pSect->width_px, sizeof(pSect->width_px), hash);
+			hash = Display_PtnCacheHash(&pSect->wavelength_start_nm, sizeof(pSect->wavelength_start_nm), hash);
+			hash = Display_PtnCacheHash(&pSect->wavelength_end_nm, sizeof(pSect->wavelength_end_nm), hash);
+			hash = Display_PtnCacheHash(&pSect->num_patterns, sizeof(pSect->num_patterns), hash);
+		}
+	}
+	else
+	{
+		hash = Display_PtnCacheHash(&pCfg->scanCfg.width_px, sizeof(pCfg->scanCfg.width_px), hash);
+		hash = Display_PtnCacheHash(&pCfg->scanCfg.wavelength_start_nm, sizeof(pCfg->scanCfg.wavelength_start_nm), hash);
+		hash = Display_PtnCacheHash(&pCfg->scanCfg.wavelength_end_nm, sizeof(pCfg->scanCfg.wavelength_end_nm), hash);
+		hash = Display_PtnCacheHash(&pCfg->scanCfg.num_patterns, sizeof(pCfg->scanCfg.num_patterns), hash);
+	}
+
+	return hash;
+}
+
+static bool Display_PtnCacheEvictLRU(void)
+{
+	int i;
+	int lru = -1;
+
+	for(i = 0; i < PTN_CACHE_NUM_ENTRIES; i++)
+	{
+		if(ptnCache[i].valid && ((lru < 0) || (ptnCache[i].last_used < ptnCache[lru].last_used)))
+			lru = i;
+	}
+
+	if(lru < 0)
+		return false;
+
+	ptnCache[lru].valid = false;
+	return true;
+}
+
+static uint16_t Display_PtnCacheFindGap(uint16_t *pStart)
+/*
+ * Finds the largest run of frames not used by any cached set.
+ * Returns its length in frames and its first frame in pStart.
+ */
+{
+	uint16_t start, end, best = 0;
+	int i, j;
+
+	*pStart = 0;
+	for(i = -1; i < PTN_CACHE_NUM_ENTRIES; i++)
+	{
+		/* Candidate gaps start at frame 0 or right after a cached set */
+		if(i < 0)
+			start = 0;
+		else if(ptnCache[i].valid)
+			start = ptnCache[i].start_frame + ptnCache[i].num_frames;
+		else
+			continue;
+
+		end = PTN_CACHE_BUDGET_FRAMES;
+		for(j = 0; j < PTN_CACHE_NUM_ENTRIES; j++)
+		{
+			if(!ptnCache[j].valid)
+				continue;
+			if((ptnCache[j].start_frame <= start) &&
+					(start < ptnCache[j].start_frame + ptnCache[j].num_frames))
+				end = start;		// candidate lies inside a cached set
+			else if((ptnCache[j].start_frame > start) && (ptnCache[j].start_frame < end))
+				end = ptnCache[j].start_frame;
+		}
+
+		if(end > start && (end - start) > best)
+		{
+			best = end - start;
+			*pStart = start;
+		}
+	}
+
+	return best;
+}
+#endif
+
 void Display_SetFrameBufferAtBeginning()
 /**
  * Reset the LCD to stream first frame buffer.
@@ -0,0 +1,102 @@
+/*
+ *
+ * Deferred binary logging. A log call stores the address of its format
+ * string, a cycle counter timestamp and its arguments as raw 32-bit words in
+ * a RAM ring; formatting is left to the host (tools/binlog_decode.py), which
+ * looks the format strings up in the firmware image.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef BINLOG_H_
+#define BINLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Size of the ring in 32-bit words; must be a power of 2. A log call that
+ * does not fit is dropped rather than overwriting what has not been sent */
+#define BIN_LOG_RING_WORDS			1024
+
+/* Most arguments a log call can carry */
+#define BIN_LOG_MAX_ARGS			8
+
+/* Longest string, with its terminating 0, copied into a record for a %s
+ * argument; longer ones are cut off */
+#define BIN_LOG_MAX_STR_LEN			32
+
+/*
+ * Records as read out of the ring, little endian 32-bit words:
+ *	sync		BIN_LOG_SYNC
+ *	header		bits 31:16 sequence number, bits 15:8 number of string words,
+ *				bits 7:0 number of arguments
+ *	format		address of the format string in the image; 0 for a record
+ *				saying how many log calls were dropped (argument 0)
+ *	timestamp	core cycle counter
+ *	arguments
+ *	strings		0 terminated strings, each padded to a whole word
+ * A %s argument that is not in the image, a name or address built at run
+ * time, is copied into the strings; its argument word is then
+ * BIN_LOG_STR_INLINE plus the byte offset of the copy.
+ */
+#define BIN_LOG_SYNC				0x474F4C4E		/* "NLOG" */
+#define BIN_LOG_STR_INLINE			0xFFFF0000
+#define BIN_LOG_RECORD_HEADER_SIZE	16
+#define BIN_LOG_MAX_RECORD_SIZE		(BIN_LOG_RECORD_HEADER_SIZE + 4 * BIN_LOG_MAX_ARGS + \
+									 BIN_LOG_MAX_ARGS * BIN_LOG_MAX_STR_LEN)
+
+/* Drain task */
+#define BIN_LOG_TASK_STACK_SIZE		1024
+#define BIN_LOG_TASK_PRIORITY		1
+#define BIN_LOG_DRAIN_PERIOD_TICKS	10
+
+/*
+ * BIN_LOG(format, args...) takes up to BIN_LOG_MAX_ARGS arguments. Every
+ * argument is logged as a 32-bit word, so 64-bit and floating point values
+ * cannot be logged. A %s argument is logged as the string's address if it
+ * is a constant in the image and copied into the record otherwise.
+ */
+#define BIN_LOG(...)					BIN_LOG_CAT(BIN_LOG_, BIN_LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+#define BIN_LOG_NARGS(...)				BIN_LOG_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0, _)
+#define BIN_LOG_NARGS_(f, a1, a2, a3, a4, a5, a6, a7, a8, n, ...)	n
+#define BIN_LOG_CAT(a, b)				BIN_LOG_CAT_(a, b)
+#define BIN_LOG_CAT_(a, b)				a##b
+#define BIN_LOG_W(a)					((uint32_t)(uintptr_t)(a))
+
+#define BIN_LOG_0(f)					BinLog_Write((f), 0)
+#define BIN_LOG_1(f, a)					BinLog_Write((f), 1, BIN_LOG_W(a))
+#define BIN_LOG_2(f, a, b)				BinLog_Write((f), 2, BIN_LOG_W(a), BIN_LOG_W(b))
+#define BIN_LOG_3(f, a, b, c)			BinLog_Write((f), 3, BIN_LOG_W(a), BIN_LOG_W(b), \
+												BIN_LOG_W(c))
+#define BIN_LOG_4(f, a, b, c, d)		BinLog_Write((f), 4, BIN_LOG_W(a), BIN_LOG_W(b), \
+												BIN_LOG_W(c), BIN_LOG_W(d))
+#define BIN_LOG_5(f, a, b, c, d, e)		BinLog_Write((f), 5, BIN_LOG_W(a), BIN_LOG_W(b), \
+												BIN_LOG_W(c), BIN_LOG_W(d), BIN_LOG_W(e))
+#define BIN_LOG_6(f, a, b, c, d, e, g)	BinLog_Write((f), 6, BIN_LOG_W(a), BIN_LOG_W(b), \
+												BIN_LOG_W(c), BIN_LOG_W(d), BIN_LOG_W(e), \
+												BIN_LOG_W(g))
+#define BIN_LOG_7(f, a, b, c, d, e, g, h)	BinLog_Write((f), 7, BIN_LOG_W(a), BIN_LOG_W(b), \
+												BIN_LOG_W(c), BIN_LOG_W(d), BIN_LOG_W(e), \
+												BIN_LOG_W(g), BIN_LOG_W(h))
+#define BIN_LOG_8(f, a, b, c, d, e, g, h, i)	BinLog_Write((f), 8, BIN_LOG_W(a), BIN_LOG_W(b), \
+												BIN_LOG_W(c), BIN_LOG_W(d), BIN_LOG_W(e), \
+												BIN_LOG_W(g), BIN_LOG_W(h), BIN_LOG_W(i))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void BinLog_Write(const char *pFmt, uint32_t numArgs, ...);
+uint32_t BinLog_Read(uint8_t *pBuf, uint32_t max_size);
+#ifndef NIRSCAN_HOST_BUILD
+void BinLog_Task(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BINLOG_H_ */
@@ -61,12 +61,29 @@ bool cmdSNRDataSave_rd();
 bool cmdCalibGenPtns_wr();
 bool cmdScanNumRepeats_wr();
 bool cmdHadSNRCompute_wr();
+bool cmdSNRSetWindow_wr();
+bool cmdSensorSvcPeriods_wr();
+bool cmdSDWriterStats_rd();
+bool cmdSDArchiveCtrl_wr();
+bool cmdSDScanQuery_rd();
+bool cmdFileStream_rd();
+bool cmdUsbBulkStatus_rd();
+bool cmdFileBulkRead_rd();
+bool cmdFileBulkWrite_wr();
+bool cmdUsbBulkAbort_wr();
+bool cmdUsbCmdQueueStats_rd();
 bool cmdRefCalibSave_wr();
 bool cmdStartScanFlashPatterns_wr();
 bool cmdSaveDeviceSerialNo_wr();
 bool cmdGetDeviceSerialNo_rd();
 bool cmdSaveModelName_wr();
 bool cmdGetModelName_rd();
+bool cmdScanStreamEnable_wr();
+bool cmdScanStreamRead_rd();
+bool cmdScanContinuousStart_wr();
+bool cmdScanContinuousStop_wr();
+bool cmdReadPGAStats_rd();
+bool cmdScanTraceCtrl_wr();
 bool cmdSaveScanNameTag_wr();
 bool cmdEraseScan_wr();
 bool cmdEEPROM_mass_erase_wr();
@@ -109,6 +109,60 @@
 #undef HW_SD_CARD_DETECT
 #endif
 
+/**
+ * Compiler switch to include the scan trace points (see scanTrace.h)
+ *
+ * 0 = Trace points compile to nothing
+ * 1 = Trace points log into the RAM trace ring
+ */
+#if 1
+	#define NIRSCAN_SCAN_TRACE
+#else
+	#undef NIRSCAN_SCAN_TRACE
+#endif
+
+/**
+ * Compiler switch for how scans are stored on the SD card (see sdArchive.h)
+ *
+ * 0 = One <index>.DAT file per scan
+ * 1 = Scans are appended to a single archive file; per-file scans already on
+ *     the card can still be read and the archive can be exported to them
+ */
+#if 1
+	#define NIRSCAN_SD_ARCHIVE
+#else
+	#undef NIRSCAN_SD_ARCHIVE
+#endif
+
+/**
+ * Compiler switch for the ADC data of scans stored on the SD card or sent to
+ * the host (see dlpspec_compress.h)
+ *
+ * 0 = Plain serialized array, readable by any dlpspeclib version
+ * 1 = Losslessly packed and marked as scan data version 2; the host needs
+ *     dlpspeclib 2.0.4 or later, earlier versions reject such scans
+ */
+#if 0
+	#define NIRSCAN_PACK_ADC_DATA
+#else
+	#undef NIRSCAN_PACK_ADC_DATA
+#endif
+
+/**
+ * Compiler switch for the USB device layout (see NNOUSBBulkDefs.h)
+ *
+ * 0 = HID command interface only
+ * 1 = Composite device adding a vendor specific bulk interface for large
+ *     file transfers; commands stay on the HID interface. The device has no
+ *     MS OS descriptors, so Windows hosts need a WinUSB or libusb driver
+ *     installed for the bulk interface
+ */
+#if 0
+	#define NIRSCAN_USB_BULK
+#else
+	#undef NIRSCAN_USB_BULK
+#endif
+
 /****************** DEBUG CONTROLS *****************/
 
 #define UART_CONSOLE 0
@@ -134,17 +188,34 @@
 	#define LOG_PORT CCS_CONSOLE
 #endif
 
+/**
+ * Compiler switch to defer log formatting to the host (see binLog.h)
+ *
+ * 0 = Logs are formatted on the device as they are made
+ * 1 = Logs are recorded unformatted into a RAM ring, sent to the log port by
+ *     a background task and rendered by tools/binlog_decode.py
+ */
+#if 1
+	#define NIRSCAN_BIN_LOG
+#else
+	#undef NIRSCAN_BIN_LOG
+#endif
+
 /**
  * Compiler switch to choose log printf substitute
  * Please use switches above to control what gets used
  */
+#ifdef NIRSCAN_BIN_LOG
+	#include "binLog.h"
+#endif
+
 #ifdef DEBUG_MSGS
-    #if (LOG_PORT == UART_CONSOLE)	// If UART command interface is not enabled, use it for logging
-		#ifndef ENABLE_UART_COMMAND_INTERFACE
+    #if (LOG_PORT == UART_CONSOLE) && defined(ENABLE_UART_COMMAND_INTERFACE)
+		#define DEBUG_PRINT(...)	// No console messages
+    #elif defined(NIRSCAN_BIN_LOG)
+		#define DEBUG_PRINT(...)                                BIN_LOG(__VA_ARGS__)
+    #elif (LOG_PORT == UART_CONSOLE)	// UART command interface is not enabled, use it for logging
        	   #define DEBUG_PRINT(...)                                do { UARTprintf(__VA_ARGS__); UARTFlushLog(false);} while(0)
-		#else // No console messages
-			#define DEBUG_PRINT(...)
-		#endif
     #else
 	// Print on the CCS Console screen
        #define DEBUG_PRINT(...)                                do { System_printf(__VA_ARGS__); System_flush();} while(0)
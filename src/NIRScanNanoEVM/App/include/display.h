@@ -39,6 +39,7 @@ void Display_Init(void);
 void Display_Disable();
 int  Display_GenScanPatterns(uScanConfig *pCfg);
 int  Display_GenCalibPatterns(CALIB_SCAN_TYPES scan_type);
+void Display_InvalidatePatternCache(void);
 void Display_SetFrameBufferAtBeginning(void);
 int Display_FramePropagationWait(void);
 
@@ -0,0 +1,56 @@
+/*
+ *
+ * Encoding of the NNO_FILE_INTERPRET_DATA file from an interpreted scan, in
+ * the layouts described in NNOCommandDefs.h. No driver or RTOS dependencies,
+ * so a host build can check it against the scan results it came from.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef INTERPRETDATA_H_
+#define INTERPRETDATA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "NNOCommandDefs.h"
+#include "dlpspec_scan.h"
+
+/* Format of the interleaved layout sent when the host gives no format byte */
+#define INTERPRET_DATA_INTERLEAVED	0xFF
+
+/* Size of the header ahead of the arrays in the structure of arrays layout */
+#define INTERPRET_DATA_HEADER_SIZE	8
+
+/* Largest file of any layout */
+#define INTERPRET_DATA_MAX_SIZE		(INTERPRET_DATA_HEADER_SIZE + \
+		ADC_DATA_LEN * (sizeof(double) + sizeof(int32_t)))
+
+/**
+ * File being read; filled in by InterpretData_Open()
+ */
+typedef struct _interpretDataFile
+{
+	const scanResults	*pResults;
+	uint8_t				format;
+	uint8_t				shift;			/**< INT16 intensity bits dropped         */
+	uint32_t			wlOffset;		/**< start of the wavelength array        */
+	uint32_t			intOffset;		/**< start of the intensity array         */
+	uint32_t			size;
+} INTERPRET_DATA_FILE;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool InterpretData_Open(INTERPRET_DATA_FILE *pFile, const scanResults *pResults,
+		uint8_t format);
+uint32_t InterpretData_Read(const INTERPRET_DATA_FILE *pFile, uint32_t offset,
+		void *pDst, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INTERPRETDATA_H_ */
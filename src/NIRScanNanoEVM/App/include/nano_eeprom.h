@@ -12,6 +12,7 @@
 #include "dlpspec_calib.h"
 #include "dlpspec_scan.h"
 #include "scan.h"
+#include "NNOCommandDefs.h"
 
 // EEPROM start addr
 #define EEPROM_START_ADDR 0
@@ -20,12 +21,12 @@
 #define EEPROM_SERIAL_NUMBER_OFFSET 0
 #define EEPROM_SERIAL_NUMBER_ADDR (EEPROM_START_ADDR + EEPROM_SERIAL_NUMBER_OFFSET)
 #define EEPROM_SERIAL_NUMBER_SIZE 8
-/* Scan Data Index Counter */
+/* Scan Data Index Counter; only read to seed the counter log (EEPROM_COUNTER_LOG) */
 #define EEPROM_INDEX_COUNTER_OFFSET (EEPROM_SERIAL_NUMBER_OFFSET + EEPROM_SERIAL_NUMBER_SIZE)
 #define EEPROM_INDEX_COUNTER_ADDR (EEPROM_START_ADDR + EEPROM_INDEX_COUNTER_OFFSET)
 #define EEPROM_INDEX_COUNTER_SIZE 4
 
-/* Scan Config Index Counter */
+/* Scan Config Index Counter; only read to seed the counter log */
 #define EEPROM_CONFIG_COUNTER_OFFSET (EEPROM_INDEX_COUNTER_OFFSET + EEPROM_INDEX_COUNTER_SIZE)
 #define EEPROM_CONFIG_COUNTER_ADDR (EEPROM_START_ADDR + EEPROM_CONFIG_COUNTER_OFFSET)
 #define EEPROM_CONFIG_COUNTER_SIZE 4
@@ -55,7 +56,9 @@
 #define EEPROM_SCAN_NAME_SIZE 16
 
 /* This word in EEPROM contains the following information
- * upper 16-bits hold the number of scan cfg structs stored in EEPROM
+ * upper 16-bits hold the number of scan cfg structs stored in EEPROM; only
+ * read to migrate to the config directory (EEPROM_CFG_DIR), which keeps the
+ * count since
  * lower 16-bits holds the currently active scan config index 
  */
 #define EEPROM_NUM_AND_ACTIVE_CFG_OFFSET (EEPROM_SCAN_NAME_OFFSET + EEPROM_SCAN_NAME_SIZE)
@@ -92,6 +95,99 @@
 #define EEPROM_MODEL_NAME_ADDR (EEPROM_START_ADDR + EEPROM_MODEL_NAME_OFFSET)
 #define EEPROM_MODEL_NAME_SIZE 16
 
+/* Scan config directory. Gives the offset, size, ID and CRC of each record
+ * in the scan cfg area, so that a record is found without reading the ones
+ * stored ahead of it. Records are written to free space and the directory
+ * entry is switched over through the journal, so a save interrupted by a
+ * power loss leaves the old record in place. */
+#define EEPROM_CFG_DIR_OFFSET (EEPROM_MODEL_NAME_OFFSET + EEPROM_MODEL_NAME_SIZE)
+#define EEPROM_CFG_DIR_ADDR (EEPROM_START_ADDR + EEPROM_CFG_DIR_OFFSET)
+#define EEPROM_CFG_DIR_SIZE (sizeof(EEPROM_CFG_DIR))	/* 184 bytes, ends at 6092 */
+#define EEPROM_CFG_DIR_MAGIC 0x52494443	/* "CDIR" */
+
+/**
+ * Directory entry of one scan config record
+ */
+typedef struct _eepromCfgDirEntry
+{
+	uint16_t	offset;			/**< bytes from EEPROM_SCAN_CFG_ADDRESS         */
+	uint16_t	size;			/**< bytes, a multiple of 4; 0 = no record      */
+	uint16_t	config_id;		/**< scanConfigIndex of the record              */
+	uint16_t	crc;			/**< low 16 bits of the CRC-32 of the record    */
+} EEPROM_CFG_DIR_ENTRY;
+
+/**
+ * Update of one directory entry, written before the entry itself and
+ * replayed when the directory is next loaded if the entry was not
+ */
+typedef struct _eepromCfgDirJournal
+{
+	uint16_t	seq;			/**< directory seq once the update is applied   */
+	uint8_t		index;			/**< entry updated                              */
+	uint8_t		num_records;	/**< number of records after the update         */
+	EEPROM_CFG_DIR_ENTRY entry;
+	uint32_t	crc;			/**< CRC-32 of the fields above                 */
+} EEPROM_CFG_DIR_JOURNAL;
+
+typedef struct _eepromCfgDir
+{
+	uint32_t	magic;			/**< EEPROM_CFG_DIR_MAGIC                       */
+	uint16_t	seq;			/**< updates applied; shares a word with        */
+	uint8_t		num_records;	/**< num_records so both change in one write    */
+	uint8_t		reserved;
+	EEPROM_CFG_DIR_ENTRY	entry[EEPROM_MAX_SCAN_CFG_STORAGE];
+	EEPROM_CFG_DIR_JOURNAL	journal;
+} EEPROM_CFG_DIR;
+
+/* Counter log. The running counters are appended to a ring of one word
+ * records instead of being rewritten in one place; the record with the
+ * highest seq holds the current value of its counter. Before the oldest
+ * record is overwritten, the last record of any counter is copied to the
+ * head of the log, so every counter keeps one record. */
+#define EEPROM_COUNTER_LOG_OFFSET (EEPROM_CFG_DIR_OFFSET + EEPROM_CFG_DIR_SIZE)
+#define EEPROM_COUNTER_LOG_ADDR (EEPROM_START_ADDR + EEPROM_COUNTER_LOG_OFFSET)
+#define EEPROM_COUNTER_LOG_SLOTS 12
+#define EEPROM_COUNTER_LOG_SIZE (EEPROM_COUNTER_LOG_SLOTS * 4)	/* ends at 6140 */
+
+/* Progress of a scan config record being moved down onto part of itself
+ * while the records are compacted. The directory journal holds the record's
+ * new entry; this word gives where it came from and how many pieces of
+ * (old offset - new offset) bytes have been copied, so a move cut short by
+ * a power loss is finished when the directory is next loaded. 0 when no
+ * move is under way. */
+#define EEPROM_CFG_MOVE_OFFSET (EEPROM_COUNTER_LOG_OFFSET + EEPROM_COUNTER_LOG_SIZE)
+#define EEPROM_CFG_MOVE_ADDR (EEPROM_START_ADDR + EEPROM_CFG_MOVE_OFFSET)
+#define EEPROM_CFG_MOVE_SIZE 4	/* ends at 6144 */
+
+/* Move word: bits 31:16 seq of the journal that completes the move, 15:6 old
+ * offset / 4, 5:0 pieces copied */
+#define EEPROM_CFG_MOVE(seq, from, done) (((uint32_t)(seq) << 16) | \
+		((((uint32_t)(from) / 4) & 0x3FF) << 6) | ((done) & 0x3F))
+#define EEPROM_CFG_MOVE_SEQ(word) ((word) >> 16)
+#define EEPROM_CFG_MOVE_FROM(word) ((((word) >> 6) & 0x3FF) * 4)
+#define EEPROM_CFG_MOVE_DONE(word) ((word) & 0x3F)
+
+/* Counters kept in the log */
+#define EEPROM_COUNTER_SCAN_INDEX	0
+#define EEPROM_COUNTER_CONFIG_INDEX	1
+#define EEPROM_NUM_COUNTERS			2
+
+/* Values of the scan config index counter handed out per record written.
+ * The record holds the end of the batch, so a counter lost with the power
+ * skips ahead instead of handing out an ID again; the exact value is
+ * written when the counters are flushed. The scan index counter goes up
+ * once per session and is written through. */
+#define EEPROM_CONFIG_COUNTER_BATCH	8
+
+/* Record in the counter log: bits 31:30 counter + 1, 29:24 check over the
+ * other bits, 23:16 seq, 15:0 value. Both counters are 16-bit IDs. */
+#define EEPROM_COUNTER_RECORD(counter, seq, value) ((((uint32_t)(counter) + 1) << 30) | \
+		(((uint32_t)(seq) & 0xFF) << 16) | ((value) & 0xFFFF))
+#define EEPROM_COUNTER_RECORD_COUNTER(rec) (((rec) >> 30) - 1)
+#define EEPROM_COUNTER_RECORD_CHECK(rec) (((rec) >> 24) & 0x3F)
+#define EEPROM_COUNTER_RECORD_SEQ(rec) (((rec) >> 16) & 0xFF)
+#define EEPROM_COUNTER_RECORD_VALUE(rec) ((rec) & 0xFFFF)
+
 /* Function declarations */
 
 #ifdef __cplusplus
@@ -106,9 +202,11 @@ int32_t Nano_eeprom_SetActiveConfig(uint32_t index);
 uint8_t Nano_eeprom_GetScanConfigIndexUsingConfigID(uint16_t id);
 int16_t Nano_eeprom_GetScanConfigIDUsingIndex(uint8_t index);
 int Nano_eeprom_EraseAllConfigRecords(void);
+int Nano_eeprom_ClearConfigDir(void);
 void Nano_eeprom_GatherScanCfgIDs(void);
 int Nano_eeprom_SetScanIndexCounter(uint16_t* scanIndexCounter);
 int Nano_eeprom_GetScanIndexCounter(uint16_t* scanIndexCounter);
+int Nano_eeprom_FlushCounters(void);
 
 int Nano_eeprom_SavecalibCoeffs(calibCoeffs* calib);
 int Nano_eeprom_GetcalibCoeffs(calibCoeffs* calib);
@@ -47,6 +47,30 @@ typedef struct PhotoDetectorValues
     uint32_t blue;
 }PhotoDetVal;
 
+typedef struct PGAPredictionStats
+{
+    uint32_t num_predicted;     /* scans run with a predicted gain        */
+    uint32_t num_prescans;      /* scans that needed the PGA pre-scan     */
+    uint32_t num_saturated;     /* predicted scans that ended up clipping */
+    uint32_t saved_ms;          /* pre-scan time skipped in total         */
+}PGAPredictStats;
+
+typedef enum _scanPhase
+{
+    SCAN_PHASE_SETUP,           /* DLPC150/lamp on and configure, or warm scan overhead */
+    SCAN_PHASE_PGA,             /* PGA gain pre-scan                                    */
+    SCAN_PHASE_PATTERNS,        /* pattern display and ADC capture of all repeats       */
+    SCAN_PHASE_TEARDOWN,        /* power down, sensor reading and data processing       */
+    SCAN_PHASE_SD_WRITE,        /* serialize and queue for the SD writer, incl. stalls  */
+    SCAN_NUM_PHASES
+}SCAN_PHASE;
+
+typedef struct ScanTimeEstimate
+{
+    uint32_t total_ms;
+    uint32_t phase_ms[SCAN_NUM_PHASES];
+}ScanTimeEstimate;
+
 typedef enum _patternSource
 {
 	USE_SPL_PATTERNS_FROM_SPLASH,
@@ -78,7 +102,11 @@ extern "C" {
 void Scan_SetNumPatternsToScan(int numPatterns);
 int Scan_SetNumRepeats(uint16_t num);
 uScanData *GetScanDataPtr(void);
+int Scan_SerializeData(void *pBuf, uint32_t buf_size, uint32_t *pLength);
 int Scan_SetPatternSource(int src);
+int Scan_SetContinuousMode(uint16_t num_scans, bool store_in_sd);
+void Scan_StopContinuousMode(void);
+bool Scan_IsContinuousMode(void);
 void Scan_DLPCOnOffControl(bool enable);
 int Scan_StoreToSDcard(void);
 int Scan_SetSubImage(uint16_t startY, uint16_t height);
@@ -88,7 +116,9 @@ int Scan_SetActiveConfig(uint8_t index);
 int Scan_SetCalibPatterns(CALIB_SCAN_TYPES calib_type);
 int Scan_SetConfig(uScanConfig *pCfg);
 uint32_t Scan_ComputeScanTime();
+void Scan_GetScanTimeEstimate(ScanTimeEstimate *pEst);
 int Scan_SNRDataCapture(void);
+int Scan_SNRSetWindow(int index, uint16_t bin_size, uint16_t sample_step);
 int Scan_HadSNRDataCapture(void);
 int Scan_GetSectionNumADCSamplesPerPattern(int section_num, uint16_t *p_num_samples);
 int16_t Scan_GetSectionNumPatterns(int section_num);
@@ -96,6 +126,7 @@ int Scan_GetVSyncPatterns(int index);
 int Scan_GetFrameSyncs(int index);
 uint32_t Scan_GetCurSectionExpTime(int section_num);
 int Scan_SetFixedPGA(bool isFixed,uint8_t pgaVal);
+void Scan_GetPGAPredictStats(PGAPredictStats *pStats);
 int Scan_dlpc150_configure(void);
 #ifdef __cplusplus
 }
@@ -0,0 +1,66 @@
+/*
+ *
+ * Bounded ring used to stream partial scan results to the host while the
+ * scan is still in progress
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef SCANSTREAM_H_
+#define SCANSTREAM_H_
+
+#include "dlpspec_scan.h"
+
+/* Number of finished repeats that can be buffered before the oldest
+ * unread one is dropped. Each slot holds a full ADC_DATA_LEN record */
+#define SCAN_STREAM_NUM_SLOTS		4
+
+/* Repeat number used for the averaged result queued at the end of a scan */
+#define SCAN_STREAM_REPEAT_AVERAGE	0xFFFF
+
+/* Size of the header sent ahead of the samples in every stream packet */
+#define SCAN_STREAM_PKT_HEADER_SIZE	16
+
+/**
+ * Status byte at the start of each stream packet
+ */
+typedef enum _scanStreamStatus
+{
+	SCAN_STREAM_STATUS_EMPTY,		/**< nothing buffered, scan still running  */
+	SCAN_STREAM_STATUS_DATA,		/**< packet carries samples                */
+	SCAN_STREAM_STATUS_DONE,		/**< nothing buffered and scan has ended   */
+	SCAN_STREAM_STATUS_DISABLED		/**< streaming is not enabled              */
+} SCAN_STREAM_STATUS;
+
+/**
+ * One finished repeat as published by the scan task
+ */
+typedef struct _scanStreamSlot
+{
+	uint8_t		scan_id;			/**< increments with every streamed scan   */
+	uint16_t	repeat;				/**< repeat number this record belongs to  */
+	uint16_t	num_repeats;		/**< total repeats in the scan             */
+	uint16_t	length;				/**< number of valid entries in adc_data   */
+	int32_t		adc_data[ADC_DATA_LEN];
+} SCAN_STREAM_SLOT;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ScanStream_Enable(bool enable);
+bool ScanStream_IsEnabled(void);
+void ScanStream_Begin(uint16_t num_repeats);
+int ScanStream_Publish(uint16_t repeat, const long long *p_adc_data, uint16_t length,
+		const uint16_t *p_map);
+int ScanStream_PublishAverage(const int32_t *p_adc_data, uint16_t length);
+int ScanStream_ReadPacket(uint8_t *pBuf, uint32_t max_size, bool scan_done);
+uint16_t ScanStream_GetNumDropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCANSTREAM_H_ */
@@ -0,0 +1,95 @@
+/*
+ *
+ * Binary trace of scan phases and scan related interrupts, timestamped with
+ * the core cycle counter
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef SCANTRACE_H_
+#define SCANTRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef NIRSCAN_HOST_BUILD
+#define NIRSCAN_SCAN_TRACE	/* always traced in host builds, see tools/host */
+#else
+#include "common.h"		/* NIRSCAN_SCAN_TRACE switch */
+#endif
+
+/* Number of events kept; must be a power of 2. Oldest events are overwritten */
+#define SCAN_TRACE_NUM_ENTRIES		512
+
+/* Layout version of the dump returned by ScanTrace_Snapshot() */
+#define SCAN_TRACE_DUMP_VERSION		1
+
+/* Size of the header ahead of the entries in a dump */
+#define SCAN_TRACE_DUMP_HEADER_SIZE	16
+
+/**
+ * Trace point IDs. Values are part of the dump format; only append.
+ */
+typedef enum _scanTraceEvent
+{
+	SCAN_TRACE_SCAN_START = 1,			/**< arg = number of repeats          */
+	SCAN_TRACE_SETUP_START,				/**< arg = 1 for general, 0 for calib */
+	SCAN_TRACE_DLPC_ON,
+	SCAN_TRACE_LAMP_ON,
+	SCAN_TRACE_DLPC_CONFIGURED,
+	SCAN_TRACE_PGA_PRESCAN_START,
+	SCAN_TRACE_PGA_SET,					/**< arg = PGA gain                   */
+	SCAN_TRACE_SETUP_END,
+	SCAN_TRACE_RUN_PATTERNS_START,
+	SCAN_TRACE_FRAMES_PROPAGATED,
+	SCAN_TRACE_RUN_PATTERNS_END,		/**< arg = ADC values captured        */
+	SCAN_TRACE_REPEAT_DONE,				/**< arg = repeat number              */
+	SCAN_TRACE_PROCESSING_DONE,
+	SCAN_TRACE_SCAN_END,
+	SCAN_TRACE_DLPC_CONFIGURE_START,
+	SCAN_TRACE_ISR_FRAME = 0x40,		/**< arg = vsync count                */
+	SCAN_TRACE_ISR_PATTERN,				/**< arg = pattern trigger count      */
+	SCAN_TRACE_ISR_DRDY,				/**< arg = ADC data index             */
+	SCAN_TRACE_ISR_DISPLAY				/**< arg = next frame buffer index     */
+} SCAN_TRACE_EVENT;
+
+/* Event mask bits; ScanTrace_SetMask() turns groups of trace points on/off */
+#define SCAN_TRACE_MASK_PHASES		0x01
+#define SCAN_TRACE_MASK_ISR_FRAME	0x02
+#define SCAN_TRACE_MASK_ISR_PATTERN	0x04
+#define SCAN_TRACE_MASK_ISR_DRDY	0x08
+#define SCAN_TRACE_MASK_ISR_DISPLAY	0x10
+#define SCAN_TRACE_MASK_ALL			0x1F
+
+/**
+ * One trace record
+ */
+typedef struct _scanTraceEntry
+{
+	uint32_t	cycles;			/**< cycle counter when the event was logged */
+	uint16_t	event;			/**< SCAN_TRACE_EVENT                        */
+	uint16_t	arg;
+} SCAN_TRACE_ENTRY;
+
+#ifdef NIRSCAN_SCAN_TRACE
+#define SCAN_TRACE(mask, event, arg)	ScanTrace_Log((mask), (event), (arg))
+#else
+#define SCAN_TRACE(mask, event, arg)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ScanTrace_Init(void);
+void ScanTrace_SetMask(uint32_t mask);
+void ScanTrace_Clear(void);
+void ScanTrace_Log(uint32_t mask, uint16_t event, uint16_t arg);
+uint32_t ScanTrace_Snapshot(uint8_t *pBuf, uint32_t max_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCANTRACE_H_ */
@@ -0,0 +1,59 @@
+/*
+ *
+ * Background writer that stores serialized scans to the SD card
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef SDWRITER_H_
+#define SDWRITER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* SDWriter_Task() runs as sdWriter in the .cfg, with a 2048 byte stack at
+ * priority 5 */
+
+/* Serialized scans that can be waiting for the SD card; at least 2 so that the
+ * next scan can be taken while the previous one is being written */
+#define SD_WRITER_NUM_SLOTS				2
+
+/**
+ * Queue and write statistics. Latency is from SDWriter_Submit() until the file
+ * is closed; write time only covers the FatFs calls.
+ */
+typedef struct _sdWriterStats
+{
+	uint32_t	num_queued;
+	uint32_t	num_written;
+	uint32_t	num_failed;
+	uint32_t	num_stalls;			/**< acquires that waited for a free slot */
+	uint32_t	stall_ms_max;
+	uint32_t	depth;				/**< scans queued or being written        */
+	uint32_t	depth_max;
+	uint32_t	write_ms_last;
+	uint32_t	write_ms_max;
+	uint32_t	latency_ms_last;
+	uint32_t	latency_ms_max;
+} SD_WRITER_STATS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int SDWriter_Init(void);
+void SDWriter_Task(void);
+uint8_t *SDWriter_AcquireSlot(uint32_t *pSize);
+void SDWriter_Submit(uint32_t length, uint32_t index, uint16_t config_id);
+void SDWriter_Flush(void);
+uint8_t *SDWriter_Reserve(uint32_t *pSize);
+void SDWriter_Release(void);
+void SDWriter_GetStats(SD_WRITER_STATS *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SDWRITER_H_ */
@@ -0,0 +1,85 @@
+/*
+ *
+ * Background sampling of the environmental sensors into a snapshot cache
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef SENSORSVC_H_
+#define SENSORSVC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* SensorSvc_Task() runs as sensorSvc in the .cfg, with a 1536 byte stack at
+ * priority 3 */
+
+/* Default sampling periods when idle and while a scan is in progress */
+#define SENSOR_SVC_IDLE_PERIOD_MS		1000
+#define SENSOR_SVC_SCAN_PERIOD_MS		250
+
+/* Oldest environmental reading the scan uses without reading the sensor again */
+#define SENSOR_SVC_SCAN_MAX_AGE_MS		(2 * SENSOR_SVC_SCAN_PERIOD_MS)
+
+/* Number of samples kept in the drift log taken while scanning */
+#define SENSOR_SVC_LOG_LEN				128
+
+/* Sources in a snapshot; also used as mask for SensorSvc_Refresh() */
+#define SENSOR_SNAP_TMP006				0x01
+#define SENSOR_SNAP_HDC1000				0x02
+#define SENSOR_SNAP_BATTERY				0x04
+#define SENSOR_SNAP_LAMP_PD				0x08
+#define SENSOR_SNAP_ENV					(SENSOR_SNAP_TMP006 | SENSOR_SNAP_HDC1000)
+
+/**
+ * Latest reading of every sensor. Each source carries the Clock tick (ms) it
+ * was sampled at; a tick of 0 means the source has not been read yet.
+ */
+typedef struct _sensorSnapshot
+{
+	uint32_t	seq;				/**< increments with every publish           */
+	float		ambient_temp;		/**< TMP006 die temperature in degC          */
+	float		detector_temp;		/**< TMP006 object temperature in degC       */
+	uint32_t	tmp006_tick;
+	float		board_temp;			/**< HDC1000 temperature in degC             */
+	float		humidity;			/**< HDC1000 relative humidity in %          */
+	uint32_t	hdc1000_tick;
+	float		battery_volt;
+	uint32_t	battery_tick;
+	uint32_t	lamp_pd;			/**< lamp photodiode, from the last scan     */
+	uint32_t	lamp_pd_tick;
+} SENSOR_SNAPSHOT;
+
+/**
+ * Drift log record; temperatures and humidity in 1/100 units
+ */
+typedef struct _sensorLogEntry
+{
+	uint32_t	tick;
+	int16_t		detector_temp;
+	int16_t		ambient_temp;
+	int16_t		board_temp;
+	uint16_t	humidity;
+} SENSOR_LOG_ENTRY;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int SensorSvc_Init(void);
+void SensorSvc_Task(void);
+int SensorSvc_Refresh(uint32_t mask);
+void SensorSvc_GetSnapshot(SENSOR_SNAPSHOT *pSnap);
+int SensorSvc_GetFresh(SENSOR_SNAPSHOT *pSnap, uint32_t max_age_ms);
+void SensorSvc_PublishLampPD(uint32_t lamp_pd);
+void SensorSvc_SetScanActive(bool active);
+int SensorSvc_SetPeriods(uint16_t idle_period_ms, uint16_t scan_period_ms);
+uint32_t SensorSvc_ReadLog(uint8_t *pBuf, uint32_t max_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSORSVC_H_ */
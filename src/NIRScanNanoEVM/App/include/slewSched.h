@@ -0,0 +1,61 @@
+/*
+ *
+ * Vsync and frame packing of slew scan patterns
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef SLEWSCHED_H_
+#define SLEWSCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dlpspec_scan.h"
+
+/* Active part of one vsync period available for pattern exposures */
+#define VSYNC_ACTIVE_PATTERN_PERIOD 15240
+
+/**
+ * Pattern count and exposure of one slew scan section
+ */
+typedef struct _slewSchedSection
+{
+	uint16_t	num_patterns;		/**< patterns excluding inserted black patterns */
+	uint32_t	exp_time_us;		/**< exposure time of each pattern             */
+} SLEW_SCHED_SECTION;
+
+/**
+ * Result of packing the sections in a given order. The two arrays are owned by
+ * the caller and may be NULL when only the counts are of interest.
+ */
+typedef struct _slewSchedPlan
+{
+	int			*pPatternsPerVsync;	/**< patterns in each vsync; 0 = held over   */
+	int			maxVsyncs;
+	int			numVsyncs;
+	int			*pFrameSyncs;		/**< vsyncs each frame is displayed for      */
+	int			maxFrames;
+	int			numFrames;
+	int			totalFrames;		/**< sum of pFrameSyncs = frames per scan    */
+	uint16_t	section_num_positions[SLEW_SCAN_MAX_SECTIONS];	/**< patterns incl. black, in run order */
+	bool		overflow;
+} SLEW_SCHED_PLAN;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int SlewSched_Pack(const SLEW_SCHED_SECTION *pSect, const uint8_t *pOrder,
+		int num_sections, SLEW_SCHED_PLAN *pPlan);
+int SlewSched_FindBestOrder(const SLEW_SCHED_SECTION *pSect, int num_sections,
+		int max_vsyncs, int max_frames, uint8_t *pOrder);
+int SlewSched_BuildAdcMap(const SLEW_SCHED_SECTION *pSect, const uint8_t *pOrder,
+		int num_sections, uint16_t *pMap, int map_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SLEWSCHED_H_ */
@@ -0,0 +1,69 @@
+/*
+ *
+ * Streaming SNR statistics of repeated scans
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef SNRSTATS_H_
+#define SNRSTATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "NNOSNRDefs.h"
+
+/* Number of integration windows SNR is computed for in one SNR scan */
+#define SNR_STATS_NUM_WINDOWS	3
+
+/**
+ * Integration window. Consecutive repeats are grouped into bins of bin_size
+ * repeats and every sample_step-th repeat of a bin is averaged into the bin
+ * value.
+ */
+typedef struct _snrStatsWindow
+{
+	uint16_t	bin_size;
+	uint16_t	sample_step;
+} SNR_STATS_WINDOW;
+
+/**
+ * Running mean and sum of squared deviations (Welford)
+ */
+typedef struct _snrWelford
+{
+	uint32_t	n;
+	float		mean;
+	float		m2;
+} SNR_WELFORD;
+
+/**
+ * Accumulator for one integration window. Memory depends only on the number
+ * of patterns, not on the number of repeats.
+ */
+typedef struct _snrStatsAcc
+{
+	SNR_STATS_WINDOW	win;
+	uint16_t			bin_pos;					/**< repeats seen in current bin   */
+	uint16_t			bin_count;					/**< repeats summed in current bin */
+	float				bin_sum[SNR_PATTERNS];
+	float				prev_bin[SNR_PATTERNS];
+	SNR_WELFORD			value[SNR_PATTERNS];		/**< statistics of bin values      */
+	SNR_WELFORD			diff[SNR_PATTERNS];			/**< of consecutive bin deltas     */
+} SNR_STATS_ACC;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int SnrStats_Init(SNR_STATS_ACC *pAcc, const SNR_STATS_WINDOW *pWin);
+void SnrStats_AddRepeat(SNR_STATS_ACC *pAcc, const long long *p_adc_data, int num_patterns,
+		const uint16_t *p_map);
+void SnrStats_GetSNR(const SNR_STATS_ACC *pAcc, float *pResult);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SNRSTATS_H_ */
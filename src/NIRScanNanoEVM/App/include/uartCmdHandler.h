@@ -22,13 +22,15 @@ extern "C" {
 /*
  * Time between two bytes of a UART command in microseconds
  *
- * TIVA would timeout if subsequent packets aren't received within this time period
- * flush all recieved packets and send a Nack back to sender
+ * TIVA would timeout if subsequent bytes aren't received within this time period
+ * drop the partial frame and send a Nack back to sender
  */
 #define MAX_TIME_BET_DATA_PACKETS_US	1000
 
 void uartCmdHandlerTask();
 int32_t cmdRecvUART(void *msgData, int32_t dataLen);
+void cmdIdleUART(void);
+void cmdTimeoutUART(void);
 
 #ifdef __cplusplus
 }
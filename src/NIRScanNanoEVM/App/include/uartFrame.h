@@ -0,0 +1,92 @@
+/*
+ *
+ * Framing of commands on the UART (see NNOUARTDefs.h). Reassembles a frame
+ * from bytes in whatever chunks the driver hands them over and wraps a
+ * response. No driver or RTOS dependencies, so a host build can run it on a
+ * pty pair standing in for the UART.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef UARTFRAME_H_
+#define UARTFRAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "NNOUARTDefs.h"
+
+/**
+ * Framing of a command, from its first bytes; the response goes back the
+ * same way
+ */
+typedef enum
+{
+	UART_FRAME_FORMAT_CRC,			/**< magic, length and CRC-32             */
+	UART_FRAME_FORMAT_LEGACY		/**< ABCD, checksum, message and DCBA     */
+} UART_FRAME_FORMAT;
+
+/**
+ * Receiver state
+ */
+typedef enum
+{
+	UART_FRAME_HUNT,				/**< looking for the magic                */
+	UART_FRAME_HEADER,				/**< rest of the header                   */
+	UART_FRAME_PAYLOAD,				/**< payload and CRC                      */
+	UART_FRAME_DONE,				/**< good frame held until released       */
+	UART_FRAME_ERROR,				/**< bad frame held until released        */
+	UART_FRAME_SKIP					/**< dropping bytes until the line idles  */
+} UART_FRAME_STATE;
+
+/**
+ * Counts since UartFrame_RxInit()
+ */
+typedef struct _uartFrameStats
+{
+	uint32_t	num_frames;
+	uint32_t	num_crc_errors;
+	uint32_t	num_length_errors;
+	uint32_t	num_incomplete;		/**< frames cut off by a gap              */
+	uint32_t	num_dropped;		/**< bytes outside any frame              */
+} UART_FRAME_STATS;
+
+/**
+ * Frame being received; filled in by UartFrame_RxInit()
+ */
+typedef struct _uartFrameRx
+{
+	uint8_t				*pDst;
+	uint32_t			maxLength;
+	UART_FRAME_STATE	state;
+	UART_FRAME_FORMAT	format;		/**< framing of the frame last started    */
+	bool				sizeKnown;	/**< legacy: message head received        */
+	int32_t				error;		/**< UART_INPUT_PKT_* code of a bad frame */
+	bool				lineIdle;	/**< no bytes since the line last idled   */
+	bool				heldDrop;	/**< bytes dropped while a frame was held */
+	uint32_t			hdrBytes;	/**< header bytes received so far         */
+	uint32_t			length;		/**< payload bytes, from the header       */
+	uint32_t			received;	/**< payload and CRC bytes so far         */
+	uint32_t			crc;		/**< running CRC or checksum of payload   */
+	uint8_t				header[UART_FRAME_HEADER_SIZE];
+	uint8_t				trailer[UART_FRAME_CRC_SIZE];
+	UART_FRAME_STATS	stats;
+} UART_FRAME_RX;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void UartFrame_RxInit(UART_FRAME_RX *pRx, void *pDst, uint32_t maxLength);
+bool UartFrame_RxBytes(UART_FRAME_RX *pRx, const void *pData, uint32_t length);
+void UartFrame_RxIdle(UART_FRAME_RX *pRx);
+bool UartFrame_RxTimeout(UART_FRAME_RX *pRx);
+void UartFrame_RxRelease(UART_FRAME_RX *pRx);
+uint32_t UartFrame_Wrap(uint8_t *pFrame, uint32_t length, UART_FRAME_FORMAT format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UARTFRAME_H_ */
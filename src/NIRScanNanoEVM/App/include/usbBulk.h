@@ -0,0 +1,48 @@
+/*
+ *
+ * Transfers of large files over the USB vendor bulk interface
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef USBBULK_H_
+#define USBBULK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "NNOUSBBulkDefs.h"
+
+/**
+ * State of the bulk interface and of the last transfer
+ */
+typedef struct _usbBulkStatus
+{
+	USB_BULK_STATE	state;
+	USB_BULK_ERROR	error;
+	uint16_t		tag;			/**< of the last transfer                 */
+	uint32_t		done;			/**< payload bytes transferred so far     */
+	uint32_t		total;			/**< payload bytes; 0 until a frame header
+									     has been received                    */
+} USB_BULK_STATUS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void UsbBulk_Connected(void);
+void UsbBulk_Disconnected(void);
+void UsbBulk_RxAvailable(void);
+void UsbBulk_TxComplete(void);
+int UsbBulk_StartSend(uint16_t tag, const void *pData, uint32_t length);
+int UsbBulk_StartReceive(uint16_t tag, void *pDst, uint32_t maxLength);
+void UsbBulk_Abort(void);
+bool UsbBulk_IsBusy(void);
+void UsbBulk_GetStatus(USB_BULK_STATUS *pStatus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USBBULK_H_ */
@@ -0,0 +1,68 @@
+/*
+ *
+ * Framing of USB bulk transfers. Splits a frame into packets for the bulk IN
+ * endpoint and reassembles one from bulk OUT packets. No driver or RTOS
+ * dependencies, so a host build can run a sender against a receiver as a
+ * loopback.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef USBBULKPROTO_H_
+#define USBBULKPROTO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "NNOUSBBulkDefs.h"
+
+/**
+ * Frame being sent; filled in by UsbBulkProto_TxStart()
+ */
+typedef struct _usbBulkTx
+{
+	const uint8_t	*pData;
+	uint32_t		length;			/**< payload bytes                        */
+	uint32_t		pos;			/**< header and payload bytes sent        */
+	uint16_t		maxPkt;
+	bool			zlpPending;		/**< frame ended on a packet boundary     */
+	bool			done;
+	uint8_t			header[USB_BULK_FRAME_HEADER_SIZE];
+} USB_BULK_TX;
+
+/**
+ * Frame being received; filled in by UsbBulkProto_RxStart()
+ */
+typedef struct _usbBulkRx
+{
+	uint8_t			*pDst;
+	uint32_t		maxLength;
+	uint16_t		tag;
+	uint32_t		hdrBytes;		/**< header bytes received so far         */
+	uint32_t		length;			/**< payload bytes, from the header       */
+	uint32_t		received;		/**< payload bytes received so far        */
+	uint32_t		crc;			/**< running CRC of the payload           */
+	USB_BULK_STATE	state;			/**< RECEIVING, DONE or ERROR             */
+	USB_BULK_ERROR	error;
+	uint8_t			header[USB_BULK_FRAME_HEADER_SIZE];
+} USB_BULK_RX;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t UsbBulkProto_Crc(uint32_t crc, const void *pData, uint32_t length);
+void UsbBulkProto_TxStart(USB_BULK_TX *pTx, uint16_t tag, const void *pData,
+		uint32_t length, uint16_t maxPkt);
+bool UsbBulkProto_TxNext(USB_BULK_TX *pTx, uint8_t *pPkt, uint32_t *pLength);
+void UsbBulkProto_RxStart(USB_BULK_RX *pRx, uint16_t tag, void *pDst,
+		uint32_t maxLength);
+USB_BULK_STATE UsbBulkProto_RxPacket(USB_BULK_RX *pRx, const uint8_t *pPkt,
+		uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USBBULKPROTO_H_ */
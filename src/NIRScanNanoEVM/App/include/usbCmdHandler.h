@@ -17,6 +17,14 @@ extern "C" {
 #define HID_MAX_PKT_SIZE    64
 #define CMD_PACKETS_TIMEOUT 1000
 
+/* Largest transfer handed to the HID driver when streaming data with
+ * cmdStreamUSB(); a multiple of HID_MAX_PKT_SIZE below 64KB */
+#define USB_STREAM_CHUNK_SIZE	(32 * 1024)
+
+/* usbCmdWorkerTask() (usbCmdWorker in the .cfg) runs queued commands below
+ * the receive task (usbCmdHandler in the .cfg) so that status queries are
+ * answered while a slow command is in progress */
+
 /****************************************************/
 /* command byte 1 definitions.    */
 /****************************************************/
@@ -86,6 +94,9 @@ bool cmdIncWrite( int32_t nBytes );   /* increment write pointer by 'n' bytes */
 void usbConn();
 void usbDisc();
 int32_t cmdRecv(void *msgData, int32_t dataLen);
+bool cmdStreamUSB(const void *pData, uint32_t nBytes);
+int usbCmdWorkerInit(void);
+void usbCmdWorkerTask(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,61 @@
+/*
+ *
+ * Queue of USB commands waiting for the command worker task. Decides which
+ * commands the receive task answers on the spot and keeps the rest in order.
+ * No driver or RTOS dependencies, so a host build can drive it from a
+ * simulation.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+*/
+
+#ifndef USBCMDQUEUE_H_
+#define USBCMDQUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "NNOCommandDefs.h"
+
+/* Commands that can be waiting for or running on the worker; a command that
+ * arrives when all are in use is answered busy */
+#define USB_CMD_QUEUE_DEPTH			4
+
+/**
+ * What the receive task does with a complete command
+ */
+typedef enum
+{
+	USB_CMD_RUN_NOW,				/**< answer it from the receive task      */
+	USB_CMD_QUEUED,					/**< copied to the queue for the worker   */
+	USB_CMD_QUEUE_FULL				/**< answer busy                          */
+} USB_CMD_DISPOSITION;
+
+/**
+ * Counts since boot
+ */
+typedef struct _usbCmdQueueStats
+{
+	uint32_t	num_immediate;		/**< answered by the receive task         */
+	uint32_t	num_queued;
+	uint32_t	num_busy;			/**< turned away with the queue full      */
+	uint32_t	depth;				/**< commands queued or running           */
+	uint32_t	depth_max;
+} USB_CMD_QUEUE_STATS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void UsbCmdQueue_Init(void);
+uint32_t UsbCmdQueue_Key(const nnoMessageStruct *pMsg);
+USB_CMD_DISPOSITION UsbCmdQueue_Submit(const nnoMessageStruct *pMsg);
+nnoMessageStruct *UsbCmdQueue_Front(void);
+void UsbCmdQueue_Pop(void);
+void UsbCmdQueue_GetStats(USB_CMD_QUEUE_STATS *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USBCMDQUEUE_H_ */
@@ -0,0 +1,282 @@
+/*
+ *
+ * Encoding of the NNO_FILE_INTERPRET_DATA file. The file is never built as a
+ * whole: each read encodes just the bytes asked for from the scan results, so
+ * the host can read it in HID sized pieces without a copy of the file being
+ * kept. Arrays stored in the results in the requested type are copied as a
+ * block; the others are converted element by element.
+ *
+ * Values are stored in the byte order of the target, which is little endian
+ * like the host.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "dlpspec_util.h"
+#include "interpretData.h"
+
+#define INTERPRET_DATA_COEFFS_SIZE	(NUM_PIXEL_NM_COEFFS * sizeof(double))
+#define INTERPRET_DATA_MIN(x, y)	(((x) <= (y)) ? (x) : (y))
+
+static uint32_t InterpretData_WlSize(uint8_t format)
+{
+	switch(format & NNO_INTERPRET_WL_MASK)
+	{
+	case NNO_INTERPRET_WL_DOUBLE:
+		return sizeof(double);
+	case NNO_INTERPRET_WL_FLOAT:
+		return sizeof(float);
+	case NNO_INTERPRET_WL_COEFFS:
+		return sizeof(int16_t);
+	default:
+		return 0;
+	}
+}
+
+static uint32_t InterpretData_IntSize(uint8_t format)
+{
+	switch(format & NNO_INTERPRET_INT_MASK)
+	{
+	case NNO_INTERPRET_INT_INT32:
+		return sizeof(int32_t);
+	case NNO_INTERPRET_INT_FLOAT:
+		return sizeof(float);
+	case NNO_INTERPRET_INT_INT16:
+		return sizeof(int16_t);
+	default:
+		return 0;
+	}
+}
+
+bool InterpretData_Open(INTERPRET_DATA_FILE *pFile, const scanResults *pResults,
+		uint8_t format)
+	/**
+	 * Sets up reading the interpret data file of a scan in one of the layouts
+	 * of NNOCommandDefs.h. The results are read in place and must not change
+	 * until the file has been read.
+	 *
+	 * @param pFile - O - file state
+	 * @param pResults - I - interpreted scan
+	 * @param format - I - NNO_INTERPRET_WL_* | NNO_INTERPRET_INT_* or
+	 *                     INTERPRET_DATA_INTERLEAVED
+	 *
+	 * @return false if the format is unknown or, for COEFFS, a wavelength does
+	 *         not come from a DMD column under the scan's calibration
+	 */
+{
+	uint32_t num = (uint32_t)pResults->length;
+	uint32_t wlSize = InterpretData_WlSize(format);
+	uint32_t intSize = InterpretData_IntSize(format);
+	const double *pCoeffs = pResults->calibration_coeffs.PixelToWavelengthCoeffs;
+	int64_t maxVal = 0;
+	int32_t halfCol;
+	uint32_t i;
+
+	memset(pFile, 0, sizeof(INTERPRET_DATA_FILE));
+	pFile->pResults = pResults;
+	pFile->format = format;
+
+	if(pResults->length < 0)
+		return false;
+
+	if(format == INTERPRET_DATA_INTERLEAVED)
+	{
+		pFile->size = sizeof(int32_t) + num * (sizeof(double) + sizeof(int32_t));
+		return true;
+	}
+
+	if((wlSize == 0) || (intSize == 0))
+		return false;
+
+	pFile->wlOffset = INTERPRET_DATA_HEADER_SIZE;
+	if((format & NNO_INTERPRET_WL_MASK) == NNO_INTERPRET_WL_COEFFS)
+	{
+		for(i = 0; i < num; i++)
+		{
+			if(dlpspec_util_nmToHalfColumn(pResults->wavelength[i], pCoeffs,
+					&halfCol) != DLPSPEC_PASS)
+				return false;
+		}
+		pFile->wlOffset += INTERPRET_DATA_COEFFS_SIZE;
+	}
+	pFile->intOffset = pFile->wlOffset + num * wlSize;
+	pFile->size = pFile->intOffset + num * intSize;
+
+	if((format & NNO_INTERPRET_INT_MASK) == NNO_INTERPRET_INT_INT16)
+	{
+		/* Smallest shift that brings every intensity, rounded, into range */
+		for(i = 0; i < num; i++)
+		{
+			if((int64_t)pResults->intensity[i] > maxVal)
+				maxVal = pResults->intensity[i];
+			if(-(int64_t)pResults->intensity[i] > maxVal + 1)
+				maxVal = -(int64_t)pResults->intensity[i] - 1;
+		}
+		while(((maxVal + ((int64_t)1 << pFile->shift >> 1)) >> pFile->shift) > INT16_MAX)
+			pFile->shift++;
+	}
+
+	return true;
+}
+
+static void InterpretData_Header(const INTERPRET_DATA_FILE *pFile, uint8_t *pHdr)
+{
+	int32_t num = pFile->pResults->length;
+
+	memcpy(&pHdr[0], &num, sizeof(num));
+	pHdr[4] = pFile->format;
+	pHdr[5] = pFile->shift;
+	pHdr[6] = 0;
+	pHdr[7] = 0;
+	memcpy(&pHdr[INTERPRET_DATA_HEADER_SIZE], pFile->pResults->calibration_coeffs.PixelToWavelengthCoeffs,
+			INTERPRET_DATA_COEFFS_SIZE);
+}
+
+static void InterpretData_Wavelength(const INTERPRET_DATA_FILE *pFile, uint32_t i, uint8_t *pElem)
+{
+	const scanResults *pResults = pFile->pResults;
+	float valFloat;
+	int32_t halfCol = 0;
+	int16_t valShort;
+
+	switch(pFile->format & NNO_INTERPRET_WL_MASK)
+	{
+	case NNO_INTERPRET_WL_FLOAT:
+		valFloat = (float)pResults->wavelength[i];
+		memcpy(pElem, &valFloat, sizeof(valFloat));
+		break;
+	case NNO_INTERPRET_WL_COEFFS:
+		/* Checked by InterpretData_Open() */
+		dlpspec_util_nmToHalfColumn(pResults->wavelength[i],
+				pResults->calibration_coeffs.PixelToWavelengthCoeffs, &halfCol);
+		valShort = (int16_t)halfCol;
+		memcpy(pElem, &valShort, sizeof(valShort));
+		break;
+	default:
+		memcpy(pElem, &pResults->wavelength[i], sizeof(double));
+		break;
+	}
+}
+
+static void InterpretData_Intensity(const INTERPRET_DATA_FILE *pFile, uint32_t i, uint8_t *pElem)
+{
+	int32_t val = (int32_t)pFile->pResults->intensity[i];
+	float valFloat;
+	int16_t valShort;
+
+	switch(pFile->format & NNO_INTERPRET_INT_MASK)
+	{
+	case NNO_INTERPRET_INT_FLOAT:
+		valFloat = (float)val;
+		memcpy(pElem, &valFloat, sizeof(valFloat));
+		break;
+	case NNO_INTERPRET_INT_INT16:
+		valShort = (int16_t)(((int64_t)val + ((int64_t)1 << pFile->shift >> 1)) >> pFile->shift);
+		memcpy(pElem, &valShort, sizeof(valShort));
+		break;
+	default:
+		memcpy(pElem, &val, sizeof(val));
+		break;
+	}
+}
+
+uint32_t InterpretData_Read(const INTERPRET_DATA_FILE *pFile, uint32_t offset,
+		void *pDst, uint32_t length)
+	/**
+	 * Encodes part of the file.
+	 *
+	 * @param pFile - I - file set up by InterpretData_Open()
+	 * @param offset - I - first byte of the file to return
+	 * @param pDst - O - buffer for the bytes
+	 * @param length - I - bytes wanted
+	 *
+	 * @return bytes written to pDst; less than length at the end of the file
+	 */
+{
+	const scanResults *pResults = pFile->pResults;
+	uint8_t *pOut = (uint8_t *)pDst;
+	uint8_t elem[INTERPRET_DATA_HEADER_SIZE + INTERPRET_DATA_COEFFS_SIZE];
+	uint32_t start;
+	uint32_t elemSize;
+	uint32_t idx;
+	uint32_t skip;
+	uint32_t chunk;
+	uint32_t done = 0;
+
+	if(offset >= pFile->size)
+		return 0;
+	if(length > pFile->size - offset)
+		length = pFile->size - offset;
+
+	while(done < length)
+	{
+		if(pFile->format == INTERPRET_DATA_INTERLEAVED)
+		{
+			if(offset < sizeof(int32_t))
+			{
+				memcpy(elem, &pResults->length, sizeof(int32_t));
+				start = 0;
+				elemSize = sizeof(int32_t);
+			}
+			else
+			{
+				elemSize = sizeof(double) + sizeof(int32_t);
+				idx = (offset - sizeof(int32_t)) / elemSize;
+				start = sizeof(int32_t) + idx * elemSize;
+				memcpy(&elem[0], &pResults->wavelength[idx], sizeof(double));
+				memcpy(&elem[sizeof(double)], &pResults->intensity[idx], sizeof(int32_t));
+			}
+		}
+		else if(offset < pFile->wlOffset)
+		{
+			InterpretData_Header(pFile, elem);
+			start = 0;
+			elemSize = pFile->wlOffset;
+		}
+		else if(offset < pFile->intOffset)
+		{
+			elemSize = InterpretData_WlSize(pFile->format);
+			idx = (offset - pFile->wlOffset) / elemSize;
+			if((pFile->format & NNO_INTERPRET_WL_MASK) == NNO_INTERPRET_WL_DOUBLE)
+			{
+				/* Stored that way; copy the rest of the array in one go */
+				chunk = INTERPRET_DATA_MIN(pFile->intOffset - offset, length - done);
+				memcpy(&pOut[done], (const uint8_t *)pResults->wavelength + (offset - pFile->wlOffset), chunk);
+				done += chunk;
+				offset += chunk;
+				continue;
+			}
+			start = pFile->wlOffset + idx * elemSize;
+			InterpretData_Wavelength(pFile, idx, elem);
+		}
+		else
+		{
+			elemSize = InterpretData_IntSize(pFile->format);
+			idx = (offset - pFile->intOffset) / elemSize;
+			if(((pFile->format & NNO_INTERPRET_INT_MASK) == NNO_INTERPRET_INT_INT32) &&
+					(sizeof(pResults->intensity[0]) == sizeof(int32_t)))
+			{
+				chunk = INTERPRET_DATA_MIN(pFile->size - offset, length - done);
+				memcpy(&pOut[done], (const uint8_t *)pResults->intensity + (offset - pFile->intOffset), chunk);
+				done += chunk;
+				offset += chunk;
+				continue;
+			}
+			start = pFile->intOffset + idx * elemSize;
+			InterpretData_Intensity(pFile, idx, elem);
+		}
+
+		skip = offset - start;
+		chunk = INTERPRET_DATA_MIN(elemSize - skip, length - done);
+		memcpy(&pOut[done], &elem[skip], chunk);
+		done += chunk;
+		offset += chunk;
+	}
+
+	return done;
+}
@@ -12,6 +12,7 @@
 #include <string.h>
 #include <inc/tm4c129xnczad.h>
 #include <inc/hw_memmap.h>
+#include <inc/hw_types.h>
 #include <driverlib/pin_map.h>
 #include <driverlib/rom.h>
 #include <driverlib/rom_map.h>
@@ -44,6 +45,11 @@
 #include "led.h"
 #include "usbhandler.h"
 #include "scan.h"
+#include "scanTrace.h"
+#include "binLog.h"
+#include "sensorSvc.h"
+#include "sdWriter.h"
+#include "dlpc150.h"
 #include "nano_eeprom.h"
 #include "dlpspec_version.h"
 #include "nano_timer.h"
@@ -52,6 +58,7 @@
 #include "nnoStatus.h"
 #ifdef ENABLE_UART_COMMAND_INTERFACE
 #include "uartstdio.h"
+#include "uartDma.h"
 #endif
 #ifdef NIRSCAN_INCLUDE_BLE
 #include "BLEMain.h"
@@ -59,6 +66,14 @@
 #endif
 #undef BPP4_MODE
 
+/* Cortex-M4 debug registers for the core cycle counter. binLog.c and
+ * scanTrace.c both timestamp from it, so it is started once here and never
+ * reset */
+#define CORE_DEMCR					0xE000EDFC
+#define CORE_DEMCR_TRCENA			0x01000000
+#define DWT_CTRL					0xE0001000
+#define DWT_CTRL_CYCCNTENA			0x00000001
+
 
 //**********************************************************************************************************
 // Globals
@@ -96,9 +111,11 @@ int main()
 	 Task_Params ble_cmd_handler_params;
 	 Task_Params ble_main_params;
 #endif
-#if defined(ENABLE_UART_COMMAND_INTERFACE) || defined(NIRSCAN_INCLUDE_BLE)
-	 Error_Block eb;
+#ifdef NIRSCAN_BIN_LOG
+	 static uint64_t bin_log_stack[BIN_LOG_TASK_STACK_SIZE / sizeof(uint64_t)];
+	 Task_Params bin_log_params;
 #endif
+	 Error_Block eb;
 	 if(app_signature != NULL); //dummy statement to avoid compiler warning
 
 
@@ -107,6 +124,8 @@ int main()
 
 	 MAP_SysCtlPeripheralClockGating(true);    // Enable peripheral clock gating.
 
+	 HWREG(CORE_DEMCR) |= CORE_DEMCR_TRCENA;
+	 HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
 	 Board_initGeneral();
 	 Board_initGPIO();
 	 Board_initI2C();
@@ -129,7 +148,8 @@ int main()
 	 /*
 	  * Initialize uart interface if required
 	  */
-#if defined(ENABLE_UART_COMMAND_INTERFACE) || (defined(DEBUG_MSGS) && (LOG_PORT == UART_CONSOLE))
+#if defined(ENABLE_UART_COMMAND_INTERFACE) || \
+	((defined(DEBUG_MSGS) || defined(NIRSCAN_BIN_LOG)) && (LOG_PORT == UART_CONSOLE))
 	 uart_interface_init();
 #endif
 
@@ -140,6 +160,10 @@ int main()
 	 IntMasterEnable();
 	 USBHandler_init();
 	 nnoStatus_init();
+	 ScanTrace_Init();
+
+	 if(dlpc150_Init() != PASS)
+		 return FAIL;
 
 	 if(FATSD_Init() != PASS)
 		 DEBUG_PRINT(("FATSD Init failed\n"));
@@ -218,7 +242,7 @@ int main()
 	 uart_TimerParams.period = MAX_TIME_BET_DATA_PACKETS_US;
 	 uart_TimerParams.startMode = Timer_StartMode_USER;
 	 uart_TimerParams.periodType = Timer_PeriodType_MICROSECS;
-	 g_uartTimerHandle = Timer_create(Timer_ANY, uartDataTimeout,
+	 g_uartTimerHandle = Timer_create(Timer_ANY, UARTDmaRxTimeout,
 			 	 	 	 	 	 	  &uart_TimerParams, &eb);
 
 	 Task_Params_init(&uart_params);
@@ -265,6 +289,33 @@ int main()
 		 DEBUG_PRINT(("\r\nERROR:BLE Command Handler task creation failed\r\n"));
 	 }
 #endif
+	 /*
+	  * The sensor service, SD writer and USB command worker tasks are created
+	  * with their stacks in appNano.cfg and run once BIOS_start() is called.
+	  * They block on the objects these create, so a failure here is fatal.
+	  */
+	 if((SensorSvc_Init() != PASS) || (SDWriter_Init() != PASS) || (usbCmdWorkerInit() != PASS))
+	 {
+		 nnoStatus_setErrorStatus(NNO_ERROR_INSUFFICIENT_MEMORY, true);
+		 DEBUG_PRINT(("\r\nERROR:Task init failed\r\n"));
+		 return FAIL;
+	 }
+
+#ifdef NIRSCAN_BIN_LOG
+	 /* Only the task object comes from the heap */
+	 Task_Params_init(&bin_log_params);
+	 Error_init(&eb);
+	 bin_log_params.stack = bin_log_stack;
+	 bin_log_params.stackSize = sizeof(bin_log_stack);
+	 bin_log_params.priority = BIN_LOG_TASK_PRIORITY;
+	 if (Task_create((Task_FuncPtr)BinLog_Task, &bin_log_params, &eb) == NULL)
+	 {
+		 nnoStatus_setErrorStatus(NNO_ERROR_INSUFFICIENT_MEMORY, true);
+		 DEBUG_PRINT(("\r\nERROR:Log drain task creation failed\r\n"));
+		 return FAIL;
+	 }
+#endif
+
 	 nnoStatus_setDeviceStatus(NNO_STATUS_TIVA, true);
 
 	 // Turn on bluetooth on boot-up. Helpful to test Bluetooth without using the button
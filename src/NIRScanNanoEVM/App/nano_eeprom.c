@@ -9,30 +9,39 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 #include <driverlib/eeprom.h>
 #include "dlpspec_version.h"
 #include <NNOCommandDefs.h>
 #include "common.h"
+#include "usbBulkProto.h"
 #include "nano_eeprom.h"
 
+#define CFG_DIR_HEAD_WORD_ADDR	(EEPROM_CFG_DIR_ADDR + offsetof(EEPROM_CFG_DIR, seq))
+#define CFG_DIR_ENTRY_ADDR(i)	(EEPROM_CFG_DIR_ADDR + offsetof(EEPROM_CFG_DIR, entry) + \
+								 (i) * sizeof(EEPROM_CFG_DIR_ENTRY))
+#define CFG_DIR_JOURNAL_ADDR	(EEPROM_CFG_DIR_ADDR + offsetof(EEPROM_CFG_DIR, journal))
+
 uint16_t g_scanConfigIDs[EEPROM_MAX_SCAN_CFG_STORAGE];
 
-static int32_t Nano_eeprom_SetNumConfigRecords(uint16_t num_records)
-/* 
- * Writes at its designated location in EEPROM; the variable that holds number of
- * config records in EEPROM.
- *
- * @param num_records -I - number of config records stored in EEPROM
- *
- * @return Error code as defined in driverlib/eeprom.h
- */
-{
-	uint32_t test_word;
+static EEPROM_CFG_DIR cfgDir;			// copy of the config directory in EEPROM
+static bool cfgDirLoaded = false;
 
-	EEPROMRead(&test_word, EEPROM_NUM_AND_ACTIVE_CFG_ADDR, EEPROM_NUM_AND_ACTIVE_CFG_SIZE);
-	EEPROM_SET_NUM_RECORDS(test_word, num_records);
-	return EEPROMProgram(&test_word, EEPROM_NUM_AND_ACTIVE_CFG_ADDR, EEPROM_NUM_AND_ACTIVE_CFG_SIZE);
-}
+static uint32_t counterLog[EEPROM_COUNTER_LOG_SLOTS];	// copy of the counter log in EEPROM
+static uint16_t counterValue[EEPROM_NUM_COUNTERS];		// current values
+static uint16_t counterStored[EEPROM_NUM_COUNTERS];	// values the EEPROM holds
+static uint8_t counterSlot[EEPROM_NUM_COUNTERS];		// slot of the last record; EEPROM_COUNTER_LOG_SLOTS if none
+static uint8_t counterLogHead;							// slot written next
+static uint8_t counterLogSeq;							// seq of the next record
+static bool counterLogLoaded = false;
+
+/* Where the counters were kept before the counter log */
+static const uint32_t counterLegacyAddr[EEPROM_NUM_COUNTERS] =
+{
+	EEPROM_INDEX_COUNTER_ADDR,
+	EEPROM_CONFIG_COUNTER_ADDR
+};
 
 int32_t Nano_eeprom_SetActiveConfig(uint32_t index)
 /**
@@ -67,87 +76,247 @@ uint8_t Nano_eeprom_GetActiveConfigIndex(void)
 	return (uint8_t)test_word;
 }
 
+static uint32_t Nano_eeprom_GetCounterCheck(uint32_t record)
+{
+	record &= ~(0x3F << 24);
+	return UsbBulkProto_Crc(0, &record, sizeof(record)) & 0x3F;
+}
+
+static bool Nano_eeprom_IsCounterSeqAfter(uint32_t seq, uint32_t ref)
+{
+	uint8_t diff = (uint8_t)(seq - ref);
+
+	return (diff != 0) && (diff < 0x80);
+}
+
+static void Nano_eeprom_LoadCounters(void)
+/*
+ * Reads the counter log into RAM the first time a counter is needed and
+ * finds the last record of each counter. A counter without a record yet
+ * takes its value from the word it used to be kept in.
+ *
+ * @return none
+ */
+{
+	uint32_t record;
+	uint32_t newest = EEPROM_COUNTER_LOG_SLOTS;
+	uint32_t counter;
+	uint32_t legacy;
+	uint32_t i;
+
+	if(counterLogLoaded)
+		return;
+
+	EEPROMRead(counterLog, EEPROM_COUNTER_LOG_ADDR, EEPROM_COUNTER_LOG_SIZE);
+
+	for(counter=0; counter<EEPROM_NUM_COUNTERS; counter++)
+		counterSlot[counter] = EEPROM_COUNTER_LOG_SLOTS;
+
+	for(i=0; i<EEPROM_COUNTER_LOG_SLOTS; i++)
+	{
+		record = counterLog[i];
+		counter = EEPROM_COUNTER_RECORD_COUNTER(record);
+		if((counter >= EEPROM_NUM_COUNTERS) ||
+				(EEPROM_COUNTER_RECORD_CHECK(record) != Nano_eeprom_GetCounterCheck(record)))
+			continue;
+
+		if((counterSlot[counter] == EEPROM_COUNTER_LOG_SLOTS) ||
+				Nano_eeprom_IsCounterSeqAfter(EEPROM_COUNTER_RECORD_SEQ(record),
+						EEPROM_COUNTER_RECORD_SEQ(counterLog[counterSlot[counter]])))
+			counterSlot[counter] = i;
+
+		if((newest == EEPROM_COUNTER_LOG_SLOTS) ||
+				Nano_eeprom_IsCounterSeqAfter(EEPROM_COUNTER_RECORD_SEQ(record),
+						EEPROM_COUNTER_RECORD_SEQ(counterLog[newest])))
+			newest = i;
+	}
+
+	for(counter=0; counter<EEPROM_NUM_COUNTERS; counter++)
+	{
+		if(counterSlot[counter] == EEPROM_COUNTER_LOG_SLOTS)
+		{
+			EEPROMRead(&legacy, counterLegacyAddr[counter], 4);
+			counterStored[counter] = (uint16_t)legacy;
+		}
+		else
+			counterStored[counter] = EEPROM_COUNTER_RECORD_VALUE(counterLog[counterSlot[counter]]);
+		counterValue[counter] = counterStored[counter];
+	}
+
+	if(newest == EEPROM_COUNTER_LOG_SLOTS)
+	{
+		counterLogHead = 0;
+		counterLogSeq = 0;
+	}
+	else
+	{
+		counterLogHead = (newest + 1) % EEPROM_COUNTER_LOG_SLOTS;
+		counterLogSeq = EEPROM_COUNTER_RECORD_SEQ(counterLog[newest]) + 1;
+	}
+
+	counterLogLoaded = true;
+}
+
+static int Nano_eeprom_WriteCounterRecord(uint32_t counter, uint16_t value)
+/*
+ * Writes a record at the head of the counter log, over the oldest one. A
+ * record is one word, so it is either written or not.
+ *
+ * @param counter -I - EEPROM_COUNTER_SCAN_INDEX or EEPROM_COUNTER_CONFIG_INDEX
+ * @param value   -I - value to store
+ *
+ * @return PASS or FAIL
+ */
+{
+	uint32_t record = EEPROM_COUNTER_RECORD(counter, counterLogSeq, value);
+
+	record |= Nano_eeprom_GetCounterCheck(record) << 24;
+	if(EEPROMProgram(&record, EEPROM_COUNTER_LOG_ADDR + counterLogHead * 4, 4) != 0)
+		return FAIL;
+
+	counterLog[counterLogHead] = record;
+	counterSlot[counter] = counterLogHead;
+	counterStored[counter] = value;
+	counterLogHead = (counterLogHead + 1) % EEPROM_COUNTER_LOG_SLOTS;
+	counterLogSeq++;
+
+	return PASS;
+}
+
+static int Nano_eeprom_AppendCounter(uint32_t counter, uint16_t value)
+/*
+ * Adds a record for a counter to the log. If the oldest record, which is
+ * about to be overwritten, is the last one of a counter, that record is
+ * first written again at the head, so the counter still has a record if
+ * power fails before the new one is written.
+ *
+ * @param counter -I - EEPROM_COUNTER_SCAN_INDEX or EEPROM_COUNTER_CONFIG_INDEX
+ * @param value   -I - value to store
+ *
+ * @return PASS or FAIL
+ */
+{
+	uint32_t other = 0;
+
+	while(other < EEPROM_NUM_COUNTERS)
+	{
+		if(counterSlot[other] != counterLogHead)
+		{
+			other++;
+			continue;
+		}
+
+		if(Nano_eeprom_WriteCounterRecord(other, counterStored[other]) != PASS)
+			return FAIL;
+		other = 0;
+	}
+
+	return Nano_eeprom_WriteCounterRecord(counter, value);
+}
+
+static int Nano_eeprom_SetCounter(uint32_t counter, uint16_t value, uint16_t batch)
+/*
+ * Sets a counter in RAM. A record is only written once the value goes
+ * past what the EEPROM already covers; it then covers batch values.
+ *
+ * @param counter -I - EEPROM_COUNTER_SCAN_INDEX or EEPROM_COUNTER_CONFIG_INDEX
+ * @param value   -I - new value
+ * @param batch   -I - values to cover per record written; 1 to write through
+ *
+ * @return PASS or FAIL
+ */
+{
+	Nano_eeprom_LoadCounters();
+
+	counterValue[counter] = value;
+	if((uint16_t)(counterStored[counter] - value) < batch)
+		return PASS;
+
+	return Nano_eeprom_AppendCounter(counter, value + batch - 1);
+}
+
+int Nano_eeprom_FlushCounters(void)
+/**
+ * Writes the exact value of every counter that the EEPROM only covers
+ * through a batch, so that the count carries on from there after the next
+ * power up. To be called before hibernating or resetting, when no other
+ * task is using the EEPROM.
+ *
+ * @return PASS or FAIL
+ */
+{
+	uint32_t counter;
+	int ret = PASS;
+
+	if(!counterLogLoaded)
+		return PASS;
+
+	for(counter=0; counter<EEPROM_NUM_COUNTERS; counter++)
+	{
+		if(counterValue[counter] == counterStored[counter])
+			continue;
+
+		if(Nano_eeprom_AppendCounter(counter, counterValue[counter]) != PASS)
+			ret = FAIL;
+	}
+
+	return ret;
+}
+
 static int Nano_eeprom_SetScanConfigIndexCounter(uint32_t* scanConfigIndexCounter)
 /* 
- * Writes at its designated location in EEPROM; the variable that holds unique scan 
- * config index
+ * Sets the variable that holds unique scan config index; written to the
+ * counter log once per EEPROM_CONFIG_COUNTER_BATCH values
  *
  * @param scanConfigIndexCounter -I - scanConfig index running counter
  *
- * @return Error code as defined in driverlib/eeprom.h
+ * @return PASS or FAIL
  */
 {
-    return EEPROMProgram((uint32_t*)scanConfigIndexCounter, EEPROM_CONFIG_COUNTER_ADDR, \
-			EEPROM_CONFIG_COUNTER_SIZE);
+	return Nano_eeprom_SetCounter(EEPROM_COUNTER_CONFIG_INDEX, *scanConfigIndexCounter,
+			EEPROM_CONFIG_COUNTER_BATCH);
 }
 
 static int Nano_eeprom_GetScanConfigIndexCounter(uint32_t* scanConfigIndexCounter)
 /* 
- * Retrieves from EEPROM; the variable that holds unique scan config index
+ * Retrieves the variable that holds unique scan config index
  *
  * @param scanConfigIndexCounter -O - true = scanConfig index running counter
  *
  * @return PASS
  */
 {
-    EEPROMRead((uint32_t*)scanConfigIndexCounter, EEPROM_CONFIG_COUNTER_ADDR,\
-		   	EEPROM_CONFIG_COUNTER_SIZE);
-    return PASS;
+	Nano_eeprom_LoadCounters();
+	*scanConfigIndexCounter = counterValue[EEPROM_COUNTER_CONFIG_INDEX];
+	return PASS;
 }
 
 int Nano_eeprom_SetScanIndexCounter(uint16_t* pScanIndexCounter)
 /**
- * Writes at its designated location in EEPROM; the variable that holds unique scan 
+ * Writes to the counter log; the variable that holds unique scan
  * index
  *
  * @param pScanIndexCounter -I - scan index running counter
  *
- * @return Error code as defined in driverlib/eeprom.h
+ * @return PASS or FAIL
  */
 {
-	uint32_t scanIndexCtr = *pScanIndexCounter;
-    return EEPROMProgram(&scanIndexCtr, EEPROM_INDEX_COUNTER_ADDR,\
-		   	EEPROM_INDEX_COUNTER_SIZE);
+	return Nano_eeprom_SetCounter(EEPROM_COUNTER_SCAN_INDEX, *pScanIndexCounter, 1);
 }
 
 int Nano_eeprom_GetScanIndexCounter(uint16_t* pScanIndexCounter)
 /** 
- * Retrieves from EEPROM; the variable that holds unique scan index
+ * Retrieves the variable that holds unique scan index
  *
  * @param pScanIndexCounter -O - true = scanConfig index running counter
  *
  * @return PASS
  */
 {
-	uint32_t scanIndexCtr;
-    EEPROMRead(&scanIndexCtr, EEPROM_INDEX_COUNTER_ADDR, \
-			EEPROM_INDEX_COUNTER_SIZE);
-
-    *pScanIndexCounter = scanIndexCtr;
+	Nano_eeprom_LoadCounters();
+	*pScanIndexCounter = counterValue[EEPROM_COUNTER_SCAN_INDEX];
 
-    return PASS;
-}
-
-void Nano_eeprom_GatherScanCfgIDs(void)
-/**
- * Iterates through all scanConfigs stored in EEPROM and populates g_scanConfigIDs
- * array that can be published to the bluetooth app later
- *
- * @return none
- *
- */
-{
-    int index;
-    uint32_t num_records;
-    uScanConfig cfgRec;
-
-    num_records = Nano_eeprom_GetNumConfigRecords();
-    for(index=0; index<num_records ; index++)
-    {
-    	Nano_eeprom_GetConfigRecord(index, &cfgRec);
-        g_scanConfigIDs[index] = cfgRec.scanCfg.scanConfigIndex;
-    }
-    return;
+	return PASS;
 }
 
 static uint32_t Nano_eeprom_GetConfigRecordSize(uScanConfig *pCfg)
@@ -166,74 +335,482 @@ static uint32_t Nano_eeprom_GetConfigRecordSize(uScanConfig *pCfg)
 	return record_size;
 }
 
-static int Nano_eeprom_GetConfigRecordFromAddr(uint32_t addr, uScanConfig *pCfg)
+static uint32_t Nano_eeprom_GetJournalCrc(EEPROM_CFG_DIR_JOURNAL *pJournal)
 {
-	uint32_t temp[EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE/4];
+	return UsbBulkProto_Crc(0, pJournal, offsetof(EEPROM_CFG_DIR_JOURNAL, crc));
+}
 
-	EEPROMRead((uint32_t *)pCfg, addr, EEPROM_SCAN_CFG_STRUCT_SIZE);
-	if(pCfg->scanCfg.scan_type == SLEW_TYPE)
+static int Nano_eeprom_ApplyConfigDirJournal(void)
+/*
+ * Writes the entry and the count/seq word the journal describes.
+ *
+ * @return PASS or FAIL
+ */
+{
+	EEPROM_CFG_DIR_JOURNAL *pJournal = &cfgDir.journal;
+
+	cfgDir.entry[pJournal->index] = pJournal->entry;
+	cfgDir.seq = pJournal->seq;
+	cfgDir.num_records = pJournal->num_records;
+
+	if(EEPROMProgram((uint32_t *)&cfgDir.entry[pJournal->index], CFG_DIR_ENTRY_ADDR(pJournal->index),
+			sizeof(EEPROM_CFG_DIR_ENTRY)) != 0)
+		return FAIL;
+
+	/* seq and num_records share a word, so this is the one write that
+	 * commits the update */
+	if(EEPROMProgram((uint32_t *)&cfgDir.seq, CFG_DIR_HEAD_WORD_ADDR, 4) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+static int Nano_eeprom_WriteConfigDirJournal(uint8_t index, EEPROM_CFG_DIR_ENTRY *pEntry, uint8_t num_records)
+/*
+ * Writes the journal for an update of one directory entry. Once it is
+ * written, the update is applied when the directory is next loaded if it
+ * has not been by then.
+ *
+ * @param index       -I - entry to update
+ * @param pEntry      -I - new entry
+ * @param num_records -I - number of records after the update
+ *
+ * @return PASS or FAIL
+ */
+{
+	EEPROM_CFG_DIR_JOURNAL *pJournal = &cfgDir.journal;
+
+	pJournal->seq = cfgDir.seq + 1;
+	pJournal->index = index;
+	pJournal->num_records = num_records;
+	pJournal->entry = *pEntry;
+	pJournal->crc = Nano_eeprom_GetJournalCrc(pJournal);
+
+	if(EEPROMProgram((uint32_t *)pJournal, CFG_DIR_JOURNAL_ADDR, sizeof(EEPROM_CFG_DIR_JOURNAL)) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+static int Nano_eeprom_UpdateConfigDir(uint8_t index, EEPROM_CFG_DIR_ENTRY *pEntry, uint8_t num_records)
+/*
+ * Points a directory entry at a record that has already been written. The
+ * update goes to the journal first, so that power lost while the entry is
+ * written cannot leave it half updated.
+ *
+ * @param index       -I - entry to update
+ * @param pEntry      -I - new entry
+ * @param num_records -I - number of records after the update
+ *
+ * @return PASS or FAIL
+ */
+{
+	if((Nano_eeprom_WriteConfigDirJournal(index, pEntry, num_records) != PASS) ||
+			(Nano_eeprom_ApplyConfigDirJournal() != PASS))
 	{
-		EEPROMRead(temp, addr, EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE);
-		memcpy( pCfg, temp, sizeof(uScanConfig));
+		/* Start again from what made it to the EEPROM */
+		cfgDirLoaded = false;
+		return FAIL;
 	}
-	if(pCfg->scanCfg.ScanConfig_serial_number[0] == 'F')
+
+	return PASS;
+}
+
+static bool Nano_eeprom_IsConfigMovePending(uint32_t move)
+/*
+ * Tells whether a move word belongs to the update in the journal, which
+ * must not be applied before the move is finished.
+ *
+ * @param move -I - move word read from EEPROM_CFG_MOVE_ADDR
+ *
+ * @return true if the move is to be finished
+ */
+{
+	EEPROM_CFG_DIR_ENTRY *pEntry = &cfgDir.journal.entry;
+	uint32_t from = EEPROM_CFG_MOVE_FROM(move);
+
+	return (move != 0) && (EEPROM_CFG_MOVE_SEQ(move) == cfgDir.journal.seq) &&
+			(from > pEntry->offset) && (from < pEntry->offset + pEntry->size) &&
+			(from + pEntry->size <= EEPROM_SCAN_CFG_SIZE) &&
+			(pEntry->size <= EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE);
+}
+
+static int Nano_eeprom_CopyConfigPieces(uint32_t move)
+/*
+ * Copies a record down to the offset in the journal entry, (old offset - new
+ * offset) bytes at a time starting at its first byte. A piece only
+ * overwrites the one copied before it, and the count of pieces copied is
+ * written after each, so the copy can be picked up again where a power loss
+ * cut it off: the piece it was writing still has its source in place.
+ *
+ * @param move -I - move word; gives the old offset and the pieces copied
+ *
+ * @return PASS or FAIL
+ */
+{
+	uint32_t piece[EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE/4];
+	EEPROM_CFG_DIR_ENTRY *pEntry = &cfgDir.journal.entry;
+	uint32_t from = EEPROM_CFG_MOVE_FROM(move);
+	uint32_t step = from - pEntry->offset;
+	uint32_t done = EEPROM_CFG_MOVE_DONE(move);
+	uint32_t pos;
+	uint32_t length;
+
+	for(pos = done * step; pos < pEntry->size; pos += step)
+	{
+		length = MIN(step, pEntry->size - pos);
+		EEPROMRead(piece, EEPROM_SCAN_CFG_ADDRESS + from + pos, length);
+		if(EEPROMProgram(piece, EEPROM_SCAN_CFG_ADDRESS + pEntry->offset + pos, length) != 0)
+			return FAIL;
+
+		/* The journal is applied after the last piece */
+		if(pos + step >= pEntry->size)
+			break;
+		move = EEPROM_CFG_MOVE(cfgDir.journal.seq, from, ++done);
+		if(EEPROMProgram(&move, EEPROM_CFG_MOVE_ADDR, EEPROM_CFG_MOVE_SIZE) != 0)
+			return FAIL;
+	}
+
+	return PASS;
+}
+
+static int Nano_eeprom_SlideConfigRecord(uint8_t index, uint16_t offset)
+/*
+ * Moves a record down to an offset less than its size below where it is.
+ * The old copy is overwritten as the new one is written, so the move is
+ * recorded in the move word and the journal first and is finished when the
+ * directory is next loaded if power is lost partway.
+ *
+ * @param index  -I - entry of the record
+ * @param offset -I - new offset
+ *
+ * @return PASS or FAIL
+ */
+{
+	EEPROM_CFG_DIR_ENTRY entry = cfgDir.entry[index];
+	uint32_t move = EEPROM_CFG_MOVE(cfgDir.seq + 1, entry.offset, 0);
+
+	entry.offset = offset;
+
+	/* The move word goes first; it counts for nothing until the journal
+	 * with its seq is written */
+	if((EEPROMProgram(&move, EEPROM_CFG_MOVE_ADDR, EEPROM_CFG_MOVE_SIZE) != 0) ||
+			(Nano_eeprom_WriteConfigDirJournal(index, &entry, cfgDir.num_records) != PASS) ||
+			(Nano_eeprom_CopyConfigPieces(move) != PASS) ||
+			(Nano_eeprom_ApplyConfigDirJournal() != PASS))
+	{
+		cfgDirLoaded = false;
 		return FAIL;
+	}
+
+	move = 0;
+	if(EEPROMProgram(&move, EEPROM_CFG_MOVE_ADDR, EEPROM_CFG_MOVE_SIZE) != 0)
+	{
+		cfgDirLoaded = false;
+		return FAIL;
+	}
 
 	return PASS;
 }
 
-static uint32_t Nano_eeprom_GetConfigRecordAddr(uint8_t index)
-/* Returns 0 on failure or invalid index or out of bounds */
+static int Nano_eeprom_MigrateConfigDir(void)
+/*
+ * Builds the directory for records stored the way they were before there
+ * was one: packed one after another from EEPROM_SCAN_CFG_ADDRESS, with only
+ * a count. The records stay where they are. The magic is written last, so
+ * an interrupted migration is simply done again.
+ *
+ * @return PASS or FAIL
+ */
 {
-	uint32_t num_records;
-	uint32_t next_record_addr = EEPROM_SCAN_CFG_ADDRESS;
+	uint32_t record[EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE/4];
+	uScanConfig *pCfg = (uScanConfig *)record;
+	uint32_t ver;
+	uint32_t test_word;
+	uint32_t num_records = 0;
+	uint32_t offset = 0;
 	uint32_t record_size;
-	uScanConfig cfg;
-	int i;
+	uint32_t i;
 
-	if(index >= EEPROM_MAX_SCAN_CFG_STORAGE)
-		return 0;
+	memset(&cfgDir, 0, sizeof(EEPROM_CFG_DIR));
 
-	num_records = Nano_eeprom_GetNumConfigRecords();
+	EEPROMRead(&ver, EEPROM_CFG_VER_ADDR, EEPROM_CFG_VER_SIZE);
+	EEPROMRead(&test_word, EEPROM_NUM_AND_ACTIVE_CFG_ADDR, EEPROM_NUM_AND_ACTIVE_CFG_SIZE);
+	if((ver == DLPSPEC_CFG_VER) && (EEPROM_GET_NUM_CFGS(test_word) <= EEPROM_MAX_SCAN_CFG_STORAGE))
+		num_records = EEPROM_GET_NUM_CFGS(test_word);
 
-	if(index > num_records)
-		return 0;
+	for(i=0; i<num_records; i++)
+	{
+		EEPROMRead(record, EEPROM_SCAN_CFG_ADDRESS + offset, EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE);
+		if((pCfg->scanCfg.scan_type == SLEW_TYPE) &&
+				(pCfg->slewScanCfg.head.num_sections > SLEW_SCAN_MAX_SECTIONS))
+			break;
+
+		record_size = Nano_eeprom_GetConfigRecordSize(pCfg);
+		if(offset + record_size > EEPROM_SCAN_CFG_SIZE)
+			break;
+
+		cfgDir.entry[i].offset = offset;
+		cfgDir.entry[i].size = record_size;
+		cfgDir.entry[i].config_id = pCfg->scanCfg.scanConfigIndex;
+		cfgDir.entry[i].crc = (uint16_t)UsbBulkProto_Crc(0, record, record_size);
+		offset += record_size;
+	}
+	cfgDir.num_records = i;
+
+	if(EEPROMProgram((uint32_t *)&cfgDir.seq, EEPROM_CFG_DIR_ADDR + sizeof(cfgDir.magic),
+			sizeof(EEPROM_CFG_DIR) - sizeof(cfgDir.magic)) != 0)
+		return FAIL;
+
+	cfgDir.magic = EEPROM_CFG_DIR_MAGIC;
+	if(EEPROMProgram(&cfgDir.magic, EEPROM_CFG_DIR_ADDR, sizeof(cfgDir.magic)) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+static int Nano_eeprom_LoadConfigDir(void)
+/*
+ * Reads the directory into RAM the first time it is needed, finishing an
+ * update or a record move that was cut short or building it from the old
+ * layout.
+ *
+ * @return PASS or FAIL
+ */
+{
+	EEPROM_CFG_DIR_JOURNAL *pJournal = &cfgDir.journal;
+	uint32_t move;
+
+	if(cfgDirLoaded)
+		return PASS;
+
+	EEPROMRead((uint32_t *)&cfgDir, EEPROM_CFG_DIR_ADDR, sizeof(EEPROM_CFG_DIR));
+	EEPROMRead(&move, EEPROM_CFG_MOVE_ADDR, EEPROM_CFG_MOVE_SIZE);
+
+	if(cfgDir.magic != EEPROM_CFG_DIR_MAGIC)
+	{
+		if(Nano_eeprom_MigrateConfigDir() != PASS)
+			return FAIL;
+	}
+	else if((pJournal->crc == Nano_eeprom_GetJournalCrc(pJournal)) &&
+			(pJournal->seq == (uint16_t)(cfgDir.seq + 1)) &&
+			(pJournal->index < EEPROM_MAX_SCAN_CFG_STORAGE) &&
+			(pJournal->num_records <= EEPROM_MAX_SCAN_CFG_STORAGE))
+	{
+		if(Nano_eeprom_IsConfigMovePending(move) && (Nano_eeprom_CopyConfigPieces(move) != PASS))
+			return FAIL;
+		if(Nano_eeprom_ApplyConfigDirJournal() != PASS)
+			return FAIL;
+	}
+
+	/* A move that is done, or never got its journal written */
+	if(move != 0)
+	{
+		move = 0;
+		if(EEPROMProgram(&move, EEPROM_CFG_MOVE_ADDR, EEPROM_CFG_MOVE_SIZE) != 0)
+			return FAIL;
+	}
+
+	if(cfgDir.num_records > EEPROM_MAX_SCAN_CFG_STORAGE)
+		return FAIL;
+
+	cfgDirLoaded = true;
+	return PASS;
+}
+
+static uint32_t Nano_eeprom_SortConfigRecords(uint8_t *pOrder)
+/*
+ * Lists the records in use by offset in the scan cfg area.
+ *
+ * @param pOrder -O - entry indices, EEPROM_MAX_SCAN_CFG_STORAGE of them at most
+ *
+ * @return number of entries listed
+ */
+{
+	uint32_t num = 0;
+	uint32_t i;
+	uint32_t j;
+
+	for(i=0; i<cfgDir.num_records; i++)
+	{
+		if(cfgDir.entry[i].size == 0)
+			continue;
+
+		for(j=num; (j > 0) && (cfgDir.entry[pOrder[j-1]].offset > cfgDir.entry[i].offset); j--)
+			pOrder[j] = pOrder[j-1];
+		pOrder[j] = i;
+		num++;
+	}
+
+	return num;
+}
+
+static bool Nano_eeprom_FindConfigSpace(uint32_t size, uint16_t *pOffset)
+/*
+ * Finds a stretch of the scan cfg area that no record uses, looking from the
+ * end of the record written last before going back to the start of the area.
+ * Saving the same config over and over then moves its copies through the
+ * whole area instead of wearing out the first free stretch.
+ *
+ * @param size    -I - bytes needed
+ * @param pOffset -O - offset of the space in the scan cfg area
+ *
+ * @return true if there is room
+ */
+{
+	uint8_t order[EEPROM_MAX_SCAN_CFG_STORAGE];
+	EEPROM_CFG_DIR_ENTRY *pEntry;
+	uint32_t num;
+	uint32_t start;
+	uint32_t pass;
+	uint32_t i;
+
+	num = Nano_eeprom_SortConfigRecords(order);
+	for(pass=0; pass<2; pass++)
+	{
+		/* The journal holds the entry of the record written last */
+		start = (pass == 0) ? (cfgDir.journal.entry.offset + cfgDir.journal.entry.size) : 0;
+		for(i=0; i<num; i++)
+		{
+			pEntry = &cfgDir.entry[order[i]];
+			if(pEntry->offset >= start + size)
+				break;
+			start = MAX(start, pEntry->offset + pEntry->size);
+		}
 
-	for(i=0; i<index; i++)
+		if(start + size <= EEPROM_SCAN_CFG_SIZE)
+		{
+			*pOffset = start;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int Nano_eeprom_CompactConfigRecords(void)
+/*
+ * Moves the records down to the start of the scan cfg area so the free
+ * space is in one piece at its end; needed once the area is too full or
+ * fragmented to take a new copy of a record next to the old one. A record
+ * with room below it for a whole copy is copied and switched over like a
+ * save; one that has to move by less than its size is slid down in pieces.
+ * Either way a power loss leaves every record readable. The record about
+ * to be replaced is moved like the others, as it has to stay until its
+ * replacement is written.
+ *
+ * @return PASS or FAIL
+ */
+{
+	uint32_t record[EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE/4];
+	uint8_t order[EEPROM_MAX_SCAN_CFG_STORAGE];
+	EEPROM_CFG_DIR_ENTRY entry;
+	uint32_t num;
+	uint32_t start = 0;
+	uint32_t i;
+
+	num = Nano_eeprom_SortConfigRecords(order);
+	for(i=0; i<num; i++)
 	{
-		if(Nano_eeprom_GetConfigRecordFromAddr(next_record_addr, &cfg) != PASS)
-			return 0;
-		record_size = Nano_eeprom_GetConfigRecordSize(&cfg);
-		next_record_addr += record_size;
+		entry = cfgDir.entry[order[i]];
+		if(start + entry.size <= entry.offset)
+		{
+			EEPROMRead(record, EEPROM_SCAN_CFG_ADDRESS + entry.offset, entry.size);
+			if(EEPROMProgram(record, EEPROM_SCAN_CFG_ADDRESS + start, entry.size) != 0)
+				return FAIL;
+			entry.offset = start;
+			if(Nano_eeprom_UpdateConfigDir(order[i], &entry, cfgDir.num_records) != PASS)
+				return FAIL;
+		}
+		else if(entry.offset != start)
+		{
+			if(Nano_eeprom_SlideConfigRecord(order[i], start) != PASS)
+				return FAIL;
+		}
+		start += entry.size;
 	}
 
-	if(next_record_addr > EEPROM_SIZE)
-		next_record_addr = 0;
+	return PASS;
+}
+
+static int Nano_eeprom_ReadConfigRecord(uint8_t index, uScanConfig *pCfg)
+{
+	uint32_t record[EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE/4];
+	EEPROM_CFG_DIR_ENTRY *pEntry = &cfgDir.entry[index];
 
-	return next_record_addr;
+	if((pEntry->size == 0) || (pEntry->size > sizeof(record)))
+		return FAIL;
+
+	EEPROMRead(record, EEPROM_SCAN_CFG_ADDRESS + pEntry->offset, pEntry->size);
+	if((uint16_t)UsbBulkProto_Crc(0, record, pEntry->size) != pEntry->crc)
+		return FAIL;
+
+	memset(pCfg, 0, sizeof(uScanConfig));
+	memcpy(pCfg, record, MIN(pEntry->size, sizeof(uScanConfig)));
+	if(pCfg->scanCfg.ScanConfig_serial_number[0] == 'F')
+		return FAIL;
+
+	return PASS;
+}
+
+void Nano_eeprom_GatherScanCfgIDs(void)
+/**
+ * Populates g_scanConfigIDs array from the config directory so that it can be
+ * published to the bluetooth app later
+ *
+ * @return none
+ *
+ */
+{
+	int index;
+
+	if(Nano_eeprom_LoadConfigDir() != PASS)
+		return;
+
+	for(index=0; index<cfgDir.num_records; index++)
+		g_scanConfigIDs[index] = cfgDir.entry[index].config_id;
+	return;
 }
 
 int Nano_eeprom_SaveConfigRecord(uint8_t index, uScanConfig *pCfg)
 /**
  * Saves the scanConfig structure that is passed at the specified index in EEPROM.
+ * The record is written to free space and then replaces the one at index,
+ * so the old record is kept if the save does not complete. Fails, leaving
+ * the old record, if the scan cfg area cannot hold both at once.
  *
- * @param index - I - index at which to store the scanConfig structure
+ * @param index - I - index at which to store the scanConfig structure; at most
+ *                    the number of records stored
  * @param pCfg - I - scan config structure to be stored in EEPROM.
  *
  * @return PASS or FAIL
  */
 {
+	uint32_t record[EEPROM_SLEW_SCAN_CFG_STRUCT_SIZE/4];
+	EEPROM_CFG_DIR_ENTRY entry;
 	uint32_t num_records;
 	int ret;
 	uint32_t ConfigIndexCounter = 0;
 	uint32_t val = DLPSPEC_CFG_VER;
+	uint32_t ver;
 	char ser_num[NANO_SER_NUM_LEN];
 	int i;
-	uint32_t addr;
+	uint32_t record_size;
 
 	if(index >= EEPROM_MAX_SCAN_CFG_STORAGE)
 		return FAIL;
 
+	if(Nano_eeprom_LoadConfigDir() != PASS)
+		return FAIL;
+
+	num_records = cfgDir.num_records;
+	if(index > num_records)
+		return FAIL;
+
+	record_size = Nano_eeprom_GetConfigRecordSize(pCfg);
+	if(record_size > sizeof(record))
+		return FAIL;
+
 	ret = Nano_eeprom_GetDeviceSerialNumber((uint8_t*)ser_num);
 	Nano_eeprom_GetScanConfigIndexCounter(&ConfigIndexCounter);
 	pCfg->scanCfg.scanConfigIndex = ConfigIndexCounter;
@@ -250,24 +827,36 @@ int Nano_eeprom_SaveConfigRecord(uint8_t index, uScanConfig *pCfg)
 			pCfg->scanCfg.ScanConfig_serial_number[i] = 'F';
 	    }
 	}
-	num_records = Nano_eeprom_GetNumConfigRecords();
-	/* Store the data structure version number */
-	EEPROMProgram(&val, EEPROM_CFG_VER_ADDR, EEPROM_CFG_VER_SIZE);
+	/* Store the data structure version number, unless it is there already
+	 * from an earlier save */
+	EEPROMRead(&ver, EEPROM_CFG_VER_ADDR, EEPROM_CFG_VER_SIZE);
+	if(ver != val)
+		EEPROMProgram(&val, EEPROM_CFG_VER_ADDR, EEPROM_CFG_VER_SIZE);
+
+	memset(record, 0, sizeof(record));
+	memcpy(record, pCfg, MIN(record_size, sizeof(uScanConfig)));
+	entry.size = record_size;
+	entry.config_id = pCfg->scanCfg.scanConfigIndex;
+	entry.crc = (uint16_t)UsbBulkProto_Crc(0, record, record_size);
+
+	/* The old record stays until the new one is written, so the area has
+	 * to hold both; if it cannot even once compacted, the save is refused */
+	if(!Nano_eeprom_FindConfigSpace(record_size, &entry.offset))
+	{
+		if((Nano_eeprom_CompactConfigRecords() != PASS) ||
+				!Nano_eeprom_FindConfigSpace(record_size, &entry.offset))
+			return FAIL;
+	}
 
-	addr = Nano_eeprom_GetConfigRecordAddr(index);
-	if(addr == 0)
+	if(EEPROMProgram(record, EEPROM_SCAN_CFG_ADDRESS + entry.offset, record_size) != 0)
 		return FAIL;
 
-	ret = EEPROMProgram((uint32_t *)pCfg, addr, Nano_eeprom_GetConfigRecordSize(pCfg));
+	if(Nano_eeprom_UpdateConfigDir(index, &entry, MAX(num_records, index + 1)) != PASS)
+		return FAIL;
 
-	//If we got next record, update num_records
-	if(index >= num_records)
-	{
-		if((ret = Nano_eeprom_SetNumConfigRecords(index + 1)) < 0)
-			return ret;
-	}
+	g_scanConfigIDs[index] = entry.config_id;
 
-	return ret;
+	return PASS;
 }
 
 int Nano_eeprom_GetConfigRecord(uint8_t index, uScanConfig *pCfg)
@@ -280,18 +869,13 @@ int Nano_eeprom_GetConfigRecord(uint8_t index, uScanConfig *pCfg)
  * @return PASS or FAIL
  */
 {
-	int32_t num_records;
-	uint32_t addr;
-
-	num_records = Nano_eeprom_GetNumConfigRecords();
-	if(index > MIN((EEPROM_MAX_SCAN_CFG_STORAGE-1), (num_records-1)))
+	if(Nano_eeprom_LoadConfigDir() != PASS)
 		return FAIL;
 
-	addr = Nano_eeprom_GetConfigRecordAddr(index);
-	if(addr == 0)
+	if(index >= cfgDir.num_records)
 		return FAIL;
 
-	return Nano_eeprom_GetConfigRecordFromAddr(addr, pCfg);
+	return Nano_eeprom_ReadConfigRecord(index, pCfg);
 }
 
 uint8_t Nano_eeprom_GetNumConfigRecords(void)
@@ -301,17 +885,10 @@ uint8_t Nano_eeprom_GetNumConfigRecords(void)
  * @return number of records
  */
 {
-	uint32_t test_word;
-	uint32_t num_records;
-	
-	EEPROMRead(&test_word, EEPROM_NUM_AND_ACTIVE_CFG_ADDR, 4);
-	if ( ((test_word & 0XFFFF0000) >> 16) > EEPROM_MAX_SCAN_CFG_STORAGE )
-	      return 0;
-	else 
-	{
-	    num_records = EEPROM_GET_NUM_CFGS(test_word);
-	    return (uint8_t)num_records;
-	}
+	if(Nano_eeprom_LoadConfigDir() != PASS)
+		return 0;
+
+	return cfgDir.num_records;
 }
 
 uint8_t Nano_eeprom_GetScanConfigIndexUsingConfigID(uint16_t id)
@@ -326,9 +903,12 @@ uint8_t Nano_eeprom_GetScanConfigIndexUsingConfigID(uint16_t id)
 	uint8_t idx = 255;	//max value to indicate failure
 	int i = 0;
 
-	for (i=0; i <EEPROM_MAX_SCAN_CFG_STORAGE; i++)
+	if(Nano_eeprom_LoadConfigDir() != PASS)
+		return idx;
+
+	for (i=0; i <cfgDir.num_records; i++)
 	{
-		if (g_scanConfigIDs[i] == id)
+		if ((cfgDir.entry[i].size != 0) && (cfgDir.entry[i].config_id == id))
 		{
 			idx = i;
 			break;
@@ -346,8 +926,8 @@ int16_t Nano_eeprom_GetScanConfigIDUsingIndex(uint8_t index)
  * @return FAIL = invalid index; or returns the scanConfig ID
  */
 {
-	if (index < EEPROM_MAX_SCAN_CFG_STORAGE)
-		return (g_scanConfigIDs[index]);
+	if ((Nano_eeprom_LoadConfigDir() == PASS) && (index < cfgDir.num_records))
+		return (cfgDir.entry[index].config_id);
 	else	// Error
 		return (FAIL);
 }
@@ -356,11 +936,42 @@ int Nano_eeprom_EraseAllConfigRecords(void)
 /**
  * Erases all scanConfig records (except the factory default) from EEPROM
  *
- * @return Error code as defined in driverlib/eeprom.h
+ * @return PASS or FAIL
  */
 {
-	uint32_t test_word = 0x10000; //Num records = 1 and Active config = 0
-	return EEPROMProgram(&test_word, EEPROM_NUM_AND_ACTIVE_CFG_ADDR, sizeof(test_word));
+	if(Nano_eeprom_LoadConfigDir() != PASS)
+		return FAIL;
+
+	cfgDir.num_records = MIN(cfgDir.num_records, 1);
+	if(EEPROMProgram((uint32_t *)&cfgDir.seq, CFG_DIR_HEAD_WORD_ADDR, 4) != 0)
+	{
+		cfgDirLoaded = false;
+		return FAIL;
+	}
+
+	return Nano_eeprom_SetActiveConfig(0);
+}
+
+int Nano_eeprom_ClearConfigDir(void)
+/**
+ * Empties the config directory, for when the scan cfg area has been wiped.
+ *
+ * @return PASS or FAIL
+ */
+{
+	uint32_t move = 0;
+
+	memset(&cfgDir, 0, sizeof(EEPROM_CFG_DIR));
+	memset(g_scanConfigIDs, 0, sizeof(g_scanConfigIDs));
+	cfgDir.magic = EEPROM_CFG_DIR_MAGIC;
+	cfgDirLoaded = false;
+
+	if((EEPROMProgram((uint32_t *)&cfgDir, EEPROM_CFG_DIR_ADDR, sizeof(EEPROM_CFG_DIR)) != 0) ||
+			(EEPROMProgram(&move, EEPROM_CFG_MOVE_ADDR, EEPROM_CFG_MOVE_SIZE) != 0))
+		return FAIL;
+
+	cfgDirLoaded = true;
+	return PASS;
 }
 
 int Nano_eeprom_SavecalibCoeffs(calibCoeffs* pCfg)
@@ -33,6 +33,7 @@
 #include "nano_timer.h"
 #include "cmdHandlerIFMgr.h"
 #include "scan.h"
+#include "nano_eeprom.h"
 
 static uint32_t activity_counter = 0;
 static uint32_t nano_timer_count = 0;
@@ -137,6 +138,7 @@ void nano_timer_handler(void)
 			 * By this way we are safely go to Hibernate Mode.
 			 */
 				b_sleeping = true;
+				Nano_eeprom_FlushCounters();
 				NIRscanNano_powerDown();
 		}
 		nano_timer_reset_activity_count();
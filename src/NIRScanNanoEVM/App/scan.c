@@ -66,22 +66,32 @@
 #include "dlpspec_version.h"
 #include "dlpspec_setup.h"
 #include "cmdProc.h"
+#include "scanStream.h"
+#include "slewSched.h"
+#include "scanTrace.h"
+#include "snrStats.h"
+#include "sensorSvc.h"
+#include "sdWriter.h"
 #include "scan.h"
 
 static int32_t Scan_GetPeakADCval(void);
 static int Scan_AdjustPGAGain(int32_t max_adc_data);
+static uint8_t Scan_ComputePGAGain(int32_t max_adc_data);
+static bool Scan_PredictPGAGain(float detector_temp, uint8_t *p_gain);
+static void Scan_UpdatePGAHistory(int32_t peak_adc_data, float detector_temp);
+static uint32_t Scan_GetPGAScanTime(void);
+static uint32_t Scan_TimeModelEwma(uint32_t estimate, uint32_t sample);
+static uint64_t Scan_GetTimestamp(void);
+static void Scan_UpdateTimeModel(uint64_t setup_ticks, uint64_t ptn_ticks, uint64_t proc_ticks,
+		uint64_t sd_ticks);
 
-static int Scan_CalculateSNR_17ms(void);
-static int Scan_CalculateSNR_133ms(void);
-static int Scan_CalculateSNR_600ms(void);
-static int Scan_BinandAverage(float scanArr[][9] , int num_repeats , int steps,
-		float resultArr[][9]);
-static int Scan_CalculateSNR(float snr_arr[][9] , int num_repeat , float* result_array );
 static int Scan_SetupCalibScan(float* , float* , float* , float*);
 static int Scan_SetupGeneralScan(float* , float* , float* , float*);
 static void Scan_StoreInSDCard(void);
 static void Scan_GetSensorReadings(float, float, float, float);
 static int Scan_TearDownScanSetup(void);
+static bool Scan_ContinueWarm(void);
+static void Scan_EndContinuousSession(void);
 
 
 /* No. of times to repeat photodetector measurement */
@@ -89,22 +99,34 @@ static int Scan_TearDownScanSetup(void);
 
 #define PGA_SET_RETRY_COUNT 10
 
+/* PGA gain prediction from the previous scan of the same config */
+#define PGA_MAX_GAIN					64
+#define PGA_SATURATION_LEVEL			(MAX_ADC_OUTPUT - (MAX_ADC_OUTPUT >> 5))	// ~97% of full scale
+#define PGA_PREDICT_MAX_TEMP_DELTA		2.0		// degC change in detector temperature
+#define PGA_PREDICT_LAMP_PD_TOLERANCE	10		// max % change in lamp photodiode reading
+
 #define DLPC150_INPUT_FRAME_RATE	60		// input frame rate to DLPC150
 
-/* Declaration of SNR macros */
-#define NUMBER_SCANS        720
-#define NUMBER_BIN_1        90
-#define NUMBER_BIN_2        20
-#define BIN1_SIZE           NUMBER_SCANS/NUMBER_BIN_1
-#define BIN2_SIZE           NUMBER_SCANS/NUMBER_BIN_2
+/* Scan time model; each new measurement moves the estimate by 1/8 of the error */
+#define SCAN_TIME_EWMA_WEIGHT		8
+#define SCAN_TIME_DLPC_CONFIG_MS	150		// default DLPC150 configure time
+#define SCAN_TIME_OVERHEAD_MS		100		// default sensor reading and data processing time
+
+/* Default SNR integration windows for the 17ms, 133ms and 600ms results.
+ * Bins of 8 and 36 repeats with every 4th repeat averaged into the bin */
+#define SNR_BIN1_SIZE       8
+#define SNR_BIN2_SIZE       36
+#define SNR_BIN_STEP        4
 
-/* Global Arrays to store SNR */
+/* SNR results and running statistics of the SNR scan in progress */
 snrData SNRData;
-static float SNR_ScanArr[NUMBER_SCANS][SNR_PATTERNS];
-static float SNR_100ms_bins[NUMBER_BIN_1][SNR_PATTERNS];
-static float SNR_500ms_bins[NUMBER_BIN_2][SNR_PATTERNS];
-static float snrDiff[NUMBER_SCANS];
-static float snrtemp[NUMBER_SCANS];
+static SNR_STATS_WINDOW snrWindows[SNR_STATS_NUM_WINDOWS] =
+{
+	{ 1, 1 },
+	{ SNR_BIN1_SIZE, SNR_BIN_STEP },
+	{ SNR_BIN2_SIZE, SNR_BIN_STEP }
+};
+static SNR_STATS_ACC snrAcc[SNR_STATS_NUM_WINDOWS];
 int g_frameSyncArr[NUM_FRAMEBUFFERS];
 extern int vsync_period_us;
 extern int first_pattern_delay_us;
@@ -143,11 +165,44 @@ static bool scan_dlpc_onoff_control = true;
 static bool scan_index_saved = false;
 static int scan_num_repeats = 1;
 static uint16_t scan_section_num_patterns[SLEW_SCAN_MAX_SECTIONS];
+static uint8_t slew_exec_order[SLEW_SCAN_MAX_SECTIONS] = {0, 1, 2, 3, 4};	// section run in k-th place
+static bool slew_reordered = false;
+static bool scan_general_patterns = false;	// patterns on the DMD come from Scan_SetConfig()
+static uint16_t slew_adc_map[ADC_DATA_LEN];	// run order ADC index -> config order index
 static bool pga_scan;
 static bool isfixedPGA = false;
 static uint8_t fixedPGA = 1;
+static bool scan_continuous = false;
+static bool scan_continuous_store = false;
+static uint16_t scan_continuous_remaining = 0;
+static bool scan_continuous_running = false;
+static bool scan_warm = false;				// lamp, DLPC150, LCD and ADC left on by previous scan
+static uint32_t scan_warm_overhead_ms = 0;	// measured non-pattern time of a warm scan
+
+/* What the last general scan looked like; used to predict the PGA gain of the next one */
+static struct
+{
+	bool		valid;
+	bool		lamp_stable;		// lamp photodiode agreed with the scan before
+	int32_t		norm_peak;			// peak ADC value divided by PGA gain
+	float		detector_temp;
+	uint32_t	lamp_pd;
+	uScanConfig	cfg;
+} pga_history;
+static bool pga_predicted = false;		// gain of the current scan was predicted
+static bool pga_prescan_done = false;	// PGA pre-scan ran as part of the current scan
+static uint32_t pga_prescan_ms = 0;		// measured duration of the last PGA pre-scan
+static PGAPredictStats pga_stats;
+
+/* Measured phase durations of past scans, 0 until the first measurement */
+static struct
+{
+	uint32_t	setup_ms;			// cold general scan setup excluding PGA pre-scan
+	uint32_t	frame_us;			// pattern loop time per displayed frame
+	uint32_t	teardown_ms;		// teardown, sensor reading and data processing
+	uint32_t	sd_write_ms;		// serialize and queue, including waits for a free slot
+} scan_time_model;
 
-extern uint8_t g_dataBlob[];
 extern uint32_t g_FrameTrigger, g_PatternTrigger, g_DRDYTrigger;
 extern uint32_t  g_ui32UnderflowCount;
 extern uint32_t  g_eof0Count;
@@ -199,6 +254,7 @@ static void Scan_RunPatterns(void)
 	long long *p_adc_acc_vals;
 	uint16_t *p_adc_num_vals;
 
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_RUN_PATTERNS_START, 0);
 	g_ui32UnderflowCount = 0;
 	if(ptnSrc == PATTERNS_FROM_RGB_PORT)
 	{
@@ -214,6 +270,7 @@ static void Scan_RunPatterns(void)
 					DEBUG_PRINT("dlpc150_GetLightSensorData failed\n");
 				}
 			}
+			SensorSvc_PublishLampPD(photo_val.green);
 		}
 
 		if(Display_FramePropagationWait() != PASS)
@@ -227,6 +284,7 @@ static void Scan_RunPatterns(void)
 			DEBUG_PRINT("Wait for vsyncs from initial pattern frames timed out\n");
 			return;
 		}
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_FRAMES_PROPAGATED, 0);
 		g_eof0Count=0;
 		g_eof1Count=0;
 	}
@@ -244,6 +302,7 @@ static void Scan_RunPatterns(void)
 	MAP_IntEnable( INT_GPIOP1 );        //Pattern trigger
 
 	Semaphore_pend(endScanSem, BIOS_WAIT_FOREVER);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_RUN_PATTERNS_END, g_scanDataIdx);
 
 	MAP_GPIOIntDisable( GPIO_PORTP_BASE, GPIO_PIN_0 | GPIO_PIN_1 );
 	MAP_IntDisable( INT_GPIOP0 );
@@ -406,7 +465,10 @@ static int Scan_SetPGAGain(uint8_t gain_val)
 	}
 
 	if(result == PASS)
+	{
 		curScanData.pga = gain_val;
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_PGA_SET, gain_val);
+	}
 	else
 	{
 		//make it 0 so that the error is evident to someone looking at it later
@@ -424,6 +486,12 @@ static int Scan_SetPGAGain(uint8_t gain_val)
 
 int Scan_dlpc150_configure(void)
 {
+	int ret = PASS;
+
+	/* Send the whole sequence over one I2C handle. If the port cannot be
+	 * opened, the first command reports it */
+	dlpc150_OpenSession();
+
 	/* Set up the Input Source Select and Pattern Streaming mode */
 	if ( dlpc150_SetUpSource(ptnSrc) )
 	{
@@ -433,10 +501,10 @@ int Scan_dlpc150_configure(void)
 		bleNotificationHandler_sendErrorIndication(NNO_ERROR_SCAN,NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
 	#endif
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true,(int16_t)NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		return FAIL;
+		ret = FAIL;
 	}
 	// Set DLPA2005 LED driver off (it is currently off in the DLPC150 firmware)
-	if ( dlpc150_LampEnable(false) )
+	else if ( dlpc150_LampEnable(false) )
 	{
 		DEBUG_PRINT((" DLPC150: Error Turning off PAD Lamp driver\n" ));
 		NIRscanNano_LampEnable(false);
@@ -447,17 +515,20 @@ int Scan_dlpc150_configure(void)
 #endif
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true,
 				(int16_t)NNO_ERROR_SCAN_DLPC150_LAMP_DRIVER_ERROR);
-		return FAIL;
+		ret = FAIL;
 	}
 
-	return PASS;
+	dlpc150_CloseSession();
+	return ret;
 }
 
 static int Scan_SetupCalibScan(float* ambt1 , float* dett1 , float* boardt1 , float* humt1)
 {
 	float ambientT1, detectorT1;
 	float boardT1, hum1;
+	SENSOR_SNAPSHOT snap;
 
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SETUP_START, 0);
 	MAP_SysCtlPeripheralEnable( SYSCTL_PERIPH_SSI1 );  	// Turn on SSI peripheral
 	if(adc_Wakeup_NoDelay() != PASS)	// Wake-up ADS1255 takes about 32usec
 	{
@@ -476,7 +547,9 @@ static int Scan_SetupCalibScan(float* ambt1 , float* dett1 , float* boardt1 , fl
 				return FAIL;
 	}
 
-	hdc1000_DataTemperatureGetFloat( &boardT1, &hum1 );
+	SensorSvc_GetFresh(&snap, SENSOR_SVC_SCAN_MAX_AGE_MS);
+	boardT1 = snap.board_temp;
+	hum1 = snap.humidity;
 	MAP_LCDRasterEnable(LCD0_BASE);			// Turn on LCD peripheral
 	if(ptnSrc == PATTERNS_FROM_RGB_PORT)
 		MAP_IntEnable( INT_LCD0 );
@@ -496,7 +569,9 @@ static int Scan_SetupCalibScan(float* ambt1 , float* dett1 , float* boardt1 , fl
 				NNO_ERROR_SCAN_ADC_DATA_ERROR);
 		return FAIL;
 	}
-	tmp006_DataTemperatureGetFloat( &ambientT1, &detectorT1 );
+	SensorSvc_GetFresh(&snap, SENSOR_SVC_SCAN_MAX_AGE_MS);
+	ambientT1 = snap.ambient_temp;
+	detectorT1 = snap.detector_temp;
 
 	*ambt1 = ambientT1;
 	*dett1 = detectorT1;
@@ -513,7 +588,12 @@ static int Scan_SetupGeneralScan(float* ambt1 , float* dett1 , float* boardt1 ,
 	int32_t max_adc_data;
 	int result = PASS;
 	uint32_t time1, time2, lampTurnOnTime;
+	uint8_t predicted_pga;
+	uint64_t time_prescan;
+	Types_FreqHz freq;
+	SENSOR_SNAPSHOT snap;
 
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SETUP_START, 1);
 
 	// Turn on DLPA2005 and Lamp Driver 5V supply - 300MS delay max
 	if ( NIRscanNano_DLPCEnable(true) != PASS)
@@ -528,8 +608,11 @@ static int Scan_SetupGeneralScan(float* ambt1 , float* dett1 , float* boardt1 ,
 		return FAIL;
 	}
 
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_DLPC_ON, 0);
+
 	NIRscanNano_LampEnable(true);	// Turn on Lamp Driver
 	time1 = Timestamp_get32();		// Start measuring time Lamp is on
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_LAMP_ON, 0);
 
 	MAP_SysCtlPeripheralEnable( SYSCTL_PERIPH_SSI1 );  	// Turn on SSI peripheral
 	if(adc_Wakeup_NoDelay() != PASS)	// Wake-up ADS1255 takes about 32usec
@@ -543,7 +626,10 @@ static int Scan_SetupGeneralScan(float* ambt1 , float* dett1 , float* boardt1 ,
 		return FAIL;
 	}
 
-	hdc1000_DataTemperatureGetFloat( &boardT1, &hum1 );
+	/* Sensors are sampled in the background; only a stale reading costs I2C time here */
+	SensorSvc_GetFresh(&snap, SENSOR_SVC_SCAN_MAX_AGE_MS);
+	boardT1 = snap.board_temp;
+	hum1 = snap.humidity;
 	if(adc_EmptyReadBuffer() != PASS)
 	{
 #ifdef NIRSCAN_INCLUDE_BLE
@@ -566,20 +652,31 @@ static int Scan_SetupGeneralScan(float* ambt1 , float* dett1 , float* boardt1 ,
 	}
 
 	/* Setup the input source after LCD Enable to get the VSYNCs */
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_DLPC_CONFIGURE_START, 0);
 	if ( Scan_dlpc150_configure() == FAIL)
 	{
 		return FAIL;
 	}
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_DLPC_CONFIGURED, 0);
 
 	MAP_LCDRasterEnable(LCD0_BASE);			// Turn on LCD peripheral
 	if(ptnSrc == PATTERNS_FROM_RGB_PORT)
 		MAP_IntEnable( INT_LCD0 );
 
-	tmp006_DataTemperatureGetFloat( &ambientT1, &detectorT1 );
+	SensorSvc_GetFresh(&snap, SENSOR_SVC_SCAN_MAX_AGE_MS);
+	ambientT1 = snap.ambient_temp;
+	detectorT1 = snap.detector_temp;
+	pga_predicted = false;
+	pga_prescan_done = false;
 	if(isfixedPGA) //do not do this scan if we want a Fixed PGA Gain value
 	{
 		result = Scan_SetPGAGain(fixedPGA);
 	}
+	else if(Scan_PredictPGAGain(detectorT1, &predicted_pga))
+	{
+		result = Scan_SetPGAGain(predicted_pga);
+		pga_predicted = true;
+	}
 	else
 	{
 		result = Scan_SetPGAGain(1);
@@ -606,8 +703,15 @@ static int Scan_SetupGeneralScan(float* ambt1 , float* dett1 , float* boardt1 ,
 	/* Perform single scan to determine PGA gain setting.
 	 * This will be done while lamp stabilizes */
 
-	if(!isfixedPGA) //do not do this scan if we want a Fixed PGA Gain value
+	if(pga_predicted)
 	{
+		pga_stats.num_predicted++;
+		pga_stats.saved_ms += Scan_GetPGAScanTime();
+	}
+	else if(!isfixedPGA) //do not do this scan if we want a Fixed PGA Gain value
+	{
+		time_prescan = Scan_GetTimestamp();
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_PGA_PRESCAN_START, 0);
 		max_adc_data = Scan_GetPeakADCval();
 		if(max_adc_data <= 0)
 		{
@@ -631,6 +735,10 @@ static int Scan_SetupGeneralScan(float* ambt1 , float* dett1 , float* boardt1 ,
 					NNO_ERROR_SCAN_ADC_DATA_ERROR);
 			return FAIL;
 		}
+		Timestamp_getFreq(&freq);
+		pga_prescan_ms = (uint32_t)((Scan_GetTimestamp() - time_prescan) / (freq.lo / 1000));
+		pga_stats.num_prescans++;
+		pga_prescan_done = true;
 	} 
 
 	*ambt1 = ambientT1;
@@ -642,14 +750,28 @@ static int Scan_SetupGeneralScan(float* ambt1 , float* dett1 , float* boardt1 ,
 }
 
 static void Scan_StoreInSDCard(void)
+/*
+ * Serializes the scan into an SD writer slot and queues it; the file is
+ * written by the SD writer task while the next scan runs.
+ */
 {
-	FRESULT fresult;
+	uint8_t *pSlot;
+	uint32_t slot_size;
+	uint32_t length;
 	int result = PASS;
 
 	storeScan = false;
-	result = dlpspec_scan_write_data(GetScanDataPtr(), g_dataBlob,SCAN_DATA_BLOB_SIZE);
+#ifdef HW_SD_CARD_DETECT
+	if (TRUE != nnoStatus_getIndDeviceStatus(NNO_STATUS_SD_CARD_PRESENT))
+		return;
+#endif
+	// without HW detect SW cannot tell if the card is present without read/write
+
+	pSlot = SDWriter_AcquireSlot(&slot_size);
+	result = Scan_SerializeData(pSlot, slot_size, &length);
 	if (result != PASS)
 	{
+		SDWriter_Submit(0, 0, 0);
 #ifdef NIRSCAN_INCLUDE_BLE
 		bleNotificationHandler_sendErrorIndication(NNO_ERROR_SPEC_LIB,
 				(int16_t)result);
@@ -657,29 +779,15 @@ static void Scan_StoreInSDCard(void)
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SPEC_LIB, true,
 				(int16_t)result);
 	}
-#ifndef HW_SD_CARD_DETECT
-	else	// do not check if HW detect is not active; SW cannot tell out without read/write
-#else
-		else if (TRUE == nnoStatus_getIndDeviceStatus(NNO_STATUS_SD_CARD_PRESENT))
-#endif
-		{
-			fresult = FATSD_WriteScanFile(g_dataBlob, SCAN_DATA_BLOB_SIZE , \
-					curScanData.scanDataIndex);
-			if (FR_OK != fresult)
-			{
-				DEBUG_PRINT("ERROR: Writing to u-SD card failed!! Returned error:%d", fresult);
-#ifdef NIRSCAN_INCLUDE_BLE
-				bleNotificationHandler_sendErrorIndication(NNO_ERROR_SD_CARD,(int16_t)fresult);
-#endif
-				nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD,NNO_ERROR_SD_CARD, (int16_t)fresult);
-			}
-		}
+	else
+		SDWriter_Submit(length, curScanData.scanDataIndex, curScanData.scanConfigIndex);
 }
 
 static void Scan_GetSensorReadings(float ambientT1 , float detectorT1 , float boardT1 , float hum1 )
 {
 	float ambientT2, detectorT2;
 	float boardT2, hum2;
+	SENSOR_SNAPSHOT snap;
 
 #ifdef NIRSCAN_INCLUDE_BLE
 	int16_t temperature = 0;
@@ -688,8 +796,11 @@ static void Scan_GetSensorReadings(float ambientT1 , float detectorT1 , float bo
 #endif
 
 	// Read Temperature and Humidity
-	tmp006_DataTemperatureGetFloat( &ambientT2, &detectorT2 );
-	hdc1000_DataTemperatureGetFloat( &boardT2, &hum2 );
+	SensorSvc_GetFresh(&snap, SENSOR_SVC_SCAN_MAX_AGE_MS);
+	ambientT2 = snap.ambient_temp;
+	detectorT2 = snap.detector_temp;
+	boardT2 = snap.board_temp;
+	hum2 = snap.humidity;
 #ifdef NIRSCAN_INCLUDE_BLE
 	TMPAmbientTemp = (ambientT1 + ambientT2)/2;
 
@@ -736,120 +847,74 @@ static int Scan_TearDownScanSetup(void)
 	return PASS;
 }
 
-#define VSYNC_ACTIVE_PATTERN_PERIOD 15240
-
-static void Scan_SetUpSlewScan(uScanConfig *pCfg)
+static int Scan_SetUpSlewScan(uScanConfig *pCfg, bool find_order)
+/*
+ * Packs the slew scan patterns into vsyncs and frames. With find_order set the
+ * section order that needs the fewest frames is chosen first; otherwise the
+ * order chosen by the last Scan_SetConfig() is reused.
+ */
 {
-	int numPattterns_inFrame = 0;
-	int frameNumber_index = 0;
-	int exp_time_us;
-	uint16_t numPatterns_inSection;
+	SLEW_SCHED_SECTION sections[SLEW_SCAN_MAX_SECTIONS];
+	SLEW_SCHED_PLAN plan;
 	uint16_t num_black_patterns_inSection;
+	int section_start_index;
+	int num_sections;
 	int i;
-	int numPatterns_inVsync = 0;
-	int tot_exp_time_inVsync = 0;
-	int vSyncarr_index = 0;
-	int frame_sync_count = 1;
-	int  section_start_index;
 
-	if(pCfg->scanCfg.scan_type == SLEW_TYPE)
+	if(pCfg->scanCfg.scan_type != SLEW_TYPE)
+		return PASS;
+
+	num_sections = pCfg->slewScanCfg.head.num_sections;
+	for(i=0; i<num_sections; i++)
 	{
-		for(i=0; i<pCfg->slewScanCfg.head.num_sections; i++)
-		{
-			exp_time_us = dlpspec_scan_get_exp_time_us((EXP_TIME)pCfg->slewScanCfg.section[i].exposure_time);
-			dlpspec_scan_section_get_adc_data_range(&curSlewScanData, i, &section_start_index, &numPatterns_inSection, &num_black_patterns_inSection);
-			scan_section_num_patterns[i] = numPatterns_inSection + num_black_patterns_inSection;
+		sections[i].exp_time_us = dlpspec_scan_get_exp_time_us((EXP_TIME)pCfg->slewScanCfg.section[i].exposure_time);
+		dlpspec_scan_section_get_adc_data_range(&curSlewScanData, i, &section_start_index, &sections[i].num_patterns, &num_black_patterns_inSection);
+	}
 
-			while(numPatterns_inSection > 0 )
-			{
-				//special case for exposure time > vsync period
-				if(exp_time_us > VSYNC_ACTIVE_PATTERN_PERIOD)
-				{
-					//close out the previous vysnc and start at next
-					if(numPatterns_inVsync != 0)
-					{
-						if(numPattterns_inFrame == 24)
-						{
-							//dark time for the 25th frame. There is always room for the black pattern exposure
-							numPatterns_inVsync++;
-							g_frameSyncArr[frameNumber_index++] = frame_sync_count ;
-							frame_sync_count = 1;
-							numPattterns_inFrame = 0;
-						}
-						g_patternsPerVsyncarr[vSyncarr_index++] = numPatterns_inVsync;
-					}
-					numPattterns_inFrame++;
-					if(exp_time_us > 2*VSYNC_ACTIVE_PATTERN_PERIOD) //4x
-					{
-						g_patternsPerVsyncarr[vSyncarr_index++] = 0;
-						g_patternsPerVsyncarr[vSyncarr_index++] = 0;
-						g_patternsPerVsyncarr[vSyncarr_index++] = 0;
-						if(numPattterns_inFrame == 1)
-							frame_sync_count+=3;
-						else
-							frame_sync_count+=4;
-					}
-					else                                            //2x
-					{
-						g_patternsPerVsyncarr[vSyncarr_index++] = 0;
-						if(numPattterns_inFrame == 1)
-							frame_sync_count++;
-						else
-							frame_sync_count+=2;
-					}
-					numPatterns_inVsync = 1;    //carry over this pattern to next vsync
-					tot_exp_time_inVsync = exp_time_us;
-				}
-				else if((tot_exp_time_inVsync + exp_time_us) > VSYNC_ACTIVE_PATTERN_PERIOD )
-				{
-					if(numPattterns_inFrame == 24)
-					{
-						//dark time for the 25th frame. There is always room for the black pattern exposure
-						numPatterns_inVsync++;
-						g_frameSyncArr[frameNumber_index++] = frame_sync_count ;
-						frame_sync_count = 1;
-						numPattterns_inFrame = 1;
-					}
-					else
-					{
-						frame_sync_count++;
-						numPattterns_inFrame++;
-					}
-					g_patternsPerVsyncarr[vSyncarr_index++] = numPatterns_inVsync;
-					numPatterns_inVsync = 1;    //carry over this pattern to next vsync
-					tot_exp_time_inVsync = exp_time_us;
-				}
-				else
-				{
-					if(numPattterns_inFrame == 24)
-					{
-						//dark time for the 25th frame. There is always room for the black pattern exposure
-						g_patternsPerVsyncarr[vSyncarr_index++] = numPatterns_inVsync + 1;
-						g_frameSyncArr[frameNumber_index++] = frame_sync_count ;
-						frame_sync_count = 1;
-						numPattterns_inFrame = 1;
-						numPatterns_inVsync = 1;
-						tot_exp_time_inVsync = exp_time_us;
-					}
-					else
-					{
-						numPattterns_inFrame++;
-						numPatterns_inVsync++;
-						tot_exp_time_inVsync += exp_time_us;
-					}
-				}
-				numPatterns_inSection--;
-			}
+	if(find_order)
+	{
+		if(SlewSched_FindBestOrder(sections, num_sections, MAX_VSYNCS, NUM_FRAMEBUFFERS, slew_exec_order) < 0)
+		{
+			for(i=0; i<SLEW_SCAN_MAX_SECTIONS; i++)
+				slew_exec_order[i] = i;
 		}
-		if(numPatterns_inVsync != 0)
+		slew_reordered = false;
+		for(i=0; i<num_sections; i++)
 		{
-			g_patternsPerVsyncarr[vSyncarr_index++] = numPatterns_inVsync;
-			g_frameSyncArr[frameNumber_index++] = frame_sync_count;
+			if(slew_exec_order[i] != i)
+				slew_reordered = true;
+		}
+		if(slew_reordered)
+		{
+			if(SlewSched_BuildAdcMap(sections, slew_exec_order, num_sections, slew_adc_map, ADC_DATA_LEN) != PASS)
+				return FAIL;
 		}
-		scan_total_frames = 0;
-		for(i=0; i<frameNumber_index; i++)
-			scan_total_frames += g_frameSyncArr[i];
 	}
+
+	plan.pPatternsPerVsync = g_patternsPerVsyncarr;
+	plan.maxVsyncs = MAX_VSYNCS;
+	plan.pFrameSyncs = g_frameSyncArr;
+	plan.maxFrames = NUM_FRAMEBUFFERS;
+	if(SlewSched_Pack(sections, slew_exec_order, num_sections, &plan) < 0)
+		return FAIL;
+
+	for(i=0; i<num_sections; i++)
+		scan_section_num_patterns[i] = plan.section_num_positions[i];
+	scan_total_frames = plan.totalFrames;
+
+	return PASS;
+}
+
+static void Scan_GetSlewExecConfig(uScanConfig *pExecCfg)
+/*
+ * Copy of curScanConfig with the sections in the order they are run in.
+ */
+{
+	int i;
+
+	memcpy(pExecCfg, &curScanConfig, sizeof(uScanConfig));
+	for(i=0; i<curScanConfig.slewScanCfg.head.num_sections; i++)
+		pExecCfg->slewScanCfg.section[i] = curScanConfig.slewScanCfg.section[slew_exec_order[i]];
 }
 
 void PerformScan()
@@ -864,10 +929,17 @@ void PerformScan()
 	int i;
 	int j;
 	long long *adc_data;
+	int32_t scan_peak;
 	uint32_t eeprom_calib_ver;
 	uint32_t eeprom_config_ver;
 	uScanConfig cfg;
 	uint8_t index;
+	bool keep_warm;
+	bool was_warm;
+	uint64_t time_start, time_ptn_start, time_ptn_end;
+	uint64_t time_setup_end, time_proc_end;
+	bool sd_write;
+	Types_FreqHz freq;
 
 
 #ifdef NIRSCAN_INCLUDE_BLE
@@ -919,10 +991,42 @@ void PerformScan()
 	while ( 1 )
 	{
 		nnoStatus_setDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS, false);	//reset scan status - end of scan?
+
+		/* Continuous run is over once nothing is kept warm; this includes runs
+		 * that were cut short by a scan error */
+		if(scan_continuous_running && !scan_warm)
+		{
+			scan_continuous = false;
+			scan_continuous_running = false;
+		}
+
+		/* Back to idle sensor sampling unless the lamp stays on for the next scan */
+		if(!scan_warm)
+			SensorSvc_SetScanActive(false);
+
 		Semaphore_pend(scanSem, BIOS_WAIT_FOREVER);
+
+		/* Continuous mode was stopped while the lamp and DLPC150 were kept on */
+		if(scan_warm && !scan_continuous)
+		{
+			Scan_EndContinuousSession();
+			continue;
+		}
+
+		time_start = Scan_GetTimestamp();
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SCAN_START, scan_num_repeats);
+		SensorSvc_SetScanActive(true);
+		was_warm = scan_warm;
 		scanFinished = false;
 		nnoStatus_setDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS, true); // set scan status
 
+		if(scan_continuous)
+		{
+			scan_continuous_running = true;
+			if(scan_continuous_store)
+				storeScan = true;
+		}
+
 		//if patterns are from flash, make sure repeat count is initialized to 1.
 		if(ptnSrc == PATTERNS_FROM_FLASH) 
 			scan_num_repeats = 1;
@@ -930,6 +1034,8 @@ void PerformScan()
 		{
 			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, 
 					NNO_ERROR_SCAN_CFG_INVALID);
+			if(scan_warm)
+				Scan_EndContinuousSession();
 			continue;
 		}
 
@@ -943,7 +1049,12 @@ void PerformScan()
 		pga_scan = true;
 
 		//Enable DLPC and switch on the lamp at the start of all the scans
-		if(scan_dlpc_onoff_control == true)
+		//unless they are still on from the previous scan in continuous mode
+		if(scan_warm)
+		{
+			/* PGA gain and sensor readings from the first scan are reused */
+		}
+		else if(scan_dlpc_onoff_control == true)
 		{
 			if(PASS != Scan_SetupGeneralScan(&ambientT1 , &detectorT1 , &boardT1 , &hum1))
 				continue;
@@ -955,8 +1066,10 @@ void PerformScan()
 		}
 
 		pga_scan = false;
+		time_setup_end = Scan_GetTimestamp();
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SETUP_END, 0);
 		/* Initialize slew scan arrays now */
-		Scan_SetUpSlewScan(&curScanConfig);
+		Scan_SetUpSlewScan(&curScanConfig, false);
 
 		if(scan_with_subimage)
 		{
@@ -973,6 +1086,12 @@ void PerformScan()
 			}
 		}
 
+		if(ScanStream_IsEnabled())
+			ScanStream_Begin(scan_num_repeats);
+
+		time_ptn_start = Scan_GetTimestamp();
+		scan_peak = 0;
+
 		for(i=0; i<scan_num_repeats; i++)
 		{
 			if(i==0)
@@ -987,7 +1106,20 @@ void PerformScan()
 
 			adc_data = Trig_GetADCAccDataPtr();
 
-			if(i==0)
+			if(slew_reordered)	//sections were run out of order; store in config order
+			{
+				if(i==0)
+				{
+					for(j=0;j<curScanData.adc_data_length;j++)
+						curScanData.adc_data[slew_adc_map[j]] = adc_data[j];
+				}
+				else
+				{
+					for(j=0;j<curScanData.adc_data_length;j++)
+						curScanData.adc_data[slew_adc_map[j]] += adc_data[j];
+				}
+			}
+			else if(i==0)
 			{
 				for(j=0;j<curScanData.adc_data_length;j++)
 					curScanData.adc_data[j] = adc_data[j];
@@ -997,18 +1129,48 @@ void PerformScan()
 				for(j=0;j<curScanData.adc_data_length;j++)
 					curScanData.adc_data[j] += adc_data[j];
 			}
+			for(j=0;j<curScanData.adc_data_length;j++)
+			{
+				if(adc_data[j] > scan_peak)
+					scan_peak = adc_data[j];
+			}
+			/* Publish this repeat so that the host can start using it while the
+			 * remaining repeats run */
+			if(ScanStream_IsEnabled())
+			{
+				ScanStream_Publish(i, adc_data, curScanData.adc_data_length,
+						(slew_reordered) ? slew_adc_map : NULL);
+#ifdef NIRSCAN_INCLUDE_BLE
+				if (isBLEConnActive())
+				{
+					bleNotifyData[0] = 0x02;
+					bleNotifyData[1] = (0x00ff & i);
+					bleNotifyData[2] = (0xff00 & i) >> 8;
+					bleNotifyData[3] = (0x00ff & scan_num_repeats);
+					bleNotifyData[4] = (0xff00 & scan_num_repeats) >> 8;
+
+					/* Also gets the BLE task to notify the repeat to a client
+					 * that takes the scan stream */
+					if ((0 == bleNotificationHandler_setNotificationData(BLE_NOTIFY_SCAN_STATUS,\
+								5, &bleNotifyData[0])) || bleNotificationHandler_isScanStreamOn())
+						Semaphore_post(BLENotifySem);
+				}
+#endif
+			}
 			if(scan_snr_savedata)
 			{
-				for(j=0;j<curScanData.adc_data_length;j++)
-					SNR_ScanArr[i][j] = (float)adc_data[j];
+				for(j=0;j<SNR_STATS_NUM_WINDOWS;j++)
+					SnrStats_AddRepeat(&snrAcc[j], adc_data, curScanData.adc_data_length,
+							(slew_reordered) ? slew_adc_map : NULL);
 			}
 			if(scan_had_snr_savedata)
 			{
 				for(j=0;j<curScanData.adc_data_length;j++)
 				{
-					SNR_HadArr[i / HADSNR_BIN_SIZE][j] += adc_data[j];
+					SNR_HadArr[i / HADSNR_BIN_SIZE][(slew_reordered) ? slew_adc_map[j] : j] += adc_data[j];
 				}
 			}
+			SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_REPEAT_DONE, i);
 		}
 
 		if(scan_had_snr_savedata)
@@ -1018,8 +1180,22 @@ void PerformScan()
 					SNR_HadArr[i][j] = SNR_HadArr[i][j] / HADSNR_BIN_SIZE;
 		}
 
-		if(PASS != Scan_TearDownScanSetup())
-			continue;
+		time_ptn_end = Scan_GetTimestamp();
+
+		/* Calibration and flash pattern peaks say nothing about the gain
+		 * the next general scan needs */
+		if((scan_dlpc_onoff_control == true) && scan_general_patterns &&
+				(ptnSrc == PATTERNS_FROM_RGB_PORT))
+			Scan_UpdatePGAHistory(scan_peak, detectorT1);
+
+		keep_warm = Scan_ContinueWarm();
+		if(!keep_warm)
+		{
+			scan_warm = false;
+			scan_warm_overhead_ms = 0;
+			if(PASS != Scan_TearDownScanSetup())
+				continue;
+		}
 
 		Scan_GetSensorReadings(ambientT1 , detectorT1 , boardT1 , hum1);
 
@@ -1027,7 +1203,7 @@ void PerformScan()
 
 #ifndef LEAVE_PATTERNS_ON
 		//switch off the lamp and DLPC if we are controlling ON OFF
-		if(scan_dlpc_onoff_control == true)
+		if((scan_dlpc_onoff_control == true) && !keep_warm)
 		{
 			NIRscanNano_LampEnable(false);
 			NIRscanNano_DLPCEnable(false);
@@ -1044,19 +1220,43 @@ void PerformScan()
 
 		if(scan_snr_savedata)
 		{
-			Scan_CalculateSNR_17ms();
-			Scan_CalculateSNR_133ms();
-			Scan_CalculateSNR_600ms();
+			SnrStats_GetSNR(&snrAcc[0], SNRData.snr_17ms);
+			SnrStats_GetSNR(&snrAcc[1], SNRData.snr_100ms);
+			SnrStats_GetSNR(&snrAcc[2], SNRData.snr_500ms);
 			scan_snr_savedata = false;
 		}
 
+		if(ScanStream_IsEnabled())
+			ScanStream_PublishAverage(curScanData.adc_data, curScanData.adc_data_length);
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_PROCESSING_DONE, 0);
+		time_proc_end = Scan_GetTimestamp();
+
+		sd_write = storeScan;
 		if(storeScan)
 		{
 			Scan_StoreInSDCard();
 		}
+
+		/* Setup and teardown are only modelled for general scans that did them */
+		Scan_UpdateTimeModel(
+				(!was_warm && scan_dlpc_onoff_control) ? (time_setup_end - time_start) : 0,
+				time_ptn_end - time_ptn_start,
+				(!keep_warm && scan_dlpc_onoff_control) ? (time_proc_end - time_ptn_end) : 0,
+				sd_write ? (Scan_GetTimestamp() - time_proc_end) : 0);
+
+		/* Per-scan overhead of a warm scan is everything except the pattern loop.
+		 * The last scan of a run powers down and has no warm successor */
+		if(was_warm && keep_warm)
+		{
+			Timestamp_getFreq(&freq);
+			scan_warm_overhead_ms = (uint32_t)(((Scan_GetTimestamp() - time_start) -
+					(time_ptn_end - time_ptn_start)) / (freq.lo / 1000));
+		}
+
 		UnlockScanButton();
 		scanFinished = true;
 		scan_had_snr_savedata = false;
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SCAN_END, 0);
 
 #ifdef NIRSCAN_INCLUDE_BLE
 		if (isBLEConnActive())		// To be moved to a more appropriate place later
@@ -1067,14 +1267,60 @@ void PerformScan()
 			bleNotifyData[3] = (0x00ff0000 & curScanData.scanDataIndex) >> 16;
 			bleNotifyData[4] = (0xff000000 & curScanData.scanDataIndex) >> 24;
 
-			if (0 == bleNotificationHandler_setNotificationData(BLE_NOTIFY_SCAN_STATUS,\
-						5, &bleNotifyData[0]))
+			if ((0 == bleNotificationHandler_setNotificationData(BLE_NOTIFY_SCAN_STATUS,\
+						5, &bleNotifyData[0])) || bleNotificationHandler_isScanStreamOn())
 				Semaphore_post(BLENotifySem);
 		}
 #endif
+		/* Queue the next back-to-back scan with everything left on */
+		scan_warm = keep_warm;
+		if(keep_warm)
+			Semaphore_post(scanSem);
 	}
 }
 
+static bool Scan_ContinueWarm(void)
+	/*
+	 * Decides at the end of a scan whether lamp, DLPC150, LCD raster and ADC are
+	 * to be left on for another back-to-back scan and counts down the number of
+	 * continuous scans remaining.
+	 *
+	 * @return true if another scan follows in continuous mode
+	 */
+{
+	if(!scan_continuous)
+		return false;
+
+	if(scan_continuous_remaining != 0)
+	{
+		if(--scan_continuous_remaining == 0)
+		{
+			scan_continuous = false;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void Scan_EndContinuousSession(void)
+	/*
+	 * Turns off everything that was kept on between continuous scans when the
+	 * host stops continuous mode in between two scans.
+	 */
+{
+	scan_warm = false;
+	scan_warm_overhead_ms = 0;
+	Scan_TearDownScanSetup();
+#ifndef LEAVE_PATTERNS_ON
+	if(scan_dlpc_onoff_control == true)
+	{
+		NIRscanNano_LampEnable(false);
+		NIRscanNano_DLPCEnable(false);
+	}
+#endif
+}
+
 static void Scan_GenSlewScanData(void)
 {
 	size_t copy_size = sizeof(slewScanData) - sizeof(int32_t)*ADC_DATA_LEN - sizeof(slewScanConfig);
@@ -1130,6 +1376,35 @@ uScanData *GetScanDataPtr(void)
 
 }
 
+int Scan_SerializeData(void *pBuf, uint32_t buf_size, uint32_t *pLength)
+	/**
+	 * Serializes the last scan for the SD card or the host. With
+	 * NIRSCAN_PACK_ADC_DATA the ADC data of slew scans is packed and only
+	 * the bytes used are reported; otherwise the whole buffer is.
+	 *
+	 * @param pBuf     - O - buffer for the serialized scan
+	 * @param buf_size - I - size of pBuf, at least SCAN_DATA_BLOB_SIZE
+	 * @param pLength  - O - bytes of pBuf to store or send
+	 *
+	 * @return PASS or the dlpspec error code
+	 *
+	 */
+{
+	int result;
+#ifdef NIRSCAN_PACK_ADC_DATA
+	size_t length = 0;
+
+	result = dlpspec_scan_write_data_encoded(GetScanDataPtr(), pBuf, buf_size,
+			ADC_DATA_ENCODING_RICE, &length);
+	*pLength = (result == PASS) ? length : 0;
+#else
+	result = dlpspec_scan_write_data(GetScanDataPtr(), pBuf, buf_size);
+	*pLength = (result == PASS) ? buf_size : 0;
+#endif
+
+	return result;
+}
+
 bool Scan_IsScanComplete()
 	/** function shall be used to query scan completion status
 	 *
@@ -1154,6 +1429,46 @@ void Scan_DLPCOnOffControl(bool enable)
 	scan_dlpc_onoff_control = enable;
 }
 
+int Scan_SetContinuousMode(uint16_t num_scans, bool store_in_sd)
+	/**
+	 * Sets up continuous mode for the scans that follow. Lamp, DLPC150, LCD raster
+	 * and ADC are set up once and kept on until the requested number of scans has
+	 * completed or Scan_StopContinuousMode() is called. Only the pattern loop and
+	 * header population are repeated for each scan. The caller posts scanSem to
+	 * start the first scan.
+	 *
+	 * @param num_scans   - I - number of back-to-back scans; 0 = until stopped
+	 * @param store_in_sd - I - store every scan of the run to SD card
+	 *
+	 * @return PASS or FAIL
+	 */
+{
+	if(scan_continuous || scan_warm)
+		return FAIL;
+
+	scan_continuous_remaining = num_scans;
+	scan_continuous_store = store_in_sd;
+	scan_continuous = true;
+
+	return PASS;
+}
+
+void Scan_StopContinuousMode(void)
+	/**
+	 * Stops continuous mode. The scan in progress, if any, completes normally and
+	 * lamp and DLPC150 are turned off after it.
+	 *
+	 * @return none
+	 */
+{
+	scan_continuous = false;
+}
+
+bool Scan_IsContinuousMode(void)
+{
+	return (scan_continuous || scan_warm);
+}
+
 int Scan_SetPatternSource(int src)
 	/** 
 	 * This function to be always called prior to performing a scan.
@@ -1224,6 +1539,13 @@ int Scan_SetActiveConfig(uint8_t index)
 int Scan_SetCalibPatterns(CALIB_SCAN_TYPES calib_type)
 {
 	int numPatterns;
+	int i;
+
+	/* Calibration patterns are always run in the order they are generated */
+	slew_reordered = false;
+	scan_general_patterns = false;
+	for(i=0; i<SLEW_SCAN_MAX_SECTIONS; i++)
+		slew_exec_order[i] = i;
 	
 	numPatterns = Display_GenCalibPatterns(calib_type);
 	
@@ -1243,7 +1565,9 @@ int Scan_SetConfig(uScanConfig *pCfg)
 	 */
 {
 	int num_patterns;
+	uScanConfig execCfg;
 
+	scan_general_patterns = false;
 	if(pCfg->scanCfg.scan_type != SLEW_TYPE)
 	{
 		/* Start Error Checking */
@@ -1262,6 +1586,7 @@ int Scan_SetConfig(uScanConfig *pCfg)
 
 		memcpy(&curScanConfig, pCfg, sizeof(uScanConfig));
 		Scan_SetNumRepeats(pCfg->scanCfg.num_repeats);
+		slew_reordered = false;
 	}
 	else
 	{
@@ -1277,10 +1602,18 @@ int Scan_SetConfig(uScanConfig *pCfg)
 		Scan_SetNumRepeats(pCfg->slewScanCfg.head.num_repeats);
 		Scan_PopulateScanDataHeader();
 		Scan_GenSlewScanData();
-		Scan_SetUpSlewScan(&curScanConfig);
+		if(Scan_SetUpSlewScan(&curScanConfig, true) != PASS)
+			return FAIL;
 	}
 
-	num_patterns = Display_GenScanPatterns(pCfg);
+	if(slew_reordered)
+	{
+		/* Patterns have to be generated in the order the sections are run */
+		Scan_GetSlewExecConfig(&execCfg);
+		num_patterns = Display_GenScanPatterns(&execCfg);
+	}
+	else
+		num_patterns = Display_GenScanPatterns(pCfg);
 
 	/* Prevent frame buffer overflow */
 	if(num_patterns > MAX_PATTERNS_PER_SCAN)
@@ -1292,6 +1625,7 @@ int Scan_SetConfig(uScanConfig *pCfg)
 		scan_total_frames = num_patterns/NUM_BP_PER_FRAME + 1;
 
 	Scan_SetNumPatternsToScan(num_patterns);
+	scan_general_patterns = (num_patterns > 0);
 	return num_patterns;
 }
 
@@ -1347,186 +1681,53 @@ int Scan_StoreToSDcard(void)
 
 int Scan_SNRDataCapture(void)
 	/**
-	 * Call this API to capture 720x9 array for SNR computation
-	 * This is done by running 9 patterns for each scan with
-	 * 720 scans.
-	 *
-	 * @return PASS or FAIL
-	 */
-{
-	scan_snr_savedata = true;
-
-	return PASS;
-}
-
-int Scan_HadSNRDataCapture(void)
-{
-	scan_had_snr_savedata = true;
-	memset(&SNR_HadArr[0][0],0,HADSNR_NUM_DATA*HADSNR_LENGTH*sizeof(int));
-
-	return PASS;
-}
-
-static int Scan_CalculateSNR_17ms(void)
-	/**
-	 * This API calculates and stores the SNR for each 9
-	 * patterns at 17ms interval(one frame time). The maximum
-	 * of these 9 patterns is taken as the SNR values for
-	 * 17ms interval.
-	 *
-	 * @return PASS or FAIL
-	 */
-{
-	Scan_CalculateSNR(SNR_ScanArr , NUMBER_SCANS  , SNRData.snr_17ms );
-
-	return PASS;
-}
-
-static int Scan_CalculateSNR_133ms(void)
-	/**
-	 * This API calculates and stores the SNR for each 9
-	 * patterns at 133ms interval. The maximum
-	 * of these 9 patterns is taken as the SNR values for
-	 * 133ms interval. The 90 scans are binned and averaged
-	 * before calculating the SNR
+	 * Call this API to compute SNR from the next scan. Each repeat is
+	 * folded into running statistics of the three integration windows as
+	 * it completes, so the number of repeats is not limited by memory.
+	 * Typically run with 9 patterns per scan and 720 repeats.
 	 *
 	 * @return PASS or FAIL
 	 */
 {
-	/*Bin and average the 720x9 array */
-	Scan_BinandAverage(SNR_ScanArr , NUMBER_SCANS  , BIN1_SIZE  , SNR_100ms_bins);
-
-	/* Calculate SNR */
-	Scan_CalculateSNR(SNR_100ms_bins , NUMBER_BIN_1 , SNRData.snr_100ms);
-
-	return PASS;
-}
-
-static int Scan_CalculateSNR_600ms(void)
-	/**
-	 * This API calculates and stores the SNR for each 9
-	 * patterns at 600ms interval. The maximum
-	 * of these 9 patterns is taken as the SNR values for
-	 * 600ms interval. The 20 scans are binned and averaged
-	 * before calculating the SNR
-	 *
-	 * @return PASS or FAIL
-	 */
-{
-	/*Bin and average the 720x9 array */
-	Scan_BinandAverage(SNR_ScanArr , NUMBER_SCANS  , BIN2_SIZE  , SNR_500ms_bins);
-
-	/* Calculate SNR */
-	Scan_CalculateSNR(SNR_500ms_bins , NUMBER_BIN_2 , SNRData.snr_500ms );
-
-	return PASS;
-}
-
-static int Scan_BinandAverage(float scanArr[][SNR_PATTERNS] , int num_repeats , int steps , float resultArr[][SNR_PATTERNS])
-	/**
-	 * This API does binning and averaging for 720x9 array. The bin size is 90 for 133ms snr and 20 for
-	 * 600ms snr value.
-	 *
-	 * @param scanArr       -I- Array of 720x9 values
-	 *        num_repeats   -I- No. of scans. The number of repeats to extract one row of 720 elements
-	 *        steps         -I- number of patterns jumped to get the required time
-	 *        resultArr     -O- Bins to be used for SNR calculation
-	 *
-	 * @return PASS or FAIL
-	 */
-{
-	int i , j , k;
-	float sum =0.0;
-	int countbin=0;
-	int countscan=0;
+	int i;
 
-	for(j=0 ; j<SNR_PATTERNS ; j++)
+	for(i=0; i<SNR_STATS_NUM_WINDOWS; i++)
 	{
-		countbin = 0;
-		for(i=0; i<num_repeats/*720*/ ; i+=steps/*8*/)
-		{
-			for(k=i ; k<i+steps ; k+=4)
-			{
-				sum += scanArr[k][j];
-				countscan++;
-			}
-
-			resultArr[countbin][j]= (float)sum/(float)countscan;
-			countscan = 0;
-			countbin++;
-			sum = 0;
-		}
+		if(SnrStats_Init(&snrAcc[i], &snrWindows[i]) != PASS)
+			return FAIL;
 	}
+	scan_snr_savedata = true;
+
 	return PASS;
 }
 
-static void find_meanstandard_deviation(float* data, int n , float* average , float* std)
+int Scan_SNRSetWindow(int index, uint16_t bin_size, uint16_t sample_step)
 	/**
-	 * This API calculates the mean and standard deviation of the input array.
+	 * Changes the integration window of one of the SNR results. Takes effect
+	 * from the next SNR scan.
 	 *
-	 * @param data          -I- Pointer to array of values
-	 *        n             -I- Size of the input array
-	 *        average       -O- calculated average of the array of values
-	 *        std           -O- calculated standard deviation of the array of values
+	 * @param index       - I - 0 = 17ms, 1 = 133ms, 2 = 600ms result
+	 * @param bin_size    - I - repeats per bin
+	 * @param sample_step - I - every sample_step-th repeat of a bin is averaged
 	 *
 	 * @return PASS or FAIL
 	 */
 {
-	float mean=0.0, sum_deviation=0.0;
-	int i;
-	for(i=0; i<n;++i)
-	{
-		mean+=data[i];
-	}
-	mean=mean/n;
-	*average = mean;
-
-	for(i=0; i<n;++i)
-		sum_deviation+=(data[i]-mean)*(data[i]-mean);
-
-	*std = sqrt(sum_deviation/n);
+	if((index < 0) || (index >= SNR_STATS_NUM_WINDOWS))
+		return FAIL;
+	if((bin_size == 0) || (sample_step == 0) || (sample_step > bin_size))
+		return FAIL;
 
-	return;
+	snrWindows[index].bin_size = bin_size;
+	snrWindows[index].sample_step = sample_step;
 
+	return PASS;
 }
 
-static int Scan_CalculateSNR(float snr_arr[][SNR_PATTERNS] , int num_repeat , float* result_array )
-	/**
-	 * This API calculates the SNR of 9 patterns for different time intervals based on bins.
-	 * The formula is SNR = AVERAGE(A)/STANDARD_DEVIATION(D) where A is the values array and
-	 * D is difference array of A.
-	 *
-	 * @param snr_arr       -I- Array of bins
-	 *        num_repeat    -I- number of scans to loop through
-	 *        result_array  -O- result of SNR for 9 patterns each
-	 *
-	 * @return PASS or FAIL
-	 */
+int Scan_HadSNRDataCapture(void)
 {
-	int i , j ;
-	int count = 0;
-
-	float avg=0.0  , std = 0.0 , avgdummy= 0.0 , stddummy = 0.0;
-
-	for(j=0; j<SNR_PATTERNS ; j++)
-	{
-		for(i=0 ; i<num_repeat ; i++)
-		{
-			snrtemp[i] = snr_arr[i][j];
-
-			if(i>0 && i<NUMBER_SCANS)
-			{
-
-				count++;
-				snrDiff[i-1] = snrtemp[i]-snrtemp[i-1];
-			}
-			find_meanstandard_deviation(snrtemp, num_repeat  , &avg , &stddummy);
-			find_meanstandard_deviation(snrDiff, count  , &avgdummy , &std);
-			result_array[j] = (float)avg/std;
-
-		}
-		count = 0;
-	}
+	scan_had_snr_savedata = true;
+	memset(&SNR_HadArr[0][0],0,HADSNR_NUM_DATA*HADSNR_LENGTH*sizeof(int));
 
 	return PASS;
 }
@@ -1561,11 +1762,15 @@ static int32_t  Scan_GetPeakADCval(void)
 
 #define MAX_RESOLUTION_LESS_TENPERCENT 7549747
 static int Scan_AdjustPGAGain(int32_t max_adc_data)
+{
+	return Scan_SetPGAGain(Scan_ComputePGAGain(max_adc_data));
+}
+
+static uint8_t Scan_ComputePGAGain(int32_t max_adc_data)
 {
 	float pga_ratio_mult = 1.0;
 	uint32_t temp_pga = 0;
 	uint8_t	new_pga = 0;
-	int32_t result = PASS;
 
 	/*Calculate PGA gain value*/
 
@@ -1585,51 +1790,232 @@ static int Scan_AdjustPGAGain(int32_t max_adc_data)
 	else
 		temp_pga = 1 << new_pga;
 
-	result = Scan_SetPGAGain((uint8_t)temp_pga);
-	return result;
+	return (uint8_t)temp_pga;
 }
 
-uint32_t Scan_ComputeScanTime()
-	/** Returns the estimated scan time in milliseconds
-	 *  Make sure the requied scanConfig and numRepeats are set
-	 *  before calling this function to query estimated scan time.
-	 */
+static bool Scan_PredictPGAGain(float detector_temp, uint8_t *p_gain)
+/*
+ * Predicts the PGA gain from the last general scan instead of running the
+ * pre-scan. Only done when that scan used the same config, did not
+ * saturate, had a peak in the useful range, the lamp output was steady and
+ * the detector temperature has not moved much since.
+ */
+{
+	if(!scan_general_patterns || (ptnSrc != PATTERNS_FROM_RGB_PORT))
+		return false;
+
+	if(!pga_history.valid || !pga_history.lamp_stable)
+		return false;
+
+	if(memcmp(&pga_history.cfg, &curScanConfig, sizeof(uScanConfig)) != 0)
+		return false;
+
+	if(fabs(detector_temp - pga_history.detector_temp) > PGA_PREDICT_MAX_TEMP_DELTA)
+		return false;
+
+	*p_gain = Scan_ComputePGAGain(pga_history.norm_peak);
+	return true;
+}
+
+static void Scan_UpdatePGAHistory(int32_t peak_adc_data, float detector_temp)
+{
+	bool saturated = (peak_adc_data >= PGA_SATURATION_LEVEL);
+	uint32_t lamp_pd = photo_val.green;
+	uint32_t lamp_pd_delta;
+
+	if(saturated && pga_predicted)
+		pga_stats.num_saturated++;
+
+	lamp_pd_delta = (lamp_pd > pga_history.lamp_pd) ? (lamp_pd - pga_history.lamp_pd) :
+			(pga_history.lamp_pd - lamp_pd);
+	pga_history.lamp_stable = (pga_history.lamp_pd != 0) &&
+			(lamp_pd_delta * 100 <= pga_history.lamp_pd * PGA_PREDICT_LAMP_PD_TOLERANCE);
+	pga_history.lamp_pd = lamp_pd;
+
+	/* A low peak is only trusted if the gain could not have gone higher */
+	pga_history.valid = !saturated && (curScanData.pga != 0) &&
+			((peak_adc_data >= MAX_RESOLUTION_LESS_TENPERCENT/4) || (curScanData.pga == PGA_MAX_GAIN));
+	if(pga_history.valid)
+	{
+		pga_history.norm_peak = peak_adc_data / curScanData.pga;
+		pga_history.detector_temp = detector_temp;
+		memcpy(&pga_history.cfg, &curScanConfig, sizeof(uScanConfig));
+	}
+}
+
+static uint32_t Scan_GetPGAScanTime(void)
+/*
+ * Time a PGA pre-scan takes; measured once one has run, estimated before that.
+ */
 {
-	uint32_t scan_time = 0;
-	uint32_t pga_scan_num_frames = 0;
 	uint32_t num_ptns = 0;
 	uint32_t i;
 
+	if(pga_prescan_ms != 0)
+		return pga_prescan_ms;
+
+	if(curScanConfig.scanCfg.scan_type != SLEW_TYPE)
+	{
+		num_ptns = Scan_GetSectionNumPatterns(0);
+	}
+	else
+	{
+		for(i=0; i<curScanConfig.slewScanCfg.head.num_sections; i++)
+			num_ptns += Scan_GetSectionNumPatterns(i);
+	}
+
+	return (uint32_t)(((double)(num_ptns/NUM_BP_PER_FRAME + 1 + PATTERN_DISPLAY_DELAY_NUM_FRAMES) * \
+				(double)(1.0/(double)DLPC150_INPUT_FRAME_RATE)) * 1000.0);
+}
+
+void Scan_GetPGAPredictStats(PGAPredictStats *pStats)
+	/**
+	 * Returns how often the PGA pre-scan was skipped by predicting the gain from
+	 * the previous scan and how much scan time that saved.
+	 *
+	 * @param pStats - O - counters since power up
+	 *
+	 * @return none
+	 */
+{
+	memcpy(pStats, &pga_stats, sizeof(PGAPredictStats));
+}
+
+static uint32_t Scan_TimeModelEwma(uint32_t estimate, uint32_t sample)
+{
+	if(estimate == 0)
+		return sample;
+
+	return (uint32_t)((int32_t)estimate +
+			((int32_t)sample - (int32_t)estimate) / SCAN_TIME_EWMA_WEIGHT);
+}
+
+static uint64_t Scan_GetTimestamp(void)
+	/*
+	 * 64-bit timestamp for phase durations. The 32-bit one wraps after about
+	 * 35 s at 120 MHz, which a long scan with many repeats easily exceeds.
+	 */
+{
+	Types_Timestamp64 ts;
+
+	Timestamp_get64(&ts);
+	return ((uint64_t)ts.hi << 32) | ts.lo;
+}
+
+static void Scan_UpdateTimeModel(uint64_t setup_ticks, uint64_t ptn_ticks, uint64_t proc_ticks,
+		uint64_t sd_ticks)
+	/*
+	 * Folds the phase durations of the scan just finished into the scan time
+	 * model. A duration of 0 means the phase was not run or not representative
+	 * in this scan and leaves its estimate unchanged.
+	 */
+{
+	Types_FreqHz freq;
+	uint32_t ticks_per_ms;
+	uint32_t setup_ms;
+	uint32_t num_frames;
+
+	Timestamp_getFreq(&freq);
+	ticks_per_ms = freq.lo / 1000;
+
+	if(setup_ticks != 0)
+	{
+		setup_ms = (uint32_t)(setup_ticks / ticks_per_ms);
+		if(pga_prescan_done)
+			setup_ms = (setup_ms > pga_prescan_ms) ? (setup_ms - pga_prescan_ms) : 0;
+		scan_time_model.setup_ms = Scan_TimeModelEwma(scan_time_model.setup_ms, setup_ms);
+	}
+
+	num_frames = (scan_total_frames + PATTERN_DISPLAY_DELAY_NUM_FRAMES) * scan_num_repeats;
+	if((ptn_ticks != 0) && (num_frames != 0))
+		scan_time_model.frame_us = Scan_TimeModelEwma(scan_time_model.frame_us,
+				(uint32_t)((ptn_ticks * 1000) / ticks_per_ms / num_frames));
+
+	if(proc_ticks != 0)
+		scan_time_model.teardown_ms = Scan_TimeModelEwma(scan_time_model.teardown_ms,
+				(uint32_t)(proc_ticks / ticks_per_ms));
+
+	if(sd_ticks != 0)
+		scan_time_model.sd_write_ms = Scan_TimeModelEwma(scan_time_model.sd_write_ms,
+				(uint32_t)(sd_ticks / ticks_per_ms));
+}
+
+void Scan_GetScanTimeEstimate(ScanTimeEstimate *pEst)
+	/**
+	 * Predicts the duration of the next scan, broken down into phases. Phases
+	 * use the durations measured on this device once a scan has run and the
+	 * nominal values before that.
+	 * Make sure the requied scanConfig and numRepeats are set
+	 * before calling this function.
+	 *
+	 * @param pEst - O - total and per phase estimate in milliseconds
+	 *
+	 * @return none
+	 */
+{
+	bool pga_predict;
+	uint32_t frame_us;
+	int i;
+
+	memset(pEst, 0, sizeof(ScanTimeEstimate));
+
+	// Lamp, DLPC150 and LCD stay on between continuous scans; use measured overhead.
+	// The first scan of a run starts cold and pays the full setup
+	if(scan_continuous && scan_warm && (scan_warm_overhead_ms != 0))
+	{
+		pEst->phase_ms[SCAN_PHASE_SETUP] = scan_warm_overhead_ms;
+	}
 	// Standard delays per scan
-	if(scan_dlpc_onoff_control == true)
+	else if(scan_dlpc_onoff_control == true)
 	{
-		scan_time += (DLPC_ENABLE_MAX_DELAY/DELAY_1MS);
-		scan_time += (LAMP_STABLIZE_DELAY/DELAY_1MS);
-		scan_time += 150; //150ms DLPC150 configure time
+		if(scan_time_model.setup_ms != 0)
+			pEst->phase_ms[SCAN_PHASE_SETUP] = scan_time_model.setup_ms;
+		else
+			pEst->phase_ms[SCAN_PHASE_SETUP] = (DLPC_ENABLE_MAX_DELAY/DELAY_1MS) +
+				(LAMP_STABLIZE_DELAY/DELAY_1MS) + SCAN_TIME_DLPC_CONFIG_MS;
 
-		if(curScanConfig.scanCfg.scan_type != SLEW_TYPE)
-		{
-			num_ptns = Scan_GetSectionNumPatterns(0);
-		}
+		// add pga scan time unless the gain is expected to be predicted
+		pga_predict = !isfixedPGA && pga_history.valid && pga_history.lamp_stable &&
+				(memcmp(&pga_history.cfg, &curScanConfig, sizeof(uScanConfig)) == 0);
+		if(!pga_predict && !isfixedPGA)
+			pEst->phase_ms[SCAN_PHASE_PGA] = Scan_GetPGAScanTime();
+
+		if(scan_time_model.teardown_ms != 0)
+			pEst->phase_ms[SCAN_PHASE_TEARDOWN] = scan_time_model.teardown_ms;
 		else
-		{
-			for(i=0; i<curScanConfig.slewScanCfg.head.num_sections; i++)
-				num_ptns += Scan_GetSectionNumPatterns(i);
-		}
-		pga_scan_num_frames = num_ptns/NUM_BP_PER_FRAME + 1;
-		// add pga scan time
-		scan_time += (uint32_t)(((double)(pga_scan_num_frames + PATTERN_DISPLAY_DELAY_NUM_FRAMES) * \
-					(double)(1.0/(double)DLPC150_INPUT_FRAME_RATE)) * 1000.0);
+			pEst->phase_ms[SCAN_PHASE_TEARDOWN] = SCAN_TIME_OVERHEAD_MS;
 	}
-	scan_time += 100; //100ms added for overheads like sensor reading and scan data processing.
+	else
+	{
+		pEst->phase_ms[SCAN_PHASE_TEARDOWN] = SCAN_TIME_OVERHEAD_MS;
+	}
+
+	// Pattern display delay plus frames per repeat times num repeats
+	if(scan_time_model.frame_us != 0)
+		frame_us = scan_time_model.frame_us;
+	else
+		frame_us = 1000000 / DLPC150_INPUT_FRAME_RATE;
+	pEst->phase_ms[SCAN_PHASE_PATTERNS] = (uint32_t)(((uint64_t)(scan_total_frames +
+			PATTERN_DISPLAY_DELAY_NUM_FRAMES) * scan_num_repeats * frame_us) / 1000);
+
+	if(storeScan)
+		pEst->phase_ms[SCAN_PHASE_SD_WRITE] = scan_time_model.sd_write_ms;
+
+	for(i=0; i<SCAN_NUM_PHASES; i++)
+		pEst->total_ms += pEst->phase_ms[i];
+}
+
+uint32_t Scan_ComputeScanTime()
+	/** Returns the estimated scan time in milliseconds
+	 *  Make sure the requied scanConfig and numRepeats are set
+	 *  before calling this function to query estimated scan time.
+	 */
+{
+	ScanTimeEstimate est;
 
-	// Add pattern display delay, compute time based on num repeats and frame rate
-	// and add that to scan time
-	scan_time += (uint32_t)(((double)(scan_total_frames + PATTERN_DISPLAY_DELAY_NUM_FRAMES) * \
-				(double)(1.0/(double)DLPC150_INPUT_FRAME_RATE)) * \
-			(double)(scan_num_repeats) * 1000.0);
+	Scan_GetScanTimeEstimate(&est);
 
-	return (scan_time);
+	return (est.total_ms);
 }
 
 int16_t Scan_GetSectionNumPatterns(int section_num)
@@ -1663,7 +2049,7 @@ uint32_t Scan_GetCurSectionExpTime(int section_num)
 	{
 		if(curScanConfig.scanCfg.scan_type == SLEW_TYPE)
 		{
-			section_exposure = dlpspec_scan_get_exp_time_us((EXP_TIME)curSlewScanData.slewCfg.section[section_num].exposure_time);
+			section_exposure = dlpspec_scan_get_exp_time_us((EXP_TIME)curSlewScanData.slewCfg.section[slew_exec_order[section_num]].exposure_time);
 		}
 		else
 		{
@@ -0,0 +1,252 @@
+/*
+ *
+ * Bounded ring used to stream partial scan results to the host while the
+ * scan is still in progress. The scan task is the only producer. The only
+ * consumer is the BLE task while a BLE client has scan stream notifications
+ * on, and the command task answering NNO_CMD_SCAN_STREAM_READ otherwise, so
+ * the ring is kept lock free with free running head/tail counters.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "common.h"
+#include "scanStream.h"
+
+/* Keeps the slot contents and the head/tail counters in order. The producer
+ * and consumer are tasks on the same core, so this is mostly there to stop
+ * the compiler moving slot accesses across the counter updates */
+#ifdef NIRSCAN_HOST_BUILD
+#define SCAN_STREAM_BARRIER()		__sync_synchronize()
+#else
+#define SCAN_STREAM_BARRIER()		__asm(" dmb")
+#endif
+
+static SCAN_STREAM_SLOT streamSlots[SCAN_STREAM_NUM_SLOTS];
+static volatile uint32_t streamHead = 0;		// number of slots published
+static volatile uint32_t streamTail = 0;		// number of slots fully read
+static volatile uint16_t streamDropped = 0;
+static uint16_t streamReadOffset = 0;			// next sample to send from tail slot
+static uint16_t streamSeq = 0;
+static uint8_t streamScanId = 0;
+static uint16_t streamNumRepeats = 0;
+static bool streamEnabled = false;
+
+static void ScanStream_PutHalfWord(uint8_t *pBuf, uint16_t val)
+{
+	pBuf[0] = val & 0xFF;
+	pBuf[1] = (val >> 8) & 0xFF;
+}
+
+void ScanStream_Enable(bool enable)
+	/**
+	 * Enables or disables publishing of per-repeat results for subsequent scans.
+	 * Disabling also discards anything that has not been read yet.
+	 *
+	 * @param enable - I - true = publish each finished repeat, false = do not
+	 *
+	 * @return none
+	 */
+{
+	streamEnabled = enable;
+	if(!enable)
+	{
+		streamTail = streamHead;
+		streamReadOffset = 0;
+	}
+}
+
+bool ScanStream_IsEnabled(void)
+{
+	return streamEnabled;
+}
+
+void ScanStream_Begin(uint16_t num_repeats)
+	/**
+	 * Called by the scan task before the first repeat of a scan. Records left
+	 * over from a previous scan are kept so that a slow reader still gets them;
+	 * the scan_id in each packet tells the host which scan they belong to.
+	 *
+	 * @param num_repeats - I - number of repeats the scan is going to run
+	 *
+	 * @return none
+	 */
+{
+	streamScanId++;
+	streamNumRepeats = num_repeats;
+	streamDropped = 0;
+}
+
+static SCAN_STREAM_SLOT *ScanStream_GetFreeSlot(void)
+{
+	if(!streamEnabled)
+		return NULL;
+
+	if((streamHead - streamTail) >= SCAN_STREAM_NUM_SLOTS)
+	{
+		if(streamDropped < 0xFFFF)
+			streamDropped++;
+		return NULL;
+	}
+
+	/* The slot must not be written before the reader has let go of it */
+	SCAN_STREAM_BARRIER();
+	return &streamSlots[streamHead % SCAN_STREAM_NUM_SLOTS];
+}
+
+int ScanStream_Publish(uint16_t repeat, const long long *p_adc_data, uint16_t length,
+		const uint16_t *p_map)
+	/**
+	 * Copies the averaged ADC values of one finished repeat into the ring. The
+	 * scan task never waits on the reader; if the ring is full the record is
+	 * dropped and counted so the host can detect the gap.
+	 *
+	 * @param repeat     - I - repeat number (0 based)
+	 * @param p_adc_data - I - per pattern averaged ADC values from trigger.c
+	 * @param length     - I - number of valid entries in p_adc_data
+	 * @param p_map      - I - destination index of each value, NULL to keep order
+	 *
+	 * @return PASS or FAIL if the record was dropped
+	 */
+{
+	SCAN_STREAM_SLOT *pSlot;
+	int i;
+
+	pSlot = ScanStream_GetFreeSlot();
+	if(pSlot == NULL)
+		return FAIL;
+
+	pSlot->scan_id = streamScanId;
+	pSlot->repeat = repeat;
+	pSlot->num_repeats = streamNumRepeats;
+	pSlot->length = MIN(length, ADC_DATA_LEN);
+	if(p_map != NULL)
+	{
+		for(i=0; i<pSlot->length; i++)
+			pSlot->adc_data[p_map[i]] = (int32_t)p_adc_data[i];
+	}
+	else
+	{
+		for(i=0; i<pSlot->length; i++)
+			pSlot->adc_data[i] = (int32_t)p_adc_data[i];
+	}
+
+	/* Slot contents must be complete before the reader can see it */
+	SCAN_STREAM_BARRIER();
+	streamHead++;
+
+	return PASS;
+}
+
+int ScanStream_PublishAverage(const int32_t *p_adc_data, uint16_t length)
+	/**
+	 * Queues the final averaged result of a scan behind its repeats. The record
+	 * is sent with repeat set to SCAN_STREAM_REPEAT_AVERAGE.
+	 *
+	 * @param p_adc_data - I - averaged ADC values of the complete scan
+	 * @param length     - I - number of valid entries in p_adc_data
+	 *
+	 * @return PASS or FAIL if the record was dropped
+	 */
+{
+	SCAN_STREAM_SLOT *pSlot;
+
+	pSlot = ScanStream_GetFreeSlot();
+	if(pSlot == NULL)
+		return FAIL;
+
+	pSlot->scan_id = streamScanId;
+	pSlot->repeat = SCAN_STREAM_REPEAT_AVERAGE;
+	pSlot->num_repeats = streamNumRepeats;
+	pSlot->length = MIN(length, ADC_DATA_LEN);
+	memcpy(pSlot->adc_data, p_adc_data, pSlot->length * sizeof(int32_t));
+
+	SCAN_STREAM_BARRIER();
+	streamHead++;
+
+	return PASS;
+}
+
+int ScanStream_ReadPacket(uint8_t *pBuf, uint32_t max_size, bool scan_done)
+	/**
+	 * Fills pBuf with the next stream packet. A packet is a
+	 * SCAN_STREAM_PKT_HEADER_SIZE byte little endian header followed by as many
+	 * int32 samples of the oldest unread repeat as fit in max_size. A repeat
+	 * larger than one packet is sent over several packets using the offset field.
+	 *
+	 *  0      status (SCAN_STREAM_STATUS)
+	 *  1      scan_id
+	 *  2..3   seq - increments with every data packet
+	 *  4..5   repeat
+	 *  6..7   num_repeats
+	 *  8..9   offset of first sample in this packet
+	 *  10..11 number of samples in this packet
+	 *  12..13 total samples in the repeat
+	 *  14..15 number of repeats dropped in the current scan
+	 *
+	 * @param pBuf      - O - destination buffer
+	 * @param max_size  - I - size of pBuf in bytes
+	 * @param scan_done - I - true if no scan is in progress
+	 *
+	 * @return number of bytes written to pBuf or FAIL
+	 */
+{
+	SCAN_STREAM_SLOT *pSlot;
+	uint16_t count;
+
+	if(max_size < SCAN_STREAM_PKT_HEADER_SIZE + sizeof(int32_t))
+		return FAIL;
+
+	memset(pBuf, 0, SCAN_STREAM_PKT_HEADER_SIZE);
+	pBuf[1] = streamScanId;
+	ScanStream_PutHalfWord(&pBuf[14], streamDropped);
+
+	if(!streamEnabled)
+	{
+		pBuf[0] = SCAN_STREAM_STATUS_DISABLED;
+		return SCAN_STREAM_PKT_HEADER_SIZE;
+	}
+
+	if(streamHead == streamTail)
+	{
+		pBuf[0] = (scan_done) ? SCAN_STREAM_STATUS_DONE : SCAN_STREAM_STATUS_EMPTY;
+		return SCAN_STREAM_PKT_HEADER_SIZE;
+	}
+
+	/* Only read the slot once its publish is visible */
+	SCAN_STREAM_BARRIER();
+	pSlot = &streamSlots[streamTail % SCAN_STREAM_NUM_SLOTS];
+	count = MIN((max_size - SCAN_STREAM_PKT_HEADER_SIZE) / sizeof(int32_t),
+			(uint32_t)(pSlot->length - streamReadOffset));
+
+	pBuf[0] = SCAN_STREAM_STATUS_DATA;
+	pBuf[1] = pSlot->scan_id;
+	ScanStream_PutHalfWord(&pBuf[2], streamSeq++);
+	ScanStream_PutHalfWord(&pBuf[4], pSlot->repeat);
+	ScanStream_PutHalfWord(&pBuf[6], pSlot->num_repeats);
+	ScanStream_PutHalfWord(&pBuf[8], streamReadOffset);
+	ScanStream_PutHalfWord(&pBuf[10], count);
+	ScanStream_PutHalfWord(&pBuf[12], pSlot->length);
+	memcpy(&pBuf[SCAN_STREAM_PKT_HEADER_SIZE], &pSlot->adc_data[streamReadOffset],
+			count * sizeof(int32_t));
+
+	streamReadOffset += count;
+	if(streamReadOffset >= pSlot->length)
+	{
+		streamReadOffset = 0;
+		/* Finish copying out of the slot before handing it back */
+		SCAN_STREAM_BARRIER();
+		streamTail++;
+	}
+
+	return SCAN_STREAM_PKT_HEADER_SIZE + count * sizeof(int32_t);
+}
+
+uint16_t ScanStream_GetNumDropped(void)
+{
+	return streamDropped;
+}
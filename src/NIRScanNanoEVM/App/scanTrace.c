@@ -0,0 +1,211 @@
+/*
+ *
+ * Binary trace of scan phases and scan related interrupts. Every event is a
+ * cycle counter timestamp, an event ID and a 16-bit argument written into a
+ * RAM ring, cheap enough to be called from the DRDY and trigger interrupts
+ * where DEBUG_PRINT is not an option. The ring is read out as a file over
+ * USB and turned into a timeline on the host.
+ *
+ * Building with NIRSCAN_HOST_BUILD defined replaces the DWT cycle counter with
+ * the host clock so the same trace points can be used in a simulation.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#ifdef NIRSCAN_HOST_BUILD
+#include <time.h>
+#else
+#include <inc/hw_types.h>
+#include <xdc/std.h>
+#include <xdc/runtime/Types.h>
+#include <ti/sysbios/BIOS.h>
+#endif
+#include "scanTrace.h"
+
+#ifdef NIRSCAN_HOST_BUILD
+#define SCAN_TRACE_CYCLES()			((uint32_t)clock())
+#define SCAN_TRACE_CLOCK_HZ()		((uint32_t)CLOCKS_PER_SEC)
+#else
+/* Core cycle counter; main() starts it at boot and nothing resets it, as
+ * binLog.c timestamps from it too */
+#define DWT_CYCCNT					0xE0001004
+
+#define SCAN_TRACE_CYCLES()			HWREG(DWT_CYCCNT)
+#define SCAN_TRACE_CLOCK_HZ()		ScanTrace_GetCpuFreq()
+#endif
+
+static SCAN_TRACE_ENTRY traceRing[SCAN_TRACE_NUM_ENTRIES];
+static volatile uint32_t traceHead = 0;		// number of events logged, free running
+static volatile uint32_t traceMask = SCAN_TRACE_MASK_PHASES | SCAN_TRACE_MASK_ISR_FRAME |
+		SCAN_TRACE_MASK_ISR_PATTERN;
+static volatile bool traceFrozen = false;
+
+#ifndef NIRSCAN_HOST_BUILD
+static uint32_t ScanTrace_GetCpuFreq(void)
+{
+	Types_FreqHz freq;
+
+	BIOS_getCpuFreq(&freq);
+	return freq.lo;
+}
+#endif
+
+#ifdef NIRSCAN_HOST_BUILD
+static uint32_t ScanTrace_Claim(uint32_t *pCycles)
+{
+	uint32_t idx;
+
+	do
+	{
+		idx = traceHead;
+		*pCycles = SCAN_TRACE_CYCLES();
+	} while(!__sync_bool_compare_and_swap(&traceHead, idx, idx + 1));
+
+	return idx;
+}
+#else
+/*
+ * Pattern and frame trigger interrupts are zero latency and cannot be masked
+ * through BIOS, so the slot is claimed lock free as in binLog.c. An interrupt
+ * between the exclusive load and store fails the store; the retry reads the
+ * cycle counter again, so timestamps stay in ring order
+ */
+static uint32_t ScanTrace_Claim(uint32_t *pCycles)
+{
+	uint32_t idx;
+
+	do
+	{
+		idx = (uint32_t)__ldrex((void *)&traceHead);
+		*pCycles = SCAN_TRACE_CYCLES();
+	} while(__strex(idx + 1, (void *)&traceHead) != 0);
+
+	return idx;
+}
+#endif
+
+static void ScanTrace_PutWord(uint8_t *pBuf, uint32_t val)
+{
+	pBuf[0] = val & 0xFF;
+	pBuf[1] = (val >> 8) & 0xFF;
+	pBuf[2] = (val >> 16) & 0xFF;
+	pBuf[3] = (val >> 24) & 0xFF;
+}
+
+void ScanTrace_Init(void)
+	/**
+	 * Empties the trace. Must be called once at boot, after main() has
+	 * started the core cycle counter and before any trace point is hit.
+	 *
+	 * @return none
+	 */
+{
+	ScanTrace_Clear();
+}
+
+void ScanTrace_SetMask(uint32_t mask)
+	/**
+	 * Selects which groups of trace points are recorded. The DRDY interrupt
+	 * fires for every ADC sample and is off by default since it would flush
+	 * the ring within a few patterns.
+	 *
+	 * @param mask - I - OR of SCAN_TRACE_MASK_xxx; 0 stops tracing
+	 *
+	 * @return none
+	 */
+{
+	traceMask = mask;
+}
+
+void ScanTrace_Clear(void)
+{
+	traceHead = 0;
+}
+
+void ScanTrace_Log(uint32_t mask, uint16_t event, uint16_t arg)
+	/**
+	 * Records one event. Safe to call from any task or interrupt.
+	 *
+	 * @param mask  - I - SCAN_TRACE_MASK_xxx group the trace point belongs to
+	 * @param event - I - SCAN_TRACE_EVENT
+	 * @param arg   - I - event specific argument
+	 *
+	 * @return none
+	 */
+{
+	SCAN_TRACE_ENTRY *pEntry;
+	uint32_t cycles;
+	uint32_t idx;
+
+	if(((traceMask & mask) == 0) || traceFrozen)
+		return;
+
+	idx = ScanTrace_Claim(&cycles);
+
+	pEntry = &traceRing[idx & (SCAN_TRACE_NUM_ENTRIES - 1)];
+	pEntry->cycles = cycles;
+	pEntry->event = event;
+	pEntry->arg = arg;
+}
+
+uint32_t ScanTrace_Snapshot(uint8_t *pBuf, uint32_t max_size)
+	/**
+	 * Copies the ring, oldest event first, behind a little endian header:
+	 * version (2 bytes), entry size (2), number of entries (4), number of
+	 * events lost to overwrite (4) and cycle counter frequency in Hz (4).
+	 * Tracing is paused while copying. If the buffer is too small the newest
+	 * events that fit are returned.
+	 *
+	 * @param pBuf     - O - destination
+	 * @param max_size - I - size of pBuf in bytes
+	 *
+	 * @return number of bytes written to pBuf
+	 */
+{
+	uint32_t head;
+	uint32_t num_entries;
+	uint32_t first;
+	uint32_t i;
+	uint8_t *pEntryBuf;
+	SCAN_TRACE_ENTRY *pEntry;
+
+	if(max_size < SCAN_TRACE_DUMP_HEADER_SIZE)
+		return 0;
+
+	traceFrozen = true;
+	head = traceHead;
+
+	num_entries = (head < SCAN_TRACE_NUM_ENTRIES) ? head : SCAN_TRACE_NUM_ENTRIES;
+	if(num_entries > (max_size - SCAN_TRACE_DUMP_HEADER_SIZE) / sizeof(SCAN_TRACE_ENTRY))
+		num_entries = (max_size - SCAN_TRACE_DUMP_HEADER_SIZE) / sizeof(SCAN_TRACE_ENTRY);
+	first = head - num_entries;
+
+	pBuf[0] = SCAN_TRACE_DUMP_VERSION & 0xFF;
+	pBuf[1] = (SCAN_TRACE_DUMP_VERSION >> 8) & 0xFF;
+	pBuf[2] = sizeof(SCAN_TRACE_ENTRY) & 0xFF;
+	pBuf[3] = (sizeof(SCAN_TRACE_ENTRY) >> 8) & 0xFF;
+	ScanTrace_PutWord(&pBuf[4], num_entries);
+	ScanTrace_PutWord(&pBuf[8], first);
+	ScanTrace_PutWord(&pBuf[12], SCAN_TRACE_CLOCK_HZ());
+
+	pEntryBuf = &pBuf[SCAN_TRACE_DUMP_HEADER_SIZE];
+	for(i=0; i<num_entries; i++)
+	{
+		pEntry = &traceRing[(first + i) & (SCAN_TRACE_NUM_ENTRIES - 1)];
+		ScanTrace_PutWord(&pEntryBuf[0], pEntry->cycles);
+		pEntryBuf[4] = pEntry->event & 0xFF;
+		pEntryBuf[5] = (pEntry->event >> 8) & 0xFF;
+		pEntryBuf[6] = pEntry->arg & 0xFF;
+		pEntryBuf[7] = (pEntry->arg >> 8) & 0xFF;
+		pEntryBuf += sizeof(SCAN_TRACE_ENTRY);
+	}
+
+	traceFrozen = false;
+
+	return SCAN_TRACE_DUMP_HEADER_SIZE + num_entries * sizeof(SCAN_TRACE_ENTRY);
+}
@@ -0,0 +1,268 @@
+/*
+ *
+ * SD card writer. The scan task serializes a finished scan straight into a
+ * free queue slot and submits it; a task below the scan and command tasks
+ * (sdWriter in the .cfg) stores the queued scans to the SD card so that
+ * the next scan does not wait for FatFs. It runs above the sensor service so
+ * that sensor reads do not hold back a queued scan. When
+ * all slots are in use SDWriter_AcquireSlot() blocks until the writer frees
+ * one, which is counted as a stall so that back-pressure shows up in the
+ * statistics instead of as unexplained scan time.
+ *
+ * Only the scan task acquires and submits slots. Anyone that reads the scan
+ * files on the card calls SDWriter_Flush() first so that it sees every scan
+ * taken so far. The card itself is shared through the gate in fatsd.c, so a
+ * scan submitted after the flush is written before or after that read but
+ * never in the middle of it.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/gates/GateMutex.h>
+#include "common.h"
+#include "dlpspec_scan.h"
+#include "fatsd.h"
+#include "nnoStatus.h"
+#ifdef NIRSCAN_INCLUDE_BLE
+#include "BLECommonDefs.h"
+#include "BLENotificationHandler.h"
+#endif
+#include "sdWriter.h"
+
+typedef struct _sdWriterSlot
+{
+	uint8_t		blob[SCAN_DATA_BLOB_SIZE];
+	uint32_t	length;
+	uint32_t	index;				/* scan data index, names the file */
+	uint16_t	config_id;			/* scan config the scan was taken with */
+	uint32_t	submit_tick;
+} SD_WRITER_SLOT;
+
+static SD_WRITER_SLOT slots[SD_WRITER_NUM_SLOTS];
+static volatile uint32_t slotHead = 0;			// slots handed out to the scan task
+static volatile uint32_t slotTail = 0;			// slots written by the writer task
+
+static Semaphore_Handle slotFreeSem = NULL;
+static Semaphore_Handle slotReadySem = NULL;
+static GateMutex_Handle flushGate = NULL;
+
+static SD_WRITER_STATS stats;
+
+static uint32_t SDWriter_TicksToMs(uint32_t ticks)
+{
+	return (uint32_t)(((uint64_t)ticks * Clock_tickPeriod) / 1000);
+}
+
+int SDWriter_Init(void)
+	/**
+	 * Creates the queue semaphores. Must be called before BIOS_start() runs
+	 * the writer task.
+	 *
+	 * @return PASS or FAIL
+	 */
+{
+	Error_Block eb;
+
+	memset(&stats, 0, sizeof(SD_WRITER_STATS));
+
+	Error_init(&eb);
+	slotFreeSem = Semaphore_create(SD_WRITER_NUM_SLOTS, NULL, &eb);
+	if(slotFreeSem == NULL)
+		return FAIL;
+
+	Error_init(&eb);
+	slotReadySem = Semaphore_create(0, NULL, &eb);
+	if(slotReadySem == NULL)
+		return FAIL;
+
+	Error_init(&eb);
+	flushGate = GateMutex_create(NULL, &eb);
+	if(flushGate == NULL)
+		return FAIL;
+
+	return PASS;
+}
+
+void SDWriter_Task(void)
+	/**
+	 * Task that writes queued scans to the SD card in the order they were
+	 * submitted and returns each slot to the scan task once its file is closed.
+	 */
+{
+	SD_WRITER_SLOT *pSlot;
+	FRESULT fresult;
+	uint32_t start;
+	uint32_t end;
+
+	while(1)
+	{
+		Semaphore_pend(slotReadySem, BIOS_WAIT_FOREVER);
+
+		pSlot = &slots[slotTail % SD_WRITER_NUM_SLOTS];
+		start = Clock_getTicks();
+		fresult = FATSD_WriteScanFile(pSlot->blob, pSlot->length, pSlot->index, pSlot->config_id);
+		end = Clock_getTicks();
+
+		if(fresult != FR_OK)
+		{
+			DEBUG_PRINT("ERROR: Writing to u-SD card failed!! Returned error:%d", fresult);
+#ifdef NIRSCAN_INCLUDE_BLE
+			bleNotificationHandler_sendErrorIndication(NNO_ERROR_SD_CARD,(int16_t)fresult);
+#endif
+			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, (int16_t)fresult);
+			stats.num_failed++;
+		}
+		else
+			stats.num_written++;
+
+		stats.write_ms_last = SDWriter_TicksToMs(end - start);
+		if(stats.write_ms_last > stats.write_ms_max)
+			stats.write_ms_max = stats.write_ms_last;
+		stats.latency_ms_last = SDWriter_TicksToMs(end - pSlot->submit_tick);
+		if(stats.latency_ms_last > stats.latency_ms_max)
+			stats.latency_ms_max = stats.latency_ms_last;
+
+		slotTail++;
+		Semaphore_post(slotFreeSem);
+	}
+}
+
+uint8_t *SDWriter_AcquireSlot(uint32_t *pSize)
+	/**
+	 * Returns the buffer of a free queue slot to serialize a scan into. Blocks
+	 * while all slots are waiting to be written. The slot must be passed back
+	 * with SDWriter_Submit() before the next acquire.
+	 *
+	 * @param pSize - O - size of the returned buffer
+	 *
+	 * @return slot buffer
+	 */
+{
+	uint32_t start;
+	uint32_t stall_ms;
+
+	if(!Semaphore_pend(slotFreeSem, BIOS_NO_WAIT))
+	{
+		start = Clock_getTicks();
+		stats.num_stalls++;
+		Semaphore_pend(slotFreeSem, BIOS_WAIT_FOREVER);
+		stall_ms = SDWriter_TicksToMs(Clock_getTicks() - start);
+		if(stall_ms > stats.stall_ms_max)
+			stats.stall_ms_max = stall_ms;
+	}
+
+	*pSize = SCAN_DATA_BLOB_SIZE;
+	return slots[slotHead % SD_WRITER_NUM_SLOTS].blob;
+}
+
+void SDWriter_Submit(uint32_t length, uint32_t index, uint16_t config_id)
+	/**
+	 * Queues the slot returned by the last SDWriter_AcquireSlot() for writing.
+	 * A length of 0 gives the slot back without writing anything, e.g. when
+	 * serialization failed.
+	 *
+	 * @param length    - I - bytes used in the slot buffer
+	 * @param index     - I - scan data index of the serialized scan
+	 * @param config_id - I - scanConfigIndex of the scan, kept in the SD index
+	 *
+	 * @return none
+	 */
+{
+	SD_WRITER_SLOT *pSlot = &slots[slotHead % SD_WRITER_NUM_SLOTS];
+	uint32_t depth;
+
+	if(length == 0)
+	{
+		Semaphore_post(slotFreeSem);
+		return;
+	}
+
+	pSlot->length = length;
+	pSlot->index = index;
+	pSlot->config_id = config_id;
+	pSlot->submit_tick = Clock_getTicks();
+	slotHead++;
+
+	stats.num_queued++;
+	depth = slotHead - slotTail;
+	if(depth > stats.depth_max)
+		stats.depth_max = depth;
+
+	Semaphore_post(slotReadySem);
+}
+
+uint8_t *SDWriter_Reserve(uint32_t *pSize)
+	/**
+	 * Waits until every submitted scan has been written to the SD card and
+	 * keeps all queue slots until SDWriter_Release(), so that the caller can
+	 * use a slot buffer as scratch space for work on the card, e.g. archive
+	 * compaction. The scan task waits in SDWriter_AcquireSlot() meanwhile.
+	 *
+	 * @param pSize - O - size of the returned buffer
+	 *
+	 * @return slot buffer
+	 */
+{
+	IArg key;
+	int i;
+
+	key = GateMutex_enter(flushGate);
+
+	/* All slots free means nothing is queued or being written */
+	for(i=0; i<SD_WRITER_NUM_SLOTS; i++)
+		Semaphore_pend(slotFreeSem, BIOS_WAIT_FOREVER);
+
+	GateMutex_leave(flushGate, key);
+
+	*pSize = SCAN_DATA_BLOB_SIZE;
+	return slots[slotHead % SD_WRITER_NUM_SLOTS].blob;
+}
+
+void SDWriter_Release(void)
+	/**
+	 * Gives back the queue slots taken by SDWriter_Reserve().
+	 *
+	 * @return none
+	 */
+{
+	int i;
+
+	for(i=0; i<SD_WRITER_NUM_SLOTS; i++)
+		Semaphore_post(slotFreeSem);
+}
+
+void SDWriter_Flush(void)
+	/**
+	 * Waits until every submitted scan has been written to the SD card.
+	 *
+	 * @return none
+	 */
+{
+	uint32_t size;
+
+	SDWriter_Reserve(&size);
+	SDWriter_Release();
+}
+
+void SDWriter_GetStats(SD_WRITER_STATS *pStats)
+	/**
+	 * Returns the queue and write statistics since boot.
+	 *
+	 * @param pStats - O - statistics
+	 *
+	 * @return none
+	 */
+{
+	memcpy(pStats, &stats, sizeof(SD_WRITER_STATS));
+	pStats->depth = slotHead - slotTail;
+}
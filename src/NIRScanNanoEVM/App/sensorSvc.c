@@ -0,0 +1,355 @@
+/*
+ *
+ * Sensor service. A low priority task samples TMP006, HDC1000 and battery
+ * voltage periodically and publishes them as one timestamped snapshot. The
+ * scan task and command handlers take the latest snapshot instead of waiting
+ * on I2C. Anyone that needs a reading right now calls SensorSvc_Refresh(),
+ * which is serialised with the task since the sensor drivers open and close
+ * their I2C port on every read. The gate inherits priority, so the scan task
+ * waiting on it is not held up by mid priority tasks while the service task
+ * finishes a sample.
+ *
+ * Snapshots are double buffered: a writer fills the buffer not being pointed
+ * at and then flips the index. Readers copy and retry if a publish happened
+ * meanwhile, so they never block on the (lower priority) sampling task.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/gates/GateMutexPri.h>
+#include "common.h"
+#include "tmp006.h"
+#include "hdc1000.h"
+#include "battery.h"
+#include "sensorSvc.h"
+
+static SENSOR_SNAPSHOT snapBuf[2];
+static volatile uint32_t snapIdx = 0;			// buffer holding the latest snapshot
+static SENSOR_SNAPSHOT snapWork;				// next snapshot, guarded by sensorGate
+static volatile uint32_t lampPD = 0;
+static volatile uint32_t lampPDTick = 0;
+
+static GateMutexPri_Handle sensorGate = NULL;
+static Semaphore_Handle sensorWakeSem = NULL;
+static volatile uint16_t idlePeriodMs = SENSOR_SVC_IDLE_PERIOD_MS;
+static volatile uint16_t scanPeriodMs = SENSOR_SVC_SCAN_PERIOD_MS;
+static volatile bool scanActive = false;
+
+static SENSOR_LOG_ENTRY sensorLog[SENSOR_SVC_LOG_LEN];
+static volatile uint32_t sensorLogHead = 0;		// entries logged since scan start
+
+static uint32_t SensorSvc_GetTick(void)
+{
+	uint32_t tick = Clock_getTicks();
+
+	/* 0 is reserved for "never sampled" */
+	return (tick == 0) ? 1 : tick;
+}
+
+static uint32_t SensorSvc_TicksToMs(uint32_t ticks)
+{
+	return (uint32_t)(((uint64_t)ticks * Clock_tickPeriod) / 1000);
+}
+
+static uint32_t SensorSvc_MsToTicks(uint32_t ms)
+{
+	return (uint32_t)(((uint64_t)ms * 1000) / Clock_tickPeriod);
+}
+
+static void SensorSvc_Publish(void)
+	/* Caller holds sensorGate */
+{
+	uint32_t next = snapIdx ^ 1;
+
+	snapWork.seq++;
+	memcpy(&snapBuf[next], &snapWork, sizeof(SENSOR_SNAPSHOT));
+	snapIdx = next;
+}
+
+static int SensorSvc_Sample(uint32_t mask)
+	/* Caller holds sensorGate */
+{
+	float val1, val2;
+	int result = PASS;
+
+	if(mask & SENSOR_SNAP_TMP006)
+	{
+		if(tmp006_DataTemperatureGetFloat(&val1, &val2) == PASS)
+		{
+			snapWork.ambient_temp = val1;
+			snapWork.detector_temp = val2;
+			snapWork.tmp006_tick = SensorSvc_GetTick();
+		}
+		else
+			result = FAIL;
+	}
+
+	if(mask & SENSOR_SNAP_HDC1000)
+	{
+		if(hdc1000_DataTemperatureGetFloat(&val1, &val2) == PASS)
+		{
+			snapWork.board_temp = val1;
+			snapWork.humidity = val2;
+			snapWork.hdc1000_tick = SensorSvc_GetTick();
+		}
+		else
+			result = FAIL;
+	}
+
+	if(mask & SENSOR_SNAP_BATTERY)
+	{
+		battery_read(&val1);
+		snapWork.battery_volt = val1;
+		snapWork.battery_tick = SensorSvc_GetTick();
+	}
+
+	SensorSvc_Publish();
+
+	return result;
+}
+
+static void SensorSvc_LogSample(void)
+{
+	SENSOR_LOG_ENTRY *pEntry = &sensorLog[sensorLogHead % SENSOR_SVC_LOG_LEN];
+
+	pEntry->tick = snapWork.tmp006_tick;
+	pEntry->detector_temp = (int16_t)(snapWork.detector_temp * 100);
+	pEntry->ambient_temp = (int16_t)(snapWork.ambient_temp * 100);
+	pEntry->board_temp = (int16_t)(snapWork.board_temp * 100);
+	pEntry->humidity = (uint16_t)(snapWork.humidity * 100);
+	sensorLogHead++;
+}
+
+int SensorSvc_Init(void)
+	/**
+	 * Creates the lock and wake-up semaphore used by the sensor service. Must
+	 * be called before BIOS_start() runs the service task.
+	 *
+	 * @return PASS or FAIL
+	 */
+{
+	Error_Block eb;
+
+	Error_init(&eb);
+	sensorGate = GateMutexPri_create(NULL, &eb);
+	if(sensorGate == NULL)
+		return FAIL;
+
+	Error_init(&eb);
+	sensorWakeSem = Semaphore_create(0, NULL, &eb);
+	if(sensorWakeSem == NULL)
+		return FAIL;
+
+	return PASS;
+}
+
+void SensorSvc_Task(void)
+	/**
+	 * Task that samples all sensors every idle period, or every scan period
+	 * while a scan is in progress. Samples taken during a scan also go into
+	 * the drift log. An idle period of 0 stops sampling outside of scans.
+	 */
+{
+	IArg key;
+	uint32_t period;
+	bool logging;
+
+	while(1)
+	{
+		logging = scanActive;
+		period = (logging) ? scanPeriodMs : idlePeriodMs;
+
+		if(period != 0)
+		{
+			key = GateMutexPri_enter(sensorGate);
+			SensorSvc_Sample(SENSOR_SNAP_TMP006 | SENSOR_SNAP_HDC1000 | SENSOR_SNAP_BATTERY);
+			if(logging)
+				SensorSvc_LogSample();
+			GateMutexPri_leave(sensorGate, key);
+
+			Semaphore_pend(sensorWakeSem, SensorSvc_MsToTicks(period));
+		}
+		else
+		{
+			Semaphore_pend(sensorWakeSem, BIOS_WAIT_FOREVER);
+		}
+	}
+}
+
+int SensorSvc_Refresh(uint32_t mask)
+	/**
+	 * Samples the given sensors now and publishes the result. Blocks while the
+	 * service task is in the middle of a sample.
+	 *
+	 * @param mask - I - SENSOR_SNAP_xxx sources to read
+	 *
+	 * @return PASS or FAIL if any of the sensors could not be read
+	 */
+{
+	IArg key;
+	int result;
+
+	key = GateMutexPri_enter(sensorGate);
+	result = SensorSvc_Sample(mask);
+	GateMutexPri_leave(sensorGate, key);
+
+	return result;
+}
+
+void SensorSvc_GetSnapshot(SENSOR_SNAPSHOT *pSnap)
+	/**
+	 * Returns the latest snapshot without touching I2C.
+	 *
+	 * @param pSnap - O - copy of the latest snapshot
+	 *
+	 * @return none
+	 */
+{
+	uint32_t idx;
+
+	do
+	{
+		idx = snapIdx;
+		memcpy(pSnap, &snapBuf[idx], sizeof(SENSOR_SNAPSHOT));
+	} while((idx != snapIdx) || (pSnap->seq != snapBuf[idx].seq));
+
+	pSnap->lamp_pd = lampPD;
+	pSnap->lamp_pd_tick = lampPDTick;
+}
+
+int SensorSvc_GetFresh(SENSOR_SNAPSHOT *pSnap, uint32_t max_age_ms)
+	/**
+	 * Returns the latest snapshot, reading TMP006 and HDC1000 first if their
+	 * last sample is older than max_age_ms.
+	 *
+	 * @param pSnap      - O - snapshot
+	 * @param max_age_ms - I - oldest acceptable environmental reading
+	 *
+	 * @return PASS or FAIL if a stale sensor could not be read
+	 */
+{
+	uint32_t now;
+	uint32_t mask = 0;
+	int result = PASS;
+
+	SensorSvc_GetSnapshot(pSnap);
+	now = SensorSvc_GetTick();
+
+	if((pSnap->tmp006_tick == 0) ||
+			(SensorSvc_TicksToMs(now - pSnap->tmp006_tick) > max_age_ms))
+		mask |= SENSOR_SNAP_TMP006;
+	if((pSnap->hdc1000_tick == 0) ||
+			(SensorSvc_TicksToMs(now - pSnap->hdc1000_tick) > max_age_ms))
+		mask |= SENSOR_SNAP_HDC1000;
+
+	if(mask != 0)
+	{
+		result = SensorSvc_Refresh(mask);
+		SensorSvc_GetSnapshot(pSnap);
+	}
+
+	return result;
+}
+
+void SensorSvc_PublishLampPD(uint32_t lamp_pd)
+	/**
+	 * Records the lamp photodiode reading taken by the scan. The photodiode is
+	 * read through the DLPC150, which only the scan task talks to.
+	 *
+	 * @param lamp_pd - I - green channel of the DLPC150 light sensor
+	 *
+	 * @return none
+	 */
+{
+	lampPD = lamp_pd;
+	lampPDTick = SensorSvc_GetTick();
+}
+
+void SensorSvc_SetScanActive(bool active)
+	/**
+	 * Switches between the idle and the scan sampling period. Starting a scan
+	 * clears the drift log and reads TMP006 and HDC1000 before returning: the
+	 * idle period may be longer than SENSOR_SVC_SCAN_MAX_AGE_MS, and the scan
+	 * must not find a stale snapshot and read I2C once patterns are running.
+	 *
+	 * @param active - I - true at scan start, false at scan end
+	 *
+	 * @return none
+	 */
+{
+	if(active && !scanActive)
+	{
+		sensorLogHead = 0;
+		SensorSvc_Refresh(SENSOR_SNAP_ENV);
+	}
+	scanActive = active;
+	Semaphore_post(sensorWakeSem);
+}
+
+int SensorSvc_SetPeriods(uint16_t idle_period_ms, uint16_t scan_period_ms)
+	/**
+	 * Sets the sampling periods.
+	 *
+	 * @param idle_period_ms - I - period outside of scans; 0 = do not sample
+	 * @param scan_period_ms - I - period during scans, drift log rate
+	 *
+	 * @return PASS or FAIL
+	 */
+{
+	if(scan_period_ms == 0)
+		return FAIL;
+
+	idlePeriodMs = idle_period_ms;
+	scanPeriodMs = scan_period_ms;
+	Semaphore_post(sensorWakeSem);
+
+	return PASS;
+}
+
+uint32_t SensorSvc_ReadLog(uint8_t *pBuf, uint32_t max_size)
+	/**
+	 * Copies the drift log of the current or last scan, oldest entry first,
+	 * after a 4 byte entry count and the 4 byte Clock tick period in us.
+	 *
+	 * @param pBuf     - O - destination
+	 * @param max_size - I - size of pBuf
+	 *
+	 * @return number of bytes written
+	 */
+{
+	IArg key;
+	uint32_t num_entries;
+	uint32_t first;
+	uint32_t tick_us = Clock_tickPeriod;
+	uint32_t i;
+
+	if(max_size < 2 * sizeof(uint32_t))
+		return 0;
+
+	key = GateMutexPri_enter(sensorGate);
+
+	num_entries = (sensorLogHead < SENSOR_SVC_LOG_LEN) ? sensorLogHead : SENSOR_SVC_LOG_LEN;
+	if(num_entries > (max_size - 2 * sizeof(uint32_t)) / sizeof(SENSOR_LOG_ENTRY))
+		num_entries = (max_size - 2 * sizeof(uint32_t)) / sizeof(SENSOR_LOG_ENTRY);
+	first = sensorLogHead - num_entries;
+
+	memcpy(&pBuf[0], &num_entries, sizeof(uint32_t));
+	memcpy(&pBuf[4], &tick_us, sizeof(uint32_t));
+	for(i=0; i<num_entries; i++)
+		memcpy(&pBuf[8 + i * sizeof(SENSOR_LOG_ENTRY)],
+				&sensorLog[(first + i) % SENSOR_SVC_LOG_LEN], sizeof(SENSOR_LOG_ENTRY));
+
+	GateMutexPri_leave(sensorGate, key);
+
+	return 2 * sizeof(uint32_t) + num_entries * sizeof(SENSOR_LOG_ENTRY);
+}
@@ -0,0 +1,323 @@
+/*
+ *
+ * Vsync and frame packing of slew scan patterns. Patterns of consecutive
+ * sections are packed into vsync periods and 24 pattern frames; a black
+ * pattern follows every 24th pattern. Only the order in which the sections
+ * are run is free, so the best order is found by trying all of them.
+ *
+ * Nothing in here touches hardware or globals so that it can be built and
+ * exercised on a host as well.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "common.h"
+#include "slewSched.h"
+
+/* Patterns per frame before the black pattern is inserted */
+#define SLEW_SCHED_PTNS_PER_FRAME	24
+
+/* Position of a pattern in ADC data once the black patterns are inserted */
+#define SLEW_SCHED_POSITION(item)	((item) + (item)/SLEW_SCHED_PTNS_PER_FRAME)
+
+static void SlewSched_AddVsync(SLEW_SCHED_PLAN *pPlan, int num_patterns)
+{
+	if(pPlan->numVsyncs >= pPlan->maxVsyncs)
+	{
+		pPlan->overflow = true;
+		return;
+	}
+	if(pPlan->pPatternsPerVsync != NULL)
+		pPlan->pPatternsPerVsync[pPlan->numVsyncs] = num_patterns;
+	pPlan->numVsyncs++;
+}
+
+static void SlewSched_AddFrame(SLEW_SCHED_PLAN *pPlan, int frame_sync_count)
+{
+	if(pPlan->numFrames >= pPlan->maxFrames)
+	{
+		pPlan->overflow = true;
+		return;
+	}
+	if(pPlan->pFrameSyncs != NULL)
+		pPlan->pFrameSyncs[pPlan->numFrames] = frame_sync_count;
+	pPlan->numFrames++;
+	pPlan->totalFrames += frame_sync_count;
+}
+
+int SlewSched_Pack(const SLEW_SCHED_SECTION *pSect, const uint8_t *pOrder,
+		int num_sections, SLEW_SCHED_PLAN *pPlan)
+	/**
+	 * Packs the patterns of all sections, run in the given order, into vsync
+	 * periods and frames. A pattern longer than one vsync period starts at a new
+	 * vsync and holds it over one (2x) or three (4x) more vsyncs. The black
+	 * pattern after every 24th pattern is shown in the dark time of the vsync it
+	 * falls in.
+	 *
+	 * @param pSect        - I - sections in configuration order
+	 * @param pOrder       - I - pOrder[k] is the section run in k-th place
+	 * @param num_sections - I - number of sections
+	 * @param pPlan        - I/O - array pointers and sizes in, packing out
+	 *
+	 * @return total frames per scan or FAIL if the arrays are too small
+	 */
+{
+	int numPatterns_inFrame = 0;
+	int numPatterns_inVsync = 0;
+	int tot_exp_time_inVsync = 0;
+	int frame_sync_count = 1;
+	int numPatterns_inSection;
+	int exp_time_us;
+	int item = 0;
+	int last_position = -1;
+	int i;
+
+	pPlan->numVsyncs = 0;
+	pPlan->numFrames = 0;
+	pPlan->totalFrames = 0;
+	pPlan->overflow = false;
+
+	if(num_sections > SLEW_SCAN_MAX_SECTIONS)
+		return FAIL;
+
+	for(i=0; i<num_sections; i++)
+	{
+		exp_time_us = pSect[pOrder[i]].exp_time_us;
+		numPatterns_inSection = pSect[pOrder[i]].num_patterns;
+
+		/* Black patterns between two sections count towards the later one */
+		item += numPatterns_inSection;
+		if(item > 0)
+		{
+			pPlan->section_num_positions[i] = SLEW_SCHED_POSITION(item - 1) - last_position;
+			last_position = SLEW_SCHED_POSITION(item - 1);
+		}
+		else
+			pPlan->section_num_positions[i] = 0;
+
+		while(numPatterns_inSection > 0)
+		{
+			//special case for exposure time > vsync period
+			if(exp_time_us > VSYNC_ACTIVE_PATTERN_PERIOD)
+			{
+				//close out the previous vysnc and start at next
+				if(numPatterns_inVsync != 0)
+				{
+					if(numPatterns_inFrame == SLEW_SCHED_PTNS_PER_FRAME)
+					{
+						//dark time for the 25th frame. There is always room for the black pattern exposure
+						numPatterns_inVsync++;
+						SlewSched_AddFrame(pPlan, frame_sync_count);
+						frame_sync_count = 1;
+						numPatterns_inFrame = 0;
+					}
+					SlewSched_AddVsync(pPlan, numPatterns_inVsync);
+				}
+				numPatterns_inFrame++;
+				if(exp_time_us > 2*VSYNC_ACTIVE_PATTERN_PERIOD) //4x
+				{
+					SlewSched_AddVsync(pPlan, 0);
+					SlewSched_AddVsync(pPlan, 0);
+					SlewSched_AddVsync(pPlan, 0);
+					if(numPatterns_inFrame == 1)
+						frame_sync_count+=3;
+					else
+						frame_sync_count+=4;
+				}
+				else                                            //2x
+				{
+					SlewSched_AddVsync(pPlan, 0);
+					if(numPatterns_inFrame == 1)
+						frame_sync_count++;
+					else
+						frame_sync_count+=2;
+				}
+				numPatterns_inVsync = 1;    //carry over this pattern to next vsync
+				tot_exp_time_inVsync = exp_time_us;
+			}
+			else if((tot_exp_time_inVsync + exp_time_us) > VSYNC_ACTIVE_PATTERN_PERIOD)
+			{
+				if(numPatterns_inFrame == SLEW_SCHED_PTNS_PER_FRAME)
+				{
+					//dark time for the 25th frame. There is always room for the black pattern exposure
+					numPatterns_inVsync++;
+					SlewSched_AddFrame(pPlan, frame_sync_count);
+					frame_sync_count = 1;
+					numPatterns_inFrame = 1;
+				}
+				else
+				{
+					frame_sync_count++;
+					numPatterns_inFrame++;
+				}
+				SlewSched_AddVsync(pPlan, numPatterns_inVsync);
+				numPatterns_inVsync = 1;    //carry over this pattern to next vsync
+				tot_exp_time_inVsync = exp_time_us;
+			}
+			else
+			{
+				if(numPatterns_inFrame == SLEW_SCHED_PTNS_PER_FRAME)
+				{
+					//dark time for the 25th frame. There is always room for the black pattern exposure
+					SlewSched_AddVsync(pPlan, numPatterns_inVsync + 1);
+					SlewSched_AddFrame(pPlan, frame_sync_count);
+					frame_sync_count = 1;
+					numPatterns_inFrame = 1;
+					numPatterns_inVsync = 1;
+					tot_exp_time_inVsync = exp_time_us;
+				}
+				else
+				{
+					numPatterns_inFrame++;
+					numPatterns_inVsync++;
+					tot_exp_time_inVsync += exp_time_us;
+				}
+			}
+			numPatterns_inSection--;
+		}
+	}
+	if(numPatterns_inVsync != 0)
+	{
+		SlewSched_AddVsync(pPlan, numPatterns_inVsync);
+		SlewSched_AddFrame(pPlan, frame_sync_count);
+	}
+
+	if(pPlan->overflow)
+		return FAIL;
+
+	return pPlan->totalFrames;
+}
+
+int SlewSched_FindBestOrder(const SLEW_SCHED_SECTION *pSect, int num_sections,
+		int max_vsyncs, int max_frames, uint8_t *pOrder)
+	/**
+	 * Tries every order of the sections (at most 5! = 120) and returns the one
+	 * that needs the fewest frames. The configuration order is tried first and
+	 * is kept unless another order is strictly better.
+	 *
+	 * @param pSect        - I - sections in configuration order
+	 * @param num_sections - I - number of sections
+	 * @param max_vsyncs   - I - vsync array size the plan has to fit in
+	 * @param max_frames   - I - frame array size the plan has to fit in
+	 * @param pOrder       - O - pOrder[k] is the section to run in k-th place
+	 *
+	 * @return total frames per scan of the chosen order or FAIL
+	 */
+{
+	SLEW_SCHED_PLAN plan;
+	uint8_t perm[SLEW_SCAN_MAX_SECTIONS];
+	uint8_t c[SLEW_SCAN_MAX_SECTIONS];
+	uint8_t tmp;
+	int best = -1;
+	int frames;
+	int i;
+
+	if((num_sections <= 0) || (num_sections > SLEW_SCAN_MAX_SECTIONS))
+		return FAIL;
+
+	plan.pPatternsPerVsync = NULL;
+	plan.maxVsyncs = max_vsyncs;
+	plan.pFrameSyncs = NULL;
+	plan.maxFrames = max_frames;
+
+	for(i=0; i<num_sections; i++)
+	{
+		perm[i] = i;
+		c[i] = 0;
+		pOrder[i] = i;
+	}
+
+	/* Heap's algorithm; every iteration evaluates one new permutation */
+	i = 0;
+	do
+	{
+		frames = SlewSched_Pack(pSect, perm, num_sections, &plan);
+		if((frames >= 0) && ((best < 0) || (frames < best)))
+		{
+			best = frames;
+			memcpy(pOrder, perm, num_sections);
+		}
+
+		while(i < num_sections)
+		{
+			if(c[i] < i)
+			{
+				if(i % 2 == 0)
+				{
+					tmp = perm[0];
+					perm[0] = perm[i];
+				}
+				else
+				{
+					tmp = perm[c[i]];
+					perm[c[i]] = perm[i];
+				}
+				perm[i] = tmp;
+				c[i]++;
+				i = 0;
+				break;
+			}
+			c[i] = 0;
+			i++;
+		}
+	} while(i < num_sections);
+
+	return (best < 0) ? FAIL : best;
+}
+
+int SlewSched_BuildAdcMap(const SLEW_SCHED_SECTION *pSect, const uint8_t *pOrder,
+		int num_sections, uint16_t *pMap, int map_len)
+	/**
+	 * Builds the table that moves ADC data of a scan run in pOrder back to
+	 * configuration order. Black patterns sit at the same positions in both
+	 * layouts and are left in place; the DC level taken from them is an average
+	 * over all of them so their order does not matter.
+	 *
+	 * @param pSect        - I - sections in configuration order
+	 * @param pOrder       - I - pOrder[k] is the section run in k-th place
+	 * @param num_sections - I - number of sections
+	 * @param pMap         - O - pMap[i] is the configuration order index of the
+	 *                           i-th ADC value measured
+	 * @param map_len      - I - entries in pMap
+	 *
+	 * @return PASS or FAIL
+	 */
+{
+	uint16_t section_start[SLEW_SCAN_MAX_SECTIONS];
+	int exec_item = 0;
+	int cfg_item;
+	int exec_pos, cfg_pos;
+	int i, j;
+
+	if(num_sections > SLEW_SCAN_MAX_SECTIONS)
+		return FAIL;
+
+	for(i=0; i<map_len; i++)
+		pMap[i] = i;
+
+	section_start[0] = 0;
+	for(i=1; i<num_sections; i++)
+		section_start[i] = section_start[i-1] + pSect[i-1].num_patterns;
+
+	for(i=0; i<num_sections; i++)
+	{
+		for(j=0; j<pSect[pOrder[i]].num_patterns; j++)
+		{
+			cfg_item = section_start[pOrder[i]] + j;
+			exec_pos = SLEW_SCHED_POSITION(exec_item);
+			cfg_pos = SLEW_SCHED_POSITION(cfg_item);
+			if((exec_pos >= map_len) || (cfg_pos >= map_len))
+				return FAIL;
+			pMap[exec_pos] = cfg_pos;
+			exec_item++;
+		}
+	}
+
+	return PASS;
+}
@@ -0,0 +1,122 @@
+/*
+ *
+ * Streaming SNR statistics of repeated scans. Each repeat is folded into
+ * bins as it arrives and every finished bin updates Welford accumulators of
+ * the bin value and of the difference to the previous bin, so no repeat has
+ * to be kept around. SNR = mean(bin values) / stddev(bin differences).
+ *
+ * Nothing in here touches hardware or globals so that it can be built and
+ * exercised on a host as well.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "common.h"
+#include "snrStats.h"
+
+static void SnrStats_WelfordAdd(SNR_WELFORD *pW, float x)
+{
+	float delta = x - pW->mean;
+
+	pW->n++;
+	pW->mean += delta / pW->n;
+	pW->m2 += delta * (x - pW->mean);
+}
+
+int SnrStats_Init(SNR_STATS_ACC *pAcc, const SNR_STATS_WINDOW *pWin)
+	/**
+	 * Clears the accumulator and sets the integration window to use.
+	 *
+	 * @param pAcc - O - accumulator
+	 * @param pWin - I - window; sample_step must be between 1 and bin_size
+	 *
+	 * @return PASS or FAIL
+	 */
+{
+	memset(pAcc, 0, sizeof(SNR_STATS_ACC));
+
+	if((pWin->bin_size == 0) || (pWin->sample_step == 0) ||
+			(pWin->sample_step > pWin->bin_size))
+		return FAIL;
+
+	pAcc->win = *pWin;
+	return PASS;
+}
+
+void SnrStats_AddRepeat(SNR_STATS_ACC *pAcc, const long long *p_adc_data, int num_patterns,
+		const uint16_t *p_map)
+	/**
+	 * Adds the ADC data of one repeat of an SNR scan.
+	 *
+	 * @param pAcc         - I/O - accumulator
+	 * @param p_adc_data   - I - ADC value per pattern, in run order
+	 * @param num_patterns - I - entries in p_adc_data; only patterns whose
+	 *                           configuration index is below SNR_PATTERNS
+	 *                           are used
+	 * @param p_map        - I - configuration index of each value, NULL if
+	 *                           the patterns ran in configuration order
+	 *
+	 * @return none
+	 */
+{
+	float bin_val;
+	int j, k;
+
+	if(pAcc->win.bin_size == 0)
+		return;
+
+	if((pAcc->bin_pos % pAcc->win.sample_step) == 0)
+	{
+		for(j=0; j<num_patterns; j++)
+		{
+			k = (p_map != NULL) ? p_map[j] : j;
+			if(k < SNR_PATTERNS)
+				pAcc->bin_sum[k] += (float)p_adc_data[j];
+		}
+		pAcc->bin_count++;
+	}
+
+	if(++pAcc->bin_pos < pAcc->win.bin_size)
+		return;
+
+	/* Bin complete */
+	for(j=0; j<SNR_PATTERNS; j++)
+	{
+		bin_val = pAcc->bin_sum[j] / (float)pAcc->bin_count;
+		if(pAcc->value[j].n > 0)
+			SnrStats_WelfordAdd(&pAcc->diff[j], bin_val - pAcc->prev_bin[j]);
+		SnrStats_WelfordAdd(&pAcc->value[j], bin_val);
+		pAcc->prev_bin[j] = bin_val;
+		pAcc->bin_sum[j] = 0;
+	}
+	pAcc->bin_pos = 0;
+	pAcc->bin_count = 0;
+}
+
+void SnrStats_GetSNR(const SNR_STATS_ACC *pAcc, float *pResult)
+	/**
+	 * Returns the SNR of each pattern over the completed bins; a trailing
+	 * partial bin is ignored. Patterns with fewer than two bins report 0.
+	 *
+	 * @param pAcc    - I - accumulator
+	 * @param pResult - O - SNR_PATTERNS values
+	 *
+	 * @return none
+	 */
+{
+	int j;
+
+	for(j=0; j<SNR_PATTERNS; j++)
+	{
+		if(pAcc->diff[j].n == 0)
+			pResult[j] = 0;
+		else
+			pResult[j] = pAcc->value[j].mean / sqrtf(pAcc->diff[j].m2 / pAcc->diff[j].n);
+	}
+}
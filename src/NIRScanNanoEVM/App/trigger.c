@@ -32,6 +32,7 @@
 #include "nano_timer.h"
 #include "trigger.h"
 #include "nnoStatus.h"
+#include "scanTrace.h"
 
 //#define USE_MEDIAN_ADC_VAL
 #define NUM_ADC_SAMPLES_ACCU_MAX 2000
@@ -122,6 +123,7 @@ void Trig_FrameCallback()
 {
 	bool pattern_extends_beyond_a_vsync;
 
+	SCAN_TRACE(SCAN_TRACE_MASK_ISR_FRAME, SCAN_TRACE_ISR_FRAME, trig_vsyncCount);
 	if(scanStart == true) //command had been recieved to start scan
 	{
 		scanStart = false;
@@ -202,6 +204,7 @@ void Pattern_trig_int_handler()
 		NIRscanNano_Sync_ADC();
 
 		g_PatternTrigger++;
+		SCAN_TRACE(SCAN_TRACE_MASK_ISR_PATTERN, SCAN_TRACE_ISR_PATTERN, g_PatternTrigger);
 		ptn_drdy_count = 0;
 		if (g_PatternTrigger == pCurScanData->data.adc_data_length+1)
 		{
@@ -273,6 +276,7 @@ void DRDY_int_handler()
 	{
 		ptn_drdy_count++;
 		g_DRDYTrigger++;
+		SCAN_TRACE(SCAN_TRACE_MASK_ISR_DRDY, SCAN_TRACE_ISR_DRDY, g_scanDataIdx);
 
 		if(((g_scanDataIdx+1) % 25) == 0)
 			black_pattern = true;
@@ -17,7 +17,9 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
 #include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
 /* usblib Header files */
 #include "common.h"
 
@@ -26,7 +28,8 @@
 #include "NNOUARTDefs.h"
 #include <cmdHandlerIFMgr.h>
 #include "cmdDict.h"
-#include "uartstdio.h"
+#include "uartFrame.h"
+#include "uartDma.h"
 #include "nano_timer.h"
 #include "nnoStatus.h"
 #include "uartCmdHandler.h"
@@ -55,13 +58,14 @@ extern uint8_t *wrp;                /* pointer to next message byte to write */
 union parmUnionType parmUnionUART; /* macro helper object. See cmdHandler.h */
 
 /**
- * 4-byte aligned message structure. Alignment is
- * required since a pointer to this struct will be
- * passed to the USB driver
+ * Frame buffer; the command is received into it and the response built in
+ * place and sent from it by the uDMA. Word aligned so that the message
+ * following the frame header is.
  */
-static uint8_t uartCmdPacket[UART_MAX_CMD_MAX_PKT_SZ];
-uartMessageStruct *pUartMsg = (uartMessageStruct*) uartCmdPacket;/*USB HID msg structure*/
-static uint32_t pktLen = 0;
+static uint32_t uartCmdFrame[(UART_MAX_CMD_MAX_PKT_SZ + 3) / 4];
+static uint8_t *uartCmdPacket = (uint8_t *)uartCmdFrame;
+static nnoMessageStruct *pUartMsg = (nnoMessageStruct *)&uartCmdFrame[UART_FRAME_HEADER_SIZE / 4];
+static UART_FRAME_RX uartFrameRx;
 
 #define UART_MAX_PACKET_DATA_SIZE (NNO_DATA_MAX_SIZE - 2)	//command size
 
@@ -75,19 +79,36 @@ static void cmdUARTWrite(CMD1_TYPE type);
 static bool uartSendResp();
 
 /**
- * This functions is called by the UART interrupt handler function in 
- * uartstdio.c. This copies the command packet from driver space to 
- * application space and notifies usbCmdHandlerTask() via semPktRecd semaphore.
+ * This functions is called by the UART interrupt handler in uartDma.c with
+ * the bytes received since the last call. They are framed straight into the
+ * command buffer, and uartCmdHandlerTask() is notified via semUARTPktRecd
+ * once a frame is complete or has been found bad.
  */
 int32_t cmdRecvUART(void *msgData, int32_t dataLen)
 {
-	pktLen = MIN(dataLen, sizeof(nnoMessageStruct));
-	memset(uartCmdPacket, 0, UART_MAX_CMD_MAX_PKT_SZ);
-	memcpy(uartCmdPacket, msgData, pktLen);
-	Semaphore_post(semUARTPktRecd);
+	if (UartFrame_RxBytes(&uartFrameRx, msgData, dataLen))
+		Semaphore_post(semUARTPktRecd);
 	return 0;
 }
 
+/**
+ * Called by the UART interrupt handler when the line has gone idle
+ */
+void cmdIdleUART(void)
+{
+	UartFrame_RxIdle(&uartFrameRx);
+}
+
+/**
+ * Called by the UART inter byte timer when nothing has been received for
+ * MAX_TIME_BET_DATA_PACKETS_US. A frame cut off is answered with an error.
+ */
+void cmdTimeoutUART(void)
+{
+	if (UartFrame_RxTimeout(&uartFrameRx))
+		Semaphore_post(semUARTPktRecd);
+}
+
 /**
  * Fetches 'nBytes' from the command packet. Value is copied to caller's
  * environment.
@@ -143,7 +164,7 @@ static void cmdUARTExecute(void)
 {
 	nano_timer_increment_activity_count();	// Register activity so that inactivity monitor knows about it
 
-	switch (pUartMsg->msg.head.flags.rw)
+	switch (pUartMsg->head.flags.rw)
 	{
 	case REQUEST:
 		cmdUARTWrite(CMD1_WRITE);
@@ -154,8 +175,8 @@ static void cmdUARTExecute(void)
 		break;
 
 	default: /* unknown CMD1 should never occur */
-		pUartMsg->msg.head.length = 0; /* set length */
-		pUartMsg->msg.head.flags.resp = NNO_RESP_ERROR; /* set handler error */
+		pUartMsg->head.length = 0; /* set length */
+		pUartMsg->head.flags.resp = NNO_RESP_ERROR; /* set handler error */
 		break;
 	}
 
@@ -170,14 +191,14 @@ static void cmdUARTRead(CMD1_TYPE cmd1)
 	uint32_t key;
 	int ret_val = 0;
 
-	key = ((pUartMsg->msg.payload.cmd << 8) | cmd1);
+	key = ((pUartMsg->payload.cmd << 8) | cmd1);
 
-	rdp = &pUartMsg->msg.payload.data[sizeof(pUartMsg->msg.payload.cmd)];
-	wrp = &pUartMsg->msg.payload.data[sizeof(pUartMsg->msg.payload.cmd)];
-	nRemReadPC = pUartMsg->msg.head.length - 2; /* number of read bytes */
+	rdp = &pUartMsg->payload.data[sizeof(pUartMsg->payload.cmd)];
+	wrp = &pUartMsg->payload.data[sizeof(pUartMsg->payload.cmd)];
+	nRemReadPC = pUartMsg->head.length - 2; /* number of read bytes */
 	/* no. of write bytes */
-	nRemWritePC = (uint16_t) (sizeof(pUartMsg->msg.payload) - sizeof(pUartMsg->msg.payload.cmd));
-	nWrittenUART = sizeof(pUartMsg->msg.payload.cmd); /* number of written bytes */
+	nRemWritePC = (uint16_t) (sizeof(pUartMsg->payload) - sizeof(pUartMsg->payload.cmd));
+	nWrittenUART = sizeof(pUartMsg->payload.cmd); /* number of written bytes */
 
 	rdp = rdp;
 		wrp = wrp;
@@ -209,19 +230,19 @@ static void cmdUARTRead(CMD1_TYPE cmd1)
 _uart_read_response:
 	if (CMD1_READ_RESPONSE == cc) /* if valid response */
 	{
-		pUartMsg->msg.head.length = nWrittenUART; /* set length */
-		pUartMsg->msg.head.flags.resp = NNO_RESP_SUCCESS; /* set ack no error */
+		pUartMsg->head.length = nWrittenUART; /* set length */
+		pUartMsg->head.flags.resp = NNO_RESP_SUCCESS; /* set ack no error */
 	}
 	else if (CMD1_BUSY == cc)
 	{
-		pUartMsg->msg.head.length = 0; /* set length */
-		pUartMsg->msg.head.flags.resp = NNO_RESP_BUSY;
+		pUartMsg->head.length = 0; /* set length */
+		pUartMsg->head.flags.resp = NNO_RESP_BUSY;
 		DEBUG_PRINT("Read Message - handler busy\r\n");
 	}
 	else
 	{
-		pUartMsg->msg.head.length = 0; /* set length */
-		pUartMsg->msg.head.flags.resp = NNO_RESP_ERROR; /* set handler error */
+		pUartMsg->head.length = 0; /* set length */
+		pUartMsg->head.flags.resp = NNO_RESP_ERROR; /* set handler error */
 		DEBUG_PRINT("Read Message handler error\r\n");
 	}
 }
@@ -229,17 +250,17 @@ _uart_read_response:
 static void cmdUARTWrite(CMD1_TYPE cmd1)
 {
 	CMD1_TYPE cc; /* response message code */
-	uint32_t key = ((pUartMsg->msg.payload.cmd << 8) | cmd1);
+	uint32_t key = ((pUartMsg->payload.cmd << 8) | cmd1);
 	int ret_val = 0;
 
 	/* pointer to next message byte to read */
-	rdp = &pUartMsg->msg.payload.data[sizeof(pUartMsg->msg.payload.cmd)];
+	rdp = &pUartMsg->payload.data[sizeof(pUartMsg->payload.cmd)];
 	/* pointer to next message byte to write */
-	wrp = &pUartMsg->msg.payload.data[sizeof(pUartMsg->msg.payload.cmd)];
-	nRemReadPC = pUartMsg->msg.head.length - 2; /* number of read bytes */
+	wrp = &pUartMsg->payload.data[sizeof(pUartMsg->payload.cmd)];
+	nRemReadPC = pUartMsg->head.length - 2; /* number of read bytes */
 	/* number of write bytes */
-	nRemWritePC = (uint16_t) (sizeof(pUartMsg->msg.payload) - sizeof(pUartMsg->msg.payload.cmd));
-	nWrittenUART = sizeof(pUartMsg->msg.payload.cmd); /* number of written bytes */
+	nRemWritePC = (uint16_t) (sizeof(pUartMsg->payload) - sizeof(pUartMsg->payload.cmd));
+	nWrittenUART = sizeof(pUartMsg->payload.cmd); /* number of written bytes */
 
 	rdp = rdp;
 	wrp = wrp;
@@ -271,19 +292,19 @@ static void cmdUARTWrite(CMD1_TYPE cmd1)
 _uart_write_response:
 	if (CMD1_WRITE_RESPONSE == cc) /* if valid response */
 	{
-		pUartMsg->msg.head.length = nWrittenUART; /* set length */
-		pUartMsg->msg.head.flags.resp = NNO_RESP_SUCCESS; /* set ack no error */
+		pUartMsg->head.length = nWrittenUART; /* set length */
+		pUartMsg->head.flags.resp = NNO_RESP_SUCCESS; /* set ack no error */
 	}
 	else if (CMD1_BUSY == cc)
 	{
-		pUartMsg->msg.head.length = 0; /* set length */
-		pUartMsg->msg.head.flags.resp = NNO_RESP_BUSY; /* set handler error */
+		pUartMsg->head.length = 0; /* set length */
+		pUartMsg->head.flags.resp = NNO_RESP_BUSY; /* set handler error */
 		DEBUG_PRINT("Write Message - handler busy\r\n");
 	}
 	else
 	{
-		pUartMsg->msg.head.length = 0; /* set length */
-		pUartMsg->msg.head.flags.resp = NNO_RESP_ERROR; /* set handler error */
+		pUartMsg->head.length = 0; /* set length */
+		pUartMsg->head.flags.resp = NNO_RESP_ERROR; /* set handler error */
 		DEBUG_PRINT("Write Message handler error\r\n");
 	}
 }
@@ -291,94 +312,68 @@ _uart_write_response:
 
 void uartCmdHandlerTask()
 {
-	uint32_t timeoutVal = BIOS_WAIT_FOREVER;
-	int i = 0;
-	uint32_t dataChkSum = 0;
-	uint8_t *pChar = NULL;
+	int32_t error;
+	UInt key;
+
+	key = Hwi_disable();
+	UartFrame_RxInit(&uartFrameRx, pUartMsg, UART_FRAME_MAX_PAYLOAD);
+	Hwi_restore(key);
 
 	while (true)
 	{
-		//Indefinite wait for first packet in a command and timed wait for subsequent packets if any
-		Semaphore_pend(semUARTPktRecd, timeoutVal);
-
-		/*
-		 * Sanity check
-		 * validate checksum first
-		 * then check if length works out OK
-		 */
-		i = 0;
-		dataChkSum = 0;
-		pChar = (uint8_t *)&uartCmdPacket[UART_START_IND_NUM_BYTES + sizeof(pUartMsg->chkSum)];
-		while (i < (pktLen - UART_START_IND_NUM_BYTES - UART_END_IND_NUM_BYTES - sizeof(pUartMsg->chkSum)))
-		{
-			dataChkSum += *(pChar + i);
-			i++;
-		}
+		// Wait for a frame; the UART interrupt has already checked its CRC or checksum
+		Semaphore_pend(semUARTPktRecd, BIOS_WAIT_FOREVER);
+
+		error = uartFrameRx.error;
+		if ((error == 0) &&
+			((pUartMsg->head.length < sizeof(pUartMsg->payload.cmd)) ||
+			 (sizeof(pUartMsg->head) + pUartMsg->head.length > uartFrameRx.length)))
+			error = UART_INPUT_PKT_LENGTH_ERROR;
 
-		if (pUartMsg->chkSum != dataChkSum)
+		if (error != 0)
 		{
-			pUartMsg->msg.head.flags.resp = NNO_RESP_ERROR;
-			pUartMsg->msg.head.length = sizeof(pUartMsg->msg.payload.cmd);
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_UART, true, UART_INPUT_PKT_CHECKSUM_ERROR);
+			memset(&pUartMsg->head, 0, sizeof(pUartMsg->head));
+			pUartMsg->head.flags.resp = NNO_RESP_ERROR;
+			nWrittenUART = 0;
+			nnoStatus_setErrorStatusAndCode(NNO_ERROR_UART, true, error);
 			uartSendResp();
 		}
 		else
 		{
 			cmdUARTExecute();
-			if (pUartMsg->msg.head.flags.reply)
+			if (pUartMsg->head.flags.reply)
 			{
 				uartSendResp();
 			}
-
 		}
 
+		// The buffer is free again once the response is out
+		key = Hwi_disable();
+		UartFrame_RxRelease(&uartFrameRx);
+		Hwi_restore(key);
 	}
 }
 
 static bool uartSendResp()
 {
-	int i = 0;
-	uint16_t endIndex = 0;
-	uint16_t len = 0;
-	uint8_t *pChar = NULL;
+	uint32_t len = 0;
 
 	/*
 	 * Compute length
 	 */
-	pUartMsg->msg.head.length = nWrittenUART;
+	pUartMsg->head.length = nWrittenUART;
 
-	/*
-	 * compute checksum for payload
-	 */
-	pUartMsg->chkSum = 0;	// reset to start with
-	pChar = (uint8_t *)&uartCmdPacket[UART_START_IND_NUM_BYTES \
-									  + sizeof(pUartMsg->chkSum)];
-	len = sizeof(nnoMessageStruct) - NNO_DATA_MAX_SIZE \
-		  + nWrittenUART;
+	len = UartFrame_Wrap(uartCmdPacket, sizeof(pUartMsg->head) + nWrittenUART,
+			uartFrameRx.format);
 
-	while (i < len)
+	if (UARTDmaWrite(uartCmdPacket, len) != PASS)
 	{
-		pUartMsg->chkSum += *(pChar + i);
-		i++;
-	}
-
-	/*
-	 * Add end indication bytes at appropriate position
-	 */
-	endIndex = sizeof(uartMessageStruct) - UART_END_IND_NUM_BYTES \
-			   - NNO_DATA_MAX_SIZE \
-			   + nWrittenUART;
-
-	uartCmdPacket[endIndex++] = UART_END_IND_BYTE_0;
-	uartCmdPacket[endIndex++] = UART_END_IND_BYTE_1;
-	uartCmdPacket[endIndex++] = UART_END_IND_BYTE_2;
-	uartCmdPacket[endIndex++] = UART_END_IND_BYTE_3;
-
-	if (endIndex != UARTwrite((const char *)&uartCmdPacket[0], endIndex))
+		nnoStatus_setErrorStatusAndCode(NNO_ERROR_UART, true, UART_WRITE_FAILED);
 		return FAIL;
+	}
 
-	if (len > 0)
-		UARTFlushTx(false);
+	while (UARTDmaTxBusy())
+		Task_sleep(1);
 
 	return PASS;
 }
@@ -0,0 +1,379 @@
+/*
+ *
+ * Framing of commands on the UART (see NNOUARTDefs.h), CRC frames or the
+ * earlier ABCD/DCBA framing, whichever a command starts with. The receiver is fed
+ * from the UART interrupt with whatever the DMA has collected, copies the
+ * payload straight into the command buffer while checking the CRC, and holds
+ * a finished frame until the command task has dealt with it. Gaps in the
+ * line are reported by the driver: a short one lets the receiver resync
+ * after a bad frame, a long one in the middle of a frame ends it as
+ * incomplete.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "usbBulkProto.h"
+#include "uartFrame.h"
+
+static const uint8_t frameMagic[4] =
+{
+	UART_FRAME_MAGIC & 0xFF,
+	(UART_FRAME_MAGIC >> 8) & 0xFF,
+	(UART_FRAME_MAGIC >> 16) & 0xFF,
+	(UART_FRAME_MAGIC >> 24) & 0xFF
+};
+
+static const uint8_t legacyStart[UART_START_IND_NUM_BYTES] =
+{
+	UART_START_IND_BYTE_0,
+	UART_START_IND_BYTE_1,
+	UART_START_IND_BYTE_2,
+	UART_START_IND_BYTE_3
+};
+
+static const uint8_t legacyEnd[UART_END_IND_NUM_BYTES] =
+{
+	UART_END_IND_BYTE_0,
+	UART_END_IND_BYTE_1,
+	UART_END_IND_BYTE_2,
+	UART_END_IND_BYTE_3
+};
+
+static void UartFrame_PutWord(uint8_t *pBuf, uint32_t val)
+{
+	pBuf[0] = val & 0xFF;
+	pBuf[1] = (val >> 8) & 0xFF;
+	pBuf[2] = (val >> 16) & 0xFF;
+	pBuf[3] = (val >> 24) & 0xFF;
+}
+
+static uint32_t UartFrame_GetWord(const uint8_t *pBuf)
+{
+	return (uint32_t)pBuf[0] | ((uint32_t)pBuf[1] << 8) |
+			((uint32_t)pBuf[2] << 16) | ((uint32_t)pBuf[3] << 24);
+}
+
+/* Sum of bytes, the checksum of the earlier framing */
+static uint32_t UartFrame_Sum(uint32_t sum, const uint8_t *pData, uint32_t length)
+{
+	while(length-- > 0)
+		sum += *pData++;
+	return sum;
+}
+
+static bool UartFrame_IsStart(const uint8_t *pBytes, uint32_t length)
+{
+	return ((memcmp(pBytes, frameMagic, length) == 0) ||
+			(memcmp(pBytes, legacyStart, length) == 0));
+}
+
+static void UartFrame_Hunt(UART_FRAME_RX *pRx, uint8_t byte)
+{
+	/* Keep the longest tail of what has been seen that could still start a
+	 * frame, so a run of garbage ahead of a frame cannot hide its start */
+	pRx->header[pRx->hdrBytes++] = byte;
+	while((pRx->hdrBytes > 0) && !UartFrame_IsStart(pRx->header, pRx->hdrBytes))
+	{
+		pRx->hdrBytes--;
+		memmove(pRx->header, &pRx->header[1], pRx->hdrBytes);
+		pRx->stats.num_dropped++;
+	}
+
+	if(pRx->hdrBytes == sizeof(frameMagic))
+	{
+		if(memcmp(pRx->header, frameMagic, sizeof(frameMagic)) == 0)
+			pRx->format = UART_FRAME_FORMAT_CRC;
+		else
+			pRx->format = UART_FRAME_FORMAT_LEGACY;
+		pRx->state = UART_FRAME_HEADER;
+	}
+}
+
+static bool UartFrame_CheckHeader(UART_FRAME_RX *pRx)
+{
+	uint16_t length = pRx->header[4] | (pRx->header[5] << 8);
+	uint16_t lengthInv = pRx->header[6] | (pRx->header[7] << 8);
+
+	pRx->received = 0;
+	pRx->crc = 0;
+
+	/* The earlier framing has a checksum here; the size of the message comes
+	 * from its head, see UartFrame_LegacySize() */
+	if(pRx->format == UART_FRAME_FORMAT_LEGACY)
+	{
+		pRx->length = UART_MSG_HEAD_SIZE;
+		pRx->sizeKnown = false;
+		pRx->state = UART_FRAME_PAYLOAD;
+		return true;
+	}
+
+	if(((uint16_t)~length != lengthInv) || (length == 0) || (length > pRx->maxLength))
+	{
+		pRx->error = UART_INPUT_PKT_LENGTH_ERROR;
+		pRx->stats.num_length_errors++;
+		pRx->state = UART_FRAME_ERROR;
+		return false;
+	}
+
+	pRx->length = length;
+	pRx->state = UART_FRAME_PAYLOAD;
+	return true;
+}
+
+static bool UartFrame_LegacySize(UART_FRAME_RX *pRx)
+{
+	uint32_t length = UART_MSG_HEAD_SIZE +
+			(pRx->pDst[offsetof(nnoMessageStruct, head.length)] |
+			 (pRx->pDst[offsetof(nnoMessageStruct, head.length) + 1] << 8));
+
+	pRx->sizeKnown = true;
+	if(length > pRx->maxLength)
+	{
+		pRx->error = UART_INPUT_PKT_LENGTH_ERROR;
+		pRx->stats.num_length_errors++;
+		pRx->state = UART_FRAME_ERROR;
+		return false;
+	}
+
+	pRx->length = length;
+	return true;
+}
+
+static int32_t UartFrame_CheckTrailer(const UART_FRAME_RX *pRx)
+{
+	if(pRx->format == UART_FRAME_FORMAT_CRC)
+		return (UartFrame_GetWord(pRx->trailer) == pRx->crc) ? 0 : UART_INPUT_PKT_CHECKSUM_ERROR;
+
+	/* An end anywhere else means head.length was wrong */
+	if(memcmp(pRx->trailer, legacyEnd, sizeof(legacyEnd)) != 0)
+		return UART_INPUT_PKT_LENGTH_ERROR;
+
+	return (UartFrame_GetWord(&pRx->header[UART_START_IND_NUM_BYTES]) == pRx->crc) ?
+			0 : UART_INPUT_PKT_CHECKSUM_ERROR;
+}
+
+void UartFrame_RxInit(UART_FRAME_RX *pRx, void *pDst, uint32_t maxLength)
+	/**
+	 * Sets up the receiver, looking for the start of a frame.
+	 *
+	 * @param pRx       - O - receiver state
+	 * @param pDst      - I - where the payload of a frame goes
+	 * @param maxLength - I - bytes available at pDst
+	 *
+	 * @return none
+	 */
+{
+	memset(pRx, 0, sizeof(UART_FRAME_RX));
+	pRx->pDst = (uint8_t *)pDst;
+	pRx->maxLength = maxLength;
+	pRx->state = UART_FRAME_HUNT;
+	pRx->lineIdle = true;
+}
+
+bool UartFrame_RxBytes(UART_FRAME_RX *pRx, const void *pData, uint32_t length)
+	/**
+	 * Takes bytes received on the line. Bytes that arrive while a frame is
+	 * held, or while skipping after a bad one, are dropped.
+	 *
+	 * @param pRx    - I/O - receiver state
+	 * @param pData  - I - bytes in the order received
+	 * @param length - I - bytes in pData
+	 *
+	 * @return true if these bytes finished a frame, good (state DONE) or bad
+	 *         (state ERROR)
+	 */
+{
+	const uint8_t *p = (const uint8_t *)pData;
+	bool ended = false;
+	uint32_t n;
+
+	if(length > 0)
+		pRx->lineIdle = false;
+
+	while(length > 0)
+	{
+		switch(pRx->state)
+		{
+			case UART_FRAME_HUNT:
+				UartFrame_Hunt(pRx, *p++);
+				length--;
+				break;
+
+			case UART_FRAME_HEADER:
+				pRx->header[pRx->hdrBytes++] = *p++;
+				length--;
+				if((pRx->hdrBytes == UART_FRAME_HEADER_SIZE) && !UartFrame_CheckHeader(pRx))
+					ended = true;
+				break;
+
+			case UART_FRAME_PAYLOAD:
+				if(pRx->received < pRx->length)
+				{
+					n = pRx->length - pRx->received;
+					if(n > length)
+						n = length;
+					memcpy(&pRx->pDst[pRx->received], p, n);
+					if(pRx->format == UART_FRAME_FORMAT_CRC)
+						pRx->crc = UsbBulkProto_Crc(pRx->crc, p, n);
+					else
+						pRx->crc = UartFrame_Sum(pRx->crc, p, n);
+					pRx->received += n;
+					p += n;
+					length -= n;
+					if((pRx->format == UART_FRAME_FORMAT_LEGACY) && !pRx->sizeKnown &&
+							(pRx->received == pRx->length) && !UartFrame_LegacySize(pRx))
+						ended = true;
+					break;
+				}
+
+				pRx->trailer[pRx->received++ - pRx->length] = *p++;
+				length--;
+				if(pRx->received < pRx->length + UART_FRAME_CRC_SIZE)
+					break;
+
+				pRx->error = UartFrame_CheckTrailer(pRx);
+				if(pRx->error == UART_INPUT_PKT_CHECKSUM_ERROR)
+				{
+					pRx->stats.num_crc_errors++;
+					pRx->state = UART_FRAME_ERROR;
+				}
+				else if(pRx->error != 0)
+				{
+					pRx->stats.num_length_errors++;
+					pRx->state = UART_FRAME_ERROR;
+				}
+				else
+				{
+					pRx->stats.num_frames++;
+					pRx->state = UART_FRAME_DONE;
+				}
+				ended = true;
+				break;
+
+			default:
+				if(pRx->state != UART_FRAME_SKIP)
+					pRx->heldDrop = true;
+				pRx->stats.num_dropped += length;
+				length = 0;
+				break;
+		}
+	}
+
+	return ended;
+}
+
+void UartFrame_RxIdle(UART_FRAME_RX *pRx)
+	/**
+	 * Called when the line has been idle for a character time. Ends skipping
+	 * after a bad frame; a frame in progress carries on, as a host may pause
+	 * briefly in the middle of one.
+	 *
+	 * @param pRx - I/O - receiver state
+	 *
+	 * @return none
+	 */
+{
+	pRx->lineIdle = true;
+	if(pRx->state == UART_FRAME_SKIP)
+	{
+		pRx->hdrBytes = 0;
+		pRx->state = UART_FRAME_HUNT;
+	}
+}
+
+bool UartFrame_RxTimeout(UART_FRAME_RX *pRx)
+	/**
+	 * Called when nothing has been received for MAX_TIME_BET_DATA_PACKETS_US.
+	 * A frame in progress is ended as incomplete.
+	 *
+	 * @param pRx - I/O - receiver state
+	 *
+	 * @return true if a frame was ended (state ERROR)
+	 */
+{
+	UartFrame_RxIdle(pRx);
+
+	switch(pRx->state)
+	{
+		case UART_FRAME_HUNT:
+			pRx->stats.num_dropped += pRx->hdrBytes;
+			pRx->hdrBytes = 0;
+			return false;
+
+		case UART_FRAME_HEADER:
+		case UART_FRAME_PAYLOAD:
+			pRx->error = UART_INPUT_PKT_INCOMPLETE;
+			pRx->stats.num_incomplete++;
+			pRx->state = UART_FRAME_ERROR;
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+void UartFrame_RxRelease(UART_FRAME_RX *pRx)
+	/**
+	 * Lets the receiver go on once the frame it holds has been dealt with.
+	 * The next frame may follow a good one straight away. After a bad frame,
+	 * or if bytes were dropped while the frame was held, whatever comes
+	 * until the line is next idle cannot be framed any more and is skipped.
+	 *
+	 * @param pRx - I/O - receiver state
+	 *
+	 * @return none
+	 */
+{
+	if((pRx->state != UART_FRAME_DONE) && (pRx->state != UART_FRAME_ERROR))
+		return;
+
+	if(pRx->lineIdle || ((pRx->state == UART_FRAME_DONE) && !pRx->heldDrop))
+		pRx->state = UART_FRAME_HUNT;
+	else
+		pRx->state = UART_FRAME_SKIP;
+
+	pRx->hdrBytes = 0;
+	pRx->error = 0;
+	pRx->heldDrop = false;
+}
+
+uint32_t UartFrame_Wrap(uint8_t *pFrame, uint32_t length, UART_FRAME_FORMAT format)
+	/**
+	 * Turns a payload into a frame by filling in the header in front of it
+	 * and the CRC after it, or the start, checksum and end of the earlier
+	 * framing.
+	 *
+	 * @param pFrame - I/O - frame; the payload starts at
+	 *                 pFrame[UART_FRAME_HEADER_SIZE] and there must be room
+	 *                 for UART_FRAME_CRC_SIZE bytes after it
+	 * @param length - I - payload bytes
+	 * @param format - I - framing of the command being answered
+	 *
+	 * @return frame bytes to send
+	 */
+{
+	if(format == UART_FRAME_FORMAT_LEGACY)
+	{
+		memcpy(pFrame, legacyStart, sizeof(legacyStart));
+		UartFrame_PutWord(&pFrame[UART_START_IND_NUM_BYTES],
+				UartFrame_Sum(0, &pFrame[UART_FRAME_HEADER_SIZE], length));
+		memcpy(&pFrame[UART_FRAME_HEADER_SIZE + length], legacyEnd, sizeof(legacyEnd));
+		return UART_FRAME_HEADER_SIZE + length + UART_END_IND_NUM_BYTES;
+	}
+
+	UartFrame_PutWord(pFrame, UART_FRAME_MAGIC);
+	pFrame[4] = length & 0xFF;
+	pFrame[5] = (length >> 8) & 0xFF;
+	pFrame[6] = ~length & 0xFF;
+	pFrame[7] = (~length >> 8) & 0xFF;
+	UartFrame_PutWord(&pFrame[UART_FRAME_HEADER_SIZE + length],
+			UsbBulkProto_Crc(0, &pFrame[UART_FRAME_HEADER_SIZE], length));
+
+	return UART_FRAME_HEADER_SIZE + length + UART_FRAME_CRC_SIZE;
+}
@@ -0,0 +1,233 @@
+/*
+ *
+ * Transfers of large files over the USB vendor bulk interface. Commands on
+ * the HID interface set up one frame at a time (see NNOUSBBulkDefs.h); the
+ * packets of the frame are then moved from the USB interrupt, one per TX
+ * complete or RX available event, without involving the command task. The
+ * HID interface stays free for other commands while a frame is in flight.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <xdc/std.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <usblib/usblib.h>
+#include <usblib/device/usbdevice.h>
+#include <usblib/device/usbdbulk.h>
+#include "common.h"
+#include "usbBulkProto.h"
+#include "usbBulk.h"
+
+#ifdef NIRSCAN_USB_BULK
+
+extern tUSBDBulkDevice NirscanBulkDevice;
+
+static USB_BULK_TX bulkTx;
+static USB_BULK_RX bulkRx;
+static volatile USB_BULK_STATE bulkState = USB_BULK_STATE_OFFLINE;
+static volatile USB_BULK_ERROR bulkError = USB_BULK_ERR_NONE;
+static uint16_t bulkTag = 0;
+static bool bulkIn = false;						// last transfer was to the host
+static uint8_t txPkt[USB_BULK_MAX_PKT_SIZE];
+static uint8_t rxPkt[USB_BULK_MAX_PKT_SIZE];
+
+static void UsbBulk_SendNext(void)
+{
+	uint32_t length;
+
+	if(!UsbBulkProto_TxNext(&bulkTx, txPkt, &length))
+	{
+		bulkState = USB_BULK_STATE_DONE;
+		return;
+	}
+
+	if(USBDBulkPacketWrite((void *)&NirscanBulkDevice, txPkt, length, true) != length)
+	{
+		bulkError = USB_BULK_ERR_TX;
+		bulkState = USB_BULK_STATE_ERROR;
+	}
+}
+
+void UsbBulk_Connected(void)
+	/**
+	 * Called from the USB interrupt when the host has configured the bulk
+	 * interface.
+	 *
+	 * @return none
+	 */
+{
+	bulkError = USB_BULK_ERR_NONE;
+	bulkState = USB_BULK_STATE_IDLE;
+}
+
+void UsbBulk_Disconnected(void)
+	/**
+	 * Called from the USB interrupt when the host has gone. A transfer in
+	 * flight is dropped.
+	 *
+	 * @return none
+	 */
+{
+	if((bulkState == USB_BULK_STATE_SENDING) || (bulkState == USB_BULK_STATE_RECEIVING))
+		bulkError = USB_BULK_ERR_ABORTED;
+	bulkState = USB_BULK_STATE_OFFLINE;
+}
+
+void UsbBulk_RxAvailable(void)
+	/**
+	 * Called from the USB interrupt when a packet has arrived on the bulk OUT
+	 * endpoint. Packets that do not belong to a frame that was set up are
+	 * dropped so that they cannot stall the endpoint.
+	 *
+	 * @return none
+	 */
+{
+	uint32_t length;
+
+	length = USBDBulkPacketRead((void *)&NirscanBulkDevice, rxPkt, USB_BULK_MAX_PKT_SIZE, true);
+
+	if(bulkState != USB_BULK_STATE_RECEIVING)
+		return;
+
+	switch(UsbBulkProto_RxPacket(&bulkRx, rxPkt, length))
+	{
+		case USB_BULK_STATE_DONE:
+			bulkState = USB_BULK_STATE_DONE;
+			break;
+		case USB_BULK_STATE_ERROR:
+			bulkError = bulkRx.error;
+			bulkState = USB_BULK_STATE_ERROR;
+			break;
+		default:
+			break;
+	}
+}
+
+void UsbBulk_TxComplete(void)
+	/**
+	 * Called from the USB interrupt when the host has taken the last packet
+	 * sent on the bulk IN endpoint; queues the next one.
+	 *
+	 * @return none
+	 */
+{
+	if(bulkState == USB_BULK_STATE_SENDING)
+		UsbBulk_SendNext();
+}
+
+int UsbBulk_StartSend(uint16_t tag, const void *pData, uint32_t length)
+	/**
+	 * Starts sending a frame on the bulk IN endpoint. The data is sent in
+	 * place; the caller must not change it while UsbBulk_IsBusy() is true.
+	 *
+	 * @param tag    - I - tag for the frame header, given by the host
+	 * @param pData  - I - payload
+	 * @param length - I - payload bytes
+	 *
+	 * @return PASS or FAIL if the interface is offline or busy
+	 */
+{
+	UInt key;
+
+	if((bulkState == USB_BULK_STATE_OFFLINE) || UsbBulk_IsBusy())
+		return FAIL;
+
+	UsbBulkProto_TxStart(&bulkTx, tag, pData, length, USB_BULK_MAX_PKT_SIZE);
+	bulkTag = tag;
+	bulkIn = true;
+	bulkError = USB_BULK_ERR_NONE;
+
+	key = Hwi_disable();
+	bulkState = USB_BULK_STATE_SENDING;
+	UsbBulk_SendNext();
+	Hwi_restore(key);
+
+	return (bulkState == USB_BULK_STATE_ERROR) ? FAIL : PASS;
+}
+
+int UsbBulk_StartReceive(uint16_t tag, void *pDst, uint32_t maxLength)
+	/**
+	 * Makes the bulk OUT endpoint take the next frame from the host. Progress
+	 * is read back with UsbBulk_GetStatus().
+	 *
+	 * @param tag       - I - tag the frame must carry, given by the host
+	 * @param pDst      - I - where the payload goes
+	 * @param maxLength - I - size of pDst
+	 *
+	 * @return PASS or FAIL if the interface is offline or busy
+	 */
+{
+	if((bulkState == USB_BULK_STATE_OFFLINE) || UsbBulk_IsBusy())
+		return FAIL;
+
+	UsbBulkProto_RxStart(&bulkRx, tag, pDst, maxLength);
+	bulkTag = tag;
+	bulkIn = false;
+	bulkError = USB_BULK_ERR_NONE;
+	bulkState = USB_BULK_STATE_RECEIVING;
+
+	return PASS;
+}
+
+void UsbBulk_Abort(void)
+	/**
+	 * Drops the transfer in flight, if any. Packets already handed to the
+	 * driver still go out.
+	 *
+	 * @return none
+	 */
+{
+	UInt key;
+
+	key = Hwi_disable();
+	if(UsbBulk_IsBusy())
+	{
+		bulkError = USB_BULK_ERR_ABORTED;
+		bulkState = USB_BULK_STATE_ERROR;
+	}
+	Hwi_restore(key);
+}
+
+bool UsbBulk_IsBusy(void)
+	/**
+	 * @return true while a frame is being sent or received
+	 */
+{
+	return (bulkState == USB_BULK_STATE_SENDING) || (bulkState == USB_BULK_STATE_RECEIVING);
+}
+
+void UsbBulk_GetStatus(USB_BULK_STATUS *pStatus)
+	/**
+	 * Returns the state of the bulk interface and of the last transfer.
+	 *
+	 * @param pStatus - O - status
+	 *
+	 * @return none
+	 */
+{
+	UInt key;
+
+	key = Hwi_disable();
+	pStatus->state = bulkState;
+	pStatus->error = bulkError;
+	pStatus->tag = bulkTag;
+	if(bulkIn)
+	{
+		pStatus->total = bulkTx.length;
+		pStatus->done = (bulkTx.pos > USB_BULK_FRAME_HEADER_SIZE) ?
+				bulkTx.pos - USB_BULK_FRAME_HEADER_SIZE : 0;
+	}
+	else
+	{
+		pStatus->total = bulkRx.length;
+		pStatus->done = bulkRx.received;
+	}
+	Hwi_restore(key);
+}
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ *
+ * Framing of USB bulk transfers (see NNOUSBBulkDefs.h). The sender hands out
+ * one packet at a time so it can be driven from the TX complete interrupt;
+ * the receiver takes packets as they arrive and copies the payload straight
+ * to its destination while checking the CRC.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "usbBulkProto.h"
+
+/* CRC-32 (IEEE 802.3), 4 bits at a time */
+static const uint32_t crcNibbleTable[16] =
+{
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+	0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+	0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static void UsbBulkProto_PutWord(uint8_t *pBuf, uint32_t val)
+{
+	pBuf[0] = val & 0xFF;
+	pBuf[1] = (val >> 8) & 0xFF;
+	pBuf[2] = (val >> 16) & 0xFF;
+	pBuf[3] = (val >> 24) & 0xFF;
+}
+
+static uint32_t UsbBulkProto_GetWord(const uint8_t *pBuf)
+{
+	return (uint32_t)pBuf[0] | ((uint32_t)pBuf[1] << 8) |
+			((uint32_t)pBuf[2] << 16) | ((uint32_t)pBuf[3] << 24);
+}
+
+uint32_t UsbBulkProto_Crc(uint32_t crc, const void *pData, uint32_t length)
+	/**
+	 * Updates a CRC-32 with a block of data. Start with crc = 0.
+	 *
+	 * @param crc    - I - CRC of the data so far
+	 * @param pData  - I - data
+	 * @param length - I - bytes in pData
+	 *
+	 * @return updated CRC
+	 */
+{
+	const uint8_t *p = (const uint8_t *)pData;
+
+	crc = ~crc;
+	while(length--)
+	{
+		crc ^= *p++;
+		crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+		crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+void UsbBulkProto_TxStart(USB_BULK_TX *pTx, uint16_t tag, const void *pData,
+		uint32_t length, uint16_t maxPkt)
+	/**
+	 * Sets up a frame to be sent. The payload is read in place by
+	 * UsbBulkProto_TxNext() and must not change until the frame is out.
+	 *
+	 * @param pTx    - O - sender state
+	 * @param tag    - I - tag for the frame header
+	 * @param pData  - I - payload
+	 * @param length - I - payload bytes
+	 * @param maxPkt - I - max packet size of the bulk IN endpoint
+	 *
+	 * @return none
+	 */
+{
+	pTx->pData = (const uint8_t *)pData;
+	pTx->length = length;
+	pTx->pos = 0;
+	pTx->maxPkt = maxPkt;
+	pTx->zlpPending = false;
+	pTx->done = false;
+
+	UsbBulkProto_PutWord(&pTx->header[0], USB_BULK_FRAME_MAGIC);
+	pTx->header[4] = USB_BULK_PROTO_VERSION;
+	pTx->header[5] = 0;
+	pTx->header[6] = tag & 0xFF;
+	pTx->header[7] = (tag >> 8) & 0xFF;
+	UsbBulkProto_PutWord(&pTx->header[8], length);
+	UsbBulkProto_PutWord(&pTx->header[12], UsbBulkProto_Crc(0, pData, length));
+}
+
+bool UsbBulkProto_TxNext(USB_BULK_TX *pTx, uint8_t *pPkt, uint32_t *pLength)
+	/**
+	 * Gives the next packet of the frame. The first packet carries the header
+	 * followed by the start of the payload.
+	 *
+	 * @param pTx     - I/O - sender state
+	 * @param pPkt    - O   - packet, at least maxPkt bytes
+	 * @param pLength - O   - packet bytes; 0 for the closing zero length packet
+	 *
+	 * @return false once the whole frame has been handed out
+	 */
+{
+	uint32_t total = USB_BULK_FRAME_HEADER_SIZE + pTx->length;
+	uint32_t n = 0;
+	uint32_t chunk;
+
+	if(pTx->done)
+		return false;
+
+	if(pTx->zlpPending)
+	{
+		pTx->zlpPending = false;
+		pTx->done = true;
+		*pLength = 0;
+		return true;
+	}
+
+	if(pTx->pos < USB_BULK_FRAME_HEADER_SIZE)
+	{
+		n = USB_BULK_FRAME_HEADER_SIZE - pTx->pos;
+		if(n > pTx->maxPkt)
+			n = pTx->maxPkt;
+		memcpy(pPkt, &pTx->header[pTx->pos], n);
+		pTx->pos += n;
+	}
+
+	chunk = total - pTx->pos;
+	if(chunk > pTx->maxPkt - n)
+		chunk = pTx->maxPkt - n;
+	memcpy(&pPkt[n], &pTx->pData[pTx->pos - USB_BULK_FRAME_HEADER_SIZE], chunk);
+	pTx->pos += chunk;
+	n += chunk;
+
+	if(pTx->pos == total)
+	{
+		/* A full last packet does not tell the host the frame is over */
+		if(n == pTx->maxPkt)
+			pTx->zlpPending = true;
+		else
+			pTx->done = true;
+	}
+
+	*pLength = n;
+	return true;
+}
+
+void UsbBulkProto_RxStart(USB_BULK_RX *pRx, uint16_t tag, void *pDst,
+		uint32_t maxLength)
+	/**
+	 * Sets up reception of one frame.
+	 *
+	 * @param pRx       - O - receiver state
+	 * @param tag       - I - tag the frame header must carry
+	 * @param pDst      - I - where the payload goes
+	 * @param maxLength - I - size of pDst
+	 *
+	 * @return none
+	 */
+{
+	memset(pRx, 0, sizeof(USB_BULK_RX));
+	pRx->pDst = (uint8_t *)pDst;
+	pRx->maxLength = maxLength;
+	pRx->tag = tag;
+	pRx->state = USB_BULK_STATE_RECEIVING;
+}
+
+static USB_BULK_STATE UsbBulkProto_RxFail(USB_BULK_RX *pRx, USB_BULK_ERROR error)
+{
+	pRx->error = error;
+	pRx->state = USB_BULK_STATE_ERROR;
+	return pRx->state;
+}
+
+USB_BULK_STATE UsbBulkProto_RxPacket(USB_BULK_RX *pRx, const uint8_t *pPkt,
+		uint32_t length)
+	/**
+	 * Takes the next packet from the bulk OUT endpoint. Packets that arrive
+	 * after the frame has completed or failed are ignored.
+	 *
+	 * @param pRx    - I/O - receiver state
+	 * @param pPkt   - I   - packet
+	 * @param length - I   - packet bytes
+	 *
+	 * @return RECEIVING while more is expected, then DONE or ERROR
+	 */
+{
+	uint32_t n;
+
+	if(pRx->state != USB_BULK_STATE_RECEIVING)
+		return pRx->state;
+
+	if(pRx->hdrBytes < USB_BULK_FRAME_HEADER_SIZE)
+	{
+		n = USB_BULK_FRAME_HEADER_SIZE - pRx->hdrBytes;
+		if(n > length)
+			n = length;
+		memcpy(&pRx->header[pRx->hdrBytes], pPkt, n);
+		pRx->hdrBytes += n;
+		pPkt += n;
+		length -= n;
+
+		if(pRx->hdrBytes < USB_BULK_FRAME_HEADER_SIZE)
+			return pRx->state;
+
+		if((UsbBulkProto_GetWord(&pRx->header[0]) != USB_BULK_FRAME_MAGIC) ||
+				(pRx->header[4] != USB_BULK_PROTO_VERSION))
+			return UsbBulkProto_RxFail(pRx, USB_BULK_ERR_MAGIC);
+		if((pRx->header[6] | (pRx->header[7] << 8)) != pRx->tag)
+			return UsbBulkProto_RxFail(pRx, USB_BULK_ERR_TAG);
+		pRx->length = UsbBulkProto_GetWord(&pRx->header[8]);
+		if(pRx->length > pRx->maxLength)
+			return UsbBulkProto_RxFail(pRx, USB_BULK_ERR_LENGTH);
+	}
+
+	if(length > pRx->length - pRx->received)
+		return UsbBulkProto_RxFail(pRx, USB_BULK_ERR_OVERRUN);
+
+	memcpy(&pRx->pDst[pRx->received], pPkt, length);
+	pRx->crc = UsbBulkProto_Crc(pRx->crc, pPkt, length);
+	pRx->received += length;
+
+	if(pRx->received == pRx->length)
+	{
+		if(pRx->crc != UsbBulkProto_GetWord(&pRx->header[12]))
+			return UsbBulkProto_RxFail(pRx, USB_BULK_ERR_CRC);
+		pRx->state = USB_BULK_STATE_DONE;
+	}
+
+	return pRx->state;
+}
@@ -1,7 +1,13 @@
 /*
- * This file hosts the task to handle commands recieved through
+ * This file hosts the tasks to handle commands recieved through
  * USB interface
  *
+ * The receive task assembles commands from HID reports. Status queries are
+ * answered right away; all other commands are queued for the worker task
+ * and run one at a time in the order received (see usbCmdQueue.c). A slow
+ * command therefore no longer holds up status polls, and the host can have
+ * several commands outstanding, matching responses by their seq byte.
+ *
  * Copyright (C) 2006-2015 Texas Instruments Incorporated - http://www.ti.com/
  * ALL RIGHTS RESERVED
  *
@@ -18,6 +24,8 @@
 #include <stdint.h>
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/gates/GateMutex.h>
 /* usblib Header files */
 #include <usblib/usb-ids.h>
 #include <usblib/usblib.h>
@@ -34,6 +42,7 @@
 #include "nano_timer.h"
 #include "nnoStatus.h"
 #include "usbCmdHandler.h"
+#include "usbCmdQueue.h"
 
 /**
  * Message parser variables
@@ -51,15 +60,38 @@ uint8_t pktState = HEADER; /* pointer to the Header of the message */
 
 union parmUnionType parmUnionUSB; /* macro helper object. See cmdHandler.h */
 
+/**
+ * Message parser variables of a command interrupted by one that is answered
+ * from the receive task
+ */
+typedef struct _usbParserState
+{
+	uint16_t nWritten;
+	int16_t nRemReadPC;
+	int16_t nRemWritePC;
+	uint8_t *rdp;
+	uint8_t *wrp;
+	union parmUnionType parmUnion;
+} USB_PARSER_STATE;
+
 /**
  * 4-byte aligned message structure. Alignment is
  * required since a pointer to this struct will be
  * passed to the USB driver
  */
-static nnoMessageStruct Msg;
-nnoMessageStruct *pMsg = (nnoMessageStruct*) &Msg;/*USB HID msg structure*/
+static nnoMessageStruct Msg; /* command being received */
 static uint8_t cmdPacket[HID_MAX_PKT_SIZE];
 
+static Semaphore_Handle cmdQueuedSem = NULL; /* one count per queued command */
+static GateMutex_Handle usbTxGate = NULL; /* one response on the wire at a time */
+static bool workerRunning = false;
+
+/**
+ * Data queued by cmdStreamUSB() to follow the response of the current command
+ */
+static const uint8_t *pStreamData = NULL;
+static uint32_t nStreamBytes = 0;
+
 extern Semaphore_Handle semPktRecd; /* This is defined in app.cfg */
 extern tUSBDHIDCustomHidDevice NirscanNanoDevice;
 
@@ -67,9 +99,14 @@ extern tUSBDHIDCustomHidDevice NirscanNanoDevice;
  * Local functions
  */
 
-static uint16_t cmdUSBExecute(void);
-static void cmdUSBRead(CMD1_TYPE type);
-static void cmdUSBWrite(CMD1_TYPE type);
+static uint16_t cmdUSBExecute(nnoMessageStruct *pMsg);
+static void cmdUSBExecuteNow(nnoMessageStruct *pMsg);
+static void cmdUSBDispatch(nnoMessageStruct *pMsg);
+static void cmdUSBReply(nnoMessageStruct *pMsg, bool sendStream);
+static void cmdUSBRead(nnoMessageStruct *pMsg, CMD1_TYPE type);
+static void cmdUSBWrite(nnoMessageStruct *pMsg, CMD1_TYPE type);
+static void cmdUSBWaitTxIdle(void);
+static void cmdUSBSendStream(void);
 
 /**
  * Set USB as the active command connection interface
@@ -186,6 +223,215 @@ bool cmdIncWriteUSB(int32_t nBytes)
 	return true; /* success */
 }
 
+/**
+ * Queues 'nBytes' from 'pData' to be sent to the host as raw 64 byte reports
+ * right after the response of the command being processed. The last report is
+ * zero padded. The data is sent in place, without being copied, and the
+ * worker does not start the next queued command until it is out, so the
+ * caller only has to keep it unchanged until it returns from the command
+ * handler. Not for commands answered from the receive task.
+ *
+ * @param pData [in] data to send
+ * @param nBytes [in] number of bytes to send
+ *
+ * @return true on success; false if a stream is already queued.
+ */
+bool cmdStreamUSB(const void *pData, uint32_t nBytes)
+{
+	if (pStreamData != NULL)
+		return false;
+
+	pStreamData = (const uint8_t *) pData;
+	nStreamBytes = nBytes;
+
+	return true;
+}
+
+/**
+ * Blocks until the last report has been sent, letting lower priority tasks run
+ * meanwhile.
+ */
+static void cmdUSBWaitTxIdle(void)
+{
+	while (!USBDHIDCustomHidTxIdle(&NirscanNanoDevice))
+		Task_sleep(1);
+}
+
+/**
+ * Sends the data queued by cmdStreamUSB(). Whole reports go out straight from
+ * the caller's buffer in transfers of up to USB_STREAM_CHUNK_SIZE bytes; only
+ * the partial last report is copied to be zero padded.
+ */
+static void cmdUSBSendStream(void)
+{
+	uint8_t lastPkt[HID_MAX_PKT_SIZE];
+	uint32_t nSent = 0;
+	uint32_t nChunk;
+	uint32_t nWhole = nStreamBytes - (nStreamBytes % HID_MAX_PKT_SIZE);
+
+	while (nSent < nWhole)
+	{
+		nChunk = MIN(nWhole - nSent, USB_STREAM_CHUNK_SIZE);
+		cmdUSBWaitTxIdle();
+		if (USBDHIDCustomHidStream(&NirscanNanoDevice, &pStreamData[nSent],
+				nChunk) != CUSTOMHID_SUCCESS)
+			break;
+		nSent += nChunk;
+	}
+
+	if ((nSent == nWhole) && (nStreamBytes > nWhole))
+	{
+		memset(lastPkt, 0, HID_MAX_PKT_SIZE);
+		memcpy(lastPkt, &pStreamData[nWhole], nStreamBytes - nWhole);
+		cmdUSBWaitTxIdle();
+		USBDHIDCustomHidResponse(&NirscanNanoDevice, (signed char *) lastPkt,
+				HID_MAX_PKT_SIZE);
+	}
+
+	/* The data may be reused by the next command once it is out */
+	cmdUSBWaitTxIdle();
+}
+
+/**
+ * Sends the response to a command if the host asked for one, followed by the
+ * data queued by cmdStreamUSB() when 'sendStream' is set. Responses from the
+ * receive and worker tasks take turns on the interrupt IN endpoint.
+ */
+static void cmdUSBReply(nnoMessageStruct *pMsg, bool sendStream)
+{
+	IArg key = 0;
+
+	if (!pMsg->head.flags.reply)
+		return;
+
+	if (usbTxGate != NULL)
+		key = GateMutex_enter(usbTxGate);
+
+	/* The driver copies the response into the report buffer of the previous
+	 * one, so let that go out first */
+	cmdUSBWaitTxIdle();
+	USBDHIDCustomHidResponse(&NirscanNanoDevice, (signed char *) pMsg,
+			(sizeof(pMsg->head) + pMsg->head.length));
+	if (sendStream && (pStreamData != NULL))
+		cmdUSBSendStream();
+
+	if (usbTxGate != NULL)
+		GateMutex_leave(usbTxGate, key);
+}
+
+/**
+ * Runs a command from the receive task. The worker may have been preempted
+ * in the middle of a command of its own, so its parser state is put back
+ * once the response has been built.
+ */
+static void cmdUSBExecuteNow(nnoMessageStruct *pMsg)
+{
+	USB_PARSER_STATE saved;
+
+	saved.nWritten = nWritten;
+	saved.nRemReadPC = nRemReadPC;
+	saved.nRemWritePC = nRemWritePC;
+	saved.rdp = rdp;
+	saved.wrp = wrp;
+	saved.parmUnion = parmUnionUSB;
+
+	cmdUSBExecute(pMsg);
+
+	nWritten = saved.nWritten;
+	nRemReadPC = saved.nRemReadPC;
+	nRemWritePC = saved.nRemWritePC;
+	rdp = saved.rdp;
+	wrp = saved.wrp;
+	parmUnionUSB = saved.parmUnion;
+}
+
+/**
+ * Answers a complete command from the receive task or hands it to the
+ * worker. A command that does not fit in the queue is answered busy.
+ */
+static void cmdUSBDispatch(nnoMessageStruct *pMsg)
+{
+	if (!workerRunning)
+	{
+		cmdUSBExecute(pMsg);
+		cmdUSBReply(pMsg, true);
+		pStreamData = NULL;
+		nStreamBytes = 0;
+		return;
+	}
+
+	switch (UsbCmdQueue_Submit(pMsg))
+	{
+	case USB_CMD_RUN_NOW:
+		cmdUSBExecuteNow(pMsg);
+		cmdUSBReply(pMsg, false);
+		break;
+
+	case USB_CMD_QUEUED:
+		Semaphore_post(cmdQueuedSem);
+		break;
+
+	default:
+		pMsg->head.length = 0; /* set length */
+		pMsg->head.flags.resp = NNO_RESP_BUSY;
+		DEBUG_PRINT("USB command queue full\r\n");
+		cmdUSBReply(pMsg, false);
+		break;
+	}
+}
+
+/**
+ * Creates the queue semaphore and the response gate. Must be called before
+ * BIOS_start() runs the worker task.
+ *
+ * @return PASS or FAIL
+ */
+int usbCmdWorkerInit(void)
+{
+	Error_Block eb;
+
+	UsbCmdQueue_Init();
+
+	Error_init(&eb);
+	cmdQueuedSem = Semaphore_create(0, NULL, &eb);
+	if (cmdQueuedSem == NULL)
+		return FAIL;
+
+	Error_init(&eb);
+	usbTxGate = GateMutex_create(NULL, &eb);
+	if (usbTxGate == NULL)
+		return FAIL;
+
+	return PASS;
+}
+
+/**
+ * Runs the queued commands in the order they were received and sends their
+ * responses. Until this task is running the receive task runs every command
+ * itself.
+ */
+void usbCmdWorkerTask(void)
+{
+	nnoMessageStruct *pCmdMsg;
+
+	workerRunning = true;
+
+	while (true)
+	{
+		Semaphore_pend(cmdQueuedSem, BIOS_WAIT_FOREVER);
+
+		pCmdMsg = UsbCmdQueue_Front();
+		if (pCmdMsg == NULL)
+			continue;
+
+		cmdUSBExecute(pCmdMsg);
+		cmdUSBReply(pCmdMsg, true);
+		pStreamData = NULL;
+		nStreamBytes = 0;
+		UsbCmdQueue_Pop();
+	}
+}
+
 /****************************************************************************/
 /* Errors in checksum or message header are handled by this function, Other */
 /* errors are handled by the read/write handler or the individual command   */
@@ -196,18 +442,18 @@ bool cmdIncWriteUSB(int32_t nBytes)
 /* header/checksum and return the complete result to the caller.            */
 /****************************************************************************/
 
-static uint16_t cmdUSBExecute(void)
+static uint16_t cmdUSBExecute(nnoMessageStruct *pMsg)
 {
 	nano_timer_increment_activity_count();	// Register activity so that inactivity monitor knows about it
 
 	switch (pMsg->head.flags.rw)
 	{
 	case REQUEST:
-		cmdUSBWrite(CMD1_WRITE);
+		cmdUSBWrite(pMsg, CMD1_WRITE);
 		break;
 
 	case RESPONSE:
-		cmdUSBRead(CMD1_READ);
+		cmdUSBRead(pMsg, CMD1_READ);
 		break;
 
 	default: /* unknown CMD1 should never occur */
@@ -234,7 +480,7 @@ static uint16_t cmdUSBExecute(void)
 /*                                                                          */
 /****************************************************************************/
 
-static void cmdUSBRead(CMD1_TYPE cmd1)
+static void cmdUSBRead(nnoMessageStruct *pMsg, CMD1_TYPE cmd1)
 {
 	CMD1_TYPE cc; /* response message code */
 	uint32_t key;
@@ -302,7 +548,7 @@ _usb_read_response:
 /* the command processor.                                                   */
 /****************************************************************************/
 
-static void cmdUSBWrite(CMD1_TYPE cmd1)
+static void cmdUSBWrite(nnoMessageStruct *pMsg, CMD1_TYPE cmd1)
 {
 	CMD1_TYPE cc; /* response message code */
 	uint32_t key = ((pMsg->payload.cmd << 8) | cmd1);
@@ -357,7 +603,7 @@ _usb_write_response:
 }
 
 /****************************************************************************/
-/* Spin waiting for msg packets and when complete command msg is recevied, vector to the processing function  */
+/* Spin waiting for msg packets and when complete command msg is recevied, answer or queue it  */
 /****************************************************************************/
 void usbCmdHandlerTask()
 {
@@ -384,7 +630,7 @@ void usbCmdHandlerTask()
 		switch (pktState)
 		{
 		case HEADER:
-			pCmd = (uint8_t *) pMsg;
+			pCmd = (uint8_t *) &Msg;
 			pTempMsg = (nnoMessageStruct *) cmdPacket;
 			expected = pTempMsg->head.length; /* data length expected */
 			bcount = 0; /* Set byte received count */
@@ -409,14 +655,8 @@ void usbCmdHandlerTask()
 			{
 				pktState = HEADER;
 				timeoutVal = BIOS_WAIT_FOREVER;
-				//We now have a full command packet; execute comamnd and send response
-				cmdUSBExecute();
-				if (pMsg->head.flags.reply)
-				{
-					USBDHIDCustomHidResponse(&NirscanNanoDevice,
-							(signed char *) pMsg,
-							(sizeof(pMsg->head) + pMsg->head.length));
-				}
+				//We now have a full command packet; answer it or queue it for the worker
+				cmdUSBDispatch(&Msg);
 			}
 			else
 			{
@@ -0,0 +1,166 @@
+/*
+ *
+ * Queue of USB commands waiting for the command worker task. Status queries
+ * that only copy values already held in memory are answered by the receive
+ * task as soon as they arrive; everything else is copied into a slot and run
+ * by the worker in the order received. Responses carry the seq byte of their
+ * request, so the host matches them up when a query overtakes a slow command.
+ *
+ * A query is kept behind the queued commands if any of them was sent without
+ * asking for a reply: the host cannot tell when such a command has taken
+ * effect and expects the query to see its result.
+ *
+ * Only the receive task submits and only the worker pops.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "usbCmdQueue.h"
+
+/* Handlers that neither block nor use state shared with other handlers */
+static const uint32_t immediateKeys[] =
+{
+	NNO_CMD_SCAN_GET_STATUS,
+	NNO_CMD_SCAN_INTERPRET_GET_STATUS,
+	NNO_CMD_READ_PGA_STATS,
+	NNO_CMD_SD_WRITER_STATS,
+	NNO_CMD_USB_BULK_STATUS,
+	NNO_CMD_USB_CMD_QUEUE_STATS,
+	NNO_CMD_READ_DEVICE_STATUS,
+	NNO_CMD_GET_SPECIFIC_ERR_STATUS,
+	NNO_CMD_GET_SPECIFIC_ERR_CODE
+};
+
+static nnoMessageStruct slots[USB_CMD_QUEUE_DEPTH];
+static bool slotNoReply[USB_CMD_QUEUE_DEPTH];
+static volatile uint32_t queueHead = 0;			// commands submitted
+static volatile uint32_t queueTail = 0;			// commands completed by the worker
+static volatile uint32_t noReplyIn = 0;			// of those submitted, sent without reply
+static volatile uint32_t noReplyOut = 0;		// of those completed, sent without reply
+
+static USB_CMD_QUEUE_STATS stats;
+
+void UsbCmdQueue_Init(void)
+	/**
+	 * Empties the queue and clears the statistics.
+	 *
+	 * @return none
+	 */
+{
+	queueHead = 0;
+	queueTail = 0;
+	noReplyIn = 0;
+	noReplyOut = 0;
+	memset(&stats, 0, sizeof(USB_CMD_QUEUE_STATS));
+}
+
+uint32_t UsbCmdQueue_Key(const nnoMessageStruct *pMsg)
+	/**
+	 * Returns the command dictionary key of a message.
+	 *
+	 * @param pMsg - I - complete command
+	 *
+	 * @return key as looked up by cmdDict_Vector()
+	 */
+{
+	return ((uint32_t)pMsg->payload.cmd << 8) |
+			((pMsg->head.flags.rw == RESPONSE) ? CMD1_READ : CMD1_WRITE);
+}
+
+static bool UsbCmdQueue_IsImmediate(uint32_t key)
+{
+	uint32_t i;
+
+	for(i = 0; i < sizeof(immediateKeys) / sizeof(immediateKeys[0]); i++)
+	{
+		if(immediateKeys[i] == key)
+			return true;
+	}
+	return false;
+}
+
+USB_CMD_DISPOSITION UsbCmdQueue_Submit(const nnoMessageStruct *pMsg)
+	/**
+	 * Decides what to do with a command that has been received in full and
+	 * queues it for the worker if it is not answered straight away.
+	 *
+	 * @param pMsg - I - complete command; copied if queued
+	 *
+	 * @return USB_CMD_RUN_NOW, USB_CMD_QUEUED or USB_CMD_QUEUE_FULL
+	 */
+{
+	uint32_t slot;
+	uint32_t depth = queueHead - queueTail;
+
+	if(UsbCmdQueue_IsImmediate(UsbCmdQueue_Key(pMsg)) && (noReplyIn == noReplyOut))
+	{
+		stats.num_immediate++;
+		return USB_CMD_RUN_NOW;
+	}
+
+	if(depth >= USB_CMD_QUEUE_DEPTH)
+	{
+		stats.num_busy++;
+		return USB_CMD_QUEUE_FULL;
+	}
+
+	slot = queueHead % USB_CMD_QUEUE_DEPTH;
+	memcpy(&slots[slot], pMsg, sizeof(pMsg->head) + pMsg->head.length);
+	slotNoReply[slot] = !pMsg->head.flags.reply;
+	if(slotNoReply[slot])
+		noReplyIn++;
+	queueHead++;
+
+	stats.num_queued++;
+	if(depth + 1 > stats.depth_max)
+		stats.depth_max = depth + 1;
+
+	return USB_CMD_QUEUED;
+}
+
+nnoMessageStruct *UsbCmdQueue_Front(void)
+	/**
+	 * Returns the oldest queued command. It stays in the queue, and the
+	 * response may be built in place, until UsbCmdQueue_Pop().
+	 *
+	 * @return command or NULL if the queue is empty
+	 */
+{
+	if(queueHead == queueTail)
+		return NULL;
+
+	return &slots[queueTail % USB_CMD_QUEUE_DEPTH];
+}
+
+void UsbCmdQueue_Pop(void)
+	/**
+	 * Frees the slot of the oldest command once it has been run and answered.
+	 *
+	 * @return none
+	 */
+{
+	if(queueHead == queueTail)
+		return;
+
+	if(slotNoReply[queueTail % USB_CMD_QUEUE_DEPTH])
+		noReplyOut++;
+	queueTail++;
+}
+
+void UsbCmdQueue_GetStats(USB_CMD_QUEUE_STATS *pStats)
+	/**
+	 * Returns the queue statistics since boot.
+	 *
+	 * @param pStats - O - statistics
+	 *
+	 * @return none
+	 */
+{
+	memcpy(pStats, &stats, sizeof(USB_CMD_QUEUE_STATS));
+	pStats->depth = queueHead - queueTail;
+}
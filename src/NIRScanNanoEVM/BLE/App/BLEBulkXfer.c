@@ -0,0 +1,167 @@
+/*
+ * BLE bulk transfer
+ *
+ * Splits a block of data into notifications of the negotiated packet size
+ * and hands them to the stack until its GATT queue is full. A packet the
+ * stack refuses is kept and offered again once the connection reports its
+ * buffer empty, so the controller has a window of packets to send at every
+ * connection event rather than one.
+ *
+ * Copyright (C) 2014-15 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "BTErrors.h"
+#include "BLEBulkXfer.h"
+
+void bleBulkXfer_start(BLE_BULK_XFER *pXfer, const uint8_t *pData, uint32_t length, uint16_t pktSize, bool indexed)
+/**
+ * Sets up a transfer. The data is read in place and must not change until
+ * the transfer is done.
+ *
+ * @param[out]  pXfer		Transfer state
+ * @param[in]	pData		Payload
+ * @param[in]	length		Payload bytes; nothing is sent if zero
+ * @param[in]	pktSize		Largest notification the connection takes
+ * @param[in]	indexed		Send packet 0 and a sequence number in each packet
+ *
+ * @return      None
+ *
+ */
+{
+	memset(pXfer, 0, sizeof(BLE_BULK_XFER));
+	pXfer->pData = pData;
+	pXfer->length = length;
+	pXfer->pktSize = pktSize;
+	pXfer->indexed = indexed;
+}
+
+bool bleBulkXfer_isDone(const BLE_BULK_XFER *pXfer)
+/**
+ * @return      true once the stack has accepted every packet of the transfer
+ */
+{
+	if (pXfer->length == 0)
+		return true;
+
+	return ((pXfer->pos == pXfer->length) && (!pXfer->indexed || (pXfer->seq > 0)));
+}
+
+uint16_t bleBulkXfer_buildPacket(const BLE_BULK_XFER *pXfer, uint8_t *pPkt)
+/**
+ * Builds the next packet of the transfer. The transfer does not move on
+ * until bleBulkXfer_packetSent() is called, so a refused packet is built
+ * again the same way.
+ *
+ * @param[in]   pXfer		Transfer state
+ * @param[out]	pPkt		Packet, at least pktSize bytes
+ *
+ * @return      Packet bytes, 0 if the transfer is done
+ *
+ */
+{
+	uint32_t payload;
+
+	if (bleBulkXfer_isDone(pXfer))
+		return 0;
+
+	if (!pXfer->indexed)
+	{
+		payload = pXfer->length - pXfer->pos;
+		if (payload > pXfer->pktSize)
+			payload = pXfer->pktSize;
+		memcpy(pPkt, &pXfer->pData[pXfer->pos], payload);
+		return (uint16_t)payload;
+	}
+
+	pPkt[0] = pXfer->seq & 0xFF;
+	pPkt[1] = (pXfer->seq >> 8) & 0xFF;
+
+	if (pXfer->seq == 0)
+	{
+		pPkt[2] = pXfer->length & 0xFF;
+		pPkt[3] = (pXfer->length >> 8) & 0xFF;
+		pPkt[4] = (pXfer->length >> 16) & 0xFF;
+		pPkt[5] = (pXfer->length >> 24) & 0xFF;
+		return BLE_BULK_XFER_SIZE_PKT_LEN;
+	}
+
+	payload = pXfer->length - pXfer->pos;
+	if (payload > (uint32_t)(pXfer->pktSize - BLE_BULK_XFER_SEQ_SIZE))
+		payload = pXfer->pktSize - BLE_BULK_XFER_SEQ_SIZE;
+	memcpy(&pPkt[BLE_BULK_XFER_SEQ_SIZE], &pXfer->pData[pXfer->pos], payload);
+	return (uint16_t)(payload + BLE_BULK_XFER_SEQ_SIZE);
+}
+
+void bleBulkXfer_packetSent(BLE_BULK_XFER *pXfer)
+/**
+ * Moves the transfer past the packet last built, once the stack has
+ * accepted it.
+ *
+ * @param[in,out]   pXfer	Transfer state
+ *
+ * @return      None
+ *
+ */
+{
+	uint32_t payload;
+	uint16_t maxPayload = pXfer->pktSize;
+
+	if (bleBulkXfer_isDone(pXfer))
+		return;
+
+	if (pXfer->indexed)
+	{
+		maxPayload -= BLE_BULK_XFER_SEQ_SIZE;
+		if (pXfer->seq++ == 0)
+		{
+			pXfer->numPackets++;
+			return;
+		}
+	}
+
+	payload = pXfer->length - pXfer->pos;
+	if (payload > maxPayload)
+		payload = maxPayload;
+	pXfer->pos += payload;
+	pXfer->numPackets++;
+}
+
+BLE_Bulk_Xfer_Status_t bleBulkXfer_pump(BLE_BULK_XFER *pXfer, uint8_t *pPkt, BLE_BULK_SEND_FUNC pSend, void *pCtx)
+/**
+ * Hands packets to the stack until the transfer is done or the GATT queue
+ * of the connection is full. Called when the transfer starts and again
+ * each time the connection reports its buffer empty.
+ *
+ * @param[in,out]   pXfer	Transfer state
+ * @param[out]	pPkt		Scratch buffer for the packet, at least pktSize bytes
+ * @param[in]	pSend		Function that queues a notification with the stack
+ * @param[in]	pCtx		Passed on to pSend
+ *
+ * @return      DONE, WAIT for the buffer empty event or ERROR
+ *
+ */
+{
+	uint16_t length;
+	int ret_val;
+
+	while ((length = bleBulkXfer_buildPacket(pXfer, pPkt)) > 0)
+	{
+		ret_val = pSend(pCtx, length, pPkt);
+		if (ret_val == BTPS_ERROR_INSUFFICIENT_BUFFER_SPACE)
+		{
+			pXfer->numStalls++;
+			return BLE_BULK_XFER_WAIT;
+		}
+		if (ret_val < 0)
+			return BLE_BULK_XFER_ERROR;
+
+		bleBulkXfer_packetSent(pXfer);
+	}
+
+	return BLE_BULK_XFER_DONE;
+}
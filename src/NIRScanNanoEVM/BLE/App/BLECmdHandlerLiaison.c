@@ -22,6 +22,8 @@
 #include "BLECmdHandlerLiaison.h"
 #include "led.h"
 #include "BLEUtils.h"
+#include "BLENotificationHandler.h"
+#include "BLEBulkXfer.h"
 
 #include "scan.h"
 #include "nano_eeprom.h"
@@ -41,14 +43,14 @@
 #define MAX_BUFFER_SIZE						512
 
 /**
- * @brief Size of standard notifcation sent from server
+ * @brief Max File Type
  */
-#define STANDARD_NOTIFICATION_SIZE			5
+#define BLE_DUMMY_COMMAND_ID	0xFFFFFF
 
 /**
- * @brief Max File Type
+ * @brief Max number of responses pending at a time
  */
-#define BLE_DUMMY_COMMAND_ID	0xFFFFFF
+#define BLE_RESPONSE_LIST_SIZE				8
 
 /*************** Globals used across TIVA App ****************************/
 /**
@@ -112,6 +114,19 @@ const uint32_t phasedBLECommandIDs[BLE_MAX_COMMANDS][4]	=
  */
 BLE_RESPONSE_INFO_LIST_NODE	*blePendingResponseList;		//FIFO list of reponses that are pending
 
+/**
+ * @brief Static storage for the pending response list
+ */
+static BLE_RESPONSE_INFO_LIST_NODE responseNodes[BLE_RESPONSE_LIST_SIZE];
+static BLE_POOL responsePool;
+static bool responsePoolReady = false;
+
+/**
+ * @brief Last node of the pending response list and the node of each file type
+ */
+static BLE_RESPONSE_INFO_LIST_NODE *blePendingResponseTail;
+static BLE_RESPONSE_INFO_LIST_NODE *responseNodeByFileType[BLE_MAX_COMMANDS];
+
 /**
  * @brief Temporary buffer for storing a BLE packet data
  */
@@ -138,6 +153,7 @@ const BLE_CMD_DICT_ENTRY bleDictArray[] =
     { CMD_KEY(0xFF, 0x0C, 0x04,	0x00), cmdPrintCalCoeffs_rd		},
     { CMD_KEY(0xFF, 0x0D, 0x02, 0x00), cmdSetSerialNumber_wr  	},
 	{ CMD_KEY(0xFF, 0x0E, 0x02, 0x00), cmdSetDevErrStat_wr		},
+	{ CMD_KEY(0xFF, 0x0F, 0x04, 0x00), cmdPrintPoolStats_rd		},
 };
 
 /**
@@ -148,13 +164,13 @@ const size_t bleDictSize = sizeof( bleDictArray ) / sizeof( BLE_CMD_DICT_ENTRY )
 /*********************** Local functions ***************************************/
 int bleCmdHandlerLiason_saveInfoForResponse(BLE_RESPONSE_INFO info);
 int addNodeToResponseList(BLE_RESPONSE_INFO_LIST_NODE node);
-void clearReponseListNode(BLE_RESPONSE_INFO_LIST_NODE *node);
+void clearReponseList(void);
 
 BLE_RESPONSE_INFO_LIST_NODE *getFirstMatchfromResponseList(bool isCallerBLE, unsigned char fileType, unsigned char subFileType, unsigned int connectionID);
 
 int addNodeToResponseList(BLE_RESPONSE_INFO_LIST_NODE node)
 /**
- * Add node to response list
+ * Add node to response list. Only one response per file type can be pending.
  *
  * @param[in]   node	Node to be added
  *
@@ -162,65 +178,34 @@ int addNodeToResponseList(BLE_RESPONSE_INFO_LIST_NODE node)
  *
  */
 {
-	int ret_val = 0;
-	BLE_RESPONSE_INFO_LIST_NODE *lastNd;
-	int cnt = 0;
+	BLE_RESPONSE_INFO_LIST_NODE *newNd;
 
-	if (blePendingResponseList == NULL)
+	if (node.Info.fileType >= BLE_MAX_COMMANDS)
+		return (FAIL);
+
+	if (responseNodeByFileType[node.Info.fileType] != NULL)
 	{
-		DEBUG_PRINT("\r\nResponse List was empty\r\n");
-		blePendingResponseList = (BLE_RESPONSE_INFO_LIST_NODE *)bleMalloc(sizeof(BLE_RESPONSE_INFO_LIST_NODE));
-		if (blePendingResponseList != NULL)
-		{
-			memcpy(blePendingResponseList, &node, sizeof(BLE_RESPONSE_INFO_LIST_NODE));
-			blePendingResponseList->next = NULL;
-			cnt++;
-		}
-		else
-		{
-			ret_val = FAIL;
-		}
+		DEBUG_PRINT("\r\nResponse for file type %d already pending\r\n", node.Info.fileType);
+		return (FAIL);
 	}
-	else
-	{
-		DEBUG_PRINT("\r\nResponse List was not empty\r\n");
-		Boolean_t nodeExists = false;
-		lastNd = blePendingResponseList;
 
-		while (lastNd->next != NULL) //find last node
-		{
-			if ((lastNd->Info.fileType != node.Info.fileType) &&
-				(lastNd->Info.cmdType != node.Info.cmdType))
-				lastNd = lastNd->next;
-			else
-			{
-				nodeExists = true;
-				break;
-			}
-			cnt++;
-		}
+	newNd = (BLE_RESPONSE_INFO_LIST_NODE *)blePoolAlloc(&responsePool);
+	if (newNd == NULL)
+		return (FAIL);
 
-		if (!nodeExists)
-		{
-			lastNd->next = (BLE_RESPONSE_INFO_LIST_NODE *)bleMalloc(sizeof(BLE_RESPONSE_INFO_LIST_NODE));
-			if (lastNd->next != NULL)
-			{
-				memcpy(lastNd->next, &node, sizeof(BLE_RESPONSE_INFO_LIST_NODE));
-				lastNd->next->next = NULL;
-				cnt++;
-			}
-			else
-			{
-				ret_val = FAIL;
-			}
-		}
-		else
-			ret_val = FAIL;
-	}
+	memcpy(newNd, &node, sizeof(BLE_RESPONSE_INFO_LIST_NODE));
+	newNd->next = NULL;
+	newNd->prev = blePendingResponseTail;
+	if (blePendingResponseTail == NULL)
+		blePendingResponseList = newNd;
+	else
+		blePendingResponseTail->next = newNd;
+	blePendingResponseTail = newNd;
+	responseNodeByFileType[node.Info.fileType] = newNd;
 
-	DEBUG_PRINT("\r\nTotal number of nodes after adding to list: %d\r\n", cnt);
+	DEBUG_PRINT("\r\nTotal number of nodes after adding to list: %d\r\n", responsePool.stats.in_use);
 
-	return(ret_val);
+	return (0);
 }
 
 BLE_RESPONSE_INFO_LIST_NODE *getFirstMatchfromResponseList(bool isCallerBLE, unsigned char fileType, unsigned char subFileType, unsigned int connectionID)
@@ -236,31 +221,30 @@ BLE_RESPONSE_INFO_LIST_NODE *getFirstMatchfromResponseList(bool isCallerBLE, uns
  *
  */
 {
-	BLE_RESPONSE_INFO_LIST_NODE *temp = blePendingResponseList;
-	while (temp != NULL)
+	BLE_RESPONSE_INFO_LIST_NODE *temp;
+
+	if (isCallerBLE)
 	{
-		if (isCallerBLE)
-		{
-			if (temp->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_FOR_PREV_PACKET_RESPONSE)
-				break;
-			else
-				temp = temp->next;
-		}
-		else
-		{
-			if (((temp->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_FOR_SIZE) ||
-			     (temp->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_FOR_DATA) ||
-				 (temp->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_TO_SEND_NOTIFICATION)) &&
-			    (temp->Info.fileType == fileType) &&
-			   ((subFileType == 0) || ((subFileType != 0) &&
-			    (temp->Info.subfieldType == subFileType))))
-				break;
-			else
-				temp = temp->next;
-		}
+		// At most BLE_RESPONSE_LIST_SIZE nodes to look at
+		temp = blePendingResponseList;
+		while ((temp != NULL) && (temp->Info.cmdStatus != BLE_COMMAND_STATUS_WAIT_FOR_PREV_PACKET_RESPONSE))
+			temp = temp->next;
+
+		return (temp);
 	}
 
-	return (temp);
+	if (fileType >= BLE_MAX_COMMANDS)
+		return (NULL);
+
+	temp = responseNodeByFileType[fileType];
+	if ((temp != NULL) &&
+		((temp->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_FOR_SIZE) ||
+		 (temp->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_FOR_DATA) ||
+		 (temp->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_TO_SEND_NOTIFICATION)) &&
+		((subFileType == 0) || (temp->Info.subfieldType == subFileType)))
+		return (temp);
+
+	return (NULL);
 }
 
 int deleteNodefromResponseList(BLE_RESPONSE_INFO_LIST_NODE *node)
@@ -273,49 +257,26 @@ int deleteNodefromResponseList(BLE_RESPONSE_INFO_LIST_NODE *node)
  *
  */
 {
-	int ret_val = 0;
-	int cnt = 0;
-
-	BLE_RESPONSE_INFO_LIST_NODE *currNode = blePendingResponseList;
-	BLE_RESPONSE_INFO_LIST_NODE *prevNode = NULL;
-
-	Boolean_t nodeFound = false;
-
-	while(!nodeFound)
-	{
-		if (currNode == NULL)
-		{
-			ret_val = FAIL;
-			break;
-		}
-		else if (currNode == node)
-		{
-			nodeFound = true;
+	if ((node == NULL) || (node->Info.fileType >= BLE_MAX_COMMANDS) ||
+		(responseNodeByFileType[node->Info.fileType] != node))
+		return (FAIL);
 
-			if (prevNode == NULL)	//first node
-				blePendingResponseList = currNode->next;
-			else
-				prevNode->next = currNode->next;
+	if (node->prev == NULL)	//first node
+		blePendingResponseList = node->next;
+	else
+		node->prev->next = node->next;
 
-			bleFree(currNode, sizeof(BLE_RESPONSE_INFO_LIST_NODE));
-		}
-		else
-		{
-			prevNode = currNode;
-			currNode = currNode->next;
-		}
-	}
+	if (node->next == NULL)	//last node
+		blePendingResponseTail = node->prev;
+	else
+		node->next->prev = node->prev;
 
-	currNode = blePendingResponseList;
-	while (currNode != NULL)
-	{
-		cnt++;
-		currNode = currNode->next;
-	}
+	responseNodeByFileType[node->Info.fileType] = NULL;
+	blePoolFree(&responsePool, node);
 
-	DEBUG_PRINT("\r\nNo of nodes after removing node from list:%d\r\n", cnt);
+	DEBUG_PRINT("\r\nNo of nodes after removing node from list:%d\r\n", responsePool.stats.in_use);
 
-	return (ret_val);
+	return (0);
 }
 
 int bleCmdHandlerLiason_saveInfoForResponse(BLE_RESPONSE_INFO respInfo)
@@ -363,8 +324,8 @@ int bleCmdHandlerLiason_relayCmd(Byte_t *pData, int length, BLE_RESPONSE_INFO re
 		responseInfo.cmd[i] = pData[i];
 	responseInfo.cmdLen = length;
 
-	responseInfo.remLength = 0;
 	responseInfo.totalLength = 0;
+	memset(&responseInfo.xfer, 0, sizeof(BLE_BULK_XFER));
 
 	// Push the data to pending command handler if type warrants the same
 	if ((responseInfo.cmdType == BLE_COMMAND_TYPE_WRITE_NOTIFY) || (responseInfo.cmdType == BLE_COMMAND_TYPE_WRITE_INDICATE))
@@ -438,6 +399,65 @@ int bleCmdHandlerLiason_relayCmd(Byte_t *pData, int length, BLE_RESPONSE_INFO re
 
 }
 
+static int bleCmdHandlerLiason_sendPacket(void *pCtx, uint16_t length, uint8_t *pPkt)
+/**
+ * Queues one packet of a response as a notification to the client
+ *
+ * @param[in]   pCtx		BT_INFO of the response
+ * @param[in]	length		Packet length
+ * @param[in]	pPkt		Packet data
+ *
+ * @return      Success=0, Failure <0
+ *
+ */
+{
+	BT_INFO *btInfo = (BT_INFO *)pCtx;
+
+	return (BLEUtil_SendNotification(btInfo->bluetoothID,
+									 btInfo->serviceID,
+									 btInfo->connectionID,
+									 btInfo->ccdOffset,
+									 length,
+									 pPkt));
+}
+
+static int bleCmdHandlerLiason_sendResponseData(BLE_RESPONSE_INFO_LIST_NODE *node)
+/**
+ * Sends as many packets of a response as the GATT queue takes. If the queue
+ * fills up the rest are sent when the stack reports the connection's buffer
+ * empty; otherwise the response is complete and its node is deleted.
+ *
+ * @param[in]   node	Node of the response being sent
+ *
+ * @return      Success=0, Failure <0
+ *
+ */
+{
+	int ret_val = 0;
+	BLE_Bulk_Xfer_Status_t status;
+
+	status = bleBulkXfer_pump(&node->Info.xfer, &packetData[0], bleCmdHandlerLiason_sendPacket, &node->Info.btInfo);
+
+	if (status == BLE_BULK_XFER_WAIT)
+	{
+		node->Info.cmdStatus = BLE_COMMAND_STATUS_WAIT_FOR_PREV_PACKET_RESPONSE;
+		return (0);
+	}
+
+	if (status == BLE_BULK_XFER_ERROR)
+	{
+		DEBUG_PRINT("\r\nBLE notification failed at packet %d, transfer dropped\r\n", node->Info.xfer.seq);
+		ret_val = FAIL;
+	}
+
+	DEBUG_PRINT("\r\nResponse sent: %d packets, %d stalls\r\n", node->Info.xfer.numPackets, node->Info.xfer.numStalls);
+
+	deleteNodefromResponseList(node);
+	gBLECmdHandlerRepsonse.output_data_len = 0;
+
+	return (ret_val);
+}
+
 int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connectionID)
 /**
  * Function that handles BLE command handler response
@@ -452,8 +472,6 @@ int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connec
 	int ret_val = 0;
 	int i = 0;
 	BLE_RESPONSE_INFO_LIST_NODE *node = NULL;
-	unsigned int pos = 0;
-	uint32_t tempLen = 0;
 
 	// First check if any reponse if pending
 	if (blePendingResponseList == NULL)
@@ -482,7 +500,6 @@ int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connec
 										 (*(gBLECmdHandlerRepsonse.output + 1) << 8) |
 										 (*(gBLECmdHandlerRepsonse.output + 2) << 16) |
 										 (*(gBLECmdHandlerRepsonse.output + 3) << 24);
-				node->Info.remLength = node->Info.totalLength;
 
 				DEBUG_PRINT("\r\nSize returned=%d\r\n", node->Info.totalLength);
 
@@ -503,103 +520,15 @@ int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connec
 		}
 		else if (node->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_FOR_DATA)
 		{
-			pos = 0;
-
 			DEBUG_PRINT("\r\nResponse Handler: Data returned, size=%d\r\n",gBLECmdHandlerRepsonse.output_data_len);
 
-			node->Info.currentPktIdx = 0;
-			node->Info.data = gBLECmdHandlerRepsonse.output;
-			node->Info.remLength = gBLECmdHandlerRepsonse.output_data_len;
-
-			DEBUG_PRINT("\r\nResponse Handler: data length to be sent=%d\r\n",node->Info.remLength);
-
 			if ((node->Info.cmdType == BLE_COMMAND_TYPE_WRITE_NOTIFY) || (node->Info.cmdType == BLE_COMMAND_TYPE_WRITE_INDICATE))
 			{
-				if (node->Info.dataType == 1)
-				{
-					packetData[0] =  0;
-					if (node->Info.totalLength > 0)
-						tempLen = node->Info.totalLength;
-					else
-						tempLen = node->Info.remLength;
-
-					if (tempLen > 0)
-					{
-						packetData[1] = (0xff & tempLen);
-						packetData[2] = (0xff00 & tempLen) >> 8;
-						packetData[3] = (0xff0000 & tempLen) >> 16;
-						packetData[4] = (0xff000000 & tempLen) >> 24;
-
-						ret_val = BLEUtil_SendNotification(node->Info.btInfo.bluetoothID,
-														node->Info.btInfo.serviceID,
-														node->Info.btInfo.connectionID,
-														node->Info.btInfo.ccdOffset,
-														STANDARD_NOTIFICATION_SIZE,
-														&packetData[0]);
-
-						if (ret_val < 0)
-							DEBUG_PRINT("\r\nData size packet: BLE notification failed, ret_val:%d\r\n",ret_val);
-					}
-				}
-
-				while (node->Info.remLength > 0)
-				{
-					int length = 0;
-					for(i=0;i<gBLESuppMTUSize;i++)
-						packetData[i] = 0;
-
-					if (node->Info.dataType == 1)
-					{
-						length = (node->Info.remLength > (gBLESuppMTUSize - 1)) ? (gBLESuppMTUSize - 1) : node->Info.remLength;
-						packetData[0] =  (0xff & (node->Info.currentPktIdx+1));
-						memcpy(&packetData[1],&gBLECmdHandlerRepsonse.output[pos],length);
-						length++;
-					}
-					else
-					{
-						length = (node->Info.remLength > gBLESuppMTUSize) ? gBLESuppMTUSize : node->Info.remLength;
-						memcpy(&packetData[0],&gBLECmdHandlerRepsonse.output[pos],length);
-					}
-
-					ret_val = BLEUtil_SendNotification(node->Info.btInfo.bluetoothID,
-													node->Info.btInfo.serviceID,
-													node->Info.btInfo.connectionID,
-													node->Info.btInfo.ccdOffset,
-													length,
-													&packetData[0]);
-					if (ret_val == 0)
-					{
-						if (node->Info.dataType == 1)
-						{
-							node->Info.remLength -= (length-1);
-							pos += (length - 1);
-						}
-						else
-						{
-							node->Info.remLength -= length;
-							pos += length;
-						}
-						node->Info.currentPktIdx++;
-
-						DEBUG_PRINT("\r\n#%d Packet sent, remaining data:%d , pos:%d\r\n", node->Info.currentPktIdx, node->Info.remLength, pos);
+				bleBulkXfer_start(&node->Info.xfer, gBLECmdHandlerRepsonse.output,
+								  gBLECmdHandlerRepsonse.output_data_len, gBLESuppMTUSize,
+								  (node->Info.dataType == 1));
 
-					}
-					else
-					{
-						if (node->Info.remLength > 0)
-							node->Info.cmdStatus = BLE_COMMAND_STATUS_WAIT_FOR_PREV_PACKET_RESPONSE;
-
-						DEBUG_PRINT("\r\nData packet ID %d: BLE notification failed, ret_val:%d\r\n", node->Info.currentPktIdx, ret_val);
-						break;
-					}
-				}
-
-				// For write-notify type, delete the node since the data has been sent completely already
-				if ((node->Info.remLength == 0) && (node->Info.cmdType == BLE_COMMAND_TYPE_WRITE_NOTIFY))
-				{
-					deleteNodefromResponseList(node);
-					gBLECmdHandlerRepsonse.output_data_len = 0;
-				}
+				ret_val = bleCmdHandlerLiason_sendResponseData(node);
 			}
 			else if (node->Info.cmdType == BLE_COMMAND_TYPE_READ_DELAY_RESPONSE)
 			{
@@ -623,16 +552,6 @@ int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connec
 												 &packetData[0]);
 
 				if (ret_val == 0)
-					node->Info.remLength = 0;
-				else
-					DEBUG_PRINT("\r\nBLE send read response failed, ret_val:%d\r\n", ret_val);
-			}
-
-			if (ret_val == 0)
-			{
-				if (node->Info.remLength > 0)
-					node->Info.cmdStatus = BLE_COMMAND_STATUS_WAIT_FOR_PREV_PACKET_RESPONSE;
-				else
 				{
 					if (0 > deleteNodefromResponseList(node))
 					{
@@ -640,6 +559,8 @@ int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connec
 						ret_val = FAIL;
 					}
 				}
+				else
+					DEBUG_PRINT("\r\nBLE send read response failed, ret_val:%d\r\n", ret_val);
 			}
 			DEBUG_PRINT("\r\nForwarded data to BLE\r\n");
 		}
@@ -671,44 +592,9 @@ int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connec
 	}
 	else if (node->Info.cmdStatus == BLE_COMMAND_STATUS_WAIT_FOR_PREV_PACKET_RESPONSE)	// prompt from BLE
 	{
-		//short remdataLen = node->Info.remLength;
-		unsigned pos = 0;
-		pos = node->Info.totalLength - node->Info.remLength;
-		//packetData = NULL;
-
-		DEBUG_PRINT("\r\nSubsequent iteration to send data, Data length remaining:%d\r\n", node->Info.remLength);
-
-		while (node->Info.remLength > 0)
-		{
-			int length = (node->Info.remLength > (gBLESuppMTUSize - 1)) ? (gBLESuppMTUSize - 1) : node->Info.remLength;
-
-			for (i = 0; i < gBLESuppMTUSize; i++)
-				packetData[i] = 0;
+		DEBUG_PRINT("\r\nSubsequent iteration to send data, packet:%d\r\n", node->Info.xfer.seq);
 
-			packetData[0] = (0xff & (node->Info.currentPktIdx + 1));
-			memcpy(&packetData[1], &gBLECmdHandlerRepsonse.output[pos], length);
-				ret_val = BLEUtil_SendNotification(node->Info.btInfo.bluetoothID, node->Info.btInfo.serviceID, node->Info.btInfo.connectionID, node->Info.btInfo.ccdOffset, length + 1, &packetData[0]);
-			if (ret_val == 0)
-			{
-				node->Info.remLength -= (gBLESuppMTUSize - 1);
-				pos += (gBLESuppMTUSize - 1);
-				node->Info.currentPktIdx++;
-				DEBUG_PRINT("\r\n#%d Packet sent, remaining data:%d , pos:%d\r\n", node->Info.currentPktIdx, node->Info.remLength, pos);
-				//for (i=0;i<gBLESuppMTUSize;i++)
-				//	DEBUG_PRINT("Data at index %d:%d\r\n", i, packetData[i]);
-
-			}
-			else
-			{
-				DEBUG_PRINT("\r\nBLE Send notification failed for packet %d, ret_val:%d\r\n", node->Info.currentPktIdx, ret_val);
-				break;
-			}
-		}
-
-		if (node->Info.remLength > 0)
-				node->Info.cmdStatus = BLE_COMMAND_STATUS_WAIT_FOR_PREV_PACKET_RESPONSE;
-		else
-			deleteNodefromResponseList(node);
+		ret_val = bleCmdHandlerLiason_sendResponseData(node);
 
 		DEBUG_PRINT("\r\nForwarded subsequent packets to BLE\r\n");
 	}
@@ -775,29 +661,44 @@ void InitBLECmdHandlerLiason()
  *
  */
 {
-	blePendingResponseList = NULL;
+	clearReponseList();
 	currentState = BLE_CMD_HANDLER_LIAISON_STATE_IDLE;
 
 	return;
 }
 
-void clearReponseListNode(BLE_RESPONSE_INFO_LIST_NODE *node)
+void clearReponseList(void)
 /**
- * Function to delete response list node
- *
- * @param[in]   node	Pointer to node to be deleted
+ * Function to empty the response list, returning all nodes to the pool
  *
  * @return      None
  *
  */
 {
-	if (node == NULL)
-		return;
+	if (!responsePoolReady)
+	{
+		blePoolInit(&responsePool, responseNodes, sizeof(BLE_RESPONSE_INFO_LIST_NODE), BLE_RESPONSE_LIST_SIZE);
+		responsePoolReady = true;
+	}
+	else
+		blePoolReset(&responsePool);
 
-	if (node->next != NULL)
-		clearReponseListNode(node->next);
+	blePendingResponseList = NULL;
+	blePendingResponseTail = NULL;
+	memset(responseNodeByFileType, 0, sizeof(responseNodeByFileType));
+}
 
-	bleFree(node, sizeof(BLE_RESPONSE_INFO_LIST_NODE));
+void bleCmdHandlerLiason_getPoolStats(BLE_POOL_STATS *pStats)
+/**
+ * Returns the allocation statistics of the pending response list
+ *
+ * @param[out]  pStats	Statistics
+ *
+ * @return      None
+ *
+ */
+{
+	blePoolGetStats(&responsePool, pStats);
 }
 
 void DeInitBLECmdHandlerLiason()
@@ -808,8 +709,7 @@ void DeInitBLECmdHandlerLiason()
  *
  */
 {
-	clearReponseListNode(blePendingResponseList);
-	blePendingResponseList = NULL;
+	clearReponseList();
 	currentState = BLE_CMD_HANDLER_LIAISON_STATE_IDLE;
 
 	return;
@@ -958,4 +858,29 @@ bool cmdSetDevErrStat_wr(uint8_t len, uint8_t *pData)
 		return false;
 
 }
+bool cmdPrintPoolStats_rd(uint8_t len, uint8_t *pData)
+/**
+ * Print allocation statistics of the response and notification lists
+ *
+ * @param[in]   len		Length of data
+ * @param[in]	pData	Pointer to data
+ *
+ * @return      Success=TRUE, Failure =FALSE
+ *
+ */
+{
+	BLE_POOL_STATS stats;
+
+	bleCmdHandlerLiason_getPoolStats(&stats);
+	bleLog("\r\nResponse list: %d/%d in use, max %d, allocs %d, frees %d, failed %d, bad frees %d\r\n",
+			stats.in_use, stats.capacity, stats.in_use_max, stats.num_alloc, stats.num_free, stats.num_fail,
+			stats.num_bad_free);
+
+	bleNotificationHandler_getPoolStats(&stats);
+	bleLog("\r\nNotify list: %d/%d in use, max %d, allocs %d, frees %d, failed %d, bad frees %d\r\n",
+			stats.in_use, stats.capacity, stats.in_use_max, stats.num_alloc, stats.num_free, stats.num_fail,
+			stats.num_bad_free);
+
+	return true;
+}
 #endif
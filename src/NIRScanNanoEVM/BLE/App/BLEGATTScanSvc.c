@@ -24,6 +24,7 @@
 #include "BLECmdHandlerLiaison.h"
 #include "BLENotificationHandler.h"
 #include "BLEGATTScanSvc.h"
+#include "scanStream.h"
 
 extern unsigned short gBLESuppMTUSize;
 
@@ -52,6 +53,7 @@ void GATTScanSvc_InitApplicationStateInfo()
 	ApplicationStateInfo_ScanSvc.scanTime_CCD = 0;
 	ApplicationStateInfo_ScanSvc.scanBlobVer_CCD = 0;
 	ApplicationStateInfo_ScanSvc.scanData_CCD = 0;
+	ApplicationStateInfo_ScanSvc.scanStream_CCD = 0;
 
 	ApplicationStateInfo_ScanSvc.numScans = 0;
 }
@@ -291,6 +293,14 @@ void BTPSAPI GATTScanSvc_ServerEventCallback(unsigned int BluetoothStackID, GATT
 												   WORD_SIZE,
 												   &TempWord[0]);
 								break;
+							case BLE_SCANSVC_SCAN_STREAM_CCD_ATTRIBUTE_OFFSET:
+								DEBUG_PRINT("\r\nValue of Data CCD:%d\r\n", ApplicationStateInfo_ScanSvc.scanStream_CCD);
+								ASSIGN_HOST_WORD_TO_LITTLE_ENDIAN_UNALIGNED_WORD(&TempWord, ApplicationStateInfo_ScanSvc.scanStream_CCD);
+								GATT_Read_Response(BluetoothStackID,
+												   GATT_ServerEventData->Event_Data.GATT_Read_Request_Data->TransactionID,
+												   WORD_SIZE,
+												   &TempWord[0]);
+								break;
 						}
 					}
 					else
@@ -501,6 +511,39 @@ void BTPSAPI GATTScanSvc_ServerEventCallback(unsigned int BluetoothStackID, GATT
 										ApplicationStateInfo_ScanSvc.scanData_CCD = 0;
 								}
 								break;
+							case BLE_SCANSVC_SCAN_STREAM_CCD_ATTRIBUTE_OFFSET:
+								if (GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValueLength != WORD_SIZE)
+									bleGATTErrorResponse(BluetoothStackID, GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->TransactionID, GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeOffset, ATT_PROTOCOL_ERROR_CODE_INVALID_ATTRIBUTE_VALUE_LENGTH);
+
+								if (!BLEUtil_DecodeCharConfigDesc(WORD_SIZE, GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValue, &Notify))
+								{
+									/* Go ahead and accept the write request since we have decoded CCD Value successfully.      */
+									GATT_Write_Response(BluetoothStackID, GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->TransactionID);
+									/* Update the stored configuration for this device. While
+									 * this is on, scans stream and the BLE task drains it */
+									if (Notify)
+									{
+										ApplicationStateInfo_ScanSvc.scanStream_CCD |= GATT_CLIENT_CONFIGURATION_CHARACTERISTIC_NOTIFY_ENABLE;
+										ScanStream_Enable(true);
+										notifyInfo.btInfo.bluetoothID = BluetoothStackID;
+										notifyInfo.btInfo.serviceID = GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->ServiceID;
+										notifyInfo.btInfo.connectionID = GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->ConnectionID;
+										notifyInfo.btInfo.ccdOffset = BLE_SCANSVC_SCAN_STREAM_CCD_ATTRIBUTE_VALUE_OFFSET;
+										notifyInfo.type = BLE_NOTIFY_SCAN_STREAM;
+
+										if (0 != bleNotificationHandler_registerNotification(notifyInfo))
+											DEBUG_PRINT("Notification registration failed, %d",NNO_BLE_NOTIFICATION_PROCESSING_FAILED);
+									}
+									else
+									{
+										ApplicationStateInfo_ScanSvc.scanStream_CCD = 0;
+										ScanStream_Enable(false);
+
+										if (0 != bleNotificationHandler_deregisterNotification(BLE_NOTIFY_SCAN_STREAM))
+											DEBUG_PRINT("Notification registration failed, %d",NNO_BLE_NOTIFICATION_PROCESSING_FAILED);
+									}
+								}
+								break;
 							case BLE_SCANSVC_READ_SCAN_LIST_CHARACTERISTIC_ATTRIBUTE_OFFSET:
 								writeVal[0] = NNO_FILE_SCAN_LIST;
 								writeVal[1] = BLE_LIST_RETURN_TYPE_BYTE;
@@ -597,13 +640,23 @@ void BTPSAPI GATTScanSvc_ServerEventCallback(unsigned int BluetoothStackID, GATT
 								bleCmdHandlerLiason_relayCmd(&writeVal[0],length,bleEventInfo);
 								break;
 							case BLE_SCANSVC_READ_SCAN_DATA_CHARACTERISTIC_ATTRIBUTE_OFFSET:
-								if (GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValueLength != DWORD_SIZE)
+								/* Scan index, optionally followed by BLE_SCAN_DATA_FIELD_SPECTRUM
+								 * to read the packed interpreted spectrum instead of the blob */
+								if ((GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValueLength != DWORD_SIZE) &&
+									((GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValueLength != DWORD_SIZE + 1) ||
+									 (GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValue[DWORD_SIZE] != BLE_SCAN_DATA_FIELD_SPECTRUM)))
+								{
 									bleGATTErrorResponse(BluetoothStackID, GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->TransactionID, GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeOffset, ATT_PROTOCOL_ERROR_CODE_INVALID_ATTRIBUTE_VALUE_LENGTH);
+									break;
+								}
 
 								TempDWord = READ_UNALIGNED_DWORD_LITTLE_ENDIAN(GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValue);
 								writeVal[0] = NNO_FILE_SCAN_DATA;
 								memcpy(&writeVal[1],&TempDWord,DWORD_SIZE);
-								writeVal[5] = (0xff & BLE_SCAN_DATA_FIELD_BLOB);
+								if (GATT_ServerEventData->Event_Data.GATT_Write_Request_Data->AttributeValueLength > DWORD_SIZE)
+									writeVal[5] = (0xff & BLE_SCAN_DATA_FIELD_SPECTRUM);
+								else
+									writeVal[5] = (0xff & BLE_SCAN_DATA_FIELD_BLOB);
 								bleEventInfo.fileType = NNO_FILE_SCAN_DATA;
 								bleEventInfo.key = NNO_CMD_FILE_GET_READSIZE;
 								bleEventInfo.cmdType = BLE_COMMAND_TYPE_WRITE_NOTIFY;
@@ -612,7 +665,7 @@ void BTPSAPI GATTScanSvc_ServerEventCallback(unsigned int BluetoothStackID, GATT
 								bleEventInfo.btInfo.ccdOffset = BLE_SCANSVC_READ_SCAN_DATA_CCD_ATTRIBUTE_VALUE_OFFSET;
 								bleEventInfo.btInfo.serviceID = ScanSvcServiceInstance.ServiceID;
 								bleEventInfo.btInfo.connectionID = ScanSvcServiceInstance.ConnectionID;
-								bleEventInfo.subfieldType = BLE_SCAN_DATA_FIELD_BLOB;
+								bleEventInfo.subfieldType = writeVal[5];
 								bleEventInfo.dataType = 1;
 								bleCmdHandlerLiason_relayCmd(&writeVal[0],length,bleEventInfo);
 								break;
@@ -25,206 +25,140 @@
 #include "BLEUtils.h"
 #include "BLEcommonDefs.h"
 #include "BLENotificationHandler.h"
+#include "scanStream.h"
 
 BLE_NOTIFY_INFO_LIST_NODE	*bleNotificationList;		//FIFO list of notifications that have been requested by the client
 extern unsigned short gBLESuppMTUSize;
 
+/**
+ * @brief Node of the notification list together with its data buffer
+ */
+typedef struct _bleNotifyPoolBlock
+{
+	BLE_NOTIFY_INFO_LIST_NODE	node;
+	uint8_t						data[BLE_MAX_PACKET_SIZE];
+} BLE_NOTIFY_POOL_BLOCK;
+
+/**
+ * @brief Static storage for the notification list; at most one node per type
+ */
+static BLE_NOTIFY_POOL_BLOCK notifyBlocks[BLE_INDICATE_MAX];
+static BLE_POOL notifyPool;
+static bool notifyPoolReady = false;
+
+/**
+ * @brief Last node of the notification list and the node of each type
+ */
+static BLE_NOTIFY_INFO_LIST_NODE *bleNotificationTail;
+static BLE_NOTIFY_INFO_LIST_NODE *notifyNodeByType[BLE_INDICATE_MAX];
+
 /*********************** Local functions ***************************************/
-int addNodeToNotifyList(BLE_NOTIFY_INFO_LIST_NODE node);
-void clearNotifyListNode(BLE_NOTIFY_INFO_LIST_NODE *node);
-int deleteNodefromNotificationList(BLE_Notify_Type type);
+int addNodeToNotifyList(BLE_NOTIFY_INFO *pInfo);
+void clearNotifyList(void);
+int deleteNodefromNotificationList(uint8_t type);
+static void sendScanStream(void);
 
-int addNodeToNotifyList(BLE_NOTIFY_INFO_LIST_NODE node)
+int addNodeToNotifyList(BLE_NOTIFY_INFO *pInfo)
 {
-	int ret_val = 0;
-	BLE_NOTIFY_INFO_LIST_NODE *lastNd;
-
-	int cnt = 0;
+	BLE_NOTIFY_INFO_LIST_NODE *node;
+	BLE_NOTIFY_POOL_BLOCK *block;
 
-	// Clear data change indication flag, just in case
-	node.Info.data_changed = false;
+	if (pInfo->type >= BLE_INDICATE_MAX)
+		return (FAIL);
 
-	if (bleNotificationList == NULL)
-	{
-		DEBUG_PRINT("\r\nNotify List is empty\r\n");
-		bleNotificationList = (BLE_NOTIFY_INFO_LIST_NODE *)bleMalloc(sizeof(BLE_NOTIFY_INFO_LIST_NODE));
-		if (bleNotificationList != NULL)
-		{
-			bleNotificationList->Info.data = (uint8_t *)bleMalloc(sizeof(uint8_t)*gBLESuppMTUSize);
-			if (bleNotificationList->Info.data != NULL)
-			{
-				memcpy(&bleNotificationList->Info.btInfo, &node.Info.btInfo,sizeof(BT_INFO));
-				bleNotificationList->Info.data_changed = node.Info.data_changed;
-				bleNotificationList->Info.data_length = node.Info.data_length;
-				bleNotificationList->Info.type = node.Info.type;
-				memcpy(bleNotificationList->Info.data, node.Info.data, sizeof(uint8_t)*gBLESuppMTUSize);
-				bleNotificationList->next = NULL;
-
-				cnt++;
-			}
-		}
-		else
-			ret_val = FAIL;
-	}
-	else
+	node = notifyNodeByType[pInfo->type];
+	if (node != NULL)
 	{
-		DEBUG_PRINT("\r\nNotify List is not empty\r\n");
-		Boolean_t nodeExists = false;
-		lastNd = bleNotificationList;
+		// copy over the BLE info in case that has changed
+		node->Info.btInfo.bluetoothID = pInfo->btInfo.bluetoothID;
+		node->Info.btInfo.ccdOffset = pInfo->btInfo.ccdOffset;
+		node->Info.btInfo.connectionID = pInfo->btInfo.connectionID;
+		node->Info.btInfo.serviceID = pInfo->btInfo.serviceID;
 
-		while (lastNd->next != NULL) //find last node
-		{
-			if (lastNd->Info.type != node.Info.type)
-				lastNd = lastNd->next;
-			else
-			{
-				nodeExists = true;
-				break;
-			}
-			cnt++;
-		}
+		return (-1);
+	}
 
-		if (!nodeExists)
-		{
-			lastNd->next = (BLE_NOTIFY_INFO_LIST_NODE *)bleMalloc(sizeof(BLE_NOTIFY_INFO_LIST_NODE));
-			if (lastNd->next != NULL)
-			{
-				lastNd->next->Info.data = (uint8_t *)bleMalloc(sizeof(uint8_t)*gBLESuppMTUSize);
-				if (lastNd->next->Info.data != NULL)
-				{
-					memcpy(&lastNd->next->Info.btInfo, &node.Info.btInfo,sizeof(BT_INFO));
-					lastNd->next->Info.data_changed = node.Info.data_changed;
-					lastNd->next->Info.data_length = node.Info.data_length;
-					lastNd->next->Info.type = node.Info.type;
-					memcpy(lastNd->next->Info.data, node.Info.data, sizeof(uint8_t)*gBLESuppMTUSize);
-					lastNd->next->next = NULL;
-					cnt++;
-				}
-				else
-					ret_val = FAIL;
-			}
-			else
-				ret_val = FAIL;
-		}
-		else
-		{
-			// copy over the BLE info in case that has changed
-			lastNd->Info.btInfo.bluetoothID = node.Info.btInfo.bluetoothID;
-			lastNd->Info.btInfo.ccdOffset = node.Info.btInfo.ccdOffset;
-			lastNd->Info.btInfo.connectionID = node.Info.btInfo.connectionID;
-			lastNd->Info.btInfo.serviceID = node.Info.btInfo.serviceID;
+	block = (BLE_NOTIFY_POOL_BLOCK *)blePoolAlloc(&notifyPool);
+	if (block == NULL)
+		return (FAIL);
+
+	node = &block->node;
+	node->Info.data = &block->data[0];
+	memcpy(&node->Info.btInfo, &pInfo->btInfo, sizeof(BT_INFO));
+	node->Info.data_changed = false;		// Clear data change indication flag, just in case
+	node->Info.data_length = pInfo->data_length;
+	node->Info.type = pInfo->type;
+	if (pInfo->data != NULL)
+		memcpy(node->Info.data, pInfo->data, sizeof(uint8_t)*gBLESuppMTUSize);
+	else
+		memset(node->Info.data, 0, sizeof(uint8_t)*gBLESuppMTUSize);
 
-			ret_val = -1;
-		}
-	}
+	node->next = NULL;
+	node->prev = bleNotificationTail;
+	if (bleNotificationTail == NULL)
+		bleNotificationList = node;
+	else
+		bleNotificationTail->next = node;
+	bleNotificationTail = node;
+	notifyNodeByType[node->Info.type] = node;
 
-	DEBUG_PRINT("\r\nTotal number of nodes after adding to list: %d\r\n", cnt);
+	DEBUG_PRINT("\r\nTotal number of nodes after adding to list: %d\r\n", notifyPool.stats.in_use);
 
-	return(ret_val);
+	return (0);
 }
 
 BLE_NOTIFY_INFO_LIST_NODE *getMatchfromNotificationList(uint8_t type)
 {
-	BLE_NOTIFY_INFO_LIST_NODE *temp = bleNotificationList;
-	while (temp != NULL)
-	{
-		if (temp->Info.type == type)
-			break;
-		else
-			temp = temp->next;
-	}
+	if (type >= BLE_INDICATE_MAX)
+		return (NULL);
 
-	return (temp);
+	return (notifyNodeByType[type]);
 }
 
 int deleteNodefromNotificationList(uint8_t type)
 {
-	int ret_val = 0;
-	int cnt = 0;
-	BLE_NOTIFY_INFO_LIST_NODE *currNode = bleNotificationList;
-	BLE_NOTIFY_INFO_LIST_NODE *prevNode = NULL;
-	Boolean_t nodeFound = false;
+	BLE_NOTIFY_INFO_LIST_NODE *node = getMatchfromNotificationList(type);
 
-	while(!nodeFound)
-	{
-		if (currNode == NULL)
-		{
-			ret_val = -1;
-			break;
-		}
-		else if (currNode->Info.type == type)
-		{
-			nodeFound = true;
+	if (node == NULL)
+		return (-1);
 
-			if (prevNode == NULL)	//first node
-				bleNotificationList = currNode->next;
-			else
-				prevNode->next = currNode->next;
+	if (node->prev == NULL)	//first node
+		bleNotificationList = node->next;
+	else
+		node->prev->next = node->next;
 
-			bleFree(currNode->Info.data, sizeof(uint8_t)*gBLESuppMTUSize);
-			bleFree(currNode, sizeof(BLE_NOTIFY_INFO_LIST_NODE));
-		}
-		else
-		{
-			prevNode = currNode;
-			currNode = currNode->next;
-		}
-	}
+	if (node->next == NULL)	//last node
+		bleNotificationTail = node->prev;
+	else
+		node->next->prev = node->prev;
 
-	/* Following code is only for printing status, so remove if required */
-#if 1
-	currNode = bleNotificationList;
-	while (currNode != NULL)
-	{
-		cnt++;
-		currNode = currNode->next;
-	}
+	notifyNodeByType[type] = NULL;
+	blePoolFree(&notifyPool, node);
 
-	DEBUG_PRINT("\r\nNo of nodes after removing node from Notification list:%d\r\n", cnt);
-#endif
+	DEBUG_PRINT("\r\nNo of nodes after removing node from Notification list:%d\r\n", notifyPool.stats.in_use);
 
-	return (ret_val);
+	return (0);
 }
 
-void clearNotifyListNode(BLE_NOTIFY_INFO_LIST_NODE *node)
+void clearNotifyList(void)
 {
-	if (node == NULL)
-		return;
-
-	if (node->next != NULL)
-		clearNotifyListNode(node->next);
+	if (!notifyPoolReady)
+	{
+		blePoolInit(&notifyPool, notifyBlocks, sizeof(BLE_NOTIFY_POOL_BLOCK), BLE_INDICATE_MAX);
+		notifyPoolReady = true;
+	}
+	else
+		blePoolReset(&notifyPool);
 
-	bleFree(node->Info.data, sizeof(uint8_t)*gBLESuppMTUSize);
-	bleFree(node, sizeof(BLE_NOTIFY_INFO_LIST_NODE));
+	bleNotificationList = NULL;
+	bleNotificationTail = NULL;
+	memset(notifyNodeByType, 0, sizeof(notifyNodeByType));
 }
 
 /* Registration fucntions - would be invoked from GATT profile Handlers */
 int bleNotificationHandler_registerNotification(BLE_NOTIFY_INFO notifyInfo)
 {
-	int ret_val = 0;
-
-	BLE_NOTIFY_INFO_LIST_NODE tempNode;
-	tempNode.Info.data = (uint8_t *)bleMalloc(sizeof(uint8_t)*gBLESuppMTUSize);
-	if (tempNode.Info.data != NULL)
-	{
-		memcpy(&tempNode.Info.btInfo, &notifyInfo.btInfo,sizeof(BT_INFO));
-		tempNode.Info.data_changed = notifyInfo.data_changed;
-		tempNode.Info.data_length = notifyInfo.data_length;
-		tempNode.Info.type = notifyInfo.type;
-		if (notifyInfo.data != NULL)
-			memcpy(tempNode.Info.data, notifyInfo.data, sizeof(uint8_t)*gBLESuppMTUSize);
-		else
-			memset(tempNode.Info.data,0,sizeof(uint8_t)*gBLESuppMTUSize);
-
-		tempNode.next = NULL;
-		ret_val = addNodeToNotifyList(tempNode);
-
-		bleFree(tempNode.Info.data, sizeof(uint8_t)*gBLESuppMTUSize);
-	}
-	else
-		ret_val = FAIL;
-
-	return (ret_val);
+	return (addNodeToNotifyList(&notifyInfo));
 }
 
 int bleNotificationHandler_deregisterNotification(uint8_t type)
@@ -252,7 +186,7 @@ int bleNotificationHandler_sendNotification()
 	while (node != NULL)
 	{
 		type = node->Info.type;
-		if ((type < BLE_NOTIFY_MAX) && (node->Info.data_changed))
+		if ((type < BLE_NOTIFY_MAX) && (type != BLE_NOTIFY_SCAN_STREAM) && (node->Info.data_changed))
 		{
 			ret_val = BLEUtil_SendNotification(node->Info.btInfo.bluetoothID,
 											node->Info.btInfo.serviceID,
@@ -272,9 +206,62 @@ int bleNotificationHandler_sendNotification()
 		node = node->next;
 	}
 
+	sendScanStream();
+
 	return (ret_val);
 }
 
+static void sendScanStream(void)
+/*
+ * Sends what the scan task has queued in the scan stream as notifications of
+ * the scan stream characteristic, one ScanStream_ReadPacket() packet each,
+ * until the stream is empty or the stack has no buffer left. A packet the
+ * stack did not take stays in the node and goes first once the stack reports
+ * its buffers empty, see bleNotificationHandler_resumeScanStream().
+ */
+{
+	BLE_NOTIFY_INFO_LIST_NODE *node = getMatchfromNotificationList(BLE_NOTIFY_SCAN_STREAM);
+	int length;
+
+	if (node == NULL)
+		return;
+
+	while (1)
+	{
+		if (!node->Info.data_changed)
+		{
+			length = ScanStream_ReadPacket(&node->Info.data[0], MIN(gBLESuppMTUSize, BLE_MAX_PACKET_SIZE),
+					!nnoStatus_getIndDeviceStatus(NNO_STATUS_SCAN_IN_PROGRESS));
+			if ((length < 0) || (node->Info.data[0] != SCAN_STREAM_STATUS_DATA))
+				return;
+			node->Info.data_length = length;
+			node->Info.data_changed = true;
+		}
+
+		if (BLEUtil_SendNotification(node->Info.btInfo.bluetoothID,
+									 node->Info.btInfo.serviceID,
+									 node->Info.btInfo.connectionID,
+									 node->Info.btInfo.ccdOffset,
+									 node->Info.data_length,
+									 &node->Info.data[0]) < 0)
+			return;
+		node->Info.data_changed = false;
+	}
+}
+
+void bleNotificationHandler_resumeScanStream(void)
+{
+	BLE_NOTIFY_INFO_LIST_NODE *node = getMatchfromNotificationList(BLE_NOTIFY_SCAN_STREAM);
+
+	if ((node != NULL) && (node->Info.data_changed))
+		Semaphore_post(BLENotifySem);
+}
+
+bool bleNotificationHandler_isScanStreamOn(void)
+{
+	return (getMatchfromNotificationList(BLE_NOTIFY_SCAN_STREAM) != NULL);
+}
+
 int bleNotificationHandler_sendIndication()
 {
 	uint8_t type = 0;
@@ -423,18 +410,22 @@ int bleNotificationHandler_sendErrorIndication(uint32_t field, int16_t code)
 	return (result);
 }
 
+void bleNotificationHandler_getPoolStats(BLE_POOL_STATS *pStats)
+{
+	blePoolGetStats(&notifyPool, pStats);
+}
+
 /* Initialization/Deinitialization functions */
 void bleNotificationHandler_Init()
 {
-	bleNotificationList = NULL;
+	clearNotifyList();
 
 	return;
 }
 
 void bleNotificationHandler_DeInit()
 {
-	clearNotifyListNode(bleNotificationList);
-	bleNotificationList = NULL;
+	clearNotifyList();
 
 	return;
 }
@@ -0,0 +1,158 @@
+/*
+ * BLE block pool
+ *
+ * Fixed size blocks in caller supplied static memory, chained through their
+ * first word while free. Releases are checked against the pool, so a block
+ * given back twice or one that did not come from the pool is counted and
+ * ignored instead of corrupting the free list.
+ *
+ * Copyright (C) 2014-15 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nnoStatus.h"
+#include "BLEPool.h"
+
+static bool blePoolCanRelease(BLE_POOL *pPool, void *pBlock)
+/*
+ * Tells whether a block can be given back: it must start a block of the
+ * pool and not be on the free list already. The free list is walked, which
+ * is cheap for the few blocks the BLE lists have.
+ */
+{
+	uint8_t *pByte = (uint8_t *)pBlock;
+	void *pFree;
+
+	if ((pByte < pPool->pMem) ||
+			(pByte >= pPool->pMem + pPool->stats.capacity * pPool->blockSize) ||
+			(((size_t)(pByte - pPool->pMem) % pPool->blockSize) != 0))
+		return (false);
+
+	for (pFree = pPool->pFree; pFree != NULL; pFree = *(void **)pFree)
+	{
+		if (pFree == pBlock)
+			return (false);
+	}
+
+	return (true);
+}
+
+void blePoolInit(BLE_POOL *pPool, void *pMem, size_t blockSize, uint16_t numBlocks)
+/**
+ * Sets up a pool of fixed size blocks in caller supplied memory and clears
+ * its statistics
+ *
+ * @param[out]  pPool		Pool
+ * @param[in]   pMem		numBlocks * blockSize bytes, aligned for a pointer
+ * @param[in]   blockSize	Size of a block, at least sizeof(void *)
+ * @param[in]   numBlocks	Number of blocks
+ *
+ * @return      None
+ *
+ */
+{
+	memset(&pPool->stats, 0, sizeof(BLE_POOL_STATS));
+	pPool->pMem = (uint8_t *)pMem;
+	pPool->blockSize = blockSize;
+	pPool->stats.capacity = numBlocks;
+
+	blePoolReset(pPool);
+}
+
+void blePoolReset(BLE_POOL *pPool)
+/**
+ * Returns all blocks to the pool at once. Allocation counts and the
+ * high-water mark are kept.
+ *
+ * @param[in]   pPool	Pool
+ *
+ * @return      None
+ *
+ */
+{
+	uint16_t i;
+	void **pBlock;
+
+	pPool->pFree = NULL;
+	for (i = pPool->stats.capacity; i > 0; i--)
+	{
+		pBlock = (void **)(pPool->pMem + (i - 1) * pPool->blockSize);
+		*pBlock = pPool->pFree;
+		pPool->pFree = pBlock;
+	}
+	pPool->stats.in_use = 0;
+}
+
+void *blePoolAlloc(BLE_POOL *pPool)
+/**
+ * Takes a block from the pool
+ *
+ * @param[in]   pPool	Pool
+ *
+ * @return      Pointer to block, NULL if all blocks are in use
+ *
+ */
+{
+	void **pBlock = (void **)pPool->pFree;
+
+	if (pBlock == NULL)
+	{
+		pPool->stats.num_fail++;
+		nnoStatus_setErrorStatus(NNO_ERROR_INSUFFICIENT_MEMORY, true);
+		return (NULL);
+	}
+
+	pPool->pFree = *pBlock;
+	pPool->stats.num_alloc++;
+	pPool->stats.in_use++;
+	if (pPool->stats.in_use > pPool->stats.in_use_max)
+		pPool->stats.in_use_max = pPool->stats.in_use;
+
+	return (pBlock);
+}
+
+void blePoolFree(BLE_POOL *pPool, void *pBlock)
+/**
+ * Gives a block back to the pool it was taken from. A block that is
+ * already free or not from this pool is counted in num_bad_free and left
+ * alone.
+ *
+ * @param[in]   pPool	Pool
+ * @param[in]   pBlock	Block returned by blePoolAlloc()
+ *
+ * @return      None
+ *
+ */
+{
+	if (pBlock == NULL)
+		return;
+
+	if (!blePoolCanRelease(pPool, pBlock))
+	{
+		pPool->stats.num_bad_free++;
+		return;
+	}
+
+	*(void **)pBlock = pPool->pFree;
+	pPool->pFree = pBlock;
+	pPool->stats.num_free++;
+	pPool->stats.in_use--;
+}
+
+void blePoolGetStats(BLE_POOL *pPool, BLE_POOL_STATS *pStats)
+/**
+ * Returns the allocation statistics of a pool
+ *
+ * @param[in]   pPool	Pool
+ * @param[out]  pStats	Statistics
+ *
+ * @return      None
+ *
+ */
+{
+	memcpy(pStats, &pPool->stats, sizeof(BLE_POOL_STATS));
+}
@@ -30,6 +30,7 @@
 #include "led.h"
 #include "version.h"
 #include "BLECommonDefs.h"
+#include "BLEBulkXfer.h"
 #include "BLEGATTStdSvcs.h"
 #include "BLEGATTCmdSvc.h"
 #include "BLEGATTGISvc.h"
@@ -290,6 +291,12 @@ static int UpdateConnectionID(unsigned int ConnectionID, BD_ADDR_t BD_ADDR);
  */
 static void RemoveConnectionInfo(BD_ADDR_t BD_ADDR);
 
+/**
+ * @brief Function to set the packet size used for a connection from its MTU
+ *
+ */
+static void SetSupportedMTU(Word_t MTU);
+
 /* BTPS Callback function prototypes.                                */
 /**
  * @brief Callback function used to notify app on GAP LE events
@@ -601,6 +608,10 @@ static int OpenStack(HCI_DriverInformation_t *HCI_DriverInformation, BTPS_Initia
             /* Initialize the GATT Service.                             */
             if((Result = GATT_Initialize(ApplicationStateInfo.BluetoothStackID, GATT_INITIALIZATION_FLAGS_SUPPORT_LE, GATT_Connection_Event_Callback, 0)) == 0)
             {
+               /* Offer the largest MTU the stack is built for, so that */
+               /* a client that asks for a bigger MTU gets it.          */
+               GATT_Change_Maximum_Supported_MTU(ApplicationStateInfo.BluetoothStackID, BTPS_CONFIGURATION_GATT_MAXIMUM_SUPPORTED_MTU_SIZE);
+
                /* Determine the number of LE packets that the controller*/
                /* will accept at a time.                                */
                if((!HCI_LE_Read_Buffer_Size(ApplicationStateInfo.BluetoothStackID, &Status, &LEPacketLength, &NumberLEPackets)) && (!Status) && (LEPacketLength))
@@ -612,8 +623,12 @@ static int OpenStack(HCI_DriverInformation_t *HCI_DriverInformation, BTPS_Initia
                   NumberLEPackets = 1;
 
                /* Set a limit on the number of packets that we will     */
-               /* queue internally.                                     */
-               GATT_Set_Queuing_Parameters(ApplicationStateInfo.BluetoothStackID, (unsigned int)NumberLEPackets, (unsigned int)(NumberLEPackets-1), FALSE);
+               /* queue internally. Allow a window of notifications so */
+               /* the controller has several to send at each connection*/
+               /* event, and ask for more when half have gone.          */
+               if(NumberLEPackets < BLE_BULK_XFER_WINDOW)
+                  NumberLEPackets = BLE_BULK_XFER_WINDOW;
+               GATT_Set_Queuing_Parameters(ApplicationStateInfo.BluetoothStackID, (unsigned int)NumberLEPackets, (unsigned int)(NumberLEPackets/2), FALSE);
 
                /* Initialize the GAPS Service.                          */
                Result = GAPS_Initialize_Service(ApplicationStateInfo.BluetoothStackID, &ServiceID);
@@ -1285,6 +1300,22 @@ static void RemoveConnectionInfo(BD_ADDR_t BD_ADDR)
    }
 }
 
+static void SetSupportedMTU(Word_t MTU)
+/**
+ * Function is responsible for setting gBLESuppMTUSize from the MTU agreed
+ * with the client, limited to what the stack supports
+ *
+ * @param[in]   MTU	Connection MTU
+ *
+ * @return      None
+ */
+{
+   if(MTU > BTPS_CONFIGURATION_GATT_MAXIMUM_SUPPORTED_MTU_SIZE)
+      MTU = BTPS_CONFIGURATION_GATT_MAXIMUM_SUPPORTED_MTU_SIZE;
+
+   gBLESuppMTUSize = MTU - MTU_PACKET_HEADER_SIZE;
+}
+
    /* ***************************************************************** */
    /*                         Event Callbacks                           */
    /* ***************************************************************** */
@@ -1626,10 +1657,7 @@ static void BTPSAPI GATT_Connection_Event_Callback(unsigned int BluetoothStackID
             if(GATT_Connection_Event_Data->Event_Data.GATT_Device_Connection_Data)
             {
                // Set the MTU size for the connection
-               if (GATT_Connection_Event_Data->Event_Data.GATT_Device_Connection_Data->MTU > BTPS_CONFIGURATION_GATT_MAXIMUM_SUPPORTED_MTU_SIZE)
-            	   gBLESuppMTUSize = BTPS_CONFIGURATION_GATT_MAXIMUM_SUPPORTED_MTU_SIZE - MTU_PACKET_HEADER_SIZE;
-               else
-            	   gBLESuppMTUSize = GATT_Connection_Event_Data->Event_Data.GATT_Device_Connection_Data->MTU - MTU_PACKET_HEADER_SIZE;
+               SetSupportedMTU(GATT_Connection_Event_Data->Event_Data.GATT_Device_Connection_Data->MTU);
 
                /* Update the ConnectionID associated with the BD_ADDR   */
                /* If UpdateConnectionID returns -1, then it failed.     */
@@ -1684,10 +1712,22 @@ static void BTPSAPI GATT_Connection_Event_Callback(unsigned int BluetoothStackID
             else
             	DEBUG_PRINT("Error - Null Disconnection Data.\r\n");
             break;
+         case etGATT_Connection_Device_Connection_MTU_Update:
+            /* The client has negotiated a bigger MTU than the default; */
+            /* responses from now on use packets of the new size.       */
+            if(GATT_Connection_Event_Data->Event_Data.GATT_Device_Connection_MTU_Update_Data)
+            {
+               SetSupportedMTU(GATT_Connection_Event_Data->Event_Data.GATT_Device_Connection_MTU_Update_Data->MTU);
+               DEBUG_PRINT("\r\netGATT_Connection_Device_Connection_MTU_Update, MTU: %u\r\n", GATT_Connection_Event_Data->Event_Data.GATT_Device_Connection_MTU_Update_Data->MTU);
+            }
+            break;
          case etGATT_Connection_Device_Buffer_Empty:
         	 DEBUG_PRINT("\r\netGATT_Connection_Device_Buffer_Empty\r\n");
         	 if(GATT_Connection_Event_Data->Event_Data.GATT_Device_Buffer_Empty_Data)
+        	 {
         		 bleCmdHandlerLiaison_handleBLEResponse(true, GATT_Connection_Event_Data->Event_Data.GATT_Device_Buffer_Empty_Data->ConnectionID);
+        		 bleNotificationHandler_resumeScanStream();
+        	 }
         	 break;
       }
    }
@@ -0,0 +1,94 @@
+/*
+ * BLE bulk transfer header file
+ *
+ * Sends a block of data to a client as a run of notifications, keeping the
+ * GATT queue of the connection full. No Bluetopia or RTOS dependencies, so
+ * a host build can run it against a model of the stack.
+ *
+ * Format of an indexed transfer (large data blobs):
+ *	packet 0	: seq (2 bytes, 0x0000), total payload length (4 bytes)
+ *	packet n	: seq (2 bytes, n), up to packet size - 2 bytes of payload
+ * All fields are little endian. The sequence number is 16 bits so that
+ * blobs of more than 255 packets do not wrap. Packet 0 is 6 bytes long
+ * where the earlier 8-bit index format used 5, so a client can tell the
+ * two formats apart from it.
+ *
+ * Packets of a non-indexed transfer carry only payload.
+ *
+ * Copyright (C) 2014-15 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#ifndef BLEBULKXFER_H_
+#define BLEBULKXFER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Notifications the GATT layer may hold per connection. The stack
+ * refuses further ones until the queue has drained to half of this, then
+ * reports the connection's buffer empty.
+ */
+#define BLE_BULK_XFER_WINDOW				8
+
+/**
+ * @brief Bytes ahead of the payload in an indexed packet
+ */
+#define BLE_BULK_XFER_SEQ_SIZE				2
+
+/**
+ * @brief Length of packet 0 of an indexed transfer
+ */
+#define BLE_BULK_XFER_SIZE_PKT_LEN			(BLE_BULK_XFER_SEQ_SIZE + 4)
+
+/**
+ * @brief Result of pushing packets to the stack
+ */
+typedef enum _tagBLE_Bulk_Xfer_Status_t
+{
+	BLE_BULK_XFER_DONE,			// all packets accepted by the stack
+	BLE_BULK_XFER_WAIT,			// GATT queue full; call again on buffer empty
+	BLE_BULK_XFER_ERROR			// stack refused a packet for another reason
+} BLE_Bulk_Xfer_Status_t;
+
+/**
+ * @brief Function that hands one notification to the stack. Returns 0 if
+ * it was queued, BTPS_ERROR_INSUFFICIENT_BUFFER_SPACE if the GATT queue is
+ * full or another negative error code.
+ */
+typedef int (*BLE_BULK_SEND_FUNC)(void *pCtx, uint16_t length, uint8_t *pPkt);
+
+/**
+ * @brief State of a transfer; filled in by bleBulkXfer_start()
+ */
+typedef struct _bleBulkXfer
+{
+	const uint8_t	*pData;
+	uint32_t		length;			// payload bytes
+	uint32_t		pos;			// payload bytes accepted by the stack
+	uint16_t		seq;			// sequence number of the next packet
+	uint16_t		pktSize;		// connection MTU less the ATT header
+	bool			indexed;
+	uint16_t		numPackets;		// packets accepted by the stack
+	uint16_t		numStalls;		// packets refused with the GATT queue full
+} BLE_BULK_XFER;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Transfer set up and progress functions
+ */
+void bleBulkXfer_start(BLE_BULK_XFER *pXfer, const uint8_t *pData, uint32_t length, uint16_t pktSize, bool indexed);
+uint16_t bleBulkXfer_buildPacket(const BLE_BULK_XFER *pXfer, uint8_t *pPkt);
+void bleBulkXfer_packetSent(BLE_BULK_XFER *pXfer);
+bool bleBulkXfer_isDone(const BLE_BULK_XFER *pXfer);
+BLE_Bulk_Xfer_Status_t bleBulkXfer_pump(BLE_BULK_XFER *pXfer, uint8_t *pPkt, BLE_BULK_SEND_FUNC pSend, void *pCtx);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BLEBULKXFER_H_ */
@@ -10,6 +10,9 @@
 #ifndef BLECMDHANDLER_H_
 #define BLECMDHANDLER_H_
 
+#include "BLEUtils.h"
+#include "BLEBulkXfer.h"
+
 /**
  * @name Command handler Liason state definitions
  *
@@ -87,9 +90,7 @@ typedef struct _bleResponseInfo
 	BLE_Command_Exec_Status_t	cmdStatus;
 	BT_INFO 					btInfo;
 	unsigned short 				totalLength;
-	short 						remLength;				//remaining data length to be sent
-	unsigned char				*data;
-	unsigned char				currentPktIdx;
+	BLE_BULK_XFER				xfer;					// notifications of the response still to be sent
 	uint8_t						dataType;				// 0 - normal data, 1 - large data blob
 } BLE_RESPONSE_INFO;
 
@@ -100,6 +101,7 @@ typedef struct _bleResponseInfoListNode
 {
 	BLE_RESPONSE_INFO			Info;
 	struct _bleResponseInfoListNode	*next;
+	struct _bleResponseInfoListNode	*prev;
 } BLE_RESPONSE_INFO_LIST_NODE;
 
 /**
@@ -121,6 +123,11 @@ extern "C" {
 void InitBLECmdHandlerLiason();
 void DeInitBLECmdHandlerLiason();
 
+/**
+ * @brief Allocation statistics of the pending response list
+ */
+void bleCmdHandlerLiason_getPoolStats(BLE_POOL_STATS *pStats);
+
 /**
  * @brief This functions relays command from BLE App to command handler
  */
@@ -148,6 +155,7 @@ bool cmdStoreRefScanCfg_wr(uint8_t len, uint8_t *pData);
 bool cmdPrintCalCoeffs_rd(uint8_t len, uint8_t *pData);
 bool cmdSetSerialNumber_wr(uint8_t len, uint8_t *pData);
 bool cmdSetDevErrStat_wr(uint8_t len, uint8_t *pData);
+bool cmdPrintPoolStats_rd(uint8_t len, uint8_t *pData);
 
 #ifdef __cplusplus
 }
@@ -106,7 +106,8 @@ typedef enum _tagBLE_Scan_Data_Field_Type_t
 	BLE_SCAN_DATA_FIELD_TYPE,
 	BLE_SCAN_DATA_FIELD_TIME,
 	BLE_SCAN_DATA_FIELD_BLOB_VER,
-	BLE_SCAN_DATA_FIELD_BLOB
+	BLE_SCAN_DATA_FIELD_BLOB,
+	BLE_SCAN_DATA_FIELD_SPECTRUM		// packed interpreted spectrum, see dlpspec_spectrum_pack()
 } BLE_Scan_Data_Field_Type_t;
 
 /**
@@ -120,6 +121,7 @@ typedef enum _tagBLE_Notify_Type_t
 	BLE_NOTIFY_COMMANDS,
 	BLE_NOTIFY_SCAN_STATUS,
 	BLE_NOTIFY_CLEAR_SCAN_STATUS,
+	BLE_NOTIFY_SCAN_STREAM,
 	BLE_NOTIFY_MAX
 } BLE_Notify_Type;
 
@@ -250,6 +252,14 @@ int bleCmdHandlerLiaison_handleBLEResponse(bool isCallerBLE, unsigned int connec
  */
 int bleNotificationHandler_setNotificationData(uint8_t type, int length, uint8_t *data);
 
+/**
+ * Tells whether a BLE client takes the scan stream as notifications, in
+ * which case the BLE task is the one that reads the stream
+ *
+ * Function defined in BLENotificationHandler.c
+ */
+bool bleNotificationHandler_isScanStreamOn(void);
+
 int bleNotificationHandler_SendErrorIndication(uint32_t field, int16_t code);
 
 /**
@@ -25,6 +25,7 @@ typedef struct _tagApplicationStateInfo_ScanSvc_t
    Word_t			scanTime_CCD;
    Word_t			scanBlobVer_CCD;
    Word_t			scanData_CCD;
+   Word_t			scanStream_CCD;
    unsigned short	numScans;
 } ApplicationStateInfo_ScanSvc_t;
 
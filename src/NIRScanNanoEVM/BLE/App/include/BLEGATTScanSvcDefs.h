@@ -302,6 +302,24 @@ static BTPSCONST GATT_Characteristic_Value_128_Entry_t  BLE_ScanSvc_ReadScanData
 	NULL
 };
 
+/**
+ * @brief Scan stream characteristic UUID; notifies the scan stream packets
+ * of each finished repeat while streaming is enabled
+ */
+#define SCAN_STREAM_CCD_UUID	{ 0x6F, 0x6E, 0x61, 0x4E, 0x20, 0x52, 0x49, 0x4E, 0x20, 0x50, 0x4C, 0x44, 0x29, 0x41, 0x48, 0x43 }
+static BTPSCONST GATT_Characteristic_Declaration_128_Entry_t BLE_ScanSvc_ScanStream_Char_CCD_Declaration =
+{
+   GATT_CHARACTERISTIC_PROPERTIES_NOTIFY,
+   SCAN_STREAM_CCD_UUID
+};
+
+static BTPSCONST GATT_Characteristic_Value_128_Entry_t  BLE_ScanSvc_ScanStream_Char_CCD_Value =
+{
+	SCAN_STREAM_CCD_UUID,
+	0,
+	NULL
+};
+
 /***		Client Characteristic Configuration Descriptor            ***/
 static GATT_Characteristic_Descriptor_16_Entry_t ScanSvc_Client_Characteristic_Configuration =
 {
@@ -360,6 +378,9 @@ BTPSCONST GATT_Service_Attribute_Entry_t BLE_ScanSvc_Att_Entry[] =
    {GATT_ATTRIBUTE_FLAGS_READABLE,          aetCharacteristicDeclaration128,  (Byte_t *)&BLE_ScanSvc_ReadScanData_Char_CCD_Declaration},	//42
    {0,          							aetCharacteristicValue128,        (Byte_t *)&BLE_ScanSvc_ReadScanData_Char_CCD_Value},			//43
    {GATT_ATTRIBUTE_FLAGS_READABLE_WRITABLE, aetCharacteristicDescriptor16,    (Byte_t *)&ScanSvc_Client_Characteristic_Configuration},		//44
+   {GATT_ATTRIBUTE_FLAGS_READABLE,          aetCharacteristicDeclaration128,  (Byte_t *)&BLE_ScanSvc_ScanStream_Char_CCD_Declaration},	//45
+   {0,          							aetCharacteristicValue128,        (Byte_t *)&BLE_ScanSvc_ScanStream_Char_CCD_Value},			//46
+   {GATT_ATTRIBUTE_FLAGS_READABLE_WRITABLE, aetCharacteristicDescriptor16,    (Byte_t *)&ScanSvc_Client_Characteristic_Configuration},		//47
 };
 
 #define BLE_SCAN_SERVICE_ATTRIBUTE_COUNT               (sizeof(BLE_ScanSvc_Att_Entry)/sizeof(GATT_Service_Attribute_Entry_t))
@@ -406,6 +427,9 @@ BTPSCONST GATT_Service_Attribute_Entry_t BLE_ScanSvc_Att_Entry[] =
 #define BLE_SCANSVC_READ_SCAN_DATA_CHARACTERISTIC_ATTRIBUTE_OFFSET		41
 #define BLE_SCANSVC_READ_SCAN_DATA_CCD_ATTRIBUTE_VALUE_OFFSET			43
 #define BLE_SCANSVC_READ_SCAN_DATA_CCD_ATTRIBUTE_OFFSET					44
+/**		Scan stream characteristic offsets								*/
+#define BLE_SCANSVC_SCAN_STREAM_CCD_ATTRIBUTE_VALUE_OFFSET				46
+#define BLE_SCANSVC_SCAN_STREAM_CCD_ATTRIBUTE_OFFSET					47
 //@}
 
 #endif /* BLESCANDATASVCDEFS_H_ */
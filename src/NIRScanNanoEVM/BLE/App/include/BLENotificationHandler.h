@@ -25,6 +25,7 @@ typedef struct _bleNotifyInfoListNode
 {
 	BLE_NOTIFY_INFO			Info;
 	struct _bleNotifyInfoListNode	*next;
+	struct _bleNotifyInfoListNode	*prev;
 } BLE_NOTIFY_INFO_LIST_NODE;
 
 #ifdef __cplusplus
@@ -36,9 +37,11 @@ void bleNotificationHandler_DeInit();
 int bleNotificationHandler_registerNotification(BLE_NOTIFY_INFO notifyInfo);
 int bleNotificationHandler_deregisterNotification(uint8_t type);
 int bleNotificationHandler_sendNotification();
+void bleNotificationHandler_resumeScanStream(void);
 int bleNotificationHandler_sendIndication();
 int bleNotificationHandler_updateIndicationInfo(uint8_t type, unsigned int transactionID, int length);
 int bleNotificationHandler_sendErrorIndication(uint32_t field, int16_t code);
+void bleNotificationHandler_getPoolStats(BLE_POOL_STATS *pStats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,61 @@
+/*
+ * BLE block pool header file
+ *
+ * Fixed size blocks for the response and notification lists, taken from
+ * static memory instead of the heap. No Bluetopia or RTOS dependencies, so
+ * a host build can test it.
+ *
+ * Copyright (C) 2014-15 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#ifndef BLEPOOL_H_
+#define BLEPOOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Allocation statistics of a block pool
+ */
+typedef struct _blePoolStats
+{
+	uint32_t	num_alloc;
+	uint32_t	num_free;
+	uint32_t	num_fail;		// allocations refused because all blocks were in use
+	uint32_t	num_bad_free;	// releases ignored: block not in use or not from the pool
+	uint16_t	in_use;
+	uint16_t	in_use_max;		// high-water mark
+	uint16_t	capacity;
+} BLE_POOL_STATS;
+
+/**
+ * @brief Pool of fixed size blocks in static memory; free blocks are chained
+ * through their first word so that allocation is O(1)
+ */
+typedef struct _blePool
+{
+	uint8_t			*pMem;
+	size_t			blockSize;
+	void			*pFree;
+	BLE_POOL_STATS	stats;
+} BLE_POOL;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * BLE fixed size block pool functions
+ */
+void blePoolInit(BLE_POOL *pPool, void *pMem, size_t blockSize, uint16_t numBlocks);
+void blePoolReset(BLE_POOL *pPool);
+void *blePoolAlloc(BLE_POOL *pPool);
+void blePoolFree(BLE_POOL *pPool, void *pBlock);
+void blePoolGetStats(BLE_POOL *pPool, BLE_POOL_STATS *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BLEPOOL_H_ */
@@ -11,6 +11,8 @@
 
 #include "BTBTypes.h"
 #include "uartstdio.h"
+#include "common.h"
+#include "BLEPool.h"
 
 /** @name BLE application error codes
  *
@@ -104,8 +106,12 @@ void bleFree(void *mem, size_t size);
  * BLE - Logging related functions
  */
 void bleFlushLog();
+#ifdef NIRSCAN_BIN_LOG
+#define bleLog(...) BIN_LOG(__VA_ARGS__)
+#else
 #define bleLog(...) UARTprintf(__VA_ARGS__); \
 					bleFlushLog();
+#endif
 void bleLogFuncError(char *Function,int Status);
 
 #ifdef __cplusplus
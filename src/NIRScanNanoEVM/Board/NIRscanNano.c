@@ -60,7 +60,9 @@
 #elif defined(__GNUC__)
 __attribute__ ((aligned (1024)))
 #endif
-static tDMAControlTable NIRscanNano_DMAControlTable[32];
+/* Primary and alternate control structures; the UART command interface
+ * runs its channels in ping-pong mode */
+static tDMAControlTable NIRscanNano_DMAControlTable[64];
 static bool DMA_initialized = false;
 
 /* Hwi_Struct used in the initDMA Hwi_construct call */
@@ -227,6 +227,15 @@ extern void NIRscanNano_initSDSPI(void);
  */
 extern void NIRscanNano_initSPI(void);
 
+/*!
+ *  @brief  Initialize the uDMA controller
+ *
+ *  This function enables the uDMA controller and sets up its control table.
+ *  It may be called by every driver that uses the uDMA; only the first call
+ *  has an effect.
+ */
+extern void NIRscanNano_initDMA(void);
+
 /*!
  *  @brief  Initialize board specific UART settings
  *
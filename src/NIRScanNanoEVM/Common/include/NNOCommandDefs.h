@@ -92,9 +92,38 @@ typedef enum
     NNO_FILE_SCAN_LIST,
     NNO_FILE_SCAN_DATA_FROM_SD,
     NNO_FILE_INTERPRET_DATA,
+    NNO_FILE_SCAN_TRACE,
+    NNO_FILE_SENSOR_LOG,
     NNO_FILE_MAX_TYPES
 } NNO_FILE_TYPE;
 
+/**
+ *  Layouts of the NNO_FILE_INTERPRET_DATA file. NNO_CMD_FILE_GET_READSIZE may
+ *  follow the file type with a format byte: one wavelength encoding ORed with
+ *  one intensity encoding. Without it the file is interleaved: int count, then
+ *  a double wavelength and an int intensity per point.
+ *
+ *  With a format byte the file is a structure of arrays, little endian:
+ *      int             count
+ *      unsigned char   format
+ *      unsigned char   intensity shift; an INT16 intensity is value << shift
+ *      unsigned short  0
+ *      wavelengths     count doubles or floats, or for COEFFS the three double
+ *                      calibration coefficients c0, c1, c2 followed by count
+ *                      shorts giving the DMD column centre x in half columns;
+ *                      wavelength = c2 * (x/2)^2 + c1 * (x/2) + c0
+ *      intensities     count ints, floats or shorts
+ */
+#define NNO_INTERPRET_WL_DOUBLE		0x00
+#define NNO_INTERPRET_WL_FLOAT		0x01
+#define NNO_INTERPRET_WL_COEFFS		0x02
+#define NNO_INTERPRET_WL_MASK		0x0F
+
+#define NNO_INTERPRET_INT_INT32		0x00
+#define NNO_INTERPRET_INT_FLOAT		0x10
+#define NNO_INTERPRET_INT_INT16		0x20
+#define NNO_INTERPRET_INT_MASK		0xF0
+
 /**
  *  Enumeration of actions to perform on file payload to be sent to the EVM
  */
@@ -196,6 +225,23 @@ typedef enum Cmd1Msg
 #define NNO_CMD_SCAN_INTERPRET_GET_STATUS CMD_KEY(0x02, 0x3A, CMD1_READ,  0x01)
 #define NNO_CMD_MODEL_NAME_WRITE        CMD_KEY(0x02 ,0x3B, CMD1_WRITE,	0x10)
 #define NNO_CMD_MODEL_NAME_READ         CMD_KEY(0x02 ,0x3C, CMD1_READ,	0x00)
+#define NNO_CMD_SCAN_STREAM_ENABLE      CMD_KEY(0x02 ,0x3D, CMD1_WRITE,	0x01)
+#define NNO_CMD_SCAN_STREAM_READ        CMD_KEY(0x02 ,0x3E, CMD1_READ,	0x00)
+#define NNO_CMD_SCAN_CONTINUOUS_START   CMD_KEY(0x02 ,0x3F, CMD1_WRITE,	0x03)
+#define NNO_CMD_SCAN_CONTINUOUS_STOP    CMD_KEY(0x02 ,0x40, CMD1_WRITE,	0x00)
+#define NNO_CMD_READ_PGA_STATS          CMD_KEY(0x02 ,0x41, CMD1_READ,	0x00)
+#define NNO_CMD_SCAN_TRACE_CTRL         CMD_KEY(0x02 ,0x42, CMD1_WRITE,	0x04)
+#define NNO_CMD_SNR_SET_WINDOW          CMD_KEY(0x02 ,0x43, CMD1_WRITE,	0x05)
+#define NNO_CMD_SENSOR_SVC_PERIODS      CMD_KEY(0x02 ,0x44, CMD1_WRITE,	0x04)
+#define NNO_CMD_SD_WRITER_STATS         CMD_KEY(0x02 ,0x45, CMD1_READ,	0x00)
+#define NNO_CMD_SD_ARCHIVE_CTRL         CMD_KEY(0x02 ,0x46, CMD1_WRITE,	0x01)
+#define NNO_CMD_SD_SCAN_QUERY           CMD_KEY(0x02 ,0x47, CMD1_READ,	0x0C)
+#define NNO_CMD_FILE_STREAM_DATA        CMD_KEY(0x02 ,0x48, CMD1_READ,	0x00)
+#define NNO_CMD_USB_BULK_STATUS         CMD_KEY(0x02 ,0x49, CMD1_READ,	0x00)
+#define NNO_CMD_FILE_BULK_READ          CMD_KEY(0x02 ,0x4A, CMD1_READ,	0x02)
+#define NNO_CMD_FILE_BULK_WRITE         CMD_KEY(0x02 ,0x4B, CMD1_WRITE,	0x08)
+#define NNO_CMD_USB_BULK_ABORT          CMD_KEY(0x02 ,0x4C, CMD1_WRITE,	0x00)
+#define NNO_CMD_USB_CMD_QUEUE_STATS     CMD_KEY(0x02 ,0x4D, CMD1_READ,	0x00)
 #define NNO_CMD_READ_TEMP   			CMD_KEY(0x03, 0x00, CMD1_READ,	0x00)
 #define NNO_CMD_READ_HUM				CMD_KEY(0x03, 0x02, CMD1_READ,	0x00)
 #define NNO_CMD_SET_DATE_TIME			CMD_KEY(0x03, 0x09, CMD1_WRITE,	0x07)
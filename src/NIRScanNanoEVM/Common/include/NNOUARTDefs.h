@@ -1,6 +1,29 @@
 /*
  * UART related definitions
  *
+ * Commands and responses go over the UART as frames, little endian:
+ *	magic		4 bytes, UART_FRAME_MAGIC
+ *	length		2 bytes, payload bytes
+ *	lengthInv	2 bytes, ~length; a corrupt length is rejected before its
+ *				payload has been waited for
+ *	payload		an nnoMessageStruct cut off after the data in use
+ *	crc			4 bytes, CRC-32 (IEEE 802.3) of the payload
+ * The payload can be as large as a whole nnoMessageStruct, the same command
+ * size as over USB. The bytes of a frame must follow each other within
+ * MAX_TIME_BET_DATA_PACKETS_US. After a bad frame the device ignores the
+ * line until it has been idle for a character time, so a host resynchronises
+ * by pausing before it sends the next frame.
+ *
+ * Hosts written for the earlier framing keep working; the device tells the
+ * two apart by the first bytes and answers in the framing of the command:
+ *	start		4 bytes, "ABCD"
+ *	chkSum		4 bytes, sum of the message bytes
+ *	message		an nnoMessageStruct cut off after the data in use; its
+ *				head.length gives the size
+ *	end			4 bytes, "DCBA"
+ * It has no length check ahead of the message and a weaker checksum, so new
+ * hosts should use the frames above.
+ *
  * Copyright (C) 2015 Texas Instruments Incorporated - http://www.ti.com/
  * ALL RIGHTS RESERVED
  *
@@ -11,6 +34,14 @@
 
 #include "NNOCommandDefs.h"
 
+#define UART_FRAME_MAGIC			0x554F4E4E		/* "NNOU" */
+#define UART_FRAME_HEADER_SIZE		8
+#define UART_FRAME_CRC_SIZE			4
+
+/*
+ * Earlier framing; the start and end take the places of the frame header
+ * magic and the CRC, the checksum that of the length fields
+ */
 #define UART_START_IND_NUM_BYTES 4
 
 #define UART_START_IND_BYTE_0 0x41
@@ -25,24 +56,33 @@
 #define UART_END_IND_BYTE_2 UART_START_IND_BYTE_1
 #define UART_END_IND_BYTE_3 UART_START_IND_BYTE_0
 
-typedef struct _uartMessageStruct
+/* Message bytes ahead of the payload, which hold head.length */
+#define UART_MSG_HEAD_SIZE			(sizeof(nnoMessageStruct) - NNO_DATA_MAX_SIZE)
+
+/*
+ * Frame header, little endian
+ */
+typedef struct _uartFrameHeader
 {
-	unsigned char startInd[UART_START_IND_NUM_BYTES];
-	unsigned int chkSum;
-	nnoMessageStruct msg;
-	unsigned char endInd[UART_END_IND_NUM_BYTES];
-} uartMessageStruct;
+	unsigned int	magic;			/* UART_FRAME_MAGIC                       */
+	unsigned short	length;			/* payload bytes                          */
+	unsigned short	lengthInv;		/* ~length                                */
+} uartFrameHeader;
+
+#define UART_FRAME_MAX_PAYLOAD		sizeof(nnoMessageStruct)
 
 /*
  * Max packet size would be limited by size of message struct
  */
-#define UART_MAX_CMD_MAX_PKT_SZ 			sizeof(uartMessageStruct)
+#define UART_MAX_CMD_MAX_PKT_SZ		(UART_FRAME_HEADER_SIZE + UART_FRAME_MAX_PAYLOAD \
+									 + UART_FRAME_CRC_SIZE)
 
 /*
  * Error codes
  */
-#define UART_INCOMP_START_END_IND_RECD	-1
+#define UART_INPUT_PKT_INCOMPLETE		-1	/* gap in the middle of a frame       */
 #define UART_INPUT_PKT_CHECKSUM_ERROR	-2
 #define UART_WRITE_FAILED				-3
+#define UART_INPUT_PKT_LENGTH_ERROR		-4	/* header or message length invalid   */
 
 #endif /* NNOUARTDEFS_H_ */
@@ -0,0 +1,68 @@
+/*
+ * USB bulk interface related definitions
+ *
+ * Large files go over the vendor specific bulk interface as a single frame:
+ * a 16 byte header followed by the payload. A frame that ends on a packet
+ * boundary is followed by a zero length packet. Transfers are set up and
+ * checked with the HID commands NNO_CMD_USB_BULK_STATUS, NNO_CMD_FILE_BULK_READ
+ * and NNO_CMD_FILE_BULK_WRITE; the tag given in those commands is echoed in
+ * the frame header.
+ *
+ * Copyright (C) 2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#ifndef NNOUSBBULKDEFS_H_
+#define NNOUSBBULKDEFS_H_
+
+#define USB_BULK_PROTO_VERSION		1
+
+#define USB_BULK_FRAME_MAGIC		0x424F4E4E		/* "NNOB" */
+#define USB_BULK_FRAME_HEADER_SIZE	16
+
+/* Full speed bulk endpoints */
+#define USB_BULK_MAX_PKT_SIZE		64
+
+/*
+ * Frame header, little endian
+ */
+typedef struct _usbBulkFrameHeader
+{
+	unsigned int	magic;			/* USB_BULK_FRAME_MAGIC                   */
+	unsigned char	version;		/* USB_BULK_PROTO_VERSION                 */
+	unsigned char	flags;			/* 0                                      */
+	unsigned short	tag;			/* from the command that set up the frame */
+	unsigned int	length;			/* payload bytes                          */
+	unsigned int	crc;			/* CRC-32 (IEEE 802.3) of the payload     */
+} usbBulkFrameHeader;
+
+/*
+ * Transfer state reported by NNO_CMD_USB_BULK_STATUS
+ */
+typedef enum
+{
+	USB_BULK_STATE_OFFLINE,			/* bulk interface not configured          */
+	USB_BULK_STATE_IDLE,
+	USB_BULK_STATE_SENDING,			/* frame going to the host                */
+	USB_BULK_STATE_RECEIVING,		/* waiting for or receiving a frame       */
+	USB_BULK_STATE_DONE,			/* last transfer completed                */
+	USB_BULK_STATE_ERROR			/* last transfer failed, see error code   */
+} USB_BULK_STATE;
+
+/*
+ * Error codes
+ */
+typedef enum
+{
+	USB_BULK_ERR_NONE,
+	USB_BULK_ERR_MAGIC,				/* header magic or version mismatch       */
+	USB_BULK_ERR_TAG,				/* tag differs from the one set up        */
+	USB_BULK_ERR_LENGTH,			/* payload longer than set up             */
+	USB_BULK_ERR_OVERRUN,			/* data past the end of the frame         */
+	USB_BULK_ERR_CRC,
+	USB_BULK_ERR_ABORTED,			/* aborted by the host or disconnected    */
+	USB_BULK_ERR_TX					/* driver refused a packet                */
+} USB_BULK_ERROR;
+
+#endif /* NNOUSBBULKDEFS_H_ */
@@ -20,7 +20,10 @@
 #include "driverlib/sysctl.h"
 #include "inc/tm4c129xnczad.h"
 #include <xdc/runtime/System.h>
+#include <xdc/runtime/Error.h>
 /* TI-RTOS Header files */
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/gates/GateMutex.h>
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/I2C.h>
 
@@ -30,18 +33,78 @@
 #include "nnoStatus.h"
 #include "dlpc150.h"
 
+/* Register write command: address and value, LSB first */
+#define DLPC150_REG_WRITE_CMD(addr, value) \
+	{ 9, { DLPC150_REG_WRITE, (addr) & 0xFF, ((addr) >> 8) & 0xFF, ((addr) >> 16) & 0xFF, ((addr) >> 24) & 0xFF, \
+		(value) & 0xFF, ((value) >> 8) & 0xFF, ((value) >> 16) & 0xFF, ((value) >> 24) & 0xFF } }
+
+/* Red, green and blue LED currents, LSB first */
+#define DLPC150_LED_CURRENTS(red, green, blue) \
+	(red) & 0xFF, ((red) >> 8) & 0xFF, (green) & 0xFF, ((green) >> 8) & 0xFF, (blue) & 0xFF, ((blue) >> 8) & 0xFF
+
+#define DLPC150_DITHER_CTRL_REG		0x400053d0
+#define DLPC150_DITHER_OFF			0xD0
+
+/* Sets up the DLPC150 to display patterns from flash */
+static const DLPC150_CMD dlpc150_flashSourceSetup[] =
+{
+	{ 2, { DLPC150_SYS_W_IN_SOURCE_SEL, INPUT_SOURCE_SPLASH } },
+	{ 1, { DLPC150_FLASH_PATTERN } },
+	DLPC150_REG_WRITE_CMD(DLPC150_DITHER_CTRL_REG, DLPC150_DITHER_OFF)	// Disable dithering on patterns
+};
+
+/* Sets up the DLPC150 to display patterns from the RGB port */
+static const DLPC150_CMD dlpc150_rgbSourceSetup[] =
+{
+	// LSB,MSB  Start Pixel,  Start Line, Pixel/Line, Lines/Frame
+	{ 9, { DLPC150_SYS_W_IMAGE_CROP, 0x00, 0x00, 0x00, 0x00, DMD_WIDTH_LSB, DMD_WIDTH_MSB, DMD_HEIGHT_LSB, DMD_HEIGHT_MSB } },
+	// LSB,MSB  Pixel/Line, Lines/Frame
+	{ 5, { DLPC150_SYS_W_DISPLAY_SIZE, DMD_WIDTH_LSB, DMD_WIDTH_MSB, DMD_HEIGHT_LSB, DMD_HEIGHT_MSB } },
+	// LSB,MSB  Pixel/Line, Lines/Frame
+	{ 5, { DLPC150_SYS_W_EXT_IM_SIZE, DISP_WIDTH_LSB, DISP_WIDTH_MSB, DMD_HEIGHT_LSB, DMD_HEIGHT_MSB } },
+	{ 2, { DLPC150_SYS_W_IN_SOURCE_SEL, INPUT_SOURCE_RGB } },
+#ifdef SIXTEEN_BPP
+	{ 2, { DLPC150_PATTERN_STREAMING, 0 } },	// 16 bit patterns
+#else
+	{ 2, { DLPC150_HWLOCK_MODE, 0 } },		// 24 bit patterns
+#endif
+	DLPC150_REG_WRITE_CMD(DLPC150_DITHER_CTRL_REG, DLPC150_DITHER_OFF)	// Disable dithering on patterns
+};
+
+static const DLPC150_CMD dlpc150_lampOn[] =
+{
+#ifdef FOUR_LAMPS
+	{ 7, { DLPC150_LED_W_MAX_CURRENT, DLPC150_LED_CURRENTS(0, 400, 0) } },
+	{ 7, { DLPC150_LED_W_CURRENT, DLPC150_LED_CURRENTS(0, 377, 0) } },
+#else
+	{ 7, { DLPC150_LED_W_CURRENT, DLPC150_LED_CURRENTS(0, 189, 0) } },
+#endif
+	{ 2, { DLPC150_LED_W_ENABLE, LED_GREEN_ENABLE } }
+};
+
+static const DLPC150_CMD dlpc150_lampOff[] =
+{
+	{ 7, { DLPC150_LED_W_CURRENT, DLPC150_LED_CURRENTS(0, 0, 0) } },
+	{ 2, { DLPC150_LED_W_ENABLE, 0 } }
+};
+
+static I2C_Handle dlpc150Session = NULL;	// handle kept open by dlpc150_OpenSession()
+static uint32_t dlpc150SessionDepth = 0;
+static GateMutex_Handle dlpc150Gate = NULL;	// held by the task that has the session open
+static IArg dlpc150GateKey;
+static volatile bool dlpc150StatusPending = false;	// error reported, short status not read yet
+
+static int16_t dlpc150_GetShortStatus( uint32_t *pStatus );
+
 /**
  *
  *  Initializes I2C2 for DLPC150
  *
  *  Initializes DLPC150 using I2C2 at 100KHz.
- *  Reads Manufacturer ID and Device ID to check if initialization was successful
- *
- *  @param ptnSrc 0 sets up dlpc150 to use splash as the source for patterns and 1 sets up dlpc150 to use patterns from external video input
  *
- *  \return 0 for success, 1 for failure
+ *  \return I2C handle or NULL on failure
  */
-static I2C_Handle dlpc150_open(void)
+static I2C_Handle dlpc150_portOpen(void)
 {
 	I2C_Handle      i2c;
 	I2C_Params      i2cParams;
@@ -58,215 +121,215 @@ static I2C_Handle dlpc150_open(void)
 	return i2c;
 }
 
-static int16_t dlpc150_close(I2C_Handle i2c)
+static void dlpc150_portClose(I2C_Handle i2c)
 {
-	if(i2c != NULL)
-	{
-		I2C_close(i2c);
-		MAP_SysCtlPeripheralDisable(SYSCTL_PERIPH_I2C2);
-		return PASS;
-	}
-	else
-	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		return FAIL;
-	}
+	I2C_close(i2c);
+	MAP_SysCtlPeripheralDisable(SYSCTL_PERIPH_I2C2);
 }
 
-#if 0
-static int16_t dlpc150_SetRGBPatternMode(bool twenty_four_bpp)
+/* A call outside a session runs as a session of its own */
+static I2C_Handle dlpc150_open(void)
 {
-	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[2] = {DLPC150_PATTERN_STREAMING , 0 };
-	int16_t ret_val;
-	I2C_Handle      i2c = dlpc150_open();
-
-	if(twenty_four_bpp == true)
-		cmds[1] = 1;
+	if(dlpc150_OpenSession() != PASS)
+		return NULL;
 
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 2;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
+	return dlpc150Session;
+}
 
-	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
+static int16_t dlpc150_close(I2C_Handle i2c)
+{
+	if(i2c == NULL)
 	{
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
+		return FAIL;
 	}
 
-	dlpc150_close(i2c);
-	return ret_val;
+	return dlpc150_CloseSession();
 }
-#endif
 
-static int16_t dlpc150_SetHWLockMode(void)
+static int16_t dlpc150_writeCmd(I2C_Handle i2c, const uint8_t *pCmd, uint32_t count)
 {
 	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[2] = {DLPC150_HWLOCK_MODE , 0 };
-	int16_t ret_val;
-	I2C_Handle      i2c = dlpc150_open();
 
 	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 2;
+	i2cTransaction.writeBuf = (uint8_t *)pCmd;
+	i2cTransaction.writeCount = count;
 	i2cTransaction.readBuf = NULL;
 	i2cTransaction.readCount = 0;
 
 	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
-	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
-	}
+		return PASS;
 
-	dlpc150_close(i2c);
-	return ret_val;
+	nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
+	return FAIL;
 }
 
-static int16_t dlpc150_SetFlashPatternMode(void)
+/**
+ * Creates the gate that gives one task at a time the DLPC150. Must be called
+ * before the tasks that talk to the DLPC150 start.
+ *
+ *  \return PASS or FAIL
+ */
+int16_t dlpc150_Init(void)
 {
-	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[1] = {DLPC150_FLASH_PATTERN};
-	int16_t ret_val;
-	I2C_Handle      i2c = dlpc150_open();
-
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 1;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
+	Error_Block eb;
 
-	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
-	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
-	}
+	Error_init(&eb);
+	dlpc150Gate = GateMutex_create(NULL, &eb);
+	if(dlpc150Gate == NULL)
+		return FAIL;
 
-	dlpc150_close(i2c);
-	return ret_val;
+	return PASS;
 }
 
-
-static int16_t dlpc150_inputSourceSelect( uint8_t source )
+/**
+ * Opens the I2C port to the DLPC150 and keeps it open until
+ * dlpc150_CloseSession(), so that a series of calls does not set up and tear
+ * down the port around every command. Sessions nest; the port is closed when
+ * the outermost one ends. The session gate is held from the outermost open to
+ * its close, so another task blocks here until the session is over.
+ * A Hwi or Swi cannot wait for the gate and is refused; GPIOQ7IntHandler()
+ * leaves the DLPC150 status to be read by the next session opened.
+ *
+ *  \return PASS or FAIL
+ */
+int16_t dlpc150_OpenSession(void)
 {
-	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[2] = {DLPC150_SYS_W_IN_SOURCE_SEL, source};
-	int16_t ret_val;
-	I2C_Handle      i2c = dlpc150_open();
+	BIOS_ThreadType type = BIOS_getThreadType();
+	uint32_t shortStatus;
+	IArg key = 0;
 
-	cmds[1] = source;
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 2;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
+	if((type == BIOS_ThreadType_Hwi) || (type == BIOS_ThreadType_Swi))
+		return FAIL;
 
-	if (I2C_transfer( i2c, &i2cTransaction))
+	if(dlpc150Gate != NULL)
+		key = GateMutex_enter(dlpc150Gate);
+
+	if(dlpc150SessionDepth > 0)
 	{
-		ret_val =  PASS;
+		/* Already held by this task since the outermost open */
+		if(dlpc150Gate != NULL)
+			GateMutex_leave(dlpc150Gate, key);
+		dlpc150SessionDepth++;
+		return PASS;
 	}
-	else
+
+	dlpc150Session = dlpc150_portOpen();
+	if(dlpc150Session == NULL)
 	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
+		if(dlpc150Gate != NULL)
+			GateMutex_leave(dlpc150Gate, key);
+		return FAIL;
 	}
+	dlpc150GateKey = key;
+	dlpc150SessionDepth++;
 
-	dlpc150_close(i2c);
-	return ret_val;
+	if(dlpc150StatusPending)
+	{
+		dlpc150StatusPending = false;
+		if(dlpc150_GetShortStatus(&shortStatus) == PASS)
+			DEBUG_PRINT(" DLPC150: Short Status  0x%x\n", shortStatus);
+	}
+	return PASS;
 }
 
-static int16_t dlpc150_imageCrop( void )
+/**
+ * Ends a session started with dlpc150_OpenSession().
+ *
+ *  \return PASS or FAIL
+ */
+int16_t dlpc150_CloseSession(void)
 {
+	I2C_Handle i2c = dlpc150Session;
+
+	if(dlpc150SessionDepth == 0)
+		return FAIL;
 
-	/*
-	 * Review comment - SK
-	 * Is there any reason why dlpc150_open() & dlpc150_close() called in everyfunction?
-	 * If BOARD_I2C_DLPC	  NIRscanNano_I2C2 *I2C2* dedicated for DLPC150 communication we don't need it;
-	 * this is unecessary call every time.
-	 * Please remove and provide the reason in the code.
-	 * Same comment applicable every where
-	 */
+	if(--dlpc150SessionDepth > 0)
+		return PASS;
 
+	dlpc150Session = NULL;
+	dlpc150_portClose(i2c);
+	if(dlpc150Gate != NULL)
+		GateMutex_leave(dlpc150Gate, dlpc150GateKey);
+	return PASS;
+}
 
-	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[9] = {DLPC150_SYS_W_IMAGE_CROP, 0x00, 0x00, 0x00, 0x00, DMD_WIDTH_LSB, DMD_WIDTH_MSB, DMD_HEIGHT_LSB, DMD_HEIGHT_MSB };
-	// LSB,MSB  Start Pixel,  Start Line, Pixel/Line, Lines/Frame
-	int16_t ret_val;
+/**
+ * Sends a list of commands to the DLPC150 back to back over one I2C handle.
+ * Each command is its own I2C transaction, as the DLPC150 takes one command
+ * per transaction. Stops at the first command that is not acknowledged.
+ *
+ *  @param pCmds	-I- commands, in the order to send them
+ *  @param num		-I- number of commands
+ *
+ *  \return PASS or FAIL
+ */
+int16_t dlpc150_WriteCmds( const DLPC150_CMD *pCmds, uint32_t num )
+{
+	int16_t ret_val = PASS;
 	I2C_Handle      i2c = dlpc150_open();
+	uint32_t i;
 
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 9;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
+	if(i2c == NULL)
+		return FAIL;
 
-	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
-	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
-	}
+	for(i = 0; (i < num) && (ret_val == PASS); i++)
+		ret_val = dlpc150_writeCmd(i2c, pCmds[i].cmd, pCmds[i].count);
 
 	dlpc150_close(i2c);
 	return ret_val;
 }
 
-static int16_t dlpc150_SetDefaultDisplaySize( void )
+/**
+ * Writes a list of DLPC150 registers back to back over one I2C handle.
+ * This is a TI Internal debug only API, see dlpc150_WriteReg().
+ *
+ *  @param pRegs	-I- addresses and values, in the order to write them
+ *  @param num		-I- number of registers
+ *
+ *  \return PASS or FAIL
+ */
+int16_t dlpc150_WriteRegs( const DLPC150_REG *pRegs, uint32_t num )
 {
-	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[5] = {DLPC150_SYS_W_DISPLAY_SIZE, DMD_WIDTH_LSB, DMD_WIDTH_MSB, DMD_HEIGHT_LSB, DMD_HEIGHT_MSB };
-	// LSB,MSB  Pixel/Line, Lines/Frame
-	int16_t ret_val;
+	uint8_t cmds[9];
+	int16_t ret_val = PASS;
 	I2C_Handle      i2c = dlpc150_open();
+	uint32_t i;
 
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 5;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
+	if(i2c == NULL)
+		return FAIL;
 
-	if (I2C_transfer( i2c, &i2cTransaction))
+	cmds[0] = DLPC150_REG_WRITE;
+	for(i = 0; (i < num) && (ret_val == PASS); i++)
 	{
-		ret_val =  PASS;
-	}
-	else
-	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
+		cmds[1] = pRegs[i].addr;
+		cmds[2] = pRegs[i].addr >> 8;
+		cmds[3] = pRegs[i].addr >> 16;
+		cmds[4] = pRegs[i].addr >> 24;
+		cmds[5] = pRegs[i].value;
+		cmds[6] = pRegs[i].value >> 8;
+		cmds[7] = pRegs[i].value >> 16;
+		cmds[8] = pRegs[i].value >> 24;
+		ret_val = dlpc150_writeCmd(i2c, cmds, sizeof(cmds));
 	}
 
 	dlpc150_close(i2c);
 	return ret_val;
 }
 
-
-static int16_t dlpc150_SetDefaultInputImageSize( void )
+#if defined(SPLASH_VARIABLE_EXP) || defined(TPG)
+static int16_t dlpc150_inputSourceSelect( uint8_t source )
 {
 	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[5] = {DLPC150_SYS_W_EXT_IM_SIZE, DISP_WIDTH_LSB, DISP_WIDTH_MSB, DMD_HEIGHT_LSB, DMD_HEIGHT_MSB };
-	// LSB,MSB  Pixel/Line, Lines/Frame
+	uint8_t cmds[2] = {DLPC150_SYS_W_IN_SOURCE_SEL, source};
 	int16_t ret_val;
 	I2C_Handle      i2c = dlpc150_open();
 
+	cmds[1] = source;
 	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
 	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 5;
+	i2cTransaction.writeCount = 2;
 	i2cTransaction.readBuf = NULL;
 	i2cTransaction.readCount = 0;
 
@@ -283,6 +346,7 @@ static int16_t dlpc150_SetDefaultInputImageSize( void )
 	dlpc150_close(i2c);
 	return ret_val;
 }
+#endif
 
 #ifdef SPLASH_VARIABLE_EXP
 
@@ -442,6 +506,7 @@ int16_t dlpc150_EnableSequencer( bool enable )
  */
 int16_t dlpc150_SetUpSource(bool patterns_from_rgb_port)
 {
+	int16_t ret_val;
 
 #ifdef SPLASH_VARIABLE_EXP
 	dlpc150_inputSourceSelect( INPUT_SOURCE_SPLASH );
@@ -471,131 +536,22 @@ int16_t dlpc150_SetUpSource(bool patterns_from_rgb_port)
 #endif
 
 	if(patterns_from_rgb_port == false)
-	{
-		if( PASS != dlpc150_inputSourceSelect( INPUT_SOURCE_SPLASH ))
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-
-		if(dlpc150_SetFlashPatternMode() != PASS)
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-	}
+		ret_val = dlpc150_WriteCmds(dlpc150_flashSourceSetup,
+				sizeof(dlpc150_flashSourceSetup) / sizeof(dlpc150_flashSourceSetup[0]));
 	else
-	{
-		if(PASS != dlpc150_imageCrop())
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-		if ( dlpc150_SetDefaultDisplaySize() != PASS)
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-		if ( dlpc150_SetDefaultInputImageSize() != PASS)
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-		if ( dlpc150_inputSourceSelect( INPUT_SOURCE_RGB ) )
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-#ifdef SIXTEEN_BPP
-		if(dlpc150_SetRGBPatternMode(false) != PASS) //16 bit patterns
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-#else
-		if(dlpc150_SetHWLockMode() != PASS) //24 bit patterns
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-			return FAIL;
-		}
-#endif
-	}
-	
-	if(PASS != dlpc150_WriteReg(0x400053d0, 0xD0))  // Disable dithering on patterns
-		return FAIL;
-
-	return PASS;
-
-}
-
-static int16_t dlpc150_SetLampCurrent( uint16_t RedCurrent, uint16_t GreenCurrent, uint16_t BlueCurrent )
-{
-	I2C_Transaction   i2cTransaction;
-	uint8_t lampCurrent[7] = {DLPC150_LED_W_CURRENT, 0, 0, 0, 0, 0, 0};
-	int16_t ret_val;
-	I2C_Handle      i2c = dlpc150_open();
-
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = lampCurrent;
-	i2cTransaction.writeCount = 7;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
-
-	lampCurrent[1] = RedCurrent & 0x00FF;
-	lampCurrent[2] = (RedCurrent >> 8) & 0x00FF;
-	lampCurrent[3] = GreenCurrent & 0x00FF;
-	lampCurrent[4] = (GreenCurrent >> 8) & 0x00FF;
-	lampCurrent[5] = BlueCurrent & 0x00FF;
-	lampCurrent[6] = (BlueCurrent >> 8) & 0x00FF;
+		ret_val = dlpc150_WriteCmds(dlpc150_rgbSourceSetup,
+				sizeof(dlpc150_rgbSourceSetup) / sizeof(dlpc150_rgbSourceSetup[0]));
 
-	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
+	if(ret_val != PASS)
 	{
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
+		return FAIL;
 	}
 
-	dlpc150_close(i2c);
-	return ret_val;
-}
-
-#ifdef FOUR_LAMPS
-static int16_t dlpc150_SetMaxCurrent( uint16_t RedCurrent, uint16_t GreenCurrent, uint16_t BlueCurrent )
-{
-	I2C_Transaction   i2cTransaction;
-	uint8_t lampCurrent[7] = {DLPC150_LED_W_MAX_CURRENT, 0, 0, 0, 0, 0, 0};
-	int16_t ret_val;
-	I2C_Handle      i2c = dlpc150_open();
-
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = lampCurrent;
-	i2cTransaction.writeCount = 7;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
-
-	lampCurrent[1] = RedCurrent & 0x00FF;
-	lampCurrent[2] = (RedCurrent >> 8) & 0x00FF;
-	lampCurrent[3] = GreenCurrent & 0x00FF;
-	lampCurrent[4] = (GreenCurrent >> 8) & 0x00FF;
-	lampCurrent[5] = BlueCurrent & 0x00FF;
-	lampCurrent[6] = (BlueCurrent >> 8) & 0x00FF;
-
-	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
-	{
-		ret_val =  FAIL;
-	}
+	return PASS;
 
-	dlpc150_close(i2c);
-	return ret_val;
 }
-#endif
+
 /**
  * Due to some issues found with DLPA2005 driver, it is recommended to call this
  * API only with enable = FALSE while using NIRscan Nano EVM.
@@ -607,54 +563,17 @@ static int16_t dlpc150_SetMaxCurrent( uint16_t RedCurrent, uint16_t GreenCurrent
  */
 int16_t dlpc150_LampEnable( bool enable )
 {
-	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[2] = {DLPC150_LED_W_ENABLE, 0};
 	int16_t ret_val;
-	I2C_Handle i2c;
 
 	if(enable)
-	{
-#ifdef FOUR_LAMPS
-		if(dlpc150_SetMaxCurrent( 0x0, 400, 0x0 ) != PASS)
-			return FAIL;
-		if(dlpc150_SetLampCurrent( 0x0, 377, 0x0 ) != PASS)
-			return FAIL;
-#else
-		if(dlpc150_SetLampCurrent( 0x0, 189, 0x0 ) != PASS)
-			return FAIL;
-#endif
-		cmds[1] = LED_GREEN_ENABLE;
-	}
+		ret_val = dlpc150_WriteCmds(dlpc150_lampOn, sizeof(dlpc150_lampOn) / sizeof(dlpc150_lampOn[0]));
 	else
-	{
-		if(dlpc150_SetLampCurrent( 0x0, 0x0, 0x0 ) != PASS)
-		{
-			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_LAMP_DRIVER_ERROR);
-			return FAIL;
-		}
-	}
+		ret_val = dlpc150_WriteCmds(dlpc150_lampOff, sizeof(dlpc150_lampOff) / sizeof(dlpc150_lampOff[0]));
 
-	i2c = dlpc150_open();
-
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 2;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
-
-	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
-	{
-		ret_val =  FAIL;
+	if(ret_val != PASS)
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_LAMP_DRIVER_ERROR);
-	}
 
-	dlpc150_close(i2c);
 	return ret_val;
-
 }
 
 /**
@@ -668,20 +587,25 @@ int16_t dlpc150_LampEnable( bool enable )
  */
 int16_t dlpc150_displayCrop( uint16_t startY, uint16_t height )
 {
-	uint32_t reg_val;
-	if(PASS != dlpc150_ReadReg(0x40001300, &reg_val))
-		return FAIL;
-	reg_val &= ~1; //Clear bit 0 to set to border insertion mode for pleasing color
-	if(PASS != dlpc150_WriteReg(0x40001300, reg_val))
-		return FAIL;
-	//First display line position
-	if(PASS != dlpc150_WriteReg(0x4000107c, startY))
-		return FAIL;
-	//Total lines to display
-	if(PASS != dlpc150_WriteReg(0x40001074, height))
-		return FAIL;
+	DLPC150_REG regs[3];
+	int16_t ret_val = FAIL;
 
-	return PASS;
+	dlpc150_OpenSession();
+	if(PASS == dlpc150_ReadReg(0x40001300, &regs[0].value))
+	{
+		regs[0].addr = 0x40001300;
+		regs[0].value &= ~1; //Clear bit 0 to set to border insertion mode for pleasing color
+		//First display line position
+		regs[1].addr = 0x4000107c;
+		regs[1].value = startY;
+		//Total lines to display
+		regs[2].addr = 0x40001074;
+		regs[2].value = height;
+		ret_val = dlpc150_WriteRegs(regs, 3);
+	}
+	dlpc150_CloseSession();
+
+	return ret_val;
 }
 
 /**
@@ -696,29 +620,11 @@ int16_t dlpc150_displayCrop( uint16_t startY, uint16_t height )
  */
 int16_t dlpc150_WriteReg( uint32_t addr, uint32_t value )
 {
-	I2C_Transaction   i2cTransaction;
-	uint8_t cmds[9] = {DLPC150_REG_WRITE, addr, addr>>8, addr>>16, addr>>24, value, value>>8, value>>16, value>>24 };
-	int16_t ret_val;
-	I2C_Handle      i2c = dlpc150_open();
-
-	i2cTransaction.slaveAddress = BOARD_DLPC150_ADDR;
-	i2cTransaction.writeBuf = cmds;
-	i2cTransaction.writeCount = 9;
-	i2cTransaction.readBuf = NULL;
-	i2cTransaction.readCount = 0;
+	DLPC150_REG reg;
 
-	if (I2C_transfer( i2c, &i2cTransaction))
-	{
-		ret_val =  PASS;
-	}
-	else
-	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SCAN, true, NNO_ERROR_SCAN_DLPC150_INIT_ERROR);
-		ret_val =  FAIL;
-	}
-
-	dlpc150_close(i2c);
-	return ret_val;
+	reg.addr = addr;
+	reg.value = value;
+	return dlpc150_WriteRegs(&reg, 1);
 }
 
 /**
@@ -926,12 +832,14 @@ static int16_t dlpc150_GetShortStatus( uint32_t *pStatus )
 //*****************************************************************************
 //
 // Called by the NVIC as a result of GPIOQ7 interrupt event. For this
-// application GPIO PQ7 goes high when the DLPC150 reports an error
+// application GPIO PQ7 goes high when the DLPC150 reports an error. The
+// short status is read over I2C by the next task that opens a session, as a
+// Hwi must not use the port a task may be in the middle of a transfer on.
 //
 //*****************************************************************************
 void GPIOQ7IntHandler(void)
 {
-	uint32_t ui32Status, shortStatus;
+	uint32_t ui32Status;
 
 	ui32Status = GPIOIntStatus(GPIO_PORTQ_BASE, true);
 
@@ -945,8 +853,7 @@ void GPIOQ7IntHandler(void)
 		 * We should think about taking *shortStatus* into the "StatusHandler" function.
 		 * On init the statusHandler can know what happend to DLPC150.
 		 */
-		dlpc150_GetShortStatus( &shortStatus );
-		DEBUG_PRINT(" DLPC150: Short Statue  0x%x\n", shortStatus);
+		dlpc150StatusPending = true;
 		if (nnoStatus_setErrorStatusAndCode(NNO_ERROR_HW, true, NNO_ERROR_HW_DLPC150) < 0)
 			DEBUG_PRINT("TIVA error status could not be updated\n");
 	}
@@ -12,10 +12,12 @@
 #include <xdc/std.h>
 #include <xdc/cfg/global.h>
 #include <xdc/runtime/System.h>
+#include <xdc/runtime/Error.h>
 /* BIOS Header files */
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/fatfs/ff.h>
 #include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/gates/GateMutex.h>
 /* TIVA/Driver Header files */
 #include <inc/tm4c129xnczad.h>
 #include "inc/hw_memmap.h"
@@ -33,7 +35,9 @@
 #include "scan.h"
 #include "nano_eeprom.h"
 #include "nnoStatus.h"
+#include "common.h"
 #include "fatsd.h"
+#include "sdArchive.h"
 
 /* String conversion macro */
 #define STR_(n)             #n
@@ -48,17 +52,32 @@
 static const char  inputfile[] = STR(DRIVE_NUM)":\\input.txt";
 static const char outputfile[] = STR(DRIVE_NUM)":\\output.txt";
 static bool card_detected = false;
+#ifndef NIRSCAN_SD_ARCHIVE
 static int running_file_num = 0;
+#endif
 static const char driveNum[] = STR(DRIVE_NUM);
 static char scanFilePath[50];
 extern uint8_t g_dataBlob[];
 static char directory_name[8];
+static bool directory_ready = false;	/* serial number directory known to exist */
 static bool skip_eeprom_cfg = false;
+#ifdef NIRSCAN_SD_ARCHIVE
+static int legacy_num = -1;				/* per-file scans, -1 until listed */
+#endif
 
 unsigned int g_scanIndices[NUM_SCAN_DATA_INDEX];
 
 static FATFS FatFs;   /* Work area (file system object) for logical drive */
 
+/*
+ * FatFs is not reentrant and the card is used by the SD writer task as well
+ * as the USB, UART and BLE command paths, so every FATSD_ entry point holds
+ * this gate while it touches the card or the scan index list. A GateMutex
+ * may be entered again by the task that holds it, so entry points can call
+ * each other.
+ */
+static GateMutex_Handle fatsdGate = NULL;
+
 const char textarray[] = \
 "***********************************************************************\n"
 "0         1         2         3         4         5         6         7\n"
@@ -76,6 +95,10 @@ void HandleSDCardDetectInterrupt()
 
 	//Toggle card detect status
 	card_detected = ~card_detected;
+	directory_ready = false;
+#ifdef NIRSCAN_SD_ARCHIVE
+	legacy_num = -1;
+#endif
 
 	nnoStatus_setDeviceStatus(NNO_STATUS_SD_CARD_PRESENT,card_detected);
 #endif
@@ -169,6 +192,10 @@ FRESULT FATSD_CreateDirectory(void)
  * This API creates the directory in SD card with device serial number as
  * name if it does not exist already.
  *
+ * Once the directory is known to exist further calls return without
+ * touching the card, so back to back scan writes only update the FAT and
+ * the entry of the new file.
+ *
  * @return FR_INVALID_NAME = Error if serial number is not valid
  *         FR_OK           = Direcory created successfully
  *         FR_EXIST        = Directory already exists
@@ -177,6 +204,9 @@ FRESULT FATSD_CreateDirectory(void)
     FRESULT fr;
     char serial_number[8];
 
+    if (directory_ready)
+    	return FR_EXIST;
+
     if ( Nano_eeprom_GetDeviceSerialNumber((uint8_t*)serial_number) == PASS )
     {
 		fr = f_mkdir(serial_number);
@@ -189,6 +219,8 @@ FRESULT FATSD_CreateDirectory(void)
 				nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fr);
 				DEBUG_PRINT("\r\nChange directory permission fialed, error:%d\r\n",fr);
 			}
+			else
+				directory_ready = true;
 		}
 
 		return fr;
@@ -200,17 +232,91 @@ FRESULT FATSD_CreateDirectory(void)
 	}
 }
 
-FRESULT FATSD_FindListScanIndex(int* length)
+#ifdef NIRSCAN_SD_ARCHIVE
+static FRESULT FATSD_OpenArchive(void)
 /**
- * This API reads all the filenames in the directory named as device serial number.
- * filenames are used to extract scan data index already stored. It also counts the
- * number of files already stored.
+ * Opens the scan archive in the serial number directory unless it is open
+ * already. A card detect change forces a reopen.
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+    FRESULT fr;
+    char path[25];
+
+    if (directory_ready && SDArchive_IsOpen())
+    	return FR_OK;
+
+    fr = FATSD_CreateDirectory();
+    if ((fr != FR_OK) && (fr != FR_EXIST))
+    	return fr;
+
+    strcpy(path, driveNum);
+    strcat(path, ":");
+    strcat(path, "/");
+    strcat(path, directory_name);
+
+    return SDArchive_Open(path);
+}
+
+static bool FATSD_FindSkipCfgFile(void)
+/**
+ * Looks up the SKIP_CFG marker in the serial number directory by name, so
+ * that boot does not have to list the directory.
+ *
+ * @return true if the marker file exists
+ */
+{
+    static const char * const names[] = { "SKIP_CFG", "SKIP_CFG.TXT" };
+    FILINFO fno;
+    char path[40];
+    int i;
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+    	strcpy(path, driveNum);
+    	strcat(path, ":");
+    	strcat(path, "/");
+    	strcat(path, directory_name);
+    	strcat(path, "/");
+    	strcat(path, names[i]);
+    	if (f_stat(path, &fno) == FR_OK)
+    		return true;
+    }
+    return false;
+}
+
+static FRESULT FATSD_GetLastScanIndex(uint32_t *pIndex)
+/**
+ * Returns the index of the last stored scan: the newest one in the scan
+ * archive, or the last per-file scan when the archive is empty.
  *
- * @param  length -O- Number of files already stored in the directory
+ * @param  pIndex -O- scan data index
  *
- * @return FR_INVALID_NAME = Error if serial number is not valid
- *         FR_NOT_READY    = Error if card not detected.
+ * @return FR_NO_FILE if no scan is stored, otherwise FRESULT
  */
+{
+    FRESULT fr;
+    int num;
+
+    fr = FATSD_OpenArchive();
+    if ((fr == FR_OK) && SDArchive_GetLastIndex(pIndex))
+    	return FR_OK;
+
+    fr = FATSD_FindListScanIndex(&num);
+    if (fr != FR_OK)
+    	return fr;
+    if (legacy_num <= 0)
+    	return FR_NO_FILE;
+
+    *pIndex = g_scanIndices[legacy_num - 1];
+    return FR_OK;
+}
+#endif
+
+static FRESULT FATSD_FindListScanIndexLocked(int* length)
+/* FATSD_FindListScanIndex() with fatsdGate held */
 {
     FRESULT res;
     FILINFO fno;
@@ -218,6 +324,13 @@ FRESULT FATSD_FindListScanIndex(int* length)
     int i = 0;
     int cnt = 0;
     unsigned int val;
+#ifdef NIRSCAN_SD_ARCHIVE
+    int j;
+    SD_ARCHIVE_ENTRY entries[8];
+    SD_ARCHIVE_INFO info;
+    uint32_t pos;
+    uint32_t num;
+#endif
 
     char path[25];
     char index_str[8];
@@ -233,6 +346,7 @@ FRESULT FATSD_FindListScanIndex(int* length)
     res = f_opendir(&dir, path);                       /* Open the directory */
     if (res == FR_NO_PATH)
     {
+    	directory_ready = false;
     	res = FATSD_CreateDirectory();
     	if (res== FR_OK)
     	{
@@ -299,10 +413,61 @@ FRESULT FATSD_FindListScanIndex(int* length)
     else
     	nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, res);
 
+#ifdef NIRSCAN_SD_ARCHIVE
+    if ((res == FR_OK) && (FATSD_OpenArchive() == FR_OK))
+    {
+    	/* Scans exported from the archive to per-file are listed once */
+    	for (i = 0, j = 0; i < cnt; i++)
+    	{
+    		if (!SDArchive_Contains(g_scanIndices[i]))
+    			g_scanIndices[j++] = g_scanIndices[i];
+    	}
+    	legacy_num = j;
+
+    	SDArchive_GetInfo(&info);
+    	pos = 0;
+    	if (info.num_positions > NUM_SCAN_DATA_INDEX - j)
+    		pos = info.num_positions - (NUM_SCAN_DATA_INDEX - j);
+    	cnt = j;
+    	while ((pos < info.num_positions) && (cnt < NUM_SCAN_DATA_INDEX))
+    	{
+    		if (SDArchive_Query(&pos, 0, entries, sizeof(entries) / sizeof(entries[0]), &num) != FR_OK)
+    			break;
+    		for (i = 0; (i < num) && (cnt < NUM_SCAN_DATA_INDEX); i++)
+    			g_scanIndices[cnt++] = entries[i].index;
+    	}
+    }
+#endif
+
     *length = cnt;
 
     return res;
 }
+
+FRESULT FATSD_FindListScanIndex(int* length)
+/**
+ * This API reads all the filenames in the directory named as device serial number.
+ * filenames are used to extract scan data index already stored. It also counts the
+ * number of files already stored. With NIRSCAN_SD_ARCHIVE the list continues
+ * with the newest scans in the archive that still fit in g_scanIndices; use
+ * FATSD_QueryScans() to go through all of them.
+ *
+ * @param  length -O- Number of scan indices in g_scanIndices
+ *
+ * @return FR_INVALID_NAME = Error if serial number is not valid
+ *         FR_NOT_READY    = Error if card not detected.
+ */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_FindListScanIndexLocked(length);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+#ifndef NIRSCAN_SD_ARCHIVE
 static int FATSD_FindNumScanFiles(void)
 /**
  * This API returns the number of files already stored in the directory
@@ -327,6 +492,7 @@ static int FATSD_FindNumScanFiles(void)
 
 	return num;
 }
+#endif
 
 FRESULT FATSD_Init(void)
 /**
@@ -343,9 +509,17 @@ FRESULT FATSD_Init(void)
 	SDSPI_Params sdspiParams;
 	char serial_number[8];
 	FRESULT result;
+	Error_Block eb;
 #ifndef HW_SD_CARD_DETECT
 	FIL src;
 #endif
+
+	/* Runs before the tasks that use the card are started */
+	Error_init(&eb);
+	fatsdGate = GateMutex_create(NULL, &eb);
+	if (fatsdGate == NULL)
+		return FR_INT_ERR;
+
 	// Clear card detect interrupts to start with
 	MAP_GPIOIntClear(GPIO_PORTQ_BASE, GPIO_INT_PIN_4);
 	MAP_IntPendClear(INT_GPIOQ4);
@@ -399,11 +573,26 @@ FRESULT FATSD_Init(void)
 	{
 		strcpy(directory_name , serial_number);
 
+#ifdef NIRSCAN_SD_ARCHIVE
+		/*
+		 * Opening the archive reads the index header only, so boot does not
+		 * depend on the number of scans. Per-file scans stored before the
+		 * archive are listed when they are first asked for.
+		 */
+		if(nnoStatus_getIndDeviceStatus(NNO_STATUS_SD_CARD_PRESENT) == false)
+			return FR_NOT_READY;
+		skip_eeprom_cfg = FATSD_FindSkipCfgFile();
+		result = FATSD_OpenArchive();
+		if(result != FR_OK)
+			nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, result);
+		return result;
+#else
 		running_file_num = FATSD_FindNumScanFiles();
 		if(running_file_num >= 0)
 			return FR_OK;
 		else
 			return FR_NOT_READY;
+#endif
 	}
 	else
 	{
@@ -414,20 +603,8 @@ FRESULT FATSD_Init(void)
 
 }
 
-int FATSD_Test( void )
-/*
- *  perform a file copy
- *
- *  tries to open an existing file inputfile[]. If the file doesn't
- *  exist, create one and write some known content into it.
- *  The contents of the inputfile[] are then copied to an output file
- *  outputfile[]. Once completed, the contents of the output file are
- *  printed onto the system console (stdout).
- *
- *  Task for this function is created statically. See the project's .cfg file.
- *
- *  @return None
- */
+static int FATSD_TestLocked(void)
+/* FATSD_Test() with fatsdGate held */
 {
 	int fresult;
 	/* Variables to keep track of the file copy progress */
@@ -542,43 +719,111 @@ int FATSD_Test( void )
 
 }
 
-int FATSD_GetNumScanFiles(void)
-/**
- * This API returns the scan data index array counter
+int FATSD_Test(void)
+/*
+ *  perform a file copy
  *
- * @return counter value
+ *  tries to open an existing file inputfile[]. If the file doesn't
+ *  exist, create one and write some known content into it.
+ *  The contents of the inputfile[] are then copied to an output file
+ *  outputfile[]. Once completed, the contents of the output file are
+ *  printed onto the system console (stdout).
+ *
+ *  Task for this function is created statically. See the project's .cfg file.
+ *
+ *  @return None
  */
+{
+	int result;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	result = FATSD_TestLocked();
+	GateMutex_leave(fatsdGate, key);
 
+	return result;
+}
+
+static int FATSD_GetNumScanFilesLocked(void)
+/* FATSD_GetNumScanFiles() with fatsdGate held */
 {
+#ifdef NIRSCAN_SD_ARCHIVE
+	SD_ARCHIVE_INFO info;
+	int num;
+
+	if(nnoStatus_getIndDeviceStatus(NNO_STATUS_SD_CARD_PRESENT) == false)
+		return (FAIL);
+
+	if (legacy_num < 0)
+		FATSD_FindListScanIndex(&num);
+	if (FATSD_OpenArchive() != FR_OK)
+		return (FAIL);
+
+	SDArchive_GetInfo(&info);
+	return ((legacy_num > 0) ? legacy_num : 0) + info.num_records;
+#else
 	return running_file_num;
+#endif
 }
 
-FRESULT FATSD_ReadLastStoredScanFile( void *pBuf, uint32_t *pBufLen )
+int FATSD_GetNumScanFiles(void)
 /**
- * This API reads last stored scan data in memory buffer. This can be used
- * to store and retrive scan data in SD card in stack like manner.
+ * This API returns the scan data index array counter. With NIRSCAN_SD_ARCHIVE
+ * it returns the number of scans in the archive index plus the per-file ones.
  *
- * @param  pBuf   -I- pointer to memory buffer
- * @param  pBufLen -O- length of file read
- *
- * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
- *                   return codes.
+ * @return counter value
  */
 {
+	int num;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	num = FATSD_GetNumScanFilesLocked();
+	GateMutex_leave(fatsdGate, key);
+
+	return num;
+}
+
+static FRESULT FATSD_ReadLastStoredScanFileLocked(void *pBuf, uint32_t *pBufLen)
+/* FATSD_ReadLastStoredScanFile() with fatsdGate held */
+{
+#ifdef NIRSCAN_SD_ARCHIVE
+	uint32_t index;
+	FRESULT fresult;
+
+	fresult = FATSD_GetLastScanIndex(&index);
+	if (fresult != FR_OK)
+		return fresult;
+	return (FATSD_ReadScanFile(index, pBuf, pBufLen));
+#else
 	return (FATSD_ReadScanFile(g_scanIndices[running_file_num-1], pBuf, pBufLen));
+#endif
 }
 
-FRESULT FATSD_ReadScanFile(uint32_t index, void *pBuf, uint32_t *pBufLen)
+FRESULT FATSD_ReadLastStoredScanFile(void *pBuf, uint32_t *pBufLen)
 /**
- * This API reads scan data index file stored in SD card.
+ * This API reads last stored scan data in memory buffer. This can be used
+ * to store and retrive scan data in SD card in stack like manner.
  *
- * @param  index   -I- the scan data index need to be read
  * @param  pBuf   -I- pointer to memory buffer
  * @param  pBufLen -O- length of file read
  *
  * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
  *                   return codes.
  */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_ReadLastStoredScanFileLocked(pBuf, pBufLen);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+static FRESULT FATSD_ReadScanFileLocked(uint32_t index, void *pBuf, uint32_t *pBufLen)
+/* FATSD_ReadScanFile() with fatsdGate held */
 {
     FRESULT fresult;
 	FIL src;
@@ -589,6 +834,20 @@ FRESULT FATSD_ReadScanFile(uint32_t index, void *pBuf, uint32_t *pBufLen)
 		return FR_NOT_READY;
 	}
 
+#ifdef NIRSCAN_SD_ARCHIVE
+	if (FATSD_OpenArchive() == FR_OK)
+	{
+		fresult = SDArchive_Read(index, pBuf, SCAN_DATA_BLOB_SIZE, pBufLen);
+		/* Not in the archive: may be a per-file scan stored before it */
+		if (fresult != FR_NO_FILE)
+		{
+			if (fresult != FR_OK)
+				nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fresult);
+			return fresult;
+		}
+	}
+#endif
+
 	fresult = f_open(&src, FATSD_GetScanFileName(index), FA_READ);
 	if (fresult != FR_OK)
    	{
@@ -598,6 +857,7 @@ FRESULT FATSD_ReadScanFile(uint32_t index, void *pBuf, uint32_t *pBufLen)
 
 	/* Read from output file */
 	fresult = f_read(&src, pBuf, SCAN_DATA_BLOB_SIZE, pBufLen);
+	f_close(&src);
 	if ((fresult != FR_OK) || *pBufLen == 0)
 	{
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fresult);
@@ -607,9 +867,81 @@ FRESULT FATSD_ReadScanFile(uint32_t index, void *pBuf, uint32_t *pBufLen)
 	return fresult;
 }
 
-FRESULT FATSD_WriteScanFile( void *pBuf, int bufLen , unsigned int index )
+FRESULT FATSD_ReadScanFile(uint32_t index, void *pBuf, uint32_t *pBufLen)
 /**
- * This API writes scan data index file to SD card.
+ * This API reads scan data index file stored in SD card.
+ *
+ * @param  index   -I- the scan data index need to be read
+ * @param  pBuf   -I- pointer to memory buffer
+ * @param  pBufLen -O- length of file read
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_ReadScanFileLocked(index, pBuf, pBufLen);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+static FRESULT FATSD_GetScanFileSizeLocked(uint32_t index, uint32_t *pSize)
+/* FATSD_GetScanFileSize() with fatsdGate held */
+{
+	FRESULT fresult;
+	FILINFO info;
+
+	if(card_detected == false)
+		return FR_NOT_READY;
+
+#ifdef NIRSCAN_SD_ARCHIVE
+	if (FATSD_OpenArchive() == FR_OK)
+	{
+		fresult = SDArchive_GetLength(index, pSize);
+		/* Not in the archive: may be a per-file scan stored before it */
+		if (fresult != FR_NO_FILE)
+			return fresult;
+	}
+#endif
+
+	fresult = f_stat(FATSD_GetScanFileName(index), &info);
+	if (fresult != FR_OK)
+		return fresult;
+
+	*pSize = MIN(info.fsize, SCAN_DATA_BLOB_SIZE);
+	return FR_OK;
+}
+
+FRESULT FATSD_GetScanFileSize(uint32_t index, uint32_t *pSize)
+/**
+ * This API gives the number of bytes FATSD_ReadScanFile() returns for a scan
+ * without reading it.
+ *
+ * @param  index -I- the scan data index
+ * @param  pSize -O- stored length of the scan
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_GetScanFileSizeLocked(index, pSize);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+static FRESULT FATSD_WriteLegacyScanFile( void *pBuf, int bufLen , unsigned int index )
+/**
+ * This API writes scan data to its own <index>.DAT file in the serial number
+ * directory.
  *
  * @param  pBuf   -I- pointer to memory buffer
  * @param  bufLen -I- length of file read
@@ -620,15 +952,10 @@ FRESULT FATSD_WriteScanFile( void *pBuf, int bufLen , unsigned int index )
  */
 {
     FRESULT fresult = FR_OK;
+    FRESULT closeresult;
     unsigned int bytesWritten = 0;
 	FIL dst;
 
-	if(card_detected == false)
-	{
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, FR_NOT_READY);
-		return FR_NOT_READY;
-	}
-
 	/* Create the Directory with name as serial number */
     fresult = FATSD_CreateDirectory();
 	if ((fresult != FR_OK) && (fresult != FR_EXIST))
@@ -640,6 +967,13 @@ FRESULT FATSD_WriteScanFile( void *pBuf, int bufLen , unsigned int index )
 
 	/* Open file for both reading and writing */
 	fresult = f_open(&dst, FATSD_GetScanFileName(index), FA_CREATE_ALWAYS|FA_READ|FA_WRITE);
+	if (fresult == FR_NO_PATH)
+	{
+		/* Directory removed behind our back, e.g. card swapped without detect */
+		directory_ready = false;
+		FATSD_CreateDirectory();
+		fresult = f_open(&dst, FATSD_GetScanFileName(index), FA_CREATE_ALWAYS|FA_READ|FA_WRITE);
+	}
 	if (fresult != FR_OK)
 	{
 		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fresult);
@@ -648,22 +982,71 @@ FRESULT FATSD_WriteScanFile( void *pBuf, int bufLen , unsigned int index )
 	}
 
 	fresult = f_write(&dst, pBuf, bufLen, &bytesWritten);
-	f_sync(&dst);
-	f_close(&dst);
+	/* f_close() flushes the file and updates its directory entry */
+	closeresult = f_close(&dst);
+	if (fresult == FR_OK)
+		fresult = closeresult;
 
-	g_scanIndices[running_file_num] = index;
-	running_file_num++;
+	return fresult;
+}
+
+static FRESULT FATSD_WriteScanFileLocked(void *pBuf, int bufLen, unsigned int index, uint16_t config_id)
+/* FATSD_WriteScanFile() with fatsdGate held */
+{
+    FRESULT fresult = FR_OK;
+
+	if(card_detected == false)
+	{
+		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, FR_NOT_READY);
+		return FR_NOT_READY;
+	}
+
+#ifdef NIRSCAN_SD_ARCHIVE
+	fresult = FATSD_OpenArchive();
+	if (fresult == FR_OK)
+		fresult = SDArchive_Append(pBuf, bufLen, index, config_id);
+	if (fresult != FR_OK)
+		nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fresult);
+#else
+	fresult = FATSD_WriteLegacyScanFile(pBuf, bufLen, index);
+
+	if (running_file_num < NUM_SCAN_DATA_INDEX)
+	{
+		g_scanIndices[running_file_num] = index;
+		running_file_num++;
+	}
+#endif
 
 	return fresult;
 }
 
-FRESULT FATSD_WriteReferenceFile()
+FRESULT FATSD_WriteScanFile(void *pBuf, int bufLen, unsigned int index, uint16_t config_id)
 /**
- * This API writes scan data index file to SD card.
+ * This API writes scan data index file to SD card. With NIRSCAN_SD_ARCHIVE
+ * the scan is appended to the scan archive instead and its index entry
+ * records the configuration it was taken with.
+ *
+ * @param  pBuf      -I- pointer to memory buffer
+ * @param  bufLen    -I- length of file read
+ * @param  index     -I- the scan data index need to be read
+ * @param  config_id -I- scanConfigIndex of the scan
  *
  * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
  *                   return codes.
  */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_WriteScanFileLocked(pBuf, bufLen, index, config_id);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+static FRESULT FATSD_WriteReferenceFileLocked(void)
+/* FATSD_WriteReferenceFile() with fatsdGate held */
 {
     FRESULT fresult = FR_OK;
     unsigned int bytesWritten = 0;
@@ -715,37 +1098,86 @@ FRESULT FATSD_WriteReferenceFile()
 	return fresult;
 }
 
-
-FRESULT FATSD_DeleteLastScanFile( void )
+FRESULT FATSD_WriteReferenceFile(void)
 /**
- * This API deletes last stored scan data in SD card.
+ * This API writes scan data index file to SD card.
  *
  * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
  *                   return codes.
  */
 {
-	FRESULT ret_val = (FATSD_DeleteScanFile(g_scanIndices[running_file_num-1]));
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_WriteReferenceFileLocked();
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+
+static FRESULT FATSD_DeleteLastScanFileLocked(void)
+/* FATSD_DeleteLastScanFile() with fatsdGate held */
+{
+	FRESULT ret_val;
+#ifdef NIRSCAN_SD_ARCHIVE
+	uint32_t index;
+
+	ret_val = FATSD_GetLastScanIndex(&index);
+	if (ret_val == FR_OK)
+		ret_val = FATSD_DeleteScanFile(index);
+#else
+	ret_val = (FATSD_DeleteScanFile(g_scanIndices[running_file_num-1]));
 
 	if(ret_val == FR_OK)
 		running_file_num--;
+#endif
 
 	return (ret_val);
 }
 
-FRESULT FATSD_DeleteScanFile(unsigned int index)
+FRESULT FATSD_DeleteLastScanFile(void)
 /**
- * This API deletes  stored scan data with input index.
- *
- * @param  index -I- index of the scan data to be deleted
+ * This API deletes last stored scan data in SD card.
  *
  * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
  *                   return codes.
  */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_DeleteLastScanFileLocked();
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+static FRESULT FATSD_DeleteScanFileLocked(unsigned int index)
+/* FATSD_DeleteScanFile() with fatsdGate held */
 {
     FRESULT fresult;
     int i = 0;
 
+#ifdef NIRSCAN_SD_ARCHIVE
+	if ((FATSD_OpenArchive() == FR_OK) && SDArchive_Contains(index))
+	{
+		fresult = SDArchive_Delete(index);
+		/* Also remove a per-file copy exported earlier */
+		if (fresult == FR_OK)
+			f_unlink(FATSD_GetScanFileName(index));
+	}
+	else
+	{
+		fresult = f_unlink(FATSD_GetScanFileName(index));
+		if ((fresult == FR_OK) && (legacy_num > 0))
+			legacy_num--;
+	}
+#else
 	fresult = f_unlink(FATSD_GetScanFileName(index));
+#endif
 
 	if(fresult == FR_OK)
 	{
@@ -766,6 +1198,186 @@ FRESULT FATSD_DeleteScanFile(unsigned int index)
 	return fresult;
 }
 
+FRESULT FATSD_DeleteScanFile(unsigned int index)
+/**
+ * This API deletes  stored scan data with input index.
+ *
+ * @param  index -I- index of the scan data to be deleted
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_DeleteScanFileLocked(index);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+#ifdef NIRSCAN_SD_ARCHIVE
+static FRESULT FATSD_CompactArchiveLocked(void *pBuf, uint32_t buf_size)
+/* FATSD_CompactArchive() with fatsdGate held */
+{
+    FRESULT fresult;
+
+    if(card_detected == false)
+    	return FR_NOT_READY;
+
+    fresult = FATSD_OpenArchive();
+    if (fresult == FR_OK)
+    	fresult = SDArchive_Compact(pBuf, buf_size);
+    if (fresult != FR_OK)
+    	nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fresult);
+
+    return fresult;
+}
+
+FRESULT FATSD_CompactArchive(void *pBuf, uint32_t buf_size)
+/**
+ * This API reclaims the space of deleted scans in the scan archive.
+ *
+ * @param  pBuf     -I- scratch buffer, must hold the largest scan
+ * @param  buf_size -I- size of pBuf
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_CompactArchiveLocked(pBuf, buf_size);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+static FRESULT FATSD_ExportArchiveLocked(void *pBuf, uint32_t buf_size)
+/* FATSD_ExportArchive() with fatsdGate held */
+{
+    FRESULT fresult;
+    SD_ARCHIVE_ENTRY entries[8];
+    SD_ARCHIVE_INFO info;
+    uint32_t pos = 0;
+    uint32_t num;
+    uint32_t len;
+    uint32_t i;
+
+    if(card_detected == false)
+    	return FR_NOT_READY;
+
+    fresult = FATSD_OpenArchive();
+    if (fresult == FR_OK)
+    	SDArchive_GetInfo(&info);
+    while ((fresult == FR_OK) && (pos < info.num_positions))
+    {
+    	fresult = SDArchive_Query(&pos, 0, entries, sizeof(entries) / sizeof(entries[0]), &num);
+    	for (i = 0; (i < num) && (fresult == FR_OK); i++)
+    	{
+    		fresult = SDArchive_Read(entries[i].index, pBuf, buf_size, &len);
+    		if (fresult == FR_OK)
+    			fresult = FATSD_WriteLegacyScanFile(pBuf, len, entries[i].index);
+    	}
+    }
+
+    if (fresult != FR_OK)
+    	nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fresult);
+
+    return fresult;
+}
+
+FRESULT FATSD_ExportArchive(void *pBuf, uint32_t buf_size)
+/**
+ * This API writes every scan in the scan archive to its own <index>.DAT file
+ * as without NIRSCAN_SD_ARCHIVE, for tools that expect that layout. The
+ * archive itself is left as is.
+ *
+ * @param  pBuf     -I- scratch buffer, must hold the largest scan
+ * @param  buf_size -I- size of pBuf
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_ExportArchiveLocked(pBuf, buf_size);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+
+static FRESULT FATSD_QueryScansLocked(uint32_t min_index, uint32_t min_timestamp, uint32_t *pCursor,
+		SD_ARCHIVE_ENTRY *pEntries, uint32_t max_num, uint32_t *pNum)
+/* FATSD_QueryScans() with fatsdGate held */
+{
+    FRESULT fresult;
+    SD_ARCHIVE_INFO info;
+
+    *pNum = 0;
+    if(card_detected == false)
+    	return FR_NOT_READY;
+    if(*pCursor == FATSD_QUERY_END)
+    	return FR_OK;
+
+    fresult = FATSD_OpenArchive();
+    if ((fresult == FR_OK) && (*pCursor == FATSD_QUERY_START))
+    	fresult = SDArchive_FindPosition(min_index, pCursor);
+    if (fresult == FR_OK)
+    	fresult = SDArchive_Query(pCursor, min_timestamp, pEntries, max_num, pNum);
+
+    if (fresult != FR_OK)
+    {
+    	nnoStatus_setErrorStatusAndCode(NNO_ERROR_SD_CARD, true, fresult);
+    	return fresult;
+    }
+
+    SDArchive_GetInfo(&info);
+    if (*pCursor >= info.num_positions)
+    	*pCursor = FATSD_QUERY_END;
+
+    return FR_OK;
+}
+
+FRESULT FATSD_QueryScans(uint32_t min_index, uint32_t min_timestamp, uint32_t *pCursor,
+		SD_ARCHIVE_ENTRY *pEntries, uint32_t max_num, uint32_t *pNum)
+/**
+ * This API lists the archived scans with a scan data index of at least
+ * min_index that were stored at or after min_timestamp, in ascending index
+ * order. Start with *pCursor = FATSD_QUERY_START and call again with the
+ * returned cursor until it is FATSD_QUERY_END; a call may return no entries
+ * before the end. Compacting the archive invalidates the cursor. Per-file
+ * scans stored before the archive are not included.
+ *
+ * @param  min_index     -I-  lowest scan data index to list
+ * @param  min_timestamp -I-  FatFs time stamp, 0 for any time
+ * @param  pCursor       -IO- query position
+ * @param  pEntries      -O-  matching index entries
+ * @param  max_num       -I-  number of entries pEntries can hold
+ * @param  pNum          -O-  number of entries returned
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fresult;
+	IArg key;
+
+	key = GateMutex_enter(fatsdGate);
+	fresult = FATSD_QueryScansLocked(min_index, min_timestamp, pCursor, pEntries, max_num, pNum);
+	GateMutex_leave(fatsdGate, key);
+
+	return fresult;
+}
+#endif
+
 bool FATSD_SkipEEPROMCfg(void)
 {
 	return skip_eeprom_cfg;
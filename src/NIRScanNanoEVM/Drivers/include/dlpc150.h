@@ -127,10 +127,32 @@
 #define PATTERNS_FROM_FLASH		0
 #define PATTERNS_FROM_RGB_PORT	1
 
+// Longest DLPC150 command sent, opcode included
+#define DLPC150_MAX_CMD_SIZE	9
+
+// A DLPC150 command: opcode followed by its parameters
+typedef struct
+{
+	uint8_t count;							// bytes in cmd
+	uint8_t cmd[DLPC150_MAX_CMD_SIZE];
+} DLPC150_CMD;
+
+// A DLPC150 register and the value to write to it
+typedef struct
+{
+	uint32_t addr;
+	uint32_t value;
+} DLPC150_REG;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+int16_t dlpc150_Init( void );
+int16_t dlpc150_OpenSession( void );
+int16_t dlpc150_CloseSession( void );
+int16_t dlpc150_WriteCmds( const DLPC150_CMD *pCmds, uint32_t num );
+int16_t dlpc150_WriteRegs( const DLPC150_REG *pRegs, uint32_t num );
 int16_t dlpc150_SetUpSource(bool patterns_from_rgb_port );
 int16_t dlpc150_GetSoftwareVersion( uint32_t *pVer );
 int16_t dlpc150_GetFlashBuildVersion( uint32_t *pVer );
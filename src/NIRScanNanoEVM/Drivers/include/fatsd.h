@@ -7,6 +7,7 @@
 #ifndef _FATSD_H
 #define _FATSD_H
 #include <ti/sysbios/fatfs/ff.h>
+#include "sdArchive.h"
 
 // error codes
 #define	SDCARD_ERROR_OK 					0	/* (0) Succeeded */
@@ -31,21 +32,34 @@
 #define SDCARD_ERROR_WRITE_READ_ERROR		19
 #define NUM_SCAN_DATA_INDEX 256
 
+// scan archive operations of NNO_CMD_SD_ARCHIVE_CTRL
+#define FATSD_ARCHIVE_COMPACT				0
+#define FATSD_ARCHIVE_EXPORT				1
+
+// cursor values of FATSD_QueryScans()
+#define FATSD_QUERY_START					0
+#define FATSD_QUERY_END						0xFFFFFFFF
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int FATSD_Test( void );
 FRESULT FATSD_Init(void);
-FRESULT FATSD_WriteScanFile( void *pBuf, int bufLen , unsigned int index);
+FRESULT FATSD_WriteScanFile( void *pBuf, int bufLen , unsigned int index, uint16_t config_id);
 FRESULT FATSD_WriteReferenceFile(void);
 FRESULT FATSD_ReadLastStoredScanFile( void *pBuf, uint32_t *pBufLen);
 FRESULT FATSD_ReadScanFile(uint32_t index, void *pBuf, uint32_t *pBufLen);
+FRESULT FATSD_GetScanFileSize(uint32_t index, uint32_t *pSize);
 FRESULT FATSD_DeleteScanFile(unsigned int index);
 FRESULT FATSD_DeleteLastScanFile(void);
 int FATSD_GetNumScanFiles(void);
 FRESULT FATSD_FindListScanIndex(int* length);
 bool FATSD_SkipEEPROMCfg(void);
+FRESULT FATSD_CompactArchive(void *pBuf, uint32_t buf_size);
+FRESULT FATSD_ExportArchive(void *pBuf, uint32_t buf_size);
+FRESULT FATSD_QueryScans(uint32_t min_index, uint32_t min_timestamp, uint32_t *pCursor,
+		SD_ARCHIVE_ENTRY *pEntries, uint32_t max_num, uint32_t *pNum);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,108 @@
+/*
+ * Log structured scan archive on the SD card
+ *
+ * Copyright (C) 2014-15 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ */
+
+#ifndef SDARCHIVE_H_
+#define SDARCHIVE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ti/sysbios/fatfs/ff.h>
+
+#define SD_ARCHIVE_FILE_NAME		"SCANS.ARC"
+#define SD_ARCHIVE_TMP_FILE_NAME	"SCANS.TMP"
+#define SD_ARCHIVE_INDEX_FILE_NAME	"SCANS.IDX"
+
+/* The archive grows in segments of this size; records never cross a segment */
+#define SD_ARCHIVE_SEGMENT_SIZE		(64 * 1024)
+
+/* Space reserved for the archive header at the start of the file */
+#define SD_ARCHIVE_HEADER_SIZE		512
+
+/* The index file is read and written in pages of this size */
+#define SD_ARCHIVE_INDEX_PAGE_SIZE	512
+#define SD_ARCHIVE_INDEX_PAGE_ENTRIES	(SD_ARCHIVE_INDEX_PAGE_SIZE / sizeof(SD_ARCHIVE_ENTRY))
+
+/* Index pages kept in RAM */
+#define SD_ARCHIVE_INDEX_CACHE_PAGES	4
+
+/* Index positions SDArchive_Query() looks at per call */
+#define SD_ARCHIVE_QUERY_SCAN_LIMIT	(SD_ARCHIVE_INDEX_CACHE_PAGES * SD_ARCHIVE_INDEX_PAGE_ENTRIES)
+
+#define SD_ARCHIVE_MAGIC			0x414F4E4E		/* "NNOA" */
+#define SD_ARCHIVE_INDEX_MAGIC		0x494F4E4E		/* "NNOI" */
+#define SD_ARCHIVE_REC_MAGIC		0x52415343		/* "CSAR" */
+#define SD_ARCHIVE_VERSION			1
+#define SD_ARCHIVE_INDEX_VERSION	2
+
+typedef enum _sdArchiveRecType
+{
+	SD_ARCHIVE_REC_DATA = 1,		/**< serialized scan                        */
+	SD_ARCHIVE_REC_DELETED,			/**< tombstone, no payload                  */
+	SD_ARCHIVE_REC_PAD				/**< skip to the next segment               */
+} SD_ARCHIVE_REC_TYPE;
+
+/**
+ * Record header. The payload follows, padded to a multiple of 4 bytes. The CRC
+ * covers the header with crc = 0 and the payload.
+ */
+typedef struct _sdArchiveRecHdr
+{
+	uint32_t	magic;
+	uint16_t	type;				/**< SD_ARCHIVE_REC_TYPE                    */
+	uint16_t	config_id;			/**< scanConfigIndex of the scan            */
+	uint32_t	generation;			/**< must match the archive header          */
+	uint32_t	length;				/**< payload bytes; bytes skipped for PAD   */
+	uint32_t	index;				/**< scanDataIndex                          */
+	uint32_t	timestamp;			/**< FatFs time stamp when appended         */
+	uint32_t	crc;
+} SD_ARCHIVE_REC_HDR;
+
+/**
+ * Entry of the index file, sorted by scan index
+ */
+typedef struct _sdArchiveEntry
+{
+	uint32_t	index;				/**< scanDataIndex                          */
+	uint32_t	offset;				/**< of the record, 0 once deleted          */
+	uint32_t	timestamp;			/**< FatFs time stamp when stored           */
+	uint16_t	length;				/**< serialized scan bytes                  */
+	uint16_t	config_id;			/**< scanConfigIndex of the scan            */
+} SD_ARCHIVE_ENTRY;
+
+typedef struct _sdArchiveInfo
+{
+	uint32_t	num_records;		/**< live scans                             */
+	uint32_t	num_positions;		/**< index entries, deleted ones included   */
+	uint32_t	file_size;			/**< preallocated size of the archive       */
+	uint32_t	used_bytes;			/**< up to the append point                 */
+	uint32_t	dead_bytes;			/**< deleted or replaced records            */
+} SD_ARCHIVE_INFO;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FRESULT SDArchive_Open(const char *dir_path);
+void SDArchive_Close(void);
+bool SDArchive_IsOpen(void);
+FRESULT SDArchive_Append(const void *pBuf, uint32_t length, uint32_t index, uint16_t config_id);
+FRESULT SDArchive_Read(uint32_t index, void *pBuf, uint32_t max_length, uint32_t *pLength);
+FRESULT SDArchive_Delete(uint32_t index);
+FRESULT SDArchive_Compact(void *pBuf, uint32_t buf_size);
+bool SDArchive_Contains(uint32_t index);
+FRESULT SDArchive_GetLength(uint32_t index, uint32_t *pLength);
+bool SDArchive_GetLastIndex(uint32_t *pIndex);
+FRESULT SDArchive_FindPosition(uint32_t min_index, uint32_t *pPos);
+FRESULT SDArchive_Query(uint32_t *pPos, uint32_t min_timestamp,
+		SD_ARCHIVE_ENTRY *pEntries, uint32_t max_num, uint32_t *pNum);
+void SDArchive_GetInfo(SD_ARCHIVE_INFO *pInfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SDARCHIVE_H_ */
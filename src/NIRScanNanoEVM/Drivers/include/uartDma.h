@@ -0,0 +1,44 @@
+/*
+ * uDMA transport for the UART command interface
+ *
+ * Copyright (C) 2014-15 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ */
+
+#ifndef UARTDMA_H_
+#define UARTDMA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <xdc/std.h>
+
+/* uDMA channels of UART4, the command UART */
+#define UART_DMA_RX_CHANNEL			UDMA_CH18_UART4RX
+#define UART_DMA_TX_CHANNEL			UDMA_CH19_UART4TX
+
+/* Bytes the receive FIFO holds before the uDMA takes a burst */
+#define UART_DMA_RX_BURST			8
+
+/* Bytes per receive half buffer. One burst, so that every burst raises an
+ * interrupt: a frame ending on a burst boundary leaves the FIFO empty and
+ * gets no receive timeout, and would otherwise sit in a half filled buffer */
+#define UART_DMA_RX_HALF_SIZE		UART_DMA_RX_BURST
+
+/* Bytes per transmit transfer; the two halves alternate until a write is out */
+#define UART_DMA_TX_HALF_SIZE		256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void UARTDmaInit(uint32_t ui32Base);
+int UARTDmaWrite(const void *pData, uint32_t length);
+bool UARTDmaTxBusy(void);
+void UARTDmaIntHandler(void);
+void UARTDmaRxTimeout(UArg arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UARTDMA_H_ */
@@ -61,8 +61,6 @@ void UARTFlushRx(void);
 int UARTRxBytesAvail(void);
 int UARTTxBytesFree(void);
 void UARTEchoSet(bool bEnable);
-
-void uartDataTimeout();
 #endif
 
 //*****************************************************************************
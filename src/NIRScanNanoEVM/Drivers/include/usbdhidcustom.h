@@ -250,8 +250,14 @@ tUSBDHIDCustomHidDevice;
 
 void *USBDHIDNirscanNanoInit(unsigned long ulIndex,
                               const tUSBDHIDCustomHidDevice *psDevice);
+void *USBDHIDCustomHidCompositeInit(unsigned long ulIndex,
+                                    const tUSBDHIDCustomHidDevice *psDevice,
+                                    tCompositeEntry *psCompEntry);
 
 unsigned long USBDHIDCustomHidResponse(tUSBDHIDCustomHidDevice *psDevice, signed char HIDData[], int numBytes);
+unsigned long USBDHIDCustomHidStream(tUSBDHIDCustomHidDevice *psDevice,
+                                     const unsigned char *pucData, int numBytes);
+bool USBDHIDCustomHidTxIdle(tUSBDHIDCustomHidDevice *psDevice);
 
 //*****************************************************************************
 //
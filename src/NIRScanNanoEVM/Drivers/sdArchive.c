@@ -0,0 +1,1260 @@
+/*
+ * Copyright (c) 2014-2015, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Log structured scan archive. All scans go into one preallocated file
+ * instead of a file per scan:
+ *
+ *   [archive header][record][record]...[pad] | [record]...
+ *   |<------------- segment 0 ------------->| |<-- segment 1 ...
+ *
+ * The file grows a segment at a time and records never cross a segment
+ * boundary. A record is a header carrying the scan index, a time stamp and a
+ * CRC followed by the payload. Deleting appends a tombstone; the space is
+ * reclaimed by SDArchive_Compact(), which copies the live records to a new
+ * file.
+ *
+ * The archive header and every record carry a generation number that changes
+ * with each new file, so stale records left in reused clusters beyond the
+ * append point are never taken for valid ones.
+ *
+ * The scans are indexed by a second file holding one SD_ARCHIVE_ENTRY per
+ * scan, sorted by scan index, after a header with the counts and the archive
+ * offset the entries are up to date with:
+ *
+ *   [index header][page 0: 32 entries][page 1]...
+ *
+ * Only a few pages are cached in RAM and they are read as lookups need them,
+ * so opening the archive costs the same however many scans it holds. Scan
+ * indices increase, so storing a scan normally adds an entry to the last
+ * page; a deleted scan keeps its entry with offset 0 until the next
+ * compaction.
+ *
+ * Every change is appended to the archive first, then the index pages and
+ * finally the index header are written. If a record is found after the append
+ * point in the index header on open, the index missed a change and is rebuilt
+ * from the archive. Rebuilding stops at the first record that does not check
+ * out, which is where a write was cut off by a power loss.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+/* XDCtools Header files */
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+/* BIOS Header files */
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/fatfs/ff.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/gates/GateMutex.h>
+#include "common.h"
+#include "sdArchive.h"
+
+#define SDARCH_HDR_SIZE			sizeof(SD_ARCHIVE_REC_HDR)
+#define SDARCH_REC_SIZE(len)	(SDARCH_HDR_SIZE + (((len) + 3) & ~3UL))
+#define SDARCH_SEG_END(off)		((((off) / SD_ARCHIVE_SEGMENT_SIZE) + 1) * SD_ARCHIVE_SEGMENT_SIZE)
+#define SDARCH_MAX_PAYLOAD		(SD_ARCHIVE_SEGMENT_SIZE - SD_ARCHIVE_HEADER_SIZE - SDARCH_HDR_SIZE)
+#define SDARCH_IDX_PAGE_OFF(pg)	(SD_ARCHIVE_INDEX_PAGE_SIZE * ((pg) + 1))
+
+typedef struct _sdArchiveFileHdr
+{
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	header_size;
+	uint32_t	generation;
+	uint32_t	segment_size;
+	uint32_t	crc;
+} SD_ARCHIVE_FILE_HDR;
+
+/* First page of the index file */
+typedef struct _sdArchiveIndexHdr
+{
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	entry_size;
+	uint32_t	generation;			/* of the archive the index belongs to */
+	uint32_t	num_slots;			/* entries in the file, deleted ones included */
+	uint32_t	num_live;
+	uint32_t	append_offset;		/* records from here on are not indexed */
+	uint32_t	dead_bytes;
+	uint32_t	crc;				/* of this header with crc = 0 */
+} SD_ARCHIVE_INDEX_HDR;
+
+typedef struct _sdArchivePage
+{
+	SD_ARCHIVE_ENTRY	entry[SD_ARCHIVE_INDEX_PAGE_ENTRIES];
+	uint32_t			page;
+	uint32_t			last_use;
+	bool				valid;
+	bool				dirty;
+} SD_ARCHIVE_PAGE;
+
+typedef FRESULT (*SD_ARCHIVE_WALK_FN)(const SD_ARCHIVE_REC_HDR *pHdr, uint32_t offset);
+
+static FIL archFile;
+static FIL archIdxFile;
+static FIL archTmpFile;					// compaction target
+static bool archOpen = false;
+static GateMutex_Handle archGate = NULL;
+static char archDir[24];
+static uint32_t archGeneration;
+static uint32_t archAppendOff;
+static uint32_t archDeadBytes;
+static uint32_t archSlots;
+static uint32_t archLive;
+
+static SD_ARCHIVE_PAGE idxCache[SD_ARCHIVE_INDEX_CACHE_PAGES];
+static uint32_t idxUseCount;
+
+static uint8_t archChunk[512];			// CRC check of payloads on the card
+
+/* State of a running compaction */
+static uint32_t compGeneration;
+static uint32_t compAppendOff;
+static uint8_t *pCompBuf;
+static uint32_t compBufSize;
+
+/* CRC-32 (IEEE 802.3), 4 bits at a time */
+static const uint32_t crcNibbleTable[16] =
+{
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+	0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+	0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static uint32_t SDArchive_Crc(uint32_t crc, const void *pData, uint32_t length)
+{
+	const uint8_t *p = (const uint8_t *)pData;
+
+	crc = ~crc;
+	while(length--)
+	{
+		crc ^= *p++;
+		crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+		crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+static uint32_t SDArchive_HdrCrc(const SD_ARCHIVE_REC_HDR *pHdr)
+{
+	SD_ARCHIVE_REC_HDR hdr = *pHdr;
+
+	hdr.crc = 0;
+	return SDArchive_Crc(0, &hdr, SDARCH_HDR_SIZE);
+}
+
+static void SDArchive_MakePath(char *pPath, const char *pName)
+{
+	strcpy(pPath, archDir);
+	strcat(pPath, "/");
+	strcat(pPath, pName);
+}
+
+static uint32_t SDArchive_NewGeneration(uint32_t old_generation)
+{
+	/* Only has to differ from whatever may be left in the clusters of the new file */
+	return (old_generation * 1103515245) + get_fattime() + Clock_getTicks() + 1;
+}
+
+static FRESULT SDArchive_ReadAt(FIL *fp, uint32_t offset, void *pBuf, uint32_t length)
+{
+	FRESULT fr;
+	UINT bytesRead;
+
+	fr = f_lseek(fp, offset);
+	if(fr != FR_OK)
+		return fr;
+	fr = f_read(fp, pBuf, length, &bytesRead);
+	if((fr == FR_OK) && (bytesRead != length))
+		fr = FR_INT_ERR;
+	return fr;
+}
+
+static FRESULT SDArchive_WriteAt(FIL *fp, uint32_t offset, const void *pBuf, uint32_t length)
+{
+	FRESULT fr;
+	UINT bytesWritten;
+
+	fr = f_lseek(fp, offset);
+	if(fr != FR_OK)
+		return fr;
+	fr = f_write(fp, pBuf, length, &bytesWritten);
+	if((fr == FR_OK) && (bytesWritten != length))
+		fr = FR_DENIED;		/* volume full */
+	return fr;
+}
+
+static FRESULT SDArchive_CheckRecord(FIL *fp, uint32_t offset, uint32_t generation,
+		SD_ARCHIVE_REC_HDR *pHdr, bool *pValid)
+/*
+ * Reads the record header at offset and verifies header and payload.
+ * *pValid = false is not an error, it marks the end of the log.
+ */
+{
+	FRESULT fr;
+	uint32_t crc;
+	uint32_t pos;
+	uint32_t chunk;
+
+	*pValid = false;
+
+	fr = SDArchive_ReadAt(fp, offset, pHdr, SDARCH_HDR_SIZE);
+	if(fr != FR_OK)
+		return fr;
+
+	if((pHdr->magic != SD_ARCHIVE_REC_MAGIC) || (pHdr->generation != generation))
+		return FR_OK;
+
+	switch(pHdr->type)
+	{
+		case SD_ARCHIVE_REC_DATA:
+			if((pHdr->length == 0) || (pHdr->length > SDARCH_MAX_PAYLOAD) ||
+					(offset + SDARCH_REC_SIZE(pHdr->length) > SDARCH_SEG_END(offset)))
+				return FR_OK;
+			break;
+		case SD_ARCHIVE_REC_DELETED:
+			break;
+		case SD_ARCHIVE_REC_PAD:
+			if(offset + SDARCH_HDR_SIZE + pHdr->length != SDARCH_SEG_END(offset))
+				return FR_OK;
+			break;
+		default:
+			return FR_OK;
+	}
+
+	crc = SDArchive_HdrCrc(pHdr);
+	if(pHdr->type == SD_ARCHIVE_REC_DATA)
+	{
+		/* f_read continues right after the header */
+		for(pos = 0; pos < pHdr->length; pos += chunk)
+		{
+			UINT bytesRead;
+
+			chunk = pHdr->length - pos;
+			if(chunk > sizeof(archChunk))
+				chunk = sizeof(archChunk);
+			fr = f_read(fp, archChunk, chunk, &bytesRead);
+			if(fr != FR_OK)
+				return fr;
+			if(bytesRead != chunk)
+				return FR_OK;
+			crc = SDArchive_Crc(crc, archChunk, chunk);
+		}
+	}
+
+	*pValid = (crc == pHdr->crc);
+	return FR_OK;
+}
+
+static FRESULT SDArchive_Walk(uint32_t from, SD_ARCHIVE_WALK_FN fn, uint32_t *pEnd)
+/*
+ * Calls fn for every valid data and tombstone record from offset from until
+ * the end of the log. *pEnd is set to the offset after the last valid record.
+ */
+{
+	FRESULT fr;
+	SD_ARCHIVE_REC_HDR hdr;
+	uint32_t offset = from;
+	uint32_t size = f_size(&archFile);
+	bool valid;
+
+	while(1)
+	{
+		/* Too little room left for a pad record: the writer skipped to the next segment */
+		if(SDARCH_SEG_END(offset) - offset < SDARCH_HDR_SIZE)
+			offset = SDARCH_SEG_END(offset);
+
+		if(offset + SDARCH_HDR_SIZE > size)
+			break;
+
+		fr = SDArchive_CheckRecord(&archFile, offset, archGeneration, &hdr, &valid);
+		if(fr != FR_OK)
+			return fr;
+		if(!valid)
+			break;
+
+		if(hdr.type == SD_ARCHIVE_REC_PAD)
+		{
+			offset += SDARCH_HDR_SIZE + hdr.length;
+			continue;
+		}
+
+		fr = fn(&hdr, offset);
+		if(fr != FR_OK)
+			return fr;
+
+		offset += (hdr.type == SD_ARCHIVE_REC_DATA) ? SDARCH_REC_SIZE(hdr.length) : SDARCH_HDR_SIZE;
+	}
+
+	*pEnd = offset;
+	return FR_OK;
+}
+
+static FRESULT SDArchive_WriteRecord(FIL *fp, uint32_t *pAppendOff, uint32_t generation,
+		SD_ARCHIVE_REC_HDR *pHdr, const void *pBuf, uint32_t *pRecOff)
+/*
+ * Appends one record at *pAppendOff, padding to the next segment and growing
+ * the file by a segment when needed. The caller fills in type, length, index,
+ * timestamp and config_id of *pHdr. *pAppendOff only moves on success.
+ */
+{
+	FRESULT fr;
+	SD_ARCHIVE_REC_HDR pad;
+	uint32_t offset = *pAppendOff;
+	uint32_t size = (pHdr->type == SD_ARCHIVE_REC_DATA) ? SDARCH_REC_SIZE(pHdr->length) : SDARCH_HDR_SIZE;
+	uint32_t seg_end = SDARCH_SEG_END(offset);
+
+	if(offset + size > seg_end)
+	{
+		if(seg_end - offset >= SDARCH_HDR_SIZE)
+		{
+			memset(&pad, 0, SDARCH_HDR_SIZE);
+			pad.magic = SD_ARCHIVE_REC_MAGIC;
+			pad.type = SD_ARCHIVE_REC_PAD;
+			pad.generation = generation;
+			pad.length = seg_end - offset - SDARCH_HDR_SIZE;
+			pad.crc = SDArchive_HdrCrc(&pad);
+			fr = SDArchive_WriteAt(fp, offset, &pad, SDARCH_HDR_SIZE);
+			if(fr != FR_OK)
+				return fr;
+		}
+		offset = seg_end;
+		seg_end += SD_ARCHIVE_SEGMENT_SIZE;
+	}
+
+	if(seg_end > f_size(fp))
+	{
+		/* Preallocate the whole segment; seeking past the end grows the file */
+		fr = f_lseek(fp, seg_end);
+		if(fr != FR_OK)
+			return fr;
+		if(f_tell(fp) != seg_end)
+			return FR_DENIED;
+	}
+
+	pHdr->magic = SD_ARCHIVE_REC_MAGIC;
+	pHdr->generation = generation;
+	if(pHdr->type != SD_ARCHIVE_REC_DATA)
+		pHdr->length = 0;
+	pHdr->crc = SDArchive_Crc(SDArchive_HdrCrc(pHdr), pBuf, pHdr->length);
+
+	fr = SDArchive_WriteAt(fp, offset, pHdr, SDARCH_HDR_SIZE);
+	if((fr == FR_OK) && (pHdr->length > 0))
+	{
+		UINT bytesWritten;
+
+		fr = f_write(fp, pBuf, pHdr->length, &bytesWritten);
+		if((fr == FR_OK) && (bytesWritten != pHdr->length))
+			fr = FR_DENIED;
+	}
+	if(fr == FR_OK)
+		fr = f_sync(fp);
+	if(fr != FR_OK)
+		return fr;
+
+	*pRecOff = offset;
+	*pAppendOff = offset + size;
+	return FR_OK;
+}
+
+static FRESULT SDArchive_CreateFile(FIL *fp, const char *pPath, uint32_t generation)
+{
+	FRESULT fr;
+	SD_ARCHIVE_FILE_HDR hdr;
+
+	fr = f_open(fp, pPath, FA_CREATE_ALWAYS|FA_READ|FA_WRITE);
+	if(fr != FR_OK)
+		return fr;
+
+	hdr.magic = SD_ARCHIVE_MAGIC;
+	hdr.version = SD_ARCHIVE_VERSION;
+	hdr.header_size = SD_ARCHIVE_HEADER_SIZE;
+	hdr.generation = generation;
+	hdr.segment_size = SD_ARCHIVE_SEGMENT_SIZE;
+	hdr.crc = 0;
+	hdr.crc = SDArchive_Crc(0, &hdr, sizeof(hdr));
+
+	fr = SDArchive_WriteAt(fp, 0, &hdr, sizeof(hdr));
+	if(fr == FR_OK)
+		fr = f_lseek(fp, SD_ARCHIVE_SEGMENT_SIZE);
+	if((fr == FR_OK) && (f_tell(fp) != SD_ARCHIVE_SEGMENT_SIZE))
+		fr = FR_DENIED;
+	if(fr == FR_OK)
+		fr = f_sync(fp);
+	if(fr != FR_OK)
+		f_close(fp);
+
+	return fr;
+}
+
+static FRESULT SDArchive_ReadFileHdr(uint32_t *pGeneration)
+{
+	FRESULT fr;
+	SD_ARCHIVE_FILE_HDR hdr;
+	uint32_t crc;
+
+	fr = SDArchive_ReadAt(&archFile, 0, &hdr, sizeof(hdr));
+	if(fr != FR_OK)
+		return fr;
+
+	crc = hdr.crc;
+	hdr.crc = 0;
+	if((hdr.magic != SD_ARCHIVE_MAGIC) || (hdr.version != SD_ARCHIVE_VERSION) ||
+			(hdr.header_size != SD_ARCHIVE_HEADER_SIZE) ||
+			(hdr.segment_size != SD_ARCHIVE_SEGMENT_SIZE) ||
+			(crc != SDArchive_Crc(0, &hdr, sizeof(hdr))))
+		return FR_NO_FILESYSTEM;
+
+	*pGeneration = hdr.generation;
+	return FR_OK;
+}
+
+static FRESULT SDArchive_FlushPage(SD_ARCHIVE_PAGE *pPage)
+{
+	FRESULT fr;
+
+	if(!pPage->valid || !pPage->dirty)
+		return FR_OK;
+
+	fr = SDArchive_WriteAt(&archIdxFile, SDARCH_IDX_PAGE_OFF(pPage->page),
+			pPage->entry, SD_ARCHIVE_INDEX_PAGE_SIZE);
+	if(fr == FR_OK)
+		pPage->dirty = false;
+	return fr;
+}
+
+static FRESULT SDArchive_GetPage(uint32_t page, SD_ARCHIVE_PAGE **ppPage)
+/*
+ * Returns the cached copy of an index page, reading it in place of the least
+ * recently used one on a miss. Pages past the end of the file read as empty.
+ */
+{
+	FRESULT fr;
+	SD_ARCHIVE_PAGE *pPage = &idxCache[0];
+	uint32_t offset = SDARCH_IDX_PAGE_OFF(page);
+	uint32_t size = f_size(&archIdxFile);
+	UINT length;
+	UINT bytesRead;
+	int i;
+
+	for(i = 0; i < SD_ARCHIVE_INDEX_CACHE_PAGES; i++)
+	{
+		if(idxCache[i].valid && (idxCache[i].page == page))
+		{
+			idxCache[i].last_use = ++idxUseCount;
+			*ppPage = &idxCache[i];
+			return FR_OK;
+		}
+		if(!idxCache[i].valid)
+			pPage = &idxCache[i];
+		else if(pPage->valid && (idxCache[i].last_use < pPage->last_use))
+			pPage = &idxCache[i];
+	}
+
+	fr = SDArchive_FlushPage(pPage);
+	if(fr != FR_OK)
+		return fr;
+
+	pPage->valid = false;
+	memset(pPage->entry, 0, SD_ARCHIVE_INDEX_PAGE_SIZE);
+	if(offset < size)
+	{
+		length = size - offset;
+		if(length > SD_ARCHIVE_INDEX_PAGE_SIZE)
+			length = SD_ARCHIVE_INDEX_PAGE_SIZE;
+		fr = f_lseek(&archIdxFile, offset);
+		if(fr == FR_OK)
+			fr = f_read(&archIdxFile, pPage->entry, length, &bytesRead);
+		if((fr == FR_OK) && (bytesRead != length))
+			fr = FR_INT_ERR;
+		if(fr != FR_OK)
+			return fr;
+	}
+
+	pPage->page = page;
+	pPage->last_use = ++idxUseCount;
+	pPage->dirty = false;
+	pPage->valid = true;
+	*ppPage = pPage;
+	return FR_OK;
+}
+
+static FRESULT SDArchive_GetEntry(uint32_t pos, SD_ARCHIVE_ENTRY *pEntry)
+{
+	FRESULT fr;
+	SD_ARCHIVE_PAGE *pPage;
+
+	fr = SDArchive_GetPage(pos / SD_ARCHIVE_INDEX_PAGE_ENTRIES, &pPage);
+	if(fr == FR_OK)
+		*pEntry = pPage->entry[pos % SD_ARCHIVE_INDEX_PAGE_ENTRIES];
+	return fr;
+}
+
+static FRESULT SDArchive_PutEntry(uint32_t pos, const SD_ARCHIVE_ENTRY *pEntry)
+{
+	FRESULT fr;
+	SD_ARCHIVE_PAGE *pPage;
+
+	fr = SDArchive_GetPage(pos / SD_ARCHIVE_INDEX_PAGE_ENTRIES, &pPage);
+	if(fr == FR_OK)
+	{
+		pPage->entry[pos % SD_ARCHIVE_INDEX_PAGE_ENTRIES] = *pEntry;
+		pPage->dirty = true;
+	}
+	return fr;
+}
+
+static FRESULT SDArchive_Search(uint32_t index, uint32_t *pPos, SD_ARCHIVE_ENTRY *pEntry, bool *pFound)
+/*
+ * Binary search of the index. *pPos is the slot of index, or where it would
+ * have to be inserted with *pFound = false. Deleted entries are found too.
+ */
+{
+	FRESULT fr;
+	uint32_t lo = 0;
+	uint32_t hi = archSlots;
+	uint32_t mid;
+
+	*pFound = false;
+
+	/* Scan indices mostly increase: check the last entry first */
+	if(archSlots > 0)
+	{
+		fr = SDArchive_GetEntry(archSlots - 1, pEntry);
+		if(fr != FR_OK)
+			return fr;
+		if(pEntry->index < index)
+		{
+			*pPos = archSlots;
+			return FR_OK;
+		}
+	}
+
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		fr = SDArchive_GetEntry(mid, pEntry);
+		if(fr != FR_OK)
+			return fr;
+		if(pEntry->index < index)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*pPos = lo;
+	if(lo < archSlots)
+	{
+		fr = SDArchive_GetEntry(lo, pEntry);
+		if(fr != FR_OK)
+			return fr;
+		*pFound = (pEntry->index == index);
+	}
+	return FR_OK;
+}
+
+static FRESULT SDArchive_Insert(uint32_t pos, const SD_ARCHIVE_ENTRY *pEntry)
+{
+	FRESULT fr;
+	SD_ARCHIVE_ENTRY entry;
+	uint32_t i;
+
+	/* Only a scan stored out of order moves entries */
+	for(i = archSlots; i > pos; i--)
+	{
+		fr = SDArchive_GetEntry(i - 1, &entry);
+		if(fr == FR_OK)
+			fr = SDArchive_PutEntry(i, &entry);
+		if(fr != FR_OK)
+			return fr;
+	}
+
+	fr = SDArchive_PutEntry(pos, pEntry);
+	if(fr == FR_OK)
+		archSlots++;
+	return fr;
+}
+
+static FRESULT SDArchive_Apply(const SD_ARCHIVE_REC_HDR *pHdr, uint32_t offset)
+/*
+ * Updates the index for a record appended to the archive. Also the walk
+ * callback that rebuilds the index.
+ */
+{
+	FRESULT fr;
+	SD_ARCHIVE_ENTRY entry;
+	uint32_t pos;
+	bool found;
+
+	fr = SDArchive_Search(pHdr->index, &pos, &entry, &found);
+	if(fr != FR_OK)
+		return fr;
+
+	if(pHdr->type == SD_ARCHIVE_REC_DATA)
+	{
+		if(found && (entry.offset != 0))
+			archDeadBytes += SDARCH_REC_SIZE(entry.length);
+		else
+			archLive++;
+
+		entry.index = pHdr->index;
+		entry.offset = offset;
+		entry.timestamp = pHdr->timestamp;
+		entry.length = (uint16_t)pHdr->length;
+		entry.config_id = pHdr->config_id;
+		return (found) ? SDArchive_PutEntry(pos, &entry) : SDArchive_Insert(pos, &entry);
+	}
+
+	archDeadBytes += SDARCH_HDR_SIZE;
+	if(!found || (entry.offset == 0))
+		return FR_OK;
+
+	archDeadBytes += SDARCH_REC_SIZE(entry.length);
+	archLive--;
+	entry.offset = 0;
+	return SDArchive_PutEntry(pos, &entry);
+}
+
+static FRESULT SDArchive_Commit(void)
+/*
+ * Writes the dirty index pages, then the index header, which makes them
+ * count.
+ */
+{
+	FRESULT fr = FR_OK;
+	SD_ARCHIVE_INDEX_HDR hdr;
+	int i;
+
+	for(i = 0; (i < SD_ARCHIVE_INDEX_CACHE_PAGES) && (fr == FR_OK); i++)
+		fr = SDArchive_FlushPage(&idxCache[i]);
+	if(fr == FR_OK)
+		fr = f_sync(&archIdxFile);
+	if(fr != FR_OK)
+		return fr;
+
+	hdr.magic = SD_ARCHIVE_INDEX_MAGIC;
+	hdr.version = SD_ARCHIVE_INDEX_VERSION;
+	hdr.entry_size = sizeof(SD_ARCHIVE_ENTRY);
+	hdr.generation = archGeneration;
+	hdr.num_slots = archSlots;
+	hdr.num_live = archLive;
+	hdr.append_offset = archAppendOff;
+	hdr.dead_bytes = archDeadBytes;
+	hdr.crc = 0;
+	hdr.crc = SDArchive_Crc(0, &hdr, sizeof(hdr));
+
+	fr = SDArchive_WriteAt(&archIdxFile, 0, &hdr, sizeof(hdr));
+	if(fr == FR_OK)
+		fr = f_sync(&archIdxFile);
+	return fr;
+}
+
+static FRESULT SDArchive_NoOp(const SD_ARCHIVE_REC_HDR *pHdr, uint32_t offset)
+{
+	return FR_OK;
+}
+
+static FRESULT SDArchive_OpenIndex(void)
+/*
+ * Opens the index file and checks that it covers the whole archive, otherwise
+ * rebuilds it. Normally reads just the index header and one record header.
+ */
+{
+	FRESULT fr;
+	SD_ARCHIVE_INDEX_HDR hdr;
+	char path[40];
+	uint32_t crc;
+	uint32_t end;
+	UINT bytesRead;
+	bool valid = false;
+
+	memset(idxCache, 0, sizeof(idxCache));
+	idxUseCount = 0;
+	archSlots = 0;
+	archLive = 0;
+	archDeadBytes = 0;
+	archAppendOff = SD_ARCHIVE_HEADER_SIZE;
+
+	SDArchive_MakePath(path, SD_ARCHIVE_INDEX_FILE_NAME);
+	fr = f_open(&archIdxFile, path, FA_OPEN_ALWAYS|FA_READ|FA_WRITE);
+	if(fr != FR_OK)
+		return fr;
+
+	fr = f_read(&archIdxFile, &hdr, sizeof(hdr), &bytesRead);
+	if(fr == FR_OK)
+	{
+		crc = hdr.crc;
+		hdr.crc = 0;
+		valid = (bytesRead == sizeof(hdr)) &&
+				(hdr.magic == SD_ARCHIVE_INDEX_MAGIC) &&
+				(hdr.version == SD_ARCHIVE_INDEX_VERSION) &&
+				(hdr.entry_size == sizeof(SD_ARCHIVE_ENTRY)) &&
+				(hdr.generation == archGeneration) &&
+				(hdr.num_live <= hdr.num_slots) &&
+				(hdr.append_offset >= SD_ARCHIVE_HEADER_SIZE) &&
+				(hdr.append_offset <= f_size(&archFile)) &&
+				(crc == SDArchive_Crc(0, &hdr, sizeof(hdr)));
+	}
+
+	if((fr == FR_OK) && valid)
+	{
+		/* Anything stored after the index header was written is missing from it */
+		fr = SDArchive_Walk(hdr.append_offset, SDArchive_NoOp, &end);
+		if((fr == FR_OK) && (end == hdr.append_offset))
+		{
+			archSlots = hdr.num_slots;
+			archLive = hdr.num_live;
+			archDeadBytes = hdr.dead_bytes;
+			archAppendOff = hdr.append_offset;
+			return FR_OK;
+		}
+	}
+
+	if(fr == FR_OK)
+	{
+		DEBUG_PRINT("\r\nScan archive: rebuilding index\r\n");
+		fr = f_lseek(&archIdxFile, 0);
+		if(fr == FR_OK)
+			fr = f_truncate(&archIdxFile);
+		if(fr == FR_OK)
+			fr = SDArchive_Walk(SD_ARCHIVE_HEADER_SIZE, SDArchive_Apply, &archAppendOff);
+		if(fr == FR_OK)
+			fr = SDArchive_Commit();
+	}
+
+	if(fr != FR_OK)
+		f_close(&archIdxFile);
+	return fr;
+}
+
+static FRESULT SDArchive_CopyLive(const SD_ARCHIVE_REC_HDR *pHdr, uint32_t offset)
+/* Walk callback copying records that are still indexed to the new archive */
+{
+	FRESULT fr;
+	SD_ARCHIVE_REC_HDR hdr;
+	SD_ARCHIVE_ENTRY entry;
+	uint32_t pos;
+	uint32_t rec_off;
+	bool found;
+
+	if(pHdr->type != SD_ARCHIVE_REC_DATA)
+		return FR_OK;
+
+	fr = SDArchive_Search(pHdr->index, &pos, &entry, &found);
+	if((fr != FR_OK) || !found || (entry.offset != offset))
+		return fr;
+
+	if(pHdr->length > compBufSize)
+		return FR_INT_ERR;
+
+	fr = SDArchive_ReadAt(&archFile, offset + SDARCH_HDR_SIZE, pCompBuf, pHdr->length);
+	if(fr != FR_OK)
+		return fr;
+
+	/* Keeps index, time stamp and config ID of the original record */
+	hdr = *pHdr;
+	return SDArchive_WriteRecord(&archTmpFile, &compAppendOff, compGeneration,
+			&hdr, pCompBuf, &rec_off);
+}
+
+static void SDArchive_CloseFile(void)
+{
+	if(!archOpen)
+		return;
+
+	f_close(&archIdxFile);
+	f_close(&archFile);
+	archOpen = false;
+}
+
+static FRESULT SDArchive_OpenFile(void)
+{
+	FRESULT fr;
+	char path[40];
+	char tmp_path[40];
+
+	SDArchive_MakePath(path, SD_ARCHIVE_FILE_NAME);
+	SDArchive_MakePath(tmp_path, SD_ARCHIVE_TMP_FILE_NAME);
+
+	fr = f_open(&archFile, path, FA_OPEN_EXISTING|FA_READ|FA_WRITE);
+	if(fr == FR_NO_FILE)
+	{
+		/* A compaction may have completed without being renamed into place */
+		if(f_rename(tmp_path, path) == FR_OK)
+			fr = f_open(&archFile, path, FA_OPEN_EXISTING|FA_READ|FA_WRITE);
+		else
+			fr = SDArchive_CreateFile(&archFile, path, SDArchive_NewGeneration(0));
+	}
+	else if(fr == FR_OK)
+	{
+		/* Left over from an interrupted compaction */
+		f_unlink(tmp_path);
+	}
+	if(fr != FR_OK)
+		return fr;
+
+	fr = SDArchive_ReadFileHdr(&archGeneration);
+	if(fr == FR_OK)
+		fr = SDArchive_OpenIndex();
+	if(fr != FR_OK)
+	{
+		f_close(&archFile);
+		return fr;
+	}
+
+	archOpen = true;
+	DEBUG_PRINT("\r\nScan archive: %d scans, append at %d\r\n", archLive, archAppendOff);
+	return FR_OK;
+}
+
+static FRESULT SDArchive_Update(SD_ARCHIVE_REC_HDR *pHdr, const void *pBuf)
+/*
+ * Appends a record and brings the index up to date. If only the index could
+ * not be written the archive is closed, so that the next open rebuilds it.
+ */
+{
+	FRESULT fr;
+	uint32_t rec_off;
+
+	fr = SDArchive_WriteRecord(&archFile, &archAppendOff, archGeneration, pHdr, pBuf, &rec_off);
+	if(fr != FR_OK)
+		return fr;
+
+	fr = SDArchive_Apply(pHdr, rec_off);
+	if(fr == FR_OK)
+		fr = SDArchive_Commit();
+	if(fr != FR_OK)
+		SDArchive_CloseFile();
+
+	return fr;
+}
+
+FRESULT SDArchive_Open(const char *dir_path)
+/**
+ * Opens the archive in the given directory, creating it if it does not exist,
+ * together with its index. An already open archive is closed first.
+ *
+ * @param  dir_path -I- "drive:/directory" the archive lives in
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fr;
+	IArg key;
+	Error_Block eb;
+
+	if(archGate == NULL)
+	{
+		Error_init(&eb);
+		archGate = GateMutex_create(NULL, &eb);
+		if(archGate == NULL)
+			return FR_INT_ERR;
+	}
+
+	if(strlen(dir_path) >= sizeof(archDir))
+		return FR_INVALID_NAME;
+
+	key = GateMutex_enter(archGate);
+	SDArchive_CloseFile();
+	strcpy(archDir, dir_path);
+	fr = SDArchive_OpenFile();
+	GateMutex_leave(archGate, key);
+
+	return fr;
+}
+
+void SDArchive_Close(void)
+/**
+ * Closes the archive and its index.
+ *
+ * @return none
+ */
+{
+	IArg key;
+
+	if(archGate == NULL)
+		return;
+
+	key = GateMutex_enter(archGate);
+	SDArchive_CloseFile();
+	GateMutex_leave(archGate, key);
+}
+
+bool SDArchive_IsOpen(void)
+{
+	return archOpen;
+}
+
+FRESULT SDArchive_Append(const void *pBuf, uint32_t length, uint32_t index, uint16_t config_id)
+/**
+ * Appends a scan to the archive. A scan already stored under the same index
+ * is replaced.
+ *
+ * @param  pBuf      -I- serialized scan
+ * @param  length    -I- bytes in pBuf
+ * @param  index     -I- scan data index
+ * @param  config_id -I- scanConfigIndex the scan was taken with
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fr;
+	IArg key;
+	SD_ARCHIVE_REC_HDR hdr;
+
+	if(!archOpen)
+		return FR_NOT_READY;
+	if((length == 0) || (length > SDARCH_MAX_PAYLOAD))
+		return FR_INT_ERR;
+
+	memset(&hdr, 0, SDARCH_HDR_SIZE);
+	hdr.type = SD_ARCHIVE_REC_DATA;
+	hdr.config_id = config_id;
+	hdr.length = length;
+	hdr.index = index;
+	hdr.timestamp = get_fattime();
+
+	key = GateMutex_enter(archGate);
+	fr = SDArchive_Update(&hdr, pBuf);
+	GateMutex_leave(archGate, key);
+
+	return fr;
+}
+
+FRESULT SDArchive_Read(uint32_t index, void *pBuf, uint32_t max_length, uint32_t *pLength)
+/**
+ * Reads a scan from the archive and checks its CRC.
+ *
+ * @param  index      -I- scan data index
+ * @param  pBuf       -O- serialized scan
+ * @param  max_length -I- size of pBuf
+ * @param  pLength    -O- bytes read
+ *
+ * @return FR_NO_FILE if the scan is not in the archive, otherwise FRESULT
+ */
+{
+	FRESULT fr;
+	IArg key;
+	SD_ARCHIVE_ENTRY entry;
+	SD_ARCHIVE_REC_HDR hdr;
+	UINT bytesRead;
+	uint32_t pos;
+	bool found;
+
+	*pLength = 0;
+	if(!archOpen)
+		return FR_NOT_READY;
+
+	key = GateMutex_enter(archGate);
+
+	fr = SDArchive_Search(index, &pos, &entry, &found);
+	if((fr == FR_OK) && (!found || (entry.offset == 0)))
+		fr = FR_NO_FILE;
+	if(fr == FR_OK)
+		fr = SDArchive_ReadAt(&archFile, entry.offset, &hdr, SDARCH_HDR_SIZE);
+
+	if(fr == FR_OK)
+	{
+		if((hdr.magic != SD_ARCHIVE_REC_MAGIC) || (hdr.type != SD_ARCHIVE_REC_DATA) ||
+				(hdr.index != index) || (hdr.length > max_length))
+			fr = FR_INT_ERR;
+		else
+			fr = f_read(&archFile, pBuf, hdr.length, &bytesRead);
+	}
+
+	if(fr == FR_OK)
+	{
+		if((bytesRead != hdr.length) ||
+				(SDArchive_Crc(SDArchive_HdrCrc(&hdr), pBuf, hdr.length) != hdr.crc))
+			fr = FR_INT_ERR;
+		else
+			*pLength = hdr.length;
+	}
+
+	GateMutex_leave(archGate, key);
+	return fr;
+}
+
+FRESULT SDArchive_Delete(uint32_t index)
+/**
+ * Deletes a scan by appending a tombstone. The space is reclaimed by the next
+ * SDArchive_Compact().
+ *
+ * @param  index -I- scan data index
+ *
+ * @return FR_NO_FILE if the scan is not in the archive, otherwise FRESULT
+ */
+{
+	FRESULT fr;
+	IArg key;
+	SD_ARCHIVE_ENTRY entry;
+	SD_ARCHIVE_REC_HDR hdr;
+	uint32_t pos;
+	bool found;
+
+	if(!archOpen)
+		return FR_NOT_READY;
+
+	memset(&hdr, 0, SDARCH_HDR_SIZE);
+	hdr.type = SD_ARCHIVE_REC_DELETED;
+	hdr.index = index;
+	hdr.timestamp = get_fattime();
+
+	key = GateMutex_enter(archGate);
+
+	fr = SDArchive_Search(index, &pos, &entry, &found);
+	if((fr == FR_OK) && (!found || (entry.offset == 0)))
+		fr = FR_NO_FILE;
+	if(fr == FR_OK)
+		fr = SDArchive_Update(&hdr, NULL);
+
+	GateMutex_leave(archGate, key);
+	return fr;
+}
+
+FRESULT SDArchive_Compact(void *pBuf, uint32_t buf_size)
+/**
+ * Copies the live scans to a new archive file, in the order they were
+ * stored, and replaces the old file with it. Until the new file has been
+ * renamed into place the old one stays valid, so a power loss at any point
+ * leaves a usable archive. The index is rebuilt for the new file.
+ *
+ * @param  pBuf     -I- scratch buffer, must hold the largest scan
+ * @param  buf_size -I- size of pBuf
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fr;
+	FRESULT openresult;
+	IArg key;
+	char path[40];
+	char tmp_path[40];
+	uint32_t end;
+
+	if(!archOpen)
+		return FR_NOT_READY;
+
+	key = GateMutex_enter(archGate);
+
+	SDArchive_MakePath(path, SD_ARCHIVE_FILE_NAME);
+	SDArchive_MakePath(tmp_path, SD_ARCHIVE_TMP_FILE_NAME);
+
+	compGeneration = SDArchive_NewGeneration(archGeneration);
+	compAppendOff = SD_ARCHIVE_HEADER_SIZE;
+	pCompBuf = (uint8_t *)pBuf;
+	compBufSize = buf_size;
+
+	fr = SDArchive_CreateFile(&archTmpFile, tmp_path, compGeneration);
+	if(fr == FR_OK)
+	{
+		fr = SDArchive_Walk(SD_ARCHIVE_HEADER_SIZE, SDArchive_CopyLive, &end);
+		if((fr == FR_OK) && (end != archAppendOff))
+			fr = FR_INT_ERR;
+		if(f_close(&archTmpFile) != FR_OK)
+			fr = FR_DISK_ERR;
+	}
+
+	if(fr != FR_OK)
+	{
+		/* Old archive and its index are untouched */
+		f_unlink(tmp_path);
+		GateMutex_leave(archGate, key);
+		return fr;
+	}
+
+	SDArchive_CloseFile();
+	fr = f_unlink(path);
+	if(fr == FR_OK)
+		fr = f_rename(tmp_path, path);
+
+	/* Opens whichever file made it; the index generation no longer matches */
+	openresult = SDArchive_OpenFile();
+	if(fr == FR_OK)
+		fr = openresult;
+
+	GateMutex_leave(archGate, key);
+	return fr;
+}
+
+bool SDArchive_Contains(uint32_t index)
+{
+	IArg key;
+	SD_ARCHIVE_ENTRY entry;
+	uint32_t pos;
+	bool found;
+
+	if(!archOpen)
+		return false;
+
+	key = GateMutex_enter(archGate);
+	if(SDArchive_Search(index, &pos, &entry, &found) != FR_OK)
+		found = false;
+	GateMutex_leave(archGate, key);
+
+	return found && (entry.offset != 0);
+}
+
+FRESULT SDArchive_GetLength(uint32_t index, uint32_t *pLength)
+/**
+ * Returns the stored length of a scan without reading it.
+ *
+ * @param  index   -I- scan data index
+ * @param  pLength -O- bytes SDArchive_Read() returns for the scan
+ *
+ * @return FR_NO_FILE if the scan is not in the archive
+ */
+{
+	IArg key;
+	SD_ARCHIVE_ENTRY entry;
+	uint32_t pos;
+	bool found;
+	FRESULT fr;
+
+	if(!archOpen)
+		return FR_NOT_READY;
+
+	key = GateMutex_enter(archGate);
+	fr = SDArchive_Search(index, &pos, &entry, &found);
+	GateMutex_leave(archGate, key);
+
+	if(fr != FR_OK)
+		return fr;
+	if(!found || (entry.offset == 0))
+		return FR_NO_FILE;
+
+	*pLength = entry.length;
+	return FR_OK;
+}
+
+bool SDArchive_GetLastIndex(uint32_t *pIndex)
+/**
+ * Returns the highest scan index in the archive, which is the scan taken
+ * last.
+ *
+ * @param  pIndex -O- scan data index
+ *
+ * @return false if the archive is empty
+ */
+{
+	IArg key;
+	SD_ARCHIVE_ENTRY entry;
+	uint32_t pos;
+	bool found = false;
+
+	if(!archOpen || (archLive == 0))
+		return false;
+
+	key = GateMutex_enter(archGate);
+	for(pos = archSlots; pos > 0; pos--)
+	{
+		if(SDArchive_GetEntry(pos - 1, &entry) != FR_OK)
+			break;
+		if(entry.offset != 0)
+		{
+			*pIndex = entry.index;
+			found = true;
+			break;
+		}
+	}
+	GateMutex_leave(archGate, key);
+
+	return found;
+}
+
+FRESULT SDArchive_FindPosition(uint32_t min_index, uint32_t *pPos)
+/**
+ * Returns the position in the index of the first scan with an index of at
+ * least min_index, to start SDArchive_Query() at.
+ *
+ * @param  min_index -I- scan data index
+ * @param  pPos      -O- position in the index
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fr;
+	IArg key;
+	SD_ARCHIVE_ENTRY entry;
+	bool found;
+
+	*pPos = 0;
+	if(!archOpen)
+		return FR_NOT_READY;
+
+	key = GateMutex_enter(archGate);
+	fr = SDArchive_Search(min_index, pPos, &entry, &found);
+	GateMutex_leave(archGate, key);
+
+	return fr;
+}
+
+FRESULT SDArchive_Query(uint32_t *pPos, uint32_t min_timestamp,
+		SD_ARCHIVE_ENTRY *pEntries, uint32_t max_num, uint32_t *pNum)
+/**
+ * Copies the entries of the scans stored at or after min_timestamp, in
+ * ascending scan index order, starting at position *pPos of the index. Looks
+ * at no more than SD_ARCHIVE_QUERY_SCAN_LIMIT positions per call, so fewer
+ * than max_num entries does not mean the end; the query is done when *pPos
+ * reaches the number of positions in SD_ARCHIVE_INFO.
+ *
+ * @param  pPos          -IO- position in the index, moved past the entries looked at
+ * @param  min_timestamp -I-  FatFs time stamp, 0 for all scans
+ * @param  pEntries      -O-  matching entries
+ * @param  max_num       -I-  number of entries pEntries can hold
+ * @param  pNum          -O-  number of entries copied
+ *
+ * @return FRESULT = Refer http://elm-chan.org/fsw/ff/en/rc.html#nr for
+ *                   return codes.
+ */
+{
+	FRESULT fr = FR_OK;
+	IArg key;
+	SD_ARCHIVE_ENTRY entry;
+	uint32_t end;
+
+	*pNum = 0;
+	if(!archOpen)
+		return FR_NOT_READY;
+
+	key = GateMutex_enter(archGate);
+
+	end = *pPos + SD_ARCHIVE_QUERY_SCAN_LIMIT;
+	if((end > archSlots) || (end < *pPos))
+		end = archSlots;
+
+	while((*pPos < end) && (*pNum < max_num))
+	{
+		fr = SDArchive_GetEntry(*pPos, &entry);
+		if(fr != FR_OK)
+			break;
+		(*pPos)++;
+		if((entry.offset != 0) && (entry.timestamp >= min_timestamp))
+			pEntries[(*pNum)++] = entry;
+	}
+
+	GateMutex_leave(archGate, key);
+	return fr;
+}
+
+void SDArchive_GetInfo(SD_ARCHIVE_INFO *pInfo)
+{
+	memset(pInfo, 0, sizeof(SD_ARCHIVE_INFO));
+	if(!archOpen)
+		return;
+
+	pInfo->num_records = archLive;
+	pInfo->num_positions = archSlots;
+	pInfo->file_size = f_size(&archFile);
+	pInfo->used_bytes = archAppendOff;
+	pInfo->dead_bytes = archDeadBytes;
+}
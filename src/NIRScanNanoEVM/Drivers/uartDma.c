@@ -0,0 +1,304 @@
+/*
+ * uDMA transport for the UART command interface
+ *
+ * Received bytes are collected by the uDMA in two half buffers used in
+ * ping-pong mode and passed to the command handler a half at a time, while
+ * the uDMA fills the other half. The uDMA only serves the receive FIFO in
+ * bursts, so the last few bytes of a frame stay in the FIFO; the receive
+ * timeout interrupt that then fires after a character time of silence is
+ * taken as the line going idle, and the FIFO is passed on.
+ *
+ * Writes go out the same way, the two halves alternating until the whole
+ * buffer has been handed to the transmit FIFO. The CPU takes one interrupt
+ * per half buffer instead of one every two bytes, and does not touch the
+ * bytes in between.
+ *
+ * Copyright (C) 2014-15 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xdc/std.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/hal/Timer.h>
+#include <inc/hw_ints.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_uart.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/uart.h"
+#include "driverlib/udma.h"
+#include "common.h"
+#include "NIRscanNano.h"
+#include "uartCmdHandler.h"
+#include "uartDma.h"
+
+#ifdef ENABLE_UART_COMMAND_INTERFACE
+
+#define UART_DMA_SELECT(half)	((half) ? UDMA_ALT_SELECT : UDMA_PRI_SELECT)
+
+/*
+ * UART timer handle
+ */
+extern Timer_Handle g_uartTimerHandle;
+
+static uint32_t uartBase = 0;
+
+static uint8_t rxBuf[2][UART_DMA_RX_HALF_SIZE];
+static uint32_t rxPassed[2];				// bytes of each half passed on
+static uint32_t rxActive = 0;				// half the uDMA is filling
+
+static const uint8_t *pTxData;				// next byte to hand to the uDMA
+static uint32_t txRemaining = 0;			// bytes not yet handed to the uDMA
+static uint32_t txActive = 0;				// half the uDMA is sending
+static uint32_t txInFlight = 0;				// halves handed to the uDMA
+static volatile bool txBusy = false;
+
+static void UARTDmaRxArm(uint32_t half)
+{
+	uDMAChannelTransferSet(UART_DMA_RX_CHANNEL | UART_DMA_SELECT(half),
+						   UDMA_MODE_PINGPONG,
+						   (void *)(uartBase + UART_O_DR),
+						   rxBuf[half],
+						   UART_DMA_RX_HALF_SIZE);
+	rxPassed[half] = 0;
+}
+
+static void UARTDmaRxPass(uint32_t half, uint32_t filled)
+{
+	if (filled > rxPassed[half])
+	{
+		cmdRecvUART(&rxBuf[half][rxPassed[half]], filled - rxPassed[half]);
+		rxPassed[half] = filled;
+	}
+}
+
+/*
+ * Passes on the halves the uDMA has filled and gives them back to it
+ */
+static void UARTDmaRxCompleted(void)
+{
+	while (uDMAChannelModeGet(UART_DMA_RX_CHANNEL | UART_DMA_SELECT(rxActive)) == UDMA_MODE_STOP)
+	{
+		UARTDmaRxPass(rxActive, UART_DMA_RX_HALF_SIZE);
+		UARTDmaRxArm(rxActive);
+		rxActive ^= 1;
+	}
+
+	/* The channel stops if both halves filled before they were served */
+	if (!uDMAChannelIsEnabled(UART_DMA_RX_CHANNEL))
+		uDMAChannelEnable(UART_DMA_RX_CHANNEL);
+}
+
+/*
+ * Passes on everything received so far: the halves the uDMA has filled,
+ * the part of the half it is filling and what is left in the FIFO
+ */
+static void UARTDmaRxFlush(void)
+{
+	uint8_t fifo[16];
+	uint32_t n = 0;
+	int32_t i32Char;
+
+	/* Keep the uDMA off the FIFO so the bytes are passed on in order */
+	MAP_UARTDMADisable(uartBase, UART_DMA_RX);
+
+	UARTDmaRxCompleted();
+	UARTDmaRxPass(rxActive, UART_DMA_RX_HALF_SIZE -
+				  uDMAChannelSizeGet(UART_DMA_RX_CHANNEL | UART_DMA_SELECT(rxActive)));
+
+	while ((n < sizeof(fifo)) && ((i32Char = MAP_UARTCharGetNonBlocking(uartBase)) != -1))
+		fifo[n++] = (uint8_t)(i32Char & 0xFF);
+	if (n > 0)
+		cmdRecvUART(fifo, n);
+
+	MAP_UARTDMAEnable(uartBase, UART_DMA_RX);
+}
+
+static void UARTDmaTxArm(uint32_t half)
+{
+	uint32_t n = MIN(txRemaining, UART_DMA_TX_HALF_SIZE);
+
+	uDMAChannelTransferSet(UART_DMA_TX_CHANNEL | UART_DMA_SELECT(half),
+						   UDMA_MODE_PINGPONG,
+						   (void *)pTxData,
+						   (void *)(uartBase + UART_O_DR),
+						   n);
+	pTxData += n;
+	txRemaining -= n;
+	txInFlight++;
+}
+
+/*
+ * Refills the halves the uDMA has sent; ends the write once both are idle
+ */
+static void UARTDmaTxCompleted(void)
+{
+	while ((txInFlight > 0) &&
+		   (uDMAChannelModeGet(UART_DMA_TX_CHANNEL | UART_DMA_SELECT(txActive)) == UDMA_MODE_STOP))
+	{
+		txInFlight--;
+		if (txRemaining > 0)
+			UARTDmaTxArm(txActive);
+		txActive ^= 1;
+	}
+
+	if (txInFlight > 0)
+	{
+		if (!uDMAChannelIsEnabled(UART_DMA_TX_CHANNEL))
+			uDMAChannelEnable(UART_DMA_TX_CHANNEL);
+		return;
+	}
+
+	MAP_UARTDMADisable(uartBase, UART_DMA_TX);
+	MAP_UARTIntDisable(uartBase, UART_INT_DMATX);
+	txBusy = false;
+}
+
+void UARTDmaInit(uint32_t ui32Base)
+/**
+ * Moves the command UART over to the uDMA. Called once the UART has been
+ * configured by UARTStdioConfig(); from then on its interrupt is handled by
+ * UARTDmaIntHandler().
+ *
+ * @param[in]   ui32Base	UART base address
+ *
+ * @return      None
+ *
+ */
+{
+	uartBase = ui32Base;
+
+	NIRscanNano_initDMA();
+
+	MAP_UARTIntDisable(uartBase, 0xFFFFFFFF);
+	MAP_UARTDMADisable(uartBase, UART_DMA_RX | UART_DMA_TX);
+
+	/* Bursts of UART_DMA_RX_BURST bytes in, 4 bytes out */
+	MAP_UARTFIFOLevelSet(uartBase, UART_FIFO_TX4_8, UART_FIFO_RX4_8);
+
+	uDMAChannelAssign(UART_DMA_RX_CHANNEL);
+	uDMAChannelAssign(UART_DMA_TX_CHANNEL);
+
+	/* Bursts only, so the bytes after the last full burst wait in the FIFO
+	 * and raise the receive timeout */
+	uDMAChannelAttributeDisable(UART_DMA_RX_CHANNEL, UDMA_ATTR_ALTSELECT |
+								UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+	uDMAChannelAttributeEnable(UART_DMA_RX_CHANNEL, UDMA_ATTR_USEBURST);
+	uDMAChannelControlSet(UART_DMA_RX_CHANNEL | UDMA_PRI_SELECT,
+						  UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_8);
+	uDMAChannelControlSet(UART_DMA_RX_CHANNEL | UDMA_ALT_SELECT,
+						  UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_8);
+
+	uDMAChannelAttributeDisable(UART_DMA_TX_CHANNEL, UDMA_ATTR_ALTSELECT | UDMA_ATTR_USEBURST |
+								UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+	uDMAChannelControlSet(UART_DMA_TX_CHANNEL | UDMA_PRI_SELECT,
+						  UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+	uDMAChannelControlSet(UART_DMA_TX_CHANNEL | UDMA_ALT_SELECT,
+						  UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+
+	UARTDmaRxArm(0);
+	UARTDmaRxArm(1);
+	rxActive = 0;
+	uDMAChannelEnable(UART_DMA_RX_CHANNEL);
+
+	MAP_UARTDMAEnable(uartBase, UART_DMA_RX);
+	MAP_UARTIntEnable(uartBase, UART_INT_DMARX | UART_INT_RT);
+}
+
+int UARTDmaWrite(const void *pData, uint32_t length)
+/**
+ * Starts sending a buffer. The buffer is read in place and must not change
+ * until UARTDmaTxBusy() returns false.
+ *
+ * @param[in]   pData		Bytes to send
+ * @param[in]   length		Bytes in pData
+ *
+ * @return      PASS or FAIL if a write is still going on
+ *
+ */
+{
+	if ((uartBase == 0) || (length == 0) || txBusy)
+		return FAIL;
+
+	pTxData = (const uint8_t *)pData;
+	txRemaining = length;
+	txActive = 0;
+	txInFlight = 0;
+	txBusy = true;
+
+	UARTDmaTxArm(0);
+	if (txRemaining > 0)
+		UARTDmaTxArm(1);
+
+	uDMAChannelAttributeDisable(UART_DMA_TX_CHANNEL, UDMA_ATTR_ALTSELECT);
+	uDMAChannelEnable(UART_DMA_TX_CHANNEL);
+	MAP_UARTIntEnable(uartBase, UART_INT_DMATX);
+	MAP_UARTDMAEnable(uartBase, UART_DMA_TX);
+
+	return PASS;
+}
+
+bool UARTDmaTxBusy(void)
+/**
+ * @return      true until the last write has been handed to the transmit FIFO
+ */
+{
+	return txBusy;
+}
+
+void UARTDmaIntHandler(void)
+/**
+ * Handles the interrupt of the command UART: a half buffer sent or received,
+ * or the receive timeout.
+ *
+ * @return      None
+ *
+ */
+{
+	uint32_t ui32Ints;
+
+	ui32Ints = MAP_UARTIntStatus(uartBase, true);
+	MAP_UARTIntClear(uartBase, ui32Ints);
+
+	if (ui32Ints & UART_INT_DMATX)
+		UARTDmaTxCompleted();
+
+	if (ui32Ints & UART_INT_DMARX)
+	{
+		UARTDmaRxCompleted();
+		Timer_start(g_uartTimerHandle);
+	}
+
+	if (ui32Ints & UART_INT_RT)
+	{
+		UARTDmaRxFlush();
+		cmdIdleUART();
+		Timer_start(g_uartTimerHandle);
+	}
+}
+
+void UARTDmaRxTimeout(UArg arg)
+/**
+ * Inter byte timer callback, run MAX_TIME_BET_DATA_PACKETS_US after the last
+ * bytes were received.
+ *
+ * @param[in]   arg			Unused
+ *
+ * @return      None
+ *
+ */
+{
+	UInt key;
+
+	Timer_stop(g_uartTimerHandle);
+
+	key = Hwi_disable();
+	UARTDmaRxFlush();
+	cmdTimeoutUART();
+	Hwi_restore(key);
+}
+
+#endif
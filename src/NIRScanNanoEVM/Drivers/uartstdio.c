@@ -13,7 +13,6 @@
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "inc/hw_uart.h"
-#include <ti/sysbios/hal/Timer.h>
 #include "driverlib/debug.h"
 #include "driverlib/pin_map.h"
 #include <driverlib/interrupt.h>
@@ -26,8 +25,7 @@
 #include "common.h"
 #include "NNOUARTDefs.h"
 #include "uartstdio.h"
-#include "uartCmdHandler.h"
-#include "nnoStatus.h"
+#include "uartDma.h"
 
 //*****************************************************************************
 //
@@ -36,7 +34,6 @@
 //
 //*****************************************************************************
 extern uint32_t 	g_ui32SysClk;
-extern int16_t  nRemReadPC;     /* number of message bytes remaining to read  */
 
 //*****************************************************************************
 //
@@ -57,16 +54,6 @@ extern int16_t  nRemReadPC;     /* number of message bytes remaining to read  */
 //*****************************************************************************
 #ifndef ENABLE_UART_COMMAND_INTERFACE
 static bool g_bDisableEcho;
-#else
-/*
- * UART timer handle
- */
-extern Timer_Handle g_uartTimerHandle;
-
-/**
- * To keep track of num chars received
- */
-static unsigned char g_numCharRecd = 0;
 #endif
 
 //*****************************************************************************
@@ -124,25 +111,6 @@ static volatile uint32_t g_ui32UARTRxReadIndex = 0;
                                 (Index) = ((Index) + 1) % UART_RX_BUFFER_SIZE
 #endif
 
-/*****************
- * start/end indicator definitions
- */
-const unsigned char g_uartStartInd[UART_START_IND_NUM_BYTES] =
-{
-		UART_START_IND_BYTE_0,
-		UART_START_IND_BYTE_1,
-		UART_START_IND_BYTE_2,
-		UART_START_IND_BYTE_3
-};
-
-const unsigned char g_uartEndInd[UART_END_IND_NUM_BYTES] =
-{
-		UART_END_IND_BYTE_0,
-		UART_END_IND_BYTE_1,
-		UART_END_IND_BYTE_2,
-		UART_END_IND_BYTE_3
-};
-
 //*****************************************************************************
 //
 // The base address of the chosen UART.
@@ -207,12 +175,6 @@ static const uint32_t g_ui32UARTPeriph[5] =
 };
 
 
-/*
- * standard response on incomplete UART packets
- */
-unsigned char uartStdFailResponse[] = { 65, 66, 67, 68, 16, 0, 0, 0, 16, 0, 0, 0, 68, 67, 66, 65 };
-#define UART_STD_FAIL_RESP_SIZE sizeof(uartStdFailResponse)/sizeof(unsigned char)
-
 void uart_interface_init(void)
 {
 
@@ -234,6 +196,13 @@ void uart_interface_init(void)
     //
     UARTStdioConfig(CONSOLE_UART, 115200, g_ui32SysClk);	//16000000);
 
+#ifdef ENABLE_UART_COMMAND_INTERFACE
+    //
+    // Commands are moved by the uDMA
+    //
+    UARTDmaInit(g_ui32Base);
+#endif
+
 #if defined(ENABLE_UART_COMMAND_INTERFACE) || !defined(TEST_UART)
     UARTEchoSet(true);
 #endif
@@ -1625,14 +1594,16 @@ UARTEchoSet(bool bEnable)
 void
 UARTStdioIntHandler(void)
 {
+#ifdef ENABLE_UART_COMMAND_INTERFACE
+    //
+    // The command interface moves its data by uDMA.
+    //
+    UARTDmaIntHandler();
+#else
     uint32_t ui32Ints = 0;
     uint8_t cChar = 0;
     int32_t i32Char = 0;
 
-    static uint16_t length = 0;
-#ifdef ENABLE_UART_COMMAND_INTERFACE
-    static unsigned char cEndIndCnt = 0;
-#endif
     //
     // Get and clear the current interrupt source(s)
     //
@@ -1670,84 +1641,10 @@ UARTStdioIntHandler(void)
         {
         	i32Char = MAP_UARTCharGet(g_ui32Base);	//MAP_UARTCharGetNonBlocking(g_ui32Base);
         	cChar = (unsigned char)(i32Char & 0xFF);
-#ifdef ENABLE_UART_COMMAND_INTERFACE
-        	if (g_numCharRecd > 0)	// start timer from second byte onwards
-        	{
-        		Timer_start(g_uartTimerHandle);
-        	}
-
-            if (g_numCharRecd < UART_START_IND_NUM_BYTES)
-        	{
-
-                if (cChar == g_uartStartInd[g_numCharRecd])
-                {
-                	g_pcUARTRxBuffer[g_ui32UARTRxWriteIndex] = cChar;
-                	ADVANCE_RX_BUFFER_INDEX(g_ui32UARTRxWriteIndex);
-                	g_numCharRecd++;
-                }
-                else	// False alarm, reset num bookends recd and start over
-                {
-                	g_ui32UARTRxWriteIndex = 0;
-                	g_numCharRecd = 0;
-                }
-
-                cEndIndCnt = 0;
-
-        	}
-        	else
-        	{
-                if ( cChar == g_uartEndInd[cEndIndCnt] && (!nRemReadPC) )
-                	cEndIndCnt++;
-                else	//false alarm, start over
-                	cEndIndCnt = 0;
-
-                g_pcUARTRxBuffer[g_ui32UARTRxWriteIndex] = cChar;
-
-
-                if(g_ui32UARTRxWriteIndex == 11)
-                {
-
-                	length = (g_pcUARTRxBuffer[10] | (g_pcUARTRxBuffer[11] << 8));
-
-
-                }
-
-                ADVANCE_RX_BUFFER_INDEX(g_ui32UARTRxWriteIndex);
-
-                g_numCharRecd++;
-
-
-
-                if ((cEndIndCnt == UART_END_IND_NUM_BYTES)) //end of packet, notify cmdHandler with the data length alone
-                {
-                	if(!(g_ui32UARTRxWriteIndex == length+16))// false alarm we reached the end pattern as part of buffer
-                	{
-                	                		cEndIndCnt = 0;
-                	                		continue;
-                	}
-                	else
-                	{
-
-                	Timer_stop(g_uartTimerHandle);
-                	cmdRecvUART(&g_pcUARTRxBuffer[0], g_ui32UARTRxWriteIndex);
-                	g_ui32UARTRxWriteIndex = 0;	// command will be handled, so reset RxBuffer now
-                	UARTFlushTx(true);
-                	g_numCharRecd = 0;
-                	cEndIndCnt = 0;
-
-
-                	}
-
-                }
-
-        	}
-#endif
         }
 
-#ifndef ENABLE_UART_COMMAND_INTERFACE
         if(!g_bDisableEcho)
         	UARTwrite((const char *)&cChar, 1);
-#endif
 
         //
         // If we wrote anything to the transmit buffer, make sure it actually
@@ -1756,26 +1653,7 @@ UARTStdioIntHandler(void)
         UARTPrimeTransmit(g_ui32Base);
         MAP_UARTIntEnable(g_ui32Base, UART_INT_TX);
     }
-}
-
-
-void uartDataTimeout()
-{
-#ifdef ENABLE_UART_COMMAND_INTERFACE
-	uint16_t size = 0;
-
-	g_ui32UARTRxWriteIndex = 0;	// Reset Rx Buffer
-	g_numCharRecd = 0;
-
-	Timer_stop(g_uartTimerHandle);
-
-	size = UART_STD_FAIL_RESP_SIZE;
-	if (size != UARTwrite((const char *)&uartStdFailResponse[0], size))
-		nnoStatus_setErrorStatusAndCode(NNO_ERROR_UART, true, UART_WRITE_FAILED);
-
-	nnoStatus_setErrorStatusAndCode(NNO_ERROR_UART, true, UART_INCOMP_START_END_IND_RECD);
 #endif
-	return;
 }
 
 #endif
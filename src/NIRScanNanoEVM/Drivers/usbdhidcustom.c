@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "inc/hw_types.h"
 #include "driverlib/debug.h"
 #include "driverlib/usb.h"
@@ -24,7 +25,8 @@ static uint8_t reportBuffer[CUSTOMHID_REPORT_SIZE];
 static void *pvHIDInstance;
 
 void *USBDHIDCustomHidCompositeInit(unsigned long ulIndex,
-                                       const tUSBDHIDCustomHidDevice *psDevice);
+                                       const tUSBDHIDCustomHidDevice *psDevice,
+                                       tCompositeEntry *psCompEntry);
 void USBDHIDCustomHidTerm(void *pvInstance);
 void *USBDHIDCustomHidSetCBData(void *pvInstance, void *pvCBData);
 void USBDHIDCustomHidPowerStatusSet(void *pvInstance,
@@ -589,7 +591,7 @@ USBDHIDNirscanNanoInit(unsigned long ulIndex, const tUSBDHIDCustomHidDevice *psD
     //
     // Call the common initialization routine.
     //
-    pvHIDInstance = USBDHIDCustomHidCompositeInit(ulIndex, psDevice);
+    pvHIDInstance = USBDHIDCustomHidCompositeInit(ulIndex, psDevice, 0);
 
     //
     // If we initialized the HID layer successfully, pass our device pointer
@@ -620,10 +622,13 @@ USBDHIDNirscanNanoInit(unsigned long ulIndex, const tUSBDHIDCustomHidDevice *psD
 //! initialized for HID customhid device operation.
 //! \param psDevice points to a structure containing parameters customizing
 //! the operation of the HID customhid device.
+//! \param psCompEntry is the composite device entry to initialize when
+//! creating a composite device, or 0 for a standalone HID device.
 //!
-//! This call is very similar to USBDHIDCustomHidInit() except that it is used for
-//! initializing an instance of the HID customhid device for use in a composite
-//! device.
+//! This call is very similar to USBDHIDNirscanNanoInit() except that it is
+//! used for initializing an instance of the HID customhid device for use in a
+//! composite device.  USBDCompositeInit() must be called once all the entries
+//! have been initialized.
 //!
 //! \return Returns zero on failure or a non-zero instance value that should be
 //! used with the remaining USB HID CustomHid APIs.
@@ -631,7 +636,8 @@ USBDHIDNirscanNanoInit(unsigned long ulIndex, const tUSBDHIDCustomHidDevice *psD
 //*****************************************************************************
 void *
 USBDHIDCustomHidCompositeInit(unsigned long ulIndex,
-                          const tUSBDHIDCustomHidDevice *psDevice)
+                          const tUSBDHIDCustomHidDevice *psDevice,
+                          tCompositeEntry *psCompEntry)
 {
     tHIDCustomHidInstance *psInst;
     tUSBDHIDDevice *psHIDDevice;
@@ -697,7 +703,9 @@ USBDHIDCustomHidCompositeInit(unsigned long ulIndex,
     // Initialize the lower layer HID driver and pass it the various structures
     // and descriptors necessary to declare that we are a keyboard.
     //
-    return(USBDHIDCompositeInit(ulIndex, psHIDDevice, 0));
+    pvHIDInstance = USBDHIDCompositeInit(ulIndex, psHIDDevice, psCompEntry);
+
+    return(pvHIDInstance);
 }
 
 //*****************************************************************************
@@ -818,7 +826,6 @@ USBDHIDCustomHidResponse(tUSBDHIDCustomHidDevice *psDevice, signed char HIDData[
 {
     unsigned long ulRetcode;
     unsigned long ulCount;
-    int i;
     tHIDCustomHidInstance *psInst;
     tUSBDHIDDevice *psHIDDevice;
 
@@ -833,10 +840,7 @@ USBDHIDCustomHidResponse(tUSBDHIDCustomHidDevice *psDevice, signed char HIDData[
     psInst = psDevice->psPrivateHIDCustomHidData;
 
 
-    for(i = 0; i < numBytes; i++)
-	{
-		psInst->pucReport[i] = HIDData[i];; //No ReportID so no offset
-	}
+    memcpy(psInst->pucReport, HIDData, numBytes); //No ReportID so no offset
 
     //Round up to next multiple of 64.
     numBytes = (( numBytes + CUSTOMHID_REPORT_SIZE -1 )/CUSTOMHID_REPORT_SIZE) * CUSTOMHID_REPORT_SIZE;
@@ -889,6 +893,85 @@ USBDHIDCustomHidResponse(tUSBDHIDCustomHidDevice *psDevice, signed char HIDData[
     return(ulRetcode);
 }
 
+//*****************************************************************************
+//
+//! Sends a block of data to the USB host as consecutive raw reports.
+//!
+//! \param psDevice is the pointer to the customhid device instance structure.
+//! \param pucData is the data to be sent to the host.
+//! \param numBytes is the number of bytes to be sent; must be a multiple of
+//! CUSTOMHID_REPORT_SIZE.
+//!
+//! Unlike USBDHIDCustomHidResponse() the data is not copied into the report
+//! buffer; the HID layer reads it straight from \e pucData while the transfer
+//! is in progress. The caller must leave the data untouched until
+//! USBDHIDCustomHidTxIdle() returns \b true. The HID layer keeps the transfer
+//! length in 16 bits so \e numBytes must be below 64KB.
+//!
+//! \return Returns \b CUSTOMHID_SUCCESS on success, \b CUSTOMHID_ERR_TX_ERROR if
+//! the transfer could not be scheduled or \b CUSTOMHID_ERR_NOT_CONFIGURED if
+//! called before a host has connected to and configured the device.
+//
+//*****************************************************************************
+unsigned long
+USBDHIDCustomHidStream(tUSBDHIDCustomHidDevice *psDevice,
+                       const unsigned char *pucData, int numBytes)
+{
+    tHIDCustomHidInstance *psInst;
+    tUSBDHIDDevice *psHIDDevice;
+
+    ASSERT((numBytes % CUSTOMHID_REPORT_SIZE) == 0);
+    ASSERT(numBytes < 0x10000);
+
+    psHIDDevice = &psDevice->psPrivateHIDCustomHidData->sHIDDevice;
+    psInst = psDevice->psPrivateHIDCustomHidData;
+
+    if(!psInst->ucUSBConfigured)
+    {
+        return(CUSTOMHID_ERR_NOT_CONFIGURED);
+    }
+
+    //Wait for previous TX to complete
+    while(psInst->eCustomHidState != HID_CUSTOMHID_STATE_IDLE);	//Wait
+
+    if(!USBDHIDTxPacketAvailable((void *)psHIDDevice))
+    {
+        return(CUSTOMHID_ERR_TX_ERROR);
+    }
+
+    psInst->eCustomHidState = HID_CUSTOMHID_STATE_SEND;
+    if(!USBDHIDReportWrite((void *)psHIDDevice, (unsigned char *)pucData,
+                           numBytes, true))
+    {
+        //
+        // Nothing was scheduled so no TX complete event will follow.
+        //
+        psInst->eCustomHidState = HID_CUSTOMHID_STATE_IDLE;
+        return(CUSTOMHID_ERR_TX_ERROR);
+    }
+
+    return(CUSTOMHID_SUCCESS);
+}
+
+//*****************************************************************************
+//
+//! Tells whether the last report or stream has been sent.
+//!
+//! \param psDevice is the pointer to the customhid device instance structure.
+//!
+//! \return Returns \b true when no transmission is in progress, including when
+//! the host is not connected, \b false otherwise.
+//
+//*****************************************************************************
+bool
+USBDHIDCustomHidTxIdle(tUSBDHIDCustomHidDevice *psDevice)
+{
+    tHIDCustomHidInstance *psInst = psDevice->psPrivateHIDCustomHidData;
+
+    return(!psInst->ucUSBConfigured ||
+           (psInst->eCustomHidState == HID_CUSTOMHID_STATE_IDLE));
+}
+
 //*****************************************************************************
 //
 //! Reports the device power status (bus- or self-powered) to the USB library.
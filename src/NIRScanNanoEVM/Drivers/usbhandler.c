@@ -24,6 +24,12 @@
 #include "driverlib/usb.h"
 #include <usblib/device/usbdevice.h>
 #include <usblib/device/usbdhid.h>
+#include "common.h"
+#ifdef NIRSCAN_USB_BULK
+#include <usblib/device/usbdbulk.h>
+#include <usblib/device/usbdcomp.h>
+#include "usbBulk.h"
+#endif
 #include "usbdhidcustom.h"
 #include "usbCmdHandler.h"
 #include "usbhandler.h"
@@ -48,6 +54,11 @@ tUSBDHIDDevice dlpDevice;
 static USBMDEventType cbUSBEvent(void *cbData, USBMDEventType event,
 									unsigned int eventMsg,
                                      void *eventMsgPtr);
+#ifdef NIRSCAN_USB_BULK
+static USBMDEventType cbUSBBulkEvent(void *cbData, USBMDEventType event,
+									unsigned int eventMsg,
+                                     void *eventMsgPtr);
+#endif
 
 /* The languages supported by this device. */
 const unsigned char langDescriptor[] =
@@ -131,6 +142,49 @@ tUSBDHIDCustomHidDevice NirscanNanoDevice =
     &deviceInstance
 };
 
+#ifdef NIRSCAN_USB_BULK
+/*
+ * Vendor specific bulk interface for large transfers. The interface string
+ * and configuration string indices come from the usblib bulk descriptors.
+ */
+tUSBDBulkDevice NirscanBulkDevice =
+{
+	0x0451,  // Vendor ID
+    0x4200,  // Product ID
+    500,
+    USB_CONF_ATTR_SELF_PWR | USB_CONF_ATTR_RWAKE,
+    cbUSBBulkEvent,
+    (void *)&NirscanBulkDevice,
+    cbUSBBulkEvent,
+    (void *)&NirscanBulkDevice,
+    stringDescriptors,
+    STRINGDESCRIPTORSCOUNT
+};
+
+#define NUM_COMPOSITE_DEVICES	2
+#define COMPOSITE_DESCRIPTOR_SIZE	(COMPOSITE_DHID_SIZE + COMPOSITE_DBULK_SIZE)
+
+static tCompositeEntry compositeEntries[NUM_COMPOSITE_DEVICES];
+static uint8_t compositeDescriptorData[COMPOSITE_DESCRIPTOR_SIZE];
+
+/*
+ * HID command interface (interface 0) and bulk interface (interface 1) in one
+ * configuration. The composite layer renumbers the interfaces and endpoints.
+ */
+tUSBDCompositeDevice NirscanCompositeDevice =
+{
+	0x0451,  // Vendor ID
+    0x4200,  // Product ID
+    500,
+    USB_CONF_ATTR_SELF_PWR | USB_CONF_ATTR_RWAKE,
+    0,       // Events are handled per interface
+    stringDescriptors,
+    STRINGDESCRIPTORSCOUNT,
+    NUM_COMPOSITE_DEVICES,
+    compositeEntries
+};
+#endif
+
 /*
  *  ======== cbUSBEvent ========
  *  Callback handler for the USB stack.
@@ -177,6 +231,41 @@ static USBMDEventType cbUSBEvent (void *cbData, USBMDEventType event,
     return (0);
 }
 
+#ifdef NIRSCAN_USB_BULK
+/*
+ *  ======== cbUSBBulkEvent ========
+ *  Callback handler for the bulk interface, used for both the receive and
+ *  the transmit channel. Called from the USB interrupt.
+ */
+static USBMDEventType cbUSBBulkEvent (void *cbData, USBMDEventType event,
+                                      unsigned int eventMsgData,
+                                      void *eventMsgPtr)
+{
+    switch (event) {
+        case USB_EVENT_CONNECTED:
+        	UsbBulk_Connected();
+            break;
+
+        case USB_EVENT_DISCONNECTED:
+        	UsbBulk_Disconnected();
+            break;
+
+        case USB_EVENT_RX_AVAILABLE:
+        	UsbBulk_RxAvailable();
+            break;
+
+        case USB_EVENT_TX_COMPLETE:
+        	UsbBulk_TxComplete();
+            break;
+
+        default:
+            break;
+    }
+
+    return (0);
+}
+#endif
+
 /*
  *  ======== USB_hwiHandler ========
  *  This function calls the USB library's device interrupt handler.
@@ -195,6 +284,19 @@ void USBHandler_init(void)
     /* Set the USB stack mode to Device mode with VBUS monitoring */
     USBStackModeSet(0, eUSBModeForceDevice, 0);
 
+#ifdef NIRSCAN_USB_BULK
+    /*
+     * Set up the HID and bulk interfaces as entries of a composite device,
+     * then initialize the USB controller and connect it to the bus.
+     */
+    if (!USBDHIDCustomHidCompositeInit(0, &NirscanNanoDevice,
+                                       &compositeEntries[0]) ||
+        !USBDBulkCompositeInit(0, &NirscanBulkDevice, &compositeEntries[1]) ||
+        !USBDCompositeInit(0, &NirscanCompositeDevice,
+                           COMPOSITE_DESCRIPTOR_SIZE, compositeDescriptorData)) {
+        System_abort("Error initializing USB Handler");
+    }
+#else
     /*
      * Pass our device information to the USB HID device class driver,
      * initialize the USB controller and connect the device to the bus.
@@ -202,6 +304,7 @@ void USBHandler_init(void)
     if (!USBDHIDNirscanNanoInit(0, &NirscanNanoDevice)) {
         System_abort("Error initializing USB Handler");
     }
+#endif
 
 }
 
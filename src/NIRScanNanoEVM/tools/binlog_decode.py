@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""
+Renders the deferred binary log of the NIRscan Nano firmware (see
+App/include/binLog.h).
+
+The device logs the address of each format string instead of the text, so
+the decoder needs the .out image the firmware was built into. Format strings
+and constant %s arguments are read from its loadable sections; strings built
+at run time come copied into the record.
+
+    binlog_decode.py NIRscanNano.out capture.bin
+    binlog_decode.py --text NIRscanNano.out ccs_console.txt
+
+The first form reads the raw bytes captured from the UART console, the second
+the NLOG lines the firmware prints on the CCS console.
+
+Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ALL RIGHTS RESERVED
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+BIN_LOG_SYNC = 0x474F4C4E
+BIN_LOG_STR_INLINE = 0xFFFF0000
+BIN_LOG_MAX_ARGS = 8
+BIN_LOG_MAX_STR_WORDS = BIN_LOG_MAX_ARGS * 32 // 4
+SHF_ALLOC = 0x2
+SHT_PROGBITS = 1
+
+FORMAT_SPEC = re.compile(r'%([-+ 0#]*)(\d*)(?:\.(\d+))?(l{0,2}|h{0,2})([diuxXcsp%])')
+
+
+class Image(object):
+    """Loadable contents of an ELF file, looked up by target address"""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+            raise ValueError('%s is not a 32-bit little endian ELF file' % path)
+
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = \
+                struct.unpack_from('<IIIIII', data, shoff + i * shentsize)
+            if sh_type == SHT_PROGBITS and (flags & SHF_ALLOC) and size > 0:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        for base, contents in self.sections:
+            if base <= addr < base + len(contents):
+                end = contents.find(b'\0', addr - base)
+                if end < 0:
+                    end = len(contents)
+                return contents[addr - base:end].decode('latin-1')
+        return None
+
+
+def render(image, fmt, args, strings=b''):
+    """printf() as implemented by UARTprintf()/System_printf(), on 32-bit words.
+    strings holds the %s arguments copied into the record"""
+    args = list(args)
+
+    def one(match):
+        flags, width, precision, _, conv = match.groups()
+        if conv == '%':
+            return '%'
+        value = args.pop(0) if args else 0
+        if conv in 'di':
+            value = value - (1 << 32) if value & 0x80000000 else value
+            text = str(value)
+        elif conv == 'u':
+            text = str(value)
+        elif conv in 'xX':
+            text = '%x' % value if conv == 'x' else '%X' % value
+        elif conv == 'p':
+            text = '0x%08x' % value
+        elif conv == 'c':
+            text = chr(value & 0xFF)
+        else:
+            if value & 0xFFFF0000 == BIN_LOG_STR_INLINE:
+                start = value & 0xFFFF
+                end = strings.find(b'\0', start)
+                text = strings[start:end if end >= 0 else len(strings)].decode('latin-1')
+            else:
+                text = image.string(value)
+            if text is None:
+                text = '<string at 0x%08x>' % value
+            elif precision:
+                text = text[:int(precision)]
+        width = int(width) if width else 0
+        if '-' in flags:
+            return text.ljust(width)
+        if '0' in flags and conv not in 'sc':
+            sign = '-' if text.startswith('-') else ''
+            return sign + text.lstrip('-').rjust(width - len(sign), '0')
+        return text.rjust(width)
+
+    return FORMAT_SPEC.sub(one, fmt)
+
+
+def split_words(header, words):
+    """Splits the words after the timestamp into arguments and string bytes"""
+    num_args = header & 0xFF
+    return words[:num_args], struct.pack('<%dI' % (len(words) - num_args), *words[num_args:])
+
+
+def records_from_bytes(data):
+    """Yields (header, format, timestamp, words) from a raw UART capture"""
+    pos = 0
+    sync = struct.pack('<I', BIN_LOG_SYNC)
+    while True:
+        pos = data.find(sync, pos)
+        if pos < 0 or pos + 16 > len(data):
+            return
+        header, fmt, cycles = struct.unpack_from('<III', data, pos + 4)
+        num_args = header & 0xFF
+        num_str_words = (header >> 8) & 0xFF
+        end = pos + 16 + 4 * (num_args + num_str_words)
+        if num_args > BIN_LOG_MAX_ARGS or num_str_words > BIN_LOG_MAX_STR_WORDS or end > len(data):
+            pos += 1
+            continue
+        yield header, fmt, cycles, struct.unpack_from('<%dI' % (num_args + num_str_words), data, pos + 16)
+        pos = end
+
+
+def records_from_text(lines):
+    """Yields (header, format, timestamp, words) from NLOG console lines"""
+    for line in lines:
+        fields = line.split()
+        if len(fields) < 4 or fields[0] != 'NLOG':
+            continue
+        try:
+            words = [int(f, 16) for f in fields[1:]]
+        except ValueError:
+            continue
+        if len(words) != 3 + (words[0] & 0xFF) + ((words[0] >> 8) & 0xFF):
+            continue
+        yield words[0], words[1], words[2], words[3:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('image', help='firmware image (.out) the log was made with')
+    parser.add_argument('log', help='captured log; - for standard input')
+    parser.add_argument('--text', action='store_true', help='log is CCS console text')
+    parser.add_argument('--clock', type=float, default=120e6,
+                        help='CPU clock in Hz for the timestamps (default 120 MHz)')
+    args = parser.parse_args()
+
+    image = Image(args.image)
+    if args.text:
+        log = sys.stdin if args.log == '-' else open(args.log)
+        records = records_from_text(log)
+    else:
+        log = sys.stdin.buffer if args.log == '-' else open(args.log, 'rb')
+        records = records_from_bytes(log.read())
+
+    expected_seq = None
+    elapsed = 0
+    last_cycles = None
+    for header, fmt, cycles, words in records:
+        values, strings = split_words(header, words)
+        seq = header >> 16
+        if expected_seq is not None and seq != expected_seq:
+            print('---- %d records lost in transfer ----' % ((seq - expected_seq) & 0xFFFF))
+        expected_seq = (seq + 1) & 0xFFFF
+
+        # The 32-bit cycle counter wraps every 35 s at 120 MHz. A record can
+        # carry a slightly older timestamp than the one before it when its
+        # log call was interrupted by another
+        if last_cycles is not None:
+            delta = (cycles - last_cycles) & 0xFFFFFFFF
+            elapsed += delta - (1 << 32) if delta & 0x80000000 else delta
+        last_cycles = cycles
+        stamp = '[%12.6f]' % (elapsed / args.clock)
+
+        if fmt == 0:
+            print('%s ---- %d log calls dropped, ring full ----' % (stamp, values[0] if values else 0))
+            continue
+        text = image.string(fmt)
+        if text is None:
+            text = '<unknown format 0x%08x>' % fmt + ' %x' * len(values)
+        print('%s %s' % (stamp, render(image, text, values, strings).replace('\r', '').strip('\n')))
+
+
+if __name__ == '__main__':
+    main()
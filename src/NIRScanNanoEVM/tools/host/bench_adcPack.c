@@ -0,0 +1,106 @@
+/*
+ *
+ * Host benchmark of the packed ADC data of slew scans: blob sizes plain and
+ * packed, and pack/unpack time per scan, for typical scan configurations.
+ * Host times only compare configurations; the TM4C129 is much slower.
+ *
+ *     make -C tools/host bench
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "dlpspec_scan.h"
+#include "dlpspec_compress.h"
+#include "host_scan.h"
+
+#define BENCH_RUNS	20000
+
+typedef struct
+{
+	int		num_patterns;
+	bool	hadamard;
+	double	noise;
+	int		pga;
+} BENCH_CONFIG;
+
+static const BENCH_CONFIG configs[] =
+{
+	{ 228, false, 150, 64 },
+	{ 228, false, 30, 64 },
+	{ 624, false, 150, 64 },
+	{ 624, false, 1500, 64 },
+	{ 228, true, 150, 64 },
+	{ 624, true, 150, 64 },
+	{ 100, false, 0, 1 },
+};
+
+static double Now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+	static uScanData scan;
+	static uint8_t blob[SCAN_DATA_BLOB_SIZE];
+	static uint8_t stream[SCAN_DATA_BLOB_SIZE];
+	static int32_t samples[ADC_DATA_LEN];
+	size_t plainSize;
+	size_t packedSize;
+	size_t streamSize;
+	uint16_t num_samples;
+	double start, packTime, unpackTime;
+	unsigned c;
+	int n, i;
+
+	srand(1);
+	for(c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+	{
+		host_scan_make(&scan, configs[c].num_patterns, configs[c].hadamard,
+				configs[c].noise, configs[c].pga);
+		n = scan.slew_data.adc_data_length;
+		if((dlpspec_scan_write_data_encoded(&scan, blob, sizeof(blob),
+					ADC_DATA_ENCODING_RAW, &plainSize) != DLPSPEC_PASS) ||
+				(dlpspec_scan_write_data_encoded(&scan, blob, sizeof(blob),
+					ADC_DATA_ENCODING_RICE, &packedSize) != DLPSPEC_PASS))
+		{
+			printf("bench_adcPack: serializing failed\n");
+			return 1;
+		}
+
+		start = Now();
+		for(i = 0; i < BENCH_RUNS; i++)
+			dlpspec_adc_pack(scan.slew_data.adc_data, n, scan.slew_data.black_pattern_first,
+					scan.slew_data.black_pattern_period, stream, sizeof(stream), &streamSize);
+		packTime = (Now() - start) / BENCH_RUNS;
+
+		start = Now();
+		for(i = 0; i < BENCH_RUNS; i++)
+			dlpspec_adc_unpack(stream, streamSize, samples, ADC_DATA_LEN, &num_samples);
+		unpackTime = (Now() - start) / BENCH_RUNS;
+
+		if(memcmp(samples, scan.slew_data.adc_data, n * sizeof(int32_t)))
+		{
+			printf("bench_adcPack: unpacked samples differ\n");
+			return 1;
+		}
+
+		printf("%s %3d patterns noise %4.0f: blob %5zu -> %5zu B (%.2fx), "
+				"ADC %4d -> %4zu B (%.2f bits/sample), pack %.2f us, unpack %.2f us\n",
+				configs[c].hadamard ? "hadamard" : "column  ", configs[c].num_patterns,
+				configs[c].noise, plainSize, packedSize, (double)plainSize / packedSize,
+				n * 4, streamSize, streamSize * 8.0 / n, packTime * 1e6, unpackTime * 1e6);
+	}
+	return 0;
+}
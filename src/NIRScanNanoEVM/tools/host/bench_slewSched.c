@@ -0,0 +1,127 @@
+/*
+ *
+ * Host benchmark of the slew scan section ordering (App/slewSched.c) against
+ * the packer Scan_SetUpSlewScan() had before, which ran the sections in
+ * configuration order: pattern display time per scan repeat at the 60 Hz
+ * DLPC150 input frame rate for some multi-section configurations and for
+ * random ones, and the time the order search takes. Host times only compare
+ * the two; the TM4C129 is much slower.
+ *
+ *     make -C tools/host bench
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "display.h"
+#include "host_slewSched.h"
+
+#define BENCH_RANDOM	20000
+#define BENCH_RUNS		200
+#define BENCH_FRAME_US	(1000000 / 60)
+/* Frames before the first pattern is on the DMD, as in App/common.h */
+#define BENCH_DELAY_FRAMES	3
+
+typedef struct
+{
+	const char			*name;
+	int					num_sections;
+	SLEW_SCHED_SECTION	sect[SLEW_SCAN_MAX_SECTIONS];
+} BENCH_CONFIG;
+
+static const BENCH_CONFIG configs[] =
+{
+	{ "1 section, 228 x 635 us", 1, { { 228, 635 } } },
+	{ "2 sections, 5080 / 635 us", 2, { { 30, 5080 }, { 200, 635 } } },
+	{ "3 sections, 635 / 30480 / 635 us", 3, { { 100, 635 }, { 10, 30480 }, { 100, 635 } } },
+	{ "3 sections, 2450 / 635 / 5080 us", 3, { { 50, 2450 }, { 150, 635 }, { 40, 5080 } } },
+	{ "5 sections, mixed", 5, { { 37, 1270 }, { 61, 635 }, { 13, 15240 }, { 90, 2450 }, { 23, 5080 } } },
+};
+
+static int vsyncs[HOST_SLEW_MAX_VSYNCS + 4];
+static int frames[NUM_FRAMEBUFFERS * 4];
+
+static double Now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int GreedyFrames(const SLEW_SCHED_SECTION *pSect, int num_sections)
+{
+	int num_vsyncs, num_frames;
+
+	return host_slew_greedy_pack(pSect, num_sections, vsyncs, &num_vsyncs, frames, &num_frames);
+}
+
+static int BestFrames(const SLEW_SCHED_SECTION *pSect, int num_sections)
+{
+	uint8_t order[SLEW_SCAN_MAX_SECTIONS];
+
+	return SlewSched_FindBestOrder(pSect, num_sections, HOST_SLEW_MAX_VSYNCS, NUM_FRAMEBUFFERS, order);
+}
+
+static double DisplayMs(int total_frames)
+{
+	return (total_frames + BENCH_DELAY_FRAMES) * (double)BENCH_FRAME_US / 1000;
+}
+
+int main(void)
+{
+	SLEW_SCHED_SECTION sect[SLEW_SCAN_MAX_SECTIONS];
+	double greedy_ms = 0, best_ms = 0, max_saved_ms = 0;
+	double t0, t_greedy, t_best;
+	int num_sections;
+	int greedy, best;
+	int fewer = 0;
+	int i, n;
+
+	printf("%-34s %14s %14s\n", "", "config order", "best order");
+	for(i=0; i<(int)(sizeof(configs)/sizeof(configs[0])); i++)
+	{
+		greedy = GreedyFrames(configs[i].sect, configs[i].num_sections);
+		best = BestFrames(configs[i].sect, configs[i].num_sections);
+		printf("%-34s %3d fr %6.1f ms %3d fr %6.1f ms\n", configs[i].name,
+				greedy, DisplayMs(greedy), best, DisplayMs(best));
+	}
+
+	srand(29);
+	for(n=0; n<BENCH_RANDOM; n++)
+	{
+		num_sections = host_slew_make(sect, MAX_PATTERNS_PER_SCAN);
+		greedy = GreedyFrames(sect, num_sections);
+		best = BestFrames(sect, num_sections);
+		greedy_ms += DisplayMs(greedy);
+		best_ms += DisplayMs(best);
+		if(best < greedy)
+			fewer++;
+		if(DisplayMs(greedy) - DisplayMs(best) > max_saved_ms)
+			max_saved_ms = DisplayMs(greedy) - DisplayMs(best);
+	}
+	printf("%d random configs: %.1f ms config order, %.1f ms best order on average; "
+			"%d shorter, at most by %.1f ms\n", BENCH_RANDOM, greedy_ms / BENCH_RANDOM,
+			best_ms / BENCH_RANDOM, fewer, max_saved_ms);
+
+	/* Search cost, on the five section configuration that has the most orders */
+	t0 = Now();
+	for(n=0; n<BENCH_RUNS; n++)
+		GreedyFrames(configs[4].sect, configs[4].num_sections);
+	t_greedy = (Now() - t0) / BENCH_RUNS;
+	t0 = Now();
+	for(n=0; n<BENCH_RUNS; n++)
+		BestFrames(configs[4].sect, configs[4].num_sections);
+	t_best = (Now() - t0) / BENCH_RUNS;
+	printf("packing \"%s\": %.2f us config order, %.2f us for all 120 orders\n",
+			configs[4].name, t_greedy * 1e6, t_best * 1e6);
+
+	return 0;
+}
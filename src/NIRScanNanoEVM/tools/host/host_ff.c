@@ -0,0 +1,207 @@
+/*
+ *
+ * RAM file system behind the FatFs API in stub/, for host tests of the SD
+ * card code. Paths are kept as given; directories are not modelled.
+ *
+ * host_ff_tear_write(n) simulates a power loss: the n-th f_write() from
+ * then on stores only half of its data and fails. A file grown by f_lseek()
+ * is filled with noise, as a reused cluster on the card would be.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ti/sysbios/fatfs/ff.h>
+#include "host_ff.h"
+
+#define HOST_FF_MAX_FILES	16
+
+typedef struct
+{
+	bool	used;
+	char	name[64];
+	uint8_t	*data;
+	DWORD	size;
+} HOST_FF_FILE;
+
+static HOST_FF_FILE files[HOST_FF_MAX_FILES];
+static int tearCountdown = -1;
+static DWORD fatTime = 0x47210000;
+
+static HOST_FF_FILE *HostFF_Find(const char *path)
+{
+	int i;
+
+	for(i = 0; i < HOST_FF_MAX_FILES; i++)
+		if(files[i].used && !strcmp(files[i].name, path))
+			return &files[i];
+	return NULL;
+}
+
+static void HostFF_Resize(HOST_FF_FILE *pFile, DWORD size)
+{
+	DWORD i;
+
+	pFile->data = realloc(pFile->data, size ? size : 1);
+	for(i = pFile->size; i < size; i++)
+		pFile->data[i] = (uint8_t)rand();
+	pFile->size = size;
+}
+
+void host_ff_reset(void)
+{
+	int i;
+
+	for(i = 0; i < HOST_FF_MAX_FILES; i++)
+		free(files[i].data);
+	memset(files, 0, sizeof(files));
+	tearCountdown = -1;
+}
+
+void host_ff_tear_write(int n)
+{
+	tearCountdown = n;
+}
+
+void host_ff_set_time(DWORD time)
+{
+	fatTime = time;
+}
+
+DWORD get_fattime(void)
+{
+	return fatTime;
+}
+
+FRESULT f_open(FIL *fp, const char *path, BYTE mode)
+{
+	HOST_FF_FILE *pFile = HostFF_Find(path);
+	int i;
+
+	if(pFile == NULL)
+	{
+		if(!(mode & (FA_CREATE_ALWAYS | FA_OPEN_ALWAYS | FA_CREATE_NEW)))
+			return FR_NO_FILE;
+		for(i = 0; (i < HOST_FF_MAX_FILES) && files[i].used; i++)
+			;
+		if(i == HOST_FF_MAX_FILES)
+			return FR_TOO_MANY_OPEN_FILES;
+		pFile = &files[i];
+		pFile->used = true;
+		strncpy(pFile->name, path, sizeof(pFile->name) - 1);
+	}
+	else if(mode & FA_CREATE_NEW)
+		return FR_EXIST;
+
+	if(mode & FA_CREATE_ALWAYS)
+		HostFF_Resize(pFile, 0);
+
+	fp->fs = NULL;
+	fp->file = pFile - files;
+	fp->fptr = 0;
+	fp->fsize = pFile->size;
+	return FR_OK;
+}
+
+FRESULT f_close(FIL *fp)
+{
+	fp->file = -1;
+	return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+	HOST_FF_FILE *pFile = &files[fp->file];
+
+	if(fp->fptr + btr > pFile->size)
+		btr = (fp->fptr < pFile->size) ? pFile->size - fp->fptr : 0;
+	if(btr)
+		memcpy(buff, pFile->data + fp->fptr, btr);
+	fp->fptr += btr;
+	*br = btr;
+	return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+	HOST_FF_FILE *pFile = &files[fp->file];
+	FRESULT fr = FR_OK;
+
+	if(tearCountdown == 0)
+	{
+		btw /= 2;
+		fr = FR_DISK_ERR;
+	}
+	if(tearCountdown >= 0)
+		tearCountdown--;
+
+	if(fp->fptr + btw > pFile->size)
+		HostFF_Resize(pFile, fp->fptr + btw);
+	memcpy(pFile->data + fp->fptr, buff, btw);
+	fp->fptr += btw;
+	fp->fsize = pFile->size;
+	*bw = btw;
+	return fr;
+}
+
+FRESULT f_lseek(FIL *fp, DWORD ofs)
+{
+	HOST_FF_FILE *pFile = &files[fp->file];
+
+	if(ofs > pFile->size)
+		HostFF_Resize(pFile, ofs);
+	fp->fptr = ofs;
+	fp->fsize = pFile->size;
+	return FR_OK;
+}
+
+FRESULT f_truncate(FIL *fp)
+{
+	HOST_FF_FILE *pFile = &files[fp->file];
+
+	pFile->size = fp->fptr;
+	fp->fsize = pFile->size;
+	return FR_OK;
+}
+
+FRESULT f_sync(FIL *fp)
+{
+	return FR_OK;
+}
+
+FRESULT f_unlink(const char *path)
+{
+	HOST_FF_FILE *pFile = HostFF_Find(path);
+
+	if(pFile == NULL)
+		return FR_NO_FILE;
+	free(pFile->data);
+	memset(pFile, 0, sizeof(HOST_FF_FILE));
+	return FR_OK;
+}
+
+FRESULT f_rename(const char *path_old, const char *path_new)
+{
+	HOST_FF_FILE *pFile = HostFF_Find(path_old);
+
+	if(pFile == NULL)
+		return FR_NO_FILE;
+	if(HostFF_Find(path_new) != NULL)
+		return FR_EXIST;
+	strncpy(pFile->name, path_new, sizeof(pFile->name) - 1);
+	return FR_OK;
+}
+
+FRESULT f_stat(const char *path, FILINFO *fno)
+{
+	HOST_FF_FILE *pFile = HostFF_Find(path);
+
+	if(pFile == NULL)
+		return FR_NO_FILE;
+	memset(fno, 0, sizeof(FILINFO));
+	fno->fsize = pFile->size;
+	return FR_OK;
+}
@@ -0,0 +1,20 @@
+/*
+ *
+ * Test controls of the host RAM file system (host_ff.c)
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#ifndef HOST_FF_H_
+#define HOST_FF_H_
+
+#include <stdbool.h>
+#include <ti/sysbios/fatfs/ff.h>
+
+void host_ff_reset(void);
+void host_ff_tear_write(int n);
+void host_ff_set_time(DWORD time);
+
+#endif /* HOST_FF_H_ */
@@ -0,0 +1,91 @@
+/*
+ *
+ * Single threaded host implementations of the TI-RTOS calls in stub/
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/gates/GateMutex.h>
+#include <ti/sysbios/gates/GateMutexPri.h>
+
+struct GateMutex_Object
+{
+	int depth;
+};
+
+struct GateMutexPri_Object
+{
+	int depth;
+};
+
+UInt32 Clock_tickPeriod = 1000;
+BIOS_ThreadType host_threadType = BIOS_ThreadType_Task;
+
+static UInt32 ticks;
+
+void Error_init(Error_Block *eb)
+{
+	eb->dummy = 0;
+}
+
+BIOS_ThreadType BIOS_getThreadType(void)
+{
+	return host_threadType;
+}
+
+UInt32 Clock_getTicks(void)
+{
+	return ++ticks;
+}
+
+GateMutex_Handle GateMutex_create(void *params, Error_Block *eb)
+{
+	return calloc(1, sizeof(struct GateMutex_Object));
+}
+
+IArg GateMutex_enter(GateMutex_Handle handle)
+{
+	/* Nested entry is allowed, as on the target */
+	return handle->depth++;
+}
+
+void GateMutex_leave(GateMutex_Handle handle, IArg key)
+{
+	if(--handle->depth != key)
+	{
+		fprintf(stderr, "GateMutex_leave: unbalanced\n");
+		abort();
+	}
+}
+
+int GateMutex_depth(GateMutex_Handle handle)
+{
+	return handle->depth;
+}
+
+GateMutexPri_Handle GateMutexPri_create(void *params, Error_Block *eb)
+{
+	return calloc(1, sizeof(struct GateMutexPri_Object));
+}
+
+IArg GateMutexPri_enter(GateMutexPri_Handle handle)
+{
+	return handle->depth++;
+}
+
+void GateMutexPri_leave(GateMutexPri_Handle handle, IArg key)
+{
+	if(--handle->depth != key)
+	{
+		fprintf(stderr, "GateMutexPri_leave: unbalanced\n");
+		abort();
+	}
+}
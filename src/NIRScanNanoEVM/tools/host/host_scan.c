@@ -0,0 +1,75 @@
+/*
+ *
+ * Synthetic slew scans for host tests and benchmarks of dlpspeclib. The ADC
+ * data looks like a lamp spectrum with one absorption line, with a black
+ * pattern every 25 samples, as a one-section scan on the EVM takes it.
+ * Random numbers come from rand(); seed it with srand() for repeatable scans.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "host_scan.h"
+
+#define HOST_SCAN_BLACK_FIRST	24
+#define HOST_SCAN_BLACK_PERIOD	25
+#define HOST_SCAN_DC_LEVEL		42000
+
+static double Gauss(void)
+{
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+void host_scan_make(uScanData *pData, int num_patterns, bool hadamard, double noise, int pga)
+{
+	slewScanData *pSlew = &pData->slew_data;
+	int num_samples = num_patterns + num_patterns / 24;
+	int pattern = 0;
+	int i;
+
+	memset(pData, 0, sizeof(*pData));
+	pSlew->header_version = CUR_SCANDATA_VERSION;
+	strcpy(pSlew->scan_name, "host");
+	pSlew->slewCfg.head.scan_type = SLEW_TYPE;
+	pSlew->slewCfg.head.num_sections = 1;
+	pSlew->slewCfg.head.num_repeats = 6;
+	pSlew->slewCfg.section[0].section_scan_type = hadamard ? HADAMARD_TYPE : COLUMN_TYPE;
+	pSlew->slewCfg.section[0].width_px = 6;
+	pSlew->slewCfg.section[0].wavelength_start_nm = 900;
+	pSlew->slewCfg.section[0].wavelength_end_nm = 1700;
+	pSlew->slewCfg.section[0].num_patterns = num_patterns;
+	pSlew->slewCfg.section[0].exposure_time = T_635_US;
+	pSlew->calibration_coeffs.PixelToWavelengthCoeffs[0] = 1900;
+	pSlew->calibration_coeffs.PixelToWavelengthCoeffs[1] = -0.9;
+	pSlew->adc_data_length = num_samples;
+	pSlew->black_pattern_first = HOST_SCAN_BLACK_FIRST;
+	pSlew->black_pattern_period = HOST_SCAN_BLACK_PERIOD;
+	pSlew->pga = pga;
+
+	for(i = 0; i < num_samples; i++)
+	{
+		double value;
+
+		if((i >= HOST_SCAN_BLACK_FIRST) && ((i - HOST_SCAN_BLACK_FIRST) % HOST_SCAN_BLACK_PERIOD == 0))
+			value = HOST_SCAN_DC_LEVEL + noise * Gauss();
+		else
+		{
+			double x = (double)pattern++ / num_patterns;
+			double signal = 1.8e6 * exp(-pow((x - 0.45) / 0.3, 2)) *
+					(1 - 0.3 * exp(-pow((x - 0.7) / 0.03, 2)));
+
+			/* Hadamard patterns sum about half the columns each */
+			if(hadamard)
+				signal = 0.54e6 + 0.05 * signal * (((pattern * 2654435761u) >> 7) & 1 ? 1 : -1);
+			value = HOST_SCAN_DC_LEVEL + signal * pga / 64.0 + noise * Gauss();
+		}
+		pSlew->adc_data[i] = (int32_t)value;
+	}
+}
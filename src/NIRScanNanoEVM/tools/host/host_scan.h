@@ -0,0 +1,19 @@
+/*
+ *
+ * Synthetic slew scans for host tests and benchmarks of dlpspeclib
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#ifndef HOST_SCAN_H_
+#define HOST_SCAN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dlpspec_scan.h"
+
+void host_scan_make(uScanData *pData, int num_patterns, bool hadamard, double noise, int pga);
+
+#endif /* HOST_SCAN_H_ */
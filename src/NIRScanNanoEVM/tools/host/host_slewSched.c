@@ -0,0 +1,149 @@
+/*
+ *
+ * Reference slew scan packer and random slew configurations for host tests
+ * and benchmarks of App/slewSched.c. host_slew_greedy_pack() is the packing
+ * Scan_SetUpSlewScan() did inline before it moved to slewSched.c; it always
+ * runs the sections in configuration order. Random numbers come from rand();
+ * seed it with srand() for repeatable configurations.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdlib.h>
+#include "host_slewSched.h"
+
+#define VSYNC_ACTIVE_PATTERN_PERIOD 15240
+
+/* The exposure times a slew section can have, see dlpspec_scan_get_exp_time_us() */
+static const uint32_t exp_times_us[] = { 635, 1270, 2450, 5080, 15240, 30480, 60960 };
+
+int host_slew_greedy_pack(const SLEW_SCHED_SECTION *pSect, int num_sections,
+		int *pPatternsPerVsync, int *pNumVsyncs, int *pFrameSyncs, int *pNumFrames)
+{
+	int numPattterns_inFrame = 0;
+	int frameNumber_index = 0;
+	int exp_time_us;
+	uint16_t numPatterns_inSection;
+	int i;
+	int numPatterns_inVsync = 0;
+	int tot_exp_time_inVsync = 0;
+	int vSyncarr_index = 0;
+	int frame_sync_count = 1;
+	int total_frames = 0;
+
+	for(i=0; i<num_sections; i++)
+	{
+		exp_time_us = pSect[i].exp_time_us;
+		numPatterns_inSection = pSect[i].num_patterns;
+
+		while(numPatterns_inSection > 0 )
+		{
+			//special case for exposure time > vsync period
+			if(exp_time_us > VSYNC_ACTIVE_PATTERN_PERIOD)
+			{
+				//close out the previous vysnc and start at next
+				if(numPatterns_inVsync != 0)
+				{
+					if(numPattterns_inFrame == 24)
+					{
+						//dark time for the 25th frame. There is always room for the black pattern exposure
+						numPatterns_inVsync++;
+						pFrameSyncs[frameNumber_index++] = frame_sync_count ;
+						frame_sync_count = 1;
+						numPattterns_inFrame = 0;
+					}
+					pPatternsPerVsync[vSyncarr_index++] = numPatterns_inVsync;
+				}
+				numPattterns_inFrame++;
+				if(exp_time_us > 2*VSYNC_ACTIVE_PATTERN_PERIOD) //4x
+				{
+					pPatternsPerVsync[vSyncarr_index++] = 0;
+					pPatternsPerVsync[vSyncarr_index++] = 0;
+					pPatternsPerVsync[vSyncarr_index++] = 0;
+					if(numPattterns_inFrame == 1)
+						frame_sync_count+=3;
+					else
+						frame_sync_count+=4;
+				}
+				else                                            //2x
+				{
+					pPatternsPerVsync[vSyncarr_index++] = 0;
+					if(numPattterns_inFrame == 1)
+						frame_sync_count++;
+					else
+						frame_sync_count+=2;
+				}
+				numPatterns_inVsync = 1;    //carry over this pattern to next vsync
+				tot_exp_time_inVsync = exp_time_us;
+			}
+			else if((tot_exp_time_inVsync + exp_time_us) > VSYNC_ACTIVE_PATTERN_PERIOD )
+			{
+				if(numPattterns_inFrame == 24)
+				{
+					//dark time for the 25th frame. There is always room for the black pattern exposure
+					numPatterns_inVsync++;
+					pFrameSyncs[frameNumber_index++] = frame_sync_count ;
+					frame_sync_count = 1;
+					numPattterns_inFrame = 1;
+				}
+				else
+				{
+					frame_sync_count++;
+					numPattterns_inFrame++;
+				}
+				pPatternsPerVsync[vSyncarr_index++] = numPatterns_inVsync;
+				numPatterns_inVsync = 1;    //carry over this pattern to next vsync
+				tot_exp_time_inVsync = exp_time_us;
+			}
+			else
+			{
+				if(numPattterns_inFrame == 24)
+				{
+					//dark time for the 25th frame. There is always room for the black pattern exposure
+					pPatternsPerVsync[vSyncarr_index++] = numPatterns_inVsync + 1;
+					pFrameSyncs[frameNumber_index++] = frame_sync_count ;
+					frame_sync_count = 1;
+					numPattterns_inFrame = 1;
+					numPatterns_inVsync = 1;
+					tot_exp_time_inVsync = exp_time_us;
+				}
+				else
+				{
+					numPattterns_inFrame++;
+					numPatterns_inVsync++;
+					tot_exp_time_inVsync += exp_time_us;
+				}
+			}
+			numPatterns_inSection--;
+		}
+	}
+	if(numPatterns_inVsync != 0)
+	{
+		pPatternsPerVsync[vSyncarr_index++] = numPatterns_inVsync;
+		pFrameSyncs[frameNumber_index++] = frame_sync_count;
+	}
+	for(i=0; i<frameNumber_index; i++)
+		total_frames += pFrameSyncs[i];
+
+	*pNumVsyncs = vSyncarr_index;
+	*pNumFrames = frameNumber_index;
+	return total_frames;
+}
+
+int host_slew_make(SLEW_SCHED_SECTION *pSect, int max_patterns)
+{
+	int num_sections = 1 + rand() % SLEW_SCAN_MAX_SECTIONS;
+	int left = max_patterns;
+	int i;
+
+	for(i=0; i<num_sections; i++)
+	{
+		/* Each section gets at least 2 and at most its share of what is left */
+		pSect[i].num_patterns = 2 + rand() % (left / (num_sections - i) - 1);
+		pSect[i].exp_time_us = exp_times_us[rand() % (sizeof(exp_times_us) / sizeof(exp_times_us[0]))];
+		left -= pSect[i].num_patterns;
+	}
+	return num_sections;
+}
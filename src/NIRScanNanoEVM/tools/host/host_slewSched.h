@@ -0,0 +1,23 @@
+/*
+ *
+ * Reference slew scan packer and random slew configurations for host tests
+ * and benchmarks of App/slewSched.c
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#ifndef HOST_SLEWSCHED_H_
+#define HOST_SLEWSCHED_H_
+
+#include "slewSched.h"
+
+/* From App/scan.c; g_patternsPerVsyncarr has this many entries */
+#define HOST_SLEW_MAX_VSYNCS	2496
+
+int host_slew_greedy_pack(const SLEW_SCHED_SECTION *pSect, int num_sections,
+		int *pPatternsPerVsync, int *pNumVsyncs, int *pFrameSyncs, int *pNumFrames);
+int host_slew_make(SLEW_SCHED_SECTION *pSect, int max_patterns);
+
+#endif /* HOST_SLEWSCHED_H_ */
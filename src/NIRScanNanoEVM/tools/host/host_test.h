@@ -0,0 +1,32 @@
+/*
+ *
+ * Check macro and result line shared by the host tests
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	do { if(!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+/* Prints the result line of the test and returns its exit status */
+static inline int host_test_result(const char *name)
+{
+	if(failures)
+	{
+		printf("%s: %d failures\n", name, failures);
+		return 1;
+	}
+	printf("%s: passed\n", name);
+	return 0;
+}
+
+#endif /* HOST_TEST_H_ */
@@ -0,0 +1,294 @@
+/*
+ *
+ * Host simulation of BLE scan data transfer: the bulk transfer engine
+ * (BLE/App/BLEBulkXfer.c) against the loop it replaced, which sent one
+ * notification at a time with an 8-bit index and stopped at the first one
+ * the stack refused. The model has the Bluetopia GATT queue, the
+ * controller's ACL buffers and an LE link that sends up to a fixed number
+ * of 27-byte LL packets per connection event (no data length extension).
+ * A client reassembles what comes out of the link.
+ *
+ *     make -C tools/host bench
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "BTErrors.h"
+#include "BLEBulkXfer.h"
+
+#define SIM_CI_MS			30.0		/* connection interval */
+#define SIM_LL_PER_EVENT	6			/* LL packets the link sends per event */
+#define SIM_LL_PAYLOAD		27			/* LL payload without data length extension */
+#define SIM_BLOB_SIZE		3822		/* scan data blob */
+#define SIM_MAX_QUEUE		64
+#define SIM_MAX_PKT			200
+#define SIM_MAX_DATA		70000
+
+typedef struct
+{
+	double	ms;
+	long	wakeups;
+	bool	ok;
+} SIM_RESULT;
+
+/* GATT queue of the connection */
+static uint8_t queue[SIM_MAX_QUEUE][SIM_MAX_PKT];
+static int queueLength[SIM_MAX_QUEUE];
+static int queueHead;
+static int queueCount;
+static int queueMax;
+static int queueWake;			/* buffer empty once the queue is down to this */
+static int fragsLeft;			/* LL packets of the head notification still to go */
+static bool refused;
+
+/* Controller */
+static int ctrlBufs;
+static int ctrlFree;
+static int ctrlQueued;
+
+/* Client */
+static uint8_t rx[SIM_MAX_DATA];
+static uint32_t rxLength;
+static uint32_t rxTotal;
+static uint32_t rxSeq;
+static bool rxBad;
+static bool rxGotSize;
+
+/* The old loop */
+static const uint8_t *oldData;
+static uint32_t oldLeft;
+static uint32_t oldPos;
+static int oldIndex;
+static bool oldSizeSent;
+
+static int Frags(int length)
+{
+	/* L2CAP and ATT headers */
+	return (length + 4 + 3 + SIM_LL_PAYLOAD - 1) / SIM_LL_PAYLOAD;
+}
+
+static void ClientReceive(const uint8_t *pPkt, int length, bool seq16)
+{
+	uint32_t seq;
+
+	if(seq16)
+	{
+		seq = pPkt[0] | (pPkt[1] << 8);
+		if(seq != (rxSeq & 0xFFFF))
+		{
+			rxBad = true;
+			return;
+		}
+		if(rxSeq++ == 0)
+		{
+			rxTotal = pPkt[2] | (pPkt[3] << 8) | (pPkt[4] << 16) | ((uint32_t)pPkt[5] << 24);
+			rxGotSize = (length == BLE_BULK_XFER_SIZE_PKT_LEN);
+			return;
+		}
+		memcpy(&rx[rxLength], &pPkt[2], length - 2);
+		rxLength += length - 2;
+	}
+	else
+	{
+		/* The client cannot tell index 0 of packet 256 from the size packet */
+		seq = pPkt[0];
+		if(seq != (rxSeq & 0xFF))
+		{
+			rxBad = true;
+			return;
+		}
+		if((rxSeq++ == 0) && (length == 5))
+		{
+			rxTotal = pPkt[1] | (pPkt[2] << 8) | (pPkt[3] << 16) | ((uint32_t)pPkt[4] << 24);
+			rxGotSize = true;
+			return;
+		}
+		memcpy(&rx[rxLength], &pPkt[1], length - 1);
+		rxLength += length - 1;
+	}
+}
+
+static int StackSend(void *pCtx, uint16_t length, uint8_t *pPkt)
+{
+	int slot = (queueHead + queueCount) % SIM_MAX_QUEUE;
+
+	(void)pCtx;
+	if(queueCount >= queueMax)
+	{
+		refused = true;
+		return BTPS_ERROR_INSUFFICIENT_BUFFER_SPACE;
+	}
+	memcpy(queue[slot], pPkt, length);
+	queueLength[slot] = length;
+	if(queueCount == 0)
+		fragsLeft = Frags(length);
+	queueCount++;
+	return 0;
+}
+
+static void OldPump(int pktSize)
+{
+	uint8_t pkt[SIM_MAX_PKT];
+	int length;
+
+	if(!oldSizeSent)
+	{
+		pkt[0] = 0;
+		pkt[1] = oldLeft & 0xFF;
+		pkt[2] = (oldLeft >> 8) & 0xFF;
+		pkt[3] = pkt[4] = 0;
+		StackSend(NULL, 5, pkt);
+		oldSizeSent = true;
+	}
+	while(oldLeft > 0)
+	{
+		length = (oldLeft > (uint32_t)(pktSize - 1)) ? pktSize - 1 : (int)oldLeft;
+		pkt[0] = (oldIndex + 1) & 0xFF;
+		memcpy(&pkt[1], &oldData[oldPos], length);
+		if(StackSend(NULL, length + 1, pkt))
+			return;
+		oldLeft -= length;
+		oldPos += length;
+		oldIndex++;
+	}
+}
+
+/* After a connection event, L2CAP moves fragments of queued notifications
+ * into the controller buffers the link freed */
+static void HostMove(bool seq16)
+{
+	while((queueCount > 0) && (ctrlFree > 0))
+	{
+		ctrlFree--;
+		ctrlQueued++;
+		if(--fragsLeft == 0)
+		{
+			ClientReceive(queue[queueHead], queueLength[queueHead], seq16);
+			queueHead = (queueHead + 1) % SIM_MAX_QUEUE;
+			if(--queueCount)
+				fragsLeft = Frags(queueLength[queueHead]);
+		}
+	}
+}
+
+static SIM_RESULT Run(bool newEngine, int mtu, uint32_t length)
+{
+	static uint8_t data[SIM_MAX_DATA];
+	BLE_BULK_XFER xfer;
+	uint8_t pkt[SIM_MAX_PKT];
+	SIM_RESULT result;
+	long events = 0;
+	int pktSize = mtu - 3;
+	int sent;
+	bool done;
+	uint32_t i;
+
+	for(i = 0; i < length; i++)
+		data[i] = (uint8_t)rand();
+	queueHead = queueCount = 0;
+	refused = false;
+	rxLength = rxTotal = rxSeq = 0;
+	rxBad = rxGotSize = false;
+	ctrlFree = ctrlBufs;
+	ctrlQueued = 0;
+	result.wakeups = 0;
+
+	if(newEngine)
+	{
+		queueMax = (ctrlBufs < BLE_BULK_XFER_WINDOW) ? BLE_BULK_XFER_WINDOW : ctrlBufs;
+		queueWake = queueMax / 2;
+		bleBulkXfer_start(&xfer, data, length, pktSize, true);
+		bleBulkXfer_pump(&xfer, pkt, StackSend, NULL);
+	}
+	else
+	{
+		/* The old loop ran with the stack's default queue of one per buffer */
+		queueMax = ctrlBufs;
+		queueWake = ctrlBufs - 1;
+		oldData = data;
+		oldLeft = length;
+		oldPos = 0;
+		oldIndex = 0;
+		oldSizeSent = false;
+		OldPump(pktSize);
+	}
+	HostMove(newEngine);
+
+	do
+	{
+		/* Connection event */
+		sent = (ctrlQueued < SIM_LL_PER_EVENT) ? ctrlQueued : SIM_LL_PER_EVENT;
+		ctrlQueued -= sent;
+		ctrlFree += sent;
+		events++;
+		HostMove(newEngine);
+
+		/* Buffer empty event */
+		if(refused && (queueCount <= queueWake))
+		{
+			refused = false;
+			result.wakeups++;
+			if(newEngine)
+				bleBulkXfer_pump(&xfer, pkt, StackSend, NULL);
+			else
+				OldPump(pktSize);
+			HostMove(newEngine);
+		}
+		done = newEngine ? bleBulkXfer_isDone(&xfer) : (oldLeft == 0);
+	} while((!done || queueCount || ctrlQueued) && (events < 1000000));
+
+	result.ms = events * SIM_CI_MS;
+	result.ok = !rxBad && rxGotSize && (rxTotal == length) && (rxLength == length) &&
+			!memcmp(rx, data, length);
+	return result;
+}
+
+int main(void)
+{
+	static const int bufs[] = { 1, 4, 8 };
+	SIM_RESULT old, new23, new131, big;
+	int failures = 0;
+	unsigned b;
+	int i;
+
+	srand(1);
+	printf("blob %d bytes, CI %.0f ms, up to %d LL packets/event, %d-byte LL payload\n",
+			SIM_BLOB_SIZE, SIM_CI_MS, SIM_LL_PER_EVENT, SIM_LL_PAYLOAD);
+	for(b = 0; b < sizeof(bufs) / sizeof(bufs[0]); b++)
+	{
+		ctrlBufs = bufs[b];
+		old = Run(false, 23, SIM_BLOB_SIZE);
+		new23 = Run(true, 23, SIM_BLOB_SIZE);
+		new131 = Run(true, 131, SIM_BLOB_SIZE);
+		printf("ctrl bufs %d: old MTU 23 %5.0f B/s wake %3ld %s | new MTU 23 %5.0f B/s wake %3ld %s"
+				" | new MTU 131 %5.0f B/s wake %3ld %s\n", ctrlBufs,
+				SIM_BLOB_SIZE / (old.ms / 1000), old.wakeups, old.ok ? "ok" : "BAD",
+				SIM_BLOB_SIZE / (new23.ms / 1000), new23.wakeups, new23.ok ? "ok" : "BAD",
+				SIM_BLOB_SIZE / (new131.ms / 1000), new131.wakeups, new131.ok ? "ok" : "BAD");
+	}
+
+	/* More than 255 packets */
+	ctrlBufs = 4;
+	big = Run(true, 23, 60000);
+	old = Run(false, 23, 60000);
+	printf("60000 bytes, MTU 23, %d packets: new %s at %.0f B/s; old %s only because"
+			" nothing is lost, its index wraps %d times\n",
+			1 + (60000 + 17) / 18, big.ok ? "ok" : "BAD", 60000 / (big.ms / 1000),
+			old.ok ? "ok" : "BAD", (60000 / 22) / 256);
+
+	for(i = 0; i < 2000; i++)
+	{
+		ctrlBufs = 1 + rand() % 8;
+		if(!Run(true, 23 + rand() % 109, 1 + rand() % 65000).ok)
+			failures++;
+	}
+	printf("2000 random transfers: %d failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/*
+ *
+ * Host simulation of EEPROM wear from the scan index and config ID
+ * counters and from scan config saves (App/nano_eeprom.c). An EEPROM word
+ * takes about 110 us to program and wears out after some 500k writes.
+ * Workload: 20000 power-up sessions, each starting a scan index, running
+ * up to 7 scans and saving up to 3 configs; the counters are flushed
+ * before 8 of 10 power downs. The run is repeated with the power failing
+ * at a random word in half of the sessions, which must never hand out a
+ * scan index or config ID twice.
+ *
+ * Before the counter log each counter was rewritten in one word on every
+ * change, so that word saw one write per session or per save; the
+ * simulation counts those. Configs went to the first free stretch of the
+ * scan cfg area, which is run again here by forgetting where the last
+ * record was written before each save.
+ *
+ *     make -C tools/host bench
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include "../../App/nano_eeprom.c"
+
+#define SIM_SESSIONS		20000
+#define SIM_WORD_US			110.0
+
+typedef struct
+{
+	long	sessions_cut;
+	long	scans;
+	long	saves;
+	long	words;
+	uint32_t	max_counter;		/* counter log */
+	uint32_t	max_dir;			/* directory, journal and move word */
+	uint32_t	max_cfg;			/* scan cfg area */
+	long	dup_scan;
+	long	dup_cfg;
+} SIM_RESULT;
+
+/* EEPROM */
+static uint8_t ee[EEPROM_SIZE];
+static uint32_t wear[EEPROM_SIZE / 4];
+static long budget = -1;
+static jmp_buf powerFail;
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	memcpy(pui32Data, &ee[ui32Address], ui32Count);
+}
+
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	uint32_t i;
+
+	for(i = 0; i < ui32Count; i += 4)
+	{
+		if(budget == 0)
+			longjmp(powerFail, 1);
+		if(budget > 0)
+			budget--;
+		memcpy(&ee[ui32Address + i], (uint8_t *)pui32Data + i, 4);
+		wear[(ui32Address + i) / 4]++;
+	}
+	return 0;
+}
+
+uScanData *GetScanDataPtr(void)
+{
+	return NULL;
+}
+
+static void PowerCycle(void)
+{
+	cfgDirLoaded = false;
+	counterLogLoaded = false;
+}
+
+static uint32_t MaxWear(uint32_t addr, uint32_t size)
+{
+	uint32_t max = 0;
+	uint32_t i;
+
+	for(i = addr / 4; i < (addr + size) / 4; i++)
+		max = MAX(max, wear[i]);
+	return max;
+}
+
+/* Tracks IDs that wrap at 16 bits; true if id is not past the highest yet */
+static bool Reused(long long *pHighest, uint16_t id)
+{
+	long long value;
+
+	if(*pHighest < 0)
+	{
+		*pHighest = id;
+		return false;
+	}
+	value = *pHighest + (int16_t)(uint16_t)(id - (uint16_t)*pHighest);
+	if(value <= *pHighest)
+		return true;
+	*pHighest = value;
+	return false;
+}
+
+static SIM_RESULT Run(int failPercent, bool firstFit)
+{
+	SIM_RESULT result;
+	uScanConfig cfg;
+	long long scanHighest = -1;
+	long long cfgHighest = -1;
+	uint16_t index;
+	uint16_t check;
+	int session;
+	int n;
+	int k;
+
+	memset(&result, 0, sizeof(result));
+	memset(ee, 0xFF, sizeof(ee));
+	memcpy(&ee[EEPROM_SERIAL_NUMBER_ADDR], "SER1234", 8);
+	PowerCycle();
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.scanCfg.num_patterns = 228;
+	Nano_eeprom_SaveConfigRecord(0, &cfg);
+	Nano_eeprom_SaveConfigRecord(1, &cfg);
+	memset(wear, 0, sizeof(wear));
+
+	srand(7);
+	for(session = 0; session < SIM_SESSIONS; session++)
+	{
+		PowerCycle();
+		if(rand() % 100 < failPercent)
+			budget = rand() % 12;
+		if(setjmp(powerFail))
+		{
+			budget = -1;
+			result.sessions_cut++;
+			continue;
+		}
+
+		Nano_eeprom_GetScanIndexCounter(&index);
+		index++;
+		Nano_eeprom_SetScanIndexCounter(&index);
+		if(Reused(&scanHighest, index))
+			result.dup_scan++;
+
+		n = rand() % 8;
+		result.scans += n;
+		for(k = 0; k < n; k++)
+		{
+			Nano_eeprom_GetScanIndexCounter(&check);
+			if(check != index)
+				result.dup_scan++;
+		}
+
+		n = rand() % 4;
+		for(k = 0; k < n; k++)
+		{
+			if(firstFit)
+			{
+				cfgDir.journal.entry.offset = 0;
+				cfgDir.journal.entry.size = 0;
+			}
+			if(Nano_eeprom_SaveConfigRecord(rand() % 2, &cfg) != PASS)
+				abort();
+			result.saves++;
+			if(Reused(&cfgHighest, cfg.scanCfg.scanConfigIndex))
+				result.dup_cfg++;
+		}
+
+		if(rand() % 10 < 8)
+			Nano_eeprom_FlushCounters();
+		budget = -1;
+	}
+
+	for(k = 0; k < EEPROM_SIZE / 4; k++)
+		result.words += wear[k];
+	result.max_counter = MaxWear(EEPROM_COUNTER_LOG_ADDR, EEPROM_COUNTER_LOG_SIZE);
+	result.max_dir = MAX(MaxWear(EEPROM_CFG_DIR_ADDR, EEPROM_CFG_DIR_SIZE),
+			MaxWear(EEPROM_CFG_MOVE_ADDR, EEPROM_CFG_MOVE_SIZE));
+	result.max_cfg = MaxWear(EEPROM_SCAN_CFG_ADDRESS, EEPROM_SCAN_CFG_SIZE);
+	return result;
+}
+
+static void Print(const char *name, SIM_RESULT *pResult)
+{
+	printf("%-22s %5ld cut, %5ld scans, %5ld saves | %6ld words %6.1f s | max writes: counters %5u,"
+			" directory %5u, cfg area %5u | reused: scan index %ld, config ID %ld\n",
+			name, pResult->sessions_cut, pResult->scans, pResult->saves, pResult->words,
+			pResult->words * SIM_WORD_US / 1e6, pResult->max_counter, pResult->max_dir,
+			pResult->max_cfg, pResult->dup_scan, pResult->dup_cfg);
+}
+
+int main(void)
+{
+	SIM_RESULT result;
+	int failures = 0;
+
+	result = Run(0, true);
+	Print("cfg first fit", &result);
+	printf("%-22s one word per counter: scan index %d writes, config ID %ld writes\n",
+			"counters in one word", SIM_SESSIONS, result.saves);
+
+	result = Run(0, false);
+	Print("cfg next fit", &result);
+	failures += result.dup_scan + result.dup_cfg;
+
+	result = Run(50, false);
+	Print("power fails in 50%", &result);
+	failures += result.dup_scan + result.dup_cfg;
+
+	return failures ? 1 : 0;
+}
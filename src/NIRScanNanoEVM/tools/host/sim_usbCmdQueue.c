@@ -0,0 +1,239 @@
+/*
+ *
+ * Host simulation of the USB command queue (App/usbCmdQueue.c) against the
+ * single command task it replaced. The host sends 160 work commands (EEPROM
+ * save 40 ms, SD listing 25 ms, 2 ms commands) and polls the scan status
+ * every 10 ms alongside. Each HID report takes 1 ms each way. The old
+ * firmware runs everything in arrival order; with the queue, polls are
+ * answered by the receive task and the rest waits for the worker.
+ *
+ *     make -C tools/host bench
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "usbCmdQueue.h"
+
+#define SIM_TICK_US		10
+#define SIM_REPORT_US	1000		/* one HID report per USB frame */
+#define SIM_POLL_US		10000
+#define SIM_NUM_WORK	160
+#define SIM_MAX_REQ		4096
+
+typedef enum
+{
+	SIM_STATUS,
+	SIM_EEPROM_SAVE,
+	SIM_SD_LIST,
+	SIM_SHORT
+} SIM_KIND;
+
+typedef struct
+{
+	long		sent;
+	long		answered;
+	SIM_KIND	kind;
+} SIM_REQ;
+
+static SIM_REQ reqs[SIM_MAX_REQ];
+
+static SIM_KIND WorkKind(int i)
+{
+	switch(i % 4)
+	{
+		case 0:
+			return SIM_EEPROM_SAVE;
+		case 2:
+			return SIM_SD_LIST;
+		default:
+			return SIM_SHORT;
+	}
+}
+
+static long RunTime(SIM_KIND kind)
+{
+	switch(kind)
+	{
+		case SIM_EEPROM_SAVE:
+			return 40000;
+		case SIM_SD_LIST:
+			return 25000;
+		case SIM_SHORT:
+			return 2000;
+		default:
+			return 50;
+	}
+}
+
+static nnoMessageStruct MakeCmd(SIM_KIND kind, int seq)
+{
+	nnoMessageStruct msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.head.flags.rw = ((kind == SIM_STATUS) || (kind == SIM_SD_LIST)) ? RESPONSE : REQUEST;
+	msg.head.flags.reply = 1;
+	msg.head.seq = seq;
+	msg.head.length = 2;
+	switch(kind)
+	{
+		case SIM_STATUS:
+			msg.payload.cmd = 0x0219;		/* NNO_CMD_SCAN_GET_STATUS */
+			break;
+		case SIM_EEPROM_SAVE:
+			msg.payload.cmd = 0x0221;
+			break;
+		case SIM_SD_LIST:
+			msg.payload.cmd = 0x0400;
+			break;
+		default:
+			msg.payload.cmd = 0x0226;
+			break;
+	}
+	return msg;
+}
+
+/* old: everything on one task in arrival order; window: work commands the
+ * host keeps outstanding */
+static void Run(bool old, int window, const char *name)
+{
+	long t = 0;
+	long workerFree = 0;
+	long lastSend = -SIM_REPORT_US;
+	long nextPoll = 0;
+	long workEnd = 0;
+	int numReq = 0;
+	int workSent = 0;
+	int workOut = 0;
+	int workDone = 0;
+	bool pollOut = false;
+	long nowDone[SIM_MAX_REQ];		/* answered by the receive task */
+	int nowReq[SIM_MAX_REQ];
+	int numNow = 0;
+	long queueDone[64];				/* answered by the worker, in order */
+	int queueReq[64];
+	int queueHead = 0;
+	int queueTail = 0;
+	long sum = 0;
+	long max = 0;
+	int polls = 0;
+	int i;
+
+	memset(reqs, 0, sizeof(reqs));
+	UsbCmdQueue_Init();
+	while(workDone < SIM_NUM_WORK)
+	{
+		while((queueTail < queueHead) && (queueDone[queueTail % 64] <= t))
+		{
+			int r = queueReq[queueTail % 64];
+
+			reqs[r].answered = queueDone[queueTail % 64] + SIM_REPORT_US;
+			if(!old)
+				UsbCmdQueue_Pop();
+			queueTail++;
+			if(reqs[r].kind == SIM_STATUS)
+				pollOut = false;
+			else
+			{
+				workOut--;
+				workDone++;
+				workEnd = reqs[r].answered;
+			}
+		}
+		for(i = 0; i < numNow; i++)
+		{
+			if((nowDone[i] >= 0) && (nowDone[i] <= t))
+			{
+				reqs[nowReq[i]].answered = nowDone[i] + SIM_REPORT_US;
+				nowDone[i] = -1;
+				pollOut = false;
+			}
+		}
+
+		if(t - lastSend >= SIM_REPORT_US)
+		{
+			SIM_KIND kind;
+			bool send = true;
+
+			if(!pollOut && (t >= nextPoll))
+				kind = SIM_STATUS;
+			else if((workSent < SIM_NUM_WORK) && (workOut < window))
+				kind = WorkKind(workSent);
+			else
+				send = false;
+
+			if(send)
+			{
+				nnoMessageStruct msg = MakeCmd(kind, numReq);
+				long arrived = t + SIM_REPORT_US;
+				USB_CMD_DISPOSITION disposition = old ? USB_CMD_QUEUED : UsbCmdQueue_Submit(&msg);
+
+				lastSend = t;
+				if(disposition == USB_CMD_QUEUE_FULL)
+				{
+					t += SIM_TICK_US;
+					continue;
+				}
+				reqs[numReq].sent = t;
+				reqs[numReq].kind = kind;
+				if(disposition == USB_CMD_RUN_NOW)
+				{
+					nowDone[numNow] = arrived + RunTime(kind);
+					nowReq[numNow++] = numReq;
+				}
+				else
+				{
+					long start = (arrived > workerFree) ? arrived : workerFree;
+
+					workerFree = start + RunTime(kind);
+					queueDone[queueHead % 64] = workerFree;
+					queueReq[queueHead % 64] = numReq;
+					queueHead++;
+				}
+				if(kind == SIM_STATUS)
+				{
+					pollOut = true;
+					nextPoll += SIM_POLL_US;
+					if(nextPoll < t)
+						nextPoll = t;
+				}
+				else
+				{
+					workOut++;
+					workSent++;
+				}
+				numReq++;
+			}
+		}
+		t += SIM_TICK_US;
+	}
+
+	for(i = 0; i < numReq; i++)
+	{
+		if((reqs[i].kind == SIM_STATUS) && reqs[i].answered)
+		{
+			long rtt = reqs[i].answered - reqs[i].sent;
+
+			sum += rtt;
+			if(rtt > max)
+				max = rtt;
+			polls++;
+		}
+	}
+	printf("%-26s work done %7.1f ms (%5.1f cmd/s)  polls %4d  poll rtt avg %6.2f ms max %6.2f ms\n",
+			name, workEnd / 1000.0, SIM_NUM_WORK * 1e6 / workEnd, polls,
+			sum / 1000.0 / polls, max / 1000.0);
+}
+
+int main(void)
+{
+	Run(true, 1, "old: one task, in order");
+	Run(false, 1, "queue, 1 work outstanding");
+	Run(false, USB_CMD_QUEUE_DEPTH, "queue, 4 work outstanding");
+	return 0;
+}
@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for the TivaWare EEPROM driver. The test that links a module
+ * using it provides the EEPROM behind these calls.
+ */
+
+#ifndef HOST_DRIVERLIB_EEPROM_H_
+#define HOST_DRIVERLIB_EEPROM_H_
+
+#include <stdint.h>
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+
+#endif /* HOST_DRIVERLIB_EEPROM_H_ */
@@ -0,0 +1,24 @@
+/*
+ * Host stand-in for the TivaWare GPIO driver. The test that links a module
+ * using it provides the pin interrupt calls.
+ */
+
+#ifndef HOST_DRIVERLIB_GPIO_H_
+#define HOST_DRIVERLIB_GPIO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GPIO_PIN_0				0x00000001
+#define GPIO_PIN_1				0x00000002
+#define GPIO_PIN_2				0x00000004
+#define GPIO_PIN_3				0x00000008
+#define GPIO_PIN_4				0x00000010
+#define GPIO_PIN_5				0x00000020
+#define GPIO_PIN_6				0x00000040
+#define GPIO_PIN_7				0x00000080
+
+uint32_t GPIOIntStatus(uint32_t ui32Port, bool bMasked);
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags);
+
+#endif /* HOST_DRIVERLIB_GPIO_H_ */
@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for driverlib/i2c.h. Nothing in it is used by the modules
+ * built on the host.
+ */
+
+#ifndef HOST_DRIVERLIB_I2C_H_
+#define HOST_DRIVERLIB_I2C_H_
+
+#endif /* HOST_DRIVERLIB_I2C_H_ */
@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for driverlib/pin_map.h. Nothing in it is used by the modules
+ * built on the host.
+ */
+
+#ifndef HOST_DRIVERLIB_PIN_MAP_H_
+#define HOST_DRIVERLIB_PIN_MAP_H_
+
+#endif /* HOST_DRIVERLIB_PIN_MAP_H_ */
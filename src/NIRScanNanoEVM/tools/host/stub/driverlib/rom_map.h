@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for driverlib/rom_map.h: the MAP_ calls go to the plain
+ * driverlib calls, as they do for functions that are not in ROM
+ */
+
+#ifndef HOST_DRIVERLIB_ROM_MAP_H_
+#define HOST_DRIVERLIB_ROM_MAP_H_
+
+#define MAP_SysCtlPeripheralEnable		SysCtlPeripheralEnable
+#define MAP_SysCtlPeripheralDisable		SysCtlPeripheralDisable
+#define MAP_GPIOIntClear				GPIOIntClear
+
+#endif /* HOST_DRIVERLIB_ROM_MAP_H_ */
@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for the TivaWare system control driver. The test that links
+ * a module using it provides the peripheral clock calls.
+ */
+
+#ifndef HOST_DRIVERLIB_SYSCTL_H_
+#define HOST_DRIVERLIB_SYSCTL_H_
+
+#include <stdint.h>
+
+#define SYSCTL_PERIPH_I2C2		0xf0002002
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+void SysCtlPeripheralDisable(uint32_t ui32Peripheral);
+
+#endif /* HOST_DRIVERLIB_SYSCTL_H_ */
@@ -0,0 +1,11 @@
+/*
+ * Host stand-in for the TivaWare memory map: only the peripheral bases the
+ * modules built on the host name
+ */
+
+#ifndef HOST_HW_MEMMAP_H_
+#define HOST_HW_MEMMAP_H_
+
+#define GPIO_PORTQ_BASE			0x40066000
+
+#endif /* HOST_HW_MEMMAP_H_ */
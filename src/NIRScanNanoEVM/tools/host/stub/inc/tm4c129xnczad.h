@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for the TM4C129XNCZAD register definitions. The modules
+ * built on the host do not touch registers directly.
+ */
+
+#ifndef HOST_TM4C129XNCZAD_H_
+#define HOST_TM4C129XNCZAD_H_
+
+#endif /* HOST_TM4C129XNCZAD_H_ */
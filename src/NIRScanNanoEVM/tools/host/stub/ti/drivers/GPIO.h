@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for ti.drivers.GPIO: the types the board header names
+ */
+
+#ifndef HOST_TI_DRIVERS_GPIO_H_
+#define HOST_TI_DRIVERS_GPIO_H_
+
+#include <stdint.h>
+
+typedef void (*GPIO_CallbackFxn)(void);
+
+typedef struct GPIO_Callbacks
+{
+	uint32_t			port;
+	uint32_t			intNum;
+	GPIO_CallbackFxn	callbackFxn[8];
+} GPIO_Callbacks;
+
+#endif /* HOST_TI_DRIVERS_GPIO_H_ */
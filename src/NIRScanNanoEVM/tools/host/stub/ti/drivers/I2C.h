@@ -0,0 +1,40 @@
+/*
+ * Host stand-in for ti.drivers.I2C. The test that links a module using it
+ * provides the driver calls and sees every transaction.
+ */
+
+#ifndef HOST_TI_DRIVERS_I2C_H_
+#define HOST_TI_DRIVERS_I2C_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <xdc/std.h>
+
+typedef struct I2C_Config *I2C_Handle;
+
+typedef enum I2C_BitRate
+{
+	I2C_100kHz = 0,
+	I2C_400kHz = 1
+} I2C_BitRate;
+
+typedef struct I2C_Params
+{
+	I2C_BitRate	bitRate;
+} I2C_Params;
+
+typedef struct I2C_Transaction
+{
+	Ptr			writeBuf;
+	size_t		writeCount;
+	Ptr			readBuf;
+	size_t		readCount;
+	UChar		slaveAddress;
+} I2C_Transaction;
+
+void I2C_Params_init(I2C_Params *params);
+I2C_Handle I2C_open(UInt index, I2C_Params *params);
+void I2C_close(I2C_Handle handle);
+Bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction);
+
+#endif /* HOST_TI_DRIVERS_I2C_H_ */
@@ -0,0 +1,26 @@
+/*
+ * Host stand-in for ti.sysbios.BIOS. The host tests run as one task unless
+ * they set host_threadType to stand in for a Hwi.
+ */
+
+#ifndef HOST_BIOS_H_
+#define HOST_BIOS_H_
+
+#include <xdc/std.h>
+
+#define BIOS_WAIT_FOREVER		(~(UInt)0)
+#define BIOS_NO_WAIT			0
+
+typedef enum BIOS_ThreadType
+{
+	BIOS_ThreadType_Hwi,
+	BIOS_ThreadType_Swi,
+	BIOS_ThreadType_Task,
+	BIOS_ThreadType_Main
+} BIOS_ThreadType;
+
+extern BIOS_ThreadType host_threadType;
+
+BIOS_ThreadType BIOS_getThreadType(void);
+
+#endif /* HOST_BIOS_H_ */
@@ -0,0 +1,79 @@
+/*
+ * Host stand-in for the FatFs API (R0.10) used by the firmware, backed by
+ * the RAM file system in host_ff.c
+ */
+
+#ifndef HOST_FATFS_FF_H_
+#define HOST_FATFS_FF_H_
+
+#include <stdint.h>
+
+typedef uint8_t		BYTE;
+typedef uint16_t	WORD;
+typedef uint32_t	DWORD;
+typedef unsigned int	UINT;
+
+typedef enum {
+	FR_OK = 0,
+	FR_DISK_ERR,
+	FR_INT_ERR,
+	FR_NOT_READY,
+	FR_NO_FILE,
+	FR_NO_PATH,
+	FR_INVALID_NAME,
+	FR_DENIED,
+	FR_EXIST,
+	FR_INVALID_OBJECT,
+	FR_WRITE_PROTECTED,
+	FR_INVALID_DRIVE,
+	FR_NOT_ENABLED,
+	FR_NO_FILESYSTEM,
+	FR_MKFS_ABORTED,
+	FR_TIMEOUT,
+	FR_LOCKED,
+	FR_NOT_ENOUGH_CORE,
+	FR_TOO_MANY_OPEN_FILES,
+	FR_INVALID_PARAMETER
+} FRESULT;
+
+#define FA_READ				0x01
+#define FA_OPEN_EXISTING	0x00
+#define FA_WRITE			0x02
+#define FA_CREATE_NEW		0x04
+#define FA_CREATE_ALWAYS	0x08
+#define FA_OPEN_ALWAYS		0x10
+
+typedef struct {
+	DWORD	n_fatent;
+	BYTE	csize;
+} FATFS;
+
+typedef struct {
+	FATFS	*fs;
+	int		file;			/* host_ff.c file slot */
+	DWORD	fptr;
+	DWORD	fsize;
+} FIL;
+
+typedef struct {
+	DWORD	fsize;
+	BYTE	fattrib;
+	char	fname[13];
+} FILINFO;
+
+#define f_size(fp)	((fp)->fsize)
+#define f_tell(fp)	((fp)->fptr)
+
+FRESULT f_open(FIL *fp, const char *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, DWORD ofs);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_sync(FIL *fp);
+FRESULT f_unlink(const char *path);
+FRESULT f_rename(const char *path_old, const char *path_new);
+FRESULT f_stat(const char *path, FILINFO *fno);
+DWORD get_fattime(void);
+
+#endif /* HOST_FATFS_FF_H_ */
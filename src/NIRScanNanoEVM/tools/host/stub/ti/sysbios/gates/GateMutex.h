@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for ti.sysbios.gates.GateMutex. The host tests run in one
+ * thread, so the gate only checks that enter and leave are balanced.
+ */
+
+#ifndef HOST_GATEMUTEX_H_
+#define HOST_GATEMUTEX_H_
+
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+
+typedef struct GateMutex_Object *GateMutex_Handle;
+
+GateMutex_Handle GateMutex_create(void *params, Error_Block *eb);
+IArg GateMutex_enter(GateMutex_Handle handle);
+void GateMutex_leave(GateMutex_Handle handle, IArg key);
+int GateMutex_depth(GateMutex_Handle handle);
+
+#endif /* HOST_GATEMUTEX_H_ */
@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for ti.sysbios.gates.GateMutexPri. The host tests run in one
+ * thread, so there is no priority to inherit and the gate only checks that
+ * enter and leave are balanced.
+ */
+
+#ifndef HOST_GATEMUTEXPRI_H_
+#define HOST_GATEMUTEXPRI_H_
+
+#include <xdc/std.h>
+#include <xdc/runtime/Error.h>
+
+typedef struct GateMutexPri_Object *GateMutexPri_Handle;
+
+GateMutexPri_Handle GateMutexPri_create(void *params, Error_Block *eb);
+IArg GateMutexPri_enter(GateMutexPri_Handle handle);
+void GateMutexPri_leave(GateMutexPri_Handle handle, IArg key);
+
+#endif /* HOST_GATEMUTEXPRI_H_ */
@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for ti.sysbios.knl.Clock. Every call to Clock_getTicks()
+ * advances the clock by one tick.
+ */
+
+#ifndef HOST_CLOCK_H_
+#define HOST_CLOCK_H_
+
+#include <xdc/std.h>
+
+extern UInt32 Clock_tickPeriod;
+
+UInt32 Clock_getTicks(void);
+
+#endif /* HOST_CLOCK_H_ */
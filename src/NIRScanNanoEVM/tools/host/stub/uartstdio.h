@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for the TivaWare UART console
+ */
+
+#ifndef HOST_UARTSTDIO_H_
+#define HOST_UARTSTDIO_H_
+
+#include <stdio.h>
+
+#define UARTprintf				printf
+
+#endif /* HOST_UARTSTDIO_H_ */
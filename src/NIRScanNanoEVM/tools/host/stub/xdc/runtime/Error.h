@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for xdc.runtime.Error
+ */
+
+#ifndef HOST_XDC_ERROR_H_
+#define HOST_XDC_ERROR_H_
+
+typedef struct { int dummy; } Error_Block;
+
+void Error_init(Error_Block *eb);
+
+#endif /* HOST_XDC_ERROR_H_ */
@@ -0,0 +1,28 @@
+/*
+ * Host stand-in for the XDCtools base types used by the firmware
+ */
+
+#ifndef HOST_XDC_STD_H_
+#define HOST_XDC_STD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int				Int;
+typedef unsigned int	UInt;
+typedef char			Char;
+typedef unsigned char	UChar;
+typedef short			Short;
+typedef unsigned short	UShort;
+typedef uint8_t			UInt8;
+typedef uint16_t		UInt16;
+typedef uint32_t		UInt32;
+typedef int				Bool;
+typedef void *			Ptr;
+typedef intptr_t		IArg;
+typedef uintptr_t		UArg;
+
+#define TRUE	1
+#define FALSE	0
+
+#endif /* HOST_XDC_STD_H_ */
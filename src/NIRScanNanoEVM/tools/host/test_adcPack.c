@@ -0,0 +1,157 @@
+/*
+ *
+ * Host test of the packed ADC data of slew scans (dlpspec_compress.h and
+ * dlpspec_scan_write_data_encoded()): packed scans read back and interpret
+ * exactly as plain ones, are marked with PACKED_SCANDATA_VERSION so older
+ * readers reject them, fall back to the plain array when packing does not
+ * help, and corrupted packed streams are rejected or decoded without faults.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "dlpspec_scan.h"
+#include "dlpspec_helper.h"
+#include "dlpspec_compress.h"
+#include "tpl.h"
+#include "host_scan.h"
+#include "host_test.h"
+
+extern tpl_hook_t tpl_hook;
+
+static uScanData scan;
+static uint8_t plain[SCAN_DATA_BLOB_SIZE];
+static uint8_t packed[SCAN_DATA_BLOB_SIZE];
+static uint8_t work[SCAN_DATA_BLOB_SIZE];
+static scanResults plainResults;
+static scanResults packedResults;
+
+/* Rejected blobs are expected here; keeps TPL from reporting each one */
+static int Quiet(const char *fmt, ...)
+{
+	return 0;
+}
+
+/* header_version as a reader sees it before it looks at the ADC data */
+static uint32_t BlobVersion(const void *pBlob, size_t size)
+{
+	memcpy(work, pBlob, size);
+	if(dlpspec_deserialize(work, sizeof(work), SLEW_DATA_HEAD_TYPE) != DLPSPEC_PASS)
+		return 0;
+	return ((uScanData *)work)->slew_data.header_version;
+}
+
+static void TestRoundTrip(int num_patterns, bool hadamard, double noise, int pga)
+{
+	size_t plainSize;
+	size_t packedSize;
+	uScanData *pBack = (uScanData *)work;
+
+	host_scan_make(&scan, num_patterns, hadamard, noise, pga);
+	CHECK(dlpspec_scan_write_data_encoded(&scan, plain, sizeof(plain),
+			ADC_DATA_ENCODING_RAW, &plainSize) == DLPSPEC_PASS);
+	CHECK(dlpspec_scan_write_data_encoded(&scan, packed, sizeof(packed),
+			ADC_DATA_ENCODING_RICE, &packedSize) == DLPSPEC_PASS);
+	CHECK(packedSize < plainSize);
+
+	CHECK(BlobVersion(plain, plainSize) == CUR_SCANDATA_VERSION);
+	CHECK(BlobVersion(packed, packedSize) == PACKED_SCANDATA_VERSION);
+
+	memcpy(work, packed, packedSize);
+	CHECK(dlpspec_scan_read_data(work, sizeof(work)) == DLPSPEC_PASS);
+	CHECK(pBack->slew_data.header_version == CUR_SCANDATA_VERSION);
+	CHECK(pBack->slew_data.adc_data_length == scan.slew_data.adc_data_length);
+	CHECK(!memcmp(pBack->slew_data.adc_data, scan.slew_data.adc_data,
+			scan.slew_data.adc_data_length * sizeof(int32_t)));
+	CHECK(pBack->slew_data.slewCfg.head.num_sections == 1);
+	CHECK(!memcmp(pBack->slew_data.slewCfg.section, scan.slew_data.slewCfg.section,
+			sizeof(scan.slew_data.slewCfg.section)));
+
+	CHECK(dlpspec_scan_interpret(plain, plainSize, &plainResults) == DLPSPEC_PASS);
+	CHECK(dlpspec_scan_interpret(packed, packedSize, &packedResults) == DLPSPEC_PASS);
+	/* Entries past length are left over from interpreting and not compared */
+	CHECK(plainResults.length == packedResults.length);
+	CHECK(!memcmp(plainResults.intensity, packedResults.intensity,
+			plainResults.length * sizeof(int)));
+	CHECK(!memcmp(plainResults.wavelength, packedResults.wavelength,
+			plainResults.length * sizeof(double)));
+	CHECK(packedResults.header_version == CUR_SCANDATA_VERSION);
+}
+
+static void TestVersionMismatch(void)
+{
+	size_t size;
+	int i;
+
+	/* A packed version that does not carry a packed stream is refused */
+	host_scan_make(&scan, 228, false, 150, 64);
+	scan.slew_data.header_version = PACKED_SCANDATA_VERSION;
+	CHECK(dlpspec_scan_write_data(&scan, plain, sizeof(plain)) == DLPSPEC_PASS);
+	CHECK(dlpspec_scan_read_data(plain, sizeof(plain)) != DLPSPEC_PASS);
+
+	/* Data that does not pack stays plain, with the plain version */
+	host_scan_make(&scan, 624, false, 150, 64);
+	scan.slew_data.adc_data_length = ADC_DATA_LEN;
+	for(i = 0; i < ADC_DATA_LEN; i++)
+		scan.slew_data.adc_data[i] = (int32_t)(((uint32_t)rand() << 16) ^ rand());
+	CHECK(dlpspec_scan_write_data_encoded(&scan, packed, sizeof(packed),
+			ADC_DATA_ENCODING_RICE, &size) == DLPSPEC_PASS);
+	CHECK(BlobVersion(packed, size) == CUR_SCANDATA_VERSION);
+	CHECK(dlpspec_scan_write_data(&scan, plain, sizeof(plain)) == DLPSPEC_PASS);
+	CHECK(!memcmp(packed, plain, size));
+
+	/* Too small a buffer for the head is reported, not overrun */
+	host_scan_make(&scan, 228, false, 150, 64);
+	CHECK(dlpspec_scan_write_data_encoded(&scan, packed, 64,
+			ADC_DATA_ENCODING_RICE, &size) == ERR_DLPSPEC_INSUFFICIENT_MEM);
+}
+
+static void TestCorruption(void)
+{
+	static uint8_t corrupt[SCAN_DATA_BLOB_SIZE];
+	size_t size;
+	size_t streamSize;
+	size_t streamStart;
+	int rejected = 0;
+	int i;
+
+	host_scan_make(&scan, 624, false, 150, 64);
+	CHECK(dlpspec_scan_write_data_encoded(&scan, packed, sizeof(packed),
+			ADC_DATA_ENCODING_RICE, &size) == DLPSPEC_PASS);
+	CHECK(dlpspec_adc_pack(scan.slew_data.adc_data, scan.slew_data.adc_data_length,
+			scan.slew_data.black_pattern_first, scan.slew_data.black_pattern_period,
+			corrupt, sizeof(corrupt), &streamSize) == DLPSPEC_PASS);
+	streamStart = size - streamSize;
+
+	/* The TPL head is not what is tested here; only the packed stream is hit */
+	for(i = 0; i < 5000; i++)
+	{
+		memcpy(corrupt, packed, size);
+		corrupt[streamStart + rand() % streamSize] ^= 1 << (rand() % 8);
+		if(dlpspec_scan_interpret(corrupt, size - (rand() % 3), &packedResults) != DLPSPEC_PASS)
+			rejected++;
+	}
+	CHECK(rejected > 0);
+}
+
+int main(void)
+{
+	tpl_hook.oops = Quiet;
+	srand(1);
+	TestRoundTrip(228, false, 150, 64);
+	TestRoundTrip(228, false, 30, 64);
+	TestRoundTrip(624, false, 1500, 64);
+	TestRoundTrip(228, true, 150, 64);
+	TestRoundTrip(624, true, 150, 64);
+	TestRoundTrip(100, false, 0, 1);
+	TestVersionMismatch();
+	TestCorruption();
+
+	return host_test_result("test_adcPack");
+}
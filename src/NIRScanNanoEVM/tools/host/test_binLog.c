@@ -0,0 +1,115 @@
+/*
+ *
+ * Host test of the deferred binary log (App/binLog.c). Logs records with
+ * numbers and %s strings, changes the strings before the records are read
+ * out and checks that the copies in the records are the strings as they
+ * were logged, cut off at BIN_LOG_MAX_STR_LEN. Then fills the ring to check
+ * the drop record.
+ *
+ * Arguments are 32-bit words as on the device, so the strings are static
+ * and the test is linked without PIE to keep them below 4 GB.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "binLog.h"
+#include "host_test.h"
+
+static const char fmtNum[] = "value %d of %u\n";
+static const char fmtStr[] = "%%s: file %s in %s, %d%%, char %c\n";
+static const char fmtNull[] = "name %s\n";
+static char fileName[64];
+static char dirName[64];
+static uint8_t buf[BIN_LOG_RING_WORDS * 8];	/* records read out carry the sync word too */
+
+static uint32_t GetWord(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Returns the copy of the string of argument 'arg' of the record at p */
+static const char *RecordString(const uint8_t *p, int arg)
+{
+	uint32_t numArgs = p[4];
+	uint32_t value = GetWord(&p[BIN_LOG_RECORD_HEADER_SIZE + 4 * arg]);
+
+	if((value & 0xFFFF0000) != BIN_LOG_STR_INLINE)
+		return NULL;
+	return (const char *)&p[BIN_LOG_RECORD_HEADER_SIZE + 4 * numArgs + (value & 0xFFFF)];
+}
+
+static uint32_t RecordSize(const uint8_t *p)
+{
+	return BIN_LOG_RECORD_HEADER_SIZE + 4 * (p[4] + p[5]);
+}
+
+int main(void)
+{
+	uint32_t size;
+	uint32_t pos;
+	uint32_t writes;
+	int i;
+
+	/* Numbers only */
+	BIN_LOG(fmtNum, -5, 7);
+	size = BinLog_Read(buf, sizeof(buf));
+	CHECK(size == BIN_LOG_RECORD_HEADER_SIZE + 8);
+	CHECK(GetWord(&buf[0]) == BIN_LOG_SYNC);
+	CHECK(buf[4] == 2);
+	CHECK(buf[5] == 0);
+	CHECK(GetWord(&buf[8]) == (uint32_t)(uintptr_t)fmtNum);
+	CHECK(GetWord(&buf[16]) == (uint32_t)-5);
+	CHECK(GetWord(&buf[20]) == 7);
+
+	/* Strings, changed and freed as it were before the drain task runs */
+	strcpy(fileName, "scan_0001.dat");
+	strcpy(dirName, "a directory with a name longer than the copy");
+	BIN_LOG(fmtStr, fileName, dirName, 42, 'x');
+	strcpy(fileName, "gone");
+	memset(dirName, 0, sizeof(dirName));
+	BIN_LOG(fmtNull, 0);
+	size = BinLog_Read(buf, sizeof(buf));
+	CHECK(size == RecordSize(buf) + RecordSize(&buf[RecordSize(buf)]));
+	CHECK(buf[4] == 4);
+	CHECK(buf[5] == (16 + BIN_LOG_MAX_STR_LEN) / 4);
+	CHECK(GetWord(&buf[16]) == BIN_LOG_STR_INLINE);
+	CHECK(RecordString(buf, 0) && !strcmp(RecordString(buf, 0), "scan_0001.dat"));
+	CHECK(RecordString(buf, 1) && (strlen(RecordString(buf, 1)) == BIN_LOG_MAX_STR_LEN - 1));
+	CHECK(RecordString(buf, 1) && !strncmp(RecordString(buf, 1), "a directory with", 16));
+	CHECK(GetWord(&buf[24]) == 42);
+	CHECK(GetWord(&buf[28]) == 'x');
+	/* A NULL string is left as it is */
+	pos = RecordSize(buf);
+	CHECK(buf[pos + 4] == 1);
+	CHECK(buf[pos + 5] == 0);
+	CHECK(GetWord(&buf[pos + 16]) == 0);
+
+	/* Records with strings fill the ring until calls are dropped; the drop
+	 * record comes after the records read */
+	strcpy(fileName, "abcdefgh");
+	for(writes = 0; writes < BIN_LOG_RING_WORDS; writes++)
+		BIN_LOG(fmtStr, fileName, fileName, writes, 'y');
+	size = BinLog_Read(buf, sizeof(buf));
+	for(pos = 0, i = 0; (pos < size) && (GetWord(&buf[pos + 8]) != 0); pos += RecordSize(&buf[pos]), i++)
+	{
+		CHECK(GetWord(&buf[pos]) == BIN_LOG_SYNC);
+		CHECK(RecordString(&buf[pos], 1) && !strcmp(RecordString(&buf[pos], 1), "abcdefgh"));
+		CHECK(GetWord(&buf[pos + 24]) == (uint32_t)i);
+	}
+	CHECK(i < (int)writes);
+	CHECK(pos + BIN_LOG_RECORD_HEADER_SIZE + 4 == size);
+	CHECK(GetWord(&buf[pos + 16]) == writes - i);
+	printf("%d records of %u fitted the ring, %u dropped\n", i, writes, GetWord(&buf[pos + 16]));
+
+	/* The ring is empty again */
+	BIN_LOG(fmtNum, 1, 2);
+	CHECK(BinLog_Read(buf, sizeof(buf)) == BIN_LOG_RECORD_HEADER_SIZE + 8);
+
+	return host_test_result("test_binLog");
+}
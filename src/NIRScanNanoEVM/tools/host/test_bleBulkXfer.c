@@ -0,0 +1,182 @@
+/*
+ *
+ * Host test of the BLE bulk transfer engine (BLE/App/BLEBulkXfer.c) against
+ * a GATT queue that refuses notifications when full and drains a random
+ * number of them per connection event. A client reassembles what comes out
+ * and checks the packet format of BLEBulkXfer.h.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "BTErrors.h"
+#include "BLEBulkXfer.h"
+#include "host_test.h"
+
+#define TEST_MAX_DATA	70000
+#define TEST_MAX_PKT	200
+
+static uint8_t data[TEST_MAX_DATA];
+
+/* GATT queue of the connection */
+static int queued;
+static int queueMax;
+static int failAfter;			/* packets accepted before a link error; < 0 for none */
+
+/* Client */
+static uint8_t rx[TEST_MAX_DATA];
+static uint32_t rxLength;
+static uint32_t rxTotal;
+static uint32_t rxSeq;
+static bool rxBad;
+static bool indexed;
+
+static void ClientReceive(const uint8_t *pPkt, uint16_t length)
+{
+	uint32_t seq;
+
+	if(!indexed)
+	{
+		memcpy(&rx[rxLength], pPkt, length);
+		rxLength += length;
+		return;
+	}
+
+	seq = pPkt[0] | (pPkt[1] << 8);
+	if(seq != (rxSeq & 0xFFFF))
+	{
+		rxBad = true;
+		return;
+	}
+	if(rxSeq++ == 0)
+	{
+		if(length != BLE_BULK_XFER_SIZE_PKT_LEN)
+			rxBad = true;
+		rxTotal = pPkt[2] | (pPkt[3] << 8) | (pPkt[4] << 16) | ((uint32_t)pPkt[5] << 24);
+		return;
+	}
+	memcpy(&rx[rxLength], &pPkt[BLE_BULK_XFER_SEQ_SIZE], length - BLE_BULK_XFER_SEQ_SIZE);
+	rxLength += length - BLE_BULK_XFER_SEQ_SIZE;
+}
+
+static int StackSend(void *pCtx, uint16_t length, uint8_t *pPkt)
+{
+	uint16_t pktSize = *(uint16_t *)pCtx;
+
+	if(failAfter == 0)
+		return BTPS_ERROR_INVALID_PARAMETER;
+	if(queued >= queueMax)
+		return BTPS_ERROR_INSUFFICIENT_BUFFER_SPACE;
+	if((length == 0) || (length > pktSize))
+		rxBad = true;
+	if(failAfter > 0)
+		failAfter--;
+
+	/* The link keeps notifications in order, so deliver right away */
+	ClientReceive(pPkt, length);
+	queued++;
+	return 0;
+}
+
+/* Runs a transfer to the end as the buffer empty events would */
+static bool Transfer(uint32_t length, uint16_t pktSize, bool isIndexed, BLE_BULK_XFER *pXfer)
+{
+	uint8_t pkt[TEST_MAX_PKT];
+	BLE_Bulk_Xfer_Status_t status;
+	int events = 0;
+
+	queued = 0;
+	rxLength = 0;
+	rxTotal = 0;
+	rxSeq = 0;
+	rxBad = false;
+	indexed = isIndexed;
+
+	bleBulkXfer_start(pXfer, data, length, pktSize, isIndexed);
+	status = bleBulkXfer_pump(pXfer, pkt, StackSend, &pktSize);
+	while(status == BLE_BULK_XFER_WAIT)
+	{
+		/* Connection events until the queue is down to half */
+		while(queued > queueMax / 2)
+			queued -= 1 + rand() % queued;
+		if(queued < 0)
+			queued = 0;
+		status = bleBulkXfer_pump(pXfer, pkt, StackSend, &pktSize);
+		if(++events > 1000000)
+			return false;
+	}
+	if(status != BLE_BULK_XFER_DONE)
+		return false;
+
+	CHECK(bleBulkXfer_isDone(pXfer));
+	CHECK(bleBulkXfer_buildPacket(pXfer, pkt) == 0);
+	if(isIndexed)
+		return !rxBad && (rxTotal == length) && (rxLength == length) && !memcmp(rx, data, length);
+	return !rxBad && (rxLength == length) && !memcmp(rx, data, length);
+}
+
+int main(void)
+{
+	BLE_BULK_XFER xfer;
+	int random_failures = 0;
+	int i;
+
+	srand(1);
+	for(i = 0; i < TEST_MAX_DATA; i++)
+		data[i] = (uint8_t)rand();
+	failAfter = -1;
+
+	/* The 3822-byte scan blob at the default and the largest MTU */
+	queueMax = BLE_BULK_XFER_WINDOW;
+	CHECK(Transfer(3822, 20, true, &xfer));
+	CHECK(xfer.numPackets == 1 + (3822 + 17) / 18);
+	CHECK(xfer.numStalls > 0);
+	CHECK(Transfer(3822, 128, true, &xfer));
+
+	/* More than 255 packets: the sequence number does not wrap */
+	CHECK(Transfer(60000, 20, true, &xfer));
+	CHECK(xfer.seq > 256);
+
+	/* Non-indexed transfers carry only payload */
+	CHECK(Transfer(1000, 20, false, &xfer));
+	CHECK(xfer.numPackets == 50);
+
+	/* Nothing to send */
+	CHECK(Transfer(0, 20, true, &xfer));
+	CHECK(xfer.numPackets == 0);
+
+	/* A payload that ends on a packet boundary */
+	CHECK(Transfer(18 * 10, 20, true, &xfer));
+	CHECK(xfer.numPackets == 11);
+
+	for(i = 0; i < 2000; i++)
+	{
+		queueMax = 1 + rand() % 16;
+		if(!Transfer(1 + rand() % 65000, (uint16_t)(20 + rand() % 109), rand() % 2, &xfer))
+			random_failures++;
+	}
+	CHECK(random_failures == 0);
+
+	/* Any other error from the stack ends the transfer */
+	{
+		uint8_t pkt[TEST_MAX_PKT];
+		uint16_t pktSize = 20;
+
+		queueMax = BLE_BULK_XFER_WINDOW;
+		queued = 0;
+		failAfter = 3;
+		bleBulkXfer_start(&xfer, data, 1000, pktSize, true);
+		CHECK(bleBulkXfer_pump(&xfer, pkt, StackSend, &pktSize) == BLE_BULK_XFER_ERROR);
+		CHECK(xfer.numPackets == 3);
+		CHECK(!bleBulkXfer_isDone(&xfer));
+		failAfter = -1;
+	}
+
+	return host_test_result("test_bleBulkXfer");
+}
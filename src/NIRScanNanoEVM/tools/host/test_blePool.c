@@ -0,0 +1,315 @@
+/*
+ *
+ * Host test of the BLE block pool (BLE/App/BLEPool.c) behind the response
+ * and notification lists: exhaustion, reuse of released blocks, releases of
+ * blocks that are already free or not from the pool, reset, and a random run
+ * checked against a model of which blocks are in use.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nnoStatus.h"
+#include "BLEPool.h"
+#include "host_test.h"
+
+#define TEST_NUM_BLOCKS		8
+#define TEST_RANDOM_OPS		100000
+
+/* Same shape as the list nodes: a link first, then the payload */
+typedef struct
+{
+	void		*next;
+	uint32_t	owner;
+	uint8_t		data[22];
+} TEST_BLOCK;
+
+static TEST_BLOCK blocks[TEST_NUM_BLOCKS];
+static BLE_POOL pool;
+static int numErrors;
+
+int nnoStatus_setErrorStatus(uint32_t field, bool value)
+{
+	if((field == NNO_ERROR_INSUFFICIENT_MEMORY) && value)
+		numErrors++;
+	return 0;
+}
+
+static bool IsPoolBlock(void *pBlock)
+{
+	int i;
+
+	for(i = 0; i < TEST_NUM_BLOCKS; i++)
+	{
+		if(pBlock == &blocks[i])
+			return true;
+	}
+	return false;
+}
+
+static void Fill(TEST_BLOCK *pBlock, uint32_t owner)
+{
+	pBlock->owner = owner;
+	memset(pBlock->data, (uint8_t)owner, sizeof(pBlock->data));
+}
+
+static bool Holds(const TEST_BLOCK *pBlock, uint32_t owner)
+{
+	int i;
+
+	if(pBlock->owner != owner)
+		return false;
+	for(i = 0; i < (int)sizeof(pBlock->data); i++)
+	{
+		if(pBlock->data[i] != (uint8_t)owner)
+			return false;
+	}
+	return true;
+}
+
+static void TestExhaustion(void)
+{
+	TEST_BLOCK *pTaken[TEST_NUM_BLOCKS];
+	BLE_POOL_STATS stats;
+	int i, j;
+
+	blePoolInit(&pool, blocks, sizeof(TEST_BLOCK), TEST_NUM_BLOCKS);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.capacity == TEST_NUM_BLOCKS);
+	CHECK(stats.in_use == 0);
+
+	numErrors = 0;
+	for(i = 0; i < TEST_NUM_BLOCKS; i++)
+	{
+		pTaken[i] = blePoolAlloc(&pool);
+		CHECK(IsPoolBlock(pTaken[i]));
+		for(j = 0; j < i; j++)
+			CHECK(pTaken[j] != pTaken[i]);
+		Fill(pTaken[i], i + 1);
+	}
+	CHECK(numErrors == 0);
+
+	/* Every block is out: refused, counted and reported */
+	CHECK(blePoolAlloc(&pool) == NULL);
+	CHECK(blePoolAlloc(&pool) == NULL);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.num_fail == 2);
+	CHECK(stats.num_alloc == TEST_NUM_BLOCKS);
+	CHECK(stats.in_use == TEST_NUM_BLOCKS);
+	CHECK(stats.in_use_max == TEST_NUM_BLOCKS);
+	CHECK(numErrors == 2);
+
+	/* Refusing did not touch the blocks that are out */
+	for(i = 0; i < TEST_NUM_BLOCKS; i++)
+		CHECK(Holds(pTaken[i], i + 1));
+}
+
+static void TestReuse(void)
+{
+	TEST_BLOCK *pA, *pB, *pC;
+	BLE_POOL_STATS stats;
+
+	blePoolInit(&pool, blocks, sizeof(TEST_BLOCK), TEST_NUM_BLOCKS);
+	pA = blePoolAlloc(&pool);
+	pB = blePoolAlloc(&pool);
+	Fill(pA, 0xA);
+	Fill(pB, 0xB);
+
+	/* The block given back last is handed out next */
+	blePoolFree(&pool, pA);
+	pC = blePoolAlloc(&pool);
+	CHECK(pC == pA);
+	Fill(pC, 0xC);
+	CHECK(Holds(pB, 0xB));
+
+	blePoolFree(&pool, pB);
+	blePoolFree(&pool, pC);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.num_alloc == 3);
+	CHECK(stats.num_free == 3);
+	CHECK(stats.in_use == 0);
+	CHECK(stats.in_use_max == 2);
+	CHECK(stats.num_bad_free == 0);
+
+	/* NULL, as a failed allocation returns, is not a release */
+	blePoolFree(&pool, NULL);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.num_free == 3);
+	CHECK(stats.num_bad_free == 0);
+}
+
+static void TestBadRelease(void)
+{
+	TEST_BLOCK *pTaken[TEST_NUM_BLOCKS];
+	TEST_BLOCK *pA;
+	TEST_BLOCK other;
+	BLE_POOL_STATS stats;
+	int i, j;
+
+	blePoolInit(&pool, blocks, sizeof(TEST_BLOCK), TEST_NUM_BLOCKS);
+	pA = blePoolAlloc(&pool);
+
+	/* Given back twice: the second release is ignored */
+	blePoolFree(&pool, pA);
+	blePoolFree(&pool, pA);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.num_free == 1);
+	CHECK(stats.num_bad_free == 1);
+	CHECK(stats.in_use == 0);
+
+	/* Never taken, not from the pool, or not the start of a block */
+	blePoolFree(&pool, &blocks[TEST_NUM_BLOCKS - 1]);
+	blePoolFree(&pool, &other);
+	blePoolFree(&pool, &blocks[TEST_NUM_BLOCKS]);
+	blePoolFree(&pool, (uint8_t *)&blocks[1] + 4);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.num_free == 1);
+	CHECK(stats.num_bad_free == 5);
+	CHECK(stats.in_use == 0);
+
+	/* The free list survived: every block comes out once, then none */
+	for(i = 0; i < TEST_NUM_BLOCKS; i++)
+	{
+		pTaken[i] = blePoolAlloc(&pool);
+		CHECK(IsPoolBlock(pTaken[i]));
+		for(j = 0; j < i; j++)
+			CHECK(pTaken[j] != pTaken[i]);
+	}
+	CHECK(blePoolAlloc(&pool) == NULL);
+
+	/* A block that is out is released exactly once */
+	blePoolFree(&pool, pTaken[3]);
+	blePoolFree(&pool, pTaken[3]);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.in_use == TEST_NUM_BLOCKS - 1);
+	CHECK(stats.num_bad_free == 6);
+	CHECK(blePoolAlloc(&pool) == pTaken[3]);
+	CHECK(blePoolAlloc(&pool) == NULL);
+}
+
+static void TestReset(void)
+{
+	BLE_POOL_STATS stats;
+	int i;
+
+	blePoolInit(&pool, blocks, sizeof(TEST_BLOCK), TEST_NUM_BLOCKS);
+	for(i = 0; i < 5; i++)
+		blePoolAlloc(&pool);
+
+	/* All blocks back at once; counts and high-water mark are kept */
+	blePoolReset(&pool);
+	blePoolGetStats(&pool, &stats);
+	CHECK(stats.in_use == 0);
+	CHECK(stats.in_use_max == 5);
+	CHECK(stats.num_alloc == 5);
+
+	for(i = 0; i < TEST_NUM_BLOCKS; i++)
+		CHECK(blePoolAlloc(&pool) != NULL);
+	CHECK(blePoolAlloc(&pool) == NULL);
+}
+
+static void TestRandom(void)
+{
+	TEST_BLOCK *pTaken[TEST_NUM_BLOCKS];
+	uint32_t owners[TEST_NUM_BLOCKS];
+	BLE_POOL_STATS stats;
+	uint32_t nextOwner = 1;
+	uint32_t expBad = 0;
+	uint32_t expFail = 0;
+	int numTaken = 0;
+	int random_failures = 0;
+	TEST_BLOCK *pBlock;
+	int op, i, k;
+
+	srand(1);
+	blePoolInit(&pool, blocks, sizeof(TEST_BLOCK), TEST_NUM_BLOCKS);
+	for(op = 0; op < TEST_RANDOM_OPS; op++)
+	{
+		k = rand() % 8;
+		if(k < 4)
+		{
+			pBlock = blePoolAlloc(&pool);
+			if(numTaken == TEST_NUM_BLOCKS)
+			{
+				expFail++;
+				if(pBlock != NULL)
+					random_failures++;
+				continue;
+			}
+			if(!IsPoolBlock(pBlock))
+			{
+				random_failures++;
+				break;
+			}
+			for(i = 0; i < numTaken; i++)
+			{
+				if(pTaken[i] == pBlock)
+					random_failures++;
+			}
+			Fill(pBlock, nextOwner);
+			pTaken[numTaken] = pBlock;
+			owners[numTaken++] = nextOwner++;
+		}
+		else if((k < 7) && (numTaken > 0))
+		{
+			i = rand() % numTaken;
+			if(!Holds(pTaken[i], owners[i]))
+				random_failures++;
+			blePoolFree(&pool, pTaken[i]);
+			pBlock = pTaken[i];
+			pTaken[i] = pTaken[--numTaken];
+			owners[i] = owners[numTaken];
+			/* Now and then the same block again */
+			if(rand() % 4 == 0)
+			{
+				blePoolFree(&pool, pBlock);
+				expBad++;
+			}
+		}
+		else
+		{
+			/* A block that is free right now */
+			for(i = 0; i < TEST_NUM_BLOCKS; i++)
+			{
+				for(k = 0; k < numTaken; k++)
+				{
+					if(pTaken[k] == &blocks[i])
+						break;
+				}
+				if(k == numTaken)
+				{
+					blePoolFree(&pool, &blocks[i]);
+					expBad++;
+					break;
+				}
+			}
+		}
+
+		blePoolGetStats(&pool, &stats);
+		if((stats.in_use != numTaken) || (stats.num_bad_free != expBad) ||
+				(stats.num_fail != expFail) || (stats.num_alloc - stats.num_free != numTaken))
+			random_failures++;
+	}
+	CHECK(random_failures == 0);
+	CHECK(expBad > 1000);
+	CHECK(expFail > 0);
+	printf("%d operations: %u allocations, %u refused, %u bad releases ignored\n",
+			TEST_RANDOM_OPS, stats.num_alloc, stats.num_fail, stats.num_bad_free);
+}
+
+int main(void)
+{
+	TestExhaustion();
+	TestReuse();
+	TestBadRelease();
+	TestReset();
+	TestRandom();
+
+	return host_test_result("test_blePool");
+}
@@ -0,0 +1,330 @@
+/*
+ *
+ * Host test of the DLPC150 I2C sessions (Drivers/dlpc150.c) over a fake
+ * TI-RTOS I2C driver that logs every transaction. The calls made to set up
+ * a scan must send the same bytes as before sessions were added, now over
+ * one I2C_open() per call or per session where the driver used to open the
+ * port for every transaction. The session gate must be held across every
+ * transaction of a session and be free again after it, also when the port
+ * cannot be opened or a command is not acknowledged. The DLPC150 error
+ * interrupt, a Hwi, must not touch a session a task has open; the status it
+ * leaves is read by the next session.
+ *
+ * The bus time printed is estimated for 100 kHz from the bits on the wire:
+ * start, address and acknowledge, 9 bits per byte, a repeated start and
+ * address for a read and the stop. Setting up and tearing down the port
+ * costs CPU time that is not on the bus and is not estimated here.
+ *
+ * dlpc150.c is included rather than linked to get at its session gate.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../Drivers/dlpc150.c"
+#include "host_test.h"
+
+#define TEST_BIT_US			10.0		/* 100 kHz */
+#define TEST_MAX_XFERS		32
+#define TEST_MAX_BYTES		16
+
+typedef struct
+{
+	uint8_t		write[TEST_MAX_BYTES];
+	uint8_t		writeCount;
+	uint8_t		readCount;
+} TEST_XFER;
+
+/* I2C driver */
+struct I2C_Config
+{
+	int		unused;
+};
+
+static struct I2C_Config port;
+static bool portOpen = false;
+static bool periphOn = false;
+static int opens;
+static int nack = -1;				/* transaction not acknowledged; < 0 for none */
+static bool failOpen = false;
+static TEST_XFER xfers[TEST_MAX_XFERS];
+static int numXfers;
+static int numErrors;
+static uint32_t gpioStatus;			/* pending pin interrupts */
+
+/* What the scan setup calls sent before sessions, one open per transaction */
+static const TEST_XFER rgbSetup[] =
+{
+	{ { 0x10, 0x00, 0x00, 0x00, 0x00, 0x56, 0x03, 0xe0, 0x01 }, 9, 0 },
+	{ { 0x12, 0x56, 0x03, 0xe0, 0x01 }, 5, 0 },
+	{ { 0x2e, 0x60, 0x03, 0xe0, 0x01 }, 5, 0 },
+	{ { 0x05, 0x00 }, 2, 0 },
+	{ { 0xf6, 0x00 }, 2, 0 },
+	{ { 0xf1, 0xd0, 0x53, 0x00, 0x40, 0xd0, 0x00, 0x00, 0x00 }, 9, 0 }
+};
+
+static const TEST_XFER flashSetup[] =
+{
+	{ { 0x05, 0x02 }, 2, 0 },
+	{ { 0xf4 }, 1, 0 },
+	{ { 0xf1, 0xd0, 0x53, 0x00, 0x40, 0xd0, 0x00, 0x00, 0x00 }, 9, 0 }
+};
+
+static const TEST_XFER lampOn[] =
+{
+	{ { 0x54, 0x00, 0x00, 0xbd, 0x00, 0x00, 0x00 }, 7, 0 },
+	{ { 0x52, 0x02 }, 2, 0 }
+};
+
+static const TEST_XFER lampOff[] =
+{
+	{ { 0x54, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, 7, 0 },
+	{ { 0x52, 0x00 }, 2, 0 }
+};
+
+/* Reads back 0x44332211 */
+static const TEST_XFER crop[] =
+{
+	{ { 0xf2, 0x00, 0x13, 0x00, 0x40 }, 5, 4 },
+	{ { 0xf1, 0x00, 0x13, 0x00, 0x40, 0x10, 0x22, 0x33, 0x44 }, 9, 0 },
+	{ { 0xf1, 0x7c, 0x10, 0x00, 0x40, 0x0a, 0x00, 0x00, 0x00 }, 9, 0 },
+	{ { 0xf1, 0x74, 0x10, 0x00, 0x40, 0xc8, 0x00, 0x00, 0x00 }, 9, 0 }
+};
+
+static const TEST_XFER writeReg[] =
+{
+	{ { 0xf1, 0x78, 0x56, 0x34, 0x12, 0xdd, 0xcc, 0xbb, 0xaa }, 9, 0 }
+};
+
+/* The short status left by the error interrupt goes first */
+static const TEST_XFER statusWriteReg[] =
+{
+	{ { 0xd0 }, 1, 4 },
+	{ { 0xf1, 0x78, 0x56, 0x34, 0x12, 0xdd, 0xcc, 0xbb, 0xaa }, 9, 0 }
+};
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral)
+{
+	CHECK(ui32Peripheral == SYSCTL_PERIPH_I2C2);
+	periphOn = true;
+}
+
+void SysCtlPeripheralDisable(uint32_t ui32Peripheral)
+{
+	CHECK(ui32Peripheral == SYSCTL_PERIPH_I2C2);
+	periphOn = false;
+}
+
+uint32_t GPIOIntStatus(uint32_t ui32Port, bool bMasked)
+{
+	CHECK(ui32Port == GPIO_PORTQ_BASE);
+	return gpioStatus;
+}
+
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+	CHECK(ui32Port == GPIO_PORTQ_BASE);
+	gpioStatus &= ~ui32IntFlags;
+}
+
+void I2C_Params_init(I2C_Params *params)
+{
+	params->bitRate = I2C_400kHz;
+}
+
+I2C_Handle I2C_open(UInt index, I2C_Params *params)
+{
+	CHECK(index == BOARD_I2C_DLPC);
+	CHECK(params->bitRate == I2C_100kHz);
+	CHECK(periphOn);
+	CHECK(!portOpen);
+	if(failOpen)
+		return NULL;
+	opens++;
+	portOpen = true;
+	return &port;
+}
+
+void I2C_close(I2C_Handle handle)
+{
+	CHECK(handle == &port);
+	CHECK(portOpen);
+	portOpen = false;
+}
+
+Bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction)
+{
+	TEST_XFER *pXfer = &xfers[numXfers];
+	size_t i;
+
+	if(handle == NULL)
+		return false;
+	CHECK(handle == &port);
+	CHECK(portOpen);
+	CHECK(transaction->slaveAddress == BOARD_DLPC150_ADDR);
+	/* Nobody else may come between the transactions of a session */
+	CHECK(GateMutex_depth(dlpc150Gate) == 1);
+	if((numXfers >= TEST_MAX_XFERS) || (transaction->writeCount > TEST_MAX_BYTES))
+		abort();
+
+	memcpy(pXfer->write, transaction->writeBuf, transaction->writeCount);
+	pXfer->writeCount = transaction->writeCount;
+	pXfer->readCount = transaction->readCount;
+	for(i = 0; i < transaction->readCount; i++)
+		((uint8_t *)transaction->readBuf)[i] = 0x11 * (i + 1);
+	return (numXfers++ != nack);
+}
+
+int nnoStatus_setErrorStatusAndCode(uint32_t error_field, bool error_value, int16_t code_value)
+{
+	numErrors++;
+	return 0;
+}
+
+static void Reset(void)
+{
+	numXfers = 0;
+	numErrors = 0;
+	opens = 0;
+	nack = -1;
+	failOpen = false;
+}
+
+/* Bits on the wire for the transactions logged */
+static long BusBits(const TEST_XFER *pXfers, int num)
+{
+	long bits = 0;
+	int i;
+
+	for(i = 0; i < num; i++)
+	{
+		bits += 1 + 9 + 9 * pXfers[i].writeCount + 1;
+		if(pXfers[i].readCount)
+			bits += 1 + 9 + 9 * pXfers[i].readCount;
+	}
+	return bits;
+}
+
+/* The transactions logged are 'num' of 'pExpected', in order */
+static bool SameXfers(const TEST_XFER *pExpected, int num)
+{
+	int i;
+
+	if(numXfers != num)
+		return false;
+	for(i = 0; i < num; i++)
+	{
+		if((xfers[i].writeCount != pExpected[i].writeCount) ||
+				(xfers[i].readCount != pExpected[i].readCount) ||
+				memcmp(xfers[i].write, pExpected[i].write, pExpected[i].writeCount))
+			return false;
+	}
+	return true;
+}
+
+/* Checks a call that returned 'ret' against what it should have sent */
+static void CheckCall(const char *name, int16_t ret, const TEST_XFER *pExpected, int num)
+{
+	long bits = BusBits(pExpected, num);
+
+	CHECK(ret == PASS);
+	CHECK(SameXfers(pExpected, num));
+	CHECK(opens == 1);
+	CHECK(!portOpen && !periphOn);
+	CHECK(GateMutex_depth(dlpc150Gate) == 0);
+	CHECK(numErrors == 0);
+	printf("%-22s %2d transactions %4ld bits %6.0f us on the bus | opens: %d before, %d now\n",
+			name, num, bits, bits * TEST_BIT_US, num, opens);
+	Reset();
+}
+
+int main(void)
+{
+	TEST_XFER configure[8];
+	uint32_t value;
+	int16_t ret;
+
+	CHECK(dlpc150_Init() == PASS);
+
+	CheckCall("SetUpSource(rgb)", dlpc150_SetUpSource(true), rgbSetup, 6);
+	CheckCall("SetUpSource(flash)", dlpc150_SetUpSource(false), flashSetup, 3);
+	CheckCall("LampEnable(true)", dlpc150_LampEnable(true), lampOn, 2);
+	CheckCall("LampEnable(false)", dlpc150_LampEnable(false), lampOff, 2);
+	CheckCall("displayCrop(10, 200)", dlpc150_displayCrop(10, 200), crop, 4);
+	CheckCall("WriteReg", dlpc150_WriteReg(0x12345678, 0xAABBCCDD), writeReg, 1);
+
+	/* Scan_dlpc150_configure() */
+	memcpy(configure, rgbSetup, sizeof(rgbSetup));
+	memcpy(&configure[6], lampOff, sizeof(lampOff));
+	ret = dlpc150_OpenSession();
+	CHECK(GateMutex_depth(dlpc150Gate) == 1);
+	if(dlpc150_SetUpSource(true) || dlpc150_LampEnable(false))
+		ret = FAIL;
+	CHECK(portOpen);
+	CHECK(dlpc150_CloseSession() == PASS);
+	CheckCall("scan configure", ret, configure, 8);
+
+	/* Nested sessions close the port with the outermost one */
+	CHECK(dlpc150_OpenSession() == PASS);
+	CHECK(dlpc150_OpenSession() == PASS);
+	CHECK(GateMutex_depth(dlpc150Gate) == 1);
+	CHECK(dlpc150_ReadReg(0x40001300, &value) == PASS);
+	CHECK(value == 0x44332211);
+	CHECK(dlpc150_CloseSession() == PASS);
+	CHECK(portOpen);
+	CHECK(GateMutex_depth(dlpc150Gate) == 1);
+	CHECK(dlpc150_CloseSession() == PASS);
+	CHECK(!portOpen && (opens == 1));
+	CHECK(GateMutex_depth(dlpc150Gate) == 0);
+	CHECK(dlpc150_CloseSession() == FAIL);
+	Reset();
+
+	/* The port does not open: the gate is not kept */
+	failOpen = true;
+	CHECK(dlpc150_OpenSession() == FAIL);
+	CHECK(GateMutex_depth(dlpc150Gate) == 0);
+	CHECK(dlpc150_LampEnable(true) == FAIL);
+	CHECK(GateMutex_depth(dlpc150Gate) == 0);
+	CHECK(numErrors > 0);
+	CHECK(!portOpen);
+	CHECK(dlpc150_CloseSession() == FAIL);
+	Reset();
+
+	/* A command not acknowledged stops the table and ends the call */
+	nack = 1;
+	CHECK(dlpc150_SetUpSource(true) == FAIL);
+	CHECK(numXfers == 2);
+	CHECK(numErrors > 0);
+	CHECK(!portOpen && !periphOn);
+	CHECK(GateMutex_depth(dlpc150Gate) == 0);
+	Reset();
+
+	/* The error interrupt comes in during a session: the Hwi leaves the
+	 * port and the session alone, and calls from it are refused */
+	CHECK(dlpc150_OpenSession() == PASS);
+	CHECK(dlpc150_WriteReg(0x12345678, 0xAABBCCDD) == PASS);
+	host_threadType = BIOS_ThreadType_Hwi;
+	gpioStatus = GPIO_PIN_7;
+	GPIOQ7IntHandler();
+	CHECK(gpioStatus == 0);
+	CHECK(dlpc150_WriteReg(0x12345678, 0xAABBCCDD) == FAIL);
+	CHECK(dlpc150_OpenSession() == FAIL);
+	host_threadType = BIOS_ThreadType_Task;
+	CHECK(numXfers == 1);
+	CHECK(numErrors == 1);
+	CHECK(portOpen && (dlpc150SessionDepth == 1));
+	CHECK(GateMutex_depth(dlpc150Gate) == 1);
+	CHECK(dlpc150_CloseSession() == PASS);
+	CHECK(!portOpen && (numXfers == 1));
+	Reset();
+
+	/* The next session reads the short status first, once */
+	CheckCall("status after an error", dlpc150_WriteReg(0x12345678, 0xAABBCCDD), statusWriteReg, 2);
+	CheckCall("WriteReg", dlpc150_WriteReg(0x12345678, 0xAABBCCDD), writeReg, 1);
+
+	return host_test_result("test_dlpc150");
+}
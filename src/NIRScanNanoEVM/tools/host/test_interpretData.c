@@ -0,0 +1,337 @@
+/*
+ *
+ * Host test of the NNO_FILE_INTERPRET_DATA encoder (App/interpretData.c). A
+ * known column scan is serialized and interpreted by dlpspeclib as on the
+ * EVM, encoded in every layout, and decoded again by a reader written from
+ * the layout description in NNOCommandDefs.h. The decoded header, wavelengths
+ * and intensities are checked against the interpreted scan; reads in random
+ * pieces must give the same bytes as one whole read.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "dlpspec_scan.h"
+#include "dlpspec_util.h"
+#include "interpretData.h"
+#include "host_scan.h"
+#include "host_test.h"
+
+#define TEST_NUM_PATTERNS	228
+#define TEST_PGA			64
+
+/* File as the host application sees it after decoding */
+typedef struct
+{
+	int32_t		count;
+	uint8_t		format;
+	uint8_t		shift;
+	double		coeffs[3];
+	double		wavelength[ADC_DATA_LEN];
+	double		intensity[ADC_DATA_LEN];
+} DECODED;
+
+static const uint8_t formats[] =
+{
+	NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_INT32,
+	NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_FLOAT,
+	NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_INT16,
+	NNO_INTERPRET_WL_FLOAT | NNO_INTERPRET_INT_INT32,
+	NNO_INTERPRET_WL_FLOAT | NNO_INTERPRET_INT_FLOAT,
+	NNO_INTERPRET_WL_FLOAT | NNO_INTERPRET_INT_INT16,
+	NNO_INTERPRET_WL_COEFFS | NNO_INTERPRET_INT_INT32,
+	NNO_INTERPRET_WL_COEFFS | NNO_INTERPRET_INT_FLOAT,
+	NNO_INTERPRET_WL_COEFFS | NNO_INTERPRET_INT_INT16,
+	INTERPRET_DATA_INTERLEAVED,
+};
+
+static uScanData scan;
+static uint8_t blob[SCAN_DATA_BLOB_SIZE];
+static scanResults results;
+static uint8_t file[INTERPRET_DATA_MAX_SIZE];
+static uint8_t pieces[INTERPRET_DATA_MAX_SIZE];
+static DECODED dec;
+
+static double GetDouble(const uint8_t *p)
+{
+	double val;
+
+	memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+static int32_t GetInt(const uint8_t *p)
+{
+	return (int32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static int16_t GetShort(const uint8_t *p)
+{
+	return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static float GetFloat(const uint8_t *p)
+{
+	float val;
+
+	memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+/*
+ * Reads a file of the layout given to NNO_CMD_FILE_GET_READSIZE, or the
+ * interleaved one for INTERPRET_DATA_INTERLEAVED. Returns false if the size
+ * does not match what the header says.
+ */
+static bool Decode(const uint8_t *pFile, uint32_t size, uint8_t format, DECODED *pDec)
+{
+	uint32_t pos;
+	double half;
+	int i;
+
+	memset(pDec, 0, sizeof(DECODED));
+	if(size < 4)
+		return false;
+	pDec->count = GetInt(pFile);
+	if((pDec->count < 0) || (pDec->count > ADC_DATA_LEN))
+		return false;
+
+	if(format == INTERPRET_DATA_INTERLEAVED)
+	{
+		if(size != 4 + (uint32_t)pDec->count * 12)
+			return false;
+		for(i = 0; i < pDec->count; i++)
+		{
+			pDec->wavelength[i] = GetDouble(&pFile[4 + i * 12]);
+			pDec->intensity[i] = GetInt(&pFile[4 + i * 12 + 8]);
+		}
+		return true;
+	}
+
+	if(size < 8)
+		return false;
+	pDec->format = pFile[4];
+	pDec->shift = pFile[5];
+	if((pFile[6] != 0) || (pFile[7] != 0))
+		return false;
+	pos = 8;
+
+	switch(pDec->format & NNO_INTERPRET_WL_MASK)
+	{
+	case NNO_INTERPRET_WL_DOUBLE:
+		for(i = 0; i < pDec->count; i++, pos += 8)
+			pDec->wavelength[i] = GetDouble(&pFile[pos]);
+		break;
+	case NNO_INTERPRET_WL_FLOAT:
+		for(i = 0; i < pDec->count; i++, pos += 4)
+			pDec->wavelength[i] = GetFloat(&pFile[pos]);
+		break;
+	case NNO_INTERPRET_WL_COEFFS:
+		for(i = 0; i < 3; i++, pos += 8)
+			pDec->coeffs[i] = GetDouble(&pFile[pos]);
+		for(i = 0; i < pDec->count; i++, pos += 2)
+		{
+			half = GetShort(&pFile[pos]) / 2.0;
+			pDec->wavelength[i] = pDec->coeffs[2] * half * half + pDec->coeffs[1] * half +
+					pDec->coeffs[0];
+		}
+		break;
+	default:
+		return false;
+	}
+
+	switch(pDec->format & NNO_INTERPRET_INT_MASK)
+	{
+	case NNO_INTERPRET_INT_INT32:
+		for(i = 0; i < pDec->count; i++, pos += 4)
+			pDec->intensity[i] = GetInt(&pFile[pos]);
+		break;
+	case NNO_INTERPRET_INT_FLOAT:
+		for(i = 0; i < pDec->count; i++, pos += 4)
+			pDec->intensity[i] = GetFloat(&pFile[pos]);
+		break;
+	case NNO_INTERPRET_INT_INT16:
+		for(i = 0; i < pDec->count; i++, pos += 2)
+			pDec->intensity[i] = ldexp(GetShort(&pFile[pos]), pDec->shift);
+		break;
+	default:
+		return false;
+	}
+
+	return (pos == size);
+}
+
+/* Reads the file into file[] in one go and in random pieces, which must give
+ * the same bytes; returns its size */
+static uint32_t ReadFile(const INTERPRET_DATA_FILE *pFile)
+{
+	uint32_t offset = 0;
+	uint32_t length;
+	uint32_t got;
+
+	memset(file, 0xA5, sizeof(file));
+	CHECK(InterpretData_Read(pFile, 0, file, pFile->size + 100) == pFile->size);
+
+	memset(pieces, 0x5A, sizeof(pieces));
+	while(offset < pFile->size)
+	{
+		length = 1 + rand() % 70;
+		got = InterpretData_Read(pFile, offset, &pieces[offset], length);
+		if((got == 0) || (got > length))
+		{
+			CHECK(got != 0 && got <= length);
+			break;
+		}
+		offset += got;
+	}
+	CHECK(offset == pFile->size);
+	CHECK(memcmp(file, pieces, pFile->size) == 0);
+	CHECK(InterpretData_Read(pFile, pFile->size, pieces, 10) == 0);
+
+	return pFile->size;
+}
+
+static void CheckLayout(uint8_t format)
+{
+	INTERPRET_DATA_FILE f;
+	const double *pCoeffs = results.calibration_coeffs.PixelToWavelengthCoeffs;
+	double maxNmErr = 0;
+	double maxIntErr = 0;
+	double nmTol;
+	double intTol;
+	uint32_t size;
+	int i;
+
+	if(!InterpretData_Open(&f, &results, format))
+	{
+		printf("FAIL format 0x%02X: not opened\n", format);
+		failures++;
+		return;
+	}
+	size = ReadFile(&f);
+	if(!Decode(file, size, format, &dec))
+	{
+		printf("FAIL format 0x%02X: %u B do not decode\n", format, size);
+		failures++;
+		return;
+	}
+
+	CHECK(dec.count == TEST_NUM_PATTERNS);
+	if(format != INTERPRET_DATA_INTERLEAVED)
+	{
+		CHECK(dec.format == format);
+		if((format & NNO_INTERPRET_INT_MASK) != NNO_INTERPRET_INT_INT16)
+			CHECK(dec.shift == 0);
+	}
+	if((format & NNO_INTERPRET_WL_MASK) == NNO_INTERPRET_WL_COEFFS)
+	{
+		CHECK(dec.coeffs[0] == pCoeffs[0]);
+		CHECK(dec.coeffs[1] == pCoeffs[1]);
+		CHECK(dec.coeffs[2] == pCoeffs[2]);
+	}
+
+	for(i = 0; i < dec.count; i++)
+	{
+		if(fabs(dec.wavelength[i] - results.wavelength[i]) > maxNmErr)
+			maxNmErr = fabs(dec.wavelength[i] - results.wavelength[i]);
+		if(fabs(dec.intensity[i] - results.intensity[i]) > maxIntErr)
+			maxIntErr = fabs(dec.intensity[i] - results.intensity[i]);
+	}
+
+	/* Doubles and int32 are copied; the others are as close as their type allows */
+	switch(format == INTERPRET_DATA_INTERLEAVED ? NNO_INTERPRET_WL_DOUBLE : format & NNO_INTERPRET_WL_MASK)
+	{
+	case NNO_INTERPRET_WL_FLOAT:
+		nmTol = 2000 * FLT_EPSILON;
+		break;
+	case NNO_INTERPRET_WL_COEFFS:
+		nmTol = HALF_COLUMN_NM_TOLERANCE;
+		break;
+	default:
+		nmTol = 0;
+		break;
+	}
+	switch(format == INTERPRET_DATA_INTERLEAVED ? NNO_INTERPRET_INT_INT32 : format & NNO_INTERPRET_INT_MASK)
+	{
+	case NNO_INTERPRET_INT_INT16:
+		intTol = ldexp(1, dec.shift) / 2;
+		break;
+	default:
+		intTol = 0;
+		break;
+	}
+	CHECK(maxNmErr <= nmTol);
+	CHECK(maxIntErr <= intTol);
+
+	printf("format 0x%02X: %4u B, wavelengths within %.2g nm, intensities within %g\n",
+			format, size, maxNmErr, maxIntErr);
+}
+
+int main(void)
+{
+	INTERPRET_DATA_FILE f;
+	uint32_t size;
+	int i;
+
+	srand(1);
+
+	/* A column scan without noise, serialized and interpreted as on the EVM */
+	host_scan_make(&scan, TEST_NUM_PATTERNS, false, 0, TEST_PGA);
+	if((dlpspec_scan_write_data(&scan, blob, sizeof(blob)) != DLPSPEC_PASS) ||
+			(dlpspec_scan_interpret(blob, sizeof(blob), &results) != DLPSPEC_PASS))
+	{
+		printf("test_interpretData: the scan does not interpret\n");
+		return 1;
+	}
+	CHECK(results.length == TEST_NUM_PATTERNS);
+	CHECK(results.pga == TEST_PGA);
+
+	for(i = 0; i < (int)sizeof(formats); i++)
+		CheckLayout(formats[i]);
+
+	/* 2740 B interleaved against 944 B for the smallest layout */
+	CHECK(InterpretData_Open(&f, &results, INTERPRET_DATA_INTERLEAVED) && f.size == 4 + 228 * 12);
+	CHECK(InterpretData_Open(&f, &results, NNO_INTERPRET_WL_COEFFS | NNO_INTERPRET_INT_INT16) &&
+			f.size == 8 + 24 + 228 * 4);
+
+	/* Intensities beyond int16 are shifted down just enough */
+	for(i = 0; i < results.length; i++)
+		results.intensity[i] = i * 100 - 10000;
+	results.intensity[0] = INT16_MAX;
+	results.intensity[1] = INT16_MIN;
+	CHECK(InterpretData_Open(&f, &results, NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_INT16));
+	CHECK(f.shift == 0);
+	CheckLayout(NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_INT16);
+	results.intensity[0] = INT16_MAX + 1;
+	CHECK(InterpretData_Open(&f, &results, NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_INT16));
+	CHECK(f.shift == 1);
+	results.intensity[10] = 100000;
+	results.intensity[11] = -100000;
+	CHECK(InterpretData_Open(&f, &results, NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_INT16));
+	CHECK(f.shift == 2);
+	CheckLayout(NNO_INTERPRET_WL_FLOAT | NNO_INTERPRET_INT_INT16);
+
+	/* Unknown encodings and a wavelength off the calibration polynomial */
+	CHECK(!InterpretData_Open(&f, &results, NNO_INTERPRET_WL_MASK));
+	CHECK(!InterpretData_Open(&f, &results, NNO_INTERPRET_INT_MASK));
+	results.wavelength[5] += 0.3;
+	CHECK(!InterpretData_Open(&f, &results, NNO_INTERPRET_WL_COEFFS | NNO_INTERPRET_INT_INT32));
+	CHECK(InterpretData_Open(&f, &results, NNO_INTERPRET_WL_DOUBLE | NNO_INTERPRET_INT_INT32));
+
+	/* No points: just the header */
+	results.length = 0;
+	CHECK(InterpretData_Open(&f, &results, NNO_INTERPRET_WL_COEFFS | NNO_INTERPRET_INT_INT16));
+	size = ReadFile(&f);
+	CHECK(size == 8 + 24);
+	CHECK(Decode(file, size, f.format, &dec) && (dec.count == 0));
+
+	return host_test_result("test_interpretData");
+}
@@ -0,0 +1,322 @@
+/*
+ *
+ * Host test of the scan config store in EEPROM (App/nano_eeprom.c) over a
+ * simulated EEPROM that can lose power before any word it programs:
+ *
+ *	- configs stored packed the way they were before the config directory
+ *	  are migrated and read back
+ *	- random saves and erases are checked against a model; a quarter of
+ *	  them lose power partway, after which the record saved must read as
+ *	  either the old or the new version and every other record as before
+ *	- saves that need the records compacted first, including records slid
+ *	  down onto part of themselves, lose power at every word in turn
+ *	- a save that does not fit next to the record it replaces is refused
+ *	  and changes nothing
+ *
+ * nano_eeprom.c is included rather than linked so that a power cycle can
+ * drop its copies of the EEPROM in RAM.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include "../../App/nano_eeprom.c"
+#include "host_test.h"
+
+#define TEST_RANDOM_OPS		40000
+#define TEST_SWEEPS			40			/* compacting saves to cut at every word */
+
+/* EEPROM */
+static uint8_t ee[EEPROM_SIZE];
+static long budget = -1;			/* words programmed before the power fails; < 0 for never */
+static jmp_buf powerFail;
+static long slides;					/* move words written for a piece copied */
+
+/* What the EEPROM should hold */
+static uScanConfig model[EEPROM_MAX_SCAN_CFG_STORAGE];
+static int numModel;
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	if((ui32Address % 4) || (ui32Count % 4) || (ui32Address + ui32Count > EEPROM_SIZE))
+		abort();
+	memcpy(pui32Data, &ee[ui32Address], ui32Count);
+}
+
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+	uint32_t i;
+
+	if((ui32Address % 4) || (ui32Count % 4) || (ui32Address + ui32Count > EEPROM_SIZE))
+		abort();
+	for(i = 0; i < ui32Count; i += 4)
+	{
+		if(budget == 0)
+			longjmp(powerFail, 1);
+		if(budget > 0)
+			budget--;
+		memcpy(&ee[ui32Address + i], (uint8_t *)pui32Data + i, 4);
+		if((ui32Address + i == EEPROM_CFG_MOVE_ADDR) && (EEPROM_CFG_MOVE_DONE(pui32Data[i / 4]) != 0))
+			slides++;
+	}
+	return 0;
+}
+
+uScanData *GetScanDataPtr(void)
+{
+	return NULL;
+}
+
+static void PowerCycle(void)
+{
+	cfgDirLoaded = false;
+	counterLogLoaded = false;
+	memset(&cfgDir, 0xA5, sizeof(cfgDir));
+}
+
+/* Column configs of 64 bytes and slew configs of 64 to 108 bytes */
+static void MakeConfig(uScanConfig *pCfg, int r)
+{
+	int s;
+
+	memset(pCfg, 0, sizeof(uScanConfig));
+	for(s = 0; s < SCAN_CFG_FILENAME_LEN - 1; s++)
+		pCfg->scanCfg.config_name[s] = 'a' + (r + s) % 26;
+	if(r % 4)
+	{
+		pCfg->scanCfg.scan_type = SLEW_TYPE;
+		pCfg->slewScanCfg.head.num_sections = (r % 3) ? SLEW_SCAN_MAX_SECTIONS : 1 + r % 5;
+		for(s = 0; s < pCfg->slewScanCfg.head.num_sections; s++)
+			pCfg->slewScanCfg.section[s].num_patterns = r * 7 + s;
+	}
+	else
+		pCfg->scanCfg.num_patterns = r;
+}
+
+static bool SameConfig(uScanConfig *pA, uScanConfig *pB)
+{
+	uint32_t size = Nano_eeprom_GetConfigRecordSize(pA);
+
+	return (size == Nano_eeprom_GetConfigRecordSize(pB)) &&
+			!memcmp(pA, pB, MIN(size, sizeof(uScanConfig)));
+}
+
+/* Every record reads back as in the model */
+static bool CheckModel(void)
+{
+	uScanConfig cfg;
+	int i;
+
+	if(Nano_eeprom_GetNumConfigRecords() != numModel)
+		return false;
+	for(i = 0; i < numModel; i++)
+	{
+		if((Nano_eeprom_GetConfigRecord(i, &cfg) != PASS) || !SameConfig(&cfg, &model[i]) ||
+				(Nano_eeprom_GetScanConfigIndexUsingConfigID(model[i].scanCfg.scanConfigIndex) != i))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Saves pCfg at index with the power failing after 'words' words; returns
+ * false if the EEPROM then holds anything but the old or the new version of
+ * the record and the other records as they were. The model follows.
+ * *pDone is set if the save got through before the power failed.
+ */
+static bool TornSave(int index, uScanConfig *pCfg, long words, bool *pDone)
+{
+	uScanConfig cfg;
+	int oldNum = numModel;
+	int ret;
+	bool isNew;
+
+	budget = words;
+	if(setjmp(powerFail) == 0)
+	{
+		ret = Nano_eeprom_SaveConfigRecord(index, pCfg);
+		budget = -1;
+		*pDone = true;
+		if(ret != PASS)
+			return CheckModel();
+		isNew = true;
+	}
+	else
+	{
+		budget = -1;
+		*pDone = false;
+		PowerCycle();
+		isNew = (Nano_eeprom_GetNumConfigRecords() == oldNum + 1) ||
+				((index < oldNum) && (Nano_eeprom_GetConfigRecord(index, &cfg) == PASS) &&
+				SameConfig(&cfg, pCfg));
+	}
+	if(isNew)
+	{
+		model[index] = *pCfg;
+		if(index == numModel)
+			numModel++;
+	}
+	return CheckModel();
+}
+
+int main(void)
+{
+	static uint8_t before[EEPROM_SIZE];
+	uScanConfig cfg;
+	uint32_t offset = 0;
+	uint32_t word;
+	uint16_t space;
+	long saves = 0;
+	long refused = 0;
+	long torn = 0;
+	long compactions = 0;
+	long sweptWords = 0;
+	int sweeps = 0;
+	int index;
+	int i;
+
+	srand(1);
+	memset(ee, 0xFF, sizeof(ee));
+	memcpy(&ee[EEPROM_SERIAL_NUMBER_ADDR], "SER1234", 8);
+	word = 0;
+	memcpy(&ee[EEPROM_CONFIG_COUNTER_ADDR], &word, 4);
+
+	/* Records packed one after another with only a count, as stored before
+	 * the config directory */
+	numModel = 17;
+	for(i = 0; i < numModel; i++)
+	{
+		MakeConfig(&model[i], i * 3 + 1 + (i % 2));
+		model[i].scanCfg.scanConfigIndex = 100 + i;
+		memcpy(model[i].scanCfg.ScanConfig_serial_number, "SER1234", 8);
+		memset(&ee[EEPROM_SCAN_CFG_ADDRESS + offset], 0, Nano_eeprom_GetConfigRecordSize(&model[i]));
+		memcpy(&ee[EEPROM_SCAN_CFG_ADDRESS + offset], &model[i],
+				MIN(Nano_eeprom_GetConfigRecordSize(&model[i]), sizeof(uScanConfig)));
+		offset += Nano_eeprom_GetConfigRecordSize(&model[i]);
+	}
+	word = (numModel << 16) | 3;
+	memcpy(&ee[EEPROM_NUM_AND_ACTIVE_CFG_ADDR], &word, 4);
+	word = DLPSPEC_CFG_VER;
+	memcpy(&ee[EEPROM_CFG_VER_ADDR], &word, 4);
+	CHECK(CheckModel());
+	PowerCycle();
+	CHECK(CheckModel());
+	CHECK(Nano_eeprom_GetActiveConfigIndex() == 3);
+
+	for(i = 0; i < TEST_RANDOM_OPS; i++)
+	{
+		if(rand() % 100 < 2)
+		{
+			CHECK(Nano_eeprom_EraseAllConfigRecords() == PASS);
+			numModel = MIN(numModel, 1);
+			CHECK(CheckModel());
+			continue;
+		}
+
+		index = rand() % (numModel + 1);
+		if(index >= EEPROM_MAX_SCAN_CFG_STORAGE)
+			index = rand() % numModel;
+		MakeConfig(&cfg, rand());
+		if(Nano_eeprom_LoadConfigDir() != PASS)
+		{
+			CHECK(false);
+			break;
+		}
+		if(!Nano_eeprom_FindConfigSpace(Nano_eeprom_GetConfigRecordSize(&cfg), &space))
+		{
+			compactions++;
+
+			/* Lose the power at every word of the save in turn */
+			if(sweeps < TEST_SWEEPS)
+			{
+				uScanConfig saveModel[EEPROM_MAX_SCAN_CFG_STORAGE];
+				int saveNum = numModel;
+				long words;
+				bool done = false;
+
+				sweeps++;
+				memcpy(before, ee, sizeof(ee));
+				memcpy(saveModel, model, sizeof(model));
+				for(words = 0; !done; words++)
+				{
+					memcpy(ee, before, sizeof(ee));
+					memcpy(model, saveModel, sizeof(model));
+					numModel = saveNum;
+					PowerCycle();
+					if(!TornSave(index, &cfg, words, &done))
+					{
+						printf("FAIL compacting save cut after %ld words\n", words);
+						failures++;
+						break;
+					}
+				}
+				sweptWords += words;
+				continue;
+			}
+		}
+
+		if(rand() % 4 == 0)
+		{
+			bool done;
+
+			torn++;
+			CHECK(TornSave(index, &cfg, rand() % 400, &done));
+			PowerCycle();
+			CHECK(CheckModel());
+			continue;
+		}
+
+		if(Nano_eeprom_SaveConfigRecord(index, &cfg) == PASS)
+		{
+			saves++;
+			model[index] = cfg;
+			if(index == numModel)
+				numModel++;
+		}
+		else
+			refused++;
+		CHECK(CheckModel());
+		if(rand() % 10 == 0)
+		{
+			PowerCycle();
+			CHECK(CheckModel());
+		}
+		if(failures)
+			break;
+	}
+	printf("%ld saves, %ld refused, %ld cut short, %ld needed compacting, %ld pieces slid; "
+			"%d compacting saves cut at each of %ld words\n",
+			saves, refused, torn, compactions, slides, sweeps, sweptWords);
+	CHECK(slides > 0);
+
+	/* No room for a new copy next to the old record: refused, nothing lost */
+	Nano_eeprom_EraseAllConfigRecords();
+	MakeConfig(&model[0], 0);
+	CHECK(Nano_eeprom_SaveConfigRecord(0, &model[0]) == PASS);
+	for(i = 1; i < EEPROM_MAX_SCAN_CFG_STORAGE; i++)
+	{
+		MakeConfig(&model[i], 1);
+		CHECK(Nano_eeprom_SaveConfigRecord(i, &model[i]) == PASS);
+	}
+	numModel = EEPROM_MAX_SCAN_CFG_STORAGE;
+	CHECK(CheckModel());
+	MakeConfig(&cfg, 1);
+	CHECK(Nano_eeprom_SaveConfigRecord(0, &cfg) == FAIL);
+	CHECK(CheckModel());
+	PowerCycle();
+	CHECK(CheckModel());
+
+	Nano_eeprom_GatherScanCfgIDs();
+	for(i = 0; i < numModel; i++)
+		CHECK(g_scanConfigIDs[i] == model[i].scanCfg.scanConfigIndex);
+	CHECK(Nano_eeprom_ClearConfigDir() == PASS);
+	numModel = 0;
+	PowerCycle();
+	CHECK(CheckModel());
+
+	return host_test_result("test_nanoEeprom");
+}
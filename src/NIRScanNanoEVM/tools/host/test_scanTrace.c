@@ -0,0 +1,130 @@
+/*
+ *
+ * Host test of the scan trace ring (App/scanTrace.c). Logs a simulated scan
+ * through the SCAN_TRACE() trace points, checks the dump layout, overwrite
+ * and truncation, and writes the dump to the file named on the command line
+ * for tools/scantrace_decode.py.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "scanTrace.h"
+#include "host_test.h"
+
+static uint32_t GetWord(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t GetHalfWord(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static void SimulateScan(int num_repeats, int num_patterns)
+{
+	int i, j;
+
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SCAN_START, num_repeats);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SETUP_START, 1);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_DLPC_ON, 0);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_LAMP_ON, 0);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_DLPC_CONFIGURE_START, 0);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_DLPC_CONFIGURED, 0);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_PGA_PRESCAN_START, 0);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_PGA_SET, 16);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SETUP_END, 0);
+	for(i = 0; i < num_repeats; i++)
+	{
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_RUN_PATTERNS_START, 0);
+		SCAN_TRACE(SCAN_TRACE_MASK_ISR_DISPLAY, SCAN_TRACE_ISR_DISPLAY, 0);
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_FRAMES_PROPAGATED, 0);
+		for(j = 0; j < num_patterns; j++)
+		{
+			if(j % 24 == 0)
+				SCAN_TRACE(SCAN_TRACE_MASK_ISR_FRAME, SCAN_TRACE_ISR_FRAME, j / 24);
+			SCAN_TRACE(SCAN_TRACE_MASK_ISR_PATTERN, SCAN_TRACE_ISR_PATTERN, j);
+			SCAN_TRACE(SCAN_TRACE_MASK_ISR_DRDY, SCAN_TRACE_ISR_DRDY, j);
+		}
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_RUN_PATTERNS_END, num_patterns);
+		SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_REPEAT_DONE, i);
+	}
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_PROCESSING_DONE, 0);
+	SCAN_TRACE(SCAN_TRACE_MASK_PHASES, SCAN_TRACE_SCAN_END, 0);
+}
+
+int main(int argc, char *argv[])
+{
+	static uint8_t dump[SCAN_TRACE_DUMP_HEADER_SIZE + SCAN_TRACE_NUM_ENTRIES * sizeof(SCAN_TRACE_ENTRY)];
+	uint32_t size;
+	uint32_t i;
+	FILE *fp;
+
+	ScanTrace_Init();
+
+	/* Default mask: phases, frame and pattern interrupts only */
+	SimulateScan(2, 30);
+	size = ScanTrace_Snapshot(dump, sizeof(dump));
+	CHECK(GetHalfWord(&dump[0]) == SCAN_TRACE_DUMP_VERSION);
+	CHECK(GetHalfWord(&dump[2]) == sizeof(SCAN_TRACE_ENTRY));
+	CHECK(GetWord(&dump[4]) == 9 + 2 * (4 + 2 + 30) + 2);
+	CHECK(GetWord(&dump[8]) == 0);
+	CHECK(GetWord(&dump[12]) != 0);
+	CHECK(size == SCAN_TRACE_DUMP_HEADER_SIZE + GetWord(&dump[4]) * sizeof(SCAN_TRACE_ENTRY));
+	CHECK(GetHalfWord(&dump[SCAN_TRACE_DUMP_HEADER_SIZE + 4]) == SCAN_TRACE_SCAN_START);
+	CHECK(GetHalfWord(&dump[SCAN_TRACE_DUMP_HEADER_SIZE + 6]) == 2);
+	CHECK(GetHalfWord(&dump[size - 4]) == SCAN_TRACE_SCAN_END);
+
+	/* Events are in order and their timestamps do not go backwards */
+	for(i = 1; i < GetWord(&dump[4]); i++)
+		CHECK((int32_t)(GetWord(&dump[SCAN_TRACE_DUMP_HEADER_SIZE + i * 8]) -
+				GetWord(&dump[SCAN_TRACE_DUMP_HEADER_SIZE + (i - 1) * 8])) >= 0);
+
+	/* A full ring keeps the newest events and reports the rest as lost */
+	ScanTrace_SetMask(SCAN_TRACE_MASK_ALL);
+	ScanTrace_Clear();
+	SimulateScan(4, 100);
+	size = ScanTrace_Snapshot(dump, sizeof(dump));
+	CHECK(GetWord(&dump[4]) == SCAN_TRACE_NUM_ENTRIES);
+	CHECK(GetWord(&dump[8]) == 9 + 4 * (4 + 1 + 5 + 100 * 2) + 2 - SCAN_TRACE_NUM_ENTRIES);
+	CHECK(GetHalfWord(&dump[size - 4]) == SCAN_TRACE_SCAN_END);
+
+	/* A short buffer gets the newest events that fit */
+	size = ScanTrace_Snapshot(dump, SCAN_TRACE_DUMP_HEADER_SIZE + 3 * sizeof(SCAN_TRACE_ENTRY) + 5);
+	CHECK(GetWord(&dump[4]) == 3);
+	CHECK(size == SCAN_TRACE_DUMP_HEADER_SIZE + 3 * sizeof(SCAN_TRACE_ENTRY));
+	CHECK(GetHalfWord(&dump[size - 4]) == SCAN_TRACE_SCAN_END);
+	CHECK(ScanTrace_Snapshot(dump, SCAN_TRACE_DUMP_HEADER_SIZE - 1) == 0);
+
+	/* Mask 0 stops tracing */
+	ScanTrace_SetMask(0);
+	ScanTrace_Clear();
+	SimulateScan(1, 10);
+	ScanTrace_Snapshot(dump, sizeof(dump));
+	CHECK(GetWord(&dump[4]) == 0);
+
+	/* Leave a complete scan behind for the decoder */
+	ScanTrace_SetMask(SCAN_TRACE_MASK_PHASES | SCAN_TRACE_MASK_ISR_FRAME | SCAN_TRACE_MASK_ISR_PATTERN |
+			SCAN_TRACE_MASK_ISR_DISPLAY);
+	ScanTrace_Clear();
+	SimulateScan(3, 40);
+	size = ScanTrace_Snapshot(dump, sizeof(dump));
+	if(argc > 1)
+	{
+		fp = fopen(argv[1], "wb");
+		CHECK(fp != NULL);
+		if(fp != NULL)
+		{
+			CHECK(fwrite(dump, 1, size, fp) == size);
+			fclose(fp);
+		}
+	}
+
+	return host_test_result("test_scanTrace");
+}
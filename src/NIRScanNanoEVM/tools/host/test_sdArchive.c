@@ -0,0 +1,272 @@
+/*
+ *
+ * Host test of the SD scan archive (Drivers/sdArchive.c) on the RAM file
+ * system of host_ff.c: storing, replacing and deleting scans, reopening,
+ * recovery from a write cut off by a power loss and compaction, and the
+ * persistent scan index: lookups, queries and rebuilding a lost or stale
+ * index file.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "sdArchive.h"
+#include "host_ff.h"
+#include "host_test.h"
+
+#define TEST_DIR		"0:/TEST"
+#define TEST_INDEX_PATH	TEST_DIR "/" SD_ARCHIVE_INDEX_FILE_NAME
+#define TEST_SCAN_SIZE	3700
+
+static uint8_t scan[4096];
+static uint8_t readBack[4096];
+
+static void MakeScan(uint32_t index, uint8_t variant)
+{
+	int i;
+
+	for(i = 0; i < TEST_SCAN_SIZE; i++)
+		scan[i] = (uint8_t)(index * 31 + i) ^ variant;
+}
+
+static bool ScanMatches(uint32_t index, uint8_t variant)
+{
+	uint32_t length;
+
+	if(SDArchive_Read(index, readBack, sizeof(readBack), &length) != FR_OK)
+		return false;
+	MakeScan(index, variant);
+	return (length == TEST_SCAN_SIZE) && !memcmp(readBack, scan, length);
+}
+
+static void TestStoreAndReopen(void)
+{
+	SD_ARCHIVE_INFO info;
+	uint32_t length;
+	uint32_t i;
+
+	host_ff_reset();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	for(i = 1; i <= 100; i++)
+	{
+		MakeScan(i, 0);
+		CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, i, (uint16_t)(i % 5)) == FR_OK);
+	}
+	for(i = 1; i <= 100; i++)
+		CHECK(ScanMatches(i, 0));
+
+	/* Replace one scan, delete another */
+	MakeScan(7, 0x5A);
+	CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, 7, 0) == FR_OK);
+	CHECK(SDArchive_Delete(50) == FR_OK);
+	CHECK(SDArchive_Delete(50) == FR_NO_FILE);
+	CHECK(SDArchive_Read(50, readBack, sizeof(readBack), &length) == FR_NO_FILE);
+	CHECK(SDArchive_Read(1, readBack, TEST_SCAN_SIZE - 1, &length) != FR_OK);
+
+	SDArchive_Close();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	SDArchive_GetInfo(&info);
+	CHECK(info.num_records == 99);
+	CHECK(info.dead_bytes > 0);
+	CHECK(ScanMatches(7, 0x5A));
+	CHECK(ScanMatches(100, 0));
+	CHECK(!SDArchive_Contains(50));
+	CHECK((SDArchive_GetLength(7, &length) == FR_OK) && (length == TEST_SCAN_SIZE));
+	CHECK(SDArchive_GetLength(50, &length) == FR_NO_FILE);
+	SDArchive_Close();
+}
+
+static void TestTornWrite(void)
+{
+	SD_ARCHIVE_INFO info;
+
+	host_ff_reset();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	MakeScan(1, 0);
+	CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, 1, 0) == FR_OK);
+
+	/* Power lost while the payload of scan 2 was being written */
+	MakeScan(2, 0);
+	host_ff_tear_write(1);
+	CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, 2, 0) != FR_OK);
+	host_ff_tear_write(-1);
+
+	SDArchive_Close();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	CHECK(ScanMatches(1, 0));
+	CHECK(!SDArchive_Contains(2));
+
+	/* The next scan goes after the last good record and survives a reopen */
+	MakeScan(3, 0);
+	CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, 3, 0) == FR_OK);
+	SDArchive_Close();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	SDArchive_GetInfo(&info);
+	CHECK(info.num_records == 2);
+	CHECK(ScanMatches(1, 0));
+	CHECK(ScanMatches(3, 0));
+	SDArchive_Close();
+}
+
+static void TestCompact(void)
+{
+	SD_ARCHIVE_INFO before;
+	SD_ARCHIVE_INFO info;
+	uint32_t i;
+
+	host_ff_reset();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	for(i = 1; i <= 40; i++)
+	{
+		MakeScan(i, 0);
+		CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, i, 0) == FR_OK);
+	}
+	for(i = 1; i <= 40; i += 3)
+		CHECK(SDArchive_Delete(i) == FR_OK);
+	SDArchive_GetInfo(&before);
+
+	/* A scratch buffer too small for a scan leaves the archive as it was */
+	CHECK(SDArchive_Compact(readBack, TEST_SCAN_SIZE - 1) != FR_OK);
+	SDArchive_GetInfo(&info);
+	CHECK(info.num_records == before.num_records);
+	CHECK(info.dead_bytes == before.dead_bytes);
+	CHECK(ScanMatches(2, 0));
+
+	CHECK(SDArchive_Compact(readBack, sizeof(readBack)) == FR_OK);
+	SDArchive_GetInfo(&info);
+	CHECK(info.num_records == before.num_records);
+	CHECK(info.dead_bytes == 0);
+	CHECK(info.used_bytes < before.used_bytes);
+	for(i = 1; i <= 40; i++)
+	{
+		if(i % 3 == 1)
+			CHECK(!SDArchive_Contains(i));
+		else
+			CHECK(ScanMatches(i, 0));
+	}
+
+	SDArchive_Close();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	CHECK(ScanMatches(39, 0));
+	CHECK(!SDArchive_Contains(40));
+	SDArchive_Close();
+}
+
+static uint32_t CountQuery(uint32_t min_index, uint32_t min_timestamp)
+{
+	SD_ARCHIVE_ENTRY entries[7];
+	SD_ARCHIVE_INFO info;
+	uint32_t pos;
+	uint32_t num;
+	uint32_t total = 0;
+	uint32_t last = 0;
+	uint32_t i;
+
+	CHECK(SDArchive_FindPosition(min_index, &pos) == FR_OK);
+	SDArchive_GetInfo(&info);
+	while(pos < info.num_positions)
+	{
+		if(SDArchive_Query(&pos, min_timestamp, entries, 7, &num) != FR_OK)
+		{
+			CHECK(false);
+			break;
+		}
+		for(i = 0; i < num; i++)
+		{
+			CHECK(entries[i].index >= min_index);
+			CHECK(entries[i].index > last);
+			CHECK(entries[i].timestamp >= min_timestamp);
+			CHECK(entries[i].length == TEST_SCAN_SIZE);
+			CHECK(entries[i].config_id == (uint16_t)(entries[i].index % 5));
+			last = entries[i].index;
+		}
+		total += num;
+	}
+	return total;
+}
+
+static void TestIndex(void)
+{
+	SD_ARCHIVE_INFO info;
+	uint32_t last;
+	uint32_t i;
+
+	host_ff_reset();
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	/* Enough scans for the index to span more pages than are cached */
+	for(i = 1; i <= 300; i++)
+	{
+		MakeScan(i * 10, 0);
+		host_ff_set_time(1000 + i);
+		CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, i * 10, (uint16_t)((i * 10) % 5)) == FR_OK);
+	}
+	/* Out of order index goes into the middle of the index */
+	MakeScan(55, 0);
+	CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, 55, 0) == FR_OK);
+	CHECK(ScanMatches(55, 0));
+	CHECK(ScanMatches(10, 0));
+	CHECK(ScanMatches(3000, 0));
+
+	CHECK(SDArchive_Delete(500) == FR_OK);
+	CHECK(!SDArchive_Contains(500));
+	CHECK(SDArchive_Contains(510));
+	CHECK(CountQuery(0, 0) == 300);
+	CHECK(CountQuery(2000, 0) == 101);
+	CHECK(CountQuery(0, 1201) == 101);
+	CHECK(SDArchive_GetLastIndex(&last) && (last == 3000));
+	CHECK(SDArchive_Delete(3000) == FR_OK);
+	CHECK(SDArchive_GetLastIndex(&last) && (last == 2990));
+
+	/* Lost index file: rebuilt from the archive on open */
+	SDArchive_Close();
+	CHECK(f_unlink(TEST_INDEX_PATH) == FR_OK);
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	SDArchive_GetInfo(&info);
+	CHECK(info.num_records == 299);
+	CHECK(ScanMatches(55, 0));
+	CHECK(!SDArchive_Contains(500));
+	CHECK(CountQuery(0, 0) == 299);
+
+	/* Index header older than the last appends, as after a power loss */
+	{
+		static uint8_t saved[SD_ARCHIVE_INDEX_PAGE_SIZE];
+		FIL file;
+		UINT num;
+
+		CHECK(f_open(&file, TEST_INDEX_PATH, FA_READ) == FR_OK);
+		CHECK((f_read(&file, saved, sizeof(saved), &num) == FR_OK) && (num == sizeof(saved)));
+		f_close(&file);
+
+		MakeScan(6000, 0);
+		CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, 6000, 0) == FR_OK);
+		MakeScan(5, 0);
+		CHECK(SDArchive_Append(scan, TEST_SCAN_SIZE, 5, 0) == FR_OK);
+		SDArchive_Close();
+
+		CHECK(f_open(&file, TEST_INDEX_PATH, FA_WRITE) == FR_OK);
+		CHECK(f_write(&file, saved, sizeof(saved), &num) == FR_OK);
+		f_close(&file);
+	}
+	CHECK(SDArchive_Open(TEST_DIR) == FR_OK);
+	SDArchive_GetInfo(&info);
+	CHECK(info.num_records == 301);
+	CHECK(ScanMatches(5, 0));
+	CHECK(ScanMatches(6000, 0));
+	CHECK(SDArchive_GetLastIndex(&last) && (last == 6000));
+	SDArchive_Close();
+}
+
+int main(void)
+{
+	TestStoreAndReopen();
+	TestTornWrite();
+	TestCompact();
+	TestIndex();
+
+	return host_test_result("test_sdArchive");
+}
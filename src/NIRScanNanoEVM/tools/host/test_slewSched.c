@@ -0,0 +1,167 @@
+/*
+ *
+ * Host test of the slew scan section ordering (App/slewSched.c) against the
+ * packer Scan_SetUpSlewScan() had before: in configuration order
+ * SlewSched_Pack() gives the same vsync and frame arrays, the order
+ * SlewSched_FindBestOrder() picks runs every pattern exactly once and never
+ * takes more frames, and SlewSched_BuildAdcMap() puts every measured value
+ * back where configuration order has it.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "common.h"
+#include "display.h"
+#include "host_slewSched.h"
+#include "host_test.h"
+
+#define TEST_CONFIGS	20000
+
+static int ref_vsyncs[HOST_SLEW_MAX_VSYNCS + 4];
+static int ref_frames[NUM_FRAMEBUFFERS * 4];
+static int vsyncs[HOST_SLEW_MAX_VSYNCS];
+static int frames[NUM_FRAMEBUFFERS];
+static uint16_t adc_map[ADC_DATA_LEN];
+
+static void InitPlan(SLEW_SCHED_PLAN *pPlan)
+{
+	pPlan->pPatternsPerVsync = vsyncs;
+	pPlan->maxVsyncs = HOST_SLEW_MAX_VSYNCS;
+	pPlan->pFrameSyncs = frames;
+	pPlan->maxFrames = NUM_FRAMEBUFFERS;
+}
+
+/* Checks that the plan shows each pattern once and a black pattern after every 24th */
+static void CheckCoverage(const SLEW_SCHED_SECTION *pSect, int num_sections, const SLEW_SCHED_PLAN *pPlan)
+{
+	int num_patterns = 0;
+	int num_positions = 0;
+	int shown = 0;
+	int syncs = 0;
+	int i;
+
+	for(i=0; i<num_sections; i++)
+	{
+		num_patterns += pSect[i].num_patterns;
+		num_positions += pPlan->section_num_positions[i];
+	}
+	for(i=0; i<pPlan->numVsyncs; i++)
+		shown += pPlan->pPatternsPerVsync[i];
+	for(i=0; i<pPlan->numFrames; i++)
+		syncs += pPlan->pFrameSyncs[i];
+
+	CHECK(shown == num_patterns + (num_patterns - 1) / NUM_BP_PER_FRAME);
+	CHECK(num_positions == shown);
+	CHECK(pPlan->numFrames == (num_patterns + NUM_BP_PER_FRAME - 1) / NUM_BP_PER_FRAME);
+	CHECK(syncs == pPlan->totalFrames);
+}
+
+/*
+ * Checks that the map moves each measured value to a distinct position of the
+ * same section in configuration order and leaves the black patterns alone
+ */
+static void CheckAdcMap(const SLEW_SCHED_SECTION *pSect, const uint8_t *pOrder, int num_sections)
+{
+	uint8_t cfg_section[ADC_DATA_LEN];
+	uint8_t exec_section[ADC_DATA_LEN];
+	bool taken[ADC_DATA_LEN];
+	int num_positions;
+	int item;
+	int pos;
+	int i, j;
+
+	CHECK(SlewSched_BuildAdcMap(pSect, pOrder, num_sections, adc_map, ADC_DATA_LEN) == PASS);
+
+	memset(cfg_section, 0xFF, sizeof(cfg_section));
+	memset(exec_section, 0xFF, sizeof(exec_section));
+	memset(taken, 0, sizeof(taken));
+	for(item=0, i=0; i<num_sections; i++)
+	{
+		for(j=0; j<pSect[i].num_patterns; j++, item++)
+			cfg_section[item + item / NUM_BP_PER_FRAME] = i;
+	}
+	num_positions = item + (item - 1) / NUM_BP_PER_FRAME;
+	for(item=0, i=0; i<num_sections; i++)
+	{
+		for(j=0; j<pSect[pOrder[i]].num_patterns; j++, item++)
+			exec_section[item + item / NUM_BP_PER_FRAME] = pOrder[i];
+	}
+
+	for(pos=0; pos<num_positions; pos++)
+	{
+		CHECK(adc_map[pos] < num_positions);
+		if(adc_map[pos] >= num_positions)
+			continue;
+		CHECK(!taken[adc_map[pos]]);
+		taken[adc_map[pos]] = true;
+		/* 0xFF on both sides for a black pattern */
+		CHECK(cfg_section[adc_map[pos]] == exec_section[pos]);
+	}
+}
+
+int main(void)
+{
+	SLEW_SCHED_SECTION sect[SLEW_SCAN_MAX_SECTIONS];
+	const uint8_t identity[SLEW_SCAN_MAX_SECTIONS] = { 0, 1, 2, 3, 4 };
+	uint8_t order[SLEW_SCAN_MAX_SECTIONS];
+	SLEW_SCHED_PLAN plan;
+	int num_sections;
+	int ref_num_vsyncs, ref_num_frames;
+	int ref_total;
+	int best;
+	int tested = 0;
+	int fewer = 0;
+	int n, i;
+
+	srand(29);
+	for(n=0; n<TEST_CONFIGS; n++)
+	{
+		num_sections = host_slew_make(sect, MAX_PATTERNS_PER_SCAN);
+		ref_total = host_slew_greedy_pack(sect, num_sections, ref_vsyncs, &ref_num_vsyncs,
+				ref_frames, &ref_num_frames);
+
+		/* Configuration order: the same arrays as before */
+		InitPlan(&plan);
+		CHECK(SlewSched_Pack(sect, identity, num_sections, &plan) == ref_total);
+		CHECK(plan.numVsyncs == ref_num_vsyncs);
+		CHECK(plan.numFrames == ref_num_frames);
+		CHECK(memcmp(vsyncs, ref_vsyncs, ref_num_vsyncs * sizeof(int)) == 0);
+		CHECK(memcmp(frames, ref_frames, ref_num_frames * sizeof(int)) == 0);
+		CheckCoverage(sect, num_sections, &plan);
+
+		/* The order picked: every pattern once, never more frames */
+		best = SlewSched_FindBestOrder(sect, num_sections, HOST_SLEW_MAX_VSYNCS, NUM_FRAMEBUFFERS, order);
+		CHECK(best > 0);
+		CHECK(best <= ref_total);
+		InitPlan(&plan);
+		CHECK(SlewSched_Pack(sect, order, num_sections, &plan) == best);
+		CheckCoverage(sect, num_sections, &plan);
+		CheckAdcMap(sect, order, num_sections);
+		for(i=0; i<num_sections; i++)
+			CHECK(memchr(order, i, num_sections) != NULL);
+
+		tested++;
+		if(best < ref_total)
+			fewer++;
+	}
+
+	/* Too small arrays are refused, not overrun */
+	sect[0].num_patterns = 600;
+	sect[0].exp_time_us = 60960;
+	InitPlan(&plan);
+	plan.maxVsyncs = 100;
+	CHECK(SlewSched_Pack(sect, identity, 1, &plan) == FAIL);
+	CHECK(plan.overflow);
+	CHECK(SlewSched_FindBestOrder(sect, 1, 100, NUM_FRAMEBUFFERS, order) == FAIL);
+	CHECK(SlewSched_FindBestOrder(sect, SLEW_SCAN_MAX_SECTIONS + 1, HOST_SLEW_MAX_VSYNCS, NUM_FRAMEBUFFERS, order) == FAIL);
+
+	printf("%d configs, %d needed fewer frames in another order\n", tested, fewer);
+	return host_test_result("test_slewSched");
+}
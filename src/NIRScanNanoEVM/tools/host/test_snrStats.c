@@ -0,0 +1,237 @@
+/*
+ *
+ * Host test of the streaming SNR statistics (App/snrStats.c) against the
+ * post-processing Scan_CalculateSNR_17ms/133ms/600ms() did on the 720x9
+ * repeat matrix before, on the SNR scan data in snr_capture.txt. The two
+ * sum in a different order in float, so results must agree to within
+ * SNR_TOLERANCE (relative); SNR values stay below 10000, so that is less
+ * than one count. Patterns run out of order and
+ * mapped back must give the same result as patterns run in order.
+ *
+ *     test_snrStats snr_capture.txt
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "common.h"
+#include "snrStats.h"
+#include "host_test.h"
+
+#define SNR_TOLERANCE	1e-4
+
+/* As App/scan.c had them before */
+#define NUMBER_SCANS        720
+#define NUMBER_BIN_1        90
+#define NUMBER_BIN_2        20
+#define BIN1_SIZE           NUMBER_SCANS/NUMBER_BIN_1
+#define BIN2_SIZE           NUMBER_SCANS/NUMBER_BIN_2
+
+static long long capture[NUMBER_SCANS][SNR_PATTERNS];
+
+static float SNR_ScanArr[NUMBER_SCANS][SNR_PATTERNS];
+static float SNR_100ms_bins[NUMBER_BIN_1][SNR_PATTERNS];
+static float SNR_500ms_bins[NUMBER_BIN_2][SNR_PATTERNS];
+static float snrDiff[NUMBER_SCANS];
+static float snrtemp[NUMBER_SCANS];
+
+/* Scan_BinandAverage(), find_meanstandard_deviation() and Scan_CalculateSNR() as they were */
+static int Scan_BinandAverage(float scanArr[][SNR_PATTERNS] , int num_repeats , int steps , float resultArr[][SNR_PATTERNS])
+{
+	int i , j , k;
+	float sum =0.0;
+	int countbin=0;
+	int countscan=0;
+
+	for(j=0 ; j<SNR_PATTERNS ; j++)
+	{
+		countbin = 0;
+		for(i=0; i<num_repeats/*720*/ ; i+=steps/*8*/)
+		{
+			for(k=i ; k<i+steps ; k+=4)
+			{
+				sum += scanArr[k][j];
+				countscan++;
+			}
+
+			resultArr[countbin][j]= (float)sum/(float)countscan;
+			countscan = 0;
+			countbin++;
+			sum = 0;
+		}
+	}
+	return PASS;
+}
+
+static void find_meanstandard_deviation(float* data, int n , float* average , float* std)
+{
+	float mean=0.0, sum_deviation=0.0;
+	int i;
+	for(i=0; i<n;++i)
+	{
+		mean+=data[i];
+	}
+	mean=mean/n;
+	*average = mean;
+
+	for(i=0; i<n;++i)
+		sum_deviation+=(data[i]-mean)*(data[i]-mean);
+
+	*std = sqrt(sum_deviation/n);
+
+	return;
+
+}
+
+static int Scan_CalculateSNR(float snr_arr[][SNR_PATTERNS] , int num_repeat , float* result_array )
+{
+	int i , j ;
+	int count = 0;
+
+	float avg=0.0  , std = 0.0 , avgdummy= 0.0 , stddummy = 0.0;
+
+	for(j=0; j<SNR_PATTERNS ; j++)
+	{
+		for(i=0 ; i<num_repeat ; i++)
+		{
+			snrtemp[i] = snr_arr[i][j];
+
+			if(i>0 && i<NUMBER_SCANS)
+			{
+
+				count++;
+				snrDiff[i-1] = snrtemp[i]-snrtemp[i-1];
+			}
+			find_meanstandard_deviation(snrtemp, num_repeat  , &avg , &stddummy);
+			find_meanstandard_deviation(snrDiff, count  , &avgdummy , &std);
+			result_array[j] = (float)avg/std;
+
+		}
+		count = 0;
+	}
+
+	return PASS;
+}
+
+static int ReadCapture(const char *path)
+{
+	char line[256];
+	FILE *fp = fopen(path, "r");
+	int n = 0;
+	int j;
+
+	if(fp == NULL)
+		return FAIL;
+	while((n < NUMBER_SCANS) && (fgets(line, sizeof(line), fp) != NULL))
+	{
+		if(line[0] == '#')
+			continue;
+		if(sscanf(line, "%lld %lld %lld %lld %lld %lld %lld %lld %lld", &capture[n][0],
+				&capture[n][1], &capture[n][2], &capture[n][3], &capture[n][4], &capture[n][5],
+				&capture[n][6], &capture[n][7], &capture[n][8]) != SNR_PATTERNS)
+			break;
+		for(j=0; j<SNR_PATTERNS; j++)
+			SNR_ScanArr[n][j] = (float)capture[n][j];
+		n++;
+	}
+	fclose(fp);
+	return (n == NUMBER_SCANS) ? PASS : FAIL;
+}
+
+static double Compare(const char *name, const float *pOld, const float *pNew)
+{
+	double worst = 0;
+	double rel;
+	float lo = pOld[0], hi = pOld[0];
+	int j;
+
+	for(j=0; j<SNR_PATTERNS; j++)
+	{
+		lo = (pOld[j] < lo) ? pOld[j] : lo;
+		hi = (pOld[j] > hi) ? pOld[j] : hi;
+		rel = fabs(pNew[j] - pOld[j]) / fabs(pOld[j]);
+		CHECK(pOld[j] > 0);
+		CHECK(rel <= SNR_TOLERANCE);
+		if(rel > worst)
+			worst = rel;
+	}
+	printf("%-6s SNR %7.1f .. %7.1f, worst relative difference %.1e\n", name, lo, hi, worst);
+	return worst;
+}
+
+int main(int argc, char *argv[])
+{
+	/* The windows App/scan.c starts with */
+	const SNR_STATS_WINDOW windows[SNR_STATS_NUM_WINDOWS] =
+	{
+		{ 1, 1 },
+		{ BIN1_SIZE, 4 },
+		{ BIN2_SIZE, 4 }
+	};
+	const char *names[SNR_STATS_NUM_WINDOWS] = { "17ms", "133ms", "600ms" };
+	/* Run order of a reordered slew scan; map[k] is the configuration index */
+	const uint16_t map[SNR_PATTERNS] = { 6, 7, 8, 0, 1, 2, 3, 4, 5 };
+	static SNR_STATS_ACC acc[SNR_STATS_NUM_WINDOWS];
+	static SNR_STATS_ACC mapped[SNR_STATS_NUM_WINDOWS];
+	long long run[SNR_PATTERNS];
+	snrData old;
+	float result[SNR_PATTERNS];
+	float result_mapped[SNR_PATTERNS];
+	const SNR_STATS_WINDOW bad = { 4, 8 };
+	int i, j;
+
+	if((argc < 2) || (ReadCapture(argv[1]) != PASS))
+	{
+		printf("usage: test_snrStats <capture of %d lines of %d ADC values>\n", NUMBER_SCANS, SNR_PATTERNS);
+		return 2;
+	}
+
+	Scan_CalculateSNR(SNR_ScanArr , NUMBER_SCANS  , old.snr_17ms );
+	Scan_BinandAverage(SNR_ScanArr , NUMBER_SCANS  , BIN1_SIZE  , SNR_100ms_bins);
+	Scan_CalculateSNR(SNR_100ms_bins , NUMBER_BIN_1 , old.snr_100ms);
+	Scan_BinandAverage(SNR_ScanArr , NUMBER_SCANS  , BIN2_SIZE  , SNR_500ms_bins);
+	Scan_CalculateSNR(SNR_500ms_bins , NUMBER_BIN_2 , old.snr_500ms );
+
+	for(i=0; i<SNR_STATS_NUM_WINDOWS; i++)
+	{
+		CHECK(SnrStats_Init(&acc[i], &windows[i]) == PASS);
+		CHECK(SnrStats_Init(&mapped[i], &windows[i]) == PASS);
+	}
+	for(i=0; i<NUMBER_SCANS; i++)
+	{
+		for(j=0; j<SNR_PATTERNS; j++)
+			run[j] = capture[i][map[j]];
+		for(j=0; j<SNR_STATS_NUM_WINDOWS; j++)
+		{
+			SnrStats_AddRepeat(&acc[j], capture[i], SNR_PATTERNS, NULL);
+			SnrStats_AddRepeat(&mapped[j], run, SNR_PATTERNS, map);
+		}
+	}
+
+	for(i=0; i<SNR_STATS_NUM_WINDOWS; i++)
+	{
+		SnrStats_GetSNR(&acc[i], result);
+		SnrStats_GetSNR(&mapped[i], result_mapped);
+		Compare(names[i], (i == 0) ? old.snr_17ms : (i == 1) ? old.snr_100ms : old.snr_500ms, result);
+		CHECK(memcmp(result, result_mapped, sizeof(result)) == 0);
+	}
+
+	/* A trailing partial bin is left out; fewer than two bins give 0 */
+	SnrStats_AddRepeat(&acc[2], capture[0], SNR_PATTERNS, NULL);
+	SnrStats_GetSNR(&acc[2], result_mapped);
+	CHECK(memcmp(result, result_mapped, sizeof(result)) == 0);
+	SnrStats_Init(&acc[2], &windows[2]);
+	for(i=0; i<BIN2_SIZE; i++)
+		SnrStats_AddRepeat(&acc[2], capture[i], SNR_PATTERNS, NULL);
+	SnrStats_GetSNR(&acc[2], result);
+	CHECK(result[0] == 0);
+	CHECK(SnrStats_Init(&acc[0], &bad) == FAIL);
+
+	return host_test_result("test_snrStats");
+}
@@ -0,0 +1,158 @@
+/*
+ *
+ * Host round trip of the packed interpreted spectrum of dlpspeclib
+ * (dlpspec_spectrum_pack/unpack): column, Hadamard and multi-section slew
+ * scans are interpreted, packed exactly and rounded to int16, and unpacked
+ * again. Wavelengths must come back within HALF_COLUMN_NM_TOLERANCE
+ * (0.001 nm) of the interpreted ones, intensities exactly or within half a
+ * step; a 228-point column scan packs to 519 B. Corrupted and truncated packed
+ * spectra must be rejected or decoded without faults.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "dlpspec_scan.h"
+#include "dlpspec_compress.h"
+#include "dlpspec_util.h"
+#include "host_scan.h"
+#include "host_test.h"
+
+#define TEST_SHIFT_BYTE		9		/* header byte holding the intensity shift */
+#define TEST_CORRUPT_RUNS	20000
+
+typedef struct
+{
+	int			num_sections;
+	int			num_patterns[3];
+	uint8_t		type[3];
+	uint8_t		width_px[3];
+	const char	*name;
+} TEST_CONFIG;
+
+static const TEST_CONFIG configs[] =
+{
+	{ 1, { 228 }, { COLUMN_TYPE }, { 6 }, "column 228 w6" },
+	{ 1, { 228 }, { COLUMN_TYPE }, { 7 }, "column 228 w7" },
+	{ 1, { 624 }, { COLUMN_TYPE }, { 6 }, "column 624 w6" },
+	{ 1, { 228 }, { HADAMARD_TYPE }, { 6 }, "hadamard 228 w6" },
+	{ 1, { 624 }, { HADAMARD_TYPE }, { 8 }, "hadamard 624 w8" },
+	{ 3, { 80, 150, 60 }, { COLUMN_TYPE, HADAMARD_TYPE, COLUMN_TYPE }, { 9, 6, 5 }, "slew 3 sections" },
+};
+
+/* Splits the one-section scan of host_scan_make() into the configured sections */
+static void MakeScan(uScanData *pData, const TEST_CONFIG *pConfig)
+{
+	slewScanConfig *pCfg = &pData->slew_data.slewCfg;
+	int total = 0;
+	int s;
+
+	for(s = 0; s < pConfig->num_sections; s++)
+		total += pConfig->num_patterns[s];
+	host_scan_make(pData, total, pConfig->type[0] == HADAMARD_TYPE, 150, 64);
+
+	pCfg->head.num_sections = pConfig->num_sections;
+	for(s = 0; s < pConfig->num_sections; s++)
+	{
+		pCfg->section[s] = pCfg->section[0];
+		pCfg->section[s].section_scan_type = pConfig->type[s];
+		pCfg->section[s].width_px = pConfig->width_px[s];
+		pCfg->section[s].wavelength_start_nm = 900 + s * 800 / pConfig->num_sections;
+		pCfg->section[s].wavelength_end_nm = 900 + (s + 1) * 800 / pConfig->num_sections;
+		pCfg->section[s].num_patterns = pConfig->num_patterns[s];
+	}
+}
+
+int main(void)
+{
+	static uScanData scan;
+	static uint8_t blob[SCAN_DATA_BLOB_SIZE];
+	static uint8_t packed[SCAN_DATA_BLOB_SIZE];
+	static uint8_t corrupt[SCAN_DATA_BLOB_SIZE];
+	static scanResults results;
+	static scanResults back;
+	static int32_t work[ADC_DATA_LEN];
+	size_t size;
+	size_t exactSize = 0;
+	unsigned c;
+	int pass;
+	int i;
+
+	srand(1);
+	for(c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+	{
+		MakeScan(&scan, &configs[c]);
+		if((dlpspec_scan_write_data(&scan, blob, sizeof(blob)) != DLPSPEC_PASS) ||
+				(dlpspec_scan_interpret(blob, sizeof(blob), &results) != DLPSPEC_PASS))
+		{
+			printf("FAIL %s: interpreting the scan\n", configs[c].name);
+			failures++;
+			continue;
+		}
+
+		/* pass 0 keeps the intensities exact, pass 1 rounds them to int16 */
+		for(pass = 0; pass < 2; pass++)
+		{
+			double maxNmErr = 0;
+			int maxErr = 0;
+			int step;
+
+			if(dlpspec_spectrum_pack(&results, pass ? SPEC_PACK_SHIFT_INT16 : 0, work,
+						packed, sizeof(packed), &size) != DLPSPEC_PASS)
+			{
+				printf("FAIL %s: packing\n", configs[c].name);
+				failures++;
+				continue;
+			}
+			memset(&back, 0xA5, sizeof(back));
+			CHECK(dlpspec_spectrum_unpack(packed, size, &back) == DLPSPEC_PASS);
+			CHECK(back.length == results.length);
+			CHECK(back.pga == results.pga);
+
+			step = 1 << packed[TEST_SHIFT_BYTE];
+			for(i = 0; i < results.length; i++)
+			{
+				if(abs(back.intensity[i] - results.intensity[i]) > maxErr)
+					maxErr = abs(back.intensity[i] - results.intensity[i]);
+				if(fabs(back.wavelength[i] - results.wavelength[i]) > maxNmErr)
+					maxNmErr = fabs(back.wavelength[i] - results.wavelength[i]);
+				if(pass)
+					CHECK(abs(back.intensity[i] / step) <= 32768);
+			}
+			CHECK(maxNmErr <= HALF_COLUMN_NM_TOLERANCE);
+			if(pass)
+				CHECK(maxErr <= step / 2);
+			else
+			{
+				CHECK(maxErr == 0);
+				exactSize = size;
+			}
+
+			/* Corrupted or truncated input is rejected or decodes without faults */
+			for(i = 0; i < TEST_CORRUPT_RUNS; i++)
+			{
+				memcpy(corrupt, packed, size);
+				corrupt[rand() % size] ^= 1 << (rand() % 8);
+				dlpspec_spectrum_unpack(corrupt, size - rand() % 3, &back);
+			}
+			CHECK(dlpspec_spectrum_pack(&results, 0, work, packed, exactSize - 1, &size) ==
+					ERR_DLPSPEC_INSUFFICIENT_MEM);
+		}
+		printf("%-16s %3d points: blob %zu B, results %4d B, packed %4zu B\n", configs[c].name,
+				results.length, SCAN_DATA_BLOB_SIZE, results.length * 12, exactSize);
+	}
+
+	/* A wavelength off the calibration polynomial is refused */
+	results.wavelength[3] += 0.3;
+	CHECK(dlpspec_spectrum_pack(&results, 0, work, packed, sizeof(packed), &size) ==
+			ERR_DLPSPEC_INVALID_INPUT);
+
+	return host_test_result("test_spectrumPack");
+}
@@ -0,0 +1,294 @@
+/*
+ *
+ * Host test of the UART command framing (App/uartFrame.c) across a pty pair
+ * standing in for the UART. A device thread feeds the receiver in chunks of
+ * up to 8 bytes as the uDMA hands them over, reports the line idle after
+ * 2 ms and a timeout after UART_TEST_TIMEOUT_MS, and answers each frame in
+ * the framing it came in. The host sends CRC frames and frames of the
+ * earlier ABCD/DCBA framing in random chunks with pauses and junk in front,
+ * then corrupted, oversized and truncated frames of both kinds, each of
+ * which must be answered with an error and leave the next frame working.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include "uartFrame.h"
+#include "host_test.h"
+
+#define UART_TEST_IDLE_MS		2
+#define UART_TEST_TIMEOUT_MS	100
+#define UART_TEST_NUM_FRAMES	300
+#define UART_TEST_RESP_ERROR	0x10		/* first byte of an error answer, | -error */
+
+static int hostFd;
+static int devFd;
+static volatile bool stop = false;
+
+/* Device */
+static UART_FRAME_RX devRx;
+static uint8_t devBuf[UART_MAX_CMD_MAX_PKT_SZ];
+
+/* Host */
+static UART_FRAME_RX hostRx;
+static uint8_t hostBuf[UART_MAX_CMD_MAX_PKT_SZ];
+static uint8_t frame[UART_MAX_CMD_MAX_PKT_SZ];
+
+/* Answers a good frame with its payload, first byte inverted, and a bad one
+ * with UART_TEST_RESP_ERROR | -error */
+static void DevRespond(void)
+{
+	uint8_t *pPayload = &devBuf[UART_FRAME_HEADER_SIZE];
+	uint32_t length;
+
+	if(devRx.state == UART_FRAME_DONE)
+	{
+		length = devRx.length;
+		pPayload[0] ^= 0xFF;
+	}
+	else
+	{
+		/* A legacy answer needs a message head for its size */
+		length = UART_MSG_HEAD_SIZE;
+		memset(pPayload, 0, length);
+		pPayload[0] = UART_TEST_RESP_ERROR | (uint8_t)-devRx.error;
+	}
+	length = UartFrame_Wrap(devBuf, length, devRx.format);
+	if(write(devFd, devBuf, length) != (ssize_t)length)
+		abort();
+	UartFrame_RxRelease(&devRx);
+}
+
+static void *DevTask(void *pArg)
+{
+	uint8_t buf[8];
+	int idleMs = 0;
+	ssize_t num;
+
+	(void)pArg;
+	UartFrame_RxInit(&devRx, &devBuf[UART_FRAME_HEADER_SIZE], UART_FRAME_MAX_PAYLOAD);
+	while(!stop)
+	{
+		struct pollfd pfd = { devFd, POLLIN, 0 };
+
+		if(poll(&pfd, 1, UART_TEST_IDLE_MS) <= 0)
+		{
+			idleMs += UART_TEST_IDLE_MS;
+			UartFrame_RxIdle(&devRx);
+			if((idleMs >= UART_TEST_TIMEOUT_MS) && UartFrame_RxTimeout(&devRx))
+				DevRespond();
+			continue;
+		}
+		idleMs = 0;
+		num = read(devFd, buf, 1 + rand() % sizeof(buf));
+		if((num > 0) && UartFrame_RxBytes(&devRx, buf, num))
+			DevRespond();
+	}
+	return NULL;
+}
+
+static void HostSend(const uint8_t *pData, uint32_t length)
+{
+	uint32_t chunk;
+
+	while(length > 0)
+	{
+		chunk = 1 + rand() % 40;
+		if(chunk > length)
+			chunk = length;
+		if(write(hostFd, pData, chunk) != (ssize_t)chunk)
+			abort();
+		pData += chunk;
+		length -= chunk;
+		if(rand() % 4 == 0)
+			usleep(300);
+	}
+}
+
+/* Waits for an answer; returns its first payload byte or -1 */
+static int HostReceive(uint32_t *pLength, UART_FRAME_FORMAT *pFormat)
+{
+	uint8_t buf[64];
+	ssize_t num;
+	int i;
+
+	UartFrame_RxInit(&hostRx, hostBuf, sizeof(hostBuf));
+	for(i = 0; i < 500; i++)
+	{
+		struct pollfd pfd = { hostFd, POLLIN, 0 };
+
+		if(poll(&pfd, 1, 10) <= 0)
+			continue;
+		num = read(hostFd, buf, sizeof(buf));
+		if((num > 0) && UartFrame_RxBytes(&hostRx, buf, num))
+		{
+			if(hostRx.state != UART_FRAME_DONE)
+				return -1;
+			*pLength = hostRx.length;
+			*pFormat = hostRx.format;
+			return hostBuf[0];
+		}
+	}
+	return -1;
+}
+
+/* Builds a frame around random bytes; a legacy payload is a message of
+ * 'length' bytes whose head gives its size */
+static uint32_t MakeFrame(uint32_t length, UART_FRAME_FORMAT format)
+{
+	uint8_t *pPayload = &frame[UART_FRAME_HEADER_SIZE];
+	uint32_t i;
+
+	for(i = 0; i < length; i++)
+		pPayload[i] = (uint8_t)rand();
+	/* Starts of frames inside the payload must not throw the receiver */
+	if(length > 12)
+	{
+		memcpy(&pPayload[5], "NNOU", 4);
+		memcpy(&pPayload[9], "ABCD", 4);
+	}
+	if(format == UART_FRAME_FORMAT_LEGACY)
+	{
+		pPayload[2] = (length - UART_MSG_HEAD_SIZE) & 0xFF;
+		pPayload[3] = ((length - UART_MSG_HEAD_SIZE) >> 8) & 0xFF;
+	}
+	return UartFrame_Wrap(frame, length, format);
+}
+
+/* Sends a good frame and checks the answer */
+static bool RoundTrip(uint32_t length, UART_FRAME_FORMAT format, bool junk)
+{
+	static const uint8_t junkBytes[] = { 'N', 'N', 'A', 'x', 'N', 'A', 'B' };
+	uint32_t size = MakeFrame(length, format);
+	uint8_t first = frame[UART_FRAME_HEADER_SIZE];
+	UART_FRAME_FORMAT rxFormat;
+	uint32_t rxLength;
+
+	if(junk)
+		HostSend(junkBytes, sizeof(junkBytes));
+	HostSend(frame, size);
+	return (HostReceive(&rxLength, &rxFormat) == (uint8_t)~first) &&
+			(rxLength == length) && (rxFormat == format);
+}
+
+/* Sends a bad frame of 'size' bytes and checks the error it is answered with */
+static bool ErrorTrip(uint32_t size, UART_FRAME_FORMAT format, int32_t error)
+{
+	UART_FRAME_FORMAT rxFormat;
+	uint32_t rxLength;
+	bool ok;
+
+	HostSend(frame, size);
+	ok = (HostReceive(&rxLength, &rxFormat) == (UART_TEST_RESP_ERROR | -error)) &&
+			(rxFormat == format);
+	/* Let the line idle so that the device resyncs */
+	usleep(10000);
+	return ok;
+}
+
+int main(void)
+{
+	static const UART_FRAME_FORMAT formats[] = { UART_FRAME_FORMAT_CRC, UART_FRAME_FORMAT_LEGACY };
+	struct termios tio;
+	pthread_t dev;
+	uint32_t size;
+	uint32_t length;
+	unsigned f;
+	int bad;
+	int i;
+
+	srand(1);
+	hostFd = posix_openpt(O_RDWR | O_NOCTTY);
+	if((hostFd < 0) || grantpt(hostFd) || unlockpt(hostFd) ||
+			((devFd = open(ptsname(hostFd), O_RDWR | O_NOCTTY)) < 0))
+	{
+		printf("test_uartFrame: no pty\n");
+		return 1;
+	}
+	tcgetattr(devFd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(devFd, TCSANOW, &tio);
+	tcgetattr(hostFd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(hostFd, TCSANOW, &tio);
+	pthread_create(&dev, NULL, DevTask, NULL);
+
+	for(f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+	{
+		/* Every small size, a whole nnoMessageStruct and random sizes;
+		 * a legacy message is at least its head */
+		bad = 0;
+		for(i = 0; i < UART_TEST_NUM_FRAMES; i++)
+		{
+			if(i < 20)
+				length = i + 1;
+			else if(i == 20)
+				length = UART_FRAME_MAX_PAYLOAD;
+			else
+				length = 1 + rand() % UART_FRAME_MAX_PAYLOAD;
+			if((formats[f] == UART_FRAME_FORMAT_LEGACY) && (length < UART_MSG_HEAD_SIZE))
+				length = UART_MSG_HEAD_SIZE;
+			if(!RoundTrip(length, formats[f], i % 7 == 3))
+				bad++;
+		}
+		CHECK(bad == 0);
+
+		/* Corrupt CRC or checksum */
+		size = MakeFrame(100, formats[f]);
+		frame[UART_FRAME_HEADER_SIZE + 50] ^= 1;
+		CHECK(ErrorTrip(size, formats[f], UART_INPUT_PKT_CHECKSUM_ERROR));
+
+		/* Truncated: the rest never comes */
+		size = MakeFrame(200, formats[f]);
+		CHECK(ErrorTrip(size - 30, formats[f], UART_INPUT_PKT_INCOMPLETE));
+
+		CHECK(RoundTrip(77, formats[f], false));
+	}
+
+	/* Length and its complement do not match */
+	size = MakeFrame(10, UART_FRAME_FORMAT_CRC);
+	frame[6] ^= 1;
+	CHECK(ErrorTrip(size, UART_FRAME_FORMAT_CRC, UART_INPUT_PKT_LENGTH_ERROR));
+
+	/* Longer than an nnoMessageStruct */
+	frame[4] = 0xFF;
+	frame[5] = 0x7F;
+	frame[6] = 0x00;
+	frame[7] = 0x80;
+	CHECK(ErrorTrip(UART_FRAME_HEADER_SIZE, UART_FRAME_FORMAT_CRC, UART_INPUT_PKT_LENGTH_ERROR));
+
+	/* Legacy head.length too long for the buffer, then one that puts the
+	 * end in the wrong place */
+	MakeFrame(10, UART_FRAME_FORMAT_LEGACY);
+	frame[UART_FRAME_HEADER_SIZE + 2] = 0xFF;
+	frame[UART_FRAME_HEADER_SIZE + 3] = 0x7F;
+	CHECK(ErrorTrip(UART_FRAME_HEADER_SIZE + UART_MSG_HEAD_SIZE, UART_FRAME_FORMAT_LEGACY,
+			UART_INPUT_PKT_LENGTH_ERROR));
+	size = MakeFrame(40, UART_FRAME_FORMAT_LEGACY);
+	frame[UART_FRAME_HEADER_SIZE + 2] -= 4;
+	CHECK(ErrorTrip(size, UART_FRAME_FORMAT_LEGACY, UART_INPUT_PKT_LENGTH_ERROR));
+
+	/* Both framings back to back */
+	CHECK(RoundTrip(64, UART_FRAME_FORMAT_LEGACY, false));
+	CHECK(RoundTrip(64, UART_FRAME_FORMAT_CRC, false));
+
+	stop = true;
+	pthread_join(dev, NULL);
+	printf("device: %u frames, %u CRC/checksum, %u length, %u incomplete errors, %u bytes dropped\n",
+			devRx.stats.num_frames, devRx.stats.num_crc_errors, devRx.stats.num_length_errors,
+			devRx.stats.num_incomplete, devRx.stats.num_dropped);
+
+	return host_test_result("test_uartFrame");
+}
@@ -0,0 +1,82 @@
+/*
+ *
+ * Host loopback test of the USB bulk framing (App/usbBulkProto.c): frames of
+ * every length around the packet and header boundaries go from the sender
+ * to the receiver packet by packet, and a wrong tag, a frame longer than set
+ * up and a corrupted packet are reported as errors.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "usbBulkProto.h"
+#include "host_test.h"
+
+#define TEST_MAX_FRAME	70000
+
+static uint8_t src[TEST_MAX_FRAME];
+static uint8_t dst[TEST_MAX_FRAME];
+
+/* Sends one frame through the receiver; corrupt_pkt < 0 leaves it intact */
+static USB_BULK_STATE Loop(uint32_t length, uint16_t tx_tag, uint16_t rx_tag,
+		uint32_t max_length, int corrupt_pkt, USB_BULK_ERROR *pError)
+{
+	USB_BULK_TX tx;
+	USB_BULK_RX rx;
+	uint8_t pkt[USB_BULK_MAX_PKT_SIZE];
+	uint32_t num;
+	USB_BULK_STATE state = USB_BULK_STATE_RECEIVING;
+	int i = 0;
+
+	memset(dst, 0, sizeof(dst));
+	UsbBulkProto_TxStart(&tx, tx_tag, src, length, USB_BULK_MAX_PKT_SIZE);
+	UsbBulkProto_RxStart(&rx, rx_tag, dst, max_length);
+	while(UsbBulkProto_TxNext(&tx, pkt, &num))
+	{
+		if(i++ == corrupt_pkt)
+			pkt[0] ^= 1;
+		state = UsbBulkProto_RxPacket(&rx, pkt, num);
+		/* A short packet, zero length included, ends the frame */
+		if(num < USB_BULK_MAX_PKT_SIZE)
+			break;
+	}
+	CHECK(!UsbBulkProto_TxNext(&tx, pkt, &num));
+
+	*pError = rx.error;
+	return state;
+}
+
+int main(void)
+{
+	static const uint32_t lengths[] = { 0, 1, 47, 48, 49, 111, 112, 113, 3786, 65536, 69000 };
+	USB_BULK_ERROR error;
+	unsigned i;
+
+	srand(1);
+	for(i = 0; i < TEST_MAX_FRAME; i++)
+		src[i] = (uint8_t)rand();
+
+	for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+	{
+		CHECK(Loop(lengths[i], 7, 7, TEST_MAX_FRAME, -1, &error) == USB_BULK_STATE_DONE);
+		CHECK(error == USB_BULK_ERR_NONE);
+		CHECK(!memcmp(src, dst, lengths[i]));
+	}
+
+	CHECK(Loop(100, 7, 8, TEST_MAX_FRAME, -1, &error) == USB_BULK_STATE_ERROR);
+	CHECK(error == USB_BULK_ERR_TAG);
+	CHECK(Loop(100, 7, 7, 99, -1, &error) == USB_BULK_STATE_ERROR);
+	CHECK(error == USB_BULK_ERR_LENGTH);
+	CHECK(Loop(200, 7, 7, TEST_MAX_FRAME, 1, &error) == USB_BULK_STATE_ERROR);
+	CHECK(error == USB_BULK_ERR_CRC);
+	CHECK(Loop(200, 7, 7, TEST_MAX_FRAME, 0, &error) == USB_BULK_STATE_ERROR);
+	CHECK(error == USB_BULK_ERR_MAGIC);
+
+	return host_test_result("test_usbBulk");
+}
@@ -0,0 +1,73 @@
+/*
+ *
+ * Host test of the USB command queue (App/usbCmdQueue.c): which commands
+ * the receive task answers on the spot, the order the worker gets the rest
+ * in, status queries kept behind commands sent without a reply, a full
+ * queue and the statistics.
+ *
+ * Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ * ALL RIGHTS RESERVED
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "usbCmdQueue.h"
+#include "host_test.h"
+
+static nnoMessageStruct MakeCmd(uint16_t cmd, int rw, bool reply)
+{
+	nnoMessageStruct msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.head.flags.rw = rw;
+	msg.head.flags.reply = reply;
+	msg.head.length = 2;
+	msg.payload.cmd = cmd;
+	return msg;
+}
+
+int main(void)
+{
+	nnoMessageStruct status = MakeCmd(0x0219, RESPONSE, true);		/* NNO_CMD_SCAN_GET_STATUS */
+	nnoMessageStruct noReply = MakeCmd(0x0218, REQUEST, false);
+	nnoMessageStruct save = MakeCmd(0x0221, REQUEST, true);
+	USB_CMD_QUEUE_STATS stats;
+
+	UsbCmdQueue_Init();
+	CHECK(UsbCmdQueue_Key(&status) == NNO_CMD_SCAN_GET_STATUS);
+	CHECK(UsbCmdQueue_Front() == NULL);
+
+	CHECK(UsbCmdQueue_Submit(&status) == USB_CMD_RUN_NOW);
+	CHECK(UsbCmdQueue_Submit(&save) == USB_CMD_QUEUED);
+	/* Overtakes a command the host waits for a reply to */
+	CHECK(UsbCmdQueue_Submit(&status) == USB_CMD_RUN_NOW);
+	CHECK(UsbCmdQueue_Submit(&noReply) == USB_CMD_QUEUED);
+	/* Kept behind the command sent without a reply */
+	CHECK(UsbCmdQueue_Submit(&status) == USB_CMD_QUEUED);
+	CHECK(UsbCmdQueue_Submit(&save) == USB_CMD_QUEUED);
+	CHECK(UsbCmdQueue_Submit(&save) == USB_CMD_QUEUE_FULL);
+
+	CHECK(UsbCmdQueue_Front()->payload.cmd == 0x0221);
+	UsbCmdQueue_Pop();
+	CHECK(UsbCmdQueue_Front()->payload.cmd == 0x0218);
+	UsbCmdQueue_Pop();
+	/* The command sent without a reply has run */
+	CHECK(UsbCmdQueue_Submit(&status) == USB_CMD_RUN_NOW);
+	CHECK(UsbCmdQueue_Front()->payload.cmd == 0x0219);
+	UsbCmdQueue_Pop();
+	CHECK(UsbCmdQueue_Front()->payload.cmd == 0x0221);
+	UsbCmdQueue_Pop();
+	CHECK(UsbCmdQueue_Front() == NULL);
+
+	UsbCmdQueue_GetStats(&stats);
+	CHECK(stats.num_immediate == 3);
+	CHECK(stats.num_queued == 4);
+	CHECK(stats.num_busy == 1);
+	CHECK(stats.depth == 0);
+	CHECK(stats.depth_max == USB_CMD_QUEUE_DEPTH);
+
+	return host_test_result("test_usbCmdQueue");
+}
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""
+Renders the scan trace of the NIRscan Nano firmware (see
+App/include/scanTrace.h) as a timeline and per-phase timing summary.
+
+The trace is read from the device as the NNO_FILE_SCAN_TRACE file and saved
+as is.
+
+    scantrace_decode.py trace.bin
+    scantrace_decode.py --summary trace.bin
+
+Copyright (C) 2014-2015 Texas Instruments Incorporated - http://www.ti.com/
+ALL RIGHTS RESERVED
+"""
+
+import argparse
+import struct
+import sys
+
+SCAN_TRACE_DUMP_VERSION = 1
+SCAN_TRACE_DUMP_HEADER_SIZE = 16
+
+# SCAN_TRACE_EVENT in scanTrace.h; IDs are only ever appended there
+EVENTS = {
+    1: 'SCAN_START',
+    2: 'SETUP_START',
+    3: 'DLPC_ON',
+    4: 'LAMP_ON',
+    5: 'DLPC_CONFIGURED',
+    6: 'PGA_PRESCAN_START',
+    7: 'PGA_SET',
+    8: 'SETUP_END',
+    9: 'RUN_PATTERNS_START',
+    10: 'FRAMES_PROPAGATED',
+    11: 'RUN_PATTERNS_END',
+    12: 'REPEAT_DONE',
+    13: 'PROCESSING_DONE',
+    14: 'SCAN_END',
+    15: 'DLPC_CONFIGURE_START',
+    0x40: 'ISR_FRAME',
+    0x41: 'ISR_PATTERN',
+    0x42: 'ISR_DRDY',
+    0x43: 'ISR_DISPLAY',
+}
+
+# Phases reported by --summary: name, event that starts it, event that ends it
+PHASES = [
+    ('setup', 'SETUP_START', 'SETUP_END'),
+    ('dlpc150 configure', 'DLPC_CONFIGURE_START', 'DLPC_CONFIGURED'),
+    ('pga pre-scan', 'PGA_PRESCAN_START', 'PGA_SET'),
+    ('run patterns', 'RUN_PATTERNS_START', 'RUN_PATTERNS_END'),
+    ('scan', 'SCAN_START', 'SCAN_END'),
+]
+
+
+def parse(data):
+    """Returns (clock_hz, lost, [(time_s, event, arg)]) from a trace dump"""
+    if len(data) < SCAN_TRACE_DUMP_HEADER_SIZE:
+        raise ValueError('trace is shorter than its header')
+    version, entry_size, num_entries, first, clock_hz = struct.unpack_from('<HHIII', data, 0)
+    if version != SCAN_TRACE_DUMP_VERSION:
+        raise ValueError('unsupported trace version %d' % version)
+    if entry_size < 8 or len(data) < SCAN_TRACE_DUMP_HEADER_SIZE + num_entries * entry_size:
+        raise ValueError('trace is truncated')
+    if clock_hz == 0:
+        raise ValueError('trace does not give the clock frequency')
+
+    events = []
+    elapsed = 0
+    last_cycles = None
+    for i in range(num_entries):
+        cycles, event, arg = struct.unpack_from('<IHH', data, SCAN_TRACE_DUMP_HEADER_SIZE + i * entry_size)
+        # The 32-bit cycle counter wraps every 35 s at 120 MHz
+        if last_cycles is not None:
+            elapsed += (cycles - last_cycles) & 0xFFFFFFFF
+        last_cycles = cycles
+        events.append((elapsed / float(clock_hz), event, arg))
+    return clock_hz, first, events
+
+
+def name(event):
+    return EVENTS.get(event, 'UNKNOWN_0x%04x' % event)
+
+
+def timeline(lost, events):
+    if lost:
+        print('---- %d older events overwritten ----' % lost)
+    last = None
+    for t, event, arg in events:
+        delta = 0.0 if last is None else t - last
+        last = t
+        print('[%12.6f] +%10.3f ms  %-20s %d' % (t, delta * 1000, name(event), arg))
+
+
+def summary(events):
+    for phase, start, end in PHASES:
+        durations = []
+        started = None
+        for t, event, _ in events:
+            if name(event) == start:
+                started = t
+            elif name(event) == end and started is not None:
+                durations.append(t - started)
+                started = None
+        if durations:
+            print('%-18s n=%-4d min %9.3f  avg %9.3f  max %9.3f ms' % (
+                phase, len(durations), min(durations) * 1000,
+                sum(durations) / len(durations) * 1000, max(durations) * 1000))
+
+    # Interrupt periods, from consecutive events of the same kind
+    for isr in ('ISR_FRAME', 'ISR_PATTERN', 'ISR_DRDY', 'ISR_DISPLAY'):
+        times = [t for t, event, _ in events if name(event) == isr]
+        if len(times) < 2:
+            continue
+        periods = [b - a for a, b in zip(times, times[1:])]
+        print('%-18s n=%-4d min %9.3f  avg %9.3f  max %9.3f ms' % (
+            isr.lower() + ' period', len(periods), min(periods) * 1000,
+            sum(periods) / len(periods) * 1000, max(periods) * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('trace', help='NNO_FILE_SCAN_TRACE dump; - for standard input')
+    parser.add_argument('--summary', action='store_true', help='print phase durations and interrupt periods only')
+    args = parser.parse_args()
+
+    data = sys.stdin.buffer.read() if args.trace == '-' else open(args.trace, 'rb').read()
+    try:
+        _, lost, events = parse(data)
+    except ValueError as e:
+        sys.exit('%s: %s' % (args.trace, e))
+
+    if args.summary:
+        summary(events)
+    else:
+        timeline(lost, events)
+
+
+if __name__ == '__main__':
+    main()